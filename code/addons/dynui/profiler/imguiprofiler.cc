@@ -322,6 +322,26 @@ ImguiProfiler::Render(Timing::Time frameTime, IndexT frameIndex)
                     ImGui::PopStyleColor();
                 }
 
+                ImGui::PopFont();
+            }
+            if (ImGui::CollapsingHeader("Histograms"))
+            {
+                ImGui::PushFont(Dynui::ImguiSmallFont);
+
+                const Util::Array<Profiling::ProfilingHistogram>& histograms = Profiling::ProfilingGetHistograms();
+                for (const Profiling::ProfilingHistogram& histogram : histograms)
+                {
+                    ImGui::LabelText(histogram.name, "%llu values, mean %.2f", (unsigned long long)histogram.count, histogram.count > 0 ? histogram.sum / double(histogram.count) : 0.0);
+
+                    // bucket i counts the values below 2^i
+                    float buckets[Profiling::ProfilingHistogramBuckets];
+                    for (uint32_t i = 0; i < Profiling::ProfilingHistogramBuckets; i++)
+                        buckets[i] = (float)histogram.buckets[i];
+                    ImGui::PushID(histogram.name);
+                    ImGui::PlotHistogram("", buckets, Profiling::ProfilingHistogramBuckets, 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+                    ImGui::PopID();
+                }
+
                 ImGui::PopFont();
             }
         }
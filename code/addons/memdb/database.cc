@@ -13,6 +13,27 @@ namespace MemDb
 
 __ImplementClass(MemDb::Database, 'MmDb', Core::RefCounted);
 
+//------------------------------------------------------------------------------
+/**
+    Invalid signatures compare as equal, since an empty exclusive set is the common case.
+*/
+static bool
+SignaturesEqual(TableSignature const& lhs, TableSignature const& rhs)
+{
+    if (!lhs.IsValid() || !rhs.IsValid())
+        return lhs.IsValid() == rhs.IsValid();
+    return lhs == rhs;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static uint32_t
+QueryHash(TableSignature const& inclusive, TableSignature const& exclusive)
+{
+    return inclusive.HashCode() ^ (exclusive.HashCode() * 0x9E3779B1);
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -31,6 +52,11 @@ Database::~Database()
         if (this->IsValid(this->tables[tableIndex].tid))
             this->DeleteTable(this->tables[tableIndex].tid);
     }
+
+    for (QueryCache* query : this->queryCaches)
+        delete query;
+    this->queryCaches.Clear();
+    this->queryCacheTable.Clear();
 }
 
 //------------------------------------------------------------------------------
@@ -62,6 +88,17 @@ Database::CreateTable(TableCreateInfo const& info)
 
     this->numTables = (Ids::Index(id.id) + 1 > this->numTables ? Ids::Index(id.id) + 1 : this->numTables);
 
+    // add the table to every persistent query it fulfills, from now on the table reports its own changes
+    table.db = this;
+    for (QueryCache* query : this->queryCaches)
+    {
+        if (MatchesQuery(signature, query->inclusive, query->exclusive))
+        {
+            query->tables.Append(id);
+            query->dirty = true;
+        }
+    }
+
     return id;
 }
 
@@ -73,6 +110,20 @@ Database::DeleteTable(TableId tid)
 {
     n_assert(this->IsValid(tid));
     Table& table = this->tables[Ids::Index(tid.id)];
+
+    for (QueryCache* query : this->queryCaches)
+    {
+        if (MatchesQuery(table.signature, query->inclusive, query->exclusive))
+        {
+            IndexT const index = query->tables.FindIndex(tid);
+            if (index != InvalidIndex)
+            {
+                query->tables.EraseIndexSwap(index);
+                query->dirty = true;
+            }
+        }
+    }
+
     table = Table();
     this->tableIdPool.Deallocate(tid.id);
 }
@@ -124,6 +175,13 @@ Database::Reset()
     {
         this->tables[i] = Table();
     }
+
+    // no table fulfills any signature anymore
+    for (QueryCache* query : this->queryCaches)
+    {
+        query->tables.Clear();
+        query->dirty = true;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -202,16 +260,10 @@ Database::Query(TableSignature const& inclusive, TableSignature const& exclusive
 
     for (IndexT tableIndex = 0; tableIndex < this->numTables; tableIndex++)
     {
-        if (!MemDb::TableSignature::CheckBits(this->tables[tableIndex].signature, inclusive))
+        Table const& tbl = this->tables[tableIndex];
+        if (!MatchesQuery(tbl.signature, inclusive, exclusive))
             continue;
 
-        if (exclusive.IsValid())
-        {
-            if (MemDb::TableSignature::HasAny(this->tables[tableIndex].signature, exclusive))
-                continue;
-        }
-
-        Table const& tbl = this->tables[Ids::Index(tableIndex)];
         if (this->IsValid(tbl.tid) && tbl.totalNumRows > 0)
             result.Append(tbl.tid);
     }
@@ -219,6 +271,130 @@ Database::Query(TableSignature const& inclusive, TableSignature const& exclusive
     return result;
 }
 
+//------------------------------------------------------------------------------
+/**
+    Looks up or creates a persistent query. The first call for a signature pair scans
+    all tables once, after that CreateTable and DeleteTable keep the result up to date,
+    so that subsequent calls only cost a hash lookup.
+
+    Unlike Query, empty tables are part of the result since they might receive rows
+    at any point.
+
+    @note   Not thread safe, same as creating and deleting tables.
+*/
+Util::Array<TableId> const&
+Database::CachedQuery(TableSignature const& inclusive, TableSignature const& exclusive)
+{
+    return this->FindQuery(inclusive, exclusive)->tables;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Same as CachedQuery, but also returns the active partitions of the tables. Tables
+    mark their queries dirty when a partition is activated or recycled, the partitions
+    are only collected again on the first call after that.
+
+    @note   Not thread safe, same as creating and deleting tables.
+*/
+Database::QueryCache const&
+Database::CachedPartitionQuery(TableSignature const& inclusive, TableSignature const& exclusive)
+{
+    QueryCache* query = this->FindQuery(inclusive, exclusive);
+    if (query->dirty)
+    {
+        query->partitions.Clear();
+        for (TableId const tid : query->tables)
+        {
+            Table& tbl = this->tables[Ids::Index(tid.id)];
+            for (Table::Partition* part = tbl.GetFirstActivePartition(); part != nullptr; part = part->next)
+                query->partitions.Append({ tid, part });
+        }
+        query->version++;
+        query->dirty = false;
+    }
+    return *query;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Database::QueryCache*
+Database::FindQuery(TableSignature const& inclusive, TableSignature const& exclusive)
+{
+    uint32_t const hash = QueryHash(inclusive, exclusive);
+    QueryCache* bucket = nullptr;
+    IndexT const bucketIndex = this->queryCacheTable.FindIndex(hash);
+    if (bucketIndex != InvalidIndex)
+    {
+        bucket = this->queryCacheTable.ValueAtIndex(hash, bucketIndex);
+        for (QueryCache* query = bucket; query != nullptr; query = query->next)
+        {
+            if (SignaturesEqual(query->inclusive, inclusive) && SignaturesEqual(query->exclusive, exclusive))
+                return query;
+        }
+    }
+
+    QueryCache* query = new QueryCache;
+    query->inclusive = inclusive;
+    query->exclusive = exclusive;
+    for (IndexT tableIndex = 0; tableIndex < this->numTables; tableIndex++)
+    {
+        Table const& tbl = this->tables[tableIndex];
+        if (this->IsValid(tbl.tid) && MatchesQuery(tbl.signature, inclusive, exclusive))
+            query->tables.Append(tbl.tid);
+    }
+
+    // prepend to the bucket
+    query->next = bucket;
+    if (bucketIndex != InvalidIndex)
+        this->queryCacheTable.ValueAtIndex(hash, bucketIndex) = query;
+    else
+        this->queryCacheTable.Add(hash, query);
+    this->queryCaches.Append(query);
+
+    return query;
+}
+
+//------------------------------------------------------------------------------
+/**
+    The signature of the table might have changed as well, so the membership of the
+    table is checked again for every query.
+*/
+void
+Database::InvalidateQueries(Table const& table)
+{
+    for (QueryCache* query : this->queryCaches)
+    {
+        IndexT const index = query->tables.FindIndex(table.tid);
+        if (MatchesQuery(table.signature, query->inclusive, query->exclusive))
+        {
+            if (index == InvalidIndex)
+                query->tables.Append(table.tid);
+            query->dirty = true;
+        }
+        else if (index != InvalidIndex)
+        {
+            query->tables.EraseIndexSwap(index);
+            query->dirty = true;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+Database::MatchesQuery(TableSignature const& signature, TableSignature const& inclusive, TableSignature const& exclusive)
+{
+    if (!TableSignature::CheckBits(signature, inclusive))
+        return false;
+
+    if (exclusive.IsValid() && TableSignature::HasAny(signature, exclusive))
+        return false;
+
+    return true;
+}
+
 //------------------------------------------------------------------------------
 /**
     Note that this function will override an old table if the signature exists
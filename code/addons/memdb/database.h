@@ -19,6 +19,7 @@
 #include "dataset.h"
 #include "filterset.h"
 #include "util/blob.h"
+#include "util/hashtable.h"
 
 namespace MemDb
 {
@@ -56,6 +57,34 @@ public:
     Dataset Query(FilterSet const& filterset);
     /// Query the database for a set of tables that fulfill the requirements
     Util::Array<TableId> Query(TableSignature const& inclusive, TableSignature const& exclusive);
+    /// persistent query, kept up to date whenever a table or partition is created or deleted
+    struct QueryCache
+    {
+        /// an active partition of one of the tables
+        struct ActivePartition
+        {
+            TableId table;
+            Table::Partition* partition;
+        };
+
+        TableSignature inclusive;
+        TableSignature exclusive;
+        /// all valid tables matching the query, including empty ones
+        Util::Array<TableId> tables;
+        /// all active partitions of the tables, in table order
+        Util::Array<ActivePartition> partitions;
+        /// bumped whenever the tables or partitions change, use it to tell if data derived from them is stale
+        uint32_t version = 0;
+        /// set if the partitions have to be collected again before the next use
+        bool dirty = true;
+        /// next query in the same hash bucket
+        QueryCache* next = nullptr;
+    };
+
+    /// Get a persistent query for a set of tables. The returned array stays valid for the lifetime of the database, and is kept up to date as tables are created and deleted
+    Util::Array<TableId> const& CachedQuery(TableSignature const& inclusive, TableSignature const& exclusive);
+    /// Get a persistent query including the active partitions of its tables. The returned query stays valid for the lifetime of the database
+    QueryCache const& CachedPartitionQuery(TableSignature const& inclusive, TableSignature const& exclusive);
 
     /// copy the database into dst
     void Copy(Ptr<MemDb::Database> const& dst) const;
@@ -64,6 +93,15 @@ public:
     static constexpr uint32_t MAX_NUM_TABLES = 512;
 
 private:
+    friend class Table;
+
+    /// find or create a persistent query
+    QueryCache* FindQuery(TableSignature const& inclusive, TableSignature const& exclusive);
+    /// called by tables when their signature or partitions change
+    void InvalidateQueries(Table const& table);
+    /// check if a table signature fulfills the requirements of a query
+    static bool MatchesQuery(TableSignature const& signature, TableSignature const& inclusive, TableSignature const& exclusive);
+
     /// id pool for table ids
     Ids::IdGenerationPool tableIdPool;
 
@@ -72,6 +110,11 @@ private:
 
     /// number of tables existing currently
     SizeT numTables = 0;
+
+    /// all cached queries, allocated individually so that references to their table arrays are stable
+    Util::Array<QueryCache*> queryCaches;
+    /// maps a hash of the inclusive and exclusive signatures to the first cached query in that bucket
+    Util::HashTable<uint32_t, QueryCache*> queryCacheTable;
 };
 
 //------------------------------------------------------------------------------
@@ -4,6 +4,7 @@
 //------------------------------------------------------------------------------
 #include "foundation/stdneb.h"
 #include "table.h"
+#include "database.h"
 #include "attribute.h"
 #include "attributeregistry.h"
 #include "util/blob.h"
@@ -85,6 +86,7 @@ Table::NewPartition()
     }
 
     partition->next = this->firstActivePartition;
+    partition->previous = nullptr;
     if (this->firstActivePartition != nullptr)
     {
         this->firstActivePartition->previous = partition;
@@ -94,6 +96,9 @@ Table::NewPartition()
     this->numActivePartitions++;
 
     this->currentPartition = partition;
+
+    if (this->db != nullptr)
+        this->db->InvalidateQueries(*this);
        
     return partition;
 }
@@ -177,6 +182,9 @@ Table::AddAttribute(AttributeId attribute, bool updateSignature)
         signature.FlipBit(attribute);
     }
 
+    if (this->db != nullptr)
+        this->db->InvalidateQueries(*this);
+
     Attribute const* const desc = AttributeRegistry::GetAttribute(attribute);
 
     for (Partition* part : this->partitions)
@@ -277,6 +285,7 @@ SizeT
 Table::Defragment(std::function<void(Partition*, MemDb::RowId, MemDb::RowId)> const& moveCallback)
 {
     SizeT numErased = 0;
+    bool recycled = false;
 
     uint16_t index;
     uint16_t lastIndex;
@@ -323,6 +332,8 @@ Table::Defragment(std::function<void(Partition*, MemDb::RowId, MemDb::RowId)> co
                 part->next->previous = part->previous;
             if (part->previous != nullptr)
                 part->previous->next = part->next;
+            if (this->firstActivePartition == part)
+                this->firstActivePartition = part->next;
             Partition* nextPart = part->next;
             this->freePartitions.Append(part);
 
@@ -331,6 +342,7 @@ Table::Defragment(std::function<void(Partition*, MemDb::RowId, MemDb::RowId)> co
             part->version++;
 
             this->numActivePartitions--;
+            recycled = true;
             part = nextPart;
         }
         else
@@ -357,6 +369,9 @@ Table::Defragment(std::function<void(Partition*, MemDb::RowId, MemDb::RowId)> co
         }
     }
 
+    if (recycled && this->db != nullptr)
+        this->db->InvalidateQueries(*this);
+
     this->totalNumRows -= numErased;
     return numErased;
 }
@@ -399,6 +414,9 @@ Table::Reset()
     }
     this->partitions.Reset();
     this->currentPartition = nullptr;
+
+    if (this->db != nullptr)
+        this->db->InvalidateQueries(*this);
 }
 
 //------------------------------------------------------------------------------
@@ -660,11 +678,14 @@ Table::MigrateInstances(
 
 //------------------------------------------------------------------------------
 /**
+    Rows which are consecutive in both the source and the destination
+    partitions are copied column by column with a single copy per run.
 */
 void
 Table::DuplicateInstances(Table& src, Util::Array<RowId> const& srcRows, Table& dst, Util::FixedArray<RowId>& dstRows)
 {
-    for (int i = 0; i < srcRows.Size(); i++)
+    SizeT const num = srcRows.Size();
+    for (IndexT i = 0; i < num; i++)
     {
         dstRows[i] = dst.AddRow();
     }
@@ -678,35 +699,44 @@ Table::DuplicateInstances(Table& src, Util::Array<RowId> const& srcRows, Table&
         SizeT const byteSize = desc->typeSize;
         ColumnIndex const srcColId = src.GetAttributeIndex(attribute);
 
-        for (IndexT i = 0; i < srcRows.Size(); i++)
+        IndexT row = 0;
+        while (row < num)
         {
-            RowId srcRow = srcRows[i];
-            RowId dstRow = dstRows[i];
-
-            Partition* srcPart = src.partitions[srcRow.partition];
-            Partition* dstPart = dst.partitions[dstRow.partition];
-
-            auto& buffers = srcPart->columns;
-            auto& dstBuffers = dstPart->columns;
-
-            void*& dstBuf = dstBuffers[i];
+            RowId const srcRow = srcRows[row];
+            RowId const dstRow = dstRows[row];
+
+            // Find how many of the following rows are contiguous in both tables
+            SizeT runLength = 1;
+            while (row + runLength < num
+                   && srcRows[row + runLength].partition == srcRow.partition
+                   && srcRows[row + runLength].index == srcRow.index + runLength
+                   && dstRows[row + runLength].partition == dstRow.partition
+                   && dstRows[row + runLength].index == dstRow.index + runLength)
+            {
+                runLength++;
+            }
 
+            void* dstBuf = dst.partitions[dstRow.partition]->columns[i];
             if (srcColId != ColumnIndex::Invalid())
             {
-                // Copy value from src
-                void*& srcBuf = buffers[srcColId.id];
+                // Copy values from src
+                void* srcBuf = src.partitions[srcRow.partition]->columns[srcColId.id];
                 Memory::Copy(
                     (char*)srcBuf + ((size_t)byteSize * srcRow.index),
                     (char*)dstBuf + ((size_t)byteSize * dstRow.index),
-                    byteSize
+                    byteSize * runLength
                 );
             }
             else
             {
-                // Set default value
-                void* val = (char*)dstBuf + ((size_t)dstRow.index * desc->typeSize);
-                Memory::Copy(desc->defVal, val, desc->typeSize);
+                // Set default values
+                for (IndexT r = 0; r < runLength; r++)
+                {
+                    void* val = (char*)dstBuf + ((size_t)(dstRow.index + r) * byteSize);
+                    Memory::Copy(desc->defVal, val, byteSize);
+                }
             }
+            row += runLength;
         }
     }
 }
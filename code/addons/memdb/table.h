@@ -37,6 +37,8 @@ struct TableCreateInfo
     SizeT numAttributes;
 };
 
+class Database;
+
 //------------------------------------------------------------------------------
 /**
     @class MemDb::Table
@@ -180,6 +182,8 @@ private:
     Util::Array<AttributeId> attributes;
     /// maps attr id -> index in columns array
     Util::HashTable<AttributeId, IndexT, 32, 1> columnRegistry;
+    /// the database owning the table, told whenever the partitions or columns change
+    Database* db = nullptr;
 };
 
 //------------------------------------------------------------------------------
@@ -41,6 +41,8 @@ public:
     TableSignature& operator=(TableSignature const& rhs);
     /// equality operator
     bool const operator==(TableSignature const& rhs) const;
+    /// get a hash code for the signature, invalid signatures hash to 0
+    uint32_t HashCode() const;
     /// check if signature is valid
     bool const IsValid() const { return size > 0; }
     /// check if a single bit is set
@@ -193,6 +195,23 @@ TableSignature::operator==(TableSignature const& rhs) const
     return true;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+inline uint32_t
+TableSignature::HashCode() const
+{
+    uint64_t hash = 0;
+    for (int i = 0; i < this->size; i++)
+    {
+        alignas(16) uint64_t parts[2];
+        _mm_store_si128((__m128i*)parts, this->mask[i]);
+        hash = (hash ^ parts[0]) * 0x100000001B3ull;
+        hash = (hash ^ parts[1]) * 0x100000001B3ull;
+    }
+    return uint32_t(hash ^ (hash >> 32));
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -0,0 +1,94 @@
+//------------------------------------------------------------------------------
+//  @file snapshotreceiver.cc
+//  @copyright (C) 2025 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "snapshotreceiver.h"
+
+namespace Multiplayer
+{
+
+//--------------------------------------------------------------------------
+/**
+*/
+SnapshotReceiver::SnapshotReceiver() :
+    latestSequence(0)
+{
+    // empty
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+void
+SnapshotReceiver::Reset()
+{
+    for (uint i = 0; i < SnapshotHistorySize; i++)
+    {
+        this->history[i].sequence = 0;
+        this->history[i].tick = 0;
+        this->history[i].entities.Clear();
+    }
+    this->latestSequence = 0;
+    this->changed.Clear();
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+bool
+SnapshotReceiver::Receive(ubyte const* data, SizeT size)
+{
+    BitReader reader(data, size);
+    uint sequence, baselineSequence;
+    uint64_t tick;
+    if (!DecodeSnapshotHeader(reader, sequence, baselineSequence, tick) || sequence <= this->latestSequence)
+    {
+        return false;
+    }
+
+    Snapshot const* baseline = nullptr;
+    if (baselineSequence != 0)
+    {
+        baseline = &this->history[baselineSequence % SnapshotHistorySize];
+        if (baseline->sequence != baselineSequence || baselineSequence >= sequence)
+        {
+            return false;
+        }
+    }
+
+    this->decoded.sequence = sequence;
+    this->decoded.tick = tick;
+    if (!DecodeSnapshot(reader, baseline, this->decoded))
+    {
+        n_warning("SnapshotReceiver: dropped malformed snapshot %u\n", sequence);
+        return false;
+    }
+
+    // find the entities which changed since the previous latest snapshot
+    static const Util::Array<SnapshotEntityState> noEntities;
+    Util::Array<SnapshotEntityState> const& current = this->decoded.entities;
+    Util::Array<SnapshotEntityState> const& previous = this->latestSequence != 0 ? this->GetLatestSnapshot().entities : noEntities;
+    this->changed.Clear();
+    IndexT p = 0;
+    for (IndexT c = 0; c < current.Size(); c++)
+    {
+        while (p < previous.Size() && previous[p].networkId < current[c].networkId)
+        {
+            p++;
+        }
+        if (p == previous.Size() || !SnapshotStatesEqual(previous[p], current[c]))
+        {
+            this->changed.Append(c);
+        }
+    }
+
+    Snapshot& slot = this->history[sequence % SnapshotHistorySize];
+    slot.sequence = this->decoded.sequence;
+    slot.tick = this->decoded.tick;
+    std::swap(slot.entities, this->decoded.entities);
+    this->latestSequence = sequence;
+    return true;
+}
+
+} // namespace Multiplayer
@@ -0,0 +1,78 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Multiplayer::SnapshotReceiver
+
+    Client side of the snapshot replication, decodes the snapshot messages
+    built by the SnapshotReplicator. The last SnapshotHistorySize snapshots
+    are kept, since the server may encode against any of them.
+
+    After a snapshot was received, its sequence should be acknowledged to
+    the server, which then uses it as the baseline for later snapshots.
+    Snapshots which arrive out of order are dropped.
+
+    @copyright
+    (C) 2025 Individual contributors, see AUTHORS file
+*/
+#include "core/types.h"
+#include "util/array.h"
+#include "multiplayer/snapshot/snapshot.h"
+
+//------------------------------------------------------------------------------
+namespace Multiplayer
+{
+
+class SnapshotReceiver
+{
+public:
+    /// constructor
+    SnapshotReceiver();
+
+    /// decode a snapshot message, returns false if it is outdated, malformed, or its baseline is unknown
+    bool Receive(ubyte const* data, SizeT size);
+    /// forget all snapshots, for example after reconnecting
+    void Reset();
+
+    /// get the sequence of the latest snapshot, 0 if none was received yet
+    uint GetLatestSequence() const;
+    /// get the latest snapshot
+    Snapshot const& GetLatestSnapshot() const;
+    /// get the indices of the entities in the latest snapshot which are new or changed since the previous one
+    Util::Array<IndexT> const& GetChangedEntities() const;
+
+private:
+    Snapshot history[SnapshotHistorySize];
+    Snapshot decoded;
+    uint latestSequence;
+    Util::Array<IndexT> changed;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline uint
+SnapshotReceiver::GetLatestSequence() const
+{
+    return this->latestSequence;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline Snapshot const&
+SnapshotReceiver::GetLatestSnapshot() const
+{
+    return this->history[this->latestSequence % SnapshotHistorySize];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline Util::Array<IndexT> const&
+SnapshotReceiver::GetChangedEntities() const
+{
+    return this->changed;
+}
+
+} // namespace Multiplayer
+//------------------------------------------------------------------------------
@@ -56,7 +56,7 @@ StandardMultiplayerClient::OnIsConnecting()
 void
 StandardMultiplayerClient::OnConnected()
 {
-
+    this->snapshotReceiver.Reset();
 }
 
 //--------------------------------------------------------------------------
@@ -65,7 +65,64 @@ StandardMultiplayerClient::OnConnected()
 void
 StandardMultiplayerClient::OnDisconnected()
 {
+    this->snapshotReceiver.Reset();
+}
+
+//--------------------------------------------------------------------------
+/**
+    The view position is sent to the server with the next snapshot
+    acknowledgement, usually it is set every frame from the camera.
+*/
+void
+StandardMultiplayerClient::SetViewPosition(Math::vec3 const& position)
+{
+    this->hasViewPosition = true;
+    this->viewPosition = position;
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+void
+StandardMultiplayerClient::ClearViewPosition()
+{
+    this->hasViewPosition = false;
+}
+
+//--------------------------------------------------------------------------
+/**
+    Entities which didn't change since the previous snapshot keep
+    extrapolating from their last sample.
+*/
+void
+StandardMultiplayerClient::ApplySnapshot()
+{
+    Game::World* world = Game::GetWorld(WORLD_DEFAULT);
+    Game::TimeSource const* const timeSource = Game::Time::GetTimeSource(TIMESOURCE_GAMEPLAY);
 
+    Snapshot const& snapshot = this->snapshotReceiver.GetLatestSnapshot();
+    Util::Array<IndexT> const& changed = this->snapshotReceiver.GetChangedEntities();
+    for (IndexT i = 0; i < changed.Size(); i++)
+    {
+        SnapshotEntityState const& state = snapshot.entities[changed[i]];
+        IndexT hashIndex = this->networkEntities.FindIndex(state.networkId);
+        if (hashIndex == InvalidIndex)
+            continue;
+
+        Game::Entity entity = this->networkEntities.ValueAtIndex(state.networkId, hashIndex);
+        NetworkTransform netTransform = world->GetComponent<NetworkTransform>(entity);
+        netTransform.tickNumber = snapshot.tick;
+        netTransform.positionExtrapolator.AddSample(timeSource->time - (this->GetCurrentPing() / 2.0), timeSource->time, GetSnapshotPosition(state), GetSnapshotVelocity(state));
+        world->SetComponent<NetworkTransform>(entity, netTransform);
+    }
+
+    // the view position travels with the ack, the server uses it for the next snapshot
+    flatbuffers::FlatBufferBuilder builder(64);
+    Flat::Vec3 viewPos = flatbuffers::Pack(this->viewPosition);
+    flatbuffers::Offset<StandardProtocol::MsgSnapshotAck> msgAck = StandardProtocol::CreateMsgSnapshotAck(builder, snapshot.sequence, this->hasViewPosition ? &viewPos : nullptr);
+    flatbuffers::Offset<StandardProtocol::Message> message = StandardProtocol::CreateMessage(builder, StandardProtocol::MessageData_SnapshotAck, msgAck.Union());
+    builder.Finish(message);
+    this->Send(builder.GetBufferPointer(), builder.GetSize());
 }
 
 //--------------------------------------------------------------------------
@@ -139,6 +196,15 @@ StandardMultiplayerClient::OnMessageReceived(SteamNetworkingMessage_t* msg)
             world->SetComponent<NetworkTransform>(entity, netTransform);
             break;
         }
+        case StandardProtocol::MessageData::MessageData_Snapshot:
+        {
+            StandardProtocol::MsgSnapshot const* snapshotMsg = protocolMessage->data_as_Snapshot();
+            if (snapshotMsg->data() != nullptr && this->snapshotReceiver.Receive(snapshotMsg->data()->data(), snapshotMsg->data()->size()))
+            {
+                this->ApplySnapshot();
+            }
+            break;
+        }
         case StandardProtocol::MessageData::MessageData_ReplicateObject:
         {
             n_printf("Got message: ReplicateObject\n");
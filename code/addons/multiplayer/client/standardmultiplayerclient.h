@@ -8,6 +8,7 @@
 */
 //------------------------------------------------------------------------------
 #include "multiplayer/client/basemultiplayerclient.h"
+#include "multiplayer/client/snapshotreceiver.h"
 #include "game/entity.h"
 
 
@@ -27,8 +28,19 @@ public:
     void OnDisconnected() override;
     void OnMessageReceived(SteamNetworkingMessage_t* msg) override;
 
+    /// set the position the client views the world from, the server only replicates entities around it
+    void SetViewPosition(Math::vec3 const& position);
+    /// clear the view position, the server replicates every entity
+    void ClearViewPosition();
+
 private:
+    /// apply the entities which changed in the latest snapshot, and acknowledge it
+    void ApplySnapshot();
+
     Util::HashTable<uint, Game::Entity> networkEntities;
+    SnapshotReceiver snapshotReceiver;
+    bool hasViewPosition = false;
+    Math::vec3 viewPosition;
 };
     
 } // namespace Multiplayer
\ No newline at end of file
@@ -8,10 +8,8 @@
 #include "game/api.h"
 #include "game/world.h"
 #include "multiplayer/server/basemultiplayerserver.h"
+#include "multiplayer/server/snapshotreplicator.h"
 #include "serverprocessors.h"
-#include "nflatbuffer/nebula_flat.h"
-#include "nflatbuffer/flatbufferinterface.h"
-#include "flat/addons/multiplayer/standardprotocol.h"
 
 namespace Multiplayer
 {
@@ -19,9 +17,9 @@ namespace Multiplayer
 struct ServerProcessorContext
 {
     BaseMultiplayerServer* server;
+    SnapshotReplicator* replicator;
     Util::Array<Game::Processor*> processors;
     Game::TimeSource const* timeSource;
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder(4_KB);
 };
 
 static ServerProcessorContext* context;
@@ -29,6 +27,8 @@ static Util::StringAtom frameEvent;
 
 //--------------------------------------------------------------------------
 /**
+    Collects the entity states of this tick, the server sends them to the
+    clients as one snapshot per client afterwards.
 */
 void
 SyncPositions(Game::World* world,
@@ -36,24 +36,12 @@ SyncPositions(Game::World* world,
               NetworkTransform& netTransform,
               Game::Position& pos)
 {
-    context->builder.Clear();
-    flatbuffers::Offset<StandardProtocol::MsgSyncPosition> msgPos;
-    flatbuffers::Offset<StandardProtocol::Message> message;
-    
     netTransform.tickNumber++;
     // Reusing position extrapolators last packet pos, to save some memory.
     Math::vec3 instantVelocity = (pos - netTransform.positionExtrapolator.lastPacketPos) * (1.0f / context->server->GetTickInterval());
     netTransform.positionExtrapolator.lastPacketPos = pos;
 
-    msgPos = StandardProtocol::CreateMsgSyncPosition(context->builder, netId.identifier, (Flat::Vec3*)&pos, (Flat::Vec3*)&instantVelocity, netTransform.tickNumber);
-    message = StandardProtocol::CreateMessage(context->builder, StandardProtocol::MessageData_SyncPosition, msgPos.Union());
-    
-    context->builder.Finish(message);
-    
-    uint8_t* buf = context->builder.GetBufferPointer();
-    int size = context->builder.GetSize();
-
-    context->server->Broadcast(buf, size);
+    context->replicator->SetEntityState(netId.identifier, pos, instantVelocity);
 }
 
 //--------------------------------------------------------------------------
@@ -61,13 +49,14 @@ SyncPositions(Game::World* world,
 */
 #define CREATE_NET_PROCESSOR(FUNC, ORDER) context->processors.Append(Game::ProcessorBuilder(world, #FUNC).On(frameEvent).Order(ORDER).Func(FUNC).Build()); context->processors.Back()->active = false;
 void
-SetupServerProcessors(BaseMultiplayerServer* server)
+SetupServerProcessors(BaseMultiplayerServer* server, SnapshotReplicator* replicator)
 {
     Game::World* world = Game::GetWorld(WORLD_DEFAULT);
     frameEvent = "OnNetworkUpdate"_atm;
 
     context = new ServerProcessorContext();
     context->server = server;
+    context->replicator = replicator;
     context->timeSource = Game::Time::GetTimeSource(TIMESOURCE_GAMEPLAY);
     
 
@@ -11,8 +11,9 @@ namespace Multiplayer
 {
 
 class BaseMultiplayerServer;
+class SnapshotReplicator;
 
-void SetupServerProcessors(BaseMultiplayerServer* server);
+void SetupServerProcessors(BaseMultiplayerServer* server, SnapshotReplicator* replicator);
 void ShutdownServerProcessors();
 void SetServerProcessorsActive(bool active);
 
@@ -0,0 +1,233 @@
+//------------------------------------------------------------------------------
+//  @file snapshotreplicator.cc
+//  @copyright (C) 2025 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "snapshotreplicator.h"
+
+namespace Multiplayer
+{
+
+//--------------------------------------------------------------------------
+/**
+*/
+SnapshotReplicator::SnapshotReplicator() :
+    relevanceRadius(0.0f),
+    sequence(0),
+    tick(0)
+{
+    this->SetRelevanceRadius(128.0f);
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+SnapshotReplicator::~SnapshotReplicator()
+{
+    for (IndexT i = 0; i < this->clients.Size(); i++)
+    {
+        delete this->clients.ValueAtIndex(i);
+    }
+    this->clients.Clear();
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+void
+SnapshotReplicator::SetRelevanceRadius(float radius)
+{
+    n_assert(radius > 0.0f);
+    this->relevanceRadius = radius;
+    // with cells as large as the radius, a query touches at most 3x3 cells
+    this->grid.SetCellSize(radius);
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+void
+SnapshotReplicator::AddClient(uint clientId)
+{
+    n_assert(!this->clients.Contains(clientId));
+    this->clients.Add(clientId, new Client());
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+void
+SnapshotReplicator::RemoveClient(uint clientId)
+{
+    IndexT index = this->clients.FindIndex(clientId);
+    if (index != InvalidIndex)
+    {
+        delete this->clients.ValueAtIndex(index);
+        this->clients.EraseAtIndex(index);
+    }
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+bool
+SnapshotReplicator::HasClient(uint clientId) const
+{
+    return this->clients.Contains(clientId);
+}
+
+//--------------------------------------------------------------------------
+/**
+    Unknown clients are ignored, their acknowledgements can still arrive
+    after they have been removed.
+*/
+void
+SnapshotReplicator::SetClientViewPosition(uint clientId, Math::vec3 const& position)
+{
+    IndexT index = this->clients.FindIndex(clientId);
+    if (index != InvalidIndex)
+    {
+        Client* client = this->clients.ValueAtIndex(index);
+        client->hasViewPosition = true;
+        client->viewPosition = position;
+    }
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+void
+SnapshotReplicator::ClearClientViewPosition(uint clientId)
+{
+    IndexT index = this->clients.FindIndex(clientId);
+    if (index != InvalidIndex)
+        this->clients.ValueAtIndex(index)->hasViewPosition = false;
+}
+
+//--------------------------------------------------------------------------
+/**
+    Acknowledgements can arrive out of order, only newer ones are used.
+*/
+void
+SnapshotReplicator::AcknowledgeSnapshot(uint clientId, uint sequence)
+{
+    IndexT index = this->clients.FindIndex(clientId);
+    if (index != InvalidIndex && sequence <= this->sequence)
+    {
+        Client* client = this->clients.ValueAtIndex(index);
+        client->ackedSequence = Math::max(client->ackedSequence, sequence);
+    }
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+SizeT
+SnapshotReplicator::GetClientNumEntities(IndexT index) const
+{
+    Client const* client = this->clients.ValueAtIndex(index);
+    return client->history[this->sequence % SnapshotHistorySize].entities.Size();
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+void
+SnapshotReplicator::BeginTick(uint64_t tick)
+{
+    this->tick = tick;
+    this->entities.Clear();
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+void
+SnapshotReplicator::SetEntityState(uint networkId, Math::vec3 const& position, Math::vec3 const& velocity)
+{
+    this->entities.Append(QuantizeEntityState(networkId, position, velocity));
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+bool
+SnapshotReplicator::CompareNetworkId(SnapshotEntityState const& lhs, SnapshotEntityState const& rhs)
+{
+    return lhs.networkId < rhs.networkId;
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+Snapshot const*
+SnapshotReplicator::GetBaseline(Client const* client) const
+{
+    uint const acked = client->ackedSequence;
+    if (acked == 0 || this->sequence - acked >= SnapshotHistorySize)
+    {
+        return nullptr;
+    }
+    Snapshot const& baseline = client->history[acked % SnapshotHistorySize];
+    return baseline.sequence == acked ? &baseline : nullptr;
+}
+
+//--------------------------------------------------------------------------
+/**
+    The entities are sorted once, the grid then returns the relevant
+    entities of each client in network id order.
+*/
+void
+SnapshotReplicator::BuildSnapshots()
+{
+    this->sequence++;
+    if (this->entities.Size() > 1)
+    {
+        this->entities.SortWithFunc(CompareNetworkId);
+    }
+
+    bool needsGrid = false;
+    IndexT clientIndex;
+    for (clientIndex = 0; clientIndex < this->clients.Size(); clientIndex++)
+    {
+        needsGrid |= this->clients.ValueAtIndex(clientIndex)->hasViewPosition;
+    }
+    if (needsGrid)
+    {
+        this->positions.Resize(this->entities.Size());
+        for (IndexT i = 0; i < this->entities.Size(); i++)
+        {
+            this->positions[i] = GetSnapshotPosition(this->entities[i]);
+        }
+        this->grid.Build(this->positions);
+    }
+
+    for (clientIndex = 0; clientIndex < this->clients.Size(); clientIndex++)
+    {
+        Client* client = this->clients.ValueAtIndex(clientIndex);
+        Snapshot& snapshot = client->history[this->sequence % SnapshotHistorySize];
+        snapshot.sequence = this->sequence;
+        snapshot.tick = this->tick;
+        snapshot.entities.Clear();
+        if (client->hasViewPosition)
+        {
+            this->relevant.Clear();
+            this->grid.Query(client->viewPosition, this->relevanceRadius, this->relevant);
+            snapshot.entities.Reserve(this->relevant.Size());
+            for (IndexT i = 0; i < this->relevant.Size(); i++)
+            {
+                snapshot.entities.Append(this->entities[this->relevant[i]]);
+            }
+        }
+        else
+        {
+            snapshot.entities.AppendArray(this->entities);
+        }
+
+        // the slot of the new snapshot may have held the baseline, which is too old then anyway
+        BitWriter writer(client->message);
+        EncodeSnapshot(snapshot, this->GetBaseline(client), writer);
+    }
+}
+
+} // namespace Multiplayer
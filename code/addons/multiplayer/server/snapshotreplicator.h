@@ -0,0 +1,141 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Multiplayer::SnapshotReplicator
+
+    Builds one snapshot message per client and tick, containing the state
+    of all entities which are relevant to the client. See
+    multiplayer/snapshot/snapshot.h for the encoding.
+
+    Every tick, the entity states are set between BeginTick and
+    BuildSnapshots. The replicator keeps the last SnapshotHistorySize
+    snapshots of each client, and encodes the new snapshot as a delta
+    against the newest one the client has acknowledged. Until the client
+    acknowledges a snapshot, or if its acknowledged snapshot is too old,
+    the full snapshot is sent.
+
+    Clients with a view position only receive the entities within the
+    relevance radius around it, all other clients receive every entity.
+
+    The replicator doesn't depend on the network layer, clients are
+    identified by an arbitrary id, usually the connection id.
+
+    @copyright
+    (C) 2025 Individual contributors, see AUTHORS file
+*/
+#include "core/types.h"
+#include "util/array.h"
+#include "util/dictionary.h"
+#include "math/vec3.h"
+#include "multiplayer/snapshot/snapshot.h"
+#include "multiplayer/snapshot/interestgrid.h"
+
+//------------------------------------------------------------------------------
+namespace Multiplayer
+{
+
+class SnapshotReplicator
+{
+public:
+    /// constructor
+    SnapshotReplicator();
+    /// destructor
+    ~SnapshotReplicator();
+
+    /// set the radius around a client's view position in which entities are relevant
+    void SetRelevanceRadius(float radius);
+    /// get the relevance radius
+    float GetRelevanceRadius() const;
+
+    /// add a client, which receives a full snapshot first
+    void AddClient(uint clientId);
+    /// remove a client
+    void RemoveClient(uint clientId);
+    /// returns true if the client exists
+    bool HasClient(uint clientId) const;
+    /// set the view position of a client, which enables relevance filtering for it
+    void SetClientViewPosition(uint clientId, Math::vec3 const& position);
+    /// send all entities to the client, regardless of their position
+    void ClearClientViewPosition(uint clientId);
+    /// called when the client has acknowledged a snapshot
+    void AcknowledgeSnapshot(uint clientId, uint sequence);
+
+    /// start collecting the entity states of a tick
+    void BeginTick(uint64_t tick);
+    /// set the state of an entity, each entity may only be set once per tick
+    void SetEntityState(uint networkId, Math::vec3 const& position, Math::vec3 const& velocity);
+    /// build the snapshot messages of all clients
+    void BuildSnapshots();
+
+    /// get the number of clients
+    SizeT GetNumClients() const;
+    /// get the id of a client by index
+    uint GetClientId(IndexT index) const;
+    /// get the message built for a client by BuildSnapshots
+    Util::Array<ubyte> const& GetClientMessage(IndexT index) const;
+    /// get the number of entities in the last snapshot of a client
+    SizeT GetClientNumEntities(IndexT index) const;
+
+private:
+    struct Client
+    {
+        bool hasViewPosition = false;
+        Math::vec3 viewPosition;
+        uint ackedSequence = 0;
+        Snapshot history[SnapshotHistorySize];
+        Util::Array<ubyte> message;
+    };
+
+    /// sort entity states by network id
+    static bool CompareNetworkId(SnapshotEntityState const& lhs, SnapshotEntityState const& rhs);
+    /// get the baseline to encode a client's next snapshot against, or null
+    Snapshot const* GetBaseline(Client const* client) const;
+
+    float relevanceRadius;
+    uint sequence;
+    uint64_t tick;
+    Util::Dictionary<uint, Client*> clients;
+    Util::Array<SnapshotEntityState> entities;
+    Util::Array<Math::vec3> positions;
+    Util::Array<IndexT> relevant;
+    InterestGrid grid;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline float
+SnapshotReplicator::GetRelevanceRadius() const
+{
+    return this->relevanceRadius;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+SnapshotReplicator::GetNumClients() const
+{
+    return this->clients.Size();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline uint
+SnapshotReplicator::GetClientId(IndexT index) const
+{
+    return this->clients.KeyAtIndex(index);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline Util::Array<ubyte> const&
+SnapshotReplicator::GetClientMessage(IndexT index) const
+{
+    return this->clients.ValueAtIndex(index)->message;
+}
+
+} // namespace Multiplayer
+//------------------------------------------------------------------------------
@@ -26,7 +26,7 @@ namespace Multiplayer
 bool
 StandardMultiplayerServer::Open()
 {
-    SetupServerProcessors(this);
+    SetupServerProcessors(this, &this->replicator);
     return BaseMultiplayerServer::Open();
 }
 
@@ -55,6 +55,8 @@ StandardMultiplayerServer::OnClientIsConnecting(ClientConnection* connection)
 void 
 StandardMultiplayerServer::OnClientConnected(ClientConnection* client)
 {
+    this->replicator.AddClient(client->GetConnectionId());
+
     // TEMP: Replicate object on client
     flatbuffers::FlatBufferBuilder builder(1024);
     
@@ -123,7 +125,7 @@ StandardMultiplayerServer::OnClientConnected(ClientConnection* client)
 void 
 StandardMultiplayerServer::OnClientDisconnected(ClientConnection* connection)
 {
-
+    this->replicator.RemoveClient(connection->GetConnectionId());
 }
 
 //--------------------------------------------------------------------------
@@ -132,6 +134,28 @@ StandardMultiplayerServer::OnClientDisconnected(ClientConnection* connection)
 void 
 StandardMultiplayerServer::OnMessageReceived(ClientConnection* connection, Timing::Time recvTime, byte* data, size_t size)
 {
+    flatbuffers::Verifier verifier(data, size);
+    if (!StandardProtocol::VerifyMessageBuffer(verifier))
+    {
+        return;
+    }
+    StandardProtocol::Message const* protocolMessage = StandardProtocol::GetMessage(data);
+    if (protocolMessage->data_type() == StandardProtocol::MessageData_SnapshotAck)
+    {
+        StandardProtocol::MsgSnapshotAck const* ack = protocolMessage->data_as_SnapshotAck();
+        this->replicator.AcknowledgeSnapshot(connection->GetConnectionId(), ack->sequence());
+
+        // clients which don't send a view position receive every entity
+        if (ack->view_pos() != nullptr)
+        {
+            this->replicator.SetClientViewPosition(connection->GetConnectionId(), flatbuffers::UnPack(*ack->view_pos()));
+        }
+        else
+        {
+            this->replicator.ClearClientViewPosition(connection->GetConnectionId());
+        }
+    }
+
     //StandardProtocol::Message const* protocolMessage = StandardProtocol::GetMessage(data);
     //switch (protocolMessage->data_type())
     //{
@@ -158,6 +182,13 @@ StandardMultiplayerServer::OnMessageReceived(ClientConnection* connection, Timin
 void
 StandardMultiplayerServer::OnFrame()
 {
+    // the processors have collected the entity states of the last tick during the frame
+    if (this->snapshotPending)
+    {
+        this->replicator.BuildSnapshots();
+        this->SendSnapshots();
+        this->snapshotPending = false;
+    }
     SetServerProcessorsActive(false);
 }
 
@@ -167,7 +198,44 @@ StandardMultiplayerServer::OnFrame()
 void
 StandardMultiplayerServer::OnTick()
 {
+    this->replicator.BeginTick(++this->tickNumber);
+    this->snapshotPending = true;
     SetServerProcessorsActive(true);
 }
 
+//--------------------------------------------------------------------------
+/**
+    Snapshots are sent unreliably, lost snapshots are never resent, since
+    the next one is encoded against the last acknowledged snapshot anyway.
+*/
+void
+StandardMultiplayerServer::SendSnapshots()
+{
+    const int numClients = this->replicator.GetNumClients();
+    if (numClients == 0)
+        return;
+
+    flatbuffers::FlatBufferBuilder builder(4_KB);
+    ISteamNetworkingMessage** netMsgs = new ISteamNetworkingMessage*[numClients];
+    for (int i = 0; i < numClients; i++)
+    {
+        builder.Clear();
+        Util::Array<ubyte> const& data = this->replicator.GetClientMessage(i);
+        auto vector_bytes = builder.CreateVector(data.Begin(), data.Size());
+        flatbuffers::Offset<StandardProtocol::MsgSnapshot> msgSnapshot = StandardProtocol::CreateMsgSnapshot(builder, vector_bytes);
+        flatbuffers::Offset<StandardProtocol::Message> message = StandardProtocol::CreateMessage(builder, StandardProtocol::MessageData_Snapshot, msgSnapshot.Union());
+        builder.Finish(message);
+
+        int size = builder.GetSize();
+        netMsgs[i] = SteamNetworkingUtils()->AllocateMessage(size);
+        Memory::Copy(builder.GetBufferPointer(), netMsgs[i]->m_pData, size);
+        netMsgs[i]->m_conn = this->replicator.GetClientId(i);
+        netMsgs[i]->m_nFlags = k_nSteamNetworkingSend_Unreliable;
+    }
+
+    int64* outMessageNumberOrResult = nullptr;
+    this->netInterface->SendMessages(numClients, netMsgs, outMessageNumberOrResult);
+    delete[] netMsgs;
+}
+
 } // namespace Multiplayer
\ No newline at end of file
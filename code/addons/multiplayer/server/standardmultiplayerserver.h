@@ -8,6 +8,7 @@
 */
 //------------------------------------------------------------------------------
 #include "multiplayer/server/basemultiplayerserver.h"
+#include "multiplayer/server/snapshotreplicator.h"
 namespace Multiplayer
 {
 
@@ -25,6 +26,26 @@ public:
     void OnMessageReceived(ClientConnection* connection, Timing::Time recvTime, byte* data, size_t size) override;
     void OnTick() override;
     void OnFrame() override;
+
+    /// get the snapshot replicator, to set client view positions and the relevance radius
+    SnapshotReplicator& GetSnapshotReplicator();
+
+private:
+    /// send the snapshots built for this tick to the clients
+    void SendSnapshots();
+
+    SnapshotReplicator replicator;
+    uint64_t tickNumber = 0;
+    bool snapshotPending = false;
 };
+
+//--------------------------------------------------------------------------
+/**
+*/
+inline SnapshotReplicator&
+StandardMultiplayerServer::GetSnapshotReplicator()
+{
+    return this->replicator;
+}
     
 } // namespace Multiplayer
\ No newline at end of file
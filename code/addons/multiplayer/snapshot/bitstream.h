@@ -0,0 +1,247 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Multiplayer::BitWriter
+    @class Multiplayer::BitReader
+
+    Minimal bit packing used by the snapshot encoding. Values are written
+    least significant bit first, the writer appends to a byte array which
+    can be reused between messages to avoid allocations.
+
+    The reader never reads past the end of its buffer, instead it returns
+    zeros and flags the stream as overflowed, so a malformed message can be
+    rejected after decoding instead of crashing the client.
+
+    @copyright
+    (C) 2025 Individual contributors, see AUTHORS file
+*/
+#include "core/types.h"
+#include "util/array.h"
+
+//------------------------------------------------------------------------------
+namespace Multiplayer
+{
+
+class BitWriter
+{
+public:
+    /// constructor, writes into the given buffer, which is cleared
+    BitWriter(Util::Array<ubyte>& buffer);
+
+    /// write the lowest numBits bits of value, numBits must be 32 or less
+    void Write(uint value, uint numBits);
+    /// write a single bit
+    void WriteBool(bool value);
+    /// write a signed value as a zigzag encoded, variable length unsigned value
+    void WriteVarInt(int value);
+    /// write an unsigned value with a 2 bit length class, see ReadVarUInt
+    void WriteVarUInt(uint value);
+    /// flush the remaining bits to the buffer
+    void Flush();
+    /// get the number of bytes written so far, including partial bytes
+    SizeT GetNumBytes() const;
+
+private:
+    Util::Array<ubyte>& buffer;
+    uint64_t scratch;
+    uint scratchBits;
+};
+
+class BitReader
+{
+public:
+    /// constructor
+    BitReader(const ubyte* data, SizeT size);
+
+    /// read numBits bits, numBits must be 32 or less
+    uint Read(uint numBits);
+    /// read a single bit
+    bool ReadBool();
+    /// read a zigzag encoded value
+    int ReadVarInt();
+    /// read a variable length unsigned value
+    uint ReadVarUInt();
+    /// returns true if more bits were read than the buffer holds
+    bool HasOverflowed() const;
+
+private:
+    const ubyte* data;
+    SizeT size;
+    SizeT bytePos;
+    uint64_t scratch;
+    uint scratchBits;
+    bool overflowed;
+};
+
+/// bit widths of the four length classes of WriteVarUInt
+static const uint VarUIntBits[4] = { 4, 10, 18, 32 };
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline
+BitWriter::BitWriter(Util::Array<ubyte>& buffer) :
+    buffer(buffer),
+    scratch(0),
+    scratchBits(0)
+{
+    this->buffer.Clear();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+BitWriter::Write(uint value, uint numBits)
+{
+    n_assert(numBits <= 32);
+    if (numBits < 32)
+    {
+        value &= (1u << numBits) - 1;
+    }
+    this->scratch |= uint64_t(value) << this->scratchBits;
+    this->scratchBits += numBits;
+    while (this->scratchBits >= 8)
+    {
+        this->buffer.Append(ubyte(this->scratch & 0xFF));
+        this->scratch >>= 8;
+        this->scratchBits -= 8;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+BitWriter::WriteBool(bool value)
+{
+    this->Write(value ? 1 : 0, 1);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+BitWriter::WriteVarUInt(uint value)
+{
+    uint lengthClass = 0;
+    while (lengthClass < 3 && value >= (1u << VarUIntBits[lengthClass]))
+    {
+        lengthClass++;
+    }
+    this->Write(lengthClass, 2);
+    this->Write(value, VarUIntBits[lengthClass]);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+BitWriter::WriteVarInt(int value)
+{
+    this->WriteVarUInt((uint(value) << 1) ^ uint(value >> 31));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+BitWriter::Flush()
+{
+    if (this->scratchBits > 0)
+    {
+        this->buffer.Append(ubyte(this->scratch & 0xFF));
+        this->scratch = 0;
+        this->scratchBits = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+BitWriter::GetNumBytes() const
+{
+    return this->buffer.Size() + (this->scratchBits + 7) / 8;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline
+BitReader::BitReader(const ubyte* data, SizeT size) :
+    data(data),
+    size(size),
+    bytePos(0),
+    scratch(0),
+    scratchBits(0),
+    overflowed(false)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline uint
+BitReader::Read(uint numBits)
+{
+    n_assert(numBits <= 32);
+    while (this->scratchBits < numBits)
+    {
+        if (this->bytePos < this->size)
+        {
+            this->scratch |= uint64_t(this->data[this->bytePos++]) << this->scratchBits;
+        }
+        else
+        {
+            this->overflowed = true;
+        }
+        this->scratchBits += 8;
+    }
+    uint value = uint(this->scratch & ((uint64_t(1) << numBits) - 1));
+    this->scratch >>= numBits;
+    this->scratchBits -= numBits;
+    return value;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+BitReader::ReadBool()
+{
+    return this->Read(1) != 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline uint
+BitReader::ReadVarUInt()
+{
+    uint lengthClass = this->Read(2);
+    return this->Read(VarUIntBits[lengthClass]);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline int
+BitReader::ReadVarInt()
+{
+    uint value = this->ReadVarUInt();
+    return int(value >> 1) ^ -int(value & 1);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+BitReader::HasOverflowed() const
+{
+    return this->overflowed;
+}
+
+} // namespace Multiplayer
+//------------------------------------------------------------------------------
@@ -0,0 +1,148 @@
+//------------------------------------------------------------------------------
+//  @file interestgrid.cc
+//  @copyright (C) 2025 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "interestgrid.h"
+
+namespace Multiplayer
+{
+
+//--------------------------------------------------------------------------
+/**
+*/
+InterestGrid::InterestGrid()
+{
+    this->SetCellSize(64.0f);
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+void
+InterestGrid::SetCellSize(float size)
+{
+    n_assert(size > 0.0f);
+    this->cellSize = size;
+    this->invCellSize = 1.0f / size;
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+inline int
+InterestGrid::GetCell(float coord) const
+{
+    return (int)Math::floor(Math::clamp(coord * this->invCellSize, -1.0e9f, 1.0e9f));
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+inline uint
+InterestGrid::GetBucket(int cellX, int cellZ) const
+{
+    return (uint(cellX) * 73856093u ^ uint(cellZ) * 19349663u) % NumBuckets;
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+void
+InterestGrid::Build(Util::Array<Math::vec3> const& positions)
+{
+    SizeT const numItems = positions.Size();
+    this->bucketStart.Clear();
+    this->bucketStart.Fill(0, NumBuckets + 1, 0);
+    this->itemBuckets.Resize(numItems);
+    this->items.Resize(numItems);
+
+    IndexT i;
+    for (i = 0; i < numItems; i++)
+    {
+        uint bucket = this->GetBucket(this->GetCell(positions[i].x), this->GetCell(positions[i].z));
+        this->itemBuckets[i] = bucket;
+        this->bucketStart[bucket + 1]++;
+    }
+    for (i = 0; i < (IndexT)NumBuckets; i++)
+    {
+        this->bucketStart[i + 1] += this->bucketStart[i];
+    }
+
+    // filling a bucket advances its start to its end, which is shifted back afterwards
+    for (i = 0; i < numItems; i++)
+    {
+        Item& item = this->items[this->bucketStart[this->itemBuckets[i]]++];
+        item.index = i;
+        item.x = positions[i].x;
+        item.z = positions[i].z;
+    }
+    for (i = NumBuckets; i > 0; i--)
+    {
+        this->bucketStart[i] = this->bucketStart[i - 1];
+    }
+    this->bucketStart[0] = 0;
+}
+
+//--------------------------------------------------------------------------
+/**
+    Different cells can share a bucket, so the items of a bucket are
+    checked against the radius, and buckets are only visited once.
+*/
+void
+InterestGrid::Query(Math::vec3 const& center, float radius, Util::Array<IndexT>& outItems) const
+{
+    IndexT const first = outItems.Size();
+    float const radiusSq = radius * radius;
+    int const minX = this->GetCell(center.x - radius);
+    int const maxX = this->GetCell(center.x + radius);
+    int const minZ = this->GetCell(center.z - radius);
+    int const maxZ = this->GetCell(center.z + radius);
+
+    auto gatherBucket = [&](uint bucket)
+    {
+        uint end = this->bucketStart[bucket + 1];
+        for (uint i = this->bucketStart[bucket]; i < end; i++)
+        {
+            Item const& item = this->items[i];
+            float dx = item.x - center.x;
+            float dz = item.z - center.z;
+            if (dx * dx + dz * dz <= radiusSq)
+            {
+                outItems.Append(item.index);
+            }
+        }
+    };
+
+    int64_t const numCells = (int64_t(maxX) - minX + 1) * (int64_t(maxZ) - minZ + 1);
+    if (numCells >= NumBuckets)
+    {
+        for (uint bucket = 0; bucket < NumBuckets; bucket++)
+        {
+            gatherBucket(bucket);
+        }
+    }
+    else
+    {
+        uint visited[NumBuckets / 32] = { 0 };
+        for (int z = minZ; z <= maxZ; z++)
+        {
+            for (int x = minX; x <= maxX; x++)
+            {
+                uint bucket = this->GetBucket(x, z);
+                if ((visited[bucket / 32] & (1u << (bucket % 32))) == 0)
+                {
+                    visited[bucket / 32] |= 1u << (bucket % 32);
+                    gatherBucket(bucket);
+                }
+            }
+        }
+    }
+
+    if (outItems.Size() - first > 1)
+    {
+        std::sort(outItems.Begin() + first, outItems.End());
+    }
+}
+
+} // namespace Multiplayer
@@ -0,0 +1,74 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Multiplayer::InterestGrid
+
+    Spatial hash grid on the horizontal (xz) plane, used by the server to
+    find the entities which are relevant to a client.
+
+    The grid is rebuilt from scratch every tick, which is a counting sort of
+    the items into the hash buckets, so there are no per cell allocations
+    and the item indices of a bucket are contiguous. Cells are hashed into
+    a fixed number of buckets, so the world doesn't need to be bounded.
+
+    @copyright
+    (C) 2025 Individual contributors, see AUTHORS file
+*/
+#include "core/types.h"
+#include "util/array.h"
+#include "math/vec3.h"
+
+//------------------------------------------------------------------------------
+namespace Multiplayer
+{
+
+class InterestGrid
+{
+public:
+    /// constructor
+    InterestGrid();
+
+    /// set the edge length of a cell, should be in the order of the query radius
+    void SetCellSize(float size);
+    /// get the edge length of a cell
+    float GetCellSize() const;
+
+    /// rebuild the grid, item indices are the indices into the positions array
+    void Build(Util::Array<Math::vec3> const& positions);
+    /// append the sorted indices of all items within radius of center on the xz plane
+    void Query(Math::vec3 const& center, float radius, Util::Array<IndexT>& outItems) const;
+
+private:
+    /// get the bucket of a cell
+    uint GetBucket(int cellX, int cellZ) const;
+    /// get the cell coordinate of a world coordinate
+    int GetCell(float coord) const;
+
+    static const uint NumBuckets = 4096;
+
+    struct Item
+    {
+        IndexT index;
+        float x, z;
+    };
+
+    float cellSize;
+    float invCellSize;
+    /// start of each bucket in items, plus one past the end
+    Util::Array<uint> bucketStart;
+    /// items sorted by bucket
+    Util::Array<Item> items;
+    Util::Array<uint> itemBuckets;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline float
+InterestGrid::GetCellSize() const
+{
+    return this->cellSize;
+}
+
+} // namespace Multiplayer
+//------------------------------------------------------------------------------
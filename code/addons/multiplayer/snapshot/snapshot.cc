@@ -0,0 +1,316 @@
+//------------------------------------------------------------------------------
+//  @file snapshot.cc
+//  @copyright (C) 2025 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "snapshot.h"
+
+namespace Multiplayer
+{
+
+enum SnapshotChangeFlags
+{
+    SnapshotPositionChanged = 1 << 0,
+    SnapshotVelocityChanged = 1 << 1,
+};
+
+//--------------------------------------------------------------------------
+/**
+*/
+SnapshotEntityState
+QuantizeEntityState(uint networkId, Math::vec3 const& position, Math::vec3 const& velocity)
+{
+    SnapshotEntityState state;
+    state.networkId = networkId;
+    for (int i = 0; i < 3; i++)
+    {
+        state.position[i] = (int)Math::round(Math::clamp(position[i] * SnapshotPositionScale, -2147483520.0f, 2147483520.0f));
+        state.velocity[i] = (int)Math::round(Math::clamp(velocity[i] * SnapshotVelocityScale, -32767.0f, 32767.0f));
+    }
+    return state;
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+Math::vec3
+GetSnapshotPosition(SnapshotEntityState const& state)
+{
+    return Math::vec3(state.position[0], state.position[1], state.position[2]) * (1.0f / SnapshotPositionScale);
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+Math::vec3
+GetSnapshotVelocity(SnapshotEntityState const& state)
+{
+    return Math::vec3(state.velocity[0], state.velocity[1], state.velocity[2]) * (1.0f / SnapshotVelocityScale);
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+bool
+SnapshotStatesEqual(SnapshotEntityState const& lhs, SnapshotEntityState const& rhs)
+{
+    return lhs.networkId == rhs.networkId
+        && lhs.position[0] == rhs.position[0] && lhs.position[1] == rhs.position[1] && lhs.position[2] == rhs.position[2]
+        && lhs.velocity[0] == rhs.velocity[0] && lhs.velocity[1] == rhs.velocity[1] && lhs.velocity[2] == rhs.velocity[2];
+}
+
+//--------------------------------------------------------------------------
+/**
+    Deltas are computed with wrapping arithmetic, so even the extreme
+    quantized positions round trip.
+*/
+static void
+WriteVectorDelta(BitWriter& writer, int const* value, int const* base)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        writer.WriteVarInt(int(uint(value[i]) - uint(base[i])));
+    }
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+static void
+ReadVectorDelta(BitReader& reader, int* value, int const* base)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        value[i] = int(uint(base[i]) + uint(reader.ReadVarInt()));
+    }
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+static bool
+VectorsEqual(int const* lhs, int const* rhs)
+{
+    return lhs[0] == rhs[0] && lhs[1] == rhs[1] && lhs[2] == rhs[2];
+}
+
+//--------------------------------------------------------------------------
+/**
+    Both entity lists are sorted by network id, so the removed and changed
+    entities are found in a single merge pass. The first pass only counts
+    them, since the counts are written before the lists.
+*/
+void
+EncodeSnapshot(Snapshot const& snapshot, Snapshot const* baseline, BitWriter& writer)
+{
+    static const int zero[3] = { 0, 0, 0 };
+    static const Util::Array<SnapshotEntityState> noEntities;
+    Util::Array<SnapshotEntityState> const& current = snapshot.entities;
+    Util::Array<SnapshotEntityState> const& base = baseline != nullptr ? baseline->entities : noEntities;
+    n_assert(current.Size() <= (SizeT)SnapshotMaxEntities);
+
+    writer.Write(snapshot.sequence, 32);
+    writer.Write(baseline != nullptr ? baseline->sequence : 0, 32);
+    writer.Write(uint(snapshot.tick), 32);
+    writer.Write(uint(snapshot.tick >> 32), 32);
+
+    // count removed and changed entities
+    uint numRemoved = 0;
+    uint numChanged = 0;
+    IndexT c = 0, b = 0;
+    while (c < current.Size() || b < base.Size())
+    {
+        if (b == base.Size() || (c < current.Size() && current[c].networkId < base[b].networkId))
+        {
+            numChanged++;
+            c++;
+        }
+        else if (c == current.Size() || base[b].networkId < current[c].networkId)
+        {
+            numRemoved++;
+            b++;
+        }
+        else
+        {
+            numChanged += SnapshotStatesEqual(current[c], base[b]) ? 0 : 1;
+            c++;
+            b++;
+        }
+    }
+
+    // removed entities
+    writer.WriteVarUInt(numRemoved);
+    uint nextId = 0;
+    c = 0;
+    for (b = 0; b < base.Size(); b++)
+    {
+        while (c < current.Size() && current[c].networkId < base[b].networkId)
+        {
+            c++;
+        }
+        if (c == current.Size() || current[c].networkId != base[b].networkId)
+        {
+            writer.WriteVarUInt(base[b].networkId - nextId);
+            nextId = base[b].networkId + 1;
+        }
+    }
+
+    // new and changed entities
+    writer.WriteVarUInt(numChanged);
+    nextId = 0;
+    b = 0;
+    for (c = 0; c < current.Size(); c++)
+    {
+        SnapshotEntityState const& state = current[c];
+        while (b < base.Size() && base[b].networkId < state.networkId)
+        {
+            b++;
+        }
+        bool const inBaseline = b < base.Size() && base[b].networkId == state.networkId;
+        if (inBaseline && SnapshotStatesEqual(state, base[b]))
+        {
+            continue;
+        }
+
+        writer.WriteVarUInt(state.networkId - nextId);
+        nextId = state.networkId + 1;
+        if (inBaseline)
+        {
+            // the receiver knows the entity, only send what changed
+            uint flags = 0;
+            flags |= VectorsEqual(state.position, base[b].position) ? 0 : SnapshotPositionChanged;
+            flags |= VectorsEqual(state.velocity, base[b].velocity) ? 0 : SnapshotVelocityChanged;
+            writer.Write(flags, 2);
+            if (flags & SnapshotPositionChanged)
+            {
+                WriteVectorDelta(writer, state.position, base[b].position);
+            }
+            if (flags & SnapshotVelocityChanged)
+            {
+                WriteVectorDelta(writer, state.velocity, base[b].velocity);
+            }
+        }
+        else
+        {
+            WriteVectorDelta(writer, state.position, zero);
+            WriteVectorDelta(writer, state.velocity, zero);
+        }
+    }
+    writer.Flush();
+}
+
+//--------------------------------------------------------------------------
+/**
+*/
+bool
+DecodeSnapshotHeader(BitReader& reader, uint& outSequence, uint& outBaselineSequence, uint64_t& outTick)
+{
+    outSequence = reader.Read(32);
+    outBaselineSequence = reader.Read(32);
+    outTick = reader.Read(32);
+    outTick |= uint64_t(reader.Read(32)) << 32;
+    return !reader.HasOverflowed() && outSequence != 0;
+}
+
+//--------------------------------------------------------------------------
+/**
+    Merges the baseline with the removed and changed entities. Returns
+    false if the message is malformed, in which case outSnapshot is
+    undefined.
+*/
+bool
+DecodeSnapshot(BitReader& reader, Snapshot const* baseline, Snapshot& outSnapshot)
+{
+    static const int zero[3] = { 0, 0, 0 };
+    static const Util::Array<SnapshotEntityState> noEntities;
+    Util::Array<SnapshotEntityState> const& base = baseline != nullptr ? baseline->entities : noEntities;
+    Util::Array<SnapshotEntityState>& result = outSnapshot.entities;
+    result.Clear();
+
+    // removed entities, they are skipped when merging the baseline
+    uint numRemoved = reader.ReadVarUInt();
+    if (numRemoved > (uint)base.Size())
+    {
+        return false;
+    }
+    Util::Array<uint> removed;
+    removed.Reserve(numRemoved);
+    uint nextId = 0;
+    uint i;
+    for (i = 0; i < numRemoved; i++)
+    {
+        uint id = nextId + reader.ReadVarUInt();
+        if (id < nextId)
+        {
+            return false;
+        }
+        removed.Append(id);
+        nextId = id + 1;
+    }
+
+    uint numChanged = reader.ReadVarUInt();
+    if (numChanged > SnapshotMaxEntities || reader.HasOverflowed())
+    {
+        return false;
+    }
+    result.Reserve(base.Size() + numChanged);
+
+    IndexT b = 0;
+    IndexT r = 0;
+    auto copyBaselineUpTo = [&](uint64_t networkId)
+    {
+        while (b < base.Size() && base[b].networkId < networkId)
+        {
+            if (r < removed.Size() && removed[r] == base[b].networkId)
+            {
+                r++;
+            }
+            else
+            {
+                result.Append(base[b]);
+            }
+            b++;
+        }
+    };
+
+    nextId = 0;
+    for (i = 0; i < numChanged; i++)
+    {
+        SnapshotEntityState state;
+        state.networkId = nextId + reader.ReadVarUInt();
+        if (state.networkId < nextId)
+        {
+            return false;
+        }
+        nextId = state.networkId + 1;
+
+        copyBaselineUpTo(state.networkId);
+        if (b < base.Size() && base[b].networkId == state.networkId)
+        {
+            uint flags = reader.Read(2);
+            Memory::Copy(base[b].position, state.position, sizeof(state.position));
+            Memory::Copy(base[b].velocity, state.velocity, sizeof(state.velocity));
+            if (flags & SnapshotPositionChanged)
+            {
+                ReadVectorDelta(reader, state.position, base[b].position);
+            }
+            if (flags & SnapshotVelocityChanged)
+            {
+                ReadVectorDelta(reader, state.velocity, base[b].velocity);
+            }
+            b++;
+        }
+        else
+        {
+            ReadVectorDelta(reader, state.position, zero);
+            ReadVectorDelta(reader, state.velocity, zero);
+        }
+        result.Append(state);
+    }
+    copyBaselineUpTo(uint64_t(1) << 32);
+
+    // every removed entity must have been in the baseline
+    return !reader.HasOverflowed() && r == removed.Size();
+}
+
+} // namespace Multiplayer
@@ -0,0 +1,79 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @file multiplayer/snapshot/snapshot.h
+
+    World state snapshots which the server sends to each client every tick.
+
+    Positions and velocities are quantized to fixed point, so a state which
+    didn't change compares bit exact, and so small changes encode to a few
+    bits. A snapshot is encoded as a delta against an older snapshot the
+    client has acknowledged, the baseline:
+
+    - header: sequence, baseline sequence (0 if there is none), server tick
+    - the network ids of the entities which are in the baseline but no
+      longer in the snapshot
+    - the network ids and states of the entities which are new or differ
+      from the baseline, states of entities in the baseline are written as
+      deltas, only for the vectors which changed
+
+    Entities which didn't change since the baseline cost nothing. Network
+    ids are written as the gap to the previous id, entities are therefore
+    always sorted by network id.
+
+    @copyright
+    (C) 2025 Individual contributors, see AUTHORS file
+*/
+#include "core/types.h"
+#include "util/array.h"
+#include "math/vec3.h"
+#include "multiplayer/snapshot/bitstream.h"
+
+//------------------------------------------------------------------------------
+namespace Multiplayer
+{
+
+/// quantization steps per meter of positions
+static const float SnapshotPositionScale = 512.0f;
+/// quantization steps per meter per second of velocities, limited to +-32767 steps
+static const float SnapshotVelocityScale = 64.0f;
+/// number of snapshots kept by server and client, older baselines can't be used
+static const uint SnapshotHistorySize = 32;
+/// upper limit for the number of entities in a single snapshot
+static const uint SnapshotMaxEntities = 0xFFFF;
+
+struct SnapshotEntityState
+{
+    uint networkId;
+    int position[3];
+    int velocity[3];
+};
+
+struct Snapshot
+{
+    /// sequence number, starts at 1
+    uint sequence = 0;
+    /// server tick the snapshot was taken at
+    uint64_t tick = 0;
+    /// entity states, sorted by network id
+    Util::Array<SnapshotEntityState> entities;
+};
+
+/// quantize the state of an entity
+SnapshotEntityState QuantizeEntityState(uint networkId, Math::vec3 const& position, Math::vec3 const& velocity);
+/// get the position of a quantized state
+Math::vec3 GetSnapshotPosition(SnapshotEntityState const& state);
+/// get the velocity of a quantized state
+Math::vec3 GetSnapshotVelocity(SnapshotEntityState const& state);
+/// returns true if both states are identical
+bool SnapshotStatesEqual(SnapshotEntityState const& lhs, SnapshotEntityState const& rhs);
+
+/// encode a snapshot as a delta against the baseline, or in full if the baseline is null
+void EncodeSnapshot(Snapshot const& snapshot, Snapshot const* baseline, BitWriter& writer);
+/// read the header of an encoded snapshot
+bool DecodeSnapshotHeader(BitReader& reader, uint& outSequence, uint& outBaselineSequence, uint64_t& outTick);
+/// decode the rest of a snapshot after the header, the baseline must match the baseline sequence
+bool DecodeSnapshot(BitReader& reader, Snapshot const* baseline, Snapshot& outSnapshot);
+
+} // namespace Multiplayer
+//------------------------------------------------------------------------------
@@ -122,6 +122,10 @@ GameApplication::Open()
 
 #if NEBULA_ENABLE_PROFILING
         Profiling::ProfilingRegisterThread(15);
+
+        // stream all profiling events to a trace file
+        if (this->GetCmdLineArgs().HasArg("-profilecapture"))
+            Profiling::ProfilingStartCapture(this->GetCmdLineArgs().GetString("-profilecapture"));
 #endif
 
         // attach a log file console handler
@@ -210,6 +214,10 @@ GameApplication::Close()
     this->httpInterface = nullptr;
 #endif
 
+#if NEBULA_ENABLE_PROFILING
+    Profiling::ProfilingShutdown();
+#endif
+
     this->ioInterface->Close();
     this->ioInterface = nullptr;
     this->ioServer = nullptr;
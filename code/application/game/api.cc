@@ -12,11 +12,13 @@
 #include "basegamefeature/managers/blueprintmanager.h"
 #include "profiling/profiling.h"
 #include "util/fixedarray.h"
+#include "threading/criticalsection.h"
 
 namespace Game
 {
 
 static Memory::ArenaAllocator<sizeof(Dataset::View) * 256> viewAllocator;
+static Threading::CriticalSection viewAllocatorLock;
 
 
 
@@ -29,11 +31,42 @@ ReleaseDatasets()
     viewAllocator.Release();
 }
 
+//------------------------------------------------------------------------------
+/**
+    Datasets might be queried from several jobs at once.
+*/
+Dataset::View*
+AllocDatasetViews(SizeT numViews)
+{
+    Threading::CriticalScope scope(&viewAllocatorLock);
+    return (Dataset::View*)viewAllocator.Alloc(sizeof(Dataset::View) * numViews);
+}
+
 //------------------------------------------------------------------------------
 /**
 */
 Game::Dataset
 Query(Ptr<MemDb::Database> const& db, Util::Array<MemDb::TableId>& tids, Filter filter)
+{
+    for (IndexT tableIndex = 0; tableIndex < tids.Size(); tableIndex++)
+    {
+        if (!db->IsValid(tids[tableIndex]))
+        {
+            tids.EraseIndexSwap(tableIndex);
+            // re-run the same index
+            tableIndex--;
+        }
+    }
+
+    Util::Array<MemDb::TableId> const& validTids = tids;
+    return Query(db, validTids, filter);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Game::Dataset
+Query(Ptr<MemDb::Database> const& db, Util::Array<MemDb::TableId> const& tids, Filter filter)
 {
     Game::Dataset data;
     data.numViews = 0;
@@ -41,6 +74,9 @@ Query(Ptr<MemDb::Database> const& db, Util::Array<MemDb::TableId>& tids, Filter
     // count num views.
     for (IndexT i = 0; i < tids.Size(); i++)
     {
+        if (!db->IsValid(tids[i]))
+            continue;
+
         MemDb::Table& tbl = db->GetTable(tids[i]);
         SizeT const numRows = tbl.GetNumRows();
         if (numRows > 0)
@@ -55,48 +91,42 @@ Query(Ptr<MemDb::Database> const& db, Util::Array<MemDb::TableId>& tids, Filter
         return data;
     }
 
-    data.views = (Dataset::View*)viewAllocator.Alloc(sizeof(Dataset::View) * data.numViews);
+    data.views = AllocDatasetViews(data.numViews);
     data.numViews = 0;
 
     Util::FixedArray<ComponentId> const& components = ComponentsInFilter(filter);
 
     for (IndexT tableIndex = 0; tableIndex < tids.Size(); tableIndex++)
     {
-        if (db->IsValid(tids[tableIndex]))
+        if (!db->IsValid(tids[tableIndex]))
+            continue;
+
+        MemDb::Table& tbl = db->GetTable(tids[tableIndex]);
+        SizeT const numRows = tbl.GetNumRows();
+        if (numRows > 0)
         {
-            MemDb::Table& tbl = db->GetTable(tids[tableIndex]);
-            SizeT const numRows = tbl.GetNumRows();
-            if (numRows > 0)
+            MemDb::Table::Partition* part = tbl.GetFirstActivePartition();
+            while (part != nullptr)
             {
-                MemDb::Table::Partition* part = tbl.GetFirstActivePartition();
-                while (part != nullptr)
+                Dataset::View* view = data.views + data.numViews;
+                view->tableId = tids[tableIndex];
+                view->validInstances = part->validRows;
+                view->modifiedInstances = part->modifiedRows;
+
+                IndexT i = 0;
+                for (auto component : components)
                 {
-                    Dataset::View* view = data.views + data.numViews;
-                    view->tableId = tids[tableIndex];
-                    view->validInstances = part->validRows;
-                    view->modifiedInstances = part->modifiedRows;
-
-                    IndexT i = 0;
-                    for (auto component : components)
-                    {
-                        MemDb::ColumnIndex colId = tbl.GetAttributeIndex(component);
-                        view->buffers[i] = tbl.GetBuffer(part->partitionId, colId);
-                        i++;
-                    }
-
-                    view->numInstances = part->numRows;
-                    view->partitionId = part->partitionId;
-                    data.numViews++;
-                    part = part->next;
+                    MemDb::ColumnIndex colId = tbl.GetAttributeIndex(component);
+                    view->buffers[i] = tbl.GetBuffer(part->partitionId, colId);
+                    i++;
                 }
+
+                view->numInstances = part->numRows;
+                view->partitionId = part->partitionId;
+                data.numViews++;
+                part = part->next;
             }
         }
-        else
-        {
-            tids.EraseIndexSwap(tableIndex);
-            // re-run the same index
-            tableIndex--;
-        }
     }
 
     return data;
@@ -33,8 +33,13 @@ void DestroyFilter(Filter);
 /// Query a subset of tables in a specific db using a specified filter set. Modifies the tables array so that it only contains valid tables.
 /// This does NOT wait for resources to be available.
 Dataset Query(Ptr<MemDb::Database> const& db, Util::Array<MemDb::TableId>& tables, Filter filter);
+/// Query a subset of tables in a specific db using a specified filter set. Invalid tables are skipped, use with persistent queries from MemDb::Database::CachedQuery.
+/// This does NOT wait for resources to be available.
+Dataset Query(Ptr<MemDb::Database> const& db, Util::Array<MemDb::TableId> const& tables, Filter filter);
 /// Recycles all current datasets allocated memory to be reused
 void ReleaseDatasets();
+/// Allocate the views of a dataset, they stay valid until the datasets are released
+Dataset::View* AllocDatasetViews(SizeT numViews);
 
 /// Returns a blueprint id by name
 BlueprintId GetBlueprintId(Util::StringAtom name);
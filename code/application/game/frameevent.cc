@@ -25,10 +25,21 @@ FrameBatchJob(SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocat
         if (index >= totalJobs)
             return;
 
-        ProcessorJobInput const& input = context->inputs[index];
-        if (input.processor->active)
+        ProcessorJob const& job = context->jobs[index];
+        if (job.processor->active)
         {
-            input.processor->callback(context->world, *input.view);
+#ifdef NEBULA_ENABLE_PROFILING
+            Timing::Timer timer;
+            timer.Start();
+#endif
+            for (uint32_t v = 0; v < job.numViews; v++)
+            {
+                job.processor->callback(context->world, job.views[v]);
+            }
+#ifdef NEBULA_ENABLE_PROFILING
+            timer.Stop();
+            Threading::Interlocked::Add(&job.processor->jobTime, (int64_t)(timer.GetTime() * 1000000000.0));
+#endif
         }
     }
 }
@@ -50,17 +61,92 @@ FrameEvent::~FrameEvent()
 void
 FrameEvent::Run(World* world)
 {
-    for (SizeT i = 0; i < this->batches.Size(); i++)
+    if (this->dependenciesDirty)
+        this->BuildDependencies();
+
+    IndexT i = 0;
+    while (i < this->batches.Size())
     {
-        if (this->batches[i]->async)
+        if (!this->batches[i]->async)
         {
-            this->pipeline->inAsync = true;
+            this->batches[i]->Execute(world);
+            i++;
+            continue;
         }
 
-        this->batches[i]->Execute(world);
+        // Run all consecutive async batches together, the dependencies keep conflicting batches in order
+        IndexT end = i + 1;
+        while (end < this->batches.Size() && this->batches[end]->async)
+            end++;
 
+        this->pipeline->inAsync = true;
+        this->ExecuteAsyncBatches(world, i, end);
         this->pipeline->inAsync = false;
+        i = end;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Async batches only depend on earlier async batches which they conflict with.
+    Sequential batches act as barriers, so dependencies never cross them.
+*/
+void
+FrameEvent::BuildDependencies()
+{
+    IndexT runStart = 0;
+    for (IndexT i = 0; i < this->batches.Size(); i++)
+    {
+        Batch* batch = this->batches[i];
+        batch->dependencies.Clear();
+        if (!batch->async)
+        {
+            runStart = i + 1;
+            continue;
+        }
+
+        for (IndexT j = runStart; j < i; j++)
+        {
+            if (batch->ConflictsWith(this->batches[j]))
+                batch->dependencies.Append(j);
+        }
     }
+    this->dependenciesDirty = false;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+FrameEvent::ExecuteAsyncBatches(World* world, IndexT start, IndexT end)
+{
+    const SizeT numBatches = end - start;
+
+    // Query everything up front, so no query runs while jobs are writing to the tables
+    Util::FixedArray<SizeT> numJobs(numBatches);
+    for (IndexT i = 0; i < numBatches; i++)
+        numJobs[i] = this->batches[start + i]->PrepareAsync(world);
+
+    // Dispatch all batches, each waiting for the counters of the batches it conflicts with
+    Util::FixedArray<Threading::AtomicCounter> counters(numBatches);
+    for (IndexT i = 0; i < numBatches; i++)
+    {
+        Batch* batch = this->batches[start + i];
+        Util::FixedArray<const Threading::AtomicCounter*, true> waitCounters(batch->dependencies.Size());
+        for (IndexT j = 0; j < batch->dependencies.Size(); j++)
+            waitCounters[j] = &counters[batch->dependencies[j] - start];
+
+        counters[i] = numJobs[i] > 0 ? 1 : 0;
+        if (numJobs[i] > 0)
+            batch->DispatchAsync(world, waitCounters, &counters[i]);
+    }
+
+    // Wait for all of them at once
+    for (IndexT i = 0; i < numBatches; i++)
+        Jobs2::JobWait(&counters[i]);
+
+    for (IndexT i = 0; i < numBatches; i++)
+        this->batches[start + i]->FinishAsync();
 }
 
 //------------------------------------------------------------------------------
@@ -96,6 +182,7 @@ FrameEvent::AddProcessor(Processor* processor)
         n_assert(res);
         this->batches.Insert(i, batch);
     }
+    this->dependenciesDirty = true;
 }
 
 //--------------------------------------------------------------------------
@@ -173,6 +260,37 @@ FrameEvent::Batch::Execute(World* world)
     }
 }
 
+//------------------------------------------------------------------------------
+/**
+    Returns true if the processors can't run simultaneously, that is if one of
+    them writes to a component that the other one reads or writes.
+*/
+static bool
+ProcessorsConflict(Processor const* processor, Processor const* other)
+{
+    Util::FixedArray<ComponentId> const& components = Game::ComponentsInFilter(processor->filter);
+    Util::FixedArray<AccessMode> const& access = Game::AccessModesInFilter(processor->filter);
+    auto const& otherComponents = Game::ComponentsInFilter(other->filter);
+    auto const& otherAccess = Game::AccessModesInFilter(other->filter);
+    for (IndexT i = 0; i < components.Size(); i++)
+    {
+        for (IndexT k = 0; k < otherComponents.Size(); k++)
+        {
+            if (otherComponents[k] == components[i])
+            {
+                if (otherAccess[k] == AccessMode::WRITE || access[i] == AccessMode::WRITE)
+                {
+                    // Some processor is already writing to this component, or we're trying to write, and some other is already reading.
+                    // Either way, we cannot run the processors simultaneously since it will cause races.
+                    return true;
+                }
+                break; // we can break because a component should never exist twice in the filter
+            }
+        }
+    }
+    return false;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -183,28 +301,10 @@ FrameEvent::Batch::TryInsert(Processor* processor)
     // have multiple writers to the same components
     if (processor->async)
     {
-        Util::FixedArray<ComponentId> const& components = Game::ComponentsInFilter(processor->filter);
-        Util::FixedArray<AccessMode> const& access = Game::AccessModesInFilter(processor->filter);
-        for (IndexT i = 0; i < components.Size(); i++)
+        for (auto other : this->processors)
         {
-            for (auto other : this->processors)
-            {
-                auto const& otherComponents = Game::ComponentsInFilter(other->filter);
-                auto const& otherAccess = Game::AccessModesInFilter(other->filter);
-                for (IndexT k = 0; k < otherComponents.Size(); k++)
-                {
-                    if (otherComponents[k] == components[i])
-                    {
-                        if (otherAccess[k] == AccessMode::WRITE || access[i] == AccessMode::WRITE)
-                        {
-                            // Some processor is already writing to this component, or we're trying to write, and some other is already reading.
-                            // Either way, we cannot add the processor since it will cause races.
-                            return false;
-                        }
-                        break; // we can break because a component should never exist twice in the filter
-                    }
-                }
-            }
+            if (ProcessorsConflict(processor, other))
+                return false;
         }
     }
 
@@ -212,6 +312,23 @@ FrameEvent::Batch::TryInsert(Processor* processor)
     return true;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+FrameEvent::Batch::ConflictsWith(Batch const* other) const
+{
+    for (auto processor : this->processors)
+    {
+        for (auto otherProcessor : other->processors)
+        {
+            if (ProcessorsConflict(processor, otherProcessor))
+                return true;
+        }
+    }
+    return false;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -276,9 +393,34 @@ FrameEvent::Batch::GetProcessors() const
 void
 FrameEvent::Batch::ExecuteAsync(World* world)
 {
+    if (this->PrepareAsync(world) > 0)
+    {
+        // If we're running inside a job, this yields the fiber instead of blocking a job thread
+        Threading::AtomicCounter doneCounter = 1;
+        this->DispatchAsync(world, nullptr, &doneCounter);
+        Jobs2::JobWait(&doneCounter);
+    }
+    this->FinishAsync();
+}
+
+//------------------------------------------------------------------------------
+/**
+    Splits the work of every processor into jobs of roughly the same number of
+    rows. Large partitions are split into several jobs, and small partitions
+    are merged into one job. Jobs always start at a 64 row section boundary.
+*/
+SizeT
+FrameEvent::Batch::PrepareAsync(World* world)
+{
+    // Aim for a few jobs per thread, so threads finishing early can steal the rest
+    const SizeT JobsPerThread = 4;
+    const SizeT numThreads = Math::max(Jobs2::JobGetNumThreads(), 1);
+
     Util::FixedArray<Dataset> datasets(this->processors.Size());
+    Util::FixedArray<uint32_t> rowsPerJob(this->processors.Size(), 0);
 
-    uint32_t numJobs = 0;
+    SizeT numJobs = 0;
+    SizeT numViews = 0;
 
     for (IndexT i = 0; i < this->processors.Size(); i++)
     {
@@ -287,12 +429,6 @@ FrameEvent::Batch::ExecuteAsync(World* world)
         if (!processor->active)
             continue;
 
-#ifdef NEBULA_ENABLE_PROFILING
-        // TODO: Async batch processors will have the same timings for now. We should figure out some good way of measuring their elapsed time.
-        processor->timer.Reset();
-        processor->timer.Start();
-#endif
-
 #ifdef WITH_NEBULA_EDITOR
         if (Game::EditorState::HasInstance())
         {
@@ -302,54 +438,114 @@ FrameEvent::Batch::ExecuteAsync(World* world)
         }
 #endif
         datasets[i] = world->Query(processor->filter, processor->cache);
-        numJobs += datasets[i].numViews;
-    }
 
-    if (numJobs == 0)
-    {
-#ifdef NEBULA_ENABLE_PROFILING
-        for (IndexT i = 0; i < this->processors.Size(); i++)
-        {
-            Processor* processor = this->processors[i];
-            if (!processor->active)
-                continue;
+        SizeT numRows = 0;
+        for (uint32_t v = 0; v < datasets[i].numViews; v++)
+            numRows += datasets[i].views[v].numInstances;
+        if (numRows == 0)
+            continue;
 
-            processor->timer.Stop();
-        }
-#endif
-        return;
+        // Jobs are made from whole sections of 64 rows
+        uint32_t rows = processor->rowsPerJob;
+        if (rows == 0)
+            rows = (uint32_t)((numRows + numThreads * JobsPerThread - 1) / (numThreads * JobsPerThread));
+        rows = Math::max<uint32_t>(Memory::align(rows, 64u), 64u);
+        rowsPerJob[i] = rows;
+
+        // Every view splits into at least one range, and a job never has more ranges than that
+        for (uint32_t v = 0; v < datasets[i].numViews; v++)
+            numViews += Math::max<SizeT>((datasets[i].views[v].numInstances + rows - 1) / rows, 1);
     }
 
-    ProcessorJobContext context;
-    context.world = world;
-    context.inputs = new ProcessorJobInput[numJobs];
+    this->numJobs = 0;
+    if (numViews == 0)
+        return 0;
+
+    this->jobViews = new Dataset::View[numViews];
+    this->jobs = new ProcessorJob[numViews];
 
-    IndexT inputIndex = 0;
+    numViews = 0;
     for (IndexT i = 0; i < datasets.Size(); i++)
     {
-        for (IndexT v = 0; v < datasets[i].numViews; v++, inputIndex++)
+        uint32_t const rows = rowsPerJob[i];
+        if (rows == 0)
+            continue;
+
+        ProcessorJob* job = nullptr;
+        uint32_t jobRows = 0;
+        for (uint32_t v = 0; v < datasets[i].numViews; v++)
         {
-            context.inputs[inputIndex].processor = this->processors[i];
-            context.inputs[inputIndex].view = datasets[i].views + v;
+            Dataset::View const& view = datasets[i].views[v];
+            for (uint32_t begin = 0; begin < view.numInstances; begin += rows)
+            {
+                uint32_t const end = Math::min<uint32_t>(begin + rows, view.numInstances);
+
+                // Hide all rows before the range, callbacks stop at numInstances
+                Dataset::View& range = this->jobViews[numViews++];
+                range = view;
+                range.numInstances = (uint16_t)end;
+                for (uint32_t section = 0; section < begin / 64; section++)
+                {
+                    range.validInstances.SetBits(section, 0);
+                    range.modifiedInstances.SetBits(section, 0);
+                }
+
+                if (job == nullptr || jobRows >= rows)
+                {
+                    job = &this->jobs[numJobs++];
+                    job->processor = this->processors[i];
+                    job->views = &range;
+                    job->numViews = 0;
+                    jobRows = 0;
+                }
+                job->numViews++;
+                jobRows += end - begin;
+            }
         }
     }
+    this->numJobs = numJobs;
+    return numJobs;
+}
 
-    Threading::Event event;
-    Jobs2::JobDispatch(FrameBatchJob, numJobs, 1, context, nullptr, nullptr, &event);
-    event.Wait();
+//------------------------------------------------------------------------------
+/**
+*/
+void
+FrameEvent::Batch::DispatchAsync(World* world, const Util::FixedArray<const Threading::AtomicCounter*, true>& waitCounters, Threading::AtomicCounter* doneCounter)
+{
+    n_assert(this->numJobs > 0);
+    ProcessorJobContext context;
+    context.world = world;
+    context.jobs = this->jobs;
+    Jobs2::JobDispatch(FrameBatchJob, this->numJobs, 1, context, waitCounters, doneCounter);
+}
 
+//------------------------------------------------------------------------------
+/**
+*/
+void
+FrameEvent::Batch::FinishAsync()
+{
 #ifdef NEBULA_ENABLE_PROFILING
+    // The time of an async processor is the sum of its jobs, regardless of which threads ran them
     for (IndexT i = 0; i < this->processors.Size(); i++)
     {
         Processor* processor = this->processors[i];
-        if (!processor->active)
-            continue;
-
-        processor->timer.Stop();
+        processor->time = Threading::Interlocked::Exchange(&processor->jobTime, 0) / 1000000000.0;
     }
 #endif
 
-    delete[] context.inputs;
+    if (this->jobs != nullptr)
+    {
+        delete[] this->jobs;
+        this->jobs = nullptr;
+    }
+    if (this->jobViews != nullptr)
+    {
+        delete[] this->jobViews;
+        this->jobViews = nullptr;
+    }
+    this->numJobs = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -387,6 +583,7 @@ FrameEvent::Batch::ExecuteSequential(World* world)
 
 #ifdef NEBULA_ENABLE_PROFILING
         processor->timer.Stop();
+        processor->time = processor->timer.GetTime();
 #endif
     }
 }
@@ -9,22 +9,27 @@
 //------------------------------------------------------------------------------
 #include "game/processor.h"
 #include "threading/assertingmutex.h"
+#include "threading/interlocked.h"
+#include "util/fixedarray.h"
 
 namespace Game
 {
 
 class FramePipeline;
 
-struct ProcessorJobInput
+/// A range of rows for a single processor, spread over one or more views
+struct ProcessorJob
 {
-    Game::Dataset::View* view;
     Processor* processor;
+    /// views only have the rows of this job marked as valid
+    Game::Dataset::View* views;
+    uint32_t numViews;
 };
 
 struct ProcessorJobContext
 {
     Game::World* world;
-    ProcessorJobInput* inputs;
+    ProcessorJob* jobs;
 };
 
 //------------------------------------------------------------------------------
@@ -57,11 +62,18 @@ public:
 private:
     friend FramePipeline;
 
+    /// Find which earlier async batches each async batch has to wait for
+    void BuildDependencies();
+    /// Run a range of consecutive async batches as jobs, only waiting for them once all are dispatched
+    void ExecuteAsyncBatches(World* world, IndexT start, IndexT end);
+
     /// Which pipeline is this event attached to
     FramePipeline* pipeline;
 
     /// Batches that this event will execute
     Util::Array<Batch*> batches;
+    /// Set when batches change, and dependencies have to be rebuilt
+    bool dependenciesDirty = true;
 };
 
 
@@ -84,6 +96,8 @@ public:
     /// case, use linear probing to insert the processor
     /// into a new batch
     bool TryInsert(Processor* processor);
+    /// Returns true if any processor in this batch accesses a component in a way that races with the other batch
+    bool ConflictsWith(Batch const* other) const;
 
     /// prefilter all processors. Should not be done per frame - instead use CacheTable if you need to do incremental caching
     void Prefilter(World* world, bool force = false);
@@ -97,10 +111,26 @@ public:
     Util::Array<Processor const*> GetProcessors() const;
 
 private:
+    friend FrameEvent;
+
     void ExecuteAsync(World* world);
     void ExecuteSequential(World* world);
 
+    /// Query all processors and setup job inputs, returns the number of jobs
+    SizeT PrepareAsync(World* world);
+    /// Dispatch prepared jobs, which wait for the given counters and decrement doneCounter when finished
+    void DispatchAsync(World* world, const Util::FixedArray<const Threading::AtomicCounter*, true>& waitCounters, Threading::AtomicCounter* doneCounter);
+    /// Cleanup after the dispatched jobs are done
+    void FinishAsync();
+
     Util::Array<Processor*> processors;
+
+    /// Earlier async batches in the same frame event which this batch has to wait for
+    Util::Array<IndexT> dependencies;
+    /// Jobs and the views they run on for the current execution
+    ProcessorJob* jobs = nullptr;
+    SizeT numJobs = 0;
+    Dataset::View* jobViews = nullptr;
 };
 
 
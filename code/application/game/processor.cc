@@ -77,6 +77,16 @@ ProcessorBuilder::Order(int order)
     return *this;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+ProcessorBuilder&
+ProcessorBuilder::RowsPerJob(uint32_t rows)
+{
+    this->rowsPerJob = rows;
+    return *this;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -99,6 +109,7 @@ ProcessorBuilder::Build()
     processor->name = this->name.AsString();
     processor->async = this->async;
     processor->order = this->order;
+    processor->rowsPerJob = this->rowsPerJob;
     processor->filter = this->filterBuilder.Build();
 
 #ifdef WITH_NEBULA_EDITOR
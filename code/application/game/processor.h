@@ -11,6 +11,13 @@
 #include "util/stringatom.h"
 #include "filter.h"
 #include "processorid.h"
+#include "util/bit.h"
+#include "threading/interlocked.h"
+
+namespace Benchmarking
+{
+class ProcessorChunk;
+}
 
 namespace Game
 {
@@ -19,6 +26,43 @@ class World;
 
 class ProcessorBuilder;
 
+//------------------------------------------------------------------------------
+/**
+    A section of up to 64 consecutive instances in a table partition.
+
+    Chunked processor callbacks get one of these together with a pointer to the
+    first instance of the chunk in each component column, so the columns can be
+    processed as contiguous spans. If the chunk is full, every instance is valid
+    and the mask can be ignored, which lets the compiler vectorize the loop.
+*/
+struct ProcessorChunk
+{
+    /// index of the first instance of the chunk within the partition
+    uint16_t offset;
+    /// number of instances in the chunk, at most 64
+    uint16_t numInstances;
+    /// bit i is set if instance offset + i is valid (and modified, for OnlyModified processors)
+    uint64_t validMask;
+
+    /// returns true if all instances in the chunk are valid
+    bool IsFull() const
+    {
+        return this->validMask == (this->numInstances == 64 ? ~0ull : (1ull << this->numInstances) - 1);
+    }
+
+    /// call func(index) for every valid instance in the chunk, index is relative to the chunk
+    template <typename FUNC>
+    void ForEachValid(FUNC&& func) const
+    {
+        uint64_t mask = this->validMask;
+        while (mask != 0)
+        {
+            func(Util::FirstBitSetIndex(mask));
+            mask &= mask - 1;
+        }
+    }
+};
+
 class Processor
 {
 public:
@@ -38,9 +82,15 @@ public:
     bool cacheValid = false;
     /// set to false if the processor shouldn't execute in the frame.
     bool active = true;
+    /// number of rows per job for async processors, rounded up to whole sections of 64 rows. 0 balances rows over the job threads.
+    uint32_t rowsPerJob = 0;
 #ifdef NEBULA_ENABLE_PROFILING
     /// Profiling timer, handled by the frame pipeline.
     Timing::Timer timer;
+    /// Nanoseconds spent in jobs this frame, summed over all threads. Handled by the frame pipeline.
+    Threading::AtomicCounter64 jobTime = 0;
+    /// Time spent executing the processor in the last frame.
+    Timing::Time time = 0;
 #endif
 #ifdef WITH_NEBULA_EDITOR
     /// set to true if you want this processor to always run in editor
@@ -49,6 +99,19 @@ public:
 
 private:
     friend ProcessorBuilder;
+    /// drives the callbacks directly on synthetic views
+    friend class Benchmarking::ProcessorChunk;
+
+    template <typename... TYPES, std::size_t... Is>
+    static void
+    ChunkExpander(World* world, std::function<void(World*, ProcessorChunk const&, TYPES...)> const& func, Game::Dataset::View const& view, ProcessorChunk const& chunk, uint8_t const bufferStartOffset, std::index_sequence<Is...>)
+    {
+        func(
+            world,
+            chunk,
+            ((TYPES)view.buffers[bufferStartOffset + Is] + chunk.offset)...
+        );
+    }
 
     template <typename... TYPES, std::size_t... Is>
     static void
@@ -60,6 +123,7 @@ private:
         );
     }
 
+    /// Create a callback which runs a function on every valid instance in a view
     template <typename... COMPONENTS>
     static std::function<void(World*, Dataset::View const&)>
     ForEach(std::function<void(World*, COMPONENTS...)> func, uint8_t bufferStartOffset)
@@ -95,6 +159,7 @@ private:
         };
     }
 
+    /// Create a callback which runs a function on every valid and modified instance in a view
     template <typename... COMPONENTS>
     static std::function<void(World*, Dataset::View const&)>
     ForEachModified(std::function<void(World*, COMPONENTS...)> func, uint8_t bufferStartOffset)
@@ -131,6 +196,67 @@ private:
             }
         };
     }
+
+    /// Create a callback which runs a chunked function on every section of 64 instances in a view with any valid instance
+    template <typename... COMPONENTS>
+    static std::function<void(World*, Dataset::View const&)>
+    ForEachChunk(std::function<void(World*, ProcessorChunk const&, COMPONENTS...)> func, uint8_t bufferStartOffset)
+    {
+        return [func, bufferStartOffset](World* world, Game::Dataset::View const& view)
+        {
+            uint16_t i = 0;
+            while (i < view.numInstances)
+            {
+                ProcessorChunk chunk;
+                chunk.offset = i;
+                chunk.numInstances = Math::min<uint16_t>(uint16_t(64), view.numInstances - i);
+                chunk.validMask = view.validInstances.GetBits(i / 64);
+                if (chunk.validMask != 0)
+                {
+                    ChunkExpander<COMPONENTS...>(
+                        world,
+                        func,
+                        view,
+                        chunk,
+                        bufferStartOffset,
+                        std::make_index_sequence<sizeof...(COMPONENTS)>()
+                    );
+                }
+                i += 64;
+            }
+        };
+    }
+
+    /// Create a callback which runs a chunked function on every section of 64 instances in a view with any valid and modified instance
+    template <typename... COMPONENTS>
+    static std::function<void(World*, Dataset::View const&)>
+    ForEachChunkModified(std::function<void(World*, ProcessorChunk const&, COMPONENTS...)> func, uint8_t bufferStartOffset)
+    {
+        return [func, bufferStartOffset](World* world, Game::Dataset::View const& view)
+        {
+            uint16_t i = 0;
+            while (i < view.numInstances)
+            {
+                uint64_t const section = i / 64;
+                ProcessorChunk chunk;
+                chunk.offset = i;
+                chunk.numInstances = Math::min<uint16_t>(uint16_t(64), view.numInstances - i);
+                chunk.validMask = view.validInstances.GetBits(section) & view.modifiedInstances.GetBits(section);
+                if (chunk.validMask != 0)
+                {
+                    ChunkExpander<COMPONENTS...>(
+                        world,
+                        func,
+                        view,
+                        chunk,
+                        bufferStartOffset,
+                        std::make_index_sequence<sizeof...(COMPONENTS)>()
+                    );
+                }
+                i += 64;
+            }
+        };
+    }
 };
 
 class ProcessorBuilder
@@ -147,6 +273,14 @@ public:
     template<typename ...COMPONENTS>
     ProcessorBuilder& Func(std::function<void(World*, COMPONENTS...)> func);
 
+    /// which function to run with the processor, called per chunk of up to 64 instances with a pointer into each component column
+    template<typename LAMBDA>
+    ProcessorBuilder& FuncChunk(LAMBDA);
+
+    /// which function to run with the processor, called per chunk of up to 64 instances with a pointer into each component column
+    template<typename ...COMPONENTS>
+    ProcessorBuilder& FuncChunk(std::function<void(World*, ProcessorChunk const&, COMPONENTS...)> func);
+
     /// entities must have these components
     template<typename ... COMPONENTS>
     ProcessorBuilder& Including();
@@ -170,6 +304,9 @@ public:
     /// Set the sorting order for the processor
     ProcessorBuilder& Order(int order);
 
+    /// Set how many rows each job of an async processor should process, 0 balances automatically
+    ProcessorBuilder& RowsPerJob(uint32_t rows);
+
     /// Processor should always run, even in editor; when the game is paused.
     ProcessorBuilder& RunInEditor();
 
@@ -186,6 +323,7 @@ private:
     bool async = false;
     bool onlyModified = false;
     int order = 100;
+    uint32_t rowsPerJob = 0;
 #ifdef WITH_NEBULA_EDITOR
     bool runInEditor = false;
 #endif
@@ -215,6 +353,31 @@ ProcessorBuilder::Func(std::function<void(World*, COMPONENTS...)> func)
     return *this;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+template<typename LAMBDA>
+ProcessorBuilder& ProcessorBuilder::FuncChunk(LAMBDA lambda)
+{
+    return this->FuncChunk(std::function(lambda));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Components are passed as pointers, const pointers are read only.
+*/
+template<typename ...COMPONENTS>
+inline ProcessorBuilder&
+ProcessorBuilder::FuncChunk(std::function<void(World*, ProcessorChunk const&, COMPONENTS...)> func)
+{
+    static_assert((std::is_pointer<COMPONENTS>::value && ...), "Chunked processor functions take component pointers");
+    uint8_t const bufferStartOffset = this->filterBuilder.GetNumInclusive();
+    this->filterBuilder.Including<typename std::remove_pointer<COMPONENTS>::type&...>();
+    this->func = Processor::ForEachChunk(func, bufferStartOffset);
+    this->funcModified = Processor::ForEachChunkModified(func, bufferStartOffset);
+    return *this;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
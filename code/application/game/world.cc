@@ -808,6 +808,8 @@ World::GetNumInstances(MemDb::TableId tid)
 
 //------------------------------------------------------------------------------
 /**
+    Entities that move from the same table to the same table are migrated
+    together, so that their rows are copied in bulk.
 */
 void
 World::ExecuteAddComponentCommands()
@@ -827,6 +829,9 @@ World::ExecuteAddComponentCommands()
     }
     this->addStagedQueue.QuickSortWithFunc(sortFunc);
 
+    // Figure out where every entity is moving
+    Util::Array<StagedMigration> migrations;
+    migrations.Reserve(this->addStagedQueue.Size());
     auto* currentCmd = this->addStagedQueue.Begin();
     auto* end = this->addStagedQueue.End();
     while (currentCmd != end)
@@ -839,8 +844,66 @@ World::ExecuteAddComponentCommands()
             numEntityCmds++;
             currentCmd++;
         }
-        AddStagedComponentsToEntity(currentEntity, firstCmdOfEntity, numEntityCmds);
+
+        EntityMapping const mapping = this->GetEntityMapping(currentEntity);
+        StagedMigration migration;
+        migration.from = mapping.table;
+        migration.to = this->FindStagedComponentsTable(currentEntity, firstCmdOfEntity, numEntityCmds);
+        migration.row = mapping.instance;
+        migration.entity = currentEntity;
+        migration.cmds = firstCmdOfEntity;
+        migration.numCmds = numEntityCmds;
+        migrations.Append(migration);
+    }
+
+    // Group by source and destination table, and keep rows in order so they can be copied in runs
+    auto migrationSortFunc = [](const void* lhs, const void* rhs) -> int
+    {
+        StagedMigration const* a = (const StagedMigration*)lhs;
+        StagedMigration const* b = (const StagedMigration*)rhs;
+        if (a->from != b->from)
+            return a->from < b->from ? -1 : 1;
+        if (a->to != b->to)
+            return a->to < b->to ? -1 : 1;
+        if (a->row.partition != b->row.partition)
+            return a->row.partition < b->row.partition ? -1 : 1;
+        return (a->row.index > b->row.index) - (a->row.index < b->row.index);
+    };
+    migrations.QuickSortWithFunc(migrationSortFunc);
+
+    Util::Array<Entity> entities;
+    Util::FixedArray<MemDb::RowId> newInstances;
+    IndexT i = 0;
+    while (i < migrations.Size())
+    {
+        IndexT groupEnd = i + 1;
+        while (groupEnd < migrations.Size() && migrations[groupEnd].from == migrations[i].from && migrations[groupEnd].to == migrations[i].to)
+            groupEnd++;
+
+        MemDb::TableId const newTableId = migrations[i].to;
+        MemDb::Table& newTable = this->db->GetTable(newTableId);
+        if (groupEnd - i == 1 || migrations[i].from == newTableId)
+        {
+            // Nothing to gain from a bulk migration
+            for (IndexT m = i; m < groupEnd; m++)
+            {
+                MemDb::RowId newInstance = this->Migrate(migrations[m].entity, newTableId);
+                this->WriteStagedComponents(newTable, newInstance, migrations[m].cmds, migrations[m].numCmds);
+            }
+        }
+        else
+        {
+            entities.Clear();
+            for (IndexT m = i; m < groupEnd; m++)
+                entities.Append(migrations[m].entity);
+
+            this->Migrate(entities, migrations[i].from, newTableId, newInstances);
+            for (IndexT m = i; m < groupEnd; m++)
+                this->WriteStagedComponents(newTable, newInstances[m - i], migrations[m].cmds, migrations[m].numCmds);
+        }
+        i = groupEnd;
     }
+
     // release all memory of the staged components
     componentStageAllocator.Release();
     addStagedQueue.Reset();
@@ -889,6 +952,18 @@ World::ExecuteRemoveComponentCommands()
 */
 void
 World::AddStagedComponentsToEntity(Entity entity, AddStagedComponentCommand* cmds, SizeT numCmds)
+{
+    MemDb::TableId newCategoryId = this->FindStagedComponentsTable(entity, cmds, numCmds);
+    MemDb::RowId newInstance = this->Migrate(entity, newCategoryId);
+    this->WriteStagedComponents(this->db->GetTable(newCategoryId), newInstance, cmds, numCmds);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Find the table an entity ends up in when adding the staged components, creates it if it doesn't exist.
+*/
+MemDb::TableId
+World::FindStagedComponentsTable(Entity entity, AddStagedComponentCommand const* cmds, SizeT numCmds)
 {
     MemDb::TableSignature signature;
 
@@ -938,17 +1013,21 @@ World::AddStagedComponentsToEntity(Entity entity, AddStagedComponentCommand* cmd
 
         newCategoryId = this->CreateEntityTable(info);
     }
+    return newCategoryId;
+}
 
-    MemDb::RowId newInstance = this->Migrate(entity, newCategoryId);
-
-    MemDb::Table& newTable = this->db->GetTable(newCategoryId);
-
-    for (i = 0; i < numCmds; i++)
+//------------------------------------------------------------------------------
+/**
+*/
+void
+World::WriteStagedComponents(MemDb::Table& table, MemDb::RowId instance, AddStagedComponentCommand const* cmds, SizeT numCmds)
+{
+    for (SizeT i = 0; i < numCmds; i++)
     {
         auto const* cmd = cmds + i;
 
-        auto attrIndex = newTable.GetAttributeIndex(cmd->componentId);
-        void* ptr = newTable.GetValuePointer(attrIndex, newInstance);
+        auto attrIndex = table.GetAttributeIndex(cmd->componentId);
+        void* ptr = table.GetValuePointer(attrIndex, instance);
         Memory::Copy(cmd->data, ptr, cmd->dataSize);
     }
 }
@@ -1322,6 +1401,8 @@ World::Migrate(Entity entity, MemDb::TableId newTableId)
 /**
     @param newInstances     Will be filled with the new instance ids in the destination table.
     @note   This assumes ALL entities in the entity array is of same table!
+    @note   Like the single entity migration, the rows left in the source table are
+            freed and compacted by the defragmentation in ManageEntities.
 */
 void
 World::Migrate(
@@ -1353,9 +1434,6 @@ World::Migrate(
         this->db->GetTable(fromTableId), instances, this->db->GetTable(newTableId), newInstances, false
     );
 
-    // Defrag here to avoid entities existing in multiple tables
-    this->Defragment(fromTableId);
-
     for (IndexT i = 0; i < num; i++)
     {
         this->entityMap[entities[i].index] = {newTableId, newInstances[i]};
@@ -1556,7 +1634,7 @@ World::RenderDebug()
                     }
 #ifdef NEBULA_ENABLE_PROFILING
                     ImGui::SameLine();
-                    ImGui::Text(" | [ %0.3fms ]", (float)(processor->timer.GetTime() * 1000.0));
+                    ImGui::Text(" | [ %0.3fms ]", (float)(processor->time * 1000.0));
 #endif
                 }
                 ImGui::Unindent();
@@ -1783,9 +1861,64 @@ World::Query(Filter filter)
     //    //N_COUNTER_INCR("Calls to Game::Query", 1);
     //    N_SCOPE_ACCUM(QueryTime, EntitySystem);
     //#endif
-    Util::Array<MemDb::TableId> tids = this->db->Query(GetInclusiveTableMask(filter), GetExclusiveTableMask(filter));
+    // the cache is shared by all jobs querying the world
+    Threading::CriticalScope scope(&this->queryLock);
 
-    return this->Query(filter, tids);
+    // persistent query, kept up to date by the database when tables or partitions are created or deleted
+    MemDb::Database::QueryCache const& query = this->db->CachedPartitionQuery(GetInclusiveTableMask(filter), GetExclusiveTableMask(filter));
+    Util::FixedArray<ComponentId> const& components = ComponentsInFilter(filter);
+
+    if (this->queryViews.Size() <= (SizeT)filter)
+        this->queryViews.Resize(filter + 1);
+    QueryViews& cache = this->queryViews[filter];
+
+    if (cache.query != &query || cache.version != query.version || cache.components != components)
+    {
+        // the partitions changed, or the filter id was reused, look up the column buffers again
+        cache.views.Clear();
+        cache.views.Reserve(query.partitions.Size());
+        for (MemDb::Database::QueryCache::ActivePartition const& active : query.partitions)
+        {
+            MemDb::Table& tbl = this->db->GetTable(active.table);
+            Dataset::View view;
+            view.tableId = active.table;
+            view.partitionId = active.partition->partitionId;
+
+            IndexT i = 0;
+            for (auto component : components)
+            {
+                MemDb::ColumnIndex colId = tbl.GetAttributeIndex(component);
+                view.buffers[i] = tbl.GetBuffer(active.partition->partitionId, colId);
+                i++;
+            }
+            cache.views.Append(view);
+        }
+
+        cache.query = &query;
+        cache.version = query.version;
+        cache.components = components;
+    }
+
+    Dataset data;
+    data.numViews = cache.views.Size();
+    if (data.numViews == 0)
+        return data;
+
+    // every dataset gets views of its own, so earlier datasets don't change under their users
+    data.views = AllocDatasetViews(data.numViews);
+    for (uint32_t i = 0; i < data.numViews; i++)
+    {
+        Dataset::View const& cached = cache.views[i];
+        MemDb::Table::Partition const* part = query.partitions[i].partition;
+        Dataset::View& view = data.views[i];
+        view.tableId = cached.tableId;
+        view.partitionId = cached.partitionId;
+        Memory::Copy(cached.buffers, view.buffers, sizeof(void*) * components.Size());
+        view.numInstances = part->numRows;
+        view.validInstances = part->validRows;
+        view.modifiedInstances = part->modifiedRows;
+    }
+    return data;
 }
 
 //------------------------------------------------------------------------------
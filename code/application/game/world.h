@@ -12,11 +12,13 @@
 #include "entitypool.h"
 #include "component.h"
 #include "memdb/tablesignature.h"
+#include "memdb/database.h"
 #include "util/queue.h"
 #include "category.h"
 #include "processorid.h"
 #include "processor.h"
 #include "memory/arenaallocator.h"
+#include "threading/criticalsection.h"
 #include "frameevent.h"
 #include "util/fourcc.h"
 
@@ -137,6 +139,7 @@ public:
     void MarkAsModified(Game::Entity entity);
 
     /// Query the entity database using specified filter set. This does NOT wait for resources to be available.
+    /// Only the partition lookup is cached per filter, every call returns views of its own which are valid until the datasets are released.
     Dataset Query(Filter filter);
     /// Query a subset of tables using a specified filter set. Modifies the tables array so that it only contains valid tables.
     /// This does NOT wait for resources to be available.
@@ -222,6 +225,16 @@ private:
         void* data = nullptr;
     };
 
+    struct StagedMigration
+    {
+        MemDb::TableId from;
+        MemDb::TableId to;
+        MemDb::RowId row;
+        Entity entity;
+        AddStagedComponentCommand* cmds;
+        SizeT numCmds;
+    };
+
     struct RemoveComponentCommand
     {
         Entity entity = Game::Entity::Invalid();
@@ -267,6 +280,10 @@ private:
 
     /// Adds all components in cmds to entity 
     void AddStagedComponentsToEntity(Entity entity, AddStagedComponentCommand* cmds, SizeT numCmds);
+    /// Find or create the table an entity moves to when adding the components in cmds
+    MemDb::TableId FindStagedComponentsTable(Entity entity, AddStagedComponentCommand const* cmds, SizeT numCmds);
+    /// Copy staged component values into a row
+    void WriteStagedComponents(MemDb::Table& table, MemDb::RowId instance, AddStagedComponentCommand const* cmds, SizeT numCmds);
     /// Removes all components in cmds from entity
     void RemoveComponentsFromEntity(Entity entity, RemoveComponentCommand* cmds, SizeT numCmds);
 
@@ -302,6 +319,20 @@ private:
     MemDb::TableId defaultTableId;
     /// Contains all the component decay buffers. Lookup directly via ComponentId
     Util::FixedArray<ComponentDecayBuffer> componentDecayTable;
+
+    /// views of a filter, only looked up again when the partitions of its query change
+    struct QueryViews
+    {
+        MemDb::Database::QueryCache const* query = nullptr;
+        uint32_t version = 0;
+        Util::FixedArray<ComponentId> components;
+        /// table, partition and column buffers of each view, every query copies them into a dataset of its own
+        Util::Array<Dataset::View> views;
+    };
+    /// cached views, indexed by filter
+    Util::Array<QueryViews> queryViews;
+    /// queries might run in several jobs at once
+    Threading::CriticalSection queryLock;
 };
 
 //------------------------------------------------------------------------------
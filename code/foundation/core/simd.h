@@ -148,6 +148,44 @@ any_u32x3(u32x4 a)
     return (_mm_movemask_epi8(a) & 0x7) != 0x0;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+__forceinline u32x4
+and_u32x4(u32x4 a, u32x4 b)
+{
+    return _mm_and_si128(a, b);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+__forceinline u32x4
+or_u32x4(u32x4 a, u32x4 b)
+{
+    return _mm_or_si128(a, b);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Returns one bit per lane, set if the lane is all ones
+*/
+__forceinline uint32_t
+mask_u32x4(u32x4 a)
+{
+    return _mm_movemask_ps(_mm_castsi128_ps(a));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Returns b in the lanes where mask is set, and a in the others
+*/
+__forceinline f32x4
+select_f32x4(f32x4 a, f32x4 b, u32x4 mask)
+{
+    return _mm_blendv_ps(a, b, _mm_castsi128_ps(mask));
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -168,6 +206,15 @@ load_aligned_f32x3(const float* ptr)
     return _mm_and_ps(vec, _mask_xyz);
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+__forceinline f32x4
+load_unaligned_f32x4(const float* ptr)
+{
+    return _mm_loadu_ps(ptr);
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -547,6 +594,45 @@ any_u32x3(u32x4 cmp)
     return res == 0x0;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+__forceinline u32x4
+and_u32x4(u32x4 a, u32x4 b)
+{
+    return vandq_u32(a, b);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+__forceinline u32x4
+or_u32x4(u32x4 a, u32x4 b)
+{
+    return vorrq_u32(a, b);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Returns one bit per lane, set if the lane is all ones
+*/
+__forceinline uint32_t
+mask_u32x4(u32x4 a)
+{
+    static const uint32x4_t bits = { 1, 2, 4, 8 };
+    return vaddvq_u32(vandq_u32(a, bits));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Returns b in the lanes where mask is set, and a in the others
+*/
+__forceinline f32x4
+select_f32x4(f32x4 a, f32x4 b, u32x4 mask)
+{
+    return vbslq_f32(mask, b, a);
+}
+
 
 //------------------------------------------------------------------------------
 /**
@@ -568,6 +654,15 @@ load_aligned_f32x3(const scalar* ptr)
     return set_last_f32x4(vec, 0);
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+__forceinline f32x4
+load_unaligned_f32x4(const scalar* ptr)
+{
+    return vld1q_f32(ptr);
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -632,7 +727,8 @@ mul_first_f32x4(f32x4 a, f32x4 b)
 __forceinline f32x4
 fma_f32x4(f32x4 a, f32x4 b, f32x4 c)
 {
-    return vmlaq_f32(a, b, c);
+    // a * b + c, like the SSE path
+    return vmlaq_f32(c, a, b);
 }
 
 //------------------------------------------------------------------------------
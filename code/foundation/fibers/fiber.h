@@ -7,6 +7,7 @@
     (C) 2020 Individual contributors, see AUTHORS file
 */
 //------------------------------------------------------------------------------
+#include "core/types.h"
 namespace Fibers
 {
 
@@ -18,8 +19,8 @@ public:
     Fiber();
     /// construct from nullpointer
     Fiber(std::nullptr_t);
-    /// constructor
-    Fiber(void(*Function)(void*), void* context);
+    /// constructor, stackSize of 0 picks the platform default
+    Fiber(void(*Function)(void*), void* context, SizeT stackSize = 0);
     /// copy constructor
     Fiber(const Fiber& rhs);
     /// destructor
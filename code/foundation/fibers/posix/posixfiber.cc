@@ -64,7 +64,7 @@ static void FiberStartFunction(void* p)
 //------------------------------------------------------------------------------
 /**
 */
-Fiber::Fiber(void(*function)(void*), void* context)
+Fiber::Fiber(void(*function)(void*), void* context, SizeT stackSize)
     : handle(nullptr)
     , context(nullptr)
 {
@@ -72,7 +72,8 @@ Fiber::Fiber(void(*function)(void*), void* context)
     fiber_t* implHandle = (fiber_t*)this->handle;
     getcontext(&implHandle->fib);
 
-    const size_t stackSize = 64 * 1024;
+    if (stackSize == 0)
+        stackSize = 64 * 1024;
     implHandle->fib.uc_stack.ss_sp = new char[stackSize];
     implHandle->fib.uc_stack.ss_size = stackSize;
     implHandle->fib.uc_link = nullptr;
@@ -30,11 +30,11 @@ Fiber::Fiber(std::nullptr_t)
 //------------------------------------------------------------------------------
 /**
 */
-Fiber::Fiber(void(*function)(void*), void* context)
+Fiber::Fiber(void(*function)(void*), void* context, SizeT stackSize)
     : handle(nullptr)
     , context(nullptr)
 {
-    this->handle = CreateFiber(0, { function }, context);
+    this->handle = CreateFiber(stackSize, { function }, context);
     this->context = context;
 }
 
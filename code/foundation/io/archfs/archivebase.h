@@ -4,7 +4,8 @@
     @class IO::ArchiveBase
     
     Base class of file archives. Subclasses of this class implemented support
-    for specific archive formats, like zip.
+    for specific archive formats, like zip or Nebula pack files. Since both
+    formats can be mounted side by side, the archive interface is virtual.
 
     @copyright
     (C) 2009 Radon Labs GmbH
@@ -12,6 +13,7 @@
 */
 #include "core/refcounted.h"
 #include "io/uri.h"
+#include "io/filetime.h"
 
 //------------------------------------------------------------------------------
 namespace IO
@@ -26,22 +28,28 @@ public:
     virtual ~ArchiveBase();
 
     /// setup the archive from an URI (without file extension)
-    bool Setup(const URI& archiveURI, const Util::String& rootPath);
+    virtual bool Setup(const URI& archiveURI, const Util::String& rootPath);
     /// discard the archive
-    void Discard();
+    virtual void Discard();
     /// return true if archive is valid
     bool IsValid() const;
     /// get the URI of the archive
     const URI& GetURI() const;
 
     /// list all files in a directory in the archive
-    Util::Array<Util::String> ListFiles(const Util::String& dirPathInArchive, const Util::String& pattern) const;
+    virtual Util::Array<Util::String> ListFiles(const Util::String& dirPathInArchive, const Util::String& pattern) const;
     /// list all subdirectories in a directory in the archive
-    Util::Array<Util::String> ListDirectories(const Util::String& dirPathInArchive, const Util::String& pattern) const;
+    virtual Util::Array<Util::String> ListDirectories(const Util::String& dirPathInArchive, const Util::String& pattern) const;
     /// convert a "file:" URI into a archive-specific URI pointing into this archive
-    URI ConvertToArchiveURI(const URI& fileURI) const;
+    virtual URI ConvertToArchiveURI(const URI& fileURI) const;
     /// convert an absolute path to local path inside archive, returns empty string if absPath doesn't point into this archive
-    Util::String ConvertToPathInArchive(const Util::String& absPath) const;
+    virtual Util::String ConvertToPathInArchive(const Util::String& absPath) const;
+    /// return true if the archive contains a file
+    virtual bool HasFile(const Util::String& pathInArchive) const;
+    /// return true if the archive contains a directory
+    virtual bool HasDirectory(const Util::String& pathInArchive) const;
+    /// get size and time stamps of a file in the archive
+    virtual bool GetIOInfo(const URI& pathInArchive, IOStat& outInfo);
 
 protected:
     bool isValid;
@@ -6,7 +6,10 @@
 
 #include "io/archfs/archivefilesystembase.h"
 #include "io/archfs/archive.h"
+#include "io/packfs/packarchive.h"
+#include "io/packfs/packfilestream.h"
 #include "io/assignregistry.h"
+#include "io/schemeregistry.h"
 
 namespace IO
 {
@@ -40,12 +43,15 @@ ArchiveFileSystemBase::~ArchiveFileSystemBase()
 //------------------------------------------------------------------------------
 /**
     Setup the archive file system. Subclasses may register their
-    archive stream classes with the SchemeRegistry here.
+    archive stream classes with the SchemeRegistry here. Nebula pack files
+    are supported on all platforms, so their stream class is registered
+    by the base class.
 */
 void
 ArchiveFileSystemBase::Setup()
 {
     n_assert(!this->IsValid());
+    SchemeRegistry::Instance()->RegisterUriScheme("pak", PackFileStream::RTTI);
     this->isValid = true;
 }
 
@@ -65,6 +71,7 @@ ArchiveFileSystemBase::Discard()
         this->Unmount(this->archives.ValueAtIndex(0));
     }
 
+    SchemeRegistry::Instance()->UnregisterUriScheme("pak");
     this->isValid = false;
 }
 
@@ -74,7 +81,7 @@ ArchiveFileSystemBase::Discard()
     and adding it to the archive dictionary. If mounting fails, an invalid
     pointer will be returned!
 */
-Ptr<Archive>
+Ptr<ArchiveBase>
 ArchiveFileSystemBase::Mount(const URI& uri)
 {
     return MountEmbedded(uri, "");
@@ -84,14 +91,23 @@ ArchiveFileSystemBase::Mount(const URI& uri)
 /**
     This "mounts" an archive file by creating a new Archive object
     and adding it to the archive dictionary. If mounting fails, an invalid
-    pointer will be returned!
+    pointer will be returned! A Nebula pack file (.npk) takes precedence
+    over the platform archive (.zip) of the same name.
 */
-Ptr<Archive>
+Ptr<ArchiveBase>
 ArchiveFileSystemBase::MountEmbedded(const URI& uri, const Util::String& rootPath)
 {
     n_assert(!this->IsMounted(uri));
     String path = AssignRegistry::Instance()->ResolveAssigns(uri).LocalPath();
-    Ptr<Archive> newArchive = Archive::Create();
+    Ptr<ArchiveBase> newArchive;
+    if (PackArchive::Exists(uri))
+    {
+        newArchive = PackArchive::Create();
+    }
+    else
+    {
+        newArchive = Archive::Create();
+    }
     if (newArchive->Setup(uri, rootPath))
     {
         this->critSect.Enter();
@@ -112,7 +128,7 @@ ArchiveFileSystemBase::MountEmbedded(const URI& uri, const Util::String& rootPat
     archive registry, and call the Discard() method on it.
 */
 void
-ArchiveFileSystemBase::Unmount(const Ptr<Archive>& archive)
+ArchiveFileSystemBase::Unmount(const Ptr<ArchiveBase>& archive)
 {
     n_assert(this->IsMounted(archive->GetURI()));
     archive->Discard();
@@ -132,7 +148,7 @@ ArchiveFileSystemBase::Unmount(const URI& uri)
 {
     n_assert(this->IsMounted(uri));
     String path = AssignRegistry::Instance()->ResolveAssigns(uri).LocalPath();
-    Ptr<Archive> archive = this->archives[path];
+    Ptr<ArchiveBase> archive = this->archives[path];
     archive->Discard();
 
     this->critSect.Enter();
@@ -144,11 +160,11 @@ ArchiveFileSystemBase::Unmount(const URI& uri)
 /**
     Return all currently mounted archives.
 */
-Array<Ptr<Archive> >
+Array<Ptr<ArchiveBase> >
 ArchiveFileSystemBase::GetMountedArchives() const
 {
     this->critSect.Enter();    
-    Array<Ptr<Archive> > archiveArray = this->archives.ValuesAsArray();
+    Array<Ptr<ArchiveBase> > archiveArray = this->archives.ValuesAsArray();
     this->critSect.Leave();
     return archiveArray;
 }
@@ -159,11 +175,11 @@ ArchiveFileSystemBase::GetMountedArchives() const
     if no archive with that name exists. The filename will be resolved into
     an absolute path internally before the lookup happens.
 */
-Ptr<Archive>
+Ptr<ArchiveBase>
 ArchiveFileSystemBase::FindArchive(const URI& uri) const
 {
     String path = AssignRegistry::Instance()->ResolveAssigns(uri).LocalPath();
-    Ptr<Archive> result;
+    Ptr<ArchiveBase> result;
 
     this->critSect.Enter();    
     IndexT index = this->archives.FindIndex(path);
@@ -202,10 +218,10 @@ ArchiveFileSystemBase::HasArchives() const
     This method should return the archive which contains the provided 
     file URI. Override this method in a derived class!
 */
-Ptr<Archive>
+Ptr<ArchiveBase>
 ArchiveFileSystemBase::FindArchiveWithFile(const URI& uri) const
 {
-    return Ptr<Archive>();
+    return Ptr<ArchiveBase>();
 }
 
 //------------------------------------------------------------------------------
@@ -213,10 +229,10 @@ ArchiveFileSystemBase::FindArchiveWithFile(const URI& uri) const
     This method should return the archive which contains the
     provided directory URI. Override this method in a derived class!
 */
-Ptr<Archive>
+Ptr<ArchiveBase>
 ArchiveFileSystemBase::FindArchiveWithDir(const URI& uri) const
 {
-    return Ptr<Archive>();
+    return Ptr<ArchiveBase>();
 }
 
 //------------------------------------------------------------------------------
@@ -232,7 +248,7 @@ URI
 ArchiveFileSystemBase::ConvertFileToArchiveURIIfExists(const URI& uri) const
 {
     // make sure that derived method is called
-    Ptr<Archive> archive = this->FindArchiveWithFile(uri);
+    Ptr<ArchiveBase> archive = this->FindArchiveWithFile(uri);
     if (archive.isvalid())
     {
         return archive->ConvertToArchiveURI(uri);
@@ -248,7 +264,7 @@ ArchiveFileSystemBase::ConvertFileToArchiveURIIfExists(const URI& uri) const
 URI
 ArchiveFileSystemBase::ConvertDirToArchiveURIIfExists(const URI& uri) const
 {
-    Ptr<Archive> archive = this->FindArchiveWithDir(uri);
+    Ptr<ArchiveBase> archive = this->FindArchiveWithDir(uri);
     if (archive.isvalid())
     {
         return archive->ConvertToArchiveURI(uri);
@@ -17,7 +17,7 @@
 //------------------------------------------------------------------------------
 namespace IO
 {
-class Archive;
+class ArchiveBase;
 
 class ArchiveFileSystemBase : public Core::RefCounted
 {
@@ -37,13 +37,13 @@ public:
     bool IsValid() const;
     
     /// mount an archive
-    virtual Ptr<Archive> Mount(const URI& uri);
+    virtual Ptr<ArchiveBase> Mount(const URI& uri);
     /// mount an embedded archive
-    virtual Ptr<Archive> MountEmbedded(const URI& uri, const Util::String& rootPath);
+    virtual Ptr<ArchiveBase> MountEmbedded(const URI& uri, const Util::String& rootPath);
     /// unmount an archive by URI
     virtual void Unmount(const URI& uri);
     /// unmount an archive by pointer
-    virtual void Unmount(const Ptr<Archive>& archive);
+    virtual void Unmount(const Ptr<ArchiveBase>& archive);
     /// return true if an archive is mounted
     bool IsMounted(const URI& uri) const;
 
@@ -51,14 +51,14 @@ public:
     bool HasArchives() const;
     
     /// get an array of all mounted archives
-    Util::Array<Ptr<Archive> > GetMountedArchives() const;
+    Util::Array<Ptr<ArchiveBase> > GetMountedArchives() const;
     /// find a zip archive by its URI, returns invalid ptr if not mounted
-    Ptr<Archive> FindArchive(const URI& uri) const;
+    Ptr<ArchiveBase> FindArchive(const URI& uri) const;
 
     /// find first archive which contains the file path
-    virtual Ptr<Archive> FindArchiveWithFile(const URI& fileUri) const;
+    virtual Ptr<ArchiveBase> FindArchiveWithFile(const URI& fileUri) const;
     /// find first archive which contains the directory path
-    virtual Ptr<Archive> FindArchiveWithDir(const URI& dirUri) const;
+    virtual Ptr<ArchiveBase> FindArchiveWithDir(const URI& dirUri) const;
     /// transparently convert a URI pointing to a file into a matching archive URI
     URI ConvertFileToArchiveURIIfExists(const URI& uri) const;
     /// transparently convert a URI pointing to a directory into a matching archive URI    
@@ -66,7 +66,7 @@ public:
 
 protected:
     Threading::CriticalSection critSect;
-    Util::Dictionary<Util::String, Ptr<Archive> > archives;
+    Util::Dictionary<Util::String, Ptr<ArchiveBase> > archives;
     bool isValid;
 };
 
@@ -0,0 +1,368 @@
+//------------------------------------------------------------------------------
+//  asyncfilereader.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "io/asyncfilereader.h"
+#include "profiling/profiling.h"
+#include "jobs2/jobs2.h"
+#if __linux__
+#include <errno.h>
+#include <stdio.h>
+#endif
+
+namespace IO
+{
+__ImplementClass(IO::AsyncFileReader, 'AFRD', Core::RefCounted);
+__ImplementInterfaceSingleton(IO::AsyncFileReader);
+__ImplementClass(IO::AsyncFileReaderThread, 'AFRT', Threading::Thread);
+
+#if __linux__
+/// user data of the no-op used to wake up the thread waiting on the ring
+static const uint64_t RingWakeUp = ~0ull;
+/// largest chunk handed to a single read, larger reads are continued
+static const Stream::Size RingMaxChunk = 1 << 30;
+#endif
+
+//------------------------------------------------------------------------------
+/**
+*/
+AsyncFileReader::AsyncFileReader() :
+    nextThread(0),
+    isValid(false)
+{
+    __ConstructInterfaceSingleton;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+AsyncFileReader::~AsyncFileReader()
+{
+    if (this->IsValid())
+    {
+        this->Discard();
+    }
+    __DestructInterfaceSingleton;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AsyncFileReader::Setup()
+{
+    n_assert(!this->IsValid());
+    this->isValid = true;
+
+#if __linux__
+    if (this->ring.Setup(QueueDepth))
+    {
+        this->inflight.Resize(QueueDepth);
+        this->freeSlots.Reserve(QueueDepth);
+        for (IndexT i = QueueDepth - 1; i >= 0; i--)
+        {
+            this->freeSlots.Append(i);
+        }
+
+        // a single thread reaps the completions of all reads
+        this->threads.Resize(1);
+        this->threads[0] = AsyncFileReaderThread::Create();
+        this->threads[0]->reader = this;
+        this->threads[0]->reapsRing = true;
+        this->threads[0]->SetName("AsyncFileReader thread");
+        this->threads[0]->Start();
+        return;
+    }
+    n_printf("AsyncFileReader: io_uring not available, falling back to blocking reads\n");
+#endif
+
+    this->threads.Resize(NumWorkerThreads);
+    for (IndexT i = 0; i < this->threads.Size(); i++)
+    {
+        this->threads[i] = AsyncFileReaderThread::Create();
+        this->threads[i]->reader = this;
+        this->threads[i]->reapsRing = false;
+        this->threads[i]->SetName(Util::String::Sprintf("AsyncFileReader thread %d", i));
+        this->threads[i]->Start();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AsyncFileReader::Discard()
+{
+    n_assert(this->IsValid());
+
+    // the threads finish all submitted reads before they stop
+    for (IndexT i = 0; i < this->threads.Size(); i++)
+    {
+        this->threads[i]->Stop();
+    }
+    this->threads.Clear();
+
+#if __linux__
+    if (this->ring.IsValid())
+    {
+        this->ring.Discard();
+        this->inflight.Clear();
+        this->freeSlots.Clear();
+    }
+#endif
+    this->isValid = false;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+AsyncFileReader::IsUsingIoUring() const
+{
+#if __linux__
+    return this->ring.IsValid();
+#else
+    return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AsyncFileReader::Read(const AsyncRead* reads, SizeT numReads)
+{
+    n_assert(this->IsValid());
+#if __linux__
+    if (this->ring.IsValid())
+    {
+        this->ringLock.Enter();
+        for (IndexT i = 0; i < numReads; i++)
+        {
+            n_assert(reads[i].file != nullptr && reads[i].buffer != nullptr);
+            this->waiting.Enqueue(reads[i]);
+        }
+        this->QueueWaitingReads();
+        this->ringLock.Leave();
+        return;
+    }
+#endif
+
+    // spread the reads over the worker threads
+    for (IndexT i = 0; i < numReads; i++)
+    {
+        n_assert(reads[i].file != nullptr && reads[i].buffer != nullptr);
+        uint thread = (uint)Threading::Interlocked::Increment(&this->nextThread) % this->threads.Size();
+        this->threads[thread]->reads.Enqueue(reads[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AsyncFileReader::Finish(const AsyncRead& read, Stream::Size bytesRead)
+{
+    if (read.callback != nullptr)
+    {
+        read.callback(bytesRead);
+    }
+    if (read.counter != nullptr)
+    {
+        Jobs2::JobCounterDecrement(read.counter);
+    }
+}
+
+#if __linux__
+//------------------------------------------------------------------------------
+/**
+    Reads beyond QueueDepth wait in a queue, and are moved onto the ring as
+    the reads in flight complete.
+*/
+void
+AsyncFileReader::QueueWaitingReads()
+{
+    while (!this->waiting.IsEmpty() && !this->freeSlots.IsEmpty())
+    {
+        IndexT slot = this->freeSlots.PopBack();
+        this->inflight[slot].read = this->waiting.Dequeue();
+        this->inflight[slot].bytesRead = 0;
+        this->QueueChunk(slot);
+    }
+    this->ring.Submit();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AsyncFileReader::QueueChunk(IndexT slot)
+{
+    const InflightRead& entry = this->inflight[slot];
+    Stream::Size remaining = entry.read.size - entry.bytesRead;
+    Stream::Size chunk = remaining > RingMaxChunk ? RingMaxChunk : remaining;
+    bool queued = this->ring.PrepareRead(
+        fileno(entry.read.file),
+        entry.read.offset + entry.bytesRead,
+        (char*)entry.read.buffer + entry.bytesRead,
+        (uint)chunk,
+        slot);
+
+    // there are never more reads in flight than entries in the submission queue
+    n_assert(queued);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AsyncFileReader::ReapCompletions()
+{
+    this->ring.Wait();
+
+    uint64_t userData;
+    int result;
+    while (this->ring.PopCompletion(userData, result))
+    {
+        if (userData == RingWakeUp)
+        {
+            continue;
+        }
+
+        IndexT slot = (IndexT)userData;
+        InflightRead& entry = this->inflight[slot];
+        if (result > 0)
+        {
+            entry.bytesRead += result;
+        }
+
+        // continue short reads and reads which were interrupted
+        bool retry = result == -EINTR || result == -EAGAIN;
+        if (retry || (result > 0 && entry.bytesRead < entry.read.size))
+        {
+            this->ringLock.Enter();
+            this->QueueChunk(slot);
+            this->ring.Submit();
+            this->ringLock.Leave();
+            continue;
+        }
+
+        // the slot is free again as soon as the read is moved out of it
+        AsyncRead read = std::move(entry.read);
+        Stream::Size bytesRead = entry.bytesRead;
+        this->ringLock.Enter();
+        this->freeSlots.Append(slot);
+        this->QueueWaitingReads();
+        this->ringLock.Leave();
+
+        Finish(read, bytesRead);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+AsyncFileReader::IsRingIdle()
+{
+    this->ringLock.Enter();
+    bool idle = this->waiting.IsEmpty() && this->freeSlots.Size() == QueueDepth;
+    this->ringLock.Leave();
+    return idle;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AsyncFileReader::WakeUpRing()
+{
+    this->ringLock.Enter();
+    this->ring.PrepareNop(RingWakeUp);
+    this->ring.Submit();
+    this->ringLock.Leave();
+}
+#endif
+
+//------------------------------------------------------------------------------
+/**
+*/
+AsyncFileReaderThread::AsyncFileReaderThread() :
+    reader(nullptr),
+    reapsRing(false)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+AsyncFileReaderThread::~AsyncFileReaderThread()
+{
+    if (this->IsRunning())
+    {
+        this->Stop();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AsyncFileReaderThread::DoWork()
+{
+    Profiling::ProfilingRegisterThread();
+
+#if __linux__
+    if (this->reapsRing)
+    {
+        // keep reaping after a stop request until every submitted read is done
+        while (!(this->ThreadStopRequested() && this->reader->IsRingIdle()))
+        {
+            this->reader->ReapCompletions();
+        }
+        return;
+    }
+#endif
+
+    Util::Array<AsyncRead> batch;
+    batch.Reserve(64);
+    while (true)
+    {
+        this->reads.DequeueAll(batch);
+        for (IndexT i = 0; i < batch.Size(); i++)
+        {
+            const AsyncRead& read = batch[i];
+            Stream::Size bytesRead = FSWrapper::ReadAt(read.file, read.offset, read.buffer, read.size);
+            AsyncFileReader::Finish(read, bytesRead);
+        }
+        batch.Clear();
+
+        if (this->ThreadStopRequested() && this->reads.IsEmpty())
+        {
+            break;
+        }
+
+        // wait for more reads
+        this->reads.Wait();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AsyncFileReaderThread::EmitWakeupSignal()
+{
+#if __linux__
+    if (this->reapsRing)
+    {
+        this->reader->WakeUpRing();
+        return;
+    }
+#endif
+    this->reads.Signal();
+}
+
+} // namespace IO
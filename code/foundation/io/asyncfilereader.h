@@ -0,0 +1,168 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class IO::AsyncFileReader
+
+    Reads ranges of open files asynchronously. Any number of reads may be
+    submitted at once, each of them reports back through an optional callback
+    and an optional counter, which is decremented with JobCounterDecrement
+    once the read and its callback are done, so it can be waited on with
+    JobWait. Callbacks are run on the reader's threads, so they
+    should be short and hand the actual work off to another thread.
+
+    On Linux the reads are queued on an io_uring, which keeps up to QueueDepth
+    reads in flight in the kernel while a single thread reaps the completions.
+    On other platforms, or if io_uring is not available, the reads are spread
+    over a small pool of threads doing blocking reads.
+
+    This is a true singleton, it is created by the IoServer which submits
+    the first asynchronous read and shared by all threads.
+
+    @copyright
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "core/refcounted.h"
+#include "core/singleton.h"
+#include "io/stream.h"
+#include "io/fswrapper.h"
+#include "threading/thread.h"
+#include "threading/safequeue.h"
+#include "threading/criticalsection.h"
+#include "threading/interlocked.h"
+#include "util/fixedarray.h"
+#include "util/queue.h"
+#include <functional>
+#if __linux__
+#include "io/posix/linuxiouring.h"
+#endif
+
+//------------------------------------------------------------------------------
+namespace IO
+{
+
+struct AsyncRead
+{
+    FSWrapper::Handle file = nullptr;
+    Stream::Offset offset = 0;
+    Stream::Size size = 0;
+    void* buffer = nullptr;
+
+    /// called with the number of bytes read, which is less than size if the read failed
+    std::function<void(Stream::Size bytesRead)> callback;
+    /// decremented after the callback has been run
+    Threading::AtomicCounter* counter = nullptr;
+};
+
+class AsyncFileReaderThread;
+class AsyncFileReader : public Core::RefCounted
+{
+    __DeclareClass(AsyncFileReader);
+    __DeclareInterfaceSingleton(AsyncFileReader);
+public:
+    /// constructor
+    AsyncFileReader();
+    /// destructor
+    virtual ~AsyncFileReader();
+
+    /// setup the reader and start its threads
+    void Setup();
+    /// wait for outstanding reads and stop the threads
+    void Discard();
+    /// return true if the reader has been setup
+    bool IsValid() const;
+    /// return true if reads are queued on an io_uring
+    bool IsUsingIoUring() const;
+
+    /// submit a single read
+    void Read(const AsyncRead& read);
+    /// submit a batch of reads
+    void Read(const AsyncRead* reads, SizeT numReads);
+
+    /// number of reads kept in flight on the io_uring
+    static const SizeT QueueDepth = 128;
+    /// number of threads used when reads are done with blocking calls
+    static const SizeT NumWorkerThreads = 4;
+
+private:
+    friend class AsyncFileReaderThread;
+
+    /// run the callback of a finished read and decrement its counter
+    static void Finish(const AsyncRead& read, Stream::Size bytesRead);
+
+#if __linux__
+    /// move waiting reads into free slots and submit them, ringLock must be held
+    void QueueWaitingReads();
+    /// queue the next chunk of the read in a slot, ringLock must be held
+    void QueueChunk(IndexT slot);
+    /// wait for completions and finish or continue their reads
+    void ReapCompletions();
+    /// return true if no reads are waiting or in flight
+    bool IsRingIdle();
+    /// wake up the thread reaping completions
+    void WakeUpRing();
+
+    struct InflightRead
+    {
+        AsyncRead read;
+        Stream::Size bytesRead;
+    };
+
+    IoUring ring;
+    Threading::CriticalSection ringLock;
+    Util::FixedArray<InflightRead> inflight;
+    Util::Array<IndexT> freeSlots;
+    Util::Queue<AsyncRead> waiting;
+#endif
+
+    Util::FixedArray<Ptr<AsyncFileReaderThread>> threads;
+    Threading::AtomicCounter nextThread;
+    bool isValid;
+};
+
+//------------------------------------------------------------------------------
+/**
+    Runs the blocking reads of the fallback path, or reaps the completions of
+    the io_uring.
+*/
+class AsyncFileReaderThread : public Threading::Thread
+{
+    __DeclareClass(AsyncFileReaderThread);
+public:
+    /// constructor
+    AsyncFileReaderThread();
+    /// destructor
+    virtual ~AsyncFileReaderThread();
+
+private:
+    friend class AsyncFileReader;
+
+    /// perform work
+    void DoWork() override;
+    /// emit wakeup signal
+    void EmitWakeupSignal() override;
+
+    AsyncFileReader* reader;
+    bool reapsRing;
+    Threading::SafeQueue<AsyncRead> reads;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+AsyncFileReader::IsValid() const
+{
+    return this->isValid;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+AsyncFileReader::Read(const AsyncRead& read)
+{
+    this->Read(&read, 1);
+}
+
+} // namespace IO
+//------------------------------------------------------------------------------
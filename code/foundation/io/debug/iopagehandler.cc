@@ -92,7 +92,7 @@ IoPageHandler::HandleRequest(const Ptr<HttpRequest>& request)
 
         // display mounted archives
         htmlWriter->Element(HtmlElement::Heading3, "Mounted Archives");
-        Array<Ptr<Archive> > archives = ArchiveFileSystem::Instance()->GetMountedArchives();
+        Array<Ptr<ArchiveBase> > archives = ArchiveFileSystem::Instance()->GetMountedArchives();
         if (archives.Size() > 0)
         {
             htmlWriter->Begin(HtmlElement::UnorderedList);
@@ -15,6 +15,9 @@
 #include "io/archfs/archivefilesystem.h"
 #include "io/filewatcher.h"
 #include "io/filestream.h"
+#include "io/memorystream.h"
+#include "io/asyncfilereader.h"
+#include "jobs2/jobs2.h"
 #include <filesystem>
 #include "http/httpclientregistry.h"
 
@@ -28,6 +31,7 @@ Threading::CriticalSection IoServer::assignCriticalSection;
 Threading::CriticalSection IoServer::schemeCriticalSection;
 Threading::CriticalSection IoServer::archiveCriticalSection;
 Threading::CriticalSection IoServer::watcherCriticalSection;
+Threading::CriticalSection IoServer::asyncReaderCriticalSection;
 bool IoServer::StandardArchivesMounted = false;
 
 using namespace Core;
@@ -110,6 +114,9 @@ IoServer::~IoServer()
     this->httpClientRegistry = nullptr;
 
     this->watcher = nullptr;
+    this->asyncReaderCriticalSection.Enter();
+    this->asyncFileReader = nullptr;
+    this->asyncReaderCriticalSection.Leave();
     // unmount standard archives if this is the last instance
     if (StandardArchivesMounted && (this->archiveFileSystem->GetRefCount() == 1))
     {
@@ -167,7 +174,7 @@ IoServer::CreateStream(const URI& uri) const
 bool
 IoServer::MountArchive(const URI& uri)
 {
-    Ptr<Archive> archive = this->archiveFileSystem->Mount(uri);
+    Ptr<ArchiveBase> archive = this->archiveFileSystem->Mount(uri);
     return archive.isvalid();
 }
 
@@ -177,7 +184,7 @@ IoServer::MountArchive(const URI& uri)
 bool
 IoServer::MountEmbeddedArchive(const URI& uri)
 {
-    Ptr<Archive> archive = this->archiveFileSystem->MountEmbedded(uri, "root:");
+    Ptr<ArchiveBase> archive = this->archiveFileSystem->MountEmbedded(uri, "root:");
     return archive.isvalid();
 }
 
@@ -429,7 +436,7 @@ IoServer::FileExists(const URI& uri) const
     // transparent archive support
     if (this->IsArchiveFileSystemEnabled())
     {
-        Ptr<Archive> archive = ArchiveFileSystem::Instance()->FindArchiveWithFile(uri);
+        Ptr<ArchiveBase> archive = ArchiveFileSystem::Instance()->FindArchiveWithFile(uri);
         if (archive.isvalid())
         {
             return true;
@@ -453,7 +460,7 @@ IoServer::DirectoryExists(const URI& uri) const
     {
         if (uri.Scheme() == "file")
         {
-            Ptr<Archive> archive = ArchiveFileSystem::Instance()->FindArchiveWithDir(uri);
+            Ptr<ArchiveBase> archive = ArchiveFileSystem::Instance()->FindArchiveWithDir(uri);
             if (archive.isvalid())
             {
                 return true;
@@ -560,7 +567,7 @@ IoServer::ListFiles(const URI& uri, const String& pattern, bool asFullPath) cons
     // transparent archive file system support
     if (this->IsArchiveFileSystemEnabled())
     {
-        Ptr<Archive> archive = ArchiveFileSystem::Instance()->FindArchiveWithDir(uri);
+        Ptr<ArchiveBase> archive = ArchiveFileSystem::Instance()->FindArchiveWithDir(uri);
         if (archive.isvalid())
         {
             String pathInArchive = archive->ConvertToPathInArchive(uri.LocalPath());
@@ -598,7 +605,7 @@ IoServer::ListDirectories(const URI& uri, const String& pattern, bool asFullPath
     // transparent archive file system support
     if (this->IsArchiveFileSystemEnabled() && prioritizeArchive)
     {
-        Ptr<Archive> archive = ArchiveFileSystem::Instance()->FindArchiveWithDir(uri);
+        Ptr<ArchiveBase> archive = ArchiveFileSystem::Instance()->FindArchiveWithDir(uri);
         if (archive.isvalid())
         {
             String pathInArchive = archive->ConvertToPathInArchive(uri.LocalPath());
@@ -669,6 +676,109 @@ IoServer::ReadFile(const URI& path, Util::String& contents)
     return false;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+void
+IoServer::ReadAsync(const AsyncRead* reads, SizeT numReads) const
+{
+    this->GetAsyncFileReader()->Read(reads, numReads);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Reads the file into a memory stream which is handed to the callback, or
+    a null pointer if the read failed. The callback is run on one of the
+    async file reader's threads. If a counter is given, it is decremented
+    through the job system after the callback, so jobs and threads can
+    JobWait on it.
+
+    Only plain files are read asynchronously. Files in archives or behind
+    other schemes get a regular stream from CreateStream(), which is handed
+    to the callback right away.
+*/
+void
+IoServer::ReadFileAsync(const URI& uri, const std::function<void(const Ptr<Stream>& stream)>& callback, Threading::AtomicCounter* counter) const
+{
+    n_assert(!uri.IsEmpty());
+    n_assert(callback != nullptr);
+
+    bool plainFile = this->schemeRegistry->GetStreamClassByUriScheme(uri.Scheme()) == FileStream::RTTI;
+#if PUBLIC_BUILD
+    // archives have precedence over loose files in public builds
+    plainFile = plainFile && !(this->IsArchiveFileSystemEnabled() && ArchiveFileSystem::Instance()->FindArchiveWithFile(uri).isvalid());
+#endif
+    if (plainFile)
+    {
+        FSWrapper::Handle handle = FSWrapper::OpenFile(uri.GetHostAndLocalPath(), Stream::ReadAccess, Stream::Sequential);
+        if (handle != nullptr)
+        {
+            Stream::Size size = FSWrapper::GetFileSize(handle);
+            if (size > 0)
+            {
+                Ptr<MemoryStream> stream = MemoryStream::Create();
+                stream->SetURI(uri);
+                stream->SetSize(size);
+
+                AsyncRead read;
+                read.file = handle;
+                read.offset = 0;
+                read.size = size;
+                read.buffer = stream->GetRawPointer();
+                read.counter = counter;
+                read.callback = [handle, stream, size, callback](Stream::Size bytesRead)
+                {
+                    FSWrapper::CloseFile(handle);
+                    if (bytesRead == size)
+                    {
+                        callback(stream.upcast<Stream>());
+                    }
+                    else
+                    {
+                        n_warning("IoServer::ReadFileAsync(): failed to read '%s'\n", stream->GetURI().LocalPath().AsCharPtr());
+                        callback(nullptr);
+                    }
+                };
+                this->GetAsyncFileReader()->Read(read);
+                return;
+            }
+            FSWrapper::CloseFile(handle);
+        }
+    }
+
+    // fallthrough: let the caller open the file as usual
+    callback(this->CreateStream(uri));
+    if (counter != nullptr)
+    {
+        Jobs2::JobCounterDecrement(counter);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    The async file reader and its threads are only started once the first
+    asynchronous read is submitted, applications which never read
+    asynchronously don't pay for them.
+*/
+AsyncFileReader*
+IoServer::GetAsyncFileReader() const
+{
+    if (!this->asyncFileReader.isvalid())
+    {
+        Threading::CriticalScope scope(&asyncReaderCriticalSection);
+        if (!AsyncFileReader::HasInstance())
+        {
+            this->asyncFileReader = AsyncFileReader::Create();
+            this->asyncFileReader->Setup();
+        }
+        else
+        {
+            this->asyncFileReader = AsyncFileReader::Instance();
+        }
+    }
+    return this->asyncFileReader;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -717,7 +827,7 @@ IoServer::GetIOInfo(const URI& uri, IOStat& outInfo, bool prioritizeArchive) con
     // transparent archive support
     if (this->IsArchiveFileSystemEnabled() && prioritizeArchive)
     {
-        Ptr<Archive> archive = ArchiveFileSystem::Instance()->FindArchiveWithFile(uri);
+        Ptr<ArchiveBase> archive = ArchiveFileSystem::Instance()->FindArchiveWithFile(uri);
         if (archive.isvalid())
         {
             String pathInArchive = archive->ConvertToPathInArchive(uri.LocalPath());
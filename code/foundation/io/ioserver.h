@@ -11,6 +11,7 @@
     * transparant (ZIP) archive support
     * path assign management
     * global filesystem manipulation and query methods
+    * asynchronous file reads through the AsyncFileReader
     
     @copyright
     (C) 2006 Radon Labs GmbH
@@ -24,6 +25,8 @@
 #include "io/schemeregistry.h"
 #include "archfs/archivefilesystem.h"
 #include "io/cache/streamcache.h"
+#include "threading/interlocked.h"
+#include <functional>
 
 namespace Http
 {
@@ -38,6 +41,8 @@ class FileWatcher;
 class Stream;
 class URI;
 class AssignRegistry;
+class AsyncFileReader;
+struct AsyncRead;
 
 class IoServer : public Core::RefCounted
 {
@@ -100,6 +105,11 @@ public:
     /// return native path
     static Util::String NativePath(const Util::String& path);
 
+    /// submit reads of open files to the async file reader
+    void ReadAsync(const AsyncRead* reads, SizeT numReads) const;
+    /// read a whole file into a memory stream asynchronously, the callback is run on an io thread
+    void ReadFileAsync(const URI& path, const std::function<void(const Ptr<Stream>& stream)>& callback, Threading::AtomicCounter* counter = nullptr) const;
+
     /// get file/folder information (size, access time, modified time, creation time) via stat calls
     bool GetIOInfo(const URI& uri, IOStat& outInfo, bool prioritizeArchive) const;
 
@@ -118,6 +128,8 @@ public:
 private:
     /// helper function to add path prefix to file or dir names in array
     Util::Array<Util::String> AddPathPrefixToArray(const Util::String& prefix, const Util::Array<Util::String>& filenames) const;
+    /// get the global async file reader, it is created on first use
+    AsyncFileReader* GetAsyncFileReader() const;
 
     bool archiveFileSystemEnabled;    
     Ptr<ArchiveFileSystem> archiveFileSystem;
@@ -129,9 +141,11 @@ private:
     Ptr<SchemeRegistry> schemeRegistry;
     Ptr<FileWatcher> watcher;
     Ptr<StreamCache> streamCache;
+    mutable Ptr<AsyncFileReader> asyncFileReader;
     static Threading::CriticalSection assignCriticalSection;
     static Threading::CriticalSection schemeCriticalSection;
     static Threading::CriticalSection watcherCriticalSection;
+    static Threading::CriticalSection asyncReaderCriticalSection;
 };
 
 //------------------------------------------------------------------------------
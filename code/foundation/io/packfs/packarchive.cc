@@ -0,0 +1,427 @@
+//------------------------------------------------------------------------------
+//  packarchive.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "io/packfs/packarchive.h"
+#include "io/assignregistry.h"
+#include "zlib/zlib.h"
+
+namespace IO
+{
+__ImplementClass(IO::PackArchive, 'PKAR', IO::ArchiveBase);
+
+using namespace Util;
+
+//------------------------------------------------------------------------------
+/**
+*/
+PackArchive::PackArchive() :
+    fileHandle(0),
+    mapHandle(0),
+    mapping(nullptr),
+    mappingSize(0),
+    header(nullptr),
+    files(nullptr),
+    blocks(nullptr),
+    dirs(nullptr),
+    listEntries(nullptr),
+    strings(nullptr)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+PackArchive::~PackArchive()
+{
+    if (this->IsValid())
+    {
+        this->Discard();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Pack files are only mounted from the local file system, since they are
+    mapped into memory.
+*/
+bool
+PackArchive::Exists(const URI& uri)
+{
+    URI absPath = AssignRegistry::Instance()->ResolveAssigns(uri);
+    if (absPath.Scheme() != "file")
+    {
+        return false;
+    }
+    return FSWrapper::FileExists(absPath.GetHostAndLocalPath() + ".npk");
+}
+
+//------------------------------------------------------------------------------
+/**
+    Maps the pack file into memory and sets up pointers into the table of
+    contents, nothing else is read at this point.
+*/
+bool
+PackArchive::Setup(const URI& packFileURI, const String& rootPathOverride)
+{
+    n_assert(!this->IsValid());
+    n_assert(0 == this->mapping);
+
+    URI absPath = AssignRegistry::Instance()->ResolveAssigns(packFileURI);
+    String nativePath = absPath.GetHostAndLocalPath() + ".npk";
+    this->fileHandle = FSWrapper::OpenFile(nativePath, Stream::ReadAccess, Stream::Random);
+    if (0 == this->fileHandle)
+    {
+        return false;
+    }
+    this->mappingSize = FSWrapper::GetFileSize(this->fileHandle);
+    if (this->mappingSize < (Stream::Size)sizeof(PackHeader))
+    {
+        n_warning("PackArchive: '%s' is not a pack file!\n", nativePath.AsCharPtr());
+        FSWrapper::CloseFile(this->fileHandle);
+        this->fileHandle = 0;
+        return false;
+    }
+    this->mapping = FSWrapper::Map(this->fileHandle, Stream::ReadAccess, this->mapHandle);
+    n_assert(0 != this->mapping);
+
+    // the table of contents is used in place
+    this->header = (const PackHeader*)this->mapping;
+    if (!this->ValidateTableOfContents())
+    {
+        n_warning("PackArchive: '%s' is not a valid pack file!\n", nativePath.AsCharPtr());
+        FSWrapper::Unmap(this->mapHandle, (char*)this->mapping);
+        FSWrapper::CloseFile(this->fileHandle);
+        this->mapping = nullptr;
+        this->mapHandle = 0;
+        this->fileHandle = 0;
+        return false;
+    }
+    this->writeTime = FSWrapper::GetFileWriteTime(nativePath);
+
+    ArchiveBase::Setup(packFileURI, rootPathOverride);
+    if (!rootPathOverride.IsEmpty())
+    {
+        this->rootPath = AssignRegistry::Instance()->ResolveAssigns(rootPathOverride).LocalPath() + "/";
+    }
+    else
+    {
+        this->rootPath = this->uri.LocalPath().ExtractDirName();
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+PackArchive::Discard()
+{
+    n_assert(this->IsValid());
+    FSWrapper::Unmap(this->mapHandle, (char*)this->mapping);
+    FSWrapper::CloseFile(this->fileHandle);
+    this->mapping = nullptr;
+    this->mapHandle = 0;
+    this->fileHandle = 0;
+    this->header = nullptr;
+    this->files = nullptr;
+    this->blocks = nullptr;
+    this->dirs = nullptr;
+    this->listEntries = nullptr;
+    this->strings = nullptr;
+    ArchiveBase::Discard();
+}
+
+//------------------------------------------------------------------------------
+/**
+    Only checks that the tables fit into the file, the entries themselves
+    are checked when they are used. Sets up the pointers to the tables.
+*/
+bool
+PackArchive::ValidateTableOfContents()
+{
+    if (this->header->magic != PackMagic || this->header->version != PackVersion)
+    {
+        return false;
+    }
+    if (this->header->blockSize != PackBlockSize || this->header->numDirs == 0)
+    {
+        return false;
+    }
+    uint64_t tocSize = (uint64_t)this->header->numFiles * sizeof(PackFileEntry)
+        + (uint64_t)this->header->numBlocks * sizeof(PackBlock)
+        + (uint64_t)this->header->numDirs * sizeof(PackDirEntry)
+        + (uint64_t)this->header->numListEntries * sizeof(uint)
+        + this->header->stringsSize;
+    if ((this->header->tocOffset & 7) != 0 || this->header->tocOffset + tocSize > (uint64_t)this->mappingSize)
+    {
+        return false;
+    }
+
+    this->files = (const PackFileEntry*)(this->mapping + this->header->tocOffset);
+    this->blocks = (const PackBlock*)(this->files + this->header->numFiles);
+    this->dirs = (const PackDirEntry*)(this->blocks + this->header->numBlocks);
+    this->listEntries = (const uint*)(this->dirs + this->header->numDirs);
+    this->strings = (const char*)(this->listEntries + this->header->numListEntries);
+
+    // all strings are null terminated
+    return this->header->stringsSize > 0 && this->strings[this->header->stringsSize - 1] == 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+String
+PackArchive::NormalizePath(const String& path)
+{
+    String result = path;
+    result.ConvertBackslashes();
+    result.Trim("/");
+    return result;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Entries are sorted by path hash first, and by path if hashes collide.
+*/
+template<class ENTRY> IndexT
+PackArchive::FindEntry(const ENTRY* entries, SizeT numEntries, const String& path) const
+{
+    uint hash = String::Hash(path.AsCharPtr(), path.Length());
+    IndexT first = 0;
+    IndexT last = numEntries;
+    while (first < last)
+    {
+        IndexT mid = (first + last) / 2;
+        const ENTRY& entry = entries[mid];
+        int cmp;
+        if (entry.pathHash != hash)
+        {
+            cmp = entry.pathHash < hash ? -1 : 1;
+        }
+        else
+        {
+            cmp = strcmp(this->GetString(entry.pathOffset), path.AsCharPtr());
+        }
+
+        if (cmp == 0)
+        {
+            return mid;
+        }
+        else if (cmp < 0)
+        {
+            first = mid + 1;
+        }
+        else
+        {
+            last = mid;
+        }
+    }
+    return InvalidIndex;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+IndexT
+PackArchive::FindFile(const String& pathInArchive) const
+{
+    n_assert(this->IsValid());
+    return this->FindEntry(this->files, this->header->numFiles, NormalizePath(pathInArchive));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+IndexT
+PackArchive::FindDirectory(const String& pathInArchive) const
+{
+    n_assert(this->IsValid());
+    return this->FindEntry(this->dirs, this->header->numDirs, NormalizePath(pathInArchive));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+PackArchive::HasFile(const String& pathInArchive) const
+{
+    return InvalidIndex != this->FindFile(pathInArchive);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+PackArchive::HasDirectory(const String& pathInArchive) const
+{
+    return InvalidIndex != this->FindDirectory(pathInArchive);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Array<String>
+PackArchive::ListFiles(const String& dirPathInArchive, const String& pattern) const
+{
+    Array<String> result;
+    IndexT dirIndex = this->FindDirectory(dirPathInArchive);
+    if (InvalidIndex != dirIndex)
+    {
+        const PackDirEntry& dir = this->dirs[dirIndex];
+        n_assert(dir.firstListEntry + dir.numFiles + dir.numDirs <= this->header->numListEntries);
+        const uint* fileIndices = this->listEntries + dir.firstListEntry;
+        String fileName;
+        uint i;
+        for (i = 0; i < dir.numFiles; i++)
+        {
+            fileName = this->GetString(this->files[fileIndices[i]].nameOffset);
+            if (String::MatchPattern(fileName, pattern))
+            {
+                result.Append(fileName);
+            }
+        }
+    }
+    return result;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Array<String>
+PackArchive::ListDirectories(const String& dirPathInArchive, const String& pattern) const
+{
+    Array<String> result;
+    IndexT dirIndex = this->FindDirectory(dirPathInArchive);
+    if (InvalidIndex != dirIndex)
+    {
+        const PackDirEntry& dir = this->dirs[dirIndex];
+        n_assert(dir.firstListEntry + dir.numFiles + dir.numDirs <= this->header->numListEntries);
+        const uint* dirIndices = this->listEntries + dir.firstListEntry + dir.numFiles;
+        String subDirName;
+        uint i;
+        for (i = 0; i < dir.numDirs; i++)
+        {
+            subDirName = this->GetString(this->dirs[dirIndices[i]].nameOffset);
+            if (String::MatchPattern(subDirName, pattern))
+            {
+                result.Append(subDirName);
+            }
+        }
+    }
+    return result;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Test if an absolute path points into the pack file and return the
+    local path inside it. Like with zip archives, this only checks the
+    location of the pack file, not whether the path exists in it.
+*/
+String
+PackArchive::ConvertToPathInArchive(const String& absPath) const
+{
+    if (absPath.BeginsWithString(this->rootPath))
+    {
+        return absPath.ExtractToEnd(this->rootPath.Length());
+    }
+    // path doesn't point into this archive
+    return "";
+}
+
+//------------------------------------------------------------------------------
+/**
+    Converts a "file:" URI into a "pak:" URI, which is opened by the
+    PackFileStream.
+*/
+URI
+PackArchive::ConvertToArchiveURI(const URI& fileURI) const
+{
+    n_assert(fileURI.LocalPath().IsValid());
+
+    // localize path into archive, fail hard if URI doesn't point into archive
+    String localPath = this->ConvertToPathInArchive(fileURI.LocalPath());
+    if (!localPath.IsValid())
+    {
+        n_error("PackArchive::ConvertToArchiveURI(): file '%s' doesn't point into this pack file (%s)!\n",
+            fileURI.AsString().AsCharPtr(), this->uri.AsString().AsCharPtr());
+    }
+
+    URI packURI = this->uri;
+    packURI.SetScheme("pak");
+    String query;
+    query.Append("file=");
+    query.Append(localPath);
+    packURI.SetQuery(query);
+    return packURI;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+PackArchive::GetIOInfo(const URI& path, IOStat& outInfo)
+{
+    IndexT file = this->FindFile(path.LocalPath());
+    if (InvalidIndex != file)
+    {
+        outInfo.size = this->files[file].size;
+        outInfo.accessTime = this->writeTime;
+        outInfo.modifiedTime = this->writeTime;
+        outInfo.creationTime = this->writeTime;
+        return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Blocks are independent of each other, so this may be called for any
+    block in any order, and from several threads at once.
+*/
+Stream::Size
+PackArchive::ReadBlock(IndexT file, IndexT block, void* buf) const
+{
+    n_assert(file >= 0 && file < (IndexT)this->header->numFiles);
+    const PackFileEntry& entry = this->files[file];
+    n_assert(0 != (entry.flags & PackFileCompressed));
+    n_assert(block >= 0 && block < (IndexT)entry.numBlocks);
+
+    uint blockIndex = entry.firstBlock + block;
+    if (blockIndex >= this->header->numBlocks)
+    {
+        n_warning("PackArchive: block %d of '%s' is out of range!\n", block, this->GetString(entry.pathOffset));
+        return 0;
+    }
+    // the caller's buffer holds exactly the part of the file covered by the block
+    const PackBlock& packBlock = this->blocks[blockIndex];
+    const uint64_t blockStart = (uint64_t)block * PackBlockSize;
+    if (blockStart >= entry.size
+        || packBlock.size != Math::min((uint64_t)PackBlockSize, entry.size - blockStart)
+        || packBlock.offset + packBlock.compressedSize > (uint64_t)this->mappingSize)
+    {
+        n_warning("PackArchive: block %d of '%s' is out of range!\n", block, this->GetString(entry.pathOffset));
+        return 0;
+    }
+
+    // blocks which didn't compress are stored as is
+    const char* src = this->mapping + packBlock.offset;
+    if (packBlock.compressedSize == packBlock.size)
+    {
+        Memory::Copy(src, buf, packBlock.size);
+        return packBlock.size;
+    }
+
+    uLongf size = packBlock.size;
+    int res = uncompress((Bytef*)buf, &size, (const Bytef*)src, packBlock.compressedSize);
+    if (Z_OK != res || size != packBlock.size)
+    {
+        n_warning("PackArchive: failed to decompress block %d of '%s'!\n", block, this->GetString(entry.pathOffset));
+        return 0;
+    }
+    return packBlock.size;
+}
+
+} // namespace IO
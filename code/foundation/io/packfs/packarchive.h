@@ -0,0 +1,145 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class IO::PackArchive
+
+    A mounted Nebula pack file (.npk), see io/packfs/packformat.h for the
+    layout. The whole pack file is mapped into memory when the archive is
+    set up, the table of contents is used in place, so mounting doesn't
+    parse or allocate anything per file. Files and directories are looked
+    up with a binary search over their path hashes.
+
+    Files stored uncompressed are handed out as pointers into the mapping,
+    compressed files are decompressed block by block on demand.
+
+    Multithreading: the archive is immutable after Setup(), all methods
+    may be called from any thread.
+
+    @copyright
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "io/archfs/archivebase.h"
+#include "io/packfs/packformat.h"
+#include "io/fswrapper.h"
+#include "io/stream.h"
+
+//------------------------------------------------------------------------------
+namespace IO
+{
+class PackArchive : public ArchiveBase
+{
+    __DeclareClass(PackArchive);
+public:
+    /// constructor
+    PackArchive();
+    /// destructor
+    virtual ~PackArchive();
+
+    /// return true if there is a pack file for an archive URI (without file extension)
+    static bool Exists(const URI& uri);
+
+    /// setup the archive from an URI (without file extension)
+    bool Setup(const URI& uri, const Util::String& rootPath = "") override;
+    /// discard the archive
+    void Discard() override;
+
+    /// list all files in a directory in the archive
+    Util::Array<Util::String> ListFiles(const Util::String& dirPathInArchive, const Util::String& pattern) const override;
+    /// list all subdirectories in a directory in the archive
+    Util::Array<Util::String> ListDirectories(const Util::String& dirPathInArchive, const Util::String& pattern) const override;
+    /// convert a "file:" URI into a "pak:" URI pointing into this archive
+    URI ConvertToArchiveURI(const URI& fileURI) const override;
+    /// convert an absolute path to local path inside archive, returns empty string if absPath doesn't point into this archive
+    Util::String ConvertToPathInArchive(const Util::String& absPath) const override;
+    /// return true if the archive contains a file
+    bool HasFile(const Util::String& pathInArchive) const override;
+    /// return true if the archive contains a directory
+    bool HasDirectory(const Util::String& pathInArchive) const override;
+    /// get size and time stamps of a file in the archive
+    bool GetIOInfo(const URI& pathInArchive, IOStat& outInfo) override;
+
+    /// find a file, returns InvalidIndex if the archive doesn't contain it
+    IndexT FindFile(const Util::String& pathInArchive) const;
+    /// get the uncompressed size of a file
+    Stream::Size GetFileSize(IndexT file) const;
+    /// get the data of a file stored uncompressed, returns nullptr for compressed files
+    const void* GetRawData(IndexT file) const;
+    /// get the number of blocks of a compressed file
+    SizeT GetNumBlocks(IndexT file) const;
+    /// decompress a block of a compressed file, returns the block size, which is PackBlockSize except for the last block
+    Stream::Size ReadBlock(IndexT file, IndexT block, void* buf) const;
+
+private:
+    /// check the header and table of contents against the size of the mapping
+    bool ValidateTableOfContents();
+    /// strip slashes and convert backslashes, so the path can be hashed
+    static Util::String NormalizePath(const Util::String& path);
+    /// binary search an entry by path hash and path
+    template<class ENTRY> IndexT FindEntry(const ENTRY* entries, SizeT numEntries, const Util::String& path) const;
+    /// find a directory, returns InvalidIndex if the archive doesn't contain it
+    IndexT FindDirectory(const Util::String& pathInArchive) const;
+    /// get a string from the string table
+    const char* GetString(uint offset) const;
+
+    Util::String rootPath;              // location of the pack file
+    FSWrapper::Handle fileHandle;
+    FSWrapper::Handle mapHandle;
+    const char* mapping;                // the whole pack file
+    Stream::Size mappingSize;
+    FileTime writeTime;                 // write time of the pack file, used for all files in it
+
+    const PackHeader* header;
+    const PackFileEntry* files;
+    const PackBlock* blocks;
+    const PackDirEntry* dirs;
+    const uint* listEntries;
+    const char* strings;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline Stream::Size
+PackArchive::GetFileSize(IndexT file) const
+{
+    n_assert(file >= 0 && file < (IndexT)this->header->numFiles);
+    return (Stream::Size)this->files[file].size;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline const void*
+PackArchive::GetRawData(IndexT file) const
+{
+    n_assert(file >= 0 && file < (IndexT)this->header->numFiles);
+    const PackFileEntry& entry = this->files[file];
+    if (entry.flags & PackFileCompressed)
+    {
+        return nullptr;
+    }
+    n_assert(entry.offset + entry.size <= (uint64_t)this->mappingSize);
+    return this->mapping + entry.offset;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+PackArchive::GetNumBlocks(IndexT file) const
+{
+    n_assert(file >= 0 && file < (IndexT)this->header->numFiles);
+    return this->files[file].numBlocks;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline const char*
+PackArchive::GetString(uint offset) const
+{
+    return this->strings + offset;
+}
+
+} // namespace IO
+//------------------------------------------------------------------------------
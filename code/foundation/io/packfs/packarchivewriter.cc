@@ -0,0 +1,349 @@
+//------------------------------------------------------------------------------
+//  packarchivewriter.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "io/packfs/packarchivewriter.h"
+#include "io/ioserver.h"
+#include "util/dictionary.h"
+#include "util/fixedarray.h"
+#include "zlib/zlib.h"
+
+namespace IO
+{
+__ImplementClass(IO::PackArchiveWriter, 'PKWR', Core::RefCounted);
+
+using namespace Util;
+
+//------------------------------------------------------------------------------
+/**
+*/
+static String
+ParentPath(const String& path)
+{
+    IndexT lastSlash = path.FindCharIndexReverse('/', 0);
+    if (InvalidIndex == lastSlash)
+    {
+        return "";
+    }
+    return path.ExtractRange(0, lastSlash);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static uint
+NameIndex(const String& path)
+{
+    IndexT lastSlash = path.FindCharIndexReverse('/', 0);
+    return InvalidIndex == lastSlash ? 0 : uint(lastSlash + 1);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+PackArchiveWriter::PackArchiveWriter() :
+    compressionLevel(9)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+PackArchiveWriter::~PackArchiveWriter()
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+PackArchiveWriter::AddFile(const String& pathInArchive, const URI& srcFile, bool compress)
+{
+    SourceFile file;
+    file.path = pathInArchive;
+    file.path.ConvertBackslashes();
+    file.path.Trim("/");
+    n_assert(file.path.IsValid());
+    file.pathHash = String::Hash(file.path.AsCharPtr(), file.path.Length());
+    file.srcFile = srcFile;
+    file.compress = compress;
+    this->files.Append(file);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+PackArchiveWriter::Clear()
+{
+    this->files.Clear();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class ENTRY> bool
+PackArchiveWriter::LessThan(const ENTRY& lhs, const ENTRY& rhs)
+{
+    if (lhs.pathHash != rhs.pathHash)
+    {
+        return lhs.pathHash < rhs.pathHash;
+    }
+    return strcmp(lhs.path.AsCharPtr(), rhs.path.AsCharPtr()) < 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+uint
+PackArchiveWriter::AddString(Array<char>& strings, const String& str)
+{
+    uint offset = strings.Size();
+    strings.AppendArray(str.AsCharPtr(), str.Length());
+    strings.Append(0);
+    return offset;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+PackArchiveWriter::Pad(const Ptr<Stream>& stream, Stream::Size alignment)
+{
+    static const char zeros[PackRawAlignment] = { 0 };
+    n_assert(alignment <= PackRawAlignment);
+    Stream::Size padding = (alignment - stream->GetPosition() % alignment) % alignment;
+    if (padding > 0)
+    {
+        stream->Write(zeros, padding);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Compresses the file block by block, and only keeps the compressed
+    blocks if the whole file shrinks by at least an eighth. Blocks which
+    don't shrink are stored as is.
+*/
+bool
+PackArchiveWriter::WriteFileData(const Ptr<Stream>& stream, const SourceFile& src, PackFileEntry& entry, Array<PackBlock>& blocks)
+{
+    Ptr<Stream> srcStream = IoServer::Instance()->CreateStream(src.srcFile);
+    srcStream->SetAccessMode(Stream::ReadAccess);
+    if (!srcStream->Open())
+    {
+        n_warning("PackArchiveWriter: failed to open '%s'!\n", src.srcFile.AsString().AsCharPtr());
+        return false;
+    }
+    Stream::Size size = srcStream->GetSize();
+    const unsigned char* data = size > 0 ? (const unsigned char*)srcStream->Map() : nullptr;
+    entry.flags = 0;
+    entry.offset = 0;
+    entry.size = size;
+    entry.firstBlock = 0;
+    entry.numBlocks = 0;
+
+    bool compressed = false;
+    if (size > 0 && src.compress && this->compressionLevel > 0)
+    {
+        uint numBlocks = uint((size + PackBlockSize - 1) / PackBlockSize);
+        uLong maxBlockSize = compressBound(PackBlockSize);
+        FixedArray<unsigned char> buffer((SizeT)(numBlocks * maxBlockSize));
+        FixedArray<PackBlock> fileBlocks(numBlocks);
+        Stream::Size compressedSize = 0;
+        uint i;
+        for (i = 0; i < numBlocks; i++)
+        {
+            Stream::Size blockStart = (Stream::Size)i * PackBlockSize;
+            uint blockSize = (uint)Math::min((Stream::Size)PackBlockSize, size - blockStart);
+            unsigned char* dst = buffer.Begin() + (Stream::Size)i * maxBlockSize;
+            uLongf dstSize = maxBlockSize;
+            int res = compress2(dst, &dstSize, data + blockStart, blockSize, this->compressionLevel);
+            n_assert(Z_OK == res);
+            if (dstSize >= blockSize)
+            {
+                // store blocks which don't compress as is
+                Memory::Copy(data + blockStart, dst, blockSize);
+                dstSize = blockSize;
+            }
+            fileBlocks[i].compressedSize = (uint)dstSize;
+            fileBlocks[i].size = blockSize;
+            compressedSize += dstSize;
+        }
+
+        if (compressedSize < size - size / 8)
+        {
+            entry.flags = PackFileCompressed;
+            entry.firstBlock = blocks.Size();
+            entry.numBlocks = numBlocks;
+            for (i = 0; i < numBlocks; i++)
+            {
+                fileBlocks[i].offset = stream->GetPosition();
+                stream->Write(buffer.Begin() + (Stream::Size)i * maxBlockSize, fileBlocks[i].compressedSize);
+                blocks.Append(fileBlocks[i]);
+            }
+            compressed = true;
+        }
+    }
+
+    if (!compressed)
+    {
+        // files stored as is are aligned, so they can be used from the mapped pack file
+        Pad(stream, PackRawAlignment);
+        entry.offset = stream->GetPosition();
+        if (size > 0)
+        {
+            stream->Write(data, size);
+        }
+    }
+
+    if (size > 0)
+    {
+        srcStream->Unmap();
+    }
+    srcStream->Close();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Writes the file data first, followed by the table of contents. The
+    header is written last, once the location of the table of contents
+    is known.
+*/
+bool
+PackArchiveWriter::Write(const URI& uri)
+{
+    // the archive finds files with a binary search, so they are sorted the same way
+    if (!this->files.IsEmpty())
+    {
+        this->files.SortWithFunc(LessThan<SourceFile>);
+    }
+    IndexT fileIndex;
+    for (fileIndex = this->files.Size() - 1; fileIndex > 0; fileIndex--)
+    {
+        if (this->files[fileIndex].path == this->files[fileIndex - 1].path)
+        {
+            n_warning("PackArchiveWriter: '%s' was added more than once!\n", this->files[fileIndex].path.AsCharPtr());
+            this->files.EraseIndex(fileIndex);
+        }
+    }
+
+    // collect all directories, including the root directory
+    Array<Directory> dirs;
+    Dictionary<String, IndexT> dirLookup;
+    Directory root;
+    root.path = "";
+    root.pathHash = String::Hash("", 0);
+    dirs.Append(root);
+    dirLookup.Add(root.path, 0);
+    for (fileIndex = 0; fileIndex < this->files.Size(); fileIndex++)
+    {
+        String dirPath = ParentPath(this->files[fileIndex].path);
+        while (dirPath.IsValid() && !dirLookup.Contains(dirPath))
+        {
+            Directory dir;
+            dir.path = dirPath;
+            dir.pathHash = String::Hash(dirPath.AsCharPtr(), dirPath.Length());
+            dirLookup.Add(dirPath, dirs.Size());
+            dirs.Append(dir);
+            dirPath = ParentPath(dirPath);
+        }
+    }
+    dirs.SortWithFunc(LessThan<Directory>);
+    IndexT dirIndex;
+    for (dirIndex = 0; dirIndex < dirs.Size(); dirIndex++)
+    {
+        dirLookup[dirs[dirIndex].path] = dirIndex;
+    }
+
+    // sort the files and subdirectories into their parent directories
+    for (fileIndex = 0; fileIndex < this->files.Size(); fileIndex++)
+    {
+        dirs[dirLookup[ParentPath(this->files[fileIndex].path)]].files.Append(fileIndex);
+    }
+    for (dirIndex = 0; dirIndex < dirs.Size(); dirIndex++)
+    {
+        if (dirs[dirIndex].path.IsValid())
+        {
+            dirs[dirLookup[ParentPath(dirs[dirIndex].path)]].dirs.Append(dirIndex);
+        }
+    }
+
+    Ptr<Stream> stream = IoServer::Instance()->CreateStream(uri);
+    stream->SetAccessMode(Stream::WriteAccess);
+    if (!stream->Open())
+    {
+        n_warning("PackArchiveWriter: failed to open '%s' for writing!\n", uri.AsString().AsCharPtr());
+        return false;
+    }
+
+    PackHeader header;
+    Memory::Clear(&header, sizeof(header));
+    stream->Write(&header, sizeof(header));
+
+    // file data
+    Array<char> strings;
+    Array<PackFileEntry> fileEntries;
+    Array<PackBlock> blocks;
+    fileEntries.Reserve(this->files.Size());
+    for (fileIndex = 0; fileIndex < this->files.Size(); fileIndex++)
+    {
+        const SourceFile& src = this->files[fileIndex];
+        PackFileEntry entry;
+        if (!this->WriteFileData(stream, src, entry, blocks))
+        {
+            stream->Close();
+            return false;
+        }
+        entry.pathHash = src.pathHash;
+        entry.pathOffset = AddString(strings, src.path);
+        entry.nameOffset = entry.pathOffset + NameIndex(src.path);
+        fileEntries.Append(entry);
+    }
+
+    // directories and their listings
+    Array<PackDirEntry> dirEntries;
+    Array<uint> listEntries;
+    for (dirIndex = 0; dirIndex < dirs.Size(); dirIndex++)
+    {
+        const Directory& dir = dirs[dirIndex];
+        PackDirEntry entry;
+        entry.pathHash = dir.pathHash;
+        entry.pathOffset = AddString(strings, dir.path);
+        entry.nameOffset = entry.pathOffset + NameIndex(dir.path);
+        entry.firstListEntry = listEntries.Size();
+        entry.numFiles = dir.files.Size();
+        entry.numDirs = dir.dirs.Size();
+        listEntries.AppendArray(dir.files);
+        listEntries.AppendArray(dir.dirs);
+        dirEntries.Append(entry);
+    }
+
+    // table of contents
+    Pad(stream, 8);
+    header.magic = PackMagic;
+    header.version = PackVersion;
+    header.blockSize = PackBlockSize;
+    header.numFiles = fileEntries.Size();
+    header.numBlocks = blocks.Size();
+    header.numDirs = dirEntries.Size();
+    header.numListEntries = listEntries.Size();
+    header.stringsSize = strings.Size();
+    header.tocOffset = stream->GetPosition();
+    stream->Write(fileEntries.Begin(), fileEntries.ByteSize());
+    stream->Write(blocks.Begin(), blocks.ByteSize());
+    stream->Write(dirEntries.Begin(), dirEntries.ByteSize());
+    stream->Write(listEntries.Begin(), listEntries.ByteSize());
+    stream->Write(strings.Begin(), strings.ByteSize());
+
+    stream->Seek(0, Stream::Begin);
+    stream->Write(&header, sizeof(header));
+    stream->Close();
+    return true;
+}
+
+} // namespace IO
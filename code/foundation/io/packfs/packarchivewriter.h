@@ -0,0 +1,94 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class IO::PackArchiveWriter
+
+    Writes a Nebula pack file (.npk) from a set of files, see
+    io/packfs/packformat.h for the layout. Used by the archiver tool.
+
+    Each file is compressed in blocks of PackBlockSize bytes, files which
+    shrink by less than an eighth are stored as is instead, so they can be
+    mapped without a copy when the pack file is mounted. Files which should
+    never be compressed, like already compressed audio or video, can be
+    added with compression disabled.
+
+    @copyright
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "core/refcounted.h"
+#include "io/uri.h"
+#include "io/stream.h"
+#include "io/packfs/packformat.h"
+
+//------------------------------------------------------------------------------
+namespace IO
+{
+class PackArchiveWriter : public Core::RefCounted
+{
+    __DeclareClass(PackArchiveWriter);
+public:
+    /// constructor
+    PackArchiveWriter();
+    /// destructor
+    virtual ~PackArchiveWriter();
+
+    /// set the zlib compression level, 0 stores all files as is (default is 9)
+    void SetCompressionLevel(int level);
+    /// add a file, which is read when the pack file is written
+    void AddFile(const Util::String& pathInArchive, const URI& srcFile, bool compress = true);
+    /// get the number of files added
+    SizeT GetNumFiles() const;
+    /// write the pack file, the URI includes the file extension
+    bool Write(const URI& uri);
+    /// remove all files
+    void Clear();
+
+private:
+    struct SourceFile
+    {
+        Util::String path;
+        uint pathHash;
+        URI srcFile;
+        bool compress;
+    };
+    struct Directory
+    {
+        Util::String path;
+        uint pathHash;
+        Util::Array<uint> files;
+        Util::Array<uint> dirs;
+    };
+
+    /// sort by path hash and path, like the archive searches them
+    template<class ENTRY> static bool LessThan(const ENTRY& lhs, const ENTRY& rhs);
+    /// write a file as is, or compressed in blocks, into the stream
+    bool WriteFileData(const Ptr<Stream>& stream, const SourceFile& src, PackFileEntry& entry, Util::Array<PackBlock>& blocks);
+    /// add a string to the string table, returns its offset
+    static uint AddString(Util::Array<char>& strings, const Util::String& str);
+    /// write zeros up to the next multiple of alignment
+    static void Pad(const Ptr<Stream>& stream, Stream::Size alignment);
+
+    Util::Array<SourceFile> files;
+    int compressionLevel;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+PackArchiveWriter::SetCompressionLevel(int level)
+{
+    this->compressionLevel = level;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+PackArchiveWriter::GetNumFiles() const
+{
+    return this->files.Size();
+}
+
+} // namespace IO
+//------------------------------------------------------------------------------
@@ -0,0 +1,360 @@
+//------------------------------------------------------------------------------
+//  packfilestream.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "io/packfs/packfilestream.h"
+#include "io/packfs/packarchive.h"
+#include "io/archfs/archivefilesystembase.h"
+
+namespace IO
+{
+__ImplementClass(IO::PackFileStream, 'PKFS', IO::Stream);
+
+using namespace Util;
+
+//------------------------------------------------------------------------------
+/**
+*/
+PackFileStream::PackFileStream() :
+    file(InvalidIndex),
+    size(0),
+    position(0),
+    rawData(nullptr),
+    mapBuffer(nullptr),
+    blockBuffer(nullptr),
+    bufferedBlock(InvalidIndex)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+PackFileStream::~PackFileStream()
+{
+    if (this->IsOpen())
+    {
+        this->Close();
+    }
+    n_assert(!this->mapBuffer);
+    n_assert(!this->blockBuffer);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+PackFileStream::CanRead() const
+{
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+PackFileStream::CanWrite() const
+{
+    return false;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+PackFileStream::CanSeek() const
+{
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+PackFileStream::CanBeMapped() const
+{
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Stream::Size
+PackFileStream::GetSize() const
+{
+    return this->size;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Stream::Position
+PackFileStream::GetPosition() const
+{
+    return this->position;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Opening only looks up the file, no data is read or decompressed yet.
+*/
+bool
+PackFileStream::Open()
+{
+    n_assert(!this->IsOpen());
+    n_assert(!this->archive.isvalid());
+
+    // allow only read access
+    if (ReadAccess == this->accessMode)
+    {
+        if (Stream::Open())
+        {
+            Ptr<ArchiveBase> arch = ArchiveFileSystemBase::Instance()->FindArchive(this->uri);
+            if (arch.isvalid() && arch->IsA(PackArchive::RTTI))
+            {
+                Dictionary<String, String> params = this->uri.ParseQuery();
+                if (params.Contains("file"))
+                {
+                    this->archive = arch.downcast<PackArchive>();
+                    this->file = this->archive->FindFile(params["file"]);
+                    if (InvalidIndex != this->file)
+                    {
+                        this->size = this->archive->GetFileSize(this->file);
+                        this->rawData = (const unsigned char*)this->archive->GetRawData(this->file);
+                        this->position = 0;
+                        return true;
+                    }
+                }
+            }
+            // fallthrough: failure
+            this->Close();
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+PackFileStream::Close()
+{
+    n_assert(this->IsOpen());
+    if (this->IsMapped())
+    {
+        this->Unmap();
+    }
+    if (this->mapBuffer)
+    {
+        Memory::Free(Memory::StreamDataHeap, this->mapBuffer);
+        this->mapBuffer = nullptr;
+    }
+    if (this->blockBuffer)
+    {
+        Memory::Free(Memory::StreamDataHeap, this->blockBuffer);
+        this->blockBuffer = nullptr;
+    }
+    this->bufferedBlock = InvalidIndex;
+    this->rawData = nullptr;
+    this->archive = nullptr;
+    this->file = InvalidIndex;
+    Stream::Close();
+    this->size = 0;
+    this->position = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+PackFileStream::LoadBlock(IndexT block)
+{
+    if (block == this->bufferedBlock)
+    {
+        return true;
+    }
+    if (!this->blockBuffer)
+    {
+        this->blockBuffer = (unsigned char*)Memory::Alloc(Memory::StreamDataHeap, PackBlockSize);
+    }
+    if (0 == this->archive->ReadBlock(this->file, block, this->blockBuffer))
+    {
+        this->bufferedBlock = InvalidIndex;
+        return false;
+    }
+    this->bufferedBlock = block;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Whole blocks in the read range are decompressed straight into the
+    destination, only the partially read blocks at the start and end of
+    the range go through the block buffer.
+*/
+Stream::Size
+PackFileStream::Read(void* ptr, Size numBytes)
+{
+    n_assert(ptr);
+    n_assert(this->IsOpen());
+    n_assert(ReadAccess == this->accessMode);
+    n_assert((this->position >= 0) && (this->position <= this->size));
+
+    // check if end-of-stream is near
+    Size readBytes = Math::min(numBytes, this->size - this->position);
+    if (readBytes <= 0)
+    {
+        return 0;
+    }
+
+    // files stored as is and mapped files are copied from memory
+    const unsigned char* src = this->rawData ? this->rawData : this->mapBuffer;
+    if (src)
+    {
+        Memory::Copy(src + this->position, ptr, readBytes);
+        this->position += readBytes;
+        return readBytes;
+    }
+
+    unsigned char* dst = (unsigned char*)ptr;
+    Size bytesDone = 0;
+    while (bytesDone < readBytes)
+    {
+        Position position = this->position + bytesDone;
+        IndexT block = (IndexT)(position / PackBlockSize);
+        Size blockStart = (Size)block * PackBlockSize;
+        Size blockSize = Math::min((Size)PackBlockSize, this->size - blockStart);
+        Size offsetInBlock = position - blockStart;
+        Size chunk = Math::min(readBytes - bytesDone, blockSize - offsetInBlock);
+        bool success;
+        if (chunk == blockSize)
+        {
+            success = this->archive->ReadBlock(this->file, block, dst + bytesDone) == blockSize;
+        }
+        else
+        {
+            success = this->LoadBlock(block);
+            if (success)
+            {
+                Memory::Copy(this->blockBuffer + offsetInBlock, dst + bytesDone, chunk);
+            }
+        }
+        if (!success)
+        {
+            // like a failed Map, nothing is read from a damaged file
+            n_warning("PackFileStream::Read(): failed to decompress '%s'!\n", this->uri.AsString().AsCharPtr());
+            return 0;
+        }
+        bytesDone += chunk;
+    }
+    this->position += bytesDone;
+    return bytesDone;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+PackFileStream::Seek(Offset offset, SeekOrigin origin)
+{
+    n_assert(this->IsOpen());
+    n_assert(!this->IsMapped());
+    n_assert((this->position >= 0) && (this->position <= this->size));
+
+    switch (origin)
+    {
+        case Begin:
+            this->position = offset;
+            break;
+        case Current:
+            this->position += offset;
+            break;
+        case End:
+            this->position = this->size + offset;
+            break;
+        default:
+            n_assert(false);
+    }
+
+    // make sure read position doesn't become invalid
+    this->position = Math::clamp(this->position, (Stream::Size)0, this->size);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+PackFileStream::Eof() const
+{
+    n_assert(this->IsOpen());
+    n_assert((this->position >= 0) && (this->position <= this->size));
+    return (this->position == this->size);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Files stored as is are mapped without a copy, compressed files are
+    decompressed as a whole the first time they are mapped. Returns nullptr
+    and stays unmapped if a block can't be decompressed.
+*/
+void*
+PackFileStream::Map()
+{
+    n_assert(this->IsOpen());
+    n_assert(ReadAccess == this->accessMode);
+    if (this->rawData)
+    {
+        Stream::Map();
+        return (void*)this->rawData;
+    }
+
+    if (!this->mapBuffer && this->size > 0)
+    {
+        this->mapBuffer = (unsigned char*)Memory::Alloc(Memory::StreamDataHeap, this->size);
+        SizeT numBlocks = this->archive->GetNumBlocks(this->file);
+        IndexT block;
+        for (block = 0; block < numBlocks; block++)
+        {
+            if (0 == this->archive->ReadBlock(this->file, block, this->mapBuffer + (Size)block * PackBlockSize))
+            {
+                n_warning("PackFileStream::Map(): failed to decompress '%s'!\n", this->uri.AsString().AsCharPtr());
+                Memory::Free(Memory::StreamDataHeap, this->mapBuffer);
+                this->mapBuffer = nullptr;
+                return nullptr;
+            }
+        }
+    }
+    Stream::Map();
+    return this->mapBuffer;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+PackFileStream::Unmap()
+{
+    n_assert(this->IsOpen());
+    Stream::Unmap();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void*
+PackFileStream::MemoryMap()
+{
+    return this->Map();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+PackFileStream::MemoryUnmap()
+{
+    this->Unmap();
+}
+
+} // namespace IO
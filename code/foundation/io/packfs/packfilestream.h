@@ -0,0 +1,84 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class IO::PackFileStream
+
+    Wraps a file in a Nebula pack file into a stream. The IoServer hands
+    these out transparently for "file:" URIs pointing into a mounted pack
+    file, the archive specific URIs have the following format:
+
+    pak:///bla/blob/archive?file=path/in/packfile
+
+    Files stored uncompressed are not copied at all, Map() returns a pointer
+    into the mapped pack file and Read() copies straight from it. Compressed
+    files are decompressed one block at a time as they are read, so seeking
+    and reading a small range of a large file only decompresses the blocks
+    in that range. The last partially read block is kept, so reading a file
+    in small pieces decompresses each block once. Mapping a compressed file
+    decompresses all of it into a private buffer. If a block of the file
+    is damaged, Map() returns nullptr and Read() returns 0.
+
+    @copyright
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "io/stream.h"
+
+//------------------------------------------------------------------------------
+namespace IO
+{
+class PackArchive;
+class PackFileStream : public Stream
+{
+    __DeclareClass(PackFileStream);
+public:
+    /// constructor
+    PackFileStream();
+    /// destructor
+    virtual ~PackFileStream();
+    /// pack file streams support reading
+    bool CanRead() const override;
+    /// pack file streams don't support writing
+    bool CanWrite() const override;
+    /// pack file streams support seeking
+    bool CanSeek() const override;
+    /// pack file streams are mappable
+    bool CanBeMapped() const override;
+    /// get the size of the stream in bytes
+    Size GetSize() const override;
+    /// get the current position of the read cursor
+    Position GetPosition() const override;
+    /// open the stream
+    bool Open() override;
+    /// close the stream
+    void Close() override;
+    /// read from the stream, only decompresses the blocks in the read range
+    Size Read(void* ptr, Size numBytes) override;
+    /// seek in stream
+    void Seek(Offset offset, SeekOrigin origin) override;
+    /// return true if end-of-stream reached
+    bool Eof() const override;
+    /// map for direct memory-access
+    void* Map() override;
+    /// unmap a mapped stream
+    void Unmap() override;
+    /// map for direct memory-access, does nothing but call Map()
+    void* MemoryMap() override;
+    /// unmap memory stream
+    void MemoryUnmap() override;
+
+private:
+    /// decompress a block into the block buffer, unless it is already there
+    bool LoadBlock(IndexT block);
+
+    Ptr<PackArchive> archive;
+    IndexT file;
+    Size size;
+    Position position;
+    const unsigned char* rawData;   // points into the mapped pack file for files stored as is
+    unsigned char* mapBuffer;       // whole decompressed file, only allocated when mapped
+    unsigned char* blockBuffer;     // last block read partially
+    IndexT bufferedBlock;
+};
+
+} // namespace IO
+//------------------------------------------------------------------------------
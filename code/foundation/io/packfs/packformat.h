@@ -0,0 +1,99 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @file io/packfs/packformat.h
+
+    On-disk layout of Nebula pack files (.npk), written by the
+    PackArchiveWriter and read by the PackArchive.
+
+    A pack file starts with the header, followed by the file data. The table
+    of contents is written after the data at tocOffset, and is used in place
+    from the mapped pack file:
+
+    - PackFileEntry[numFiles], sorted by path hash and path
+    - PackBlock[numBlocks], the blocks of all compressed files
+    - PackDirEntry[numDirs], sorted by path hash and path
+    - uint[numListEntries], the file and subdirectory indices of each directory
+    - the string table with the null terminated paths
+
+    Files which don't compress well are stored as is and aligned to
+    PackRawAlignment, so they can be used straight from the mapped pack file.
+    All other files are split into blocks of PackBlockSize bytes, which are
+    compressed independently with zlib, so any range of a file can be read
+    by only decompressing the blocks it touches.
+
+    Paths are relative to the pack root, use forward slashes and have no
+    leading or trailing slash, the root directory has the empty path.
+    All values are little endian.
+
+    @copyright
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "core/types.h"
+
+//------------------------------------------------------------------------------
+namespace IO
+{
+
+static const uint PackMagic = 'NPAK';
+static const uint PackVersion = 1;
+/// uncompressed size of a block
+static const uint PackBlockSize = 64 * 1024;
+/// alignment of files stored uncompressed
+static const uint PackRawAlignment = 4096;
+
+struct PackHeader
+{
+    uint magic;
+    uint version;
+    uint blockSize;
+    uint numFiles;
+    uint numBlocks;
+    uint numDirs;
+    uint numListEntries;
+    uint stringsSize;
+    uint64_t tocOffset;     // offset of the table of contents, aligned to 8 bytes
+};
+
+enum PackFileFlags
+{
+    /// the file is split into compressed blocks, otherwise it is stored as is
+    PackFileCompressed = 1 << 0,
+};
+
+struct PackFileEntry
+{
+    uint pathHash;
+    uint pathOffset;        // offset of the path in the string table
+    uint nameOffset;        // offset of the file name in the string table
+    uint flags;
+    uint64_t offset;        // offset of the data in the pack file, for files stored as is
+    uint64_t size;          // uncompressed size
+    uint firstBlock;        // first block in the block table, for compressed files
+    uint numBlocks;
+};
+
+struct PackBlock
+{
+    uint64_t offset;        // offset of the block in the pack file
+    uint compressedSize;    // equals size if the block is stored as is
+    uint size;              // uncompressed size, PackBlockSize except for the last block of a file
+};
+
+struct PackDirEntry
+{
+    uint pathHash;
+    uint pathOffset;
+    uint nameOffset;
+    uint firstListEntry;    // the file indices, followed by the subdirectory indices
+    uint numFiles;
+    uint numDirs;
+};
+
+static_assert(sizeof(PackHeader) == 40, "pack header layout changed");
+static_assert(sizeof(PackFileEntry) == 40, "pack file entry layout changed");
+static_assert(sizeof(PackBlock) == 16, "pack block layout changed");
+static_assert(sizeof(PackDirEntry) == 24, "pack directory entry layout changed");
+
+} // namespace IO
+//------------------------------------------------------------------------------
@@ -0,0 +1,269 @@
+//------------------------------------------------------------------------------
+//  linuxiouring.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "io/posix/linuxiouring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+namespace IO
+{
+
+//------------------------------------------------------------------------------
+/**
+*/
+static int
+SysSetup(uint entries, io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static int
+SysEnter(int fd, uint toSubmit, uint minComplete, uint flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+IoUring::IoUring() :
+    ringFd(-1),
+    numQueued(0),
+    sqRing(nullptr),
+    sqRingSize(0),
+    sqHead(nullptr),
+    sqTail(nullptr),
+    sqMask(nullptr),
+    sqArray(nullptr),
+    sqes(nullptr),
+    sqesSize(0),
+    cqRing(nullptr),
+    cqRingSize(0),
+    cqHead(nullptr),
+    cqTail(nullptr),
+    cqMask(nullptr),
+    cqes(nullptr)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+IoUring::~IoUring()
+{
+    if (this->IsValid())
+    {
+        this->Discard();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Creating the ring fails on kernels without io_uring, or where it is
+    blocked, like in many containers. The caller is expected to fall back to
+    blocking reads then.
+*/
+bool
+IoUring::Setup(uint entries)
+{
+    n_assert(!this->IsValid());
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = SysSetup(entries, &params);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    // reads need at least 5.6, which is also the first version with a single mapping for both rings
+    if (0 == (params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        close(fd);
+        return false;
+    }
+
+    this->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint);
+    this->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    size_t ringSize = this->sqRingSize > this->cqRingSize ? this->sqRingSize : this->cqRingSize;
+    void* ring = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    this->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* entriesMem = mmap(nullptr, this->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (entriesMem == MAP_FAILED)
+    {
+        munmap(ring, ringSize);
+        close(fd);
+        return false;
+    }
+
+    this->ringFd = fd;
+    this->sqRing = ring;
+    this->sqRingSize = ringSize;
+    this->cqRing = ring;
+    this->cqRingSize = ringSize;
+    this->sqes = (io_uring_sqe*)entriesMem;
+
+    char* base = (char*)ring;
+    this->sqHead = (uint*)(base + params.sq_off.head);
+    this->sqTail = (uint*)(base + params.sq_off.tail);
+    this->sqMask = (uint*)(base + params.sq_off.ring_mask);
+    this->sqArray = (uint*)(base + params.sq_off.array);
+    this->cqHead = (uint*)(base + params.cq_off.head);
+    this->cqTail = (uint*)(base + params.cq_off.tail);
+    this->cqMask = (uint*)(base + params.cq_off.ring_mask);
+    this->cqes = (io_uring_cqe*)(base + params.cq_off.cqes);
+    this->numQueued = 0;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+IoUring::Discard()
+{
+    n_assert(this->IsValid());
+    munmap(this->sqes, this->sqesSize);
+    munmap(this->sqRing, this->sqRingSize);
+    close(this->ringFd);
+    this->ringFd = -1;
+    this->sqRing = this->cqRing = nullptr;
+    this->sqes = nullptr;
+    this->cqes = nullptr;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+io_uring_sqe*
+IoUring::NextEntry()
+{
+    uint tail = *this->sqTail;
+    uint head = __atomic_load_n(this->sqHead, __ATOMIC_ACQUIRE);
+    if (tail - head > *this->sqMask)
+    {
+        return nullptr;
+    }
+    uint index = tail & *this->sqMask;
+    io_uring_sqe* entry = &this->sqes[index];
+    memset(entry, 0, sizeof(io_uring_sqe));
+    this->sqArray[index] = index;
+    return entry;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+IoUring::PrepareRead(int fd, uint64_t offset, void* buf, uint size, uint64_t userData)
+{
+    io_uring_sqe* entry = this->NextEntry();
+    if (entry == nullptr)
+    {
+        return false;
+    }
+    entry->opcode = IORING_OP_READ;
+    entry->fd = fd;
+    entry->off = offset;
+    entry->addr = (uint64_t)buf;
+    entry->len = size;
+    entry->user_data = userData;
+
+    // publish the entry to the kernel
+    __atomic_store_n(this->sqTail, *this->sqTail + 1, __ATOMIC_RELEASE);
+    this->numQueued++;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+IoUring::PrepareNop(uint64_t userData)
+{
+    io_uring_sqe* entry = this->NextEntry();
+    if (entry == nullptr)
+    {
+        return false;
+    }
+    entry->opcode = IORING_OP_NOP;
+    entry->fd = -1;
+    entry->user_data = userData;
+    __atomic_store_n(this->sqTail, *this->sqTail + 1, __ATOMIC_RELEASE);
+    this->numQueued++;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+IoUring::Submit()
+{
+    while (this->numQueued > 0)
+    {
+        int res = SysEnter(this->ringFd, this->numQueued, 0, 0);
+        if (res < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+            {
+                continue;
+            }
+            n_error("IoUring::Submit(): io_uring_enter failed with '%s'\n", strerror(errno));
+        }
+        this->numQueued -= res;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+IoUring::Wait()
+{
+    while (__atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE) == *this->cqHead)
+    {
+        int res = SysEnter(this->ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+        if (res < 0 && errno != EINTR)
+        {
+            n_error("IoUring::Wait(): io_uring_enter failed with '%s'\n", strerror(errno));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+IoUring::PopCompletion(uint64_t& userData, int& result)
+{
+    uint head = *this->cqHead;
+    if (head == __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+    const io_uring_cqe& completion = this->cqes[head & *this->cqMask];
+    userData = completion.user_data;
+    result = completion.res;
+
+    // hand the entry back to the kernel
+    __atomic_store_n(this->cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+} // namespace IO
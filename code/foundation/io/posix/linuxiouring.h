@@ -0,0 +1,83 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class IO::IoUring
+
+    Minimal wrapper around a Linux io_uring, set up through the raw system
+    calls so no liburing is needed. Used by the AsyncFileReader to keep many
+    file reads in flight without a thread per read.
+
+    Submissions are not thread safe and have to be serialized by the owner,
+    completions must only be reaped from a single thread.
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "core/types.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+//------------------------------------------------------------------------------
+namespace IO
+{
+class IoUring
+{
+public:
+    /// constructor
+    IoUring();
+    /// destructor
+    ~IoUring();
+
+    /// create the ring, returns false if io_uring is not available
+    bool Setup(uint entries);
+    /// destroy the ring
+    void Discard();
+    /// return true if the ring has been setup
+    bool IsValid() const;
+
+    /// queue a read, returns false if the submission queue is full
+    bool PrepareRead(int fd, uint64_t offset, void* buf, uint size, uint64_t userData);
+    /// queue a no-op, which completes right away and may be used to wake up a waiting thread
+    bool PrepareNop(uint64_t userData);
+    /// hand all queued entries to the kernel
+    void Submit();
+    /// block until at least one completion is available
+    void Wait();
+    /// get the next completion, returns false if there is none
+    bool PopCompletion(uint64_t& userData, int& result);
+
+private:
+    /// get the next free submission entry, or nullptr
+    io_uring_sqe* NextEntry();
+
+    int ringFd;
+    uint numQueued;
+
+    void* sqRing;
+    size_t sqRingSize;
+    uint* sqHead;
+    uint* sqTail;
+    uint* sqMask;
+    uint* sqArray;
+    io_uring_sqe* sqes;
+    size_t sqesSize;
+
+    void* cqRing;
+    size_t cqRingSize;
+    uint* cqHead;
+    uint* cqTail;
+    uint* cqMask;
+    io_uring_cqe* cqes;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+IoUring::IsValid() const
+{
+    return this->ringFd != -1;
+}
+
+} // namespace IO
+//------------------------------------------------------------------------------
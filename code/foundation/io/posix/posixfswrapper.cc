@@ -14,11 +14,13 @@
 #include <sys/stat.h>
 #include <sys/file.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 #ifdef __APPLE__
 namespace CoreFoundation {
     #include <CoreFoundation/CoreFoundation.h>
 }
+#include <mach-o/dyld.h>
 #endif
 
 namespace Posix
@@ -111,6 +113,35 @@ PosixFSWrapper::Read(Handle handle, void* buf, Stream::Size numBytes)
     return bytesRead;
 }
 
+//------------------------------------------------------------------------------
+/**
+    Read through the file descriptor, the position of the FILE is left
+    untouched, so this may be called from several threads at once.
+*/
+Stream::Size
+PosixFSWrapper::ReadAt(Handle handle, Stream::Offset offset, void* buf, Stream::Size numBytes)
+{
+    n_assert(0 != handle);
+    n_assert(buf != 0);
+    n_assert(offset >= 0);
+    int fd = fileno(handle);
+    Stream::Size bytesRead = 0;
+    while (bytesRead < numBytes)
+    {
+        ssize_t res = pread(fd, (char*)buf + bytesRead, numBytes - bytesRead, offset + bytesRead);
+        if (res < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (res <= 0)
+        {
+            break;
+        }
+        bytesRead += res;
+    }
+    return bytesRead;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -587,6 +618,30 @@ PosixFSWrapper::GetBinDirectory()
     return String("file:///") + result;
 }
 
+//------------------------------------------------------------------------------
+/**
+    Unlike argv[0], this is the same for every process started from the
+    same executable, no matter how it was launched.
+*/
+String
+PosixFSWrapper::GetExecutablePath()
+{
+    char buf[MAXPATHLEN] = { 0 };
+#ifdef __APPLE__
+    uint32_t size = sizeof(buf);
+    if (_NSGetExecutablePath(buf, &size) != 0)
+    {
+        buf[0] = '\0';
+    }
+#else
+    ssize_t bytes = readlink("/proc/self/exe", buf, MAXPATHLEN - 1);
+    buf[bytes >= 0 ? bytes : 0] = '\0';
+#endif
+    String result = buf;
+    result.ConvertBackslashes();
+    return String("file:///") + result;
+}
+
 //------------------------------------------------------------------------------
 /**
     This method should return the installation directory of the
@@ -33,6 +33,8 @@ public:
     static void Write(Handle h, const void* buf, IO::Stream::Size numBytes);
     /// read from a file
     static IO::Stream::Size Read(Handle h, void* buf, IO::Stream::Size numBytes);
+    /// read from a file at an offset, without moving the file position
+    static IO::Stream::Size ReadAt(Handle h, IO::Stream::Offset offset, void* buf, IO::Stream::Size numBytes);
     /// map file to virtual memory
     static char* Map(Handle h, IO::Stream::AccessMode accessMode, Handle& mappedHandle);
     /// unmap file
@@ -87,6 +89,8 @@ public:
     static Util::String GetHomeDirectory();
     /// get path to the current bin directory (for bin: standard assign)
     static Util::String GetBinDirectory();
+    /// get path to the executable of the running process
+    static Util::String GetExecutablePath();
     /// return true when the string is a device name (e.g. "C:")
     static bool IsDeviceName(const Util::String& str);
 };
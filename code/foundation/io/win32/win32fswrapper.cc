@@ -141,6 +141,37 @@ Win32FSWrapper::Read(Handle handle, void* buf, Stream::Size numBytes)
     return bytesRead;
 }
 
+//------------------------------------------------------------------------------
+/**
+    The offset is passed through an OVERLAPPED structure, which makes the read
+    independent of the current file position.
+*/
+Stream::Size
+Win32FSWrapper::ReadAt(Handle handle, Stream::Offset offset, void* buf, Stream::Size numBytes)
+{
+    n_assert(0 != handle);
+    n_assert(buf != 0);
+    n_assert(offset >= 0);
+    Stream::Size bytesRead = 0;
+    while (bytesRead < numBytes)
+    {
+        ULARGE_INTEGER pos;
+        pos.QuadPart = offset + bytesRead;
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = pos.LowPart;
+        overlapped.OffsetHigh = pos.HighPart;
+        Stream::Size remaining = numBytes - bytesRead;
+        DWORD chunk = remaining > 0x40000000 ? 0x40000000 : (DWORD)remaining;
+        DWORD chunkRead = 0;
+        if (0 == ReadFile(handle, (char*)buf + bytesRead, chunk, &chunkRead, &overlapped) || chunkRead == 0)
+        {
+            break;
+        }
+        bytesRead += chunkRead;
+    }
+    return bytesRead;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -385,6 +416,8 @@ Win32FSWrapper::DeleteFile(const String& path)
 
 //------------------------------------------------------------------------------
 /**
+    Renames source to target, like rename() a target which doesn't exist yet
+    is created.
 */
 bool
 Win32FSWrapper::ReplaceFile(const Util::String& source, const Util::String& target)
@@ -393,7 +426,11 @@ Win32FSWrapper::ReplaceFile(const Util::String& source, const Util::String& targ
     ushort wideTargetPath[1024];
     Win32::Win32StringConverter::UTF8ToWide(source, wideSourcePath, sizeof(wideSourcePath));
     Win32::Win32StringConverter::UTF8ToWide(target, wideTargetPath, sizeof(wideTargetPath));
-    return (0 != ::ReplaceFileW((LPCWSTR)wideTargetPath, (LPCWSTR)wideSourcePath, NULL, 0, 0, 0));
+    if (0 != ::ReplaceFileW((LPCWSTR)wideTargetPath, (LPCWSTR)wideSourcePath, NULL, 0, 0, 0))
+    {
+        return true;
+    }
+    return (0 != ::MoveFileExW((LPCWSTR)wideSourcePath, (LPCWSTR)wideTargetPath, MOVEFILE_REPLACE_EXISTING));
 }
 
 //------------------------------------------------------------------------------
@@ -699,6 +736,22 @@ Win32FSWrapper::GetBinDirectory()
     return String("file:///") + result;
 }
 
+//------------------------------------------------------------------------------
+/**
+    Unlike argv[0], this is the same for every process started from the
+    same executable, no matter how it was launched.
+*/
+String
+Win32FSWrapper::GetExecutablePath()
+{
+    ushort wideBuffer[NEBULA_MAXPATH];
+    DWORD res = GetModuleFileNameW(NULL, (LPWSTR)wideBuffer, sizeof(wideBuffer) / 2);
+    n_assert(0 != res);
+    String result = Win32::Win32StringConverter::WideToUTF8(wideBuffer);
+    result.ConvertBackslashes();
+    return String("file:///") + result;
+}
+
 //------------------------------------------------------------------------------
 /**
     This method should return the installation directory of the
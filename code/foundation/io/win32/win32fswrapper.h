@@ -32,6 +32,8 @@ public:
     static void Write(Handle h, const void* buf, IO::Stream::Size numBytes);
     /// read from a file
     static IO::Stream::Size Read(Handle h, void* buf, IO::Stream::Size numBytes);
+    /// read from a file at an offset
+    static IO::Stream::Size ReadAt(Handle h, IO::Stream::Offset offset, void* buf, IO::Stream::Size numBytes);
     /// map file to virtual memory
     static char* Map(Handle h, IO::Stream::AccessMode accessMode, Handle& mappedHandle);
     /// unmap file
@@ -88,6 +90,8 @@ public:
     static Util::String GetHomeDirectory();
     /// get path to the current bin directory (for bin: standard assign)
     static Util::String GetBinDirectory();
+    /// get path to the executable of the running process
+    static Util::String GetExecutablePath();
     /// get path to the "c:/program files" directory
     static Util::String GetProgramsDirectory();
     /// get current working directory
@@ -20,7 +20,8 @@ using namespace Util;
 /**
 */
 ZipArchive::ZipArchive() :
-    zipFileHandle(0)
+    zipFileHandle(0),
+    archiveFileHandle(0)
 {
     fill_nebula3_filefunc(&this->zlibIoFuncs);
 }
@@ -69,6 +70,16 @@ ZipArchive::Setup(const URI& zipFileURI, const String& rootPathOverride)
             return false;
         }
 
+        // archives on disk get a second handle, which the file entries read from without locking
+        if (absPath.Scheme() == "file")
+        {
+            String nativePath = absPath.GetHostAndLocalPath() + ".zip";
+            if (FSWrapper::FileExists(nativePath))
+            {
+                this->archiveFileHandle = FSWrapper::OpenFile(nativePath, Stream::ReadAccess, Stream::Random);
+            }
+        }
+
         // read the table of contents
         this->ParseTableOfContents();    
         return true;
@@ -91,6 +102,11 @@ ZipArchive::Discard()
 
     unzClose(this->zipFileHandle);
     this->zipFileHandle = 0;
+    if (0 != this->archiveFileHandle)
+    {
+        FSWrapper::CloseFile(this->archiveFileHandle);
+        this->archiveFileHandle = 0;
+    }
 
     ArchiveBase::Discard();
 }
@@ -177,7 +193,7 @@ ZipArchive::AddEntry(const String& path)
     else
     {
         ZipFileEntry* finalFileEntry = dirEntry->AddFileEntry(finalName);
-        finalFileEntry->Setup(finalName, this->zipFileHandle, &this->archiveCritSect);
+        finalFileEntry->Setup(finalName, this->zipFileHandle, this->archiveFileHandle, &this->archiveCritSect);
     }
 }
 
@@ -287,6 +303,24 @@ ZipArchive::FindDirEntry(const String& pathInZipArchive) const
     return dirEntry;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+ZipArchive::HasFile(const String& pathInArchive) const
+{
+    return 0 != this->FindFileEntry(pathInArchive);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+ZipArchive::HasDirectory(const String& pathInArchive) const
+{
+    return 0 != this->FindDirEntry(pathInArchive);
+}
+
 //------------------------------------------------------------------------------
 /**
 */
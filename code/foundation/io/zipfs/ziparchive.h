@@ -6,9 +6,10 @@
     Private helper class for ZipFileSystem to hold per-Zip-archive data.
     Uses the zlib and the minizip lib for zip file access.
     
-    Multithreading: access to zlib archives needs to be serialized. A
+    Multithreading: access to the minizip handle needs to be serialized. A
     ZipArchive objects contains a critical section which it will hand down
-    to ZipFileEntry objects.
+    to ZipFileEntry objects. Archives on disk also keep a native file handle,
+    which the file entries use for positioned reads that don't need the lock.
 
     @copyright
     (C) 2006 Radon Labs GmbH
@@ -44,6 +45,10 @@ public:
     URI ConvertToArchiveURI(const URI& fileURI) const;
     /// convert an absolute path to local path inside archive, returns empty string if absPath doesn't point into this archive
     Util::String ConvertToPathInArchive(const Util::String& absPath) const;
+    /// return true if the archive contains a file
+    bool HasFile(const Util::String& pathInArchive) const;
+    /// return true if the archive contains a directory
+    bool HasDirectory(const Util::String& pathInArchive) const;
     ///
     bool GetIOInfo(const IO::URI& path, IO::IOStat& outInfo);
 
@@ -65,6 +70,7 @@ private:
 
     Util::String rootPath;                      // location of the zip archive file
     unzFile zipFileHandle;                      // the zip file handle
+    FSWrapper::Handle archiveFileHandle;        // native handle for lock-free reads, only for archives on disk
     ZipDirEntry rootEntry;                      // the root entry of the zip archive
     Threading::CriticalSection archiveCritSect; // need to serialize access to archive from multiple threads!
     zlib_filefunc64_def zlibIoFuncs;            // io functions struct from zlib to nebula
@@ -6,23 +6,62 @@
 
 #include "io/zipfs/zipfileentry.h"
 #include "timing/calendartime.h"
+#include "zlib/zlib.h"
 
 namespace IO
 {
 using namespace Util;
 using namespace Threading;
 
+/// size of the chunks compressed data is read in
+static const Stream::Size ReadChunkSize = 256 * 1024;
+
 //------------------------------------------------------------------------------
 /**
 */
 ZipFileEntry::ZipFileEntry() :
     archiveCritSect(0),
     zipFileHandle(0),
-    uncompressedSize(0)
+    archiveFileHandle(0),
+    uncompressedSize(0),
+    compressedSize(0),
+    crc(0),
+    compressionMethod(0),
+    flags(0),
+    dataOffset(-1)
 {
     Memory::Clear(&this->filePosInfo, sizeof(this->filePosInfo));
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+ZipFileEntry::ZipFileEntry(const ZipFileEntry& rhs) :
+    dataOffset(-1)
+{
+    *this = rhs;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+ZipFileEntry::operator=(const ZipFileEntry& rhs)
+{
+    this->archiveCritSect = rhs.archiveCritSect;
+    this->name = rhs.name;
+    this->zipFileHandle = rhs.zipFileHandle;
+    this->archiveFileHandle = rhs.archiveFileHandle;
+    this->filePosInfo = rhs.filePosInfo;
+    this->uncompressedSize = rhs.uncompressedSize;
+    this->compressedSize = rhs.compressedSize;
+    this->crc = rhs.crc;
+    this->compressionMethod = rhs.compressionMethod;
+    this->flags = rhs.flags;
+    this->dataOffset.store(rhs.dataOffset.load(std::memory_order_acquire), std::memory_order_release);
+    this->createdTime = rhs.createdTime;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -35,7 +74,7 @@ ZipFileEntry::~ZipFileEntry()
 /**
 */
 void
-ZipFileEntry::Setup(const StringAtom& n, unzFile h, CriticalSection* critSect)
+ZipFileEntry::Setup(const StringAtom& n, unzFile h, FSWrapper::Handle fileHandle, CriticalSection* critSect)
 {
     n_assert(0 != h);
     n_assert(0 == this->zipFileHandle);
@@ -43,6 +82,7 @@ ZipFileEntry::Setup(const StringAtom& n, unzFile h, CriticalSection* critSect)
 
     this->name = n;
     this->zipFileHandle = h;
+    this->archiveFileHandle = fileHandle;
 
     // store pointer to archive's critical section
     this->archiveCritSect = critSect;
@@ -57,6 +97,9 @@ ZipFileEntry::Setup(const StringAtom& n, unzFile h, CriticalSection* critSect)
     n_assert(UNZ_OK == res);
     this->uncompressedSize = fileInfo.uncompressed_size;
     this->compressedSize = fileInfo.compressed_size;
+    this->crc = (uint32_t)fileInfo.crc;
+    this->compressionMethod = (uint16_t)fileInfo.compression_method;
+    this->flags = (uint16_t)fileInfo.flag;
     // convert the file time from MS-DOS format to Nebula's FileTime
     const uint32_t dosDateTime = fileInfo.dos_date;
 
@@ -137,4 +180,131 @@ ZipFileEntry::Read(void* buf, Stream::Size numBytes) const
     return true;
 }
 
+//------------------------------------------------------------------------------
+/**
+    Reads unencrypted stored or deflated entries straight from the archive
+    file when the archive is on disk, anything else is read through the
+    shared minizip handle under the archive lock.
+*/
+bool
+ZipFileEntry::ReadAll(void* buf, Stream::Size numBytes, const String& password) const
+{
+    n_assert(0 != buf);
+    n_assert(numBytes == (Stream::Size)this->uncompressedSize);
+    bool direct = (0 != this->archiveFileHandle)
+        && password.IsEmpty()
+        && (0 == (this->flags & 1))
+        && (0 == this->compressionMethod || Z_DEFLATED == this->compressionMethod);
+    if (direct)
+    {
+        return this->ReadDirect(buf, numBytes);
+    }
+
+    ZipFileEntry* self = const_cast<ZipFileEntry*>(this);
+    if (!self->Open(password))
+    {
+        return false;
+    }
+    bool result = this->Read(buf, numBytes);
+    self->Close();
+    return result;
+}
+
+//------------------------------------------------------------------------------
+/**
+    The local header in front of the data has a variable size, minizip
+    skips it when opening the entry. This is done once per entry in raw
+    mode, which doesn't set up an inflate stream.
+*/
+Stream::Offset
+ZipFileEntry::GetDataOffset() const
+{
+    // the acquire pairs with the release below, so a valid offset is never seen before it is written
+    int64_t offset = this->dataOffset.load(std::memory_order_acquire);
+    if (offset < 0)
+    {
+        this->archiveCritSect->Enter();
+        offset = this->dataOffset.load(std::memory_order_relaxed);
+        if (offset < 0)
+        {
+            int res = unzGoToFilePos64(this->zipFileHandle, const_cast<unz64_file_pos*>(&this->filePosInfo));
+            if (UNZ_OK == res)
+            {
+                int method, level;
+                res = unzOpenCurrentFile2(this->zipFileHandle, &method, &level, 1);
+                if (UNZ_OK == res)
+                {
+                    offset = (int64_t)unzGetCurrentFileZStreamPos64(this->zipFileHandle);
+                    unzCloseCurrentFile(this->zipFileHandle);
+                    this->dataOffset.store(offset, std::memory_order_release);
+                }
+            }
+        }
+        this->archiveCritSect->Leave();
+    }
+    return offset;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+ZipFileEntry::ReadDirect(void* buf, Stream::Size numBytes) const
+{
+    n_assert(numBytes < INT_MAX);
+    Stream::Offset offset = this->GetDataOffset();
+    if (offset < 0)
+    {
+        return false;
+    }
+
+    if (0 == this->compressionMethod)
+    {
+        // stored entries are read as they are
+        if (FSWrapper::ReadAt(this->archiveFileHandle, offset, buf, numBytes) != numBytes)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // inflate the raw deflate stream chunk by chunk
+        z_stream zstream;
+        Memory::Clear(&zstream, sizeof(zstream));
+        if (Z_OK != inflateInit2(&zstream, -MAX_WBITS))
+        {
+            return false;
+        }
+        zstream.next_out = (Bytef*)buf;
+        zstream.avail_out = (uInt)numBytes;
+
+        Stream::Size chunkSize = Math::min(ReadChunkSize, (Stream::Size)this->compressedSize);
+        Bytef* chunk = (Bytef*)Memory::Alloc(Memory::ScratchHeap, Math::max(chunkSize, (Stream::Size)1));
+        Stream::Size consumed = 0;
+        int res = Z_OK;
+        while (Z_OK == res && consumed < (Stream::Size)this->compressedSize)
+        {
+            Stream::Size readSize = Math::min(chunkSize, (Stream::Size)this->compressedSize - consumed);
+            if (FSWrapper::ReadAt(this->archiveFileHandle, offset + consumed, chunk, readSize) != readSize)
+            {
+                res = Z_DATA_ERROR;
+                break;
+            }
+            consumed += readSize;
+            zstream.next_in = chunk;
+            zstream.avail_in = (uInt)readSize;
+            res = inflate(&zstream, Z_NO_FLUSH);
+        }
+        Memory::Free(Memory::ScratchHeap, chunk);
+        inflateEnd(&zstream);
+        if (Z_STREAM_END != res || zstream.total_out != (uLong)numBytes)
+        {
+            return false;
+        }
+    }
+
+    // the crc check minizip does when closing the entry
+    return crc32(0, (const Bytef*)buf, (uInt)numBytes) == this->crc;
+}
+
 } // namespace ZipFileEntry
@@ -6,6 +6,14 @@
     A file entry in a zip archive. The ZipFileEntry class is thread-safe,
     all public methods can be invoked from on the same object from different
     threads.
+
+    ReadAll() reads unencrypted entries of archives on disk without locking
+    the archive. The entry's data is read with positioned reads from the
+    archive file and inflated with a private zlib stream, so any number of
+    threads may read from the same archive at once. Only the first read of an
+    entry locks the archive once, to look up where the entry's data starts.
+    Open(), Read() and Close() go through the archive's shared minizip handle
+    and hold the archive lock from Open() until Close().
     
     @copyright
     (C) 2006 Radon Labs GmbH
@@ -15,6 +23,8 @@
 #include "minizip/unzip.h"
 #include "util/stringatom.h"
 #include "io/filetime.h"
+#include "io/fswrapper.h"
+#include <atomic>
 
 //------------------------------------------------------------------------------
 namespace IO
@@ -26,6 +36,10 @@ public:
     ZipFileEntry();
     /// destructor
     ~ZipFileEntry();
+    /// copy constructor, entries are only copied while the archive is set up
+    ZipFileEntry(const ZipFileEntry& rhs);
+    /// assignment operator
+    void operator=(const ZipFileEntry& rhs);
     
     /// get name of the file entry
     const Util::StringAtom& GetName() const;
@@ -38,19 +52,30 @@ public:
     void Close();
     /// read the *entire* content into the provided memory buffer
     bool Read(void* buf, IO::Stream::Size bufSize) const;
+    /// read the *entire* content, without opening the entry and without locking the archive if possible
+    bool ReadAll(void* buf, IO::Stream::Size bufSize, const Util::String& password = "") const;
 
 private:
     friend class ZipArchive;
     
     /// setup the file entry object
-    void Setup(const Util::StringAtom& name, unzFile zipFileHandle, Threading::CriticalSection* critSect);
+    void Setup(const Util::StringAtom& name, unzFile zipFileHandle, FSWrapper::Handle archiveFileHandle, Threading::CriticalSection* critSect);
+    /// get the offset of the entry's data in the archive file, looked up on first use
+    IO::Stream::Offset GetDataOffset() const;
+    /// read and inflate the entry's data directly from the archive file
+    bool ReadDirect(void* buf, IO::Stream::Size bufSize) const;
 
     Threading::CriticalSection* archiveCritSect;
     Util::StringAtom name;
     unzFile zipFileHandle;          // handle on zip file
+    FSWrapper::Handle archiveFileHandle;    // native handle on the archive file for positioned reads, or null
     unz64_file_pos filePosInfo;     // info about position in zip file
     uint64_t uncompressedSize;      // uncompressed size of the file
     uint64_t compressedSize;        // compressed size of the file
+    uint32_t crc;                   // crc32 of the uncompressed data
+    uint16_t compressionMethod;     // 0 if stored, 8 if deflated
+    uint16_t flags;                 // general purpose flags, bit 0 is set for encrypted entries
+    mutable std::atomic<int64_t> dataOffset;    // offset of the entry's data in the archive file, -1 until looked up
     IO::FileTime createdTime;       // creation time of the file
 };
 
@@ -129,12 +129,13 @@ ZipFileStream::Open()
                     {
                         // read content of zip file entry into private buffer
                         this->size = this->zipFileEntry->GetFileSize();
-                        if(!this->zipFileEntry->Open(pwd)) return false;
-                        if(!this->CopyToMap()) return false;
-                        this->position = 0;
-                        this->zipFileEntry->Close();
+                        bool copied = this->CopyToMap(pwd);
                         this->zipFileEntry = nullptr;
-                        return true;
+                        if (copied)
+                        {
+                            this->position = 0;
+                            return true;
+                        }
                     }
                 }
             }
@@ -271,13 +272,13 @@ ZipFileStream::MemoryUnmap()
 /**
 */
 bool 
-ZipFileStream::CopyToMap()
+ZipFileStream::CopyToMap(const String& password)
 {
     n_assert(this->IsOpen());
     n_assert(this->GetSize() > 0);
     n_assert(!this->mapBuffer);
     this->mapBuffer = (unsigned char*)Memory::Alloc(Memory::StreamDataHeap, this->size);
     n_assert(0 != this->mapBuffer);
-    return this->zipFileEntry->Read(this->mapBuffer, this->size);
+    return this->zipFileEntry->ReadAll(this->mapBuffer, this->size, password);
 }
 } // namespace IO
@@ -76,7 +76,7 @@ public:
 
 private:
     /// uncompress all to mapBuffer
-    bool CopyToMap();
+    bool CopyToMap(const Util::String& password);
     Size size;
     Position position;
     ZipFileEntry *zipFileEntry;
@@ -63,13 +63,13 @@ ZipFileSystem::Discard()
 //------------------------------------------------------------------------------
 /**
     This method takes a normal file URI and checks if the local path
-    of the URI is contained as file entry in any mounted zip archive. If yes
-    ptr to the zip archive is returned, otherwise a 0 pointer. NOTE: if the 
-    same path resides in several zip archives, it is currently not defined
+    of the URI is contained as file entry in any mounted archive. If yes
+    ptr to the archive is returned, otherwise a 0 pointer. NOTE: if the 
+    same path resides in several archives, it is currently not defined
     which one will be returned (the current implementation returns the
-    first zip archive in alphabetical order which contains the file).
+    first archive in alphabetical order which contains the file).
 */
-Ptr<Archive>
+Ptr<ArchiveBase>
 ZipFileSystem::FindArchiveWithFile(const URI& uri) const
 {
     // get the local path from the URI
@@ -77,16 +77,16 @@ ZipFileSystem::FindArchiveWithFile(const URI& uri) const
     n_assert(localPath.IsValid());
 
     // check each mounted archive
-    Ptr<ZipArchive> result;
+    Ptr<ArchiveBase> result;
     this->critSect.Enter();
     IndexT i;
     for (i = 0; (i < this->archives.Size()) && (!result.isvalid()); i++)
     {
-        const Ptr<ZipArchive>& arch = this->archives.ValueAtIndex(i).cast<ZipArchive>();
+        const Ptr<ArchiveBase>& arch = this->archives.ValueAtIndex(i);
         String pathInZipArchive = arch->ConvertToPathInArchive(localPath);
         if (pathInZipArchive.IsValid())
         {
-            if (0 != arch->FindFileEntry(pathInZipArchive))
+            if (arch->HasFile(pathInZipArchive))
             {
                 result = arch;
                 break;
@@ -96,15 +96,15 @@ ZipFileSystem::FindArchiveWithFile(const URI& uri) const
     this->critSect.Leave(); 
 
     // result may be invalid pointer at this point
-    return result.cast<Archive>();
+    return result;
 }
 
 //------------------------------------------------------------------------------
 /**
     Same as FindArchiveWithFile(), but checks for a directory entry 
-    in a zip file.
+    in an archive.
 */
-Ptr<Archive>
+Ptr<ArchiveBase>
 ZipFileSystem::FindArchiveWithDir(const URI& uri) const
 {
     // get the local path from the URI
@@ -112,16 +112,16 @@ ZipFileSystem::FindArchiveWithDir(const URI& uri) const
     n_assert(localPath.IsValid());
 
     // check each mounted archive
-    Ptr<ZipArchive> result;
+    Ptr<ArchiveBase> result;
     this->critSect.Enter();
     IndexT i;
     for (i = 0; (i < this->archives.Size()) && (!result.isvalid()); i++)
     {
-        const Ptr<ZipArchive>& arch = this->archives.ValueAtIndex(i).cast<ZipArchive>();
+        const Ptr<ArchiveBase>& arch = this->archives.ValueAtIndex(i);
         String pathInZipArchive = arch->ConvertToPathInArchive(localPath);
         if (pathInZipArchive.IsValid())
         {
-            if (0 != arch->FindDirEntry(pathInZipArchive))
+            if (arch->HasDirectory(pathInZipArchive))
             {
                 result = arch;
                 break;
@@ -131,7 +131,7 @@ ZipFileSystem::FindArchiveWithDir(const URI& uri) const
     this->critSect.Leave(); 
 
     // result may be invalid pointer at this point
-    return result.cast<Archive>();
+    return result;
 }
 
 } // namespace IO
@@ -11,13 +11,276 @@ namespace Jobs2
 {
 
 Jobs2Context ctx;
+thread_local JobThread* currentThread = nullptr;
+static const SizeT JobQueueCapacity = 1024;
+
+N_DECLARE_HISTOGRAM(N_JOBS2_LATENCY, Jobs2 Latency (us))
+
+#if __VC__
+#define JOBS2_NOINLINE __declspec(noinline)
+#else
+#define JOBS2_NOINLINE __attribute__((noinline))
+#endif
+
+//------------------------------------------------------------------------------
+/**
+*/
+static JobWaitList&
+GetWaitList(const Threading::AtomicCounter* counter)
+{
+    uintptr_t address = (uintptr_t)counter;
+    return ctx.waitLists[((address >> 2) ^ (address >> 8)) % Jobs2Context::NumWaitLists];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+InjectJob(JobNode* node)
+{
+    Threading::CriticalScope scope(&ctx.injectLock);
+    node->next = nullptr;
+    if (ctx.injectTail != nullptr)
+        ctx.injectTail->next = node;
+    else
+        ctx.injectHead = node;
+    ctx.injectTail = node;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static JobNode*
+DequeueInjectedJob()
+{
+    // Early out without taking the lock
+    if (ctx.injectHead == nullptr)
+        return nullptr;
+
+    Threading::CriticalScope scope(&ctx.injectLock);
+    JobNode* node = ctx.injectHead;
+    if (node != nullptr)
+    {
+        ctx.injectHead = node->next;
+        if (ctx.injectHead == nullptr)
+            ctx.injectTail = nullptr;
+        node->next = nullptr;
+    }
+    return node;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Wake a single sleeping thread, if any
+*/
+static void
+WakeupThread()
+{
+    // Make sure whatever work we just published is visible before we check for sleepers
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ctx.numSleepingThreads == 0)
+        return;
+
+    const SizeT numThreads = ctx.threads.Size();
+    uint start = (uint)Threading::Interlocked::Increment(&ctx.wakeupIterator);
+    for (IndexT i = 0; i < numThreads; i++)
+    {
+        if (ctx.threads[(start + i) % numThreads]->TryWakeup())
+            return;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Fibers can resume on another thread, so the thread local must never be 
+    cached across a fiber switch. Keeping this out of line makes sure the
+    address of the thread local is looked up every time.
+*/
+JOBS2_NOINLINE static JobThread*
+GetCurrentThread()
+{
+    return currentThread;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Put job in a queue, called when all wait counters are satisfied
+*/
+static void
+EnqueueJob(JobNode* node)
+{
+#if NEBULA_ENABLE_PROFILING
+    node->job.readyTime = Profiling::ProfilingGetTimestamp();
+#endif
+
+    // Job threads keep work they produce local, everyone else goes through the injection queue
+    JobThread* thread = GetCurrentThread();
+    if (thread == nullptr || !thread->queue.Push(node))
+        InjectJob(node);
+    WakeupThread();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static JobFiber*
+AllocFiber()
+{
+    Threading::CriticalScope scope(&ctx.fiberLock);
+    JobFiber* fiber = ctx.freeFibers;
+    if (fiber != nullptr)
+        ctx.freeFibers = fiber->next;
+    return fiber;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+FreeFiber(JobFiber* fiber)
+{
+    Threading::CriticalScope scope(&ctx.fiberLock);
+    fiber->next = ctx.freeFibers;
+    ctx.freeFibers = fiber;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Put a fiber which is done waiting in the ready list
+*/
+static void
+ReadyFiber(JobFiber* fiber)
+{
+    {
+        Threading::CriticalScope scope(&ctx.fiberLock);
+        fiber->next = nullptr;
+        if (ctx.readyTail != nullptr)
+            ctx.readyTail->next = fiber;
+        else
+            ctx.readyHead = fiber;
+        ctx.readyTail = fiber;
+    }
+    WakeupThread();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static JobFiber*
+DequeueReadyFiber()
+{
+    // Early out without taking the lock
+    if (ctx.readyHead == nullptr)
+        return nullptr;
+
+    Threading::CriticalScope scope(&ctx.fiberLock);
+    JobFiber* fiber = ctx.readyHead;
+    if (fiber != nullptr)
+    {
+        ctx.readyHead = fiber->next;
+        if (ctx.readyHead == nullptr)
+            ctx.readyTail = nullptr;
+        fiber->next = nullptr;
+    }
+    return fiber;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Called by a fiber whenever it starts or resumes. Whatever the previous
+    fiber on this thread asked for is done here, since it's only safe to touch
+    that fiber once we are no longer running on its stack.
+*/
+static void
+FinishFiberSwitch()
+{
+    JobThread* thread = GetCurrentThread();
+    JobFiber* fiber = thread->previousFiber;
+    if (fiber == nullptr)
+        return;
+    const Threading::AtomicCounter* counter = thread->previousFiberWait;
+    thread->previousFiber = nullptr;
+    thread->previousFiberWait = nullptr;
+
+    if (counter == nullptr)
+    {
+        FreeFiber(fiber);
+        return;
+    }
+
+    // Park the fiber on the counter, or resume it right away if the counter finished during the switch
+    JobWaitList& list = GetWaitList(counter);
+    list.lock.Enter();
+    if (*counter != 0)
+    {
+        fiber->waiter.counter = counter;
+        fiber->waiter.node = nullptr;
+        fiber->waiter.fiber = fiber;
+        fiber->waiter.event = nullptr;
+        fiber->waiter.next = list.head;
+        list.head = &fiber->waiter;
+        list.lock.Leave();
+    }
+    else
+    {
+        list.lock.Leave();
+        ReadyFiber(fiber);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Switch from the fiber currently running on thread to next. Returns when
+    the current fiber is resumed, which might be on a different thread.
+*/
+static void
+SwitchFiber(JobThread* thread, JobFiber* next)
+{
+    JobFiber* current = thread->currentFiber;
+    thread->currentFiber = next;
+    next->fiber->SwitchToFiber(*current->fiber);
+    FinishFiberSwitch();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static JobNode*
+FindJob(JobThread* thread)
+{
+    JobNode* node = nullptr;
+
+    // First, take from our own queue
+    if (thread->queue.Pop(node))
+        return node;
+
+    // Then, take jobs posted from outside the job system
+    node = DequeueInjectedJob();
+    if (node != nullptr)
+        return node;
+
+    // Lastly, steal from the other threads
+    const SizeT numThreads = ctx.threads.Size();
+    for (IndexT i = 1; i < numThreads; i++)
+    {
+        JobThread* victim = ctx.threads[(thread->threadIndex + i) % numThreads];
+        if (victim->queue.Steal(node))
+            return node;
+    }
+    return nullptr;
+}
 
 __ImplementClass(Jobs2::JobThread, 'J2TH', Threading::Thread);
 //------------------------------------------------------------------------------
 /**
 */
 JobThread::JobThread()
-    : wakeupEvent{ false }
+    : threadIndex(InvalidIndex)
+    , currentFiber(nullptr)
+    , previousFiber(nullptr)
+    , previousFiberWait(nullptr)
+    , wakeupEvent{ false }
+    , sleeping(0)
 {
     // empty
 }
@@ -31,6 +294,7 @@ JobThread::~JobThread()
     {
         this->Stop();
     }
+    this->queue.Discard();
 }
 
 //------------------------------------------------------------------------------
@@ -42,6 +306,30 @@ JobThread::SignalWorkAvailable()
     this->wakeupEvent.Signal();
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+JobThread::TryWakeup()
+{
+    if (Threading::Interlocked::CompareExchange(&this->sleeping, 0, 1) == 1)
+    {
+        Threading::Interlocked::Decrement(&ctx.numSleepingThreads);
+        this->wakeupEvent.Signal();
+        return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+JobThread::StopRequested()
+{
+    return this->ThreadStopRequested();
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -54,147 +342,265 @@ JobThread::EmitWakeupSignal()
 //------------------------------------------------------------------------------
 /**
 */
-void
-JobThread::DoWork()
+static void
+RunJob(JobThread* thread, JobNode* node)
 {
-    if (this->enableIo)
-        IO::IoServer::Create();
-    if (this->enableProfiling)
-        Profiling::ProfilingRegisterThread();
-    while (true)
+    JobContext* job = &node->job;
+    IndexT jobIndex = Threading::Interlocked::Decrement(&job->remainingGroups);
+    n_assert(jobIndex >= 0);
+
+    // If there are groups left, put the job back so other threads can steal it while we work
+    if (jobIndex > 0)
     {
-wait:
-        // Wait for jobs to come
-        this->wakeupEvent.Wait();
-        if (this->ThreadStopRequested())
-            return;
+        if (!thread->queue.Push(node))
+            InjectJob(node);
+        WakeupThread();
+    }
 
-next:
-        ctx.jobLock.Enter();
-        auto node = ctx.head;
-        auto dragging = ctx.head;
-        Jobs2::JobContext* job = nullptr;
+    N_HISTOGRAM_ADD(N_JOBS2_LATENCY, uint64_t((Profiling::ProfilingGetTimestamp() - job->readyTime) * 1000000.0));
 
-        //auto it = ctx.jobs.Begin();
-        int64_t jobIndex = -1;
-        while (true)
+    // Run function, if it waits we might come back on another thread
+    if (job->l.callable != nullptr)
+        job->l(job->numInvocations, job->groupSize, jobIndex, jobIndex * job->groupSize);
+    else
+        job->func(job->numInvocations, job->groupSize, jobIndex, jobIndex * job->groupSize, job->data);
+
+    // Decrement number of finished jobs, and if this was the last one, signal the finished event
+    if (Threading::Interlocked::Decrement(&job->groupCompletionCounter) == 0)
+    {
+        // If we have a job counter, only signal the event when the counter reaches 0
+        if (job->doneCounter != nullptr)
         {
-            // If head is nullptr, we either lost the race to grab a job
-            // or we traversed the whole list but found no job which has it's dependency satisfied,
-            // so let's wait 
-            if (ctx.head == nullptr || node == nullptr)
-            {
-                ctx.jobLock.Leave();
-                goto wait;
-            }
+            // Decrementing the counter releases any jobs waiting for it
+            int numDispatchesLeft = JobCounterDecrement(job->doneCounter);
 
-            bool dependencyDone = true;
+            if (job->signalEvent != nullptr && numDispatchesLeft == 0)
+                job->signalEvent->Signal();
+        }
+        else
+        {
+            // If we don't have a counter, just signal it when we're done with this dispatch
+            if (job->signalEvent != nullptr)
+                job->signalEvent->Signal();
+        }
+    }
+}
 
-            // Check dependencies
-            for (IndexT i = 0; i < node->job.numWaitCounters; i++)
-                dependencyDone &= *node->job.waitCounters[i] == 0;
+//------------------------------------------------------------------------------
+/**
+    Scheduler loop, runs on the job fibers
+*/
+static void
+JobFiberFunction(void* context)
+{
+    while (true)
+    {
+        FinishFiberSwitch();
+        JobThread* thread = GetCurrentThread();
+        if (thread->StopRequested())
+        {
+            // Hand control back to the thread, this fiber is never resumed
+            thread->threadFiber.SwitchToFiber(*thread->currentFiber->fiber);
+        }
 
-            // If dependency is not done, update iterators and progress
-            if (!dependencyDone)
+        // Resume fibers which are done waiting before picking up new jobs
+        JobFiber* ready = DequeueReadyFiber();
+        JobNode* node = ready == nullptr ? FindJob(thread) : nullptr;
+        if (ready == nullptr && node == nullptr)
+        {
+            // Announce that we are going to sleep, then look again so we can't miss a wakeup
+            Threading::Interlocked::Exchange(&thread->sleeping, 1);
+            Threading::Interlocked::Increment(&ctx.numSleepingThreads);
+            ready = DequeueReadyFiber();
+            node = ready == nullptr ? FindJob(thread) : nullptr;
+            if (ready == nullptr && node == nullptr)
             {
-                dragging = node;
-                node = node->next;
+                thread->wakeupEvent.Wait();
                 continue;
             }
 
-            if (node->sequence != nullptr)
-            {
-                job = &node->sequence->job;
-                n_assert(job->remainingGroups > 0);
-
-                // If wait hasn't been met, continue to next node in the main list
-                if (job->numWaitCounters == 1 && *job->waitCounters[0] != 0)
-                {
-                    dragging = node;
-                    node = node->next;
-                    continue;
-                }
-
-                // If we are consuming the last packet in the sequence, simply point the sequence to the next node
-                jobIndex = --job->remainingGroups;
-                if (job->remainingGroups == 0)
-                {
-                    node->sequence = node->sequence->next;
-                }
-            }
-            else
-            {
-                job = &node->job;
-                n_assert(job->remainingGroups > 0);
-
-                // If we are consuming the last job packet in this run, disconnect the node
-                jobIndex = --job->remainingGroups;
-                if (job->remainingGroups == 0)
-                {
-                    // Update node pointers
-                    auto next = node->next;
-
-                    // If node is not head, unlink the node between dragging and the current
-                    if (node != ctx.head)
-                    {
-                        // If node is the last one in the list, update tail
-                        if (node == ctx.tail)
-                            ctx.tail = dragging;
-                        dragging->next = next;
-                    }
-                    else
-                    {
-                        // If head, then just unlink the head node
-                        ctx.head = next;
-
-                        // If tail and node point to the same node, unlink tail
-                        if (node == ctx.tail)
-                            ctx.tail = nullptr;
-                    }
-                }
-            }
+            // Found work after all, if someone woke us in the meantime the event just causes a spurious wakeup later
+            if (Threading::Interlocked::Exchange(&thread->sleeping, 0) == 1)
+                Threading::Interlocked::Decrement(&ctx.numSleepingThreads);
+        }
 
-            // If we fall through it means we found a job
-            break;
+        if (ready != nullptr)
+        {
+            // The resumed fiber returns this one to the pool
+            thread->previousFiber = thread->currentFiber;
+            thread->previousFiberWait = nullptr;
+            SwitchFiber(thread, ready);
+        }
+        else
+        {
+            RunJob(thread, node);
         }
-        ctx.jobLock.Leave();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+JobThread::DoWork()
+{
+    if (this->enableIo)
+        IO::IoServer::Create();
+    if (this->enableProfiling)
+        Profiling::ProfilingRegisterThread();
+    currentThread = this;
+
+    // Jump into the fiber pool, we only get back here when the thread is stopped
+    Fibers::Fiber::ThreadToFiber(this->threadFiber);
+    this->previousFiber = nullptr;
+    this->previousFiberWait = nullptr;
+    this->currentFiber = AllocFiber();
+    n_assert(this->currentFiber != nullptr);
+    this->currentFiber->fiber->SwitchToFiber(this->threadFiber);
+
+    // The fiber we came back from has been abandoned
+    FreeFiber(this->currentFiber);
+    this->currentFiber = nullptr;
+    Fibers::Fiber::FiberToThread(this->threadFiber);
+}
 
-        // If jobIndex is -1, it means we're trying to run a function on a finished job
-        n_assert(jobIndex != -1);
+//------------------------------------------------------------------------------
+/**
+*/
+void
+JobSchedule(JobNode* node)
+{
+    JobContext& job = node->job;
 
-        // Run function
-        if (job->l.callable != nullptr)
-            job->l(job->numInvocations, job->groupSize, jobIndex, jobIndex * job->groupSize);
+    // Hold an extra wait while registering so a counter reaching zero mid-way can't release the job early
+    job.pendingWaits = job.numWaitCounters + 1;
+    for (IndexT i = 0; i < job.numWaitCounters; i++)
+    {
+        const Threading::AtomicCounter* counter = job.waitCounters[i];
+        JobWaiter* waiter = JobAlloc<JobWaiter>(1);
+
+        JobWaitList& list = GetWaitList(counter);
+        list.lock.Enter();
+        if (*counter != 0)
+        {
+            waiter->counter = counter;
+            waiter->node = node;
+            waiter->fiber = nullptr;
+            waiter->event = nullptr;
+            waiter->next = list.head;
+            list.head = waiter;
+            list.lock.Leave();
+        }
         else
-            job->func(job->numInvocations, job->groupSize, jobIndex, jobIndex * job->groupSize, job->data);
+        {
+            list.lock.Leave();
+            Threading::Interlocked::Decrement(&job.pendingWaits);
+        }
+    }
 
-        // Decrement number of finished jobs, and if this was the last one, signal the finished event
-        if (Threading::Interlocked::Decrement(&job->groupCompletionCounter) == 0)
+    if (Threading::Interlocked::Decrement(&job.pendingWaits) == 0)
+        EnqueueJob(node);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+int
+JobCounterDecrement(Threading::AtomicCounter* counter)
+{
+    JobWaiter* released = nullptr;
+
+    // Decrement inside the lock, so a job being scheduled either sees the counter at zero or gets released here
+    JobWaitList& list = GetWaitList(counter);
+    list.lock.Enter();
+    int ret = Threading::Interlocked::Decrement(counter);
+    if (ret == 0)
+    {
+        JobWaiter** it = &list.head;
+        while (*it != nullptr)
         {
-            // If we have a job counter, only signal the event when the counter reaches 0
-            if (job->doneCounter != nullptr)
+            JobWaiter* waiter = *it;
+            if (waiter->counter == counter)
             {
-                long numDispatchesLeft = Threading::Interlocked::Decrement(job->doneCounter);
-
-                if (job->signalEvent != nullptr && numDispatchesLeft == 0)
-                    job->signalEvent->Signal();
+                *it = waiter->next;
+                waiter->next = released;
+                released = waiter;
             }
             else
             {
-                // If we don't have a counter, just signal it when we're done with this dispatch
-                if (job->signalEvent != nullptr)
-                    job->signalEvent->Signal();
+                it = &waiter->next;
             }
+        }
+    }
+    list.lock.Leave();
 
-            // Since other threads might be waiting for this job to finish, trigger other threads to wake up
-            for (Ptr<JobThread>& thread : ctx.threads)
-            {
-                thread->EmitWakeupSignal();
-            }
+    // Queue every job which isn't waiting for anything else, and resume waiting fibers and threads
+    while (released != nullptr)
+    {
+        JobWaiter* next = released->next;
+        if (released->node != nullptr)
+        {
+            if (Threading::Interlocked::Decrement(&released->node->job.pendingWaits) == 0)
+                EnqueueJob(released->node);
         }
+        else if (released->fiber != nullptr)
+        {
+            ReadyFiber(released->fiber);
+        }
+        else
+        {
+            // The waiter lives on the waiting thread's stack, so it's gone as soon as we signal
+            released->event->Signal();
+        }
+        released = next;
+    }
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+JobWait(const Threading::AtomicCounter* counter)
+{
+    if (*counter == 0)
+        return;
+
+    JobThread* thread = GetCurrentThread();
+#if NEBULA_ENABLE_PROFILING
+    // The job may resume on another thread, where its open scopes can't be closed
+    n_assert2(thread == nullptr || Profiling::ProfilingGetScopeDepth() == 0, "JobWait called inside a profiling scope");
+#endif
+    JobFiber* fiber = thread != nullptr ? AllocFiber() : nullptr;
+    if (fiber != nullptr)
+    {
+        // Continue running jobs on a fresh fiber, it parks this one on the counter once we're off its stack
+        thread->previousFiber = thread->currentFiber;
+        thread->previousFiberWait = counter;
+        SwitchFiber(thread, fiber);
+        return;
+    }
 
-        // Do another
-        goto next;
+    // Not a job thread, or the fiber pool is exhausted, so block the thread
+    Threading::Event event;
+    JobWaiter waiter;
+    waiter.counter = counter;
+    waiter.node = nullptr;
+    waiter.fiber = nullptr;
+    waiter.event = &event;
+
+    JobWaitList& list = GetWaitList(counter);
+    list.lock.Enter();
+    if (*counter != 0)
+    {
+        waiter.next = list.head;
+        list.head = &waiter;
+        list.lock.Leave();
+        event.Wait();
+    }
+    else
+    {
+        list.lock.Leave();
     }
 }
 
@@ -206,19 +612,44 @@ N_DECLARE_COUNTER(N_JOBS2_MEMORY_COUNTER, Jobs2RingBufferMemory)
 void
 JobSystemInit(const JobSystemInitInfo& info)
 {
-    // Setup job system threads
+    ctx.injectHead = nullptr;
+    ctx.injectTail = nullptr;
+    ctx.wakeupIterator = 0;
+    ctx.numSleepingThreads = 0;
+
+    // Setup job system threads, all of them have to exist before any of them can start stealing
     ctx.threads.Resize(info.numThreads);
     for (IndexT i = 0; i < info.numThreads; i++)
     {
         Ptr<JobThread> thread = JobThread::Create();
         thread->enableIo = info.enableIo;
         thread->enableProfiling = info.enableProfiling;
+        thread->threadIndex = i;
+        thread->queue.Setup(JobQueueCapacity);
         thread->SetName(Util::String::Sprintf("%s #%d", info.name.Value(), i));
         thread->SetThreadAffinity(info.affinity);
-        thread->Start();
         ctx.threads[i] = thread;
     }
 
+    // Setup fiber pool, every thread needs one to run on plus some to replace the ones that wait
+    n_assert(info.numFibers > info.numThreads);
+    ctx.fibers.Resize(info.numFibers);
+    ctx.freeFibers = nullptr;
+    ctx.readyHead = nullptr;
+    ctx.readyTail = nullptr;
+    for (IndexT i = 0; i < info.numFibers; i++)
+    {
+        JobFiber& fiber = ctx.fibers[i];
+        fiber.fiber = new Fibers::Fiber(JobFiberFunction, nullptr, info.fiberStackSize);
+        fiber.next = ctx.freeFibers;
+        ctx.freeFibers = &fiber;
+    }
+
+    for (IndexT i = 0; i < info.numThreads; i++)
+    {
+        ctx.threads[i]->Start();
+    }
+
     ctx.numBuffers = info.numBuffers;
     ctx.iterator = 0;
     ctx.activeBuffer = 0;
@@ -229,8 +660,6 @@ JobSystemInit(const JobSystemInitInfo& info)
         ctx.scratchMemory[i] = (byte*)Memory::Alloc(Memory::ObjectHeap, info.scratchMemorySize);
     }
     N_BUDGET_COUNTER_SETUP(N_JOBS2_MEMORY_COUNTER, info.scratchMemorySize);
-    ctx.tail = nullptr;
-    ctx.head = nullptr;
 }
 
 //------------------------------------------------------------------------------
@@ -244,6 +673,35 @@ JobSystemUninit()
         thread->Stop();
     }
     ctx.threads.Clear();
+
+    // Fibers still parked on a counter are simply discarded
+    for (JobFiber& fiber : ctx.fibers)
+    {
+        delete fiber.fiber;
+    }
+    ctx.fibers.Clear();
+    ctx.freeFibers = nullptr;
+    ctx.readyHead = nullptr;
+    ctx.readyTail = nullptr;
+
+    for (IndexT i = 0; i < ctx.scratchMemory.Size(); i++)
+    {
+        Memory::Free(Memory::ObjectHeap, ctx.scratchMemory[i]);
+    }
+    ctx.scratchMemory.Clear();
+    ctx.injectHead = nullptr;
+    ctx.injectTail = nullptr;
+    for (JobWaitList& list : ctx.waitLists)
+        list.head = nullptr;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+SizeT
+JobGetNumThreads()
+{
+    return ctx.threads.Size();
 }
 
 //------------------------------------------------------------------------------
@@ -266,9 +724,11 @@ JobAlloc(SizeT bytes)
     // make sure to always pad to next 16 byte alignment in case the 
     // context used needs to be aligned
     bytes = Memory::align(bytes, 16);
-    n_assert((ctx.iterator + bytes) < ctx.scratchMemorySize);
-    void* ret = (ctx.scratchMemory[ctx.activeBuffer] + ctx.iterator);
-    ctx.iterator += bytes;
+
+    // jobs allocate from several threads, so claim the range before checking it
+    IndexT offset = Threading::Interlocked::Add(&ctx.iterator, bytes);
+    n_assert((offset + bytes) <= ctx.scratchMemorySize);
+    void* ret = (ctx.scratchMemory[ctx.activeBuffer] + offset);
     N_BUDGET_COUNTER_INCR(N_JOBS2_MEMORY_COUNTER, bytes);
     return ret;
 }
@@ -338,26 +798,25 @@ JobEndSequence(Threading::Event* signalEvent)
     n_assert(sequenceThread == Threading::Thread::GetMyThreadId());
     if (sequenceNode->sequence != nullptr)
     {
-        // Move head pointer to last element in the list
-        ctx.jobLock.Enter();
-
+        // The last job in the chain signals the sequence completion
         sequenceTail->job.doneCounter = sequenceNode->job.doneCounter;
         sequenceNode->job.doneCounter = nullptr;
         sequenceTail->job.signalEvent = sequenceNode->job.signalEvent;
         sequenceNode->job.signalEvent = nullptr;
 
-        // When sequence is chained, set the head pointer
-        if (ctx.head == nullptr)
-            ctx.head = sequenceNode;
-
-        // Then add sequence to the end of the current list
-        if (ctx.tail != nullptr)
-            ctx.tail->next = sequenceNode;
+        // The first job in the chain waits for whatever the sequence waits for
+        JobNode* node = sequenceNode->sequence;
+        n_assert(node->job.numWaitCounters == 0);
+        node->job.waitCounters = sequenceNode->job.waitCounters;
+        node->job.numWaitCounters = sequenceNode->job.numWaitCounters;
 
-        // Finally repoint tail
-        ctx.tail = sequenceNode;
-
-        ctx.jobLock.Leave();
+        // Schedule the whole chain, every job is released by the previous job's done counter
+        while (node != nullptr)
+        {
+            JobNode* next = node->next;
+            JobSchedule(node);
+            node = next;
+        }
     }
     prevDoneCounter = nullptr;
     sequenceNode = nullptr;
@@ -3,12 +3,30 @@
 #include "threading/event.h"
 #include "util/stringatom.h"
 #include "threading/interlocked.h"
+#include "threading/workstealingqueue.h"
+#include "fibers/fiber.h"
 
 //------------------------------------------------------------------------------
 /**
     The Jobs2 system provides a set of threads and a pool of jobs from which 
     threads can pickup work.
 
+    Every job thread owns a work stealing queue. Jobs dispatched from outside the
+    job system go into a shared injection queue, while jobs made runnable from within
+    a job thread are pushed to that thread's own queue. Idle threads steal from each other.
+
+    A job is only ever put in a queue once all of its wait counters have reached zero,
+    jobs with unsatisfied counters are parked on those counters and are released by the
+    job that decrements the counter to zero. This means wait counters must be decremented
+    through the job system (or JobCounterDecrement) if there are jobs waiting for them.
+
+    Every job runs on a fiber from a fixed pool. Calling JobWait from within a job parks
+    the fiber on the counter and the thread goes on to run other work, once the counter
+    reaches zero the fiber is resumed, possibly on another job thread. Since a waiting job
+    may continue on a different thread, don't rely on thread local state across a JobWait,
+    and don't wait inside a profiling scope. JobWait from outside of the job system just
+    blocks the calling thread.
+
     (C) 2021 Individual contributors, see AUTHORS file
 */
 //------------------------------------------------------------------------------
@@ -36,6 +54,7 @@ for (IndexT i = 0; i < groupSize; i++)\
 
 
 class JobThread;
+struct JobFiber;
 
 void* JobAlloc(SizeT bytes);
 typedef volatile long CompletionCounter;
@@ -82,8 +101,9 @@ struct JobContext
 {
     JobFunc func;
     Lambda l;
-    int remainingGroups;
+    Threading::AtomicCounter remainingGroups;
     Threading::AtomicCounter groupCompletionCounter;
+    Threading::AtomicCounter pendingWaits;
     SizeT numInvocations;
     SizeT groupSize;
     void* data;
@@ -91,6 +111,9 @@ struct JobContext
     SizeT numWaitCounters;
     Threading::AtomicCounter* doneCounter;
     Threading::Event* signalEvent;
+#if NEBULA_ENABLE_PROFILING
+    double readyTime;           // when the job was put in a queue, for measuring its latency
+#endif
 };
 
 struct JobNode
@@ -100,16 +123,48 @@ struct JobNode
     JobNode* sequence; // set to nullptr for ordinary nodes
 };
 
+struct JobWaiter
+{
+    JobWaiter* next;
+    JobNode* node;              // job to schedule, or
+    JobFiber* fiber;            // fiber to resume, or
+    Threading::Event* event;    // event to signal when the counter reaches zero
+    const Threading::AtomicCounter* counter;
+};
+
+struct JobFiber
+{
+    JobFiber* next;             // free or ready list
+    Fibers::Fiber* fiber;
+    JobWaiter waiter;           // used when the fiber is parked on a counter
+};
+
+struct JobWaitList
+{
+    Threading::CriticalSection lock;
+    JobWaiter* head = nullptr;
+};
+
 struct Jobs2Context
 {
-    Threading::CriticalSection jobLock;
-    JobNode* head = nullptr;
-    JobNode* tail = nullptr;
+    Threading::CriticalSection injectLock;
+    JobNode* injectHead = nullptr;
+    JobNode* injectTail = nullptr;
     Util::FixedArray<Ptr<JobThread>> threads;
-    Util::Array<JobNode*> queuedJobs;
+    Threading::AtomicCounter wakeupIterator;
+    Threading::AtomicCounter numSleepingThreads;
+
+    static const SizeT NumWaitLists = 64;
+    JobWaitList waitLists[NumWaitLists];
+
+    Threading::CriticalSection fiberLock;
+    Util::FixedArray<JobFiber> fibers;
+    JobFiber* freeFibers = nullptr;
+    JobFiber* readyHead = nullptr;
+    JobFiber* readyTail = nullptr;
 
     SizeT numBuffers;
-    IndexT iterator;
+    Threading::AtomicCounter iterator;
     IndexT activeBuffer;
     Util::FixedArray<byte*> scratchMemory;
     SizeT scratchMemorySize;
@@ -129,18 +184,29 @@ public:
 
     /// Signal new work available
     void SignalWorkAvailable();
+    /// Wake thread if it's sleeping, returns true if it was
+    bool TryWakeup();
+    /// Returns true if the thread has been asked to stop, used by the job fibers
+    bool StopRequested();
     
     bool enableIo;
     bool enableProfiling;
+    IndexT threadIndex;
+    Threading::WorkStealingQueue<JobNode*> queue;
+
+    Fibers::Fiber threadFiber;
+    JobFiber* currentFiber;
+    JobFiber* previousFiber;                                // fiber we just switched away from
+    const Threading::AtomicCounter* previousFiberWait;      // counter to park the previous fiber on, or nullptr to free it
+
+    Threading::Event wakeupEvent;
+    Threading::AtomicCounter sleeping;
 protected:
 
     /// override this method if your thread loop needs a wakeup call before stopping
     virtual void EmitWakeupSignal() override;
     /// this method runs in the thread context
     virtual void DoWork() override;
-
-private:
-    Threading::Event wakeupEvent;
 };
 
 struct JobSystemInitInfo
@@ -153,6 +219,9 @@ struct JobSystemInitInfo
     SizeT scratchMemorySize;
     SizeT numBuffers;
 
+    SizeT numFibers;
+    SizeT fiberStackSize;
+
     bool enableIo;
     bool enableProfiling;
 
@@ -162,6 +231,8 @@ struct JobSystemInitInfo
         , priority(UINT_MAX)
         , scratchMemorySize(1_MB)
         , numBuffers(1)
+        , numFibers(128)
+        , fiberStackSize(128_KB)
         , enableIo(false)
         , enableProfiling(true)
     {};
@@ -171,14 +242,23 @@ struct JobSystemInitInfo
 void JobSystemInit(const JobSystemInitInfo& info);
 /// Destroy job port
 void JobSystemUninit();
+/// Get number of job threads
+SizeT JobGetNumThreads();
 
 /// Allocate memory and progress memory iterator
 template <typename T> T* JobAlloc(SizeT count);
-/// Allocate memory
+/// Allocate memory, safe to call from several threads during a frame
 void* JobAlloc(SizeT bytes);
 /// Progress to new buffer
 void JobNewFrame();
 
+/// Schedule a job node, it's put in a queue as soon as its wait counters are satisfied
+void JobSchedule(JobNode* node);
+/// Decrement counter and release jobs waiting for it if it reaches zero, returns the new value
+int JobCounterDecrement(Threading::AtomicCounter* counter);
+/// Wait for counter to reach zero, yields the fiber if called from a job
+void JobWait(const Threading::AtomicCounter* counter);
+
 extern JobNode* sequenceNode;
 extern JobNode* sequenceTail;
 extern const Threading::AtomicCounter* prevDoneCounter;
@@ -245,7 +325,7 @@ JobDispatch(
     {
         if (doneCounter != nullptr)
         {
-            Threading::Interlocked::Exchange(doneCounter, 0);
+            JobCounterDecrement(doneCounter);
         }
         // If we have a signal event and no invocations, just signal the event and return
         if (signalEvent != nullptr)
@@ -282,27 +362,10 @@ JobDispatch(
     node->job.doneCounter = doneCounter;
     node->job.signalEvent = signalEvent;
     node->sequence = nullptr;
-
-    // Add to end of linked list
-    ctx.jobLock.Enter();
-
-    // First, set head node if nullptr
-    if (ctx.head == nullptr)
-        ctx.head = node;
-
-    // Then add node to end of list
     node->next = nullptr;
-    if (ctx.tail != nullptr)
-        ctx.tail->next = node;
-    ctx.tail = node;
-
-    ctx.jobLock.Leave();
 
-    // Trigger threads to wake up and compete for jobs
-    for (Ptr<JobThread>& thread : ctx.threads)
-    {
-        thread->SignalWorkAvailable();
-    }
+    // Queue job, or park it on its wait counters
+    JobSchedule(node);
 }
 
 //------------------------------------------------------------------------------
@@ -369,27 +432,10 @@ JobDispatch(
     node->job.doneCounter = doneCounter;
     node->job.signalEvent = signalEvent;
     node->sequence = nullptr;
-
-    // Add to end of linked list
-    ctx.jobLock.Enter();
-
-    // First, set head node if nullptr
-    if (ctx.head == nullptr)
-        ctx.head = node;
-
-    // Then add node to end of list
     node->next = nullptr;
-    if (ctx.tail != nullptr)
-        ctx.tail->next = node;
-    ctx.tail = node;
-
-    ctx.jobLock.Leave();
 
-    // Trigger threads to wake up and compete for jobs
-    for (Ptr<JobThread>& thread : ctx.threads)
-    {
-        thread->SignalWorkAvailable();
-    }
+    // Queue job, or park it on its wait counters
+    JobSchedule(node);
 }
 
 //------------------------------------------------------------------------------
@@ -466,9 +512,6 @@ JobAppendSequence(const JobFunc& func, const SizeT numInvocations, const SizeT g
         sequenceTail->next = node;
 
     sequenceTail = node;
-
-    // Queue job
-    //ctx.queuedJobs.Append(node);
 }
 
 //------------------------------------------------------------------------------
@@ -552,9 +595,6 @@ JobAppendSequence(
         sequenceTail->next = node;
 
     sequenceTail = node;
-
-    // Queue job
-    //ctx.queuedJobs.Append(node);
 }
 
 //------------------------------------------------------------------------------
@@ -4,32 +4,145 @@
 //------------------------------------------------------------------------------
 
 #include "profiling/profiling.h"
+#include "io/fswrapper.h"
+#include "io/assignregistry.h"
 
 namespace Profiling
 {
 
 Util::Array<ProfilingContext> profilingContexts;
 Util::Array<ProfilingContext> profilingContextsLastFrame;
-Util::Array<Threading::CriticalSection*> contextMutexes;
+Util::Array<ProfilingEventStream*> profilingStreams;
 Util::Dictionary<Util::StringAtom, Util::Array<ProfilingScope>> scopesByCategory;
 Threading::CriticalSection categoryLock;
 Threading::AtomicCounter ProfilingContextCounter = 0;
-thread_local IndexT ProfilingContextIndex = InvalidIndex;
+thread_local ProfilingEventStream* ProfilingStream = nullptr;
+
+Timing::Timer profilingTimer;
+Timing::Time profilingFrameStart = 0;
+
+/// state of a running capture, only touched with the category lock taken
+struct ProfilingCapture
+{
+    IO::FSWrapper::Handle handle;
+    Util::FixedArray<char> buffer;
+    SizeT size = 0;
+    SizeT numNamedThreads = 0;
+    bool running = false;
+};
+ProfilingCapture profilingCapture;
+
+enum ProfilingCounterType : uint8_t
+{
+    UnusedSlot,                 // the slots following the first one of a histogram
+    CounterSlot,
+    BudgetCounterSlot,
+    HistogramSlot
+};
+
+// registered from static initializers, so these must not need any construction
+std::atomic<uint32_t> numCounterSlots = 0;
+const char* counterNames[ProfilingMaxCounterSlots];
+ProfilingCounterType counterTypes[ProfilingMaxCounterSlots];
+uint64_t counterBudgets[ProfilingMaxCounterSlots];
+int64_t counterResetValues[ProfilingMaxCounterSlots];
+
+Threading::CriticalSection counterLock;
+Util::Dictionary<const char*, uint64_t> counters;
+Util::Dictionary<const char*, Util::Pair<uint64_t, uint64_t>> budgetCounters;
+Util::Array<ProfilingCounterShard*> counterShards;
+thread_local ProfilingCounterShard* ProfilingThreadCounters = nullptr;
+
+#if __VC__
+#define PROFILING_NOINLINE __declspec(noinline)
+#else
+#define PROFILING_NOINLINE __attribute__((noinline))
+#endif
+
+// summed up counters, only touched with the category lock taken
+int64_t counterTotals[ProfilingMaxCounterSlots];
+int64_t counterFrameTotals[ProfilingMaxCounterSlots];       // totals at the last frame, for the histograms
+int64_t counterCaptureTotals[ProfilingMaxCounterSlots];     // totals at the start of the capture, for the histograms
+Util::Array<ProfilingHistogram> histograms;
+
+/// collects the events of all threads while the profiling is running
+class ProfilingCollector : public Threading::Thread
+{
+    __DeclareClass(ProfilingCollector);
+public:
+    /// collect events until stopped
+    void DoWork() override;
+};
+__ImplementClass(Profiling::ProfilingCollector, 'PRCO', Threading::Thread);
+Ptr<ProfilingCollector> profilingCollector;
+
+/// how long the collector sleeps between collecting events
+static const Timing::Time ProfilingCollectInterval = 0.002;
+/// size of the buffer holding the capture until it is written to the file
+static const SizeT ProfilingCaptureBufferSize = 256 * 1024;
+
+//------------------------------------------------------------------------------
+/**
+    Jobs can wait and resume on another thread, so the address of a thread local
+    must not be cached across a fiber switch. Keeping this out of line makes sure
+    the stream of the current thread is looked up every time.
+*/
+PROFILING_NOINLINE static ProfilingEventStream*
+ProfilingGetStream()
+{
+    return ProfilingStream;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+ProfilingWriteEvent(ProfilingEventStream* stream, ProfilingEventType type, const char* name, const char* category, const char* file, int line)
+{
+    uint32_t const write = stream->writeIndex.load(std::memory_order_relaxed);
+    ProfilingEvent& event = stream->events[write & (ProfilingEventStream::Capacity - 1)];
+    event.time = profilingTimer.GetTime();
+    event.name = name;
+    event.category = category;
+    event.file = file;
+    event.line = line;
+    event.type = type;
+    stream->writeIndex.store(write + 1, std::memory_order_release);
+}
 
 //------------------------------------------------------------------------------
 /**
 */
 void 
 ProfilingPushScope(const ProfilingScope& scope)
-{   
-    n_assert(ProfilingContextIndex != InvalidIndex);
-    contextMutexes[ProfilingContextIndex]->Enter();
+{
+    ProfilingPushScope(scope.name, scope.category.Value(), scope.file, scope.line, scope.accum);
+}
 
-    // get thread context
-    ProfilingContext& ctx = profilingContexts[ProfilingContextIndex];
+//------------------------------------------------------------------------------
+/**
+    Writes the begin event of the scope, if the ring still has room for it and the
+    end events of all scopes which are open. The end events can then never be dropped, 
+    and if a begin event is dropped, its end event is dropped too.
+*/
+void
+ProfilingPushScope(const char* name, const char* category, const char* file, int line, bool accum)
+{
+    ProfilingEventStream* stream = ProfilingGetStream();
+    n_assert(stream != nullptr);
+    n_assert(stream->depth < ProfilingEventStream::MaxDepth);
 
-    ctx.scopes.Push(scope);
-    ctx.scopes.Peek().start = ctx.timer.GetTime();
+    uint64_t const levelBit = 1ull << stream->depth++;
+    uint32_t const used = stream->writeIndex.load(std::memory_order_relaxed) - stream->readIndex.load(std::memory_order_acquire);
+    if (used + stream->numOpen + 2 > ProfilingEventStream::Capacity)
+    {
+        stream->droppedScopes |= levelBit;
+        stream->numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    stream->droppedScopes &= ~levelBit;
+    stream->numOpen++;
+    ProfilingWriteEvent(stream, accum ? BeginAccumScope : BeginScope, name, category, file, line);
 }
 
 //------------------------------------------------------------------------------
@@ -38,64 +151,391 @@ ProfilingPushScope(const ProfilingScope& scope)
 void
 ProfilingPopScope()
 {
-    n_assert(ProfilingContextIndex != InvalidIndex);
+    ProfilingEventStream* stream = ProfilingGetStream();
+    n_assert(stream != nullptr);
+    n_assert(stream->depth > 0);
+
+    uint64_t const levelBit = 1ull << --stream->depth;
+    if (stream->droppedScopes & levelBit)
+        return;
+    stream->numOpen--;
+    ProfilingWriteEvent(stream, EndScope, nullptr, nullptr, nullptr, -1);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Write the capture buffer to the capture file
+*/
+static void
+ProfilingFlushCapture()
+{
+    if (profilingCapture.size > 0)
+    {
+        IO::FSWrapper::Write(profilingCapture.handle, profilingCapture.buffer.Begin(), profilingCapture.size);
+        profilingCapture.size = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+ProfilingCaptureWrite(const char* str, SizeT length)
+{
+    if (profilingCapture.size + length > profilingCapture.buffer.Size())
+        ProfilingFlushCapture();
+    if (length > profilingCapture.buffer.Size())
+        IO::FSWrapper::Write(profilingCapture.handle, str, length);
+    else
+    {
+        Memory::Copy(str, profilingCapture.buffer.Begin() + profilingCapture.size, length);
+        profilingCapture.size += length;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+ProfilingCaptureFormat(const char* format, ...)
+{
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int const length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    n_assert(length >= 0 && length < (int)sizeof(line));
+    ProfilingCaptureWrite(line, length);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Write the contents of a JSON string, escaping quotes and backslashes
+*/
+static void
+ProfilingCaptureString(const char* str)
+{
+    const char* run = str;
+    for (const char* c = str; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            ProfilingCaptureWrite(run, SizeT(c - run));
+            ProfilingCaptureWrite("\\", 1);
+            run = c;
+        }
+    }
+    ProfilingCaptureWrite(run, (SizeT)strlen(run));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Write an event to the capture, as a Chrome trace duration event
+*/
+static void
+ProfilingCaptureEvent(const ProfilingEvent& event, IndexT thread)
+{
+    if (event.type == EndScope)
+    {
+        ProfilingCaptureFormat("{\"ph\":\"E\",\"pid\":0,\"tid\":%d,\"ts\":%.3f},\n", thread, event.time * 1000000.0);
+        return;
+    }
+    ProfilingCaptureFormat("{\"ph\":\"B\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"name\":\"", thread, event.time * 1000000.0);
+    ProfilingCaptureString(event.name);
+    ProfilingCaptureFormat("\",\"cat\":\"%s\",\"args\":{\"file\":\"", event.category);
+    ProfilingCaptureString(event.file);
+    ProfilingCaptureFormat("\",\"line\":%d}},\n", event.line);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Add a finished scope to its parent, or to the top level scopes
+*/
+static void
+ProfilingFinishScope(ProfilingContext& ctx, ProfilingScope& scope, Timing::Time end)
+{
+    scope.duration = end - scope.start;
+    scope.start -= profilingFrameStart;
 
-    // get thread context
-    ProfilingContext& ctx = profilingContexts[ProfilingContextIndex];
-    ProfilingScope scope = ctx.scopes.Pop();
-    
-    // add to category lookup
-    scope.duration = ctx.timer.GetTime() - scope.start;
+    Util::Array<ProfilingScope>& siblings = ctx.scopes.IsEmpty() ? ctx.topLevelScopes : ctx.scopes.Peek().children;
+    if (scope.accum && !siblings.IsEmpty() && siblings.Back().name == scope.name)
+        siblings.Back().duration += scope.duration;
+    else
+        siblings.Append(std::move(scope));
+}
 
-    // add to top level scopes if stack is empty
-    if (ctx.scopes.IsEmpty())
+//------------------------------------------------------------------------------
+/**
+    Drain the event streams of all threads, must be called with the category lock taken
+*/
+static void
+ProfilingCollect()
+{
+    if (profilingCapture.running)
     {
-        if (scope.accum)
+        // name the threads registered since the last collection
+        for (; profilingCapture.numNamedThreads < profilingContexts.Size(); profilingCapture.numNamedThreads++)
         {
-            if (!ctx.topLevelScopes.IsEmpty())
+            ProfilingCaptureFormat("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"", profilingCapture.numNamedThreads);
+            ProfilingCaptureString(profilingContexts[profilingCapture.numNamedThreads].threadName.Value());
+            ProfilingCaptureWrite("\"}},\n", 5);
+        }
+    }
+
+    for (IndexT i = 0; i < profilingContexts.Size(); i++)
+    {
+        ProfilingContext& ctx = profilingContexts[i];
+        ProfilingEventStream* stream = profilingStreams[i];
+        uint32_t read = stream->readIndex.load(std::memory_order_relaxed);
+        uint32_t const write = stream->writeIndex.load(std::memory_order_acquire);
+        for (; read != write; read++)
+        {
+            const ProfilingEvent& event = stream->events[read & (ProfilingEventStream::Capacity - 1)];
+            if (profilingCapture.running)
+                ProfilingCaptureEvent(event, i);
+
+            if (event.type == EndScope)
             {
-                ProfilingScope& parent = ctx.topLevelScopes.Back();
-                if (parent.name == scope.name)
-                    parent.duration += scope.duration;
-                else
-                    ctx.topLevelScopes.Append(scope);
+                ProfilingScope scope = ctx.scopes.Pop();
+                ProfilingFinishScope(ctx, scope, event.time);
             }
             else
-                ctx.topLevelScopes.Append(scope);
+            {
+                ctx.scopes.Push(ProfilingScope(event.name, event.category, event.file, event.line, event.type == BeginAccumScope));
+                ctx.scopes.Peek().start = event.time;
+            }
         }
-        else
-            ctx.topLevelScopes.Append(scope);
+        stream->readIndex.store(read, std::memory_order_release);
     }
-    else
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static ProfilingCounter
+ProfilingAllocCounterSlots(const char* name, ProfilingCounterType type, uint32_t numSlots)
+{
+    uint32_t const slot = numCounterSlots.fetch_add(numSlots);
+    n_assert2(slot + numSlots <= ProfilingMaxCounterSlots, "Out of profiling counter slots, increase ProfilingMaxCounterSlots");
+    counterNames[slot] = name;
+    counterTypes[slot] = type;
+    return ProfilingCounter{ name, slot };
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+ProfilingCounter
+ProfilingRegisterCounter(const char* name)
+{
+    return ProfilingAllocCounterSlots(name, CounterSlot, 1);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+ProfilingCounter
+ProfilingRegisterHistogram(const char* name)
+{
+    return ProfilingAllocCounterSlots(name, HistogramSlot, 2 + ProfilingHistogramBuckets);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Scopes must be closed on the thread which opened them, so a job must not
+    wait for a counter while it has a scope open.
+*/
+uint32_t
+ProfilingGetScopeDepth()
+{
+    ProfilingEventStream* stream = ProfilingGetStream();
+    return stream != nullptr ? stream->depth : 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+    The shards are never freed, so the counts of finished threads are kept
+*/
+static ProfilingCounterShard*
+ProfilingCreateCounterShard()
+{
+    n_assert(ProfilingThreadCounters == nullptr);
+    ProfilingThreadCounters = new ProfilingCounterShard;
+    for (uint32_t i = 0; i < ProfilingMaxCounterSlots; i++)
+        ProfilingThreadCounters->values[i].store(0, std::memory_order_relaxed);
+
+    Threading::CriticalScope lock(&counterLock);
+    counterShards.Append(ProfilingThreadCounters);
+    return ProfilingThreadCounters;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Out of line for the same reason as ProfilingGetStream, the shard has a single
+    writer only as long as it is looked up after every possible fiber switch.
+*/
+PROFILING_NOINLINE ProfilingCounterShard*
+ProfilingGetCounterShard()
+{
+    return ProfilingThreadCounters != nullptr ? ProfilingThreadCounters : ProfilingCreateCounterShard();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static int64_t
+ProfilingSumCounterSlot(uint32_t slot)
+{
+    int64_t sum = 0;
+    for (ProfilingCounterShard* shard : counterShards)
+        sum += shard->values[slot].load(std::memory_order_relaxed);
+    return sum;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Sums up the counter slots of all threads into counterTotals
+*/
+static void
+ProfilingSumCounters()
+{
+    Threading::CriticalScope lock(&counterLock);
+    uint32_t const numSlots = numCounterSlots.load(std::memory_order_relaxed);
+    for (uint32_t slot = 0; slot < numSlots; slot++)
+        counterTotals[slot] = ProfilingSumCounterSlot(slot);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+ProfilingCaptureCounter(const char* name, const char* args, ...)
+{
+    ProfilingCaptureFormat("{\"ph\":\"C\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"name\":\"", profilingFrameStart * 1000000.0);
+    ProfilingCaptureString(name);
+    ProfilingCaptureWrite("\",\"args\":{", 10);
+
+    char line[256];
+    va_list list;
+    va_start(list, args);
+    int const length = vsnprintf(line, sizeof(line), args, list);
+    va_end(list);
+    n_assert(length >= 0 && length < (int)sizeof(line));
+    ProfilingCaptureWrite(line, length);
+    ProfilingCaptureWrite("}},\n", 4);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Update the counter tables from the summed up counters, and add them to the capture
+*/
+static void
+ProfilingReportCounters()
+{
+    histograms.Clear();
+    uint32_t const numSlots = numCounterSlots.load(std::memory_order_relaxed);
+    for (uint32_t slot = 0; slot < numSlots; slot++)
     {
-        // add as child scope
-        ProfilingScope& parent = ctx.scopes.Peek();
-        if (scope.accum && parent.name == scope.name)
-            parent.duration += scope.duration;
-        else
-            parent.children.Append(scope);
+        const char* name = counterNames[slot];
+        switch (counterTypes[slot])
+        {
+            case CounterSlot:
+            {
+                // counters only show up once they have been used
+                uint64_t const value = (uint64_t)counterTotals[slot];
+                IndexT const index = counters.FindIndex(name);
+                if (index != InvalidIndex)
+                    counters.ValueAtIndex(index) = value;
+                else if (value != 0)
+                    counters.Add(name, value);
+                if (profilingCapture.running)
+                    ProfilingCaptureCounter(name, "\"value\":%lld", (long long)value);
+                break;
+            }
+            case BudgetCounterSlot:
+            {
+                uint64_t const value = (uint64_t)(counterTotals[slot] - counterResetValues[slot]);
+                budgetCounters[name] = Util::MakePair(counterBudgets[slot], value);
+                if (profilingCapture.running)
+                    ProfilingCaptureCounter(name, "\"value\":%lld,\"budget\":%lld", (long long)value, (long long)counterBudgets[slot]);
+                break;
+            }
+            case HistogramSlot:
+            {
+                ProfilingHistogram histogram;
+                histogram.name = name;
+                histogram.count = (uint64_t)(counterTotals[slot] - counterFrameTotals[slot]);
+                histogram.sum = (uint64_t)(counterTotals[slot + 1] - counterFrameTotals[slot + 1]);
+                for (uint32_t i = 0; i < ProfilingHistogramBuckets; i++)
+                    histogram.buckets[i] = (uint64_t)(counterTotals[slot + 2 + i] - counterFrameTotals[slot + 2 + i]);
+                histograms.Append(histogram);
+                if (profilingCapture.running)
+                    ProfilingCaptureCounter(name, "\"count\":%lld,\"mean\":%.3f", (long long)histogram.count, histogram.count > 0 ? histogram.sum / double(histogram.count) : 0.0);
+                break;
+            }
+            default:
+                break;
+        }
+        counterFrameTotals[slot] = counterTotals[slot];
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Add the histograms of all values since the capture started to the capture
+*/
+static void
+ProfilingCaptureHistograms()
+{
+    uint32_t const numSlots = numCounterSlots.load(std::memory_order_relaxed);
+    for (uint32_t slot = 0; slot < numSlots; slot++)
+    {
+        if (counterTypes[slot] != HistogramSlot)
+            continue;
+        ProfilingCaptureFormat("{\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"name\":\"", profilingTimer.GetTime() * 1000000.0);
+        ProfilingCaptureString(counterNames[slot]);
+        ProfilingCaptureFormat("\",\"args\":{\"count\":%lld,\"sum\":%lld,\"buckets\":["
+            , (long long)(counterTotals[slot] - counterCaptureTotals[slot])
+            , (long long)(counterTotals[slot + 1] - counterCaptureTotals[slot + 1]));
+        for (uint32_t i = 0; i < ProfilingHistogramBuckets; i++)
+            ProfilingCaptureFormat(i == 0 ? "%lld" : ",%lld", (long long)(counterTotals[slot + 2 + i] - counterCaptureTotals[slot + 2 + i]));
+        ProfilingCaptureWrite("]}},\n", 5);
     }
-    contextMutexes[ProfilingContextIndex]->Leave();
 }
 
 //------------------------------------------------------------------------------
 /**
 */
 void
-ProfilingNewFrame()
+ProfilingCollector::DoWork()
 {
-    // get thread context
-    //ProfilingContext& ctx = profilingContexts[ProfilingContextIndex];
-    //n_assert(ctx.threadName == "MainThread");
+    while (!this->ThreadStopRequested())
+    {
+        Core::SysFunc::Sleep(ProfilingCollectInterval);
+        Threading::CriticalScope lock(&categoryLock);
+        ProfilingCollect();
+    }
+}
 
+//------------------------------------------------------------------------------
+/**
+    Collects the events written so far, and hands the scopes finished during the
+    frame over to ProfilingGetContexts. Scopes still open continue in the next frame.
+*/
+void
+ProfilingNewFrame()
+{
+    Threading::CriticalScope lock(&categoryLock);
+    ProfilingCollect();
     for (IndexT i = 0; i < profilingContexts.Size(); i++)
     {
-        Threading::CriticalScope lock(contextMutexes[i]);
-        profilingContextsLastFrame[i] = profilingContexts[i];
-        n_assert(profilingContexts[i].scopes.IsEmpty());
+        profilingContextsLastFrame[i].topLevelScopes = std::move(profilingContexts[i].topLevelScopes);
         profilingContexts[i].topLevelScopes.Clear();
-        profilingContexts[i].timer.Reset();
     }
+    profilingFrameStart = profilingTimer.GetTime();
+
+    ProfilingSumCounters();
+    ProfilingReportCounters();
 }
 
 //------------------------------------------------------------------------------
@@ -104,153 +544,182 @@ ProfilingNewFrame()
 Timing::Time 
 ProfilingGetTime()
 {
-    // get current context and return time
-    ProfilingContext& ctx = profilingContexts[ProfilingContextIndex];
-    return ctx.timer.GetTime();
+    return profilingTimer.GetTime() - profilingFrameStart;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Timing::Time
+ProfilingGetTimestamp()
+{
+    return profilingTimer.GetTime();
 }
 
 //------------------------------------------------------------------------------
 /**
+    Creates the event stream of the calling thread, and starts the collector with
+    the first registered thread.
 */
 void 
 ProfilingRegisterThread(int priority)
 {
     // make sure we don't add contexts simulatenously
     Threading::CriticalScope lock(&categoryLock);
-    ProfilingContextIndex = Threading::Interlocked::Add(&ProfilingContextCounter, 1);
+    n_assert(ProfilingStream == nullptr);
+    Threading::Interlocked::Add(&ProfilingContextCounter, 1);
     profilingContexts.Append(ProfilingContext(priority));
-    profilingContextsLastFrame.Append(ProfilingContext());
-    profilingContexts.Back().timer.Start();
-    contextMutexes.Append(new Threading::CriticalSection);
+    profilingContextsLastFrame.Append(profilingContexts.Back());
+    ProfilingStream = new ProfilingEventStream;
+    profilingStreams.Append(ProfilingStream);
+
+    if (!profilingTimer.Running())
+    {
+        profilingTimer.Start();
+        profilingCollector = ProfilingCollector::Create();
+        profilingCollector->SetName("ProfilingCollector");
+        profilingCollector->SetPriority(Threading::Thread::Low);
+        profilingCollector->Start();
+    }
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-const Util::Array<ProfilingScope>&
-ProfilingGetScopes(Threading::ThreadId thread)
+void
+ProfilingShutdown()
 {
-#if NEBULA_DEBUG
-    n_assert(profilingContextsLastFrame[thread].topLevelScopes.IsEmpty());
-#endif
-    Threading::CriticalScope lock(&categoryLock);
-    return profilingContextsLastFrame[thread].topLevelScopes;
+    ProfilingStopCapture();
+    if (profilingCollector.isvalid())
+    {
+        profilingCollector->Stop();
+        profilingCollector = nullptr;
+    }
 }
 
 //------------------------------------------------------------------------------
 /**
+    The events are written in the JSON array format, where the closing bracket is
+    optional, so the file stays readable even if the capture is never stopped.
 */
-const Util::Array<ProfilingContext>
-ProfilingGetContexts()
+bool
+ProfilingStartCapture(const IO::URI& uri)
 {
-    return profilingContextsLastFrame;
+    Threading::CriticalScope lock(&categoryLock);
+    n_assert(!profilingCapture.running);
+
+    // drop the events so far, the capture starts with the next ones
+    ProfilingCollect();
+
+    IO::URI const path = IO::AssignRegistry::HasInstance() ? IO::AssignRegistry::Instance()->ResolveAssigns(uri) : uri;
+    profilingCapture.handle = IO::FSWrapper::OpenFile(path.GetHostAndLocalPath(), IO::Stream::WriteAccess, IO::Stream::Sequential);
+    if (profilingCapture.handle == IO::FSWrapper::Handle(0))
+    {
+        n_warning("ProfilingStartCapture: could not open '%s'\n", path.AsString().AsCharPtr());
+        return false;
+    }
+    profilingCapture.buffer.Resize(ProfilingCaptureBufferSize);
+    profilingCapture.numNamedThreads = 0;
+    profilingCapture.running = true;
+    ProfilingCaptureWrite("[\n", 2);
+
+    ProfilingSumCounters();
+    Memory::Copy(counterTotals, counterCaptureTotals, sizeof(counterTotals));
+    return true;
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-void 
-ProfilingClear()
+void
+ProfilingStopCapture()
 {
-    for (IndexT i = 0; i < profilingContexts.Size(); i++)
-    {
-        n_assert(profilingContexts[i].scopes.Size() == 0);
-        profilingContexts[i].topLevelScopes.Reset();
-    }
-}
+    Threading::CriticalScope lock(&categoryLock);
+    if (!profilingCapture.running)
+        return;
 
-Threading::CriticalSection counterLock;
-Util::Dictionary<const char*, uint64_t> counters;
-Util::Dictionary<const char*, Util::Pair<uint64_t, uint64_t>> budgetCounters;
+    ProfilingCollect();
+    ProfilingSumCounters();
+    ProfilingCaptureHistograms();
+    ProfilingCaptureWrite("{}\n]\n", 5);
+    ProfilingFlushCapture();
+    IO::FSWrapper::CloseFile(profilingCapture.handle);
+    profilingCapture.running = false;
+}
 
 //------------------------------------------------------------------------------
 /**
 */
-void 
-ProfilingIncreaseCounter(const char* id, uint64_t value)
+bool
+ProfilingIsCapturing()
 {
-    counterLock.Enter();
-    IndexT idx = counters.FindIndex(id);
-    if (idx == InvalidIndex)
-        counters.Add(id, value);
-    else
-    {
-        counters.ValueAtIndex(idx) += value;
-    }
-    counterLock.Leave();
+    return profilingCapture.running;
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-void 
-ProfilingDecreaseCounter(const char* id, uint64_t value)
+const Util::Array<ProfilingScope>&
+ProfilingGetScopes(Threading::ThreadId thread)
 {
-    counterLock.Enter();
-    IndexT idx = counters.FindIndex(id);
-    n_assert(idx != InvalidIndex);
-    counters.ValueAtIndex(idx) -= value;
-    counterLock.Leave();
+    Threading::CriticalScope lock(&categoryLock);
+    return profilingContextsLastFrame[thread].topLevelScopes;
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-const Util::Dictionary<const char*, uint64_t>&
-ProfilingGetCounters()
+const Util::Array<ProfilingContext>
+ProfilingGetContexts()
 {
-    return counters;
+    Threading::CriticalScope lock(&categoryLock);
+    return profilingContextsLastFrame;
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-void
-ProfilingSetupBudgetCounter(const char* id, uint64_t budget)
+void 
+ProfilingClear()
 {
-    counterLock.Enter();
-
-    // Add budget
-    IndexT idx = budgetCounters.FindIndex(id);
-    n_assert(idx == InvalidIndex);
-    budgetCounters.Add(id, { budget, 0 });
-
-    counterLock.Leave();
+    Threading::CriticalScope lock(&categoryLock);
+    for (IndexT i = 0; i < profilingContexts.Size(); i++)
+    {
+        profilingContexts[i].topLevelScopes.Reset();
+        profilingContextsLastFrame[i].topLevelScopes.Reset();
+    }
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-void
-ProfilingBudgetIncreaseCounter(const char* id, uint64_t value)
+const Util::Dictionary<const char*, uint64_t>&
+ProfilingGetCounters()
 {
-    IndexT idx = budgetCounters.FindIndex(id);
-    n_assert(idx != InvalidIndex);
-    budgetCounters.ValueAtIndex(idx).second += value;
+    return counters;
 }
 
 //------------------------------------------------------------------------------
 /**
 */
 void
-ProfilingBudgetDecreaseCounter(const char* id, uint64_t value)
+ProfilingSetupBudgetCounter(const ProfilingCounter& counter, uint64_t budget)
 {
-    IndexT idx = budgetCounters.FindIndex(id);
-    n_assert(idx != InvalidIndex);
-    budgetCounters.ValueAtIndex(idx).second -= value;
+    n_assert(counterTypes[counter.slot] == CounterSlot);
+    counterBudgets[counter.slot] = budget;
+    counterTypes[counter.slot] = BudgetCounterSlot;
 }
 
 //------------------------------------------------------------------------------
 /**
+    Counts from now on, by remembering the current value of the counter
 */
 void
-ProfilingBudgetResetCounter(const char* id)
+ProfilingBudgetResetCounter(const ProfilingCounter& counter)
 {
-    IndexT idx = budgetCounters.FindIndex(id);
-    n_assert(idx != InvalidIndex);
-
-    // Just reset the counter to budget
-    budgetCounters.ValueAtIndex(idx).second = 0;
+    n_assert(counterTypes[counter.slot] == BudgetCounterSlot);
+    Threading::CriticalScope lock(&counterLock);
+    counterResetValues[counter.slot] = ProfilingSumCounterSlot(counter.slot);
 }
 
 //------------------------------------------------------------------------------
@@ -262,4 +731,13 @@ ProfilingGetBudgetCounters()
     return budgetCounters;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+const Util::Array<ProfilingHistogram>&
+ProfilingGetHistograms()
+{
+    return histograms;
+}
+
 } // namespace Profiling
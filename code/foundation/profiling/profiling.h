@@ -3,6 +3,24 @@
 /**
     Profiling interface
 
+    Scopes are recorded as a stream of fixed-size begin and end events, which every
+    registered thread writes to its own ring buffer without taking any locks. A
+    background thread collects the events, rebuilds the scope trees returned by
+    ProfilingGetContexts and ProfilingGetScopes, and while a capture is running,
+    writes the events to a file in the Chrome trace event format, which can be
+    opened in chrome://tracing or Perfetto. A scope has to end on the thread it
+    started on, so jobs must not call JobWait with a scope open, since they might
+    resume on another thread. JobWait asserts this.
+
+    Events only keep the pointers to their names, so scope names have to outlive
+    the capture. The static scopes use string literals, and the dynamic ones
+    intern their names as string atoms.
+
+    Counters and histograms are declared once with N_DECLARE_COUNTER and 
+    N_DECLARE_HISTOGRAM, which gives them fixed slots. Every thread adds to its own
+    copy of the slots without any locks or atomic read-modify-write operations, and
+    the copies are summed up in ProfilingNewFrame.
+
     @copyright
     (C) 2020 Individual contributors, see AUTHORS file
 */
@@ -15,6 +33,8 @@
 #include "util/tupleutility.h"
 #include "threading/thread.h"
 #include "threading/criticalsection.h"
+#include "io/uri.h"
+#include "util/bit.h"
 #include <atomic>
 
 //------------------------------------------------------------------------------
@@ -28,11 +48,11 @@
 // use these macros to insert markers
 #if NEBULA_ENABLE_PROFILING
 #define N_SCOPE(name, cat)              Profiling::ProfilingScopeLock __##name##cat##scope__(#name, #cat, __FILE__, __LINE__);
-#define N_SCOPE_DYN(str, cat)           Profiling::ProfilingScopeLock __dynscope##cat##__(str, #cat, __FILE__, __LINE__);
+#define N_SCOPE_DYN(str, cat)           Profiling::ProfilingScopeLock __dynscope##cat##__(Util::StringAtom(str).Value(), #cat, __FILE__, __LINE__);
 #define N_SCOPE_ACCUM(name, cat)        Profiling::ProfilingScopeLock __##name##cat##scope__(#name, #cat, __FILE__, __LINE__, true);
 #define N_SCOPE_DYN_ACCUM(name, cat)    Profiling::ProfilingScopeLock __##name##cat##scope__(#name, #cat, __FILE__, __LINE__, true);
-#define N_MARKER_BEGIN(name, cat)       { Profiling::ProfilingScope __##name##cat##scope__ = {#name, #cat, __FILE__, __LINE__, false}; Profiling::ProfilingPushScope(__##name##cat##scope__); }
-#define N_MARKER_DYN_BEGIN(str, cat)    { Profiling::ProfilingScope __dynmarker##cat##__ = {str, #cat, __FILE__, __LINE__, false}; Profiling::ProfilingPushScope(__dynmarker##cat##__); }
+#define N_MARKER_BEGIN(name, cat)       { Profiling::ProfilingPushScope(#name, #cat, __FILE__, __LINE__, false); }
+#define N_MARKER_DYN_BEGIN(str, cat)    { Profiling::ProfilingPushScope(Util::StringAtom(str).Value(), #cat, __FILE__, __LINE__, false); }
 #define N_MARKER_END()                  { Profiling::ProfilingPopScope(); }
 #define N_COUNTER_INCR(name, value)     Profiling::ProfilingIncreaseCounter(name, value);
 #define N_COUNTER_DECR(name, value)     Profiling::ProfilingDecreaseCounter(name, value);
@@ -40,17 +60,28 @@
 #define N_BUDGET_COUNTER_INCR(name, value) Profiling::ProfilingBudgetIncreaseCounter(name, value);
 #define N_BUDGET_COUNTER_DECR(name, value) Profiling::ProfilingBudgetDecreaseCounter(name, value);
 #define N_BUDGET_COUNTER_RESET(name) Profiling::ProfilingBudgetResetCounter(name);
-#define N_DECLARE_COUNTER(name, label)  static const char* name = #label;
+#define N_DECLARE_COUNTER(name, label)  static const Profiling::ProfilingCounter name = Profiling::ProfilingRegisterCounter(#label);
+#define N_DECLARE_HISTOGRAM(name, label) static const Profiling::ProfilingCounter name = Profiling::ProfilingRegisterHistogram(#label);
+#define N_HISTOGRAM_ADD(name, value)    Profiling::ProfilingAddHistogramValue(name, value);
+#define N_HISTOGRAM_TIMER(name)         Profiling::ProfilingHistogramTimer __##name##timer__(name);
 #else
 #define N_SCOPE(name, cat)
 #define N_SCOPE_DYN(str, cat)
 #define N_SCOPE_ACCUM(name, cat)
 #define N_SCOPE_DYN_ACCUM(name, cat)
 #define N_MARKER_BEGIN(name, cat)
+#define N_MARKER_DYN_BEGIN(str, cat)
 #define N_MARKER_END()
 #define N_COUNTER_INCR(name, value)
 #define N_COUNTER_DECR(name, value)
+#define N_BUDGET_COUNTER_SETUP(name, budget)
+#define N_BUDGET_COUNTER_INCR(name, value)
+#define N_BUDGET_COUNTER_DECR(name, value)
+#define N_BUDGET_COUNTER_RESET(name)
 #define N_DECLARE_COUNTER(name, label)
+#define N_DECLARE_HISTOGRAM(name, label)
+#define N_HISTOGRAM_ADD(name, value)
+#define N_HISTOGRAM_TIMER(name)
 #endif
 
 namespace Profiling
@@ -59,17 +90,34 @@ namespace Profiling
 struct ProfilingScope;
 struct ProfilingContext;
 
+struct ProfilingEventStream;
+
 /// push scope to scope stack
 void ProfilingPushScope(const ProfilingScope& scope);
+/// push scope to scope stack, the strings have to outlive the profiling session
+void ProfilingPushScope(const char* name, const char* category, const char* file, int line, bool accum);
 /// pop scope from scope stack
 void ProfilingPopScope();
+/// get the number of scopes open on the calling thread
+uint32_t ProfilingGetScopeDepth();
 /// pushes an 'end of frame' marker, only available on the main thread
 void ProfilingNewFrame();
 /// get current frametime
 Timing::Time ProfilingGetTime();
+/// get time since the profiling started, for measuring durations across frames
+Timing::Time ProfilingGetTimestamp();
 
 /// register a new thread for the profiling
 void ProfilingRegisterThread(int priority = 0);
+/// stop the event collection and any running capture
+void ProfilingShutdown();
+
+/// start writing all events to a Chrome trace event file, until the capture is stopped
+bool ProfilingStartCapture(const IO::URI& uri);
+/// stop writing events and close the capture file
+void ProfilingStopCapture();
+/// returns true if a capture is running
+bool ProfilingIsCapturing();
 
 /// get all top level scopes based on thread, only run when you know the thread is finished
 const Util::Array<ProfilingScope>& ProfilingGetScopes(Threading::ThreadId thread);
@@ -79,31 +127,70 @@ const Util::Array<ProfilingContext> ProfilingGetContexts();
 void ProfilingClear();
 
 extern Util::Array<ProfilingContext> profilingContexts;
-extern Util::Array<Threading::CriticalSection*> contextMutexes;
+extern Util::Array<ProfilingEventStream*> profilingStreams;
 extern Util::Dictionary<Util::StringAtom, Util::Array<ProfilingScope>> scopesByCategory;
 extern Threading::CriticalSection categoryLock;
 
 /// atomic counter used to give each thread a unique id
 extern Threading::AtomicCounter ProfilingContextCounter;
 
+/// number of slots for all counters and histograms
+static const uint32_t ProfilingMaxCounterSlots = 1024;
+/// number of buckets in a histogram, the last one holds all larger values too
+static const uint32_t ProfilingHistogramBuckets = 32;
+
+/// handle to the slots of a counter or histogram
+struct ProfilingCounter
+{
+    const char* name;
+    uint32_t slot;
+};
+
+/// a histogram of the values added during a frame, with power of two buckets
+struct ProfilingHistogram
+{
+    const char* name;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t buckets[ProfilingHistogramBuckets];    // bucket 0 counts zeros, bucket i values in [2^(i-1), 2^i)
+};
+
+/// the counter slots as seen by a single thread
+struct ProfilingCounterShard
+{
+    std::atomic<int64_t> values[ProfilingMaxCounterSlots];
+};
+/// get the counter slots of the calling thread, creates them on first use
+ProfilingCounterShard* ProfilingGetCounterShard();
+
+/// register a counter, done through N_DECLARE_COUNTER
+ProfilingCounter ProfilingRegisterCounter(const char* name);
+/// register a histogram, done through N_DECLARE_HISTOGRAM
+ProfilingCounter ProfilingRegisterHistogram(const char* name);
+
 /// increment profiling counter
-void ProfilingIncreaseCounter(const char* id, uint64_t value);
+void ProfilingIncreaseCounter(const ProfilingCounter& counter, uint64_t value);
 /// decrement profiling counter
-void ProfilingDecreaseCounter(const char* id, uint64_t value);
-/// return table of counters
+void ProfilingDecreaseCounter(const ProfilingCounter& counter, uint64_t value);
+/// return table of counters, summed up at the last new frame
 const Util::Dictionary<const char*, uint64_t>& ProfilingGetCounters();
 
 /// Setup a profiling budget counter
-void ProfilingSetupBudgetCounter(const char* id, uint64_t budget);
+void ProfilingSetupBudgetCounter(const ProfilingCounter& counter, uint64_t budget);
 /// Increment budget counter
-void ProfilingBudgetIncreaseCounter(const char* id, uint64_t value);
+void ProfilingBudgetIncreaseCounter(const ProfilingCounter& counter, uint64_t value);
 /// Decrement budget counter
-void ProfilingBudgetDecreaseCounter(const char* id, uint64_t value);
+void ProfilingBudgetDecreaseCounter(const ProfilingCounter& counter, uint64_t value);
 /// Reset budget counter
-void ProfilingBudgetResetCounter(const char* id);
-/// Return set of budget counters
+void ProfilingBudgetResetCounter(const ProfilingCounter& counter);
+/// Return set of budget counters, as budget and value at the last new frame
 const Util::Dictionary<const char*, Util::Pair<uint64_t, uint64_t>>& ProfilingGetBudgetCounters();
 
+/// add a value to a histogram
+void ProfilingAddHistogramValue(const ProfilingCounter& histogram, uint64_t value);
+/// return the histograms of the values added during the last frame
+const Util::Array<ProfilingHistogram>& ProfilingGetHistograms();
+
 extern Threading::CriticalSection counterLock;
 extern Util::Dictionary<const char*, Util::Pair<uint64_t, uint64_t>> budgetCounters;
 extern Util::Dictionary<const char*, uint64_t> counters;
@@ -147,14 +234,9 @@ struct ProfilingScope
 struct ProfilingScopeLock
 {
     /// constructor
-    ProfilingScopeLock(const char* name, Util::StringAtom category, const char* file, int line, bool accum = false)
+    ProfilingScopeLock(const char* name, const char* category, const char* file, int line, bool accum = false)
     {
-        scope.name = name;
-        scope.category = category;
-        scope.file = file;
-        scope.line = line;
-        scope.accum = accum;
-        ProfilingPushScope(scope);
+        ProfilingPushScope(name, category, file, line, accum);
     }
 
     /// destructor
@@ -162,7 +244,42 @@ struct ProfilingScopeLock
     {
         ProfilingPopScope();
     }
-    ProfilingScope scope;
+};
+
+enum ProfilingEventType : uint8_t
+{
+    BeginScope,
+    BeginAccumScope,
+    EndScope
+};
+
+/// a single begin or end of a scope, as written to the event streams
+struct ProfilingEvent
+{
+    Timing::Time time;
+    const char* name;
+    const char* category;
+    const char* file;
+    int line;
+    ProfilingEventType type;
+};
+
+/// ring buffer of events, written by a single thread and read by the collector
+struct ProfilingEventStream
+{
+    /// number of events in the ring, a power of two
+    static const uint32_t Capacity = 16384;
+    /// deepest nesting of scopes which can be dropped
+    static const uint32_t MaxDepth = 64;
+
+    ProfilingEvent events[Capacity];
+    std::atomic<uint32_t> writeIndex = 0;   // written by the owning thread only
+    std::atomic<uint32_t> readIndex = 0;    // written by the collector only
+    std::atomic<uint32_t> numDropped = 0;   // begin events dropped because the ring was full
+
+    uint32_t depth = 0;                     // nesting of open scopes, dropped or not
+    uint32_t numOpen = 0;                   // written begin events still waiting for their end event
+    uint64_t droppedScopes = 0;             // per nesting level, set if the begin event was dropped
 };
 
 /// thread context of profiling
@@ -173,14 +290,94 @@ struct ProfilingContext
         , threadId(Threading::Thread::GetMyThreadId())
         , priority(priority)
     {};
-    Util::Stack<ProfilingScope> scopes;
+    Util::Stack<ProfilingScope> scopes;         // scopes waiting for their end event, started at absolute times
     Util::Array<ProfilingScope> topLevelScopes;
 
-    Timing::Timer timer;
-    Timing::Time start;
     Util::StringAtom threadName;
     Threading::ThreadId threadId;
     int priority = 0;
 };
 
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+ProfilingAddToCounterSlot(uint32_t slot, int64_t value)
+{
+    ProfilingCounterShard* shard = ProfilingGetCounterShard();
+
+    // only this thread writes to its shard, so there is no need for an atomic add
+    std::atomic<int64_t>& slotValue = shard->values[slot];
+    slotValue.store(slotValue.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+ProfilingIncreaseCounter(const ProfilingCounter& counter, uint64_t value)
+{
+    ProfilingAddToCounterSlot(counter.slot, (int64_t)value);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+ProfilingDecreaseCounter(const ProfilingCounter& counter, uint64_t value)
+{
+    ProfilingAddToCounterSlot(counter.slot, -(int64_t)value);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+ProfilingBudgetIncreaseCounter(const ProfilingCounter& counter, uint64_t value)
+{
+    ProfilingAddToCounterSlot(counter.slot, (int64_t)value);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+ProfilingBudgetDecreaseCounter(const ProfilingCounter& counter, uint64_t value)
+{
+    ProfilingAddToCounterSlot(counter.slot, -(int64_t)value);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Histograms use a slot for the number of values, one for their sum, and one per bucket
+*/
+inline void
+ProfilingAddHistogramValue(const ProfilingCounter& histogram, uint64_t value)
+{
+    uint32_t bucket = value == 0 ? 0 : Util::LastBitSetIndex(value) + 1;
+    if (bucket >= ProfilingHistogramBuckets)
+        bucket = ProfilingHistogramBuckets - 1;
+    ProfilingAddToCounterSlot(histogram.slot, 1);
+    ProfilingAddToCounterSlot(histogram.slot + 1, (int64_t)value);
+    ProfilingAddToCounterSlot(histogram.slot + 2 + bucket, 1);
+}
+
+/// convenience class adding the lifetime of a scope in microseconds to a histogram
+struct ProfilingHistogramTimer
+{
+    /// constructor
+    ProfilingHistogramTimer(const ProfilingCounter& histogram)
+        : histogram(histogram)
+        , start(ProfilingGetTimestamp())
+    {}
+
+    /// destructor
+    ~ProfilingHistogramTimer()
+    {
+        ProfilingAddHistogramValue(this->histogram, uint64_t((ProfilingGetTimestamp() - this->start) * 1000000.0));
+    }
+    const ProfilingCounter& histogram;
+    Timing::Time start;
+};
+
 } // namespace Profiling
@@ -4,7 +4,12 @@
 //------------------------------------------------------------------------------
 #include "foundation/stdneb.h"
 #include "posixprocess.h"
+#include "util/fixedarray.h"
 #include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <unistd.h>
 
 namespace Posix
 {
@@ -15,36 +20,95 @@ using namespace IO;
 /**
 */
 PosixProcess::PosixProcess() :
-    pid(-1),
-    inPipe(-1),
     outPipe(-1),
-    errPipe(-1)
+    errPipe(-1),
+    pid(-1)
 {
     // empty
 }
 
 //------------------------------------------------------------------------------
 /**
+    Launch the application and wait until it has exited, the captured output is
+    read while the application runs.
 */
 bool
 PosixProcess::LaunchWait() const
 {
-    if(this->Launch())
+    pid_t childPid;
+    int stdoutPipe;
+    int stderrPipe;
+    if (!this->Spawn(childPid, stdoutPipe, stderrPipe))
     {
-        int status;
-        if(waitpid(this->pid,&status,0) > 0)
+        return false;
+    }
+
+    // read both pipes until the child closes them, so it never blocks on a full pipe
+    const Ptr<Stream>* streams[2] = { &this->stdoutCaptureStream, &this->stderrCaptureStream };
+    struct pollfd fds[2];
+    fds[0].fd = stdoutPipe;
+    fds[1].fd = stderrPipe;
+    int numOpen = 0;
+    IndexT i;
+    for (i = 0; i < 2; i++)
+    {
+        fds[i].events = POLLIN;
+        if (fds[i].fd >= 0)
         {
-            this->CleanUp();
-            return true;
+            (*streams[i])->SetAccessMode(Stream::WriteAccess);
+            (*streams[i])->Open();
+            numOpen++;
+        }
+    }
+    char buffer[4096];
+    while (numOpen > 0)
+    {
+        if (poll(fds, 2, -1) < 0 && errno != EINTR)
+        {
+            break;
         }
-        else
+        for (i = 0; i < 2; i++)
         {
-            this->CleanUp();
-            n_error("Failed on waitpid\n");
-            return false;
+            if (fds[i].fd >= 0 && fds[i].revents != 0)
+            {
+                ssize_t bytesRead = read(fds[i].fd, buffer, sizeof(buffer));
+                if (bytesRead > 0)
+                {
+                    (*streams[i])->Write(buffer, (Stream::Size)bytesRead);
+                }
+                else if (bytesRead == 0 || errno != EINTR)
+                {
+                    close(fds[i].fd);
+                    fds[i].fd = -1;
+                    numOpen--;
+                }
+            }
         }
     }
-    return false;
+    for (i = 0; i < 2; i++)
+    {
+        if (fds[i].fd >= 0)
+        {
+            close(fds[i].fd);
+        }
+        if ((*streams[i]).isvalid() && (*streams[i])->IsOpen())
+        {
+            (*streams[i])->Close();
+        }
+    }
+
+    int status;
+    pid_t res;
+    do
+    {
+        res = waitpid(childPid, &status, 0);
+    } while (res < 0 && errno == EINTR);
+    if (res != childPid)
+    {
+        n_warning("PosixProcess: waitpid failed for '%s'\n", this->exePath.LocalPath().AsCharPtr());
+        return false;
+    }
+    return true;
 }
 
 //------------------------------------------------------------------------------
@@ -55,116 +119,27 @@ PosixProcess::LaunchWait() const
 bool
 PosixProcess::Launch()
 {
-    n_assert(this->exePath.IsValid());
-
-    int in[2];
-    int out[2];
-    int err[2];
-    int pid;
-    int rc;
-
-    rc = pipe(in);
-
-    if(rc<0)
-    {
-        n_error("Failed to create input pipe\n");
-        return false;
-    }
-
-    rc = pipe(out);
-    if(rc<0)
+    n_assert(!this->isRunning);
+    if (!this->Spawn(this->pid, this->outPipe, this->errPipe))
     {
-        n_error("Failed to create output pipe\n");
-        close(in[0]);
-        close(in[1]);
         return false;
     }
 
-    rc = pipe(err);
-    if(rc<0)
+    // IsRunning is polled every frame, reading the captured output must not block it
+    if (this->outPipe >= 0)
     {
-        n_error("Failed to create stderr pipe\n");
-        close(in[0]);
-        close(in[1]);
-        close(out[0]);
-        close(out[1]);
-        return false;
-    }
-
-    pid = fork();
-    if(pid > 0)
-    { // parent
-            close(in[0]);
-            close(out[1]);
-            close(err[1]);
-            inPipe = in[1];
-            outPipe = out[0];
-            errPipe = err[0];
-
-            // we are currently not using stdin so we close it again
-            close(inPipe);
-            if(!this->stdoutCaptureStream.isvalid())
-            {
-                close(outPipe);
-            }
-            else
-            {
-                this->stdoutCaptureStream->SetAccessMode(Stream::WriteAccess);
-                this->stdoutCaptureStream->Open();
-            }
-
-            if(!this->stderrCaptureStream.isvalid())
-            {
-                close(errPipe);
-            }
-            else
-            {
-                this->stderrCaptureStream->SetAccessMode(Stream::WriteAccess);
-                this->stderrCaptureStream->Open();
-            }
-            this->isRunning = true;
-
-            return true;
-
-    }
-    else if(pid == 0)
-    { // child
-            close(in[1]);
-            close(out[0]);
-            close(err[0]);
-            close(0);
-            dup(in[0]);
-            close(1);
-            dup(out[1]);
-            close(2);
-            dup(err[1]);
-
-            // convert arg string to array of char*
-            Array<String> strargs = this->args.Tokenize(" ",'\"');
-            char ** argv = new char*[strargs.Size() + 2];
-            argv[0] = this->exePath.LocalPath().AsCharPtr();
-            int i;
-            for(i = 0 ; i<strargs.Size() ; i++)
-            {
-                argv[i+1] = strargs[i].AsCharPtr();
-            }
-            argv[i+1] = NULL;
-
-
-            execvp(this->exePath.LocalPath().AsCharPtr(), (char**)argv);
-            exit(1);
+        fcntl(this->outPipe, F_SETFL, fcntl(this->outPipe, F_GETFL) | O_NONBLOCK);
+        this->stdoutCaptureStream->SetAccessMode(Stream::WriteAccess);
+        this->stdoutCaptureStream->Open();
     }
-    else
+    if (this->errPipe >= 0)
     {
-        close(err[0]);
-        close(err[1]);
-        close(out[0]);
-        close(out[1]);
-        close(in[0]);
-        close(in[1]);
-        n_error("Failed to fork\n");
-        return false;
+        fcntl(this->errPipe, F_SETFL, fcntl(this->errPipe, F_GETFL) | O_NONBLOCK);
+        this->stderrCaptureStream->SetAccessMode(Stream::WriteAccess);
+        this->stderrCaptureStream->Open();
     }
+    this->isRunning = true;
+    return true;
 }
 
 //------------------------------------------------------------------------------
@@ -174,54 +149,45 @@ PosixProcess::Launch()
 bool
 PosixProcess::IsRunning()
 {
-    if(this->isRunning)
+    if (this->isRunning)
     {
         this->UpdateStdoutStream();
         int status;
-        int res = waitpid(this->pid, &status, WNOHANG);
-        if(res > 0)
+        if (waitpid(this->pid, &status, WNOHANG) != 0)
         {
-            // cleanup
-            if(this->stdoutCaptureStream.isvalid())
+            // the child is gone, whatever it wrote last is still in the pipes
+            this->UpdateStdoutStream();
+            if (this->stdoutCaptureStream.isvalid())
             {
                 this->stdoutCaptureStream->Close();
             }
-            if(this->stderrCaptureStream.isvalid())
+            if (this->stderrCaptureStream.isvalid())
             {
                 this->stderrCaptureStream->Close();
             }
             this->CleanUp();
+            this->pid = -1;
             this->isRunning = false;
         }
     }
     return this->isRunning;
 }
+
 //------------------------------------------------------------------------------
 /**
-    Reads all arrived data from stdout since the last call of this method and puts it to
-    the stream.
+    Reads all arrived data from stdout and stderr since the last call of this
+    method and puts it to the capture streams.
 */
 void
 PosixProcess::UpdateStdoutStream()
 {
-    static char buffer[256];
-    if(this->stdoutCaptureStream.isvalid())
+    if (this->outPipe >= 0)
     {
-        int bread = read(outPipe,buffer,256) > 0;
-        while(bread > 0)
-        {
-            this->stdoutCaptureStream->Write(buffer,bread);
-            bread = read(outPipe,buffer,256) > 0;
-        }
+        ReadPipe(this->outPipe, this->stdoutCaptureStream);
     }
-    if(this->stderrCaptureStream.isvalid())
+    if (this->errPipe >= 0)
     {
-        int bread = read(errPipe,buffer,256) > 0;
-        while(bread > 0)
-        {
-            this->stderrCaptureStream->Write(buffer,bread);
-            bread = read(errPipe,buffer,256) > 0;
-        }
+        ReadPipe(this->errPipe, this->stderrCaptureStream);
     }
 }
 
@@ -245,14 +211,135 @@ PosixProcess::CheckIfExists(const IO::URI & program)
     return false;
 }
 
+//------------------------------------------------------------------------------
+/**
+    Forks and executes the application. Only the pipes of the streams which are
+    captured are created, otherwise the child keeps the inherited stdout and stderr.
+    The pipes are close-on-exec, so children launched at the same time from other
+    processes don't keep each other's pipes open.
+*/
+bool
+PosixProcess::Spawn(pid_t& childPid, int& stdoutPipe, int& stderrPipe) const
+{
+    n_assert(this->exePath.IsValid());
+    stdoutPipe = -1;
+    stderrPipe = -1;
+
+    // the child may not allocate, another thread could have held the heap lock when we forked
+    const String exe = this->exePath.LocalPath();
+    const String dir = this->workingDir.IsValid() ? this->workingDir.LocalPath() : String();
+    Array<String> strargs = this->args.Tokenize(" ", '\"');
+    FixedArray<char*> argv(strargs.Size() + 2);
+    argv[0] = (char*)exe.AsCharPtr();
+    IndexT i;
+    for (i = 0; i < strargs.Size(); i++)
+    {
+        argv[i + 1] = (char*)strargs[i].AsCharPtr();
+    }
+    argv[i + 1] = nullptr;
+
+    int out[2] = { -1, -1 };
+    int err[2] = { -1, -1 };
+    if (this->stdoutCaptureStream.isvalid() && pipe2(out, O_CLOEXEC) < 0)
+    {
+        n_warning("PosixProcess: failed to create stdout pipe\n");
+        return false;
+    }
+    if (this->stderrCaptureStream.isvalid() && pipe2(err, O_CLOEXEC) < 0)
+    {
+        n_warning("PosixProcess: failed to create stderr pipe\n");
+        if (out[0] >= 0)
+        {
+            close(out[0]);
+            close(out[1]);
+        }
+        return false;
+    }
+
+    childPid = fork();
+    if (childPid == 0)
+    {
+        // child, stdin is empty as before, dup2 clears close-on-exec on the copies
+        int devNull = open("/dev/null", O_RDONLY);
+        if (devNull >= 0)
+        {
+            dup2(devNull, 0);
+            close(devNull);
+        }
+        if (out[1] >= 0)
+        {
+            dup2(out[1], 1);
+        }
+        if (err[1] >= 0)
+        {
+            dup2(err[1], 2);
+        }
+        if (dir.IsValid() && chdir(dir.AsCharPtr()) != 0)
+        {
+            _exit(127);
+        }
+        execvp(exe.AsCharPtr(), argv.Begin());
+        _exit(127);
+    }
+
+    // parent, the write ends belong to the child now
+    if (out[1] >= 0)
+    {
+        close(out[1]);
+    }
+    if (err[1] >= 0)
+    {
+        close(err[1]);
+    }
+    if (childPid < 0)
+    {
+        if (out[0] >= 0)
+        {
+            close(out[0]);
+        }
+        if (err[0] >= 0)
+        {
+            close(err[0]);
+        }
+        n_warning("PosixProcess: failed to fork '%s'\n", exe.AsCharPtr());
+        return false;
+    }
+    stdoutPipe = out[0];
+    stderrPipe = err[0];
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Reads what is available from a non-blocking pipe
+*/
+void
+PosixProcess::ReadPipe(int pipe, const Ptr<IO::Stream>& stream)
+{
+    char buffer[4096];
+    ssize_t bytesRead;
+    while ((bytesRead = read(pipe, buffer, sizeof(buffer))) > 0)
+    {
+        stream->Write(buffer, (Stream::Size)bytesRead);
+    }
+}
+
 //------------------------------------------------------------------------------
 /**
 */
 void
-PosixProcess::CleanUp() const
+PosixProcess::CleanUp()
 {
-    close(outPipe);
-    close(errPipe);
+    if (this->outPipe >= 0)
+    {
+        close(this->outPipe);
+        this->outPipe = -1;
+    }
+    if (this->errPipe >= 0)
+    {
+        close(this->errPipe);
+        this->errPipe = -1;
+    }
 }
 
 } // namespace Posix
@@ -36,10 +36,13 @@ public:
     static bool CheckIfExists(const IO::URI & program);
 
 private:
+    /// fork and exec the application, returns the read ends of the captured pipes or -1
+    bool Spawn(pid_t& childPid, int& stdoutPipe, int& stderrPipe) const;
+    /// read what has arrived in a non-blocking pipe and write it to the stream
+    static void ReadPipe(int pipe, const Ptr<IO::Stream>& stream);
     /// cleanup all pipes
-    void CleanUp() const;
+    void CleanUp();
 
-    int inPipe;
     int outPipe;
     int errPipe;
     pid_t pid;
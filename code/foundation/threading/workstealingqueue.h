@@ -0,0 +1,215 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Threading::WorkStealingQueue
+
+    A bounded Chase-Lev work stealing deque.
+
+    The owning thread pushes and pops items at the bottom of the queue (LIFO),
+    which keeps recently produced work hot in that thread's cache. Any other
+    thread may steal from the top of the queue (FIFO), which hands out the oldest
+    (and usually largest) piece of work.
+
+    Only the owner is allowed to call Push and Pop, Steal is safe from any thread.
+    The queue never grows, Push returns false if the queue is full so that the
+    caller can fall back on some other shared queue.
+
+    See "Correct and Efficient Work-Stealing for Weak Memory Models", Le et. al.
+
+    @copyright
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include "core/types.h"
+#include "core/debug.h"
+#include <atomic>
+namespace Threading
+{
+
+template <class TYPE>
+class WorkStealingQueue
+{
+public:
+    /// constructor
+    WorkStealingQueue();
+    /// destructor
+    ~WorkStealingQueue();
+
+    /// setup queue with a capacity, must be a power of two
+    void Setup(const SizeT capacity);
+    /// discard queue
+    void Discard();
+
+    /// push item to the bottom of the queue, only call from owning thread
+    bool Push(TYPE item);
+    /// pop item from the bottom of the queue, only call from owning thread
+    bool Pop(TYPE& item);
+    /// steal item from top of the queue, callable from any thread
+    bool Steal(TYPE& item);
+
+    /// returns approximate number of items in the queue
+    SizeT Size() const;
+    /// returns true if the queue is (approximately) empty
+    bool IsEmpty() const;
+
+private:
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<TYPE>* items;
+    int64_t mask;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+inline
+WorkStealingQueue<TYPE>::WorkStealingQueue()
+    : top(0)
+    , bottom(0)
+    , items(nullptr)
+    , mask(0)
+{
+    static_assert(std::is_trivially_copyable<TYPE>::value, "WorkStealingQueue items must be trivially copyable");
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+inline
+WorkStealingQueue<TYPE>::~WorkStealingQueue()
+{
+    this->Discard();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+inline void
+WorkStealingQueue<TYPE>::Setup(const SizeT capacity)
+{
+    n_assert(this->items == nullptr);
+    n_assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    this->items = new std::atomic<TYPE>[capacity];
+    this->mask = capacity - 1;
+    this->top.store(0, std::memory_order_relaxed);
+    this->bottom.store(0, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+inline void
+WorkStealingQueue<TYPE>::Discard()
+{
+    if (this->items != nullptr)
+    {
+        delete[] this->items;
+        this->items = nullptr;
+    }
+    this->mask = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+inline bool
+WorkStealingQueue<TYPE>::Push(TYPE item)
+{
+    int64_t b = this->bottom.load(std::memory_order_relaxed);
+    int64_t t = this->top.load(std::memory_order_acquire);
+
+    // Queue is full, let the caller decide where the item goes instead
+    if (b - t > this->mask)
+        return false;
+
+    this->items[b & this->mask].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    this->bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+inline bool
+WorkStealingQueue<TYPE>::Pop(TYPE& item)
+{
+    int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+    this->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = this->top.load(std::memory_order_relaxed);
+
+    bool ret = true;
+    if (t <= b)
+    {
+        item = this->items[b & this->mask].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // Last item, race against thieves for it
+            if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                ret = false;
+            this->bottom.store(b + 1, std::memory_order_relaxed);
+        }
+    }
+    else
+    {
+        // Queue was empty, restore bottom
+        ret = false;
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+inline bool
+WorkStealingQueue<TYPE>::Steal(TYPE& item)
+{
+    int64_t t = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = this->bottom.load(std::memory_order_acquire);
+
+    if (t < b)
+    {
+        TYPE ret = this->items[t & this->mask].load(std::memory_order_relaxed);
+
+        // If we lose the race against the owner or another thief, fail the steal
+        if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return false;
+        item = ret;
+        return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+inline SizeT
+WorkStealingQueue<TYPE>::Size() const
+{
+    int64_t b = this->bottom.load(std::memory_order_relaxed);
+    int64_t t = this->top.load(std::memory_order_relaxed);
+    return b > t ? SizeT(b - t) : 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+inline bool
+WorkStealingQueue<TYPE>::IsEmpty() const
+{
+    return this->Size() == 0;
+}
+
+} // namespace Threading
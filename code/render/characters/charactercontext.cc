@@ -14,6 +14,10 @@
 #include "models/nodes/characterskinnode.h"
 #include "profiling/profiling.h"
 #include "resources/resourceserver.h"
+#include "graphics/cameracontext.h"
+
+N_DECLARE_COUNTER(N_CHARACTERS_EVALUATED, Characters Evaluated);
+N_DECLARE_COUNTER(N_CHARACTERS_SKIPPED, Characters Skipped);
 
 using namespace Graphics;
 using namespace Resources;
@@ -26,6 +30,11 @@ __ImplementContext(CharacterContext, CharacterContext::characterContextAllocator
 Util::HashTable<Util::StringAtom, CoreAnimation::AnimSampleMask> CharacterContext::masks;
 Threading::Event CharacterContext::totalCompletionEvent;
 Threading::AtomicCounter CharacterContext::ConstantUpdateCounter = 0;
+CharacterContext::AnimationLodSettings CharacterContext::lodSettings;
+
+// characters evaluated and skipped by the last update
+static Threading::AtomicCounter NumEvaluatedCharacters = 0;
+static Threading::AtomicCounter NumSkippedCharacters = 0;
 
 //------------------------------------------------------------------------------
 /**
@@ -74,6 +83,7 @@ CharacterContext::Setup(
     n_assert_fmt(cid != InvalidContextEntityId, "Entity %d is not registered in CharacterContext", id.HashCode());
     characterContextAllocator.Set<Loaded>(cid.id, NoneLoaded);
     characterContextAllocator.Set<EntityId>(cid.id, id);
+    characterContextAllocator.Set<AnimLod>(cid.id, AnimationLod{ 1, 0, false });
 
     // check to make sure we registered this entity for observation, then get the visibility context
     const ContextEntityId visId = Visibility::ObservableContext::GetContextId(id);
@@ -109,6 +119,7 @@ CharacterContext::Setup(
             // setup joints, scaled joints and user controlled joints
             characterContextAllocator.Get<JointPalette>(cid.id).Resize(joints.Size());
             characterContextAllocator.Get<JointPaletteScaled>(cid.id).Resize(joints.Size());
+            characterContextAllocator.Get<JointPalettePrevious>(cid.id).Resize(joints.Size());
             characterContextAllocator.Get<UserControlledJoint>(cid.id).Resize(joints.Size());
 
             // setup job joints
@@ -385,6 +396,9 @@ struct CharacterJobContext
     const Util::Array<Util::FixedArray<Math::mat4>>* jointPalettes;
     const Util::Array<Util::FixedArray<Math::mat4>>* scaledJointPalettes;
     const Util::Array<Util::FixedArray<Math::mat4>>* userJoints;
+    const Util::Array<Util::FixedArray<Math::mat4>>* previousJointPalettes;
+    const Util::Array<CharacterContext::AnimationLod>* lods;
+    const Util::Array<IndexT>* characterNodeIndices;
     float** tmpSamples;
     uint** tmpSampleIndices;
     Math::mat4** tmpJoints;
@@ -394,8 +408,25 @@ struct CharacterJobContext
     float frameTime;
     Timing::Tick time;
     Timing::Tick ticks;
+    IndexT frameIndex;
+    Math::point cameraPosition;
+    CharacterContext::AnimationLodSettings lodSettings;
 };
 
+//------------------------------------------------------------------------------
+/**
+    Returns the number of frames between two evaluations of a character at this distance
+    to the LOD camera.
+*/
+static uint
+AnimationLodFrameInterval(const CharacterContext::AnimationLodSettings& settings, float distance)
+{
+    uint interval = 1;
+    for (float limit = settings.fullRateDistance; limit < distance && interval < settings.maxFrameInterval; limit *= 2.0f)
+        interval *= 2;
+    return interval;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -405,16 +436,43 @@ EvalCharacter(SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocat
     N_SCOPE(EvalCharacter, Graphics);
     auto context = static_cast<CharacterJobContext*>(ctx);
     using namespace CoreAnimation;
+    const Models::ModelContext::ModelInstance::Renderable& renderables = Models::ModelContext::GetModelRenderables();
+    int numEvaluated = 0, numSkipped = 0;
 
     for (IndexT i = 0; i < groupSize; i++)
     {
         IndexT index = invocationOffset + i;
         if (index >= totalJobs)
-            return;
+            break;
 
         // update time, get track controller
         Timing::Time& currentTime = context->times->Get(index);
         currentTime += context->frameTime;
+
+        const Graphics::GraphicsEntityId entity = context->entities->Get(index);
+        if (entity == Graphics::InvalidGraphicsEntityId)
+            continue;
+
+        // Evaluate characters at a rate depending on their distance, staggered by their index so that
+        // they don't all fall on the same frame. The time keeps running, so skipped frames catch up.
+        CharacterContext::AnimationLod& lod = context->lods->Get(index);
+        const Models::NodeInstanceRange& range = Models::ModelContext::GetModelRenderableRange(entity);
+        IndexT node = range.begin + context->characterNodeIndices->Get(index);
+        float distance = length(renderables.nodeBoundingBoxes[node].center() - context->cameraPosition);
+        lod.frameInterval = AnimationLodFrameInterval(context->lodSettings, distance);
+        lod.phase = (context->frameIndex + index) & (lod.frameInterval - 1);
+
+        // Characters nobody saw keep showing their last evaluated pose
+        bool frozen = context->lodSettings.freezeInvisible && !AllBits(renderables.nodeFlags[node], Models::NodeInstanceFlags::NodeInstance_WasVisible);
+        if (frozen)
+            lod.phase = lod.frameInterval - 1;
+        if (lod.evaluated && (frozen || lod.phase != 0))
+        {
+            numSkipped++;
+            continue;
+        }
+        numEvaluated++;
+
         CharacterContext::AnimationTracks& trackController = context->tracks->Get(index);
         const AnimationId anim = context->anims->Get(index);
         if (anim == InvalidAnimationId)
@@ -427,6 +485,7 @@ EvalCharacter(SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocat
         const Util::FixedArray<Characters::CharacterJoint>& joints = Characters::SkeletonGetJoints(skeleton);
         const Util::FixedArray<Math::mat4>& jointPalette = context->jointPalettes->Get(index);
         const Util::FixedArray<Math::mat4>& scaledJointPalette = context->scaledJointPalettes->Get(index);
+        const Util::FixedArray<Math::mat4>& previousJointPalette = context->previousJointPalettes->Get(index);
         const Util::FixedArray<Math::vec4>& idleSamples = Characters::SkeletonGetIdleSamples(skeleton);
         const CoreAnimation::AnimSampleBuffer& sampleBuffer = context->sampleBuffers->Get(index);
         Math::mat4* tmpMatrices = context->tmpJoints[index];
@@ -435,6 +494,10 @@ EvalCharacter(SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocat
         auto sampleMixInfo = context->animMixInfos + index;
         bool runSkeletonThisFrame = false;
 
+        // The last evaluated pose is where the interpolation towards the new one starts
+        if (lod.evaluated)
+            Memory::Copy(jointPalette.Begin(), previousJointPalette.Begin(), jointPalette.Size() * sizeof(Math::mat4));
+
         // loop over all tracks, and update the playing clip on each respective track
         bool firstAnimTrack = true;
         IndexT j;
@@ -542,28 +605,18 @@ EvalCharacter(SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocat
                 sampleMixInfo->sampleType = SampleType::Linear;
                 sampleMixInfo->velocityScale.set(playing.timeFactor, playing.timeFactor, playing.timeFactor, 0);
 
-                // Get pointers to memory and size
-                const float* srcPtr = buffer->GetKeyBufferPointer();
-                const AnimKeyBuffer::Interval* srcTimePtr = buffer->GetIntervalBufferPointer();
-
                 const Util::FixedArray<AnimCurve>& curves = CoreAnimation::AnimGetCurves(anim);
                 Timing::Tick evalTime = playing.sampleTime % clip.duration;
 
                 if (firstAnimTrack
                     || playing.blend != 1.0f)
                 {
-                    if (sampleMixInfo->sampleType == SampleType::Step)
-                        AnimSampleStep(clip, curves, evalTime, sampleMixInfo->velocityScale, idleSamples, srcPtr, srcTimePtr, playing.curveSampleIndices.Begin(), sampleBuffer.GetSamplesPointer(), sampleBuffer.GetSampleCountsPointer());
-                    else
-                        AnimSampleLinear(clip, curves, evalTime, sampleMixInfo->velocityScale, idleSamples, srcPtr, srcTimePtr, playing.curveSampleIndices.Begin(), sampleBuffer.GetSamplesPointer(), sampleBuffer.GetSampleCountsPointer());
+                    AnimSample(clip, curves, evalTime, sampleMixInfo->velocityScale, idleSamples, buffer, sampleMixInfo->sampleType, playing.curveSampleIndices.Begin(), sampleBuffer.GetSamplesPointer(), sampleBuffer.GetSampleCountsPointer());
                 }
                 else // Playing with mix
                 {
                     uchar tmpSampleCounts = 0;
-                    if (sampleMixInfo->sampleType == SampleType::Step)
-                        AnimSampleStep(clip, curves, evalTime, sampleMixInfo->velocityScale, idleSamples, srcPtr, srcTimePtr, tmpSampleIndices, tmpSamples, &tmpSampleCounts);
-                    else
-                        AnimSampleLinear(clip, curves, evalTime, sampleMixInfo->velocityScale, idleSamples, srcPtr, srcTimePtr, tmpSampleIndices, tmpSamples, &tmpSampleCounts);
+                    AnimSample(clip, curves, evalTime, sampleMixInfo->velocityScale, idleSamples, buffer, sampleMixInfo->sampleType, tmpSampleIndices, tmpSamples, &tmpSampleCounts);
 
                     AnimMix(clip, curves.Size(), playing.mask, sampleMixInfo->mixWeight, sampleBuffer.GetSamplesPointer(), tmpSamples, sampleBuffer.GetSampleCountsPointer(), &tmpSampleCounts, sampleBuffer.GetSamplesPointer(), sampleBuffer.GetSampleCountsPointer());
                 }
@@ -638,7 +691,17 @@ EvalCharacter(SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocat
 
             skinMatrixBase[jointIndex] = scaledMatrix * invPoseMatrixBase[jointIndex];
         }
+
+        // There is nothing to interpolate from the first time around
+        if (!lod.evaluated)
+        {
+            Memory::Copy(jointPalette.Begin(), previousJointPalette.Begin(), jointPalette.Size() * sizeof(Math::mat4));
+            lod.evaluated = true;
+        }
     }
+
+    Threading::Interlocked::Add(&NumEvaluatedCharacters, numEvaluated);
+    Threading::Interlocked::Add(&NumSkippedCharacters, numSkipped);
 }
 
 //------------------------------------------------------------------------------
@@ -661,6 +724,19 @@ CharacterContext::UpdateAnimations(const Graphics::FrameContext& ctx)
     const Util::Array<Graphics::GraphicsEntityId>& models = characterContextAllocator.GetArray<EntityId>();
     const Util::Array<bool>& supportsBlending = characterContextAllocator.GetArray<SupportMix>();
     const Util::Array<IndexT>& characterSkinNodeIndices = characterContextAllocator.GetArray<CharacterSkinNodeIndexOffset>();
+    const Util::Array<Util::FixedArray<Math::mat4>>& previousJointPalettes = characterContextAllocator.GetArray<JointPalettePrevious>();
+    const Util::Array<AnimationLod>& lods = characterContextAllocator.GetArray<AnimLod>();
+
+    // The jobs of the previous frame are done, so report what they did
+    static int reportedEvaluated = 0, reportedSkipped = 0;
+    N_COUNTER_INCR(N_CHARACTERS_EVALUATED, NumEvaluatedCharacters);
+    N_COUNTER_INCR(N_CHARACTERS_SKIPPED, NumSkippedCharacters);
+    N_COUNTER_DECR(N_CHARACTERS_EVALUATED, reportedEvaluated);
+    N_COUNTER_DECR(N_CHARACTERS_SKIPPED, reportedSkipped);
+    reportedEvaluated = NumEvaluatedCharacters;
+    reportedSkipped = NumSkippedCharacters;
+    NumEvaluatedCharacters = 0;
+    NumSkippedCharacters = 0;
 
     if (!models.IsEmpty())
     {
@@ -680,10 +756,16 @@ CharacterContext::UpdateAnimations(const Graphics::FrameContext& ctx)
         charCtx.jointPalettes = &jointPalettes;
         charCtx.scaledJointPalettes = &scaledJointPalettes;
         charCtx.userJoints = &userJoints;
+        charCtx.previousJointPalettes = &previousJointPalettes;
+        charCtx.lods = &lods;
+        charCtx.characterNodeIndices = &characterSkinNodeIndices;
         charCtx.entities = &models;
         charCtx.frameTime = ctx.frameTime;
         charCtx.ticks = ctx.ticks;
         charCtx.time = ctx.time;
+        charCtx.frameIndex = ctx.frameIndex;
+        charCtx.cameraPosition = Graphics::CameraContext::GetTransform(Graphics::CameraContext::GetLODCameras()[0]).position;
+        charCtx.lodSettings = CharacterContext::lodSettings;
         charCtx.animMixInfos = Jobs2::JobAlloc<AnimSampleMixInfo>(models.Size());
 
         charCtx.tmpJoints = Jobs2::JobAlloc<Math::mat4*>(models.Size());
@@ -709,8 +791,8 @@ CharacterContext::UpdateAnimations(const Graphics::FrameContext& ctx)
             }
         }
 
-        // Run job
-        Jobs2::JobDispatch(EvalCharacter, models.Size(), 64, charCtx, nullptr, &animationCounter, nullptr);
+        // Run job, the level of detail depends on the visibility and bounding boxes updated by the models
+        Jobs2::JobDispatch(EvalCharacter, models.Size(), 64, charCtx, { &Models::ModelContext::LodUpdateCounter }, &animationCounter, nullptr);
 
         n_assert(ConstantUpdateCounter == 0);
         ConstantUpdateCounter = 1;
@@ -721,6 +803,8 @@ CharacterContext::UpdateAnimations(const Graphics::FrameContext& ctx)
                 characterNodeIndices = characterSkinNodeIndices.ConstBegin()
                 , entities = models.ConstBegin()
                 , jointPalettes = jointPalettes.ConstBegin()
+                , previousJointPalettes = previousJointPalettes.ConstBegin()
+                , lods = lods.ConstBegin()
             ]
         (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
         {
@@ -746,7 +830,21 @@ CharacterContext::UpdateAnimations(const Graphics::FrameContext& ctx)
                 Util::FixedArray<Math::mat4, true> usedMatrices(usedIndices.Size());
 
                 // update joints, which is stored in character context
-                if (!jointPalette.IsEmpty())
+                const AnimationLod& lod = lods[index];
+                if (!jointPalette.IsEmpty() && lod.evaluated && lod.phase + 1 < lod.frameInterval)
+                {
+                    // between evaluations, interpolate from the pose before the last evaluation
+                    const Util::FixedArray<Math::mat4>& previousJointPalette = previousJointPalettes[index];
+                    float t = (lod.phase + 1) / float(lod.frameInterval);
+                    IndexT j;
+                    for (j = 0; j < usedIndices.Size(); j++)
+                    {
+                        const Math::mat4& from = previousJointPalette[usedIndices[j]];
+                        const Math::mat4& to = jointPalette[usedIndices[j]];
+                        usedMatrices[j] = Math::mat4(lerp(from.row0, to.row0, t), lerp(from.row1, to.row1, t), lerp(from.row2, to.row2, t), lerp(from.row3, to.row3, t));
+                    }
+                }
+                else if (!jointPalette.IsEmpty())
                 {
                     // copy active matrix palette, or set identity
                     IndexT j;
@@ -768,6 +866,16 @@ CharacterContext::UpdateAnimations(const Graphics::FrameContext& ctx)
         CharacterContext::totalCompletionEvent.Signal();
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+void
+CharacterContext::SetAnimationLodSettings(const AnimationLodSettings& settings)
+{
+    n_assert(settings.maxFrameInterval > 0 && (settings.maxFrameInterval & (settings.maxFrameInterval - 1)) == 0);
+    CharacterContext::lodSettings = settings;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
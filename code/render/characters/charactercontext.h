@@ -21,6 +21,11 @@
         Animations can be played without enqueueing, which replaces the currently
         playing animation on that track.
 
+    Characters further away from the LOD camera are evaluated at a reduced rate, and
+    characters no observer saw the previous frame keep their pose. Between evaluations,
+    the joint palette is interpolated from the pose before the last evaluation to the
+    last evaluated pose, see AnimationLodSettings.
+
 
     @copyright
     (C) 2018-2020 Individual contributors, see AUTHORS file
@@ -117,6 +122,16 @@ public:
     /// retrieve animation clip names and lengths
     static void QueryClips(const Graphics::GraphicsEntityId id, Util::FixedArray<CoreAnimation::AnimClip>& outClips);
 
+    /// animation level of detail, applies to all characters
+    struct AnimationLodSettings
+    {
+        float fullRateDistance = 20.0f;     // characters closer than this are evaluated every frame, the interval doubles with every doubling of the distance
+        uint maxFrameInterval = 8;          // the most frames between two evaluations, has to be a power of two
+        bool freezeInvisible = true;        // characters no observer saw the previous frame are not evaluated
+    };
+    /// set animation level of detail
+    static void SetAnimationLodSettings(const AnimationLodSettings& settings);
+
     /// runs before frame is updated
     static void UpdateAnimations(const Graphics::FrameContext& ctx);
     /// run after frame
@@ -168,6 +183,13 @@ private:
     friend Timing::Tick GetAbsoluteStopTime(const CharacterContext::AnimationRuntime& runtime);
     friend void EvalCharacter(SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset, void* ctx);
 
+    struct AnimationLod
+    {
+        uint frameInterval;                 // frames between two evaluations
+        uint phase;                         // frames since the last evaluation
+        bool evaluated;                     // set if the joint palette has been evaluated at least once
+    };
+
     static const SizeT MaxNumTracks = 16;
     struct AnimationTracks
     {
@@ -184,12 +206,14 @@ private:
         AnimTime,
         JointPalette,
         JointPaletteScaled,
+        JointPalettePrevious,
         UserControlledJoint,
         JobJoints,
         SampleBuffer,
         SupportMix,
         EntityId,
-        CharacterSkinNodeIndexOffset
+        CharacterSkinNodeIndexOffset,
+        AnimLod
     };
 
     typedef Ids::IdAllocator<
@@ -201,11 +225,13 @@ private:
         Util::FixedArray<Math::mat4>,
         Util::FixedArray<Math::mat4>,
         Util::FixedArray<Math::mat4>,
+        Util::FixedArray<Math::mat4>,
         Util::FixedArray<SkeletonJobJoint>,
         CoreAnimation::AnimSampleBuffer,
         bool,
         Graphics::GraphicsEntityId,
-        IndexT
+        IndexT,
+        AnimationLod
     > CharacterContextAllocator;
     static CharacterContextAllocator characterContextAllocator;
 
@@ -216,6 +242,7 @@ private:
 
     static Util::HashTable<Util::StringAtom, CoreAnimation::AnimSampleMask> masks;
     static Threading::Event totalCompletionEvent;
+    static AnimationLodSettings lodSettings;
 };
 
 __ImplementEnumBitOperators(CharacterContext::LoadState);
@@ -17,6 +17,7 @@
 #include "coreanimation/animclip.h"
 #include "coreanimation/animkeybuffer.h"
 #include "coreanimation/animsamplemask.h"
+#include "coreanimation/sampletype.h"
 
 //------------------------------------------------------------------------------
 namespace CoreAnimation
@@ -64,6 +65,55 @@ extern void AnimSampleLinear(
     uchar* outSampleCounts
 );
 
+//------------------------------------------------------------------------------
+/**
+*/
+extern void AnimSampleStepCompressed(
+    const AnimClip& clip,
+    const Util::FixedArray<AnimCurve>& curves,
+    const Timing::Tick time,
+    const Math::vec4& velocityScale,
+    const Util::FixedArray<Math::vec4>& idleSamples,
+    const ushort* srcKeyPtr,
+    const AnimKeyBuffer::Interval* intervalPtr,
+    uint* outSampleKeyPtr,
+    float* outSamplePtr,
+    uchar* outSampleCounts
+);
+
+//------------------------------------------------------------------------------
+/**
+*/
+extern void AnimSampleLinearCompressed(
+    const AnimClip& clip,
+    const Util::FixedArray<AnimCurve>& curves,
+    const Timing::Tick time,
+    const Math::vec4& velocityScale,
+    const Util::FixedArray<Math::vec4>& idleSamples,
+    const ushort* srcKeyPtr,
+    const AnimKeyBuffer::Interval* intervalPtr,
+    uint* outSampleKeyPtr,
+    float* outSamplePtr,
+    uchar* outSampleCounts
+);
+
+//------------------------------------------------------------------------------
+/**
+    Sample a clip from a key buffer, picking the sampler for its key format
+*/
+extern void AnimSample(
+    const AnimClip& clip,
+    const Util::FixedArray<AnimCurve>& curves,
+    const Timing::Tick time,
+    const Math::vec4& velocityScale,
+    const Util::FixedArray<Math::vec4>& idleSamples,
+    const AnimKeyBuffer* keyBuffer,
+    const SampleType::Code sampleType,
+    uint* outSampleKeyPtr,
+    float* outSamplePtr,
+    uchar* outSampleCounts
+);
+
 //------------------------------------------------------------------------------
 /**
 */
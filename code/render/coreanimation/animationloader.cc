@@ -34,8 +34,9 @@ AnimationLoader::InitializeResource(const ResourceLoadJob& job, const Ptr<IO::St
     Nax3Header* naxHeader = (Nax3Header*)ptr;
     ptr += sizeof(Nax3Header);
 
-    // check magic value
-    if (FourCC(naxHeader->magic) != NEBULA_NAX3_MAGICNUMBER)
+    // check magic value, NAX4 files only differ by having compressed curves and keys
+    bool const compressed = FourCC(naxHeader->magic) == NEBULA_NAX4_MAGICNUMBER;
+    if (FourCC(naxHeader->magic) != NEBULA_NAX3_MAGICNUMBER && !compressed)
     {
         n_error("StreamAnimationLoader::InitializeResource(): '%s' has invalid file format (magic number doesn't match)!", stream->GetURI().AsString().AsCharPtr());
         return ret;
@@ -56,15 +57,32 @@ AnimationLoader::InitializeResource(const ResourceLoadJob& job, const Ptr<IO::St
             curves.SetSize(anim->numCurves);
             for (IndexT curveIndex = 0; curveIndex < anim->numCurves; curveIndex++)
             {
-                Nax3Curve* naxCurve = (Nax3Curve*)ptr;
-                ptr += sizeof(Nax3Curve);
-
                 AnimCurve& curve = curves[curveIndex];
-                curve.firstIntervalOffset = naxCurve->firstIntervalOffset;
-                curve.numIntervals = naxCurve->numIntervals;
-                curve.preInfinityType = (CoreAnimation::InfinityType::Code)naxCurve->preInfinityType;
-                curve.postInfinityType = (CoreAnimation::InfinityType::Code)naxCurve->postInfinityType;
-                curve.curveType = (CoreAnimation::CurveType::Code)naxCurve->curveType;
+                if (compressed)
+                {
+                    Nax4Curve* naxCurve = (Nax4Curve*)ptr;
+                    ptr += sizeof(Nax4Curve);
+
+                    curve.firstIntervalOffset = naxCurve->firstIntervalOffset;
+                    curve.numIntervals = naxCurve->numIntervals;
+                    curve.preInfinityType = (CoreAnimation::InfinityType::Code)naxCurve->preInfinityType;
+                    curve.postInfinityType = (CoreAnimation::InfinityType::Code)naxCurve->postInfinityType;
+                    curve.curveType = (CoreAnimation::CurveType::Code)naxCurve->curveType;
+                    curve.isStatic = (naxCurve->flags & Nax4CurveStatic) != 0;
+                    curve.keyOffset = vec4(naxCurve->keyOffset[0], naxCurve->keyOffset[1], naxCurve->keyOffset[2], naxCurve->keyOffset[3]);
+                    curve.keyScale = vec4(naxCurve->keyScale[0], naxCurve->keyScale[1], naxCurve->keyScale[2], 0.0f);
+                }
+                else
+                {
+                    Nax3Curve* naxCurve = (Nax3Curve*)ptr;
+                    ptr += sizeof(Nax3Curve);
+
+                    curve.firstIntervalOffset = naxCurve->firstIntervalOffset;
+                    curve.numIntervals = naxCurve->numIntervals;
+                    curve.preInfinityType = (CoreAnimation::InfinityType::Code)naxCurve->preInfinityType;
+                    curve.postInfinityType = (CoreAnimation::InfinityType::Code)naxCurve->postInfinityType;
+                    curve.curveType = (CoreAnimation::CurveType::Code)naxCurve->curveType;
+                }
             }
         }
 
@@ -114,10 +132,13 @@ AnimationLoader::InitializeResource(const ResourceLoadJob& job, const Ptr<IO::St
 
         // Load keys
         keyBuffer = AnimKeyBuffer::Create();
-        keyBuffer->Setup(anim->numIntervals, anim->numKeys, ptr, ptr + sizeof(Nax3Interval) * anim->numIntervals);
+        if (compressed)
+            keyBuffer->SetupCompressed(anim->numIntervals, anim->numKeys, ptr, ptr + sizeof(Nax3Interval) * anim->numIntervals);
+        else
+            keyBuffer->Setup(anim->numIntervals, anim->numKeys, ptr, ptr + sizeof(Nax3Interval) * anim->numIntervals);
 
         // Advance pointer by keys and timings
-        ptr += anim->numKeys * sizeof(float) + anim->numIntervals * sizeof(AnimKeyBuffer::Interval);
+        ptr += keyBuffer->GetByteSize() + anim->numIntervals * sizeof(AnimKeyBuffer::Interval);
 
         // Create animation
         AnimationCreateInfo info;
@@ -8,6 +8,8 @@
     with all other AnimCurves in their AnimClip object. An AnimCurve may
     be collapsed into a single key, so that AnimCurves where all keys
     are identical don't take up any space in the animation key buffer.
+    Curves of compressed key buffers also hold the range to decode their
+    keys with.
     For performance reasons, AnimCurve's are not as flexible as their
     Maya counterparts, for instance it is not possible to set 
     the pre- and post-infinity types per curve, but only per clip.
@@ -35,6 +37,9 @@ public:
     CoreAnimation::InfinityType::Code preInfinityType;
     CoreAnimation::InfinityType::Code postInfinityType;
     CurveType::Code curveType;
+    bool isStatic;                  // all keys are identical, the key is stored in keyOffset
+    Math::vec4 keyOffset;           // compressed keys are decoded as keyOffset + key * keyScale
+    Math::vec4 keyScale;
 };
 
 //------------------------------------------------------------------------------
@@ -47,6 +52,9 @@ AnimCurve::AnimCurve()
     , preInfinityType(CoreAnimation::InfinityType::InvalidInfinityType)
     , postInfinityType(CoreAnimation::InfinityType::InvalidInfinityType)
     , curveType(CoreAnimation::CurveType::InvalidCurveType)
+    , isStatic(false)
+    , keyOffset(0.0f)
+    , keyScale(0.0f)
 {
     // empty
 }
@@ -20,6 +20,7 @@ AnimKeyBuffer::AnimKeyBuffer()
     , numIntervals(0)
     , mapCount(0)
     , keyBuffer(nullptr)
+    , compressedKeyBuffer(nullptr)
     , intervalBuffer(nullptr)
 {
     // empty
@@ -52,6 +53,22 @@ AnimKeyBuffer::Setup(SizeT numIntervals, SizeT numKeys, void* intervalPtr, void*
     Memory::Copy(intervalPtr, this->intervalBuffer, sizeof(AnimKeyBuffer::Interval) * this->numIntervals);
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AnimKeyBuffer::SetupCompressed(SizeT numIntervals, SizeT numKeys, void* intervalPtr, void* keyPtr)
+{
+    n_assert(!this->IsValid());
+    this->numIntervals = numIntervals;
+    this->numKeys = numKeys;
+    this->mapCount = 0;
+    this->compressedKeyBuffer = (ushort*)Memory::Alloc(Memory::ResourceHeap, sizeof(ushort) * this->numKeys);
+    Memory::Copy(keyPtr, this->compressedKeyBuffer, this->GetByteSize());
+    this->intervalBuffer = (AnimKeyBuffer::Interval*)Memory::Alloc(Memory::ResourceHeap, sizeof(AnimKeyBuffer::Interval) * this->numIntervals);
+    Memory::Copy(intervalPtr, this->intervalBuffer, sizeof(AnimKeyBuffer::Interval) * this->numIntervals);
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -59,8 +76,12 @@ void
 AnimKeyBuffer::Discard()
 {
     n_assert(this->IsValid());
-    Memory::Free(Memory::ResourceHeap, this->keyBuffer);
+    if (this->keyBuffer != nullptr)
+        Memory::Free(Memory::ResourceHeap, this->keyBuffer);
     this->keyBuffer = 0;
+    if (this->compressedKeyBuffer != nullptr)
+        Memory::Free(Memory::ResourceHeap, this->compressedKeyBuffer);
+    this->compressedKeyBuffer = nullptr;
     Memory::Free(Memory::ResourceHeap, this->intervalBuffer);
     this->intervalBuffer = 0;
     this->numKeys = 0;
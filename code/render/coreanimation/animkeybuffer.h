@@ -4,6 +4,9 @@
     @class CoreAnimation::AnimKeyBuffer
     
     A simple buffer of vec4 animation keys.
+
+    The keys are either raw floats, or three 16 bit values per key when loaded
+    from a NAX4 file, see coreanimation/animkeycompression.h.
     
     @copyright
     (C) 2008 Radon Labs GmbH
@@ -32,16 +35,22 @@ public:
     virtual ~AnimKeyBuffer();
     /// setup the buffer
     void Setup(SizeT numIntervals, SizeT numKeys, void* intervalPtr, void* keyPtr);
+    /// setup the buffer with compressed keys, numKeys is the number of 16 bit values
+    void SetupCompressed(SizeT numIntervals, SizeT numKeys, void* intervalPtr, void* keyPtr);
     /// discard the buffer
     void Discard();
     /// return true if the object has been setup
     bool IsValid() const;
+    /// return true if the keys are compressed
+    bool IsCompressed() const;
     /// get number of keys in buffer
     SizeT GetNumKeys() const;
     /// get buffer size in bytes
     SizeT GetByteSize() const;
     /// Get direct pointer to keys
     const float* GetKeyBufferPointer() const;
+    /// get direct pointer to compressed keys
+    const ushort* GetCompressedKeyBufferPointer() const;
     /// get direct pointer to interval buffer
     const AnimKeyBuffer::Interval* GetIntervalBufferPointer() const;
 
@@ -50,6 +59,7 @@ private:
     SizeT numIntervals;
     uint mapCount;
     float* keyBuffer;
+    ushort* compressedKeyBuffer;
     AnimKeyBuffer::Interval* intervalBuffer;
 };
 
@@ -62,6 +72,15 @@ AnimKeyBuffer::IsValid() const
     return (0 != this->intervalBuffer);
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+AnimKeyBuffer::IsCompressed() const
+{
+    return (nullptr != this->compressedKeyBuffer);
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -77,7 +96,7 @@ AnimKeyBuffer::GetNumKeys() const
 inline SizeT
 AnimKeyBuffer::GetByteSize() const
 {
-    return this->numKeys * sizeof(float);
+    return this->numKeys * (this->IsCompressed() ? sizeof(ushort) : sizeof(float));
 }
 
 //------------------------------------------------------------------------------
@@ -89,6 +108,15 @@ AnimKeyBuffer::GetKeyBufferPointer() const
     return this->keyBuffer;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+inline const ushort*
+AnimKeyBuffer::GetCompressedKeyBufferPointer() const
+{
+    return this->compressedKeyBuffer;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
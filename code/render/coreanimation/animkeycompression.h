@@ -0,0 +1,117 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @file coreanimation/animkeycompression.h
+
+    Quantization of animation keys, as stored in NAX4 files.
+
+    Every compressed key is three 16 bit values. Rotations use the smallest three
+    encoding, where the largest component of the unit quaternion is left out and
+    recovered from the other three, which are quantized to 15 bits each. The two
+    bits of the index of the left out component are stored in the top bits of the
+    first two values. Translation, scale and velocity keys are quantized to 16 bits
+    per component, relative to the range of their curve.
+
+    @copyright
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include "core/types.h"
+#include "math/scalar.h"
+#include "math/vec3.h"
+#include "math/quat.h"
+
+namespace CoreAnimation
+{
+
+/// the components left after dropping the largest one of a unit quaternion are within +-1/sqrt(2)
+static const float AnimKeyRotationRange = 0.70710678f;
+/// largest quantized rotation component
+static const float AnimKeyRotationSteps = 32767.0f;
+/// largest quantized translation, scale or velocity component
+static const float AnimKeyVectorSteps = 65535.0f;
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+AnimCompressRotation(const Math::quat& rotation, ushort* key)
+{
+    Math::quat const q = Math::normalize(rotation);
+    uint largest = 0;
+    for (uint i = 1; i < 4; i++)
+    {
+        if (Math::abs(q.v[i]) > Math::abs(q.v[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation, so the left out component is always positive
+    float const sign = q.v[largest] < 0.0f ? -1.0f : 1.0f;
+    float const quantize = AnimKeyRotationSteps / (2.0f * AnimKeyRotationRange);
+    uint slot = 0;
+    for (uint i = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+        float const value = Math::clamp(q.v[i] * sign, -AnimKeyRotationRange, AnimKeyRotationRange);
+        key[slot++] = (ushort)Math::frnd((value + AnimKeyRotationRange) * quantize);
+    }
+    key[0] |= (largest & 1) << 15;
+    key[1] |= (largest >> 1) << 15;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline Math::quat
+AnimDecompressRotation(const ushort* key)
+{
+    uint const largest = (key[0] >> 15) | ((key[1] >> 15) << 1);
+    float const step = 2.0f * AnimKeyRotationRange / AnimKeyRotationSteps;
+    float const a = (key[0] & 0x7FFF) * step - AnimKeyRotationRange;
+    float const b = (key[1] & 0x7FFF) * step - AnimKeyRotationRange;
+    float const c = (key[2] & 0x7FFF) * step - AnimKeyRotationRange;
+    float const d = Math::sqrt(Math::max(0.0f, 1.0f - a * a - b * b - c * c));
+    switch (largest)
+    {
+        case 0: return Math::quat(d, a, b, c);
+        case 1: return Math::quat(a, d, b, c);
+        case 2: return Math::quat(a, b, d, c);
+        default: return Math::quat(a, b, c, d);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Get the offset and scale to quantize values between min and max.
+*/
+inline void
+AnimVectorRange(const Math::vec3& min, const Math::vec3& max, Math::vec3& offset, Math::vec3& scale)
+{
+    offset = min;
+    scale = (max - min) * (1.0f / AnimKeyVectorSteps);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+AnimCompressVector(const Math::vec3& value, const Math::vec3& offset, const Math::vec3& scale, ushort* key)
+{
+    for (uint i = 0; i < 3; i++)
+    {
+        float const quantized = scale[i] > 0.0f ? (value[i] - offset[i]) / scale[i] : 0.0f;
+        key[i] = (ushort)Math::frnd(Math::clamp(quantized, 0.0f, AnimKeyVectorSteps));
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline Math::vec3
+AnimDecompressVector(const ushort* key, const Math::vec3& offset, const Math::vec3& scale)
+{
+    return Math::vec3(offset.x + key[0] * scale.x, offset.y + key[1] * scale.y, offset.z + key[2] * scale.z);
+}
+
+} // namespace CoreAnimation
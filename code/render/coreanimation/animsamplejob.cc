@@ -7,6 +7,9 @@
 #include "animkeybuffer.h"
 #include "animcurve.h"
 #include "animclip.h"
+#include "animkeycompression.h"
+#include "sampletype.h"
+#include "core/simd.h"
 
 using namespace Math;
 namespace CoreAnimation
@@ -32,6 +35,8 @@ WrapTime(
 
 //------------------------------------------------------------------------------
 /**
+    Playback mostly moves forward, so the interval used last time and the one
+    after it are tried first, before searching all intervals of the curve.
 */
 AnimKeyBuffer::Interval
 FindNextInterval(
@@ -41,25 +46,29 @@ FindNextInterval(
     , const AnimKeyBuffer::Interval* sampleTimes
 )
 {
-    if (time < sampleTimes[curve.firstIntervalOffset + key].start)
+    const AnimKeyBuffer::Interval* intervals = sampleTimes + curve.firstIntervalOffset;
+    uint const last = curve.numIntervals - 1;
+    if (key > last)
         key = 0;
 
-    AnimKeyBuffer::Interval interval = sampleTimes[curve.firstIntervalOffset + key];
+    // The last interval also takes every time after it
+    if (time >= intervals[key].start && (time < intervals[key].end || key == last))
+        return intervals[key];
+    if (key < last && time >= intervals[key + 1].start && (time < intervals[key + 1].end || key + 1 == last))
+        return intervals[++key];
 
-    // Check each time if it's behind the current time.
-    // We are looking the find the first key after the current sample time, such that
-    // key - 1 and key is before and after the current sample time. 
-    while (key < curve.numIntervals - 1)
+    // Find the last interval starting at or before the time
+    uint low = 0, high = last;
+    while (low < high)
     {
-        if (time >= interval.start && time < interval.end)
-            break;
+        uint const mid = (low + high + 1) / 2;
+        if (intervals[mid].start <= time)
+            low = mid;
         else
-            ++key;
-
-        interval = sampleTimes[curve.firstIntervalOffset + key];
+            high = mid - 1;
     }
-
-    return interval;
+    key = low;
+    return intervals[key];
 }
 
 //------------------------------------------------------------------------------
@@ -290,4 +299,333 @@ AnimMix(
     }
 }
 
+//------------------------------------------------------------------------------
+/**
+    Compressed curves are decoded four at a time. Curves are collected into a batch
+    per key type as they are visited, and a batch is decoded, interpolated and
+    written to the samples once it's full or all curves of the clip have been visited.
+*/
+struct AnimCompressedBatch
+{
+    const ushort* key0[4];
+    const ushort* key1[4];
+    const AnimCurve* curves[4];
+    float weights[4];
+    float* outputs[4];
+    SizeT count;
+};
+
+//------------------------------------------------------------------------------
+/**
+    Unused lanes repeat the first one, so that they decode to something valid.
+*/
+static inline void
+GatherKeys(const AnimCompressedBatch& batch, bool key1, float (&values)[3][4])
+{
+    for (IndexT lane = 0; lane < 4; lane++)
+    {
+        const ushort* key = key1 ? batch.key1[lane < batch.count ? lane : 0] : batch.key0[lane < batch.count ? lane : 0];
+        values[0][lane] = key[0];
+        values[1][lane] = key[1];
+        values[2][lane] = key[2];
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static inline void
+DecodeSmallestThree(const float (&values)[3][4], const float (&largest)[4], f32x4 (&q)[4])
+{
+    f32x4 const step = splat_f32x4(2.0f * AnimKeyRotationRange / AnimKeyRotationSteps);
+    f32x4 const offset = splat_f32x4(-AnimKeyRotationRange);
+    f32x4 const a = fma_f32x4(load_unaligned_f32x4(values[0]), step, offset);
+    f32x4 const b = fma_f32x4(load_unaligned_f32x4(values[1]), step, offset);
+    f32x4 const c = fma_f32x4(load_unaligned_f32x4(values[2]), step, offset);
+    f32x4 const squares = fma_f32x4(a, a, fma_f32x4(b, b, mul_f32x4(c, c)));
+    f32x4 const d = sqrt_f32x4(max_f32x4(sub_f32x4(splat_f32x4(1.0f), squares), splat_f32x4(0.0f)));
+
+    // The left out component goes in its place, the other three keep their order
+    f32x4 const index = load_unaligned_f32x4(largest);
+    u32x4 const is0 = compare_equal_f32x4(index, splat_f32x4(0.0f));
+    u32x4 const is1 = compare_equal_f32x4(index, splat_f32x4(1.0f));
+    u32x4 const is2 = compare_equal_f32x4(index, splat_f32x4(2.0f));
+    u32x4 const is3 = compare_equal_f32x4(index, splat_f32x4(3.0f));
+    q[0] = select_f32x4(a, d, is0);
+    q[1] = select_f32x4(select_f32x4(b, a, is0), d, is1);
+    q[2] = select_f32x4(select_f32x4(c, b, or_u32x4(is0, is1)), d, is2);
+    q[3] = select_f32x4(c, d, is3);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Interpolates with a normalized lerp, which is close to a slerp for keys as
+    close together as the ones of a sampled animation.
+*/
+static void
+DecodeRotations(AnimCompressedBatch& batch)
+{
+    float values[3][4], largest[4], weights[4];
+    for (IndexT lane = 0; lane < 4; lane++)
+    {
+        IndexT const src = lane < batch.count ? lane : 0;
+        weights[lane] = batch.weights[src];
+    }
+
+    f32x4 q0[4], q1[4];
+    for (IndexT lane = 0; lane < 4; lane++)
+    {
+        const ushort* key = batch.key0[lane < batch.count ? lane : 0];
+        largest[lane] = float((key[0] >> 15) | ((key[1] >> 15) << 1));
+        values[0][lane] = float(key[0] & 0x7FFF);
+        values[1][lane] = float(key[1] & 0x7FFF);
+        values[2][lane] = float(key[2] & 0x7FFF);
+    }
+    DecodeSmallestThree(values, largest, q0);
+    for (IndexT lane = 0; lane < 4; lane++)
+    {
+        const ushort* key = batch.key1[lane < batch.count ? lane : 0];
+        largest[lane] = float((key[0] >> 15) | ((key[1] >> 15) << 1));
+        values[0][lane] = float(key[0] & 0x7FFF);
+        values[1][lane] = float(key[1] & 0x7FFF);
+        values[2][lane] = float(key[2] & 0x7FFF);
+    }
+    DecodeSmallestThree(values, largest, q1);
+
+    // Take the shortest path between the two keys
+    f32x4 const cosine = fma_f32x4(q0[0], q1[0], fma_f32x4(q0[1], q1[1], fma_f32x4(q0[2], q1[2], mul_f32x4(q0[3], q1[3]))));
+    u32x4 const flip = compare_less_f32x4(cosine, splat_f32x4(0.0f));
+    f32x4 const weight = load_unaligned_f32x4(weights);
+    f32x4 q[4];
+    for (IndexT i = 0; i < 4; i++)
+    {
+        f32x4 const target = select_f32x4(q1[i], flip_sign_f32x4(q1[i]), flip);
+        q[i] = fma_f32x4(sub_f32x4(target, q0[i]), weight, q0[i]);
+    }
+    f32x4 const length = sqrt_f32x4(fma_f32x4(q[0], q[0], fma_f32x4(q[1], q[1], fma_f32x4(q[2], q[2], mul_f32x4(q[3], q[3])))));
+    f32x4 const invLength = div_f32x4(splat_f32x4(1.0f), length);
+
+    float result[4][4];
+    for (IndexT i = 0; i < 4; i++)
+        store_f32x4(mul_f32x4(q[i], invLength), result[i]);
+    for (IndexT lane = 0; lane < batch.count; lane++)
+    {
+        float* out = batch.outputs[lane];
+        out[0] = result[0][lane];
+        out[1] = result[1][lane];
+        out[2] = result[2][lane];
+        out[3] = result[3][lane];
+    }
+    batch.count = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+DecodeVectors(AnimCompressedBatch& batch, const vec4& velocityScale)
+{
+    float values0[3][4], values1[3][4], offsets[3][4], scales[3][4], weights[4];
+    GatherKeys(batch, false, values0);
+    GatherKeys(batch, true, values1);
+    for (IndexT lane = 0; lane < 4; lane++)
+    {
+        IndexT const src = lane < batch.count ? lane : 0;
+        const AnimCurve& curve = *batch.curves[src];
+        for (IndexT i = 0; i < 3; i++)
+        {
+            offsets[i][lane] = curve.keyOffset[i];
+            scales[i][lane] = curve.keyScale[i];
+        }
+        weights[lane] = batch.weights[src];
+    }
+
+    f32x4 const weight = load_unaligned_f32x4(weights);
+    float result[3][4];
+    for (IndexT i = 0; i < 3; i++)
+    {
+        f32x4 const offset = load_unaligned_f32x4(offsets[i]);
+        f32x4 const scale = load_unaligned_f32x4(scales[i]);
+        f32x4 const v0 = fma_f32x4(load_unaligned_f32x4(values0[i]), scale, offset);
+        f32x4 const v1 = fma_f32x4(load_unaligned_f32x4(values1[i]), scale, offset);
+        store_f32x4(fma_f32x4(sub_f32x4(v1, v0), weight, v0), result[i]);
+    }
+
+    for (IndexT lane = 0; lane < batch.count; lane++)
+    {
+        float* out = batch.outputs[lane];
+        bool const velocity = batch.curves[lane]->curveType == CurveType::Velocity;
+        out[0] = velocity ? result[0][lane] * velocityScale.x : result[0][lane];
+        out[1] = velocity ? result[1][lane] * velocityScale.y : result[1][lane];
+        out[2] = velocity ? result[2][lane] * velocityScale.z : result[2][lane];
+    }
+    batch.count = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Step sampling is linear sampling with a weight of zero, which decodes to the
+    first key of the interval.
+*/
+static void
+AnimSampleCompressed(
+    const AnimClip& clip,
+    const Util::FixedArray<AnimCurve>& curves,
+    const Timing::Tick time,
+    const vec4& velocityScale,
+    const Util::FixedArray<Math::vec4>& idleSamples,
+    const ushort* srcKeyPtr,
+    const AnimKeyBuffer::Interval* intervalPtr,
+    uint* lastUsedIntervalPtr,
+    float* outSamplePtr,
+    uchar* outSampleCounts,
+    bool interpolate)
+{
+    AnimCompressedBatch rotations, vectors;
+    rotations.count = 0;
+    vectors.count = 0;
+
+    int i;
+    for (i = 0; i < clip.numCurves; i++)
+    {
+        const AnimCurve& curve = curves[clip.firstCurve + i];
+        const bool rotation = curve.curveType == CurveType::Rotation;
+        const int stride = rotation ? 4 : 3;
+        n_assert(rotation || curve.curveType == CurveType::Translation || curve.curveType == CurveType::Scale || curve.curveType == CurveType::Velocity);
+
+        if (curve.isStatic)
+        {
+            // The only key of a static curve is stored uncompressed
+            vec4 value = curve.keyOffset;
+            if (curve.curveType == CurveType::Velocity)
+                value = value * velocityScale;
+            outSamplePtr[0] = value.x;
+            outSamplePtr[1] = value.y;
+            outSamplePtr[2] = value.z;
+            if (rotation)
+                outSamplePtr[3] = value.w;
+        }
+        else if (curve.numIntervals > 0)
+        {
+            uint& key = lastUsedIntervalPtr[i];
+            AnimKeyBuffer::Interval curveLastTime = intervalPtr[curve.firstIntervalOffset + curve.numIntervals - 1];
+            Timing::Tick wrappedTime = WrapTime(curve, time, curveLastTime.end);
+            AnimKeyBuffer::Interval currentTime = FindNextInterval(curve, wrappedTime, key, intervalPtr);
+
+            float sampleWeight = 0.0f;
+            if (interpolate)
+            {
+                if (wrappedTime >= currentTime.end)
+                    sampleWeight = 1.0f;
+                else
+                    sampleWeight = Math::max(0.0f, (wrappedTime - currentTime.start) * currentTime.duration);
+            }
+
+            AnimCompressedBatch& batch = rotation ? rotations : vectors;
+            batch.key0[batch.count] = srcKeyPtr + currentTime.key0;
+            batch.key1[batch.count] = srcKeyPtr + currentTime.key1;
+            batch.curves[batch.count] = &curve;
+            batch.weights[batch.count] = sampleWeight;
+            batch.outputs[batch.count] = outSamplePtr;
+            if (++batch.count == 4)
+            {
+                if (rotation)
+                    DecodeRotations(batch);
+                else
+                    DecodeVectors(batch, velocityScale);
+            }
+        }
+        else
+        {
+            const vec4& idle = idleSamples[i];
+            outSamplePtr[0] = idle.x;
+            outSamplePtr[1] = idle.y;
+            outSamplePtr[2] = idle.z;
+            if (rotation)
+                outSamplePtr[3] = idle.w;
+        }
+
+        outSamplePtr += stride;
+        outSampleCounts[i] = curve.isStatic || curve.numIntervals > 0;
+    }
+
+    if (rotations.count > 0)
+        DecodeRotations(rotations);
+    if (vectors.count > 0)
+        DecodeVectors(vectors, velocityScale);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AnimSampleStepCompressed(
+    const AnimClip& clip,
+    const Util::FixedArray<AnimCurve>& curves,
+    const Timing::Tick time,
+    const vec4& velocityScale,
+    const Util::FixedArray<Math::vec4>& idleSamples,
+    const ushort* srcKeyPtr,
+    const AnimKeyBuffer::Interval* intervalPtr,
+    uint* lastUsedIntervalPtr,
+    float* outSamplePtr,
+    uchar* outSampleCounts)
+{
+    AnimSampleCompressed(clip, curves, time, velocityScale, idleSamples, srcKeyPtr, intervalPtr, lastUsedIntervalPtr, outSamplePtr, outSampleCounts, false);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AnimSampleLinearCompressed(
+    const AnimClip& clip,
+    const Util::FixedArray<AnimCurve>& curves,
+    const Timing::Tick time,
+    const vec4& velocityScale,
+    const Util::FixedArray<Math::vec4>& idleSamples,
+    const ushort* srcKeyPtr,
+    const AnimKeyBuffer::Interval* intervalPtr,
+    uint* lastUsedIntervalPtr,
+    float* outSamplePtr,
+    uchar* outSampleCounts)
+{
+    AnimSampleCompressed(clip, curves, time, velocityScale, idleSamples, srcKeyPtr, intervalPtr, lastUsedIntervalPtr, outSamplePtr, outSampleCounts, true);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AnimSample(
+    const AnimClip& clip,
+    const Util::FixedArray<AnimCurve>& curves,
+    const Timing::Tick time,
+    const vec4& velocityScale,
+    const Util::FixedArray<Math::vec4>& idleSamples,
+    const AnimKeyBuffer* keyBuffer,
+    const SampleType::Code sampleType,
+    uint* lastUsedIntervalPtr,
+    float* outSamplePtr,
+    uchar* outSampleCounts)
+{
+    const AnimKeyBuffer::Interval* intervalPtr = keyBuffer->GetIntervalBufferPointer();
+    if (keyBuffer->IsCompressed())
+    {
+        const ushort* srcKeyPtr = keyBuffer->GetCompressedKeyBufferPointer();
+        if (sampleType == SampleType::Step)
+            AnimSampleStepCompressed(clip, curves, time, velocityScale, idleSamples, srcKeyPtr, intervalPtr, lastUsedIntervalPtr, outSamplePtr, outSampleCounts);
+        else
+            AnimSampleLinearCompressed(clip, curves, time, velocityScale, idleSamples, srcKeyPtr, intervalPtr, lastUsedIntervalPtr, outSamplePtr, outSampleCounts);
+    }
+    else
+    {
+        const float* srcSamplePtr = keyBuffer->GetKeyBufferPointer();
+        if (sampleType == SampleType::Step)
+            AnimSampleStep(clip, curves, time, velocityScale, idleSamples, srcSamplePtr, intervalPtr, lastUsedIntervalPtr, outSamplePtr, outSampleCounts);
+        else
+            AnimSampleLinear(clip, curves, time, velocityScale, idleSamples, srcSamplePtr, intervalPtr, lastUsedIntervalPtr, outSamplePtr, outSampleCounts);
+    }
+}
+
 } // namespace CoreAnimation
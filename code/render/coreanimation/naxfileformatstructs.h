@@ -16,6 +16,7 @@ namespace CoreAnimation
 #pragma pack(push, 1)
 
 #define NEBULA_NAX3_MAGICNUMBER 'NA01'
+#define NEBULA_NAX4_MAGICNUMBER 'NA02'
 
 //------------------------------------------------------------------------------
 /** 
@@ -75,6 +76,29 @@ struct Nax3Curve
     uchar curveType;                // CoreAnimation::CurveType::Code
 };
 
+//------------------------------------------------------------------------------
+/**
+    NAX4 file format structs, NAX4 files are NAX3 files with compressed keys,
+    see coreanimation/animkeycompression.h. Curves with the same value for all
+    their keys have no intervals, and store their key in the curve instead.
+*/
+enum Nax4CurveFlags
+{
+    Nax4CurveStatic = 1 << 0
+};
+
+struct Nax4Curve
+{
+    uint firstIntervalOffset;
+    uint numIntervals;
+    uchar preInfinityType;          // CoreAnimation::InfinityType::Code
+    uchar postInfinityType;         // CoreAnimation::InfinityType::Code
+    uchar curveType;                // CoreAnimation::CurveType::Code
+    uchar flags;                    // CoreAnimation::Nax4CurveFlags
+    float keyOffset[4];             // range minimum of the keys, or the key of a static curve
+    float keyScale[3];              // range of the keys, divided by the largest quantized value
+};
+
 //------------------------------------------------------------------------------
 /** 
     legacy NAX2 file format structs
@@ -13,6 +13,7 @@
 #include "util/array.h"
 #include "ids/idpool.h"
 #include "memory/rangeallocator.h"
+#include "profiling/profiling.h"
 #if __VULKAN__
 #include "vk/vkloader.h"
 #endif
@@ -79,7 +80,7 @@ struct MemoryPool
     Util::Array<void*> blockMappedPointers;
     DeviceSize size;
 
-    const char* budgetCounter;
+    Profiling::ProfilingCounter budgetCounter;
     DeviceSize maxSize;
     bool mapMemory;
 
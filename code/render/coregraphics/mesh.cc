@@ -37,6 +37,7 @@ CreateMesh(const MeshCreateInfo& info)
         .vertexLayout = info.vertexLayout,
         .primitiveTopology = info.topology,
         .primitiveGroups = info.primitiveGroups,
+        .meshlets = info.meshlets,
     };
     meshAllocator.Set<Mesh_Internals>(id, internals);
     meshAllocator.Release(id);
@@ -72,6 +73,15 @@ MeshGetPrimitiveGroup(const MeshId id, const IndexT group)
     return meshAllocator.ConstGet<Mesh_Internals>(id.id).primitiveGroups[group];
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+const Util::Array<CoreGraphics::Meshlet>&
+MeshGetMeshlets(const MeshId id)
+{
+    return meshAllocator.ConstGet<Mesh_Internals>(id.id).meshlets;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
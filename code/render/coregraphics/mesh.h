@@ -26,6 +26,17 @@ struct VertexAlloc
 
 struct CmdBufferId;
 
+/// a cluster of triangles of a primitive group, see Nvx3Meshlet for the culling test
+struct Meshlet
+{
+    uint firstIndex;
+    uint numIndices;
+    float boundingSphere[4];
+    float coneApex[3];
+    float coneAxis[3];
+    float coneCutoff;
+};
+
 ID_24_8_TYPE(MeshId);
 
 struct VertexStream
@@ -45,6 +56,7 @@ struct MeshCreateInfo
     VertexLayoutId vertexLayout = CoreGraphics::InvalidVertexLayoutId;
     CoreGraphics::PrimitiveTopology::Code topology = CoreGraphics::PrimitiveTopology::InvalidPrimitiveTopology;
     Util::Array<CoreGraphics::PrimitiveGroup> primitiveGroups;
+    Util::Array<CoreGraphics::Meshlet> meshlets;
 };
 
 /// create new mesh
@@ -56,6 +68,8 @@ void DestroyMesh(const MeshId id);
 const Util::Array<CoreGraphics::PrimitiveGroup>& MeshGetPrimitiveGroups(const MeshId id);
 /// get primitive group
 const CoreGraphics::PrimitiveGroup MeshGetPrimitiveGroup(const MeshId id, const IndexT group);
+/// get meshlets of all primitive groups, empty if the mesh has none
+const Util::Array<CoreGraphics::Meshlet>& MeshGetMeshlets(const MeshId id);
 /// get vertex buffer
 const BufferId MeshGetVertexBuffer(const MeshId id, const IndexT stream);
 /// Set vertex buffer
@@ -93,6 +107,7 @@ struct __Mesh
     VertexLayoutId vertexLayout;
     CoreGraphics::PrimitiveTopology::Code primitiveTopology;
     Util::Array<CoreGraphics::PrimitiveGroup> primitiveGroups;
+    Util::Array<CoreGraphics::Meshlet> meshlets;
 };
 
 typedef Ids::IdAllocatorSafe<
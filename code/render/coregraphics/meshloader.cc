@@ -26,6 +26,9 @@ MeshLoader::MeshLoader()
     this->failResourceName = "sysmsh:error.nvx";
     this->async = true;
 
+    // meshes upload their whole file, so read them into memory ahead of the loader thread
+    this->preloadFiles = true;
+
     this->streamerThreadName = "Mesh Streamer Thread";
 
     // Setup vertex layouts
@@ -143,7 +146,6 @@ MeshLoader::StreamResource(const ResourceLoadJob& job)
     auto vertexRanges = (Nvx3VertexRange*)(basePtr + header->meshDataOffset);
     auto vertexData = (ubyte*)(basePtr + header->vertexDataOffset);
     auto indexData = (ubyte*)(basePtr + header->indexDataOffset);
-    //auto meshletData = (Nvx3Meshlet*)(indexData + header->indexDataSize);
 
     CoreGraphics::BufferId vbo = CoreGraphics::GetVertexBuffer();
     CoreGraphics::BufferId ibo = CoreGraphics::GetIndexBuffer();
@@ -364,7 +366,7 @@ MeshLoader::SetupMeshFromNvx(const Ptr<IO::Stream>& stream, const ResourceLoadJo
         auto vertexRanges = (Nvx3VertexRange*)(basePtr + header->meshDataOffset);
         auto vertexData = (ubyte*)(basePtr + header->vertexDataOffset);
         auto indexData = (ubyte*)(basePtr + header->indexDataOffset);
-        //auto meshletData = (Nvx3Meshlet*)(indexData + header->indexDataSize);
+        auto meshletData = (Nvx3Meshlet*)(basePtr + header->meshletDataOffset);
 
         meshes.Resize(header->numMeshes);
 
@@ -407,6 +409,7 @@ MeshLoader::SetupMeshFromNvx(const Ptr<IO::Stream>& stream, const ResourceLoadJo
         for (uint i = 0; i < header->numMeshes; i++)
         {
             Util::Array<CoreGraphics::PrimitiveGroup> primGroups;
+            Util::Array<CoreGraphics::Meshlet> meshlets;
             const Nvx3VertexRange& range = vertexRanges[i];
 
             for (uint j = 0; j < range.numGroups; j++)
@@ -415,6 +418,27 @@ MeshLoader::SetupMeshFromNvx(const Ptr<IO::Stream>& stream, const ResourceLoadJo
                 const Nvx3Group* nvxGroup = (Nvx3Group*)(basePtr + range.firstGroupOffset + j * sizeof(Nvx3Group));
                 group.SetBaseIndex(nvxGroup->firstIndex);
                 group.SetNumIndices(nvxGroup->numIndices);
+
+                // meshlets are stored for all meshes, the mesh only keeps its own
+                if (nvxGroup->numMeshlets > 0)
+                {
+                    n_assert(nvxGroup->firstMeshlet + nvxGroup->numMeshlets <= header->numMeshlets);
+                    group.SetFirstMeshlet(meshlets.Size());
+                    group.SetNumMeshlets(nvxGroup->numMeshlets);
+                    meshlets.Reserve(meshlets.Size() + nvxGroup->numMeshlets);
+                    for (uint k = 0; k < nvxGroup->numMeshlets; k++)
+                    {
+                        const Nvx3Meshlet& nvxMeshlet = meshletData[nvxGroup->firstMeshlet + k];
+                        Meshlet meshlet;
+                        meshlet.firstIndex = nvxMeshlet.firstIndex;
+                        meshlet.numIndices = nvxMeshlet.numIndices;
+                        Memory::Copy(nvxMeshlet.boundingSphere, meshlet.boundingSphere, sizeof(meshlet.boundingSphere));
+                        Memory::Copy(nvxMeshlet.coneApex, meshlet.coneApex, sizeof(meshlet.coneApex));
+                        Memory::Copy(nvxMeshlet.coneAxis, meshlet.coneAxis, sizeof(meshlet.coneAxis));
+                        meshlet.coneCutoff = nvxMeshlet.coneCutoff;
+                        meshlets.Append(meshlet);
+                    }
+                }
                 primGroups.Append(group);
             }
             MeshCreateInfo mshInfo;
@@ -425,6 +449,7 @@ MeshLoader::SetupMeshFromNvx(const Ptr<IO::Stream>& stream, const ResourceLoadJo
             mshInfo.topology = PrimitiveTopology::TriangleList;
             mshInfo.indexType = range.indexType;
             mshInfo.primitiveGroups = primGroups;
+            mshInfo.meshlets = meshlets;
             mshInfo.vertexLayout = Layouts[(uint)range.layout];
             mshInfo.name = job.name;
             MeshId mesh = CreateMesh(mshInfo);
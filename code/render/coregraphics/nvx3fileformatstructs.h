@@ -58,11 +58,26 @@ struct Nvx3Group
     uint numMeshlets;               // Number of meshlets for this primitive group
 };
 
+//------------------------------------------------------------------------------
+/**
+    A cluster of at most 124 triangles referencing at most 64 unique vertices.
+    The triangles of a meshlet are contiguous in the index buffer, so
+    firstIndex is relative to the index range of the mesh, like Nvx3Group.
+
+    The normal cone allows backface culling a whole meshlet, it is culled if
+    dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff. A
+    cutoff of 1 and a zero axis mean the meshlet faces too many directions
+    to ever be culled.
+*/
 struct Nvx3Meshlet
 {
-    uint indexOffset;
     uint firstIndex;
     uint numIndices;
+    uint numVertices;
+    float boundingSphere[4];        // xyz center, w radius
+    float coneApex[3];
+    float coneAxis[3];
+    float coneCutoff;
 };
 
 
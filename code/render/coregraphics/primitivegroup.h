@@ -40,12 +40,22 @@ public:
     SizeT GetNumIndices() const;
     /// get computed number of primitives
     SizeT GetNumPrimitives(const CoreGraphics::PrimitiveTopology::Code& topo) const;
+    /// set first meshlet, indexes the meshlets of the mesh
+    void SetFirstMeshlet(IndexT i);
+    /// get first meshlet
+    IndexT GetFirstMeshlet() const;
+    /// set number of meshlets, 0 if the group has not been split into meshlets
+    void SetNumMeshlets(SizeT n);
+    /// get number of meshlets
+    SizeT GetNumMeshlets() const;
 
 private:
     IndexT baseVertex;
     SizeT numVertices;
     IndexT baseIndex;
     SizeT numIndices;
+    IndexT firstMeshlet;
+    SizeT numMeshlets;
 };
 
 //------------------------------------------------------------------------------
@@ -56,7 +66,9 @@ PrimitiveGroup::PrimitiveGroup() :
     baseVertex(0),
     numVertices(0),
     baseIndex(0),
-    numIndices(0)
+    numIndices(0),
+    firstMeshlet(0),
+    numMeshlets(0)
 {
     // empty
 }
@@ -149,6 +161,42 @@ PrimitiveGroup::GetNumPrimitives(const CoreGraphics::PrimitiveTopology::Code& to
     }
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+PrimitiveGroup::SetFirstMeshlet(IndexT i)
+{
+    this->firstMeshlet = i;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline IndexT
+PrimitiveGroup::GetFirstMeshlet() const
+{
+    return this->firstMeshlet;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+PrimitiveGroup::SetNumMeshlets(SizeT n)
+{
+    this->numMeshlets = n;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+PrimitiveGroup::GetNumMeshlets() const
+{
+    return this->numMeshlets;
+}
+
 } // namespace PrimitiveGroup
 //------------------------------------------------------------------------------
 
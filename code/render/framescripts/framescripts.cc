@@ -44,6 +44,7 @@ DrawBatch(const CoreGraphics::CmdBufferId cmdBuf, MaterialTemplatesGPULang::Batc
                     uint32_t baseInstance = 0;
                     CoreGraphics::PrimitiveGroup primGroup;
                     CoreGraphics::MeshId mesh = CoreGraphics::InvalidMeshId;
+                    bool instanced = false;
 
                     for (uint packetIndex = start; packetIndex < end; ++packetIndex)
                     {
@@ -76,9 +77,34 @@ DrawBatch(const CoreGraphics::CmdBufferId cmdBuf, MaterialTemplatesGPULang::Batc
                         // If new draw setup, progress to the next one
                         if (visDrawCmd && visDrawCmd->offset == packetIndex)
                         {
-                            Models::ShaderStateNode::DrawPacket* instance = drawList->drawPackets[packetIndex];
-                            instance->Apply(cmdBuf, pass->index, bufferIndex);
-                            CoreGraphics::CmdDraw(cmdBuf, visDrawCmd->numInstances, visDrawCmd->baseInstance, visDrawCmd->primitiveGroup);
+                            if (visDrawCmd->numPackets > 1 && pass->instancedProgram != CoreGraphics::InvalidShaderProgramId)
+                            {
+                                // Draw identical node instances at once, the first packet points to the block holding their transforms
+                                if (!instanced)
+                                {
+                                    CoreGraphics::CmdSetShaderProgram(cmdBuf, pass->instancedProgram, CoreGraphics::GraphicsQueueType);
+                                    CoreGraphics::CmdSetGraphicsPipeline(cmdBuf);
+                                    instanced = true;
+                                }
+                                Models::ShaderStateNode::DrawPacket* instance = drawList->drawPackets[packetIndex];
+                                instance->Apply(cmdBuf, pass->index, bufferIndex);
+                                CoreGraphics::CmdDraw(cmdBuf, visDrawCmd->numPackets, visDrawCmd->firstInstance, visDrawCmd->primitiveGroup);
+                            }
+                            else
+                            {
+                                if (instanced)
+                                {
+                                    CoreGraphics::CmdSetShaderProgram(cmdBuf, pass->program, CoreGraphics::GraphicsQueueType);
+                                    CoreGraphics::CmdSetGraphicsPipeline(cmdBuf);
+                                    instanced = false;
+                                }
+                                for (uint i = 0; i < visDrawCmd->numPackets; i++)
+                                {
+                                    Models::ShaderStateNode::DrawPacket* instance = drawList->drawPackets[packetIndex + i];
+                                    instance->Apply(cmdBuf, pass->index, bufferIndex);
+                                    CoreGraphics::CmdDraw(cmdBuf, visDrawCmd->numInstances, visDrawCmd->baseInstance, visDrawCmd->primitiveGroup);
+                                }
+                            }
                             visDrawCmd++;
 
                             if (visDrawCmd == visBatchCmd.draws.End())
@@ -160,9 +186,13 @@ DrawBatch(const CoreGraphics::CmdBufferId cmdBuf, MaterialTemplatesGPULang::Batc
                         // If new draw setup, progress to the next one
                         if (visDrawCmd && visDrawCmd->offset == packetIndex)
                         {
-                            Models::ShaderStateNode::DrawPacket* instance = drawList->drawPackets[packetIndex];
-                            instance->Apply(cmdBuf, pass->index, bufferIndex);
-                            CoreGraphics::CmdDraw(cmdBuf, visDrawCmd->numInstances * numInstances, visDrawCmd->baseInstance + baseInstance, visDrawCmd->primitiveGroup);
+                            // The instance index is already taken by the caller, so merged node instances are drawn one by one
+                            for (uint i = 0; i < visDrawCmd->numPackets; i++)
+                            {
+                                Models::ShaderStateNode::DrawPacket* instance = drawList->drawPackets[packetIndex + i];
+                                instance->Apply(cmdBuf, pass->index, bufferIndex);
+                                CoreGraphics::CmdDraw(cmdBuf, visDrawCmd->numInstances * numInstances, visDrawCmd->baseInstance + baseInstance, visDrawCmd->primitiveGroup);
+                            }
 
                             visDrawCmd++;
 
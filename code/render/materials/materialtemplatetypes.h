@@ -155,6 +155,7 @@ namespace MaterialTemplatesGPULang
         {
             CoreGraphics::ShaderId shader;
             CoreGraphics::ShaderProgramId program;
+            CoreGraphics::ShaderProgramId instancedProgram;     // used to draw runs of identical node instances, if valid
             uint index;
             const char* name;
             IndexT bufferIndex;
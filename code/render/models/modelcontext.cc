@@ -33,6 +33,7 @@ __ImplementContext(ModelContext, ModelContext::modelContextAllocator);
 
 Threading::AtomicCounter ModelContext::ConstantsUpdateCounter = 0;
 Threading::AtomicCounter ModelContext::TransformsUpdateCounter = 0;
+Threading::AtomicCounter ModelContext::LodUpdateCounter = 0;
 
 Memory::RangeAllocator ModelContext::TransformInstanceAllocator, ModelContext::RenderInstanceAllocator;
 
@@ -162,6 +163,7 @@ ModelContext::Setup(
         {
             NodeInstances.renderable.nodeStates.Extend(stateRange.end);
             NodeInstances.renderable.nodeTransformIndex.Extend(stateRange.end);
+            NodeInstances.renderable.nodeWorldTransforms.Extend(stateRange.end);
             NodeInstances.renderable.nodeBoundingBoxes.Extend(stateRange.end);
             NodeInstances.renderable.origBoundingBoxes.Extend(stateRange.end);
             NodeInstances.renderable.nodeLodDistances.Extend(stateRange.end);
@@ -315,6 +317,7 @@ ModelContext::Setup(
     {
         NodeInstances.renderable.nodeStates.Extend(stateRange.end);
         NodeInstances.renderable.nodeTransformIndex.Extend(stateRange.end);
+        NodeInstances.renderable.nodeWorldTransforms.Extend(stateRange.end);
         NodeInstances.renderable.nodeBoundingBoxes.Extend(stateRange.end);
         NodeInstances.renderable.origBoundingBoxes.Extend(stateRange.end);
         NodeInstances.renderable.nodeLodDistances.Extend(stateRange.end);
@@ -438,6 +441,7 @@ ModelContext::Setup(
         {
             NodeInstances.renderable.nodeStates.Extend(stateRange.end);
             NodeInstances.renderable.nodeTransformIndex.Extend(stateRange.end);
+            NodeInstances.renderable.nodeWorldTransforms.Extend(stateRange.end);
             NodeInstances.renderable.nodeBoundingBoxes.Extend(stateRange.end);
             NodeInstances.renderable.origBoundingBoxes.Extend(stateRange.end);
             NodeInstances.renderable.nodeLodDistances.Extend(stateRange.end);
@@ -888,9 +892,8 @@ ModelContext::UpdateTransforms(const Graphics::FrameContext& ctx)
         }
     }, nodeInstanceTransformRanges.Size(), 256, nullptr, &TransformsUpdateCounter, nullptr);
 
-    static Threading::AtomicCounter lodUpdateCounter = 0;
-    n_assert(lodUpdateCounter == 0);
-    lodUpdateCounter = 1;
+    n_assert(LodUpdateCounter == 0);
+    LodUpdateCounter = 1;
 
     Jobs2::JobDispatch(
         [
@@ -983,6 +986,13 @@ ModelContext::UpdateTransforms(const Graphics::FrameContext& ctx)
                     // If not, make the lod active by default
                     nodeFlag = SetBits(nodeFlag, Models::NodeInstanceFlags::NodeInstance_LodActive);
 
+                // Latch the visibility of the previous frame, observers set it again for this one
+                if (AllBits(nodeFlag, Models::NodeInstanceFlags::NodeInstance_Visible))
+                    nodeFlag = SetBits(nodeFlag, Models::NodeInstanceFlags::NodeInstance_WasVisible);
+                else
+                    nodeFlag = UnsetBits(nodeFlag, Models::NodeInstanceFlags::NodeInstance_WasVisible);
+                nodeFlag = UnsetBits(nodeFlag, Models::NodeInstanceFlags::NodeInstance_Visible);
+
                 // Set the flags back
                 NodeInstances.renderable.nodeFlags[j] = nodeFlag;
 
@@ -991,7 +1001,7 @@ ModelContext::UpdateTransforms(const Graphics::FrameContext& ctx)
 
             }
         }
-    }, nodeInstanceStateRanges.Size(), 256, { &TransformsUpdateCounter }, &lodUpdateCounter, nullptr);
+    }, nodeInstanceStateRanges.Size(), 256, { &TransformsUpdateCounter }, &LodUpdateCounter, nullptr);
 
     n_assert(ConstantsUpdateCounter == 0);
     ConstantsUpdateCounter = 1;
@@ -1027,6 +1037,7 @@ ModelContext::UpdateTransforms(const Graphics::FrameContext& ctx)
                 // Allocate object constants
                 ObjectsShared::ObjectUniforms::STRUCT block;
                 transform.store(&block.Model[0][0]);
+                NodeInstances.renderable.nodeWorldTransforms[j] = transform;
                 inverse(transform).store(&block.InvModel[0][0]);
                 block.DitherFactor = NodeInstances.renderable.nodeLods[j];
                 block.ObjectId = j;
@@ -1042,7 +1053,7 @@ ModelContext::UpdateTransforms(const Graphics::FrameContext& ctx)
                 */
             }
         }
-    }, nodeInstanceStateRanges.Size(), 256, { &lodUpdateCounter }, &ConstantsUpdateCounter, &ModelContext::completionEvent);
+    }, nodeInstanceStateRanges.Size(), 256, { &LodUpdateCounter }, &ConstantsUpdateCounter, &ModelContext::completionEvent);
 }
 
 //------------------------------------------------------------------------------
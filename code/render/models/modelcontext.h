@@ -51,6 +51,7 @@ enum class NodeInstanceFlags
     , NodeInstance_AlwaysVisible = N_BIT(3)     // Should always resolve to being visible by visibility
     , NodeInstance_Visible = N_BIT(4)           // Set to true if any observer sees it
     , NodeInstance_Moved = N_BIT(5)
+    , NodeInstance_WasVisible = N_BIT(6)        // Set if any observer saw it the previous frame, valid once the LOD update is done
 };
 __ImplementEnumBitOperators(NodeInstanceFlags);
 
@@ -179,6 +180,7 @@ public:
             Util::PinnedArray<0xFFFF, float> nodeLods;
             Util::PinnedArray<0xFFFF, float> textureLods;
             Util::PinnedArray<0xFFFF, uint32_t> nodeTransformIndex;
+            Util::PinnedArray<0xFFFF, Math::mat4> nodeWorldTransforms;
             Util::PinnedArray<0xFFFF, uint64_t> nodeSortId;
             Util::PinnedArray<0xFFFF, NodeInstanceFlags> nodeFlags;
             Util::PinnedArray<0xFFFF, Materials::MaterialId> nodeMaterials;
@@ -226,6 +228,7 @@ public:
 
     static Threading::AtomicCounter ConstantsUpdateCounter;
     static Threading::AtomicCounter TransformsUpdateCounter;
+    static Threading::AtomicCounter LodUpdateCounter;
 
 private:
     friend class Visibility::VisibilityContext;
@@ -1,10 +1,11 @@
 #pragma once
 //------------------------------------------------------------------------------
 /**
-    @class Particles::Particle
+    @class Particles::ParticleStore
     
-    The particle structure holds the current state of a single particle and
-    common data for particle-job and nebula3 particle system
+    The particle store holds the current state of the particles of a system, in
+    structure of arrays layout so the step kernel can update several particles
+    at once, and common data for particle-job and nebula3 particle system
 
     !! NOTE: this header is also included from job particlejob.cc, so only 
     !! job-compliant headers can be included here
@@ -19,6 +20,8 @@
 #include "particles/emitterattrs.h"
 #include "threading/interlocked.h"
 #include "threading/event.h"
+#include "util/fixedarray.h"
+#include "core/simd.h"
 
 //------------------------------------------------------------------------------
 namespace Particles
@@ -27,22 +30,62 @@ namespace Particles
     static const SizeT ParticleSystemNumEnvelopeSamples = 192;
     static const SizeT MaxNumRenderedParticles = 65535;
 
-    struct Particle
+    /// number of particles the step kernel updates at once
+    static const SizeT ParticleKernelWidth = 4;
+
+    /// per particle render data, matches the per instance components of the particle vertex layout
+    struct ParticleVertex
     {
         Math::vec4 position;
-        Math::vec4 startPosition;
         Math::vec4 stretchPosition;
-        Math::vec4 velocity;
-        Math::vec4 uvMinMax;
         Math::vec4 color;
-        float rotation;      
-        float rotationVariation;
-        float size;
-        float sizeVariation;
-        float oneDivLifeTime;
-        float relAge;                       // between 0 and 1, particle is dead if age > 1.0
-        float age;                          // absolute age
-        float particleId;                   // id for differing particles in vertex shader
+        Math::vec4 uvMinMax;
+        Math::vec4 rotationSize;            // x: sin(rotation), y: cos(rotation), z: size, w: particle id
+    };
+
+    /// state of the particles of a system, as one stream per attribute
+    struct ParticleStore
+    {
+        enum Stream
+        {
+            PositionX,
+            PositionY,
+            PositionZ,
+            StartPositionX,
+            StartPositionY,
+            StartPositionZ,
+            VelocityX,
+            VelocityY,
+            VelocityZ,
+            Rotation,
+            RotationVariation,
+            SizeVariation,
+            OneDivLifeTime,
+            RelAge,                         // between 0 and 1, particle is dead if age > 1.0
+            Age,                            // absolute age
+            ParticleId,                     // id for differing particles in vertex shader
+            TextureMin,                     // v coordinate of the texture tile
+            TextureMax,
+
+            NumStreams
+        };
+
+        /// constructor
+        ParticleStore();
+        /// set the capacity, which drops all particles
+        void SetCapacity(SizeT capacity);
+        /// drop all particles
+        void Reset();
+        /// add a particle, returns InvalidIndex if the store is full
+        IndexT Append();
+        /// get a stream, padded to a multiple of the kernel width
+        float* Get(Stream stream);
+        /// get a stream, padded to a multiple of the kernel width
+        const float* Get(Stream stream) const;
+
+        Util::FixedArray<f32x4> data;
+        SizeT size;
+        SizeT capacity;
     };
 
     typedef unsigned int JOB_ID;
@@ -75,20 +118,67 @@ namespace Particles
         unsigned int numParticlesToRender;
     };
 
-    struct ParticleJobContext
+    /// update the particles of a system, removing the dead ones and writing the ones to render
+    extern void ParticleSystemStep(const ParticleJobUniformData* perSystemUniforms, const float stepTime, ParticleStore& particles, ParticleVertex* renderOutput, ParticleJobSliceOutputData* output);
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    inline
+    ParticleStore::ParticleStore()
+        : size(0)
+        , capacity(0)
     {
-        const Particle* inputParticles;
-        Particle* outputParticles;
-        const ParticleJobUniformData* uniformData;
-        float stepTime;
-        uint numParticles;
-        ParticleJobSliceOutputData* output;
-    };
+    }
 
-    static const SizeT ParticleJobInputElementSize = sizeof(Particle);
+    //------------------------------------------------------------------------------
+    /**
+    */
+    inline void
+    ParticleStore::SetCapacity(SizeT capacity)
+    {
+        this->capacity = Memory::align(capacity, ParticleKernelWidth);
+        this->data.Resize(NumStreams * this->capacity / ParticleKernelWidth);
+        this->size = 0;
+    }
 
-    static const SizeT ParticleJobInputMaxElementsPerSlice = JobMaxSliceSize / ParticleJobInputElementSize;
-    static const SizeT ParticleJobInputSliceSize = ParticleJobInputMaxElementsPerSlice * ParticleJobInputElementSize;
+    //------------------------------------------------------------------------------
+    /**
+    */
+    inline void
+    ParticleStore::Reset()
+    {
+        this->size = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    inline IndexT
+    ParticleStore::Append()
+    {
+        if (this->size == this->capacity)
+            return InvalidIndex;
+        return this->size++;
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    inline float*
+    ParticleStore::Get(Stream stream)
+    {
+        return (float*)(this->data.Begin() + stream * this->capacity / ParticleKernelWidth);
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    inline const float*
+    ParticleStore::Get(Stream stream) const
+    {
+        return (const float*)(this->data.Begin() + stream * this->capacity / ParticleKernelWidth);
+    }
 
 } // namespace Particles
 //------------------------------------------------------------------------------
@@ -25,10 +25,6 @@ namespace Particles
 ParticleContext::ParticleContextAllocator ParticleContext::particleContextAllocator;
 __ImplementContext(ParticleContext, ParticleContext::particleContextAllocator);
 
-extern void JobStep(const ParticleJobUniformData* perSystemUniforms, const float stepTime, unsigned int numParticles,
-             const Particle* particles_input, Particle* particles_output, Particle* livingParticles,
-             ParticleJobSliceOutputData* sliceOutput);
-
 const Timing::Time DefaultStepTime = 1.0f / 60.0f;
 Timing::Time StepTime = 1.0f / 60.0f;
 
@@ -36,6 +32,12 @@ const SizeT ParticleContextNumEnvelopeSamples = 192;
 Threading::AtomicCounter allSystemsCompleteCounter = 0;
 Threading::AtomicCounter ParticleContext::ConstantUpdateCounter = 0;
 Threading::Event ParticleContext::totalCompletionEvent;
+ParticleContext::SleepSettings ParticleContext::sleepSettings;
+
+N_DECLARE_COUNTER(N_PARTICLE_SYSTEMS_UPDATED, Particle Systems Updated);
+N_DECLARE_COUNTER(N_PARTICLE_SYSTEMS_SLEEPING, Particle Systems Sleeping);
+static Threading::AtomicCounter NumUpdatedSystems = 0;
+static Threading::AtomicCounter NumSleepingSystems = 0;
 
 struct
 {
@@ -269,8 +271,14 @@ ParticleContext::Setup(const Graphics::GraphicsEntityId id, const Resources::Res
                 system.emitterMesh.Setup(meshes[i - range.begin], 0);
                 system.renderableIndex = i - range.begin;
                 system.emissionCounter = 0;
+                system.prevEmissionTime = 0.0f;
+                system.emissionStartTimeOffset = 0.0f;
+                system.firstFrame = true;
                 system.particles.SetCapacity(1 + SizeT(maxFreq * maxLifeTime));
-                system.particlesToRender.Resize(1 + SizeT(maxFreq * maxLifeTime));
+                system.particlesToRender.Resize(system.particles.capacity);
+                system.outputData.bbox = Math::bbox();
+                system.outputData.numLivingParticles = 0;
+                system.outputData.numParticlesToRender = 0;
                 system.outputCapacity = 0;
                 system.sampleBuffer.Setup(attrs, ParticleContextNumEnvelopeSamples);
                 
@@ -365,16 +373,13 @@ ParticleContext::Play(const Graphics::GraphicsEntityId id, const PlayMode mode)
     if ((runtime.playing && mode == RestartIfPlaying) || !runtime.playing)
     {
         runtime.stepTime = 0;
-        runtime.prevEmissionTime = 0.0f;
-        runtime.emissionStartTimeOffset = 0.0f;
-        runtime.firstFrame = true;
         runtime.playing = true;
-    }
-    
-    for (IndexT i = 0; i < systems.Size(); i++)
-    {
-        if ((runtime.playing && mode == RestartIfPlaying) || !runtime.playing)
+
+        for (IndexT i = 0; i < systems.Size(); i++)
         {
+            systems[i].prevEmissionTime = 0.0f;
+            systems[i].emissionStartTimeOffset = 0.0f;
+            systems[i].firstFrame = true;
             systems[i].particles.Reset();
         }
     }
@@ -403,13 +408,28 @@ ParticleContext::UpdateParticles(const Graphics::FrameContext& ctx)
     const Util::Array<ParticleRuntime>& runtimes = particleContextAllocator.GetArray<Runtime>();
     const Util::Array<Util::Array<ParticleSystemRuntime>>& allSystems = particleContextAllocator.GetArray<ParticleSystems>();
     const Models::ModelContext::ModelInstance::Renderable& renderables = ModelContext::GetModelRenderables();
-    const Models::ModelContext::ModelInstance::Transformable& transformables = ModelContext::GetModelTransformables();
     const Util::Array<Graphics::GraphicsEntityId>& graphicsEntities = particleContextAllocator.GetArray<ModelContextId>();
 
+    // The jobs of the previous frame are done, so report what they did
+    static int reportedUpdated = 0, reportedSleeping = 0;
+    N_COUNTER_INCR(N_PARTICLE_SYSTEMS_UPDATED, NumUpdatedSystems);
+    N_COUNTER_INCR(N_PARTICLE_SYSTEMS_SLEEPING, NumSleepingSystems);
+    N_COUNTER_DECR(N_PARTICLE_SYSTEMS_UPDATED, reportedUpdated);
+    N_COUNTER_DECR(N_PARTICLE_SYSTEMS_SLEEPING, reportedSleeping);
+    reportedUpdated = NumUpdatedSystems;
+    reportedSleeping = NumSleepingSystems;
+    NumUpdatedSystems = 0;
+    NumSleepingSystems = 0;
+
     n_assert(allSystemsCompleteCounter == 0);
-    allSystemsCompleteCounter = runtimes.Size();
     n_assert(ParticleContext::ConstantUpdateCounter == 0);
 
+    SizeT numSystems = 0;
+    for (IndexT i = 0; i < allSystems.Size(); i++)
+        numSystems += allSystems[i].Size();
+    ParticleSystemUpdate* updates = Jobs2::JobAlloc<ParticleSystemUpdate>(Math::max(numSystems, 1));
+    SizeT numUpdates = 0;
+
     IndexT i;
     for (i = 0; i < runtimes.Size(); i++)
     {
@@ -433,42 +453,78 @@ ParticleContext::UpdateParticles(const Graphics::FrameContext& ctx)
 
         if (runtime.playing && !systems.IsEmpty())
         {
-            Jobs2::JobBeginSequence(nullptr, &allSystemsCompleteCounter);
-
             IndexT j;
             for (j = 0; j < systems.Size(); j++)
             {
                 ParticleSystemRuntime& system = systems[j];
-                renderables.nodeMeshes[stateRange.begin + system.renderableIndex] = system.meshPerFrame[frame];
-                system.transform = transformables.nodeTransforms[transformRange.begin + renderables.nodeTransformIndex[stateRange.begin + system.renderableIndex]];
+                uint32_t const node = stateRange.begin + system.renderableIndex;
+                renderables.nodeMeshes[node] = system.meshPerFrame[frame];
+
+                // Emission and the step run in the job, once the transforms and the visibility of the previous frame are known
+                ParticleSystemUpdate& update = updates[numUpdates++];
+                update.system = &system;
+                update.time = runtime.stepTime;
+                update.stepTime = float(timeDiff);
+                update.node = node;
+                update.transform = transformRange.begin + renderables.nodeTransformIndex[node];
+                update.emit = !runtime.stopping;
+            }
+            runtime.stepTime += timeDiff;
+        }
+    }
+
+    if (numUpdates > 0)
+    {
+        allSystemsCompleteCounter = 1;
+        Jobs2::JobDispatch(
+            [
+                updates
+                , cameraPosition = Graphics::CameraContext::GetTransform(Graphics::CameraContext::GetLODCameras()[0]).position
+                , settings = ParticleContext::sleepSettings
+            ]
+        (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+        {
+            N_SCOPE(ParticleStepJob, Graphics);
+            const Models::ModelContext::ModelInstance::Renderable& renderables = Models::ModelContext::GetModelRenderables();
+            const Models::ModelContext::ModelInstance::Transformable& transformables = Models::ModelContext::GetModelTransformables();
 
-#if NEBULA_USED_FIXED_PARTICLE_UPDATE_TIME
-                IndexT curStep = 0;
-                while (runtime.stepTime <= ctx.time)
+            int numUpdated = 0, numSleeping = 0;
+            for (IndexT i = 0; i < groupSize; i++)
+            {
+                IndexT index = i + invocationOffset;
+                if (index >= totalJobs)
+                    break;
+
+                const ParticleSystemUpdate& update = updates[index];
+                ParticleSystemRuntime& system = *update.system;
+                system.transform = transformables.nodeTransforms[update.transform];
+
+                // Systems far away are hidden until the camera comes closer
+                float const distance = Math::length(system.transform.position - cameraPosition);
+                if (distance > settings.sleepDistance)
                 {
-                    ParticleContext::EmitParticles(runtime, system, ParticleContext::StepTime);
-                    bool isLastJob = (runtime.stepTime + ParticleContext::StepTime) > ctx.time;
-                    ParticleContext::RunParticleStep(runtime, system, ParticleContext::StepTime, isLastJob);
-                    runtime.stepTime += ParticleContext::StepTime;
-                    curStep++;
+                    system.outputData.numParticlesToRender = 0;
+                    numSleeping++;
+                    continue;
                 }
-#else
-                if (!runtime.stopping)
+
+                // Systems nobody saw keep their particles and bounding box, so visibility can pick them up again
+                if (settings.sleepInvisible
+                    && system.outputData.numParticlesToRender > 0
+                    && !AllBits(renderables.nodeFlags[update.node], Models::NodeInstanceFlags::NodeInstance_WasVisible))
                 {
-                    ParticleContext::EmitParticles(runtime, system, float(timeDiff));
+                    numSleeping++;
+                    continue;
                 }
-                ParticleContext::RunParticleStep(runtime, system, float(timeDiff), true);
-                runtime.stepTime += timeDiff;
-#endif
-            }
 
-            // Flush queued work
-            Jobs2::JobEndSequence();
-        }
-        else
-        {
-            allSystemsCompleteCounter--;
-        }
+                if (update.emit)
+                    ParticleContext::EmitParticles(system, update.time, update.stepTime);
+                ParticleContext::StepParticles(system, update.stepTime);
+                numUpdated++;
+            }
+            Threading::Interlocked::Add(&NumUpdatedSystems, numUpdated);
+            Threading::Interlocked::Add(&NumSleepingSystems, numSleeping);
+        }, numUpdates, 8, { &Models::ModelContext::LodUpdateCounter }, &allSystemsCompleteCounter, nullptr);
     }
 
     state.numParticlesThisFrame = 0;
@@ -609,7 +665,6 @@ ParticleContext::WaitForParticleUpdates(const Graphics::FrameContext& ctx)
 
     // Get mapped CPU hosted vertices and copy to the buffer
     float* buf = (float*)state.mappedVertices[frame];
-    Math::vec4 tmp;
     IndexT i;
     for (i = 0; i < allSystems.Size(); i++)
     {
@@ -622,20 +677,9 @@ ParticleContext::WaitForParticleUpdates(const Graphics::FrameContext& ctx)
             ParticleSystemRuntime& system = systems[j];
             SizeT numParticles = system.outputData.numParticlesToRender;
 
-            // stream update vertex buffer region
-            IndexT k;
-            for (k = 0; k < system.outputData.numParticlesToRender; k++)
-            {
-                const Particle& particle = system.particlesToRender[k];
-                particle.position.stream(buf); buf += 4;
-                particle.stretchPosition.stream(buf); buf += 4;
-                particle.color.stream(buf); buf += 4;
-                particle.uvMinMax.stream(buf); buf += 4;
-                float sinRot = Math::sin(particle.rotation);
-                float cosRot = Math::cos(particle.rotation);
-                tmp.set(sinRot, cosRot, particle.size, particle.particleId);
-                tmp.stream(buf); buf += 4;
-            }
+            // the step job writes the particles in vertex layout
+            Memory::Copy(system.particlesToRender.Begin(), buf, numParticles * sizeof(ParticleVertex));
+            buf += numParticles * sizeof(ParticleVertex) / sizeof(float);
 
             // Update the meshes offset for stream 1 to offset it by the allocation this frame, and the offset for this specific system
             const IndexT nodeIndex = stateRange.begin + system.renderableIndex;
@@ -734,7 +778,7 @@ ParticleContext::RecalculateEnvelopeSamples(const Graphics::GraphicsEntityId id)
         float maxFreq = system.attrs->GetEnvelope(EmitterAttrs::EmissionFrequency).GetMaxValue();
         float maxLifeTime = system.attrs->GetEnvelope(EmitterAttrs::LifeTime).GetMaxValue();
         system.particles.SetCapacity(1 + SizeT(maxFreq * maxLifeTime));
-        system.particlesToRender.Resize(1 + SizeT(maxFreq * maxLifeTime));
+        system.particlesToRender.Resize(system.particles.capacity);
     }
 }
 #endif
@@ -742,41 +786,48 @@ ParticleContext::RecalculateEnvelopeSamples(const Graphics::GraphicsEntityId id)
 //------------------------------------------------------------------------------
 /**
 */
+void
+ParticleContext::SetSleepSettings(const SleepSettings& settings)
+{
+    n_assert(settings.sleepDistance > 0.0f);
+    ParticleContext::sleepSettings = settings;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Runs in the particle step job, time is the time of the entity before the step.
+*/
 void 
-ParticleContext::EmitParticles(ParticleRuntime& rt, ParticleSystemRuntime& srt, float stepTime)
+ParticleContext::EmitParticles(ParticleSystemRuntime& srt, Timing::Time time, float stepTime)
 {
     N_SCOPE(EmitParticles, Particles);
 
     // get the (wrapped around if looping) time since emission has started
-    rt.emissionStartTimeOffset += stepTime;
+    srt.emissionStartTimeOffset += stepTime;
     Timing::Time emDuration = srt.attrs->GetFloat(EmitterAttrs::EmissionDuration);
     Timing::Time startDelay = srt.attrs->GetFloat(EmitterAttrs::StartDelay);
     Timing::Time loopTime = emDuration + startDelay;
     bool looping = srt.attrs->GetBool(EmitterAttrs::Looping);
-    if (looping && (rt.emissionStartTimeOffset > loopTime))
+    if (looping && (srt.emissionStartTimeOffset > loopTime))
     {
         // a wrap-around
-        rt.emissionStartTimeOffset = Math::fmod((float)rt.emissionStartTimeOffset, (float)loopTime);
+        srt.emissionStartTimeOffset = Math::fmod((float)srt.emissionStartTimeOffset, (float)loopTime);
     }
 
     // if we are before the start delay, we definitely don't need to emit anything
-    if (rt.emissionStartTimeOffset < startDelay)
+    if (srt.emissionStartTimeOffset < startDelay)
     {
         // we're before the start delay
         return;
     }
-    else if ((rt.emissionStartTimeOffset > loopTime) && !looping)
+    else if ((srt.emissionStartTimeOffset > loopTime) && !looping)
     {
         // we're past the emission time
-        if (0 == (rt.stopping | rt.stopping))
-        {
-            rt.stopped = 1;
-        }
         return;
     }
 
     // compute the relative emission time (0.0 .. 1.0)
-    Timing::Time relEmissionTime = (rt.emissionStartTimeOffset - startDelay) / emDuration;
+    Timing::Time relEmissionTime = (srt.emissionStartTimeOffset - startDelay) / emDuration;
     IndexT emSampleIndex = IndexT(relEmissionTime * (Particles::ParticleContextNumEnvelopeSamples - 1));
 
     // lookup current emission frequency
@@ -787,9 +838,9 @@ ParticleContext::EmitParticles(ParticleRuntime& rt, ParticleSystemRuntime& srt,
 
         // if we haven't emitted particles in this run yet, we need to compute
         // the precalc-time and initialize the lastEmissionTime
-        if (rt.firstFrame)
+        if (srt.firstFrame)
         {
-            rt.firstFrame = false;
+            srt.firstFrame = false;
 
             // handle pre-calc if necessary, this will instantly produce
             // a number of particles to let the particle system
@@ -800,21 +851,21 @@ ParticleContext::EmitParticles(ParticleRuntime& rt, ParticleSystemRuntime& srt,
                 // during pre-calculation we need to update the particle system,
                 // but we do this with a lower step-rate for better performance
                 // (but less precision)
-                rt.prevEmissionTime = 0.0f;
+                srt.prevEmissionTime = 0.0f;
                 Timing::Time updateTime = 0.0f;
                 Timing::Time updateStep = 0.05f;
                 if (updateStep < emTimeStep)
                 {
                     updateStep = emTimeStep;
                 }
-                while (rt.prevEmissionTime < preCalcTime)
+                while (srt.prevEmissionTime < preCalcTime)
                 {
-                    ParticleContext::EmitParticle(rt, srt, emSampleIndex, 0.0f);
-                    rt.prevEmissionTime += emTimeStep;
+                    ParticleContext::EmitParticle(srt, emSampleIndex, 0.0f);
+                    srt.prevEmissionTime += emTimeStep;
                     updateTime += emTimeStep;
                     if (updateTime >= updateStep)
                     {
-                        ParticleContext::RunParticleStep(rt, srt, (float)updateStep, false);
+                        ParticleContext::StepParticles(srt, (float)updateStep);
                         updateTime = 0.0f;
                     }
                 }
@@ -823,48 +874,55 @@ ParticleContext::EmitParticles(ParticleRuntime& rt, ParticleSystemRuntime& srt,
             // setup the lastEmissionTime for particle emission so that at least
             // one frame's worth of particles is emitted, this is necessary
             // for very short-emitting particles
-            rt.prevEmissionTime = rt.stepTime;
+            srt.prevEmissionTime = time;
             if (stepTime > emTimeStep)
             {
-                rt.prevEmissionTime -= (stepTime + N_TINY);
+                srt.prevEmissionTime -= (stepTime + N_TINY);
             }
             else
             {
-                rt.prevEmissionTime -= (emTimeStep + N_TINY);
+                srt.prevEmissionTime -= (emTimeStep + N_TINY);
             }
         }
 
+        // a system waking up from sleep only catches up on particles which would still be alive
+        Timing::Time catchUpTime = Math::max((Timing::Time)srt.attrs->GetEnvelope(EmitterAttrs::LifeTime).GetMaxValue(), stepTime + emTimeStep);
+        if ((time - srt.prevEmissionTime) > catchUpTime)
+        {
+            srt.prevEmissionTime = time - catchUpTime;
+        }
+
         // handle the "normal" particle emission while the particle system is emitting
-        while ((rt.prevEmissionTime + emTimeStep) <= rt.stepTime)
+        while ((srt.prevEmissionTime + emTimeStep) <= time)
         {
-            rt.prevEmissionTime += emTimeStep;
-            ParticleContext::EmitParticle(rt, srt, emSampleIndex, (float)(rt.stepTime - rt.prevEmissionTime));
+            srt.prevEmissionTime += emTimeStep;
+            ParticleContext::EmitParticle(srt, emSampleIndex, (float)(time - srt.prevEmissionTime));
         }
     }
 }
 
 //------------------------------------------------------------------------------
 /**
+    New particles are dropped if the particle store of the system is full.
 */
 void 
-ParticleContext::EmitParticle(ParticleRuntime& rt, ParticleSystemRuntime& srt, IndexT sampleIndex, float initialAge)
+ParticleContext::EmitParticle(ParticleSystemRuntime& srt, IndexT sampleIndex, float initialAge)
 {
-    N_SCOPE(EmitParticle, Particles);
     n_assert(initialAge >= 0.0f);
 
     using namespace Math;
 
-    Particle particle;
-    float* particleEnvSamples = srt.sampleBuffer.LookupSamples(0);
+    IndexT const index = srt.particles.Append();
+    if (index == InvalidIndex)
+        return;
+
     float* emissionEnvSamples = srt.sampleBuffer.LookupSamples(sampleIndex);
 
     // lookup pseudo-random emitter vertex from the emitter mesh
     const EmitterMesh::EmitterPoint& emPoint = srt.emitterMesh.GetEmitterPoint(srt.emissionCounter++);
 
     // setup particle position and start position
-    particle.position = srt.transform * emPoint.position;
-    particle.startPosition = particle.position;
-    particle.stretchPosition = particle.position;
+    vec4 position = srt.transform * emPoint.position;
 
     // compute emission direction
     float minSpread = emissionEnvSamples[EmitterAttrs::SpreadMin];
@@ -883,7 +941,7 @@ ParticleContext::EmitParticle(ParticleRuntime& rt, ParticleSystemRuntime& srt, I
     float startVelocity = emissionEnvSamples[EmitterAttrs::StartVelocity] * velocityVariation;
 
     // setup particle velocity vector
-    particle.velocity = emNormal * startVelocity;
+    vec4 velocity = emNormal * startVelocity;
 
     // setup uvMinMax to a random texture tile
     // FIXME: what's up with the horizontal flip?
@@ -892,79 +950,80 @@ ParticleContext::EmitParticle(ParticleRuntime& rt, ParticleSystemRuntime& srt, I
     float tileIndex = floorf(Math::rand() * texTile);
     float vMin = step * tileIndex;
     float vMax = vMin + step;
-    particle.uvMinMax.set(1.0f, 1.0f - vMin, 0.0f, 1.0f - vMax);
-
-    // setup initial particle color and clamp to 0,0,0
-    particle.color.load(&(particleEnvSamples[EmitterAttrs::Red]));
 
     // setup rotation and rotationVariation
     float startRotMin = srt.attrs->GetFloat(EmitterAttrs::StartRotationMin);
     float startRotMax = srt.attrs->GetFloat(EmitterAttrs::StartRotationMax);
-    particle.rotation = startRotMin + Math::rand() * (startRotMax - startRotMin);
+    float rotation = startRotMin + Math::rand() * (startRotMax - startRotMin);
     float rotVar = 1.0f - (Math::rand() * srt.attrs->GetFloat(EmitterAttrs::RotationRandomize));
-    particle.rotationVariation = rotVar;
 
-    // setup particle size and size variation
-    particle.size = particleEnvSamples[EmitterAttrs::Size];
-    particle.sizeVariation = 1.0f - (Math::rand() * srt.attrs->GetFloat(EmitterAttrs::SizeRandomize));
+    // setup particle size variation, the size and color are sampled by the step
+    float sizeVariation = 1.0f - (Math::rand() * srt.attrs->GetFloat(EmitterAttrs::SizeRandomize));
 
     // setup particle age and oneDivLifetime, clamp lifetime to 1.0f if there's a risk we will divide by 0
     float lifeTime = emissionEnvSamples[EmitterAttrs::LifeTime];
+    float oneDivLifeTime = 0.0f;
     if (lifeTime >= 1.0f)
     {
-        particle.oneDivLifeTime = 1.0f / lifeTime;
+        oneDivLifeTime = 1.0f / lifeTime;
     }
-    else
-    {
-        particle.oneDivLifeTime = 0.0f;
-    }
-    particle.relAge = initialAge * particle.oneDivLifeTime;
-    particle.age = initialAge;
+    float relAge = initialAge * oneDivLifeTime;
 
     // group particles dependent on its lifetime
-    if (particle.relAge < 0.25f)
+    float particleId;
+    if (relAge < 0.25f)
     {
-        particle.particleId = 4;
+        particleId = 4;
     }
-    else if (particle.relAge < 0.5f)
+    else if (relAge < 0.5f)
     {
-        particle.particleId = 3;
+        particleId = 3;
     }
-    else if (particle.relAge < 0.75f)
+    else if (relAge < 0.75f)
     {
-        particle.particleId = 2;
+        particleId = 2;
     }
     else
     {
-        particle.particleId = 1;
+        particleId = 1;
     }
-    //this->particleId = !this->particleId;
-    // set particle id, just switch between 0 and 1 
-    //particle.particleId = (float)this->particleId;    
-    //if (++this->particleId > 3) this->particleId = 0;         
 
-    // add the new particle to the particle ring buffer
-    srt.particles.Add(particle);
+    // add the new particle to the particle store
+    ParticleStore& particles = srt.particles;
+    particles.Get(ParticleStore::PositionX)[index] = position.x;
+    particles.Get(ParticleStore::PositionY)[index] = position.y;
+    particles.Get(ParticleStore::PositionZ)[index] = position.z;
+    particles.Get(ParticleStore::StartPositionX)[index] = position.x;
+    particles.Get(ParticleStore::StartPositionY)[index] = position.y;
+    particles.Get(ParticleStore::StartPositionZ)[index] = position.z;
+    particles.Get(ParticleStore::VelocityX)[index] = velocity.x;
+    particles.Get(ParticleStore::VelocityY)[index] = velocity.y;
+    particles.Get(ParticleStore::VelocityZ)[index] = velocity.z;
+    particles.Get(ParticleStore::Rotation)[index] = rotation;
+    particles.Get(ParticleStore::RotationVariation)[index] = rotVar;
+    particles.Get(ParticleStore::SizeVariation)[index] = sizeVariation;
+    particles.Get(ParticleStore::OneDivLifeTime)[index] = oneDivLifeTime;
+    particles.Get(ParticleStore::RelAge)[index] = relAge;
+    particles.Get(ParticleStore::Age)[index] = initialAge;
+    particles.Get(ParticleStore::ParticleId)[index] = particleId;
+    particles.Get(ParticleStore::TextureMin)[index] = 1.0f - vMin;
+    particles.Get(ParticleStore::TextureMax)[index] = 1.0f - vMax;
 }
 
 //------------------------------------------------------------------------------
 /**
 */
 void 
-ParticleContext::RunParticleStep(ParticleRuntime& rt, ParticleSystemRuntime& srt, float stepTime, bool generateVtxList)
+ParticleContext::StepParticles(ParticleSystemRuntime& srt, float stepTime)
 {
-    N_SCOPE(RunParticleStep, Particles);
-
     // if no particles, no need to run the step update
-    if (srt.particles.Size() == 0)
+    if (srt.particles.size == 0)
     {
-        // Reduce systems complete counter manually
-        allSystemsCompleteCounter--;
+        srt.outputData.numLivingParticles = 0;
+        srt.outputData.numParticlesToRender = 0;
         return;
     }
 
-    n_assert(srt.particles.GetBuffer());
-
     ParticleJobUniformData uniforms;
     uniforms.sampleBuffer = srt.sampleBuffer.GetSampleBuffer();
     uniforms.gravity = srt.attrs->GetFloat(Particles::EmitterAttrs::Gravity);
@@ -972,29 +1031,7 @@ ParticleContext::RunParticleStep(ParticleRuntime& rt, ParticleSystemRuntime& srt
     uniforms.stretchToStart = srt.attrs->GetBool(Particles::EmitterAttrs::StretchToStart);
     uniforms.windVector = srt.attrs->GetVec4(Particles::EmitterAttrs::WindDirection);
 
-    // Sequence job
-    Jobs2::JobAppendSequence(
-        [
-            inputParticles = srt.particles.GetBuffer(),
-            outputParticles = srt.particles.GetBuffer(),
-            livingParticles = srt.particlesToRender.Begin(),
-            output = &srt.outputData,
-            uniformData = uniforms,
-            stepTime,
-            numParticles = srt.particles.Size()
-        ]
-        (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
-    {
-        N_SCOPE(ParticleStepJob, Graphics);
-        n_assert(totalJobs == 1); // Assert we only have one particle system per job execution
-
-        output->numLivingParticles = 0;
-        output->numParticlesToRender = 0;
-        output->bbox = Math::bbox();
-
-        // Take a job step
-        JobStep(&uniformData, stepTime, numParticles, inputParticles, outputParticles, livingParticles, output);
-    }, 1);
+    ParticleSystemStep(&uniforms, stepTime, srt.particles, srt.particlesToRender.Begin(), &srt.outputData);
 }
 
 } // namespace Particles
@@ -15,7 +15,6 @@
 #include "particleresource.h"
 #include "jobs/jobs.h"
 #include "jobs2/jobs2.h"
-#include "util/ringbuffer.h"
 #include "particle.h"
 namespace Particles
 {
@@ -66,6 +65,15 @@ public:
     /// stop particle updating when frame ends
     static void WaitForParticleUpdates(const Graphics::FrameContext& ctx);
 
+    /// particle system sleeping, applies to all particle systems
+    struct SleepSettings
+    {
+        float sleepDistance = 150.0f;       // systems further away from the LOD camera than this are neither updated nor rendered
+        bool sleepInvisible = true;         // systems with particles no observer saw the previous frame are not updated
+    };
+    /// set particle system sleeping
+    static void SetSleepSettings(const SleepSettings& settings);
+
     /// get the shared particle index buffer
     static CoreGraphics::BufferId GetParticleIndexBuffer();
     /// get the shared vertex buffer
@@ -92,15 +100,11 @@ private:
     struct ParticleRuntime
     {
         Timing::Time stepTime;
-        Timing::Time prevEmissionTime;
-        Timing::Time emissionStartTimeOffset;
         IndexT emissionCounter : 30;
         bool initial : 1;
         bool playing : 1;
         bool stopping : 1;
-        bool stopped : 1;
         bool restarting : 1;
-        bool firstFrame : 1;
     };
 
     struct ParticleJobOutput
@@ -115,12 +119,17 @@ private:
         Particles::EnvelopeSampleBuffer sampleBuffer;
         Particles::EmitterMesh emitterMesh;
         uint32_t renderableIndex;
-        Util::RingBuffer<Particle> particles;
-        Util::Array<Particle> particlesToRender;
+        ParticleStore particles;
+        Util::FixedArray<ParticleVertex> particlesToRender;
         Math::mat4 transform;
         Math::bbox boundingBox;
         SizeT emissionCounter;
 
+        // emission is per system, since systems are updated in parallel
+        Timing::Time prevEmissionTime;
+        Timing::Time emissionStartTimeOffset;
+        bool firstFrame;
+
         SizeT outputCapacity;
         ParticleJobSliceOutputData outputData;
 
@@ -147,12 +156,25 @@ private:
     > ParticleContextAllocator;
     static ParticleContextAllocator particleContextAllocator;
 
+    /// a particle system to update this frame
+    struct ParticleSystemUpdate
+    {
+        ParticleSystemRuntime* system;
+        Timing::Time time;                  // time of the entity before this step
+        float stepTime;
+        uint32_t node;                      // renderable node instance of the system
+        uint32_t transform;                 // transformable node instance of the system
+        bool emit;
+    };
+
     /// internal function for emitting new particles
-    static void EmitParticles(ParticleRuntime& rt, ParticleSystemRuntime& srt, float stepTime);
+    static void EmitParticles(ParticleSystemRuntime& srt, Timing::Time time, float stepTime);
     /// internal function for emitting single particle
-    static void EmitParticle(ParticleRuntime& rt, ParticleSystemRuntime& srt, IndexT sampleIndex, float initialAge);
-    /// internal function to emit a job for updating particles
-    static void RunParticleStep(ParticleRuntime& rt, ParticleSystemRuntime& srt, float stepTime, bool generateVtxList);
+    static void EmitParticle(ParticleSystemRuntime& srt, IndexT sampleIndex, float initialAge);
+    /// internal function to update the particles of a system
+    static void StepParticles(ParticleSystemRuntime& srt, float stepTime);
+
+    static SleepSettings sleepSettings;
 
     /// allocate a new slice for this context
     static Graphics::ContextEntityId Alloc();
@@ -7,14 +7,7 @@
 #include "jobs/jobs.h"
 #include "math/vec4.h"
 #include "particles/particle.h"
-
-#if __NEBULA_NO_ASSERT__
-#define ASSERT_POINT(p)
-#define ASSERT_VECTOR(v)
-#else
-#define ASSERT_POINT(p)     { n_assert(p.w > 0.995f);  n_assert(p.w < 1.005f) }
-#define ASSERT_VECTOR(v)    { n_assert(v.w > -0.005f); n_assert(v.w < 0.005f) }
-#endif
+#include "core/simd.h"
 
 namespace Particles
 {
@@ -23,28 +16,22 @@ using namespace Math;
 
 //------------------------------------------------------------------------------
 /**
-
-    NOTE: JobStepAndVlist does the same as JobStep, but it also generates the vertex 
-          list. It could be in one function, but then we would always have to check a 
-          boolean value for each particle. Thats bad for the SPU, since it doesnt
-          have any branch prediction, and it would have to throw away commands 
-          and fetch new commands from the program in each iteration
+    NOTE: The step kernel updates ParticleKernelWidth particles at once, one stream
+          of the particle store at a time. Only the envelope samples have to be
+          fetched per particle, since every particle has its own age.
 */
 
-
 /// lookup samples at index "sampleIndex" in sample-table
 const float* LookupEnvelopeSamples(const float sampleBuffer[ParticleSystemNumEnvelopeSamples*EmitterAttrs::NumEnvelopeAttrs], IndexT sampleIndex);
-/// update bounding box (min, max) with vector v
-void UpdateBbox(const vec4& v, vec4& min, vec4& max);
-/// integrate the particle state with a given time-step, retursn true if input particle is valid
-void ParticleStep(const ParticleJobUniformData* perSystemUniforms, const float stepTime, const Particle& in, Particle& out, ParticleJobSliceOutputData* sliceOutput);
-/// update particle system step
-void JobStep(const ParticleJobUniformData* perSystemUniforms, const float stepTime, unsigned int numParticles, const Particle* particles_input, Particle* particles_output, ParticleJobSliceOutputData* sliceOutput);
+/// gather one envelope attribute for all particles of a kernel iteration
+f32x4 GatherEnvelopeSamples(const float* const samples[ParticleKernelWidth], EmitterAttrs::EnvelopeAttr attr);
+/// move a run of living particles towards the front of all streams
+void MoveParticles(ParticleStore& particles, IndexT from, IndexT to, SizeT count);
 
 //------------------------------------------------------------------------------
 /**
 */
-__forceinline 
+__forceinline
 const float*
 LookupEnvelopeSamples(const float sampleBuffer[ParticleSystemNumEnvelopeSamples*EmitterAttrs::NumEnvelopeAttrs], IndexT sampleIndex)
 {
@@ -56,111 +43,224 @@ LookupEnvelopeSamples(const float sampleBuffer[ParticleSystemNumEnvelopeSamples*
 //------------------------------------------------------------------------------
 /**
 */
-__forceinline void
-UpdateBbox(const vec4& v, vec4& min, vec4& max)
+__forceinline f32x4
+GatherEnvelopeSamples(const float* const samples[ParticleKernelWidth], EmitterAttrs::EnvelopeAttr attr)
 {
-    min = minimize(min, v);
-    max = maximize(max, v);
+    return set_f32x4(samples[0][attr], samples[1][attr], samples[2][attr], samples[3][attr]);
 }
 
 //------------------------------------------------------------------------------
 /**
 */
 __forceinline void
-ParticleStep(const ParticleJobUniformData* perSystemUniforms, const float stepTime, const Particle& in, Particle& out, ParticleJobSliceOutputData* sliceOutput)
+MoveParticles(ParticleStore& particles, IndexT from, IndexT to, SizeT count)
 {
-    // update particle's age
-    out.oneDivLifeTime = in.oneDivLifeTime;
-    out.age = in.age + stepTime;
-    out.relAge = in.relAge + stepTime * in.oneDivLifeTime;
-
-    if (out.relAge >= 1.0f)
+    if (from == to || count == 0)
         return;
-
-    ++sliceOutput->numLivingParticles;
-
-    // copy the *const* members
-    out.startPosition = in.startPosition;
-    out.uvMinMax = in.uvMinMax;
-    out.rotationVariation = in.rotationVariation;
-    out.sizeVariation = in.sizeVariation;
-
-    const IndexT sampleIndex = IndexT(out.relAge * (float)(ParticleSystemNumEnvelopeSamples-1));
-    n_assert(sampleIndex >= 0);            
-    n_assert(sampleIndex < ParticleSystemNumEnvelopeSamples);
-
-    const float* samples = LookupEnvelopeSamples(perSystemUniforms->sampleBuffer, sampleIndex);
-    
-    // compute current particle acceleration
-    Math::vec4 acceleration = perSystemUniforms->windVector * samples[EmitterAttrs::AirResistance];
-    acceleration += perSystemUniforms->gravity;
-    acceleration *= samples[EmitterAttrs::Mass];
-
-    float curStretchTime = 0.0f;
-
-    // fix stretch time (if particle stretch is enabled
-    if (perSystemUniforms->stretchTime > 0.0f)
+    for (IndexT stream = 0; stream < ParticleStore::NumStreams; stream++)
     {
-        curStretchTime = (perSystemUniforms->stretchTime > out.age) ? out.age : perSystemUniforms->stretchTime;
+        float* data = particles.Get((ParticleStore::Stream)stream);
+        Memory::Move(data + from, data + to, count * sizeof(float));
     }
-
-    // update position, velocity, rotation
-    ASSERT_POINT(in.position);
-    ASSERT_VECTOR(in.velocity);
-    out.position = in.position + in.velocity * samples[EmitterAttrs::VelocityFactor] * stepTime;
-    ASSERT_POINT(out.position);
-    sliceOutput->bbox.extend(Math::bbox(out.position, Math::vector(samples[EmitterAttrs::Size])));
-    out.velocity = in.velocity + acceleration * stepTime;
-    ASSERT_VECTOR(out.velocity);
-    if (perSystemUniforms->stretchToStart)
-    {
-        // NOTE: don't support particle rotation in stretch modes
-        out.stretchPosition = in.startPosition;
-        out.rotation = in.rotation;
-    }
-    else if (curStretchTime > 0.0f)
-    {
-        // NOTE: don't support particle rotation in stretch modes
-        // ???
-        out.stretchPosition = out.position -
-                              (out.velocity - acceleration * curStretchTime * 0.5f) *
-                              (perSystemUniforms->stretchTime * samples[EmitterAttrs::VelocityFactor]);
-        out.rotation = in.rotation;
-    }                
-    else
-    {
-        out.stretchPosition = out.position;
-        out.rotation = in.rotation + in.rotationVariation * samples[EmitterAttrs::RotationVelocity] * stepTime;
-    }
-    out.color.loadu(&(samples[EmitterAttrs::Red]));
-    out.color.w = Math::clamp(out.color.w, 0.0f, 1.0f);
-    out.size = samples[EmitterAttrs::Size] * in.sizeVariation;
 }
 
 //------------------------------------------------------------------------------
 /**
+    Living particles keep their order. Dead particles are removed by moving the runs
+    of living particles between them to the front, which is a single move per stream
+    in the common case, where the oldest particles die first.
 */
 void
-JobStep(const ParticleJobUniformData* perSystemUniforms, const float stepTime, unsigned int numParticles,
-             const Particle* particles_input, Particle* particles_output, Particle* livingParticles,
-             ParticleJobSliceOutputData* sliceOutput)
+ParticleSystemStep(const ParticleJobUniformData* perSystemUniforms, const float stepTime, ParticleStore& particles, ParticleVertex* renderOutput, ParticleJobSliceOutputData* output)
 {
-    unsigned int inputIndex;
-    unsigned int renderIndex = 0;
-    sliceOutput->bbox.begin_extend();
-    for (inputIndex = 0; inputIndex < numParticles; inputIndex++)
+    float* posX = particles.Get(ParticleStore::PositionX);
+    float* posY = particles.Get(ParticleStore::PositionY);
+    float* posZ = particles.Get(ParticleStore::PositionZ);
+    const float* startX = particles.Get(ParticleStore::StartPositionX);
+    const float* startY = particles.Get(ParticleStore::StartPositionY);
+    const float* startZ = particles.Get(ParticleStore::StartPositionZ);
+    float* velX = particles.Get(ParticleStore::VelocityX);
+    float* velY = particles.Get(ParticleStore::VelocityY);
+    float* velZ = particles.Get(ParticleStore::VelocityZ);
+    float* rotation = particles.Get(ParticleStore::Rotation);
+    const float* rotationVariation = particles.Get(ParticleStore::RotationVariation);
+    const float* sizeVariation = particles.Get(ParticleStore::SizeVariation);
+    const float* oneDivLifeTime = particles.Get(ParticleStore::OneDivLifeTime);
+    float* relAge = particles.Get(ParticleStore::RelAge);
+    float* age = particles.Get(ParticleStore::Age);
+    const float* particleId = particles.Get(ParticleStore::ParticleId);
+    const float* textureMin = particles.Get(ParticleStore::TextureMin);
+    const float* textureMax = particles.Get(ParticleStore::TextureMax);
+
+    f32x4 const dt = splat_f32x4(stepTime);
+    f32x4 const zero = splat_f32x4(0.0f);
+    f32x4 const one = splat_f32x4(1.0f);
+    f32x4 const half = splat_f32x4(0.5f);
+    f32x4 const lanes = set_f32x4(0.0f, 1.0f, 2.0f, 3.0f);
+    f32x4 const gravityX = splat_f32x4(perSystemUniforms->gravity.x);
+    f32x4 const gravityY = splat_f32x4(perSystemUniforms->gravity.y);
+    f32x4 const gravityZ = splat_f32x4(perSystemUniforms->gravity.z);
+    f32x4 const windX = splat_f32x4(perSystemUniforms->windVector.x);
+    f32x4 const windY = splat_f32x4(perSystemUniforms->windVector.y);
+    f32x4 const windZ = splat_f32x4(perSystemUniforms->windVector.z);
+    f32x4 const stretchTime = splat_f32x4(perSystemUniforms->stretchTime);
+    bool const stretch = perSystemUniforms->stretchTime > 0.0f;
+    bool const stretchToStart = perSystemUniforms->stretchToStart;
+    float const maxSampleIndex = (float)(ParticleSystemNumEnvelopeSamples - 1);
+
+    f32x4 minX = splat_f32x4(+1000000.0f), minY = minX, minZ = minX;
+    f32x4 maxX = splat_f32x4(-1000000.0f), maxY = maxX, maxZ = maxX;
+
+    SizeT numLiving = 0, numToRender = 0;
+    IndexT runStart = 0;
+    SizeT runLength = 0;
+    SizeT const numParticles = particles.size;
+    for (IndexT base = 0; base < numParticles; base += ParticleKernelWidth)
     {
-        const Particle &in = particles_input[inputIndex];
-        Particle &out = particles_output[inputIndex];
-        ParticleStep(perSystemUniforms, stepTime, in, out, sliceOutput);
+        // update particle's age
+        f32x4 const newAge = add_f32x4(load_unaligned_f32x4(age + base), dt);
+        f32x4 const newRelAge = fma_f32x4(dt, load_unaligned_f32x4(oneDivLifeTime + base), load_unaligned_f32x4(relAge + base));
+        store_f32x4(newAge, age + base);
+        store_f32x4(newRelAge, relAge + base);
+
+        // padding lanes after the last particle count as dead
+        SizeT const count = Math::min(numParticles - base, ParticleKernelWidth);
+        u32x4 const livingMask = and_u32x4(compare_less_f32x4(newRelAge, one), compare_less_f32x4(lanes, splat_f32x4((float)count)));
+        uint32_t const living = mask_u32x4(livingMask);
 
-        if (out.relAge < 1.0f && out.color.w > 0.001f)
+        const float* samples[ParticleKernelWidth];
+        for (IndexT lane = 0; lane < ParticleKernelWidth; lane++)
         {
-            livingParticles[renderIndex++] = out;
-            sliceOutput->numParticlesToRender++;
+            IndexT sampleIndex = 0;
+            if (living & (1 << lane))
+                sampleIndex = IndexT(relAge[base + lane] * maxSampleIndex);
+            samples[lane] = LookupEnvelopeSamples(perSystemUniforms->sampleBuffer, sampleIndex);
         }
+        f32x4 const airResistance = GatherEnvelopeSamples(samples, EmitterAttrs::AirResistance);
+        f32x4 const mass = GatherEnvelopeSamples(samples, EmitterAttrs::Mass);
+        f32x4 const velocityFactor = GatherEnvelopeSamples(samples, EmitterAttrs::VelocityFactor);
+        f32x4 const size = GatherEnvelopeSamples(samples, EmitterAttrs::Size);
+
+        // compute current particle acceleration
+        f32x4 const accelX = mul_f32x4(fma_f32x4(windX, airResistance, gravityX), mass);
+        f32x4 const accelY = mul_f32x4(fma_f32x4(windY, airResistance, gravityY), mass);
+        f32x4 const accelZ = mul_f32x4(fma_f32x4(windZ, airResistance, gravityZ), mass);
+
+        // update position and velocity
+        f32x4 const distance = mul_f32x4(velocityFactor, dt);
+        f32x4 const oldVelX = load_unaligned_f32x4(velX + base);
+        f32x4 const oldVelY = load_unaligned_f32x4(velY + base);
+        f32x4 const oldVelZ = load_unaligned_f32x4(velZ + base);
+        f32x4 const px = fma_f32x4(oldVelX, distance, load_unaligned_f32x4(posX + base));
+        f32x4 const py = fma_f32x4(oldVelY, distance, load_unaligned_f32x4(posY + base));
+        f32x4 const pz = fma_f32x4(oldVelZ, distance, load_unaligned_f32x4(posZ + base));
+        f32x4 const vx = fma_f32x4(accelX, dt, oldVelX);
+        f32x4 const vy = fma_f32x4(accelY, dt, oldVelY);
+        f32x4 const vz = fma_f32x4(accelZ, dt, oldVelZ);
+        store_f32x4(px, posX + base);
+        store_f32x4(py, posY + base);
+        store_f32x4(pz, posZ + base);
+        store_f32x4(vx, velX + base);
+        store_f32x4(vy, velY + base);
+        store_f32x4(vz, velZ + base);
+
+        // extend the bounding box by the living particles
+        minX = select_f32x4(minX, min_f32x4(minX, sub_f32x4(px, size)), livingMask);
+        minY = select_f32x4(minY, min_f32x4(minY, sub_f32x4(py, size)), livingMask);
+        minZ = select_f32x4(minZ, min_f32x4(minZ, sub_f32x4(pz, size)), livingMask);
+        maxX = select_f32x4(maxX, max_f32x4(maxX, add_f32x4(px, size)), livingMask);
+        maxY = select_f32x4(maxY, max_f32x4(maxY, add_f32x4(py, size)), livingMask);
+        maxZ = select_f32x4(maxZ, max_f32x4(maxZ, add_f32x4(pz, size)), livingMask);
+
+        // NOTE: don't support particle rotation in stretch modes
+        f32x4 sx = px, sy = py, sz = pz;
+        if (stretchToStart)
+        {
+            sx = load_unaligned_f32x4(startX + base);
+            sy = load_unaligned_f32x4(startY + base);
+            sz = load_unaligned_f32x4(startZ + base);
+        }
+        else if (stretch)
+        {
+            f32x4 const curStretchTime = mul_f32x4(min_f32x4(stretchTime, newAge), half);
+            f32x4 const length = mul_f32x4(stretchTime, velocityFactor);
+            u32x4 const stretched = compare_greater_f32x4(curStretchTime, zero);
+            sx = select_f32x4(px, sub_f32x4(px, mul_f32x4(sub_f32x4(vx, mul_f32x4(accelX, curStretchTime)), length)), stretched);
+            sy = select_f32x4(py, sub_f32x4(py, mul_f32x4(sub_f32x4(vy, mul_f32x4(accelY, curStretchTime)), length)), stretched);
+            sz = select_f32x4(pz, sub_f32x4(pz, mul_f32x4(sub_f32x4(vz, mul_f32x4(accelZ, curStretchTime)), length)), stretched);
+        }
+        else
+        {
+            f32x4 const rotationVelocity = GatherEnvelopeSamples(samples, EmitterAttrs::RotationVelocity);
+            f32x4 const r = fma_f32x4(mul_f32x4(load_unaligned_f32x4(rotationVariation + base), rotationVelocity), dt, load_unaligned_f32x4(rotation + base));
+            store_f32x4(r, rotation + base);
+        }
+
+        f32x4 const alpha = min_f32x4(max_f32x4(GatherEnvelopeSamples(samples, EmitterAttrs::Alpha), zero), one);
+        f32x4 const renderSize = mul_f32x4(size, load_unaligned_f32x4(sizeVariation + base));
+        uint32_t const visible = living & mask_u32x4(compare_greater_f32x4(alpha, splat_f32x4(0.001f)));
+
+        alignas(16) float stretchX[ParticleKernelWidth], stretchY[ParticleKernelWidth], stretchZ[ParticleKernelWidth];
+        alignas(16) float alphas[ParticleKernelWidth], sizes[ParticleKernelWidth];
+        store_f32x4(sx, stretchX);
+        store_f32x4(sy, stretchY);
+        store_f32x4(sz, stretchZ);
+        store_f32x4(alpha, alphas);
+        store_f32x4(renderSize, sizes);
+
+        for (IndexT lane = 0; lane < count; lane++)
+        {
+            IndexT const index = base + lane;
+            if ((living & (1 << lane)) == 0)
+            {
+                // a dead particle ends the current run of living ones
+                MoveParticles(particles, runStart, numLiving - runLength, runLength);
+                runStart = index + 1;
+                runLength = 0;
+                continue;
+            }
+            runLength++;
+            numLiving++;
+
+            if (visible & (1 << lane))
+            {
+                ParticleVertex& vertex = renderOutput[numToRender++];
+                vertex.position.set(posX[index], posY[index], posZ[index], 1.0f);
+                vertex.stretchPosition.set(stretchX[lane], stretchY[lane], stretchZ[lane], 1.0f);
+                vertex.color.set(samples[lane][EmitterAttrs::Red], samples[lane][EmitterAttrs::Green], samples[lane][EmitterAttrs::Blue], alphas[lane]);
+                vertex.uvMinMax.set(1.0f, textureMin[index], 0.0f, textureMax[index]);
+                vertex.rotationSize.set(Math::sin(rotation[index]), Math::cos(rotation[index]), sizes[lane], particleId[index]);
+            }
+        }
+    }
+    MoveParticles(particles, runStart, numLiving - runLength, runLength);
+    particles.size = numLiving;
+
+    output->numLivingParticles = numLiving;
+    output->numParticlesToRender = numToRender;
+    if (numLiving > 0)
+    {
+        alignas(16) float mins[3][ParticleKernelWidth], maxs[3][ParticleKernelWidth];
+        store_f32x4(minX, mins[0]);
+        store_f32x4(minY, mins[1]);
+        store_f32x4(minZ, mins[2]);
+        store_f32x4(maxX, maxs[0]);
+        store_f32x4(maxY, maxs[1]);
+        store_f32x4(maxZ, maxs[2]);
+        vec3 pmin(mins[0][0], mins[1][0], mins[2][0]), pmax(maxs[0][0], maxs[1][0], maxs[2][0]);
+        for (IndexT lane = 1; lane < ParticleKernelWidth; lane++)
+        {
+            pmin = minimize(pmin, vec3(mins[0][lane], mins[1][lane], mins[2][lane]));
+            pmax = maximize(pmax, vec3(maxs[0][lane], maxs[1][lane], maxs[2][lane]));
+        }
+        output->bbox.pmin = pmin;
+        output->bbox.pmax = pmax;
+    }
+    else
+    {
+        output->bbox.pmin.set(0.0f, 0.0f, 0.0f);
+        output->bbox.pmax.set(0.0f, 0.0f, 0.0f);
     }
-    sliceOutput->bbox.end_extend();
 }
 
 } // namespace Particles
@@ -0,0 +1,325 @@
+//------------------------------------------------------------------------------
+//  drawlistsorter.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "drawlistsorter.h"
+#include "models/modelcontext.h"
+#include "jobs2/jobs2.h"
+#include "profiling/profiling.h"
+#include <algorithm>
+
+namespace Visibility
+{
+
+//------------------------------------------------------------------------------
+/**
+*/
+DrawListSorter::DrawListSorter()
+    : sortedKeys(0)
+    , numKeys(0)
+    , numNewKeys(0)
+    , numPreviousKeys(0)
+    , frame(1)
+    , incremental(false)
+{
+}
+
+//------------------------------------------------------------------------------
+/**
+    Has to be called between Jobs2::JobBeginSequence and Jobs2::JobEndSequence. The
+    sorted keys can be used by any job appended to the sequence after this.
+*/
+void
+DrawListSorter::AppendJobs(const Math::ClipStatus::Type* statuses, const uint32_t* ids, SizeT count, const uint64_t* sortIds, Models::NodeInstanceFlags* nodeFlags, SizeT numNodeInstances)
+{
+    // frames start at 2, such that no node instance counts as visible the frame before the first
+    this->frame++;
+    if (count == 0)
+    {
+        this->sortedKeys = 0;
+        this->numKeys = 0;
+        this->numNewKeys = 0;
+        this->numPreviousKeys = 0;
+        this->incremental = false;
+        return;
+    }
+
+    if (this->staging.Size() < count)
+    {
+        this->staging.Resize(count);
+        this->keys[0].Resize(count);
+        this->keys[1].Resize(count);
+        this->newKeys.Resize(count);
+        this->previousKeys.Resize(count);
+    }
+    if (this->visibleFrames.Size() < numNodeInstances)
+    {
+        SizeT const oldSize = this->visibleFrames.Size();
+        this->visibleFrames.Resize(numNodeInstances);
+        this->visibleFrames.Fill(oldSize, numNodeInstances - oldSize, 0);
+    }
+
+    SizeT const numGroups = (count + GroupSize - 1) / GroupSize;
+    if (this->groupCounts.Size() != numGroups)
+    {
+        this->groupCounts.Resize(numGroups);
+        this->groupNewCounts.Resize(numGroups);
+        this->groupOffsets.Resize(numGroups);
+        this->groupNewOffsets.Resize(numGroups);
+        this->histograms.Resize(numGroups * RadixSize);
+    }
+
+    Jobs2::JobAppendSequence(
+        [sorter = this, statuses, ids, sortIds, nodeFlags]
+        (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+        {
+            N_SCOPE(DrawListCompact, Visibility);
+            SizeT const last = Math::min(invocationOffset + groupSize, totalJobs);
+            sorter->Compact(invocationOffset / GroupSize, invocationOffset, last, statuses, ids, sortIds, nodeFlags);
+        }, count, GroupSize);
+
+    Jobs2::JobAppendSequence(
+        [sorter = this, numGroups]
+        (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+        {
+            sorter->Scan(numGroups);
+        }, 1);
+
+    Jobs2::JobAppendSequence(
+        [sorter = this]
+        (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+        {
+            N_SCOPE(DrawListGather, Visibility);
+            sorter->Gather(invocationOffset / GroupSize);
+        }, count, GroupSize);
+
+    // The amount of visible keys is unknown at this point, so every pass covers all of them
+    for (IndexT pass = 0; pass < NumPasses; pass++)
+    {
+        Jobs2::JobAppendSequence(
+            [sorter = this, pass]
+            (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+            {
+                N_SCOPE(DrawListRadixHistogram, Visibility);
+                sorter->Histogram(pass, invocationOffset / GroupSize);
+            }, count, GroupSize);
+
+        Jobs2::JobAppendSequence(
+            [sorter = this, pass, numGroups]
+            (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+            {
+                sorter->Prefix(pass, numGroups);
+            }, 1);
+
+        Jobs2::JobAppendSequence(
+            [sorter = this, pass]
+            (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+            {
+                N_SCOPE(DrawListRadixScatter, Visibility);
+                sorter->Scatter(pass, invocationOffset / GroupSize);
+            }, count, GroupSize);
+    }
+
+    Jobs2::JobAppendSequence(
+        [sorter = this, sortIds]
+        (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+        {
+            N_SCOPE(DrawListResolve, Visibility);
+            sorter->Resolve(sortIds);
+        }, 1);
+}
+
+//------------------------------------------------------------------------------
+/**
+    New keys are staged in the second key buffer, which is free until the radix passes.
+*/
+void
+DrawListSorter::Compact(IndexT group, SizeT first, SizeT last, const Math::ClipStatus::Type* statuses, const uint32_t* ids, const uint64_t* sortIds, Models::NodeInstanceFlags* nodeFlags)
+{
+    uint64_t* groupKeys = this->staging.Begin() + first;
+    uint64_t* groupNewKeys = this->keys[1].Begin() + first;
+    uint32_t const previousFrame = this->frame - 1;
+    uint32_t numVisible = 0, numNewVisible = 0;
+    for (IndexT i = first; i < last; i++)
+    {
+        uint32_t index = ids[i];
+
+        // Make sure we're not exceeding the number of bits in the key reserved for the actual node instance
+        n_assert(index < 0xFFFFFFFF);
+
+        // Skip if not visible nor active
+        if (!AllBits(nodeFlags[index], Models::NodeInstanceFlags::NodeInstance_Active)
+            || statuses[i] == Math::ClipStatus::Outside)
+            continue;
+
+        // Set the node visible flag (use this to figure out if a node is seen by __any__ observer)
+        nodeFlags[index] = SetBits(nodeFlags[index], Models::NodeInstanceFlags::NodeInstance_Visible);
+
+        // Combine sort id with index to get full sort key
+        uint64_t const key = sortIds[index] | index;
+        groupKeys[numVisible++] = key;
+        if (this->visibleFrames[index] != previousFrame)
+            groupNewKeys[numNewVisible++] = key;
+        this->visibleFrames[index] = this->frame;
+    }
+    this->groupCounts[group] = numVisible;
+    this->groupNewCounts[group] = numNewVisible;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+DrawListSorter::Scan(SizeT numGroups)
+{
+    uint32_t offset = 0, newOffset = 0;
+    for (IndexT group = 0; group < numGroups; group++)
+    {
+        this->groupOffsets[group] = offset;
+        this->groupNewOffsets[group] = newOffset;
+        offset += this->groupCounts[group];
+        newOffset += this->groupNewCounts[group];
+    }
+    this->numKeys = offset;
+    this->numNewKeys = newOffset;
+    this->incremental = this->numPreviousKeys > 0 && this->numNewKeys * IncrementalRatio <= this->numKeys;
+    this->source[0] = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+DrawListSorter::Gather(IndexT group)
+{
+    SizeT const first = group * GroupSize;
+    Memory::Copy(this->staging.Begin() + first, this->keys[0].Begin() + this->groupOffsets[group], this->groupCounts[group] * sizeof(uint64_t));
+    if (this->incremental)
+        Memory::Copy(this->keys[1].Begin() + first, this->newKeys.Begin() + this->groupNewOffsets[group], this->groupNewCounts[group] * sizeof(uint64_t));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+DrawListSorter::Histogram(IndexT pass, IndexT group)
+{
+    uint32_t* histogram = this->histograms.Begin() + group * RadixSize;
+    memset(histogram, 0, RadixSize * sizeof(uint32_t));
+    if (this->incremental)
+        return;
+
+    const uint64_t* src = this->keys[this->source[pass]].Begin();
+    SizeT const first = group * GroupSize;
+    SizeT const last = Math::min(first + GroupSize, this->numKeys);
+    uint32_t const shift = pass * RadixBits;
+    for (IndexT i = first; i < last; i++)
+        histogram[(src[i] >> shift) & (RadixSize - 1)]++;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Offsets are laid out digit by digit and group by group within a digit, which keeps
+    the sort stable. If every key has the same digit, the pass wouldn't move anything.
+*/
+void
+DrawListSorter::Prefix(IndexT pass, SizeT numGroups)
+{
+    if (this->incremental)
+        return;
+
+    uint32_t totals[RadixSize] = { 0 };
+    for (IndexT group = 0; group < numGroups; group++)
+    {
+        const uint32_t* histogram = this->histograms.Begin() + group * RadixSize;
+        for (IndexT digit = 0; digit < RadixSize; digit++)
+            totals[digit] += histogram[digit];
+    }
+
+    this->skipPass[pass] = false;
+    for (IndexT digit = 0; digit < RadixSize; digit++)
+    {
+        if (totals[digit] == this->numKeys)
+        {
+            this->skipPass[pass] = true;
+            this->source[pass + 1] = this->source[pass];
+            return;
+        }
+    }
+
+    uint32_t offset = 0;
+    for (IndexT digit = 0; digit < RadixSize; digit++)
+    {
+        for (IndexT group = 0; group < numGroups; group++)
+        {
+            uint32_t& histogram = this->histograms[group * RadixSize + digit];
+            uint32_t const groupCount = histogram;
+            histogram = offset;
+            offset += groupCount;
+        }
+    }
+    this->source[pass + 1] = 1 - this->source[pass];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+DrawListSorter::Scatter(IndexT pass, IndexT group)
+{
+    if (this->incremental || this->skipPass[pass])
+        return;
+
+    const uint64_t* src = this->keys[this->source[pass]].Begin();
+    uint64_t* dst = this->keys[1 - this->source[pass]].Begin();
+    uint32_t* offsets = this->histograms.Begin() + group * RadixSize;
+    SizeT const first = group * GroupSize;
+    SizeT const last = Math::min(first + GroupSize, this->numKeys);
+    uint32_t const shift = pass * RadixBits;
+    for (IndexT i = first; i < last; i++)
+        dst[offsets[(src[i] >> shift) & (RadixSize - 1)]++] = src[i];
+}
+
+//------------------------------------------------------------------------------
+/**
+    Keys of the previous frame keep their order as long as they are still visible and
+    their sort id didn't change. If the sort id of any visible node instance changed,
+    the counts won't add up, and everything is sorted from scratch.
+*/
+void
+DrawListSorter::Resolve(const uint64_t* sortIds)
+{
+    if (!this->incremental)
+    {
+        this->sortedKeys = this->source[NumPasses];
+    }
+    else
+    {
+        uint64_t* survivors = this->keys[1].Begin();
+        SizeT numSurvivors = 0;
+        for (IndexT i = 0; i < this->numPreviousKeys; i++)
+        {
+            uint64_t const key = this->previousKeys[i];
+            uint32_t const index = key & 0x00000000FFFFFFFF;
+            if (this->visibleFrames[index] == this->frame && (sortIds[index] | index) == key)
+                survivors[numSurvivors++] = key;
+        }
+
+        uint64_t* result = this->keys[0].Begin();
+        if (numSurvivors + this->numNewKeys != this->numKeys)
+        {
+            std::sort(result, result + this->numKeys);
+        }
+        else
+        {
+            std::sort(this->newKeys.Begin(), this->newKeys.Begin() + this->numNewKeys);
+            std::merge(survivors, survivors + numSurvivors, this->newKeys.Begin(), this->newKeys.Begin() + this->numNewKeys, result);
+        }
+        this->sortedKeys = 0;
+    }
+
+    Memory::Copy(this->keys[this->sortedKeys].Begin(), this->previousKeys.Begin(), this->numKeys * sizeof(uint64_t));
+    this->numPreviousKeys = this->numKeys;
+}
+
+} // namespace Visibility
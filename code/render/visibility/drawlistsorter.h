@@ -0,0 +1,125 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Visibility::DrawListSorter
+
+    Sorts the visible node instances of an observer by their sort id, as the first
+    step of building its draw list.
+
+    The sort is appended as a chain of jobs to the current Jobs2 sequence. Visible and
+    active node instances are compacted in parallel into 64 bit keys, made from the
+    node sort id and the node instance index, which are then sorted by a parallel
+    LSD radix sort with 8 bit digits. Passes where all keys share the same digit are
+    skipped, which is common for the high bits of the node instance index.
+
+    Since visibility is coherent between frames, the sorter keeps the sorted keys of
+    the previous frame. If only a few node instances became visible, the keys which
+    are still visible are taken in their previous order, and only the new ones are
+    sorted and merged in.
+
+    @copyright
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include "math/clipstatus.h"
+#include "util/fixedarray.h"
+
+namespace Models
+{
+enum class NodeInstanceFlags;
+}
+
+namespace Visibility
+{
+
+class DrawListSorter
+{
+public:
+    /// constructor
+    DrawListSorter();
+
+    /// append the sorting jobs to the current job sequence
+    void AppendJobs(const Math::ClipStatus::Type* statuses, const uint32_t* ids, SizeT count, const uint64_t* sortIds, Models::NodeInstanceFlags* nodeFlags, SizeT numNodeInstances);
+
+    /// get sorted keys, valid once the sequence is done
+    const uint64_t* GetKeys() const;
+    /// get number of sorted keys, valid once the sequence is done
+    SizeT GetNumKeys() const;
+    /// returns true if the last sort reused the order of the previous frame
+    bool WasIncremental() const;
+
+    /// invocations per job group, the radix sort keeps one histogram per group
+    static const SizeT GroupSize = 4096;
+    /// the previous order is reused if at most one in this many keys is new
+    static const SizeT IncrementalRatio = 8;
+
+private:
+
+    /// compact the visible node instances of a group into the staging keys
+    void Compact(IndexT group, SizeT first, SizeT last, const Math::ClipStatus::Type* statuses, const uint32_t* ids, const uint64_t* sortIds, Models::NodeInstanceFlags* nodeFlags);
+    /// calculate the group offsets and decide whether to sort incrementally
+    void Scan(SizeT numGroups);
+    /// move the keys of a group to their compacted offsets
+    void Gather(IndexT group);
+    /// build the digit histogram of a group for a radix pass
+    void Histogram(IndexT pass, IndexT group);
+    /// turn the histograms of a radix pass into scatter offsets
+    void Prefix(IndexT pass, SizeT numGroups);
+    /// scatter the keys of a group by digit
+    void Scatter(IndexT pass, IndexT group);
+    /// finish the sort, merging the new keys with the previous order if sorting incrementally
+    void Resolve(const uint64_t* sortIds);
+
+    static const SizeT RadixBits = 8;
+    static const SizeT RadixSize = 1 << RadixBits;
+    static const SizeT NumPasses = 64 / RadixBits;
+
+    Util::FixedArray<uint64_t> staging;         // per group, the visible keys in node order
+    Util::FixedArray<uint64_t> keys[2];         // compacted keys, sorted back and forth by the radix passes
+    Util::FixedArray<uint64_t> newKeys;         // keys which were not visible the previous frame
+    Util::FixedArray<uint64_t> previousKeys;    // sorted keys of the previous frame
+    Util::FixedArray<uint32_t> visibleFrames;   // per node instance, the last frame it was visible
+    Util::FixedArray<uint32_t> groupCounts;
+    Util::FixedArray<uint32_t> groupNewCounts;
+    Util::FixedArray<uint32_t> groupOffsets;
+    Util::FixedArray<uint32_t> groupNewOffsets;
+    Util::FixedArray<uint32_t> histograms;      // per group and digit, turned into offsets by Prefix
+
+    uint32_t source[NumPasses + 1];             // key buffer holding the keys before each pass
+    bool skipPass[NumPasses];
+    uint32_t sortedKeys;                        // key buffer holding the sorted keys
+    SizeT numKeys;
+    SizeT numNewKeys;
+    SizeT numPreviousKeys;
+    uint32_t frame;
+    bool incremental;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline const uint64_t*
+DrawListSorter::GetKeys() const
+{
+    return this->keys[this->sortedKeys].Begin();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+DrawListSorter::GetNumKeys() const
+{
+    return this->numKeys;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+DrawListSorter::WasIncremental() const
+{
+    return this->incremental;
+}
+
+} // namespace Visibility
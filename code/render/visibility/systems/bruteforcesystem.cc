@@ -7,9 +7,18 @@
 #include "jobs2/jobs2.h"
 #include "math/mat4.h"
 #include "math/clipstatus.h"
+#include "core/simd.h"
 namespace Visibility
 {
 
+//------------------------------------------------------------------------------
+/**
+*/
+BruteforceSystem::BruteforceSystem()
+    : gatherCounter(0)
+{
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -18,97 +27,228 @@ BruteforceSystem::Setup(const BruteforceSystemLoadInfo& info)
 {
 }
 
+//------------------------------------------------------------------------------
+/**
+    The six planes of the clip volume, where a point is inside if it's on the positive
+    side of all of them. They match the clip codes used by bbox::clipstatus.
+*/
+struct FrustumPlanes
+{
+    float nx[6], ny[6], nz[6], d[6];
+};
+
+//------------------------------------------------------------------------------
+/**
+    Transforms are row vector, so clip space x is the dot product with the first column.
+    An orthographic observer uses a constant w of 1, like bbox::clipstatus.
+*/
+static FrustumPlanes
+ExtractPlanes(const Math::mat4& transform, bool isOrtho)
+{
+    const Math::vec4* r = transform.r;
+    float const x[4] = { r[0].x, r[1].x, r[2].x, r[3].x };
+    float const y[4] = { r[0].y, r[1].y, r[2].y, r[3].y };
+    float const z[4] = { r[0].z, r[1].z, r[2].z, r[3].z };
+    float const w[4] = { isOrtho ? 0.0f : r[0].w, isOrtho ? 0.0f : r[1].w, isOrtho ? 0.0f : r[2].w, isOrtho ? 1.0f : r[3].w };
+
+    // left, right, bottom, top, far and near, as x >= -w, x <= w and so on
+    const float* axes[3] = { x, y, z };
+    FrustumPlanes planes;
+    for (IndexT i = 0; i < 6; i++)
+    {
+        const float* axis = axes[i / 2];
+        float const sign = (i & 1) ? -1.0f : 1.0f;
+        planes.nx[i] = w[0] + sign * axis[0];
+        planes.ny[i] = w[1] + sign * axis[1];
+        planes.nz[i] = w[2] + sign * axis[2];
+        planes.d[i] = w[3] + sign * axis[3];
+    }
+    return planes;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Test four boxes against the frustum, returns one bit per box in outside and inside.
+    A box is outside if it's completely behind any plane, and inside if it's completely
+    in front of all of them, which is the same as testing its eight corners.
+*/
+static __forceinline void
+ClipBoxes4(const f32x4* planes, const float* centerX, const float* centerY, const float* centerZ, const float* extentX, const float* extentY, const float* extentZ, uint32_t& outside, uint32_t& inside)
+{
+    f32x4 const cx = load_unaligned_f32x4(centerX);
+    f32x4 const cy = load_unaligned_f32x4(centerY);
+    f32x4 const cz = load_unaligned_f32x4(centerZ);
+    f32x4 const ex = load_unaligned_f32x4(extentX);
+    f32x4 const ey = load_unaligned_f32x4(extentY);
+    f32x4 const ez = load_unaligned_f32x4(extentZ);
+    f32x4 const zero = splat_f32x4(0.0f);
+
+    u32x4 anyOutside = compare_less_f32x4(zero, zero);
+    u32x4 allInside = compare_equal_f32x4(zero, zero);
+    for (IndexT i = 0; i < 6; i++)
+    {
+        const f32x4* plane = planes + i * 7;
+
+        // signed distance of the center, and the projected radius of the box on the plane normal
+        f32x4 const distance = fma_f32x4(plane[0], cx, fma_f32x4(plane[1], cy, fma_f32x4(plane[2], cz, plane[3])));
+        f32x4 const radius = fma_f32x4(plane[4], ex, fma_f32x4(plane[5], ey, mul_f32x4(plane[6], ez)));
+        anyOutside = or_u32x4(anyOutside, compare_less_f32x4(add_f32x4(distance, radius), zero));
+        allInside = and_u32x4(allInside, compare_greater_equal_f32x4(sub_f32x4(distance, radius), zero));
+    }
+    outside = mask_u32x4(anyOutside);
+    inside = mask_u32x4(allInside);
+}
+
 //------------------------------------------------------------------------------
 /**
 */
 void
 BruteforceSystem::Run(const Threading::AtomicCounter* previousSystemCompletionCounters, const Util::FixedArray<const Threading::AtomicCounter*, true>& extraCounters)
 {
+    // Pad the arrays so that the kernel never has to deal with a partial iteration
+    SizeT const paddedCount = Memory::align(this->ent.count, KernelWidth);
+    this->boxes.centerX.Resize(paddedCount);
+    this->boxes.centerY.Resize(paddedCount);
+    this->boxes.centerZ.Resize(paddedCount);
+    this->boxes.extentX.Resize(paddedCount);
+    this->boxes.extentY.Resize(paddedCount);
+    this->boxes.extentZ.Resize(paddedCount);
+    this->boxes.alwaysVisible.Resize(paddedCount);
+
+    // Gather boxes in entity order once all entity data is available, this is the only scattered read
+    n_assert(this->gatherCounter == 0);
+    this->gatherCounter = 1;
+    Jobs2::JobDispatch(
+        [
+            ids = this->ent.ids
+            , boundingBoxes = this->ent.boxes
+            , flags = this->ent.entityFlags
+            , boxes = &this->boxes
+        ]
+    (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+    {
+        N_SCOPE(BruteforceGatherBoxes, Visibility);
+        for (IndexT i = 0; i < groupSize; i++)
+        {
+            IndexT index = i + invocationOffset;
+            if (index >= totalJobs)
+                return;
+
+            uint32_t objectId = ids[index];
+            const Math::bbox& box = boundingBoxes[objectId];
+            boxes->centerX[index] = (box.pmin.x + box.pmax.x) * 0.5f;
+            boxes->centerY[index] = (box.pmin.y + box.pmax.y) * 0.5f;
+            boxes->centerZ[index] = (box.pmin.z + box.pmax.z) * 0.5f;
+            boxes->extentX[index] = (box.pmax.x - box.pmin.x) * 0.5f;
+            boxes->extentY[index] = (box.pmax.y - box.pmin.y) * 0.5f;
+            boxes->extentZ[index] = (box.pmax.z - box.pmin.z) * 0.5f;
+            boxes->alwaysVisible[index] = AllBits(flags[objectId], (uint32_t)Models::NodeInstanceFlags::NodeInstance_AlwaysVisible);
+        }
+    }
+    , this->ent.count
+    , 1024
+    , extraCounters
+    , &this->gatherCounter
+    , nullptr);
+
     IndexT i;
     for (i = 0; i < this->obs.count; i++)
     {
-        Math::mat4 camera = this->obs.transforms[i];
-
         n_assert(this->obs.completionCounters[i] == 0);
         this->obs.completionCounters[i] = 1;
 
         // Setup counters
-        Util::FixedArray<const Threading::AtomicCounter*, true> counters(extraCounters.Size() + (previousSystemCompletionCounters == nullptr ? 0 : 1));
-        if (!extraCounters.IsEmpty())
-            Memory::CopyElements(extraCounters.Begin(), counters.Begin(), extraCounters.Size());
+        Util::FixedArray<const Threading::AtomicCounter*, true> counters(previousSystemCompletionCounters == nullptr ? 1 : 2);
+        counters[0] = &this->gatherCounter;
         if (previousSystemCompletionCounters != nullptr)
-            counters[extraCounters.Size()] = &previousSystemCompletionCounters[i];
-
-        // Splat the matrix such that all _x, _y, ... will contain the column values of x, y, ...
-        // This provides a way to rearrange the camera transform into a more SSE friendly matrix transform in the job
-        Math::vec4 colX[4], colY[4], colZ[4], colW[4];
-        colX[0] = Math::splat_x((camera).r[0]);
-        colX[1] = Math::splat_x((camera).r[1]);
-        colX[2] = Math::splat_x((camera).r[2]);
-        colX[3] = Math::splat_x((camera).r[3]);
-
-        colY[0] = Math::splat_y((camera).r[0]);
-        colY[1] = Math::splat_y((camera).r[1]);
-        colY[2] = Math::splat_y((camera).r[2]);
-        colY[3] = Math::splat_y((camera).r[3]);
-
-        colZ[0] = Math::splat_z((camera).r[0]);
-        colZ[1] = Math::splat_z((camera).r[1]);
-        colZ[2] = Math::splat_z((camera).r[2]);
-        colZ[3] = Math::splat_z((camera).r[3]);
-
-        colW[0] = Math::splat_w((camera).r[0]);
-        colW[1] = Math::splat_w((camera).r[1]);
-        colW[2] = Math::splat_w((camera).r[2]);
-        colW[3] = Math::splat_w((camera).r[3]);
-
-        // All set, run the job
+            counters[1] = &previousSystemCompletionCounters[i];
+
+        FrustumPlanes planes = ExtractPlanes(this->obs.transforms[i], this->obs.isOrtho[i]);
+
+        // All set, run the job, the group size has to be a multiple of the kernel width
         Jobs2::JobDispatch(
             [
-                ids = this->ent.ids
-                , boundingBoxes = this->ent.boxes
-                , flags = this->ent.entityFlags
-                , isOrtho = this->obs.isOrtho[i]
+                boxes = &this->boxes
                 , observerStage = this->obs.stages[i]
                 , entityStages = this->ent.stages
                 , clipStatuses = this->obs.results[i].Begin()
-                , colX, colY, colZ, colW
+                , planes
             ]
         (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
         {
             N_SCOPE(BruteforceViewFrustumCulling, Visibility);
-            // Iterate over work group
-            for (IndexT i = 0; i < groupSize; i++)
+
+            // Splat planes once per group, normals and distance followed by the absolute normals
+            f32x4 splatPlanes[6 * 7];
+            for (IndexT plane = 0; plane < 6; plane++)
             {
-                // Get item index
-                IndexT index = i + invocationOffset;
-                if (index >= totalJobs)
-                    return;
+                splatPlanes[plane * 7 + 0] = splat_f32x4(planes.nx[plane]);
+                splatPlanes[plane * 7 + 1] = splat_f32x4(planes.ny[plane]);
+                splatPlanes[plane * 7 + 2] = splat_f32x4(planes.nz[plane]);
+                splatPlanes[plane * 7 + 3] = splat_f32x4(planes.d[plane]);
+                splatPlanes[plane * 7 + 4] = splat_f32x4(Math::abs(planes.nx[plane]));
+                splatPlanes[plane * 7 + 5] = splat_f32x4(Math::abs(planes.ny[plane]));
+                splatPlanes[plane * 7 + 6] = splat_f32x4(Math::abs(planes.nz[plane]));
+            }
 
-                uint32_t objectId = ids[index];
+            SizeT const end = Math::min(invocationOffset + groupSize, totalJobs);
+            for (IndexT base = invocationOffset; base < end; base += KernelWidth)
+            {
+                SizeT const count = Math::min(end - base, KernelWidth);
 
-                // Check stage flags
-                if ((entityStages[index] & observerStage) == 0)
+                // Stage mismatches are outside, always visible entities inside, and only entities
+                // not already found visible by a previous system need their box tested
+                uint32_t stageMask = 0, testMask = 0;
+                for (IndexT lane = 0; lane < count; lane++)
                 {
-                    clipStatuses[index] = Math::ClipStatus::Outside;
-                    continue;
+                    IndexT const index = base + lane;
+                    if ((entityStages[index] & observerStage) == 0)
+                        continue;
+                    stageMask |= 1 << lane;
+                    if (!boxes->alwaysVisible[index] && clipStatuses[index] == Math::ClipStatus::Outside)
+                        testMask |= 1 << lane;
                 }
 
-                if (AllBits(flags[objectId], (uint32_t)Models::NodeInstanceFlags::NodeInstance_AlwaysVisible))
+                uint32_t outside = 0, inside = 0;
+                if (testMask != 0)
                 {
-                    clipStatuses[index] = Math::ClipStatus::Inside;
-                    continue;
+                    uint32_t outsideHigh, insideHigh;
+                    ClipBoxes4(splatPlanes
+                        , &boxes->centerX[base], &boxes->centerY[base], &boxes->centerZ[base]
+                        , &boxes->extentX[base], &boxes->extentY[base], &boxes->extentZ[base]
+                        , outside, inside);
+                    ClipBoxes4(splatPlanes
+                        , &boxes->centerX[base + 4], &boxes->centerY[base + 4], &boxes->centerZ[base + 4]
+                        , &boxes->extentX[base + 4], &boxes->extentY[base + 4], &boxes->extentZ[base + 4]
+                        , outsideHigh, insideHigh);
+                    outside |= outsideHigh << 4;
+                    inside |= insideHigh << 4;
                 }
 
-                // Run bounding box check and store output in clip statuses, if clip status is still outside
-                if (clipStatuses[index] == Math::ClipStatus::Outside)
-                    clipStatuses[index] = boundingBoxes[objectId].clipstatus(colX, colY, colZ, colW, isOrtho);
+                for (IndexT lane = 0; lane < count; lane++)
+                {
+                    IndexT const index = base + lane;
+                    uint32_t const bit = 1 << lane;
+                    if ((stageMask & bit) == 0)
+                        clipStatuses[index] = Math::ClipStatus::Outside;
+                    else if (boxes->alwaysVisible[index])
+                        clipStatuses[index] = Math::ClipStatus::Inside;
+                    else if (testMask & bit)
+                    {
+                        if (inside & bit)
+                            clipStatuses[index] = Math::ClipStatus::Inside;
+                        else if (outside & bit)
+                            clipStatuses[index] = Math::ClipStatus::Outside;
+                        else
+                            clipStatuses[index] = Math::ClipStatus::Clipped;
+                    }
+                }
             }
         }
         , this->ent.count
         , 1024
         , counters
-        , &this->obs.completionCounters[i] 
+        , &this->obs.completionCounters[i]
         , nullptr);
     }
 }
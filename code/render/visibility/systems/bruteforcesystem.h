@@ -3,6 +3,11 @@
 /**
     Brute force system
 
+    Tests every entity against every observer. Once all entity data is available, the
+    bounding boxes are gathered in entity order into a structure of arrays, which is
+    shared by all observers. The culling jobs then test eight boxes per iteration
+    against the frustum planes, reading nothing but contiguous memory.
+
     @copyright
     (C) 2018-2020 Individual contributors, see AUTHORS file
 */
@@ -14,6 +19,10 @@ namespace Visibility
 
 class BruteforceSystem : public VisibilitySystem
 {
+public:
+    /// constructor
+    BruteforceSystem();
+
 private:
     friend class ObserverContext;
 
@@ -22,6 +31,17 @@ private:
 
     /// run system
     void Run(const Threading::AtomicCounter* previousSystemCompletionCounters, const Util::FixedArray<const Threading::AtomicCounter*, true>& extraCounters) override;
+
+    /// boxes culled per kernel iteration, the structure of arrays is padded to a multiple of this
+    static const SizeT KernelWidth = 8;
+
+    struct BoxArrays
+    {
+        Util::Array<float> centerX, centerY, centerZ;
+        Util::Array<float> extentX, extentY, extentZ;
+        Util::Array<bool> alwaysVisible;
+    } boxes;
+    Threading::AtomicCounter gatherCounter;
 };
 
 } // namespace Visibility
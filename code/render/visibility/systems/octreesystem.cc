@@ -4,15 +4,382 @@
 //------------------------------------------------------------------------------
 
 #include "octreesystem.h"
+#include "jobs2/jobs2.h"
+#include "math/clipstatus.h"
 namespace Visibility
 {
 
 //------------------------------------------------------------------------------
 /**
 */
+OctreeSystem::OctreeSystem()
+    : numCullItems(0)
+    , axisDepth{ DefaultDepth, DefaultDepth, DefaultDepth }
+    , depth(DefaultDepth)
+    , frame(0)
+    , worldExpanding(false)
+    , updateCounter(0)
+{
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+OctreeSystem::~OctreeSystem()
+{
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static uint32_t
+CellsToDepth(uint cells)
+{
+    uint32_t depth = 0;
+    while ((1u << depth) < cells)
+        depth++;
+    return depth;
+}
+
+//------------------------------------------------------------------------------
+/**
+    The cell counts decide how many times every axis is split, such that the deepest
+    level has at least as many cells along every axis as requested.
+*/
 void
 OctreeSystem::Setup(const OctreeSystemLoadInfo& info)
 {
+    this->worldExpanding = info.worldExpanding;
+    if (this->worldExpanding)
+    {
+        // bounds and depths are decided by the first set of entities
+        return;
+    }
+
+    this->axisDepth[0] = Math::min(CellsToDepth(info.cellsX), MaxDepth);
+    this->axisDepth[1] = Math::min(CellsToDepth(info.cellsY), MaxDepth);
+    this->axisDepth[2] = Math::min(CellsToDepth(info.cellsZ), MaxDepth);
+    this->depth = Math::max(this->axisDepth[0], Math::max(this->axisDepth[1], this->axisDepth[2]));
+
+    Math::vector extents(info.width * 0.5f, info.height * 0.5f, info.depth * 0.5f);
+    this->center = xyz(info.pos);
+    this->Reset(Math::bbox(Math::point(info.pos.x, info.pos.y, info.pos.z), extents));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+OctreeSystem::Run(const Threading::AtomicCounter* previousSystemCompletionCounters, const Util::FixedArray<const Threading::AtomicCounter*, true>& extraCounters)
+{
+    // Update the tree once all entity data is available
+    n_assert(this->updateCounter == 0);
+    this->updateCounter = 1;
+    Jobs2::JobDispatch(
+        [this](SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+        {
+            N_SCOPE(OctreeUpdate, Visibility);
+            this->UpdateTree();
+        }
+        , 1
+        , extraCounters
+        , &this->updateCounter
+        , nullptr);
+
+    if (this->remainingItems.Size() < this->obs.count)
+        this->remainingItems.Resize(this->obs.count);
+
+    IndexT i;
+    for (i = 0; i < this->obs.count; i++)
+    {
+        n_assert(this->obs.completionCounters[i] == 0);
+        this->obs.completionCounters[i] = 1;
+
+        Util::FixedArray<const Threading::AtomicCounter*, true> counters(previousSystemCompletionCounters == nullptr ? 1 : 2);
+        counters[0] = &this->updateCounter;
+        if (previousSystemCompletionCounters != nullptr)
+            counters[1] = &previousSystemCompletionCounters[i];
+
+        Math::vec4 colX[4], colY[4], colZ[4], colW[4];
+        SplatTransform(this->obs.transforms[i], colX, colY, colZ, colW);
+
+        // One invocation per work item, the amount of items is only known after the update
+        this->remainingItems[i] = MaxCullItems;
+        Jobs2::JobDispatch(
+            [
+                system = this
+                , isOrtho = this->obs.isOrtho[i]
+                , observerStage = this->obs.stages[i]
+                , clipStatuses = this->obs.results[i].Begin()
+                , remaining = &this->remainingItems[i]
+                , colX, colY, colZ, colW
+            ]
+        (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+        {
+            N_SCOPE(OctreeViewFrustumCulling, Visibility);
+            for (IndexT i = 0; i < groupSize; i++)
+            {
+                IndexT index = i + invocationOffset;
+                if (index >= totalJobs)
+                    return;
+                system->CullItem(index, colX, colY, colZ, colW, isOrtho, observerStage, clipStatuses);
+
+                // Always visible entities are also in the tree, so they are only written once no item can touch them anymore
+                if (Threading::Interlocked::Decrement(remaining) == 0)
+                    system->MarkAlwaysVisible(observerStage, clipStatuses);
+            }
+        }
+        , MaxCullItems
+        , 1
+        , counters
+        , &this->obs.completionCounters[i]
+        , nullptr);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+OctreeSystem::Reset(const Math::bbox& box)
+{
+    this->nodes.Clear();
+
+    Node root;
+    root.box = box;
+    root.looseBox = Math::bbox(box.center(), box.extents() * 2.0f);
+    root.parent = InvalidNode;
+    root.firstChild = InvalidNode;
+    root.numChildren = 0;
+    root.level = 0;
+    root.numObjects = 0;
+    this->nodes.Append(root);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Extends the tree to cover the box with some margin, then rebuilds it from scratch.
+    Only happens when an object leaves a world expanding tree, which should be rare.
+*/
+void
+OctreeSystem::Grow(const Math::bbox& box)
+{
+    Math::bbox bounds = this->nodes[0].box;
+    bounds.extend(box);
+    Math::vector extents = bounds.extents() * 2.0f;
+    extents = Math::vector(Math::max(extents.x, 1.0f), Math::max(extents.y, 1.0f), Math::max(extents.z, 1.0f));
+
+    this->Reset(Math::bbox(bounds.center(), extents));
+    for (IndexT i = 0; i < this->objects.Size(); i++)
+    {
+        Object& object = this->objects[i];
+        if (object.node != InvalidNode)
+        {
+            object.node = InvalidNode;
+            this->Insert(i, object.box);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+uint32_t
+OctreeSystem::SplitAxes(uint32_t level) const
+{
+    uint32_t axes = 0;
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        if (level < this->axisDepth[axis])
+            axes |= 1 << axis;
+    }
+    return axes;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Children are numbered by one bit per split axis, in x, y, z order.
+*/
+void
+OctreeSystem::Subdivide(uint32_t node)
+{
+    n_assert(this->nodes[node].firstChild == InvalidNode);
+    uint32_t const firstChild = this->nodes.Size();
+    uint32_t const axes = this->SplitAxes(this->nodes[node].level);
+    uint32_t const level = this->nodes[node].level + 1;
+    Math::point const center = this->nodes[node].box.center();
+    Math::vector const nodeExtents = this->nodes[node].box.extents();
+    float extents[3] = { nodeExtents.x, nodeExtents.y, nodeExtents.z };
+    uint32_t numChildren = 1;
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        if (axes & (1 << axis))
+        {
+            extents[axis] *= 0.5f;
+            numChildren *= 2;
+        }
+    }
+
+    for (uint32_t child = 0; child < numChildren; child++)
+    {
+        float offset[3] = { 0.0f, 0.0f, 0.0f };
+        uint32_t bit = 0;
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            if (axes & (1 << axis))
+            {
+                offset[axis] = (child & (1 << bit)) ? extents[axis] : -extents[axis];
+                bit++;
+            }
+        }
+
+        Math::point const childCenter = center + Math::vector(offset[0], offset[1], offset[2]);
+        Math::vector const childExtents(extents[0], extents[1], extents[2]);
+
+        Node n;
+        n.box = Math::bbox(childCenter, childExtents);
+        n.looseBox = Math::bbox(childCenter, childExtents * 2.0f);
+        n.parent = node;
+        n.firstChild = InvalidNode;
+        n.numChildren = 0;
+        n.level = level;
+        n.numObjects = 0;
+        this->nodes.Append(n);
+    }
+
+    // append might have grown the array, so only store the index afterwards
+    this->nodes[node].firstChild = firstChild;
+    this->nodes[node].numChildren = numChildren;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+OctreeSystem::Fits(uint32_t node, const Math::bbox& box) const
+{
+    const Node& n = this->nodes[node];
+
+    // the root keeps everything that doesn't fit anywhere else
+    if (node == 0)
+        return true;
+
+    Math::vector const cellExtents = n.box.extents();
+    Math::vector const boxExtents = box.extents();
+    if (boxExtents.x > cellExtents.x || boxExtents.y > cellExtents.y || boxExtents.z > cellExtents.z)
+        return false;
+    return n.box.contains(xyz(box.center()));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+uint32_t
+OctreeSystem::FindNode(const Math::bbox& box)
+{
+    Math::point const center = box.center();
+    Math::vector const boxExtents = box.extents();
+    uint32_t node = 0;
+    if (!this->nodes[0].box.contains(xyz(center)))
+        return node;
+
+    float const objectCenter[3] = { center.x, center.y, center.z };
+    float const objectExtents[3] = { boxExtents.x, boxExtents.y, boxExtents.z };
+    while (this->nodes[node].level < this->depth)
+    {
+        uint32_t const axes = this->SplitAxes(this->nodes[node].level);
+        Math::point const nodeCenter = this->nodes[node].box.center();
+        Math::vector const nodeExtents = this->nodes[node].box.extents();
+        float const cellCenter[3] = { nodeCenter.x, nodeCenter.y, nodeCenter.z };
+        float const cellExtents[3] = { nodeExtents.x, nodeExtents.y, nodeExtents.z };
+
+        // stop once the object is larger than the child cells
+        uint32_t child = 0, bit = 0;
+        bool fits = true;
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            float const childExtent = (axes & (1 << axis)) ? cellExtents[axis] * 0.5f : cellExtents[axis];
+            fits &= objectExtents[axis] <= childExtent;
+            if (axes & (1 << axis))
+            {
+                if (objectCenter[axis] >= cellCenter[axis])
+                    child |= 1 << bit;
+                bit++;
+            }
+        }
+        if (!fits)
+            break;
+
+        if (this->nodes[node].firstChild == InvalidNode)
+            this->Subdivide(node);
+        node = this->nodes[node].firstChild + child;
+    }
+    return node;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+OctreeSystem::Insert(uint32_t objectId, const Math::bbox& box)
+{
+    uint32_t const node = this->FindNode(box);
+    Object& object = this->objects[objectId];
+    n_assert(object.node == InvalidNode);
+    object.node = node;
+    object.slot = this->nodes[node].objects.Size();
+    this->nodes[node].objects.Append({ box, objectId });
+
+    for (uint32_t it = node; it != InvalidNode; it = this->nodes[it].parent)
+        this->nodes[it].numObjects++;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+OctreeSystem::Remove(uint32_t objectId)
+{
+    Object& object = this->objects[objectId];
+    n_assert(object.node != InvalidNode);
+    Node& node = this->nodes[object.node];
+    node.objects.EraseIndexSwap(object.slot);
+    if (object.slot < (uint32_t)node.objects.Size())
+        this->objects[node.objects[object.slot].id].slot = object.slot;
+
+    for (uint32_t it = object.node; it != InvalidNode; it = this->nodes[it].parent)
+        this->nodes[it].numObjects--;
+    object.node = InvalidNode;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Nodes above CullJobLevel only test their own objects, nodes at CullJobLevel
+    are traversed with all of their children.
+*/
+void
+OctreeSystem::GatherCullItems()
+{
+    this->numCullItems = 0;
+    uint32_t queue[MaxCullItems];
+    uint32_t head = 0, tail = 0;
+    queue[tail++] = 0;
+    while (head < tail)
+    {
+        uint32_t const node = queue[head++];
+        const Node& n = this->nodes[node];
+        if (n.numObjects == 0)
+            continue;
+
+        bool const recursive = n.level == CullJobLevel;
+        this->cullItems[this->numCullItems++] = { node, recursive };
+
+        if (!recursive && n.firstChild != InvalidNode)
+        {
+            for (uint32_t child = 0; child < n.numChildren; child++)
+                queue[tail++] = n.firstChild + child;
+        }
+    }
 }
 
 } // namespace Visibility
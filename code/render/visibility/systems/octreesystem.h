@@ -3,6 +3,18 @@
 /**
     Octree system
 
+    Loose octree, where every cell accepts objects whose center is inside the cell
+    and whose extents are no larger than the cell itself. The culling bounds of a cell
+    are twice its size, so an object only has to move to another cell once its center
+    leaves the cell, which keeps reinsertion of moving objects rare. Axes stop being
+    split once they reach their cell count, so flat worlds don't waste levels on height.
+
+    The tree is updated incrementally by a job at the start of Run, only objects whose
+    bounding box no longer fits their cell are reinserted. Every observer then traverses
+    the tree hierarchically, where cells completely inside the frustum mark their whole
+    subtree as visible without any further tests. The traversal is split into one job
+    invocation per cell at CullJobLevel, together with the sparse cells above it.
+
     @copyright
     (C) 2018-2020 Individual contributors, see AUTHORS file
 */
@@ -15,12 +27,98 @@ namespace Visibility
 class OctreeSystem : public VisibilitySystem
 {
 public:
+    /// constructor
+    OctreeSystem();
+    /// destructor
+    ~OctreeSystem() override;
+
 private:
     friend class ObserverContext;
 
     /// setup from load info
     void Setup(const OctreeSystemLoadInfo& info);
+
+    /// run system
+    void Run(const Threading::AtomicCounter* previousSystemCompletionCounters, const Util::FixedArray<const Threading::AtomicCounter*, true>& extraCounters) override;
+
+    /// update tree with the entities of this frame, runs in a job
+    void UpdateTree();
+    /// cull a single work item for an observer, runs in a job
+    void CullItem(IndexT item, const Math::vec4* colX, const Math::vec4* colY, const Math::vec4* colZ, const Math::vec4* colW, bool isOrtho, Graphics::StageMask observerStage, Math::ClipStatus::Type* clipStatuses) const;
+    /// mark the always visible entities of an observer, runs once all work items of the observer are done
+    void MarkAlwaysVisible(Graphics::StageMask observerStage, Math::ClipStatus::Type* clipStatuses) const;
+
+    /// reset tree to a single root node covering the box
+    void Reset(const Math::bbox& box);
+    /// grow tree so that it covers box, reinserts all objects
+    void Grow(const Math::bbox& box);
+    /// get the axes split when subdividing a node at level, as a mask of x (1), y (2) and z (4)
+    uint32_t SplitAxes(uint32_t level) const;
+    /// create the children of a node, two for every split axis
+    void Subdivide(uint32_t node);
+    /// check if object box fits within node
+    bool Fits(uint32_t node, const Math::bbox& box) const;
+    /// find the smallest node the box fits in, creates nodes on the way
+    uint32_t FindNode(const Math::bbox& box);
+    /// insert object in tree
+    void Insert(uint32_t objectId, const Math::bbox& box);
+    /// remove object from tree
+    void Remove(uint32_t objectId);
+    /// gather the cull work items for this frame
+    void GatherCullItems();
+
+    static const uint32_t InvalidNode = 0xFFFFFFFF;
+    static const uint32_t MaxDepth = 10;
+    static const uint32_t DefaultDepth = 6;
+    static const uint32_t CullJobLevel = 2;
+    // one item per node down to and including CullJobLevel, 1 + 8 + 64
+    static const uint32_t MaxCullItems = 73;
+
+    struct NodeObject
+    {
+        Math::bbox box;                 // copy of the object box, so that culling a node reads contiguous memory
+        uint32_t id;
+    };
+
+    struct Node
+    {
+        Math::bbox box;                 // tight cell bounds
+        Math::bbox looseBox;            // culling bounds, twice the size of the cell
+        uint32_t parent;
+        uint32_t firstChild;            // first of numChildren consecutive children, or InvalidNode
+        uint32_t numChildren;
+        uint32_t level;
+        uint32_t numObjects;            // number of objects in this node and all of its children
+        Util::Array<NodeObject> objects;
+    };
+
+    struct Object
+    {
+        Math::bbox box;                 // last known bounding box
+        uint32_t node;                  // node the object is stored in, or InvalidNode
+        uint32_t slot;                  // index in the node object list
+        uint32_t index;                 // entity index this frame, used to address clip statuses
+        uint32_t frame;                 // last frame the object was part of the entities
+    };
+
+    struct CullWorkItem
+    {
+        uint32_t node;
+        bool recursive;                 // if false, only the objects within the node itself are tested
+    };
+
+    Util::Array<Node> nodes;
+    Util::Array<Object> objects;
+    Util::Array<uint32_t> alwaysVisible;
+    CullWorkItem cullItems[MaxCullItems];
+    uint32_t numCullItems;
+
+    uint32_t axisDepth[3];              // number of times each axis is split
+    uint32_t depth;
+    uint32_t frame;
+    bool worldExpanding;
+    Threading::AtomicCounter updateCounter;
+    Util::FixedArray<Threading::AtomicCounter> remainingItems;    // per observer, the last item to finish marks the always visible entities
 };
 
 } // namespace Visibility
-
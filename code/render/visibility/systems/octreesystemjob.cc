@@ -4,7 +4,180 @@
 //------------------------------------------------------------------------------
 
 #include "octreesystem.h"
+#include "math/clipstatus.h"
 namespace Visibility
 {
 
+//------------------------------------------------------------------------------
+/**
+    Entities are addressed by their object id (the node instance id), since their
+    index in the entity list is not stable between frames. Objects whose box still
+    fits their cell are left alone, and objects which are no longer part of the
+    entity list are removed from the tree.
+*/
+void
+OctreeSystem::UpdateTree()
+{
+    this->frame++;
+    this->alwaysVisible.Clear();
+
+    if (this->worldExpanding && this->nodes.IsEmpty())
+    {
+        if (this->ent.count == 0)
+        {
+            this->numCullItems = 0;
+            return;
+        }
+
+        Math::bbox bounds;
+        bounds.begin_extend();
+        for (IndexT i = 0; i < this->ent.count; i++)
+            bounds.extend(this->ent.boxes[this->ent.ids[i]]);
+        bounds.end_extend();
+
+        // keep cells roughly cubic by splitting the shorter axes fewer times
+        Math::vector const extents = bounds.extents();
+        float const axisExtents[3] = { extents.x, extents.y, extents.z };
+        float const largest = Math::max(axisExtents[0], Math::max(axisExtents[1], axisExtents[2]));
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            uint32_t depth = DefaultDepth;
+            for (float extent = axisExtents[axis] * 2.0f; extent < largest && depth > 0; extent *= 2.0f)
+                depth--;
+            this->axisDepth[axis] = depth;
+        }
+        this->depth = DefaultDepth;
+        this->Reset(bounds);
+    }
+
+    for (IndexT i = 0; i < this->ent.count; i++)
+    {
+        uint32_t const objectId = this->ent.ids[i];
+        const Math::bbox& box = this->ent.boxes[objectId];
+
+        while ((uint32_t)this->objects.Size() <= objectId)
+        {
+            Object object;
+            object.node = InvalidNode;
+            object.slot = 0;
+            object.index = 0;
+            object.frame = 0;
+            this->objects.Append(object);
+        }
+
+        Object& object = this->objects[objectId];
+        object.index = i;
+        object.frame = this->frame;
+
+        if (AllBits(this->ent.entityFlags[objectId], (uint32_t)Models::NodeInstanceFlags::NodeInstance_AlwaysVisible))
+            this->alwaysVisible.Append(i);
+
+        if (object.node != InvalidNode)
+        {
+            if (object.box.pmin == box.pmin && object.box.pmax == box.pmax)
+                continue;
+
+            object.box = box;
+            if (this->Fits(object.node, box))
+            {
+                this->nodes[object.node].objects[object.slot].box = box;
+                continue;
+            }
+            this->Remove(objectId);
+        }
+
+        object.box = box;
+        if (this->worldExpanding && !this->nodes[0].box.contains(xyz(box.center())))
+            this->Grow(box);
+        this->Insert(objectId, box);
+    }
+
+    // Every entity is in the tree at this point, so if the tree holds more objects some of them are gone
+    if (this->nodes[0].numObjects > (uint32_t)this->ent.count)
+    {
+        for (IndexT i = 0; i < this->objects.Size(); i++)
+        {
+            if (this->objects[i].node != InvalidNode && this->objects[i].frame != this->frame)
+                this->Remove(i);
+        }
+    }
+
+    this->GatherCullItems();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+OctreeSystem::CullItem(IndexT item, const Math::vec4* colX, const Math::vec4* colY, const Math::vec4* colZ, const Math::vec4* colW, bool isOrtho, Graphics::StageMask observerStage, Math::ClipStatus::Type* clipStatuses) const
+{
+    if (item >= (IndexT)this->numCullItems)
+        return;
+
+    struct StackEntry
+    {
+        uint32_t node;
+        bool inside;
+    };
+    StackEntry stack[MaxDepth * 7 + 1];
+    uint32_t top = 0;
+    stack[top++] = { this->cullItems[item].node, false };
+    bool const recursive = this->cullItems[item].recursive;
+
+    while (top > 0)
+    {
+        StackEntry const entry = stack[--top];
+        const Node& node = this->nodes[entry.node];
+
+        // The root also holds objects outside of the tree bounds, so it can't be rejected
+        Math::ClipStatus::Type status = Math::ClipStatus::Inside;
+        if (!entry.inside)
+            status = entry.node == 0 ? Math::ClipStatus::Clipped : node.looseBox.clipstatus(colX, colY, colZ, colW, isOrtho);
+
+        if (status == Math::ClipStatus::Outside)
+            continue;
+
+        for (const NodeObject& object : node.objects)
+        {
+            // Only look up the entity once the object is known to be visible, which avoids most of the scattered reads
+            Math::ClipStatus::Type objectStatus = Math::ClipStatus::Inside;
+            if (status != Math::ClipStatus::Inside)
+            {
+                objectStatus = object.box.clipstatus(colX, colY, colZ, colW, isOrtho);
+                if (objectStatus == Math::ClipStatus::Outside)
+                    continue;
+            }
+
+            uint32_t const index = this->objects[object.id].index;
+            if ((this->ent.stages[index] & observerStage) == 0)
+                continue;
+
+            if (status == Math::ClipStatus::Inside || clipStatuses[index] == Math::ClipStatus::Outside)
+                clipStatuses[index] = objectStatus;
+        }
+
+        if (recursive && node.firstChild != InvalidNode)
+        {
+            for (uint32_t child = 0; child < node.numChildren; child++)
+            {
+                if (this->nodes[node.firstChild + child].numObjects > 0)
+                    stack[top++] = { node.firstChild + child, status == Math::ClipStatus::Inside };
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+OctreeSystem::MarkAlwaysVisible(Graphics::StageMask observerStage, Math::ClipStatus::Type* clipStatuses) const
+{
+    for (uint32_t index : this->alwaysVisible)
+    {
+        if ((this->ent.stages[index] & observerStage) != 0)
+            clipStatuses[index] = Math::ClipStatus::Inside;
+    }
+}
+
 } // namespace Visibility
@@ -4,15 +4,466 @@
 //------------------------------------------------------------------------------
 
 #include "quadtreesystem.h"
+#include "jobs2/jobs2.h"
+#include "math/clipstatus.h"
 namespace Visibility
 {
 
+//------------------------------------------------------------------------------
+/**
+*/
+QuadtreeSystem::QuadtreeSystem()
+    : numCullItems(0)
+    , heightsDirty(false)
+    , axisDepth{ DefaultDepth, DefaultDepth }
+    , depth(DefaultDepth)
+    , frame(0)
+    , worldExpanding(false)
+    , updateCounter(0)
+{
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+QuadtreeSystem::~QuadtreeSystem()
+{
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static uint32_t
+CellsToDepth(uint cells)
+{
+    uint32_t depth = 0;
+    while ((1u << depth) < cells)
+        depth++;
+    return depth;
+}
+
+//------------------------------------------------------------------------------
+/**
+    The tree spans width along x and height along z, centered around pos.
+*/
+void
+QuadtreeSystem::Setup(const QuadtreeSystemLoadInfo& info)
+{
+    this->worldExpanding = info.worldExpanding;
+    if (this->worldExpanding)
+    {
+        // bounds and depths are decided by the first set of entities
+        return;
+    }
+
+    this->axisDepth[0] = Math::min(CellsToDepth(info.cellsX), MaxDepth);
+    this->axisDepth[1] = Math::min(CellsToDepth(info.cellsY), MaxDepth);
+    this->depth = Math::max(this->axisDepth[0], this->axisDepth[1]);
+
+    Math::vector extents(info.width * 0.5f, 0.0f, info.height * 0.5f);
+    this->center = xyz(info.pos);
+    this->Reset(Math::bbox(Math::point(info.pos.x, info.pos.y, info.pos.z), extents));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Observers are culled in groups of MaxObserversPerTraversal, every group walks the
+    tree once. Since the observers of a group finish together, the last work item of
+    a traversal releases all of their completion counters.
+*/
+void
+QuadtreeSystem::Run(const Threading::AtomicCounter* previousSystemCompletionCounters, const Util::FixedArray<const Threading::AtomicCounter*, true>& extraCounters)
+{
+    // Update the tree once all entity data is available
+    n_assert(this->updateCounter == 0);
+    this->updateCounter = 1;
+    Jobs2::JobDispatch(
+        [this](SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+        {
+            N_SCOPE(QuadtreeUpdate, Visibility);
+            this->UpdateTree();
+        }
+        , 1
+        , extraCounters
+        , &this->updateCounter
+        , nullptr);
+
+    SizeT const numTraversals = (this->obs.count + MaxObserversPerTraversal - 1) / MaxObserversPerTraversal;
+    if (this->remainingItems.Size() < numTraversals)
+        this->remainingItems.Resize(numTraversals);
+
+    for (IndexT traversal = 0; traversal < numTraversals; traversal++)
+    {
+        IndexT const firstObserver = traversal * MaxObserversPerTraversal;
+        SizeT const numObservers = Math::min(this->obs.count - firstObserver, (SizeT)MaxObserversPerTraversal);
+
+        // Frustums are read by the jobs, so they have to live in job memory
+        ObserverFrustum* frustums = Jobs2::JobAlloc<ObserverFrustum>(numObservers);
+        Util::FixedArray<const Threading::AtomicCounter*, true> counters(previousSystemCompletionCounters == nullptr ? 1 : 1 + numObservers);
+        counters[0] = &this->updateCounter;
+        for (IndexT i = 0; i < numObservers; i++)
+        {
+            IndexT const observer = firstObserver + i;
+            n_assert(this->obs.completionCounters[observer] == 0);
+            this->obs.completionCounters[observer] = 1;
+
+            ObserverFrustum& frustum = frustums[i];
+            SplatTransform(this->obs.transforms[observer], frustum.colX, frustum.colY, frustum.colZ, frustum.colW);
+            frustum.stage = this->obs.stages[observer];
+            frustum.isOrtho = this->obs.isOrtho[observer];
+            frustum.clipStatuses = this->obs.results[observer].Begin();
+            frustum.completionCounter = &this->obs.completionCounters[observer];
+
+            if (previousSystemCompletionCounters != nullptr)
+                counters[1 + i] = &previousSystemCompletionCounters[observer];
+        }
+
+        // One invocation per work item, the amount of items is only known after the update
+        this->remainingItems[traversal] = MaxCullItems;
+        Jobs2::JobDispatch(
+            [
+                system = this
+                , frustums
+                , numObservers
+                , remaining = &this->remainingItems[traversal]
+            ]
+        (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+        {
+            N_SCOPE(QuadtreeViewFrustumCulling, Visibility);
+            for (IndexT i = 0; i < groupSize; i++)
+            {
+                IndexT index = i + invocationOffset;
+                if (index >= totalJobs)
+                    return;
+                system->CullItem(index, frustums, numObservers);
+                if (Threading::Interlocked::Decrement(remaining) == 0)
+                {
+                    // Always visible entities are also in the tree, so they are only written once no item can touch them anymore
+                    system->MarkAlwaysVisible(frustums, numObservers);
+                    for (IndexT observer = 0; observer < numObservers; observer++)
+                        Jobs2::JobCounterDecrement(frustums[observer].completionCounter);
+                }
+            }
+        }
+        , MaxCullItems
+        , 1
+        , counters
+        , nullptr
+        , nullptr);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+QuadtreeSystem::Reset(const Math::bbox& box)
+{
+    this->nodes.Clear();
+
+    Node root;
+    root.box = box;
+    root.cullBox = Math::bbox(box.center(), box.extents() * 2.0f);
+    root.parent = InvalidNode;
+    root.firstChild = InvalidNode;
+    root.numChildren = 0;
+    root.level = 0;
+    root.numObjects = 0;
+    root.dirty = false;
+    this->nodes.Append(root);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Extends the tree to cover the box with some margin, then rebuilds it from scratch.
+    Only happens when an object leaves a world expanding tree, which should be rare.
+*/
+void
+QuadtreeSystem::Grow(const Math::bbox& box)
+{
+    Math::bbox bounds = this->nodes[0].box;
+    bounds.extend(box);
+    Math::vector extents = bounds.extents() * 2.0f;
+    extents = Math::vector(Math::max(extents.x, 1.0f), 0.0f, Math::max(extents.z, 1.0f));
+
+    this->Reset(Math::bbox(bounds.center(), extents));
+    for (IndexT i = 0; i < this->objects.Size(); i++)
+    {
+        Object& object = this->objects[i];
+        if (object.node != InvalidNode)
+        {
+            object.node = InvalidNode;
+            this->Insert(i, object.box);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+uint32_t
+QuadtreeSystem::SplitAxes(uint32_t level) const
+{
+    uint32_t axes = 0;
+    for (uint32_t axis = 0; axis < 2; axis++)
+    {
+        if (level < this->axisDepth[axis])
+            axes |= 1 << axis;
+    }
+    return axes;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Children are numbered by one bit per split axis, in x, z order.
+*/
+void
+QuadtreeSystem::Subdivide(uint32_t node)
+{
+    n_assert(this->nodes[node].firstChild == InvalidNode);
+    uint32_t const firstChild = this->nodes.Size();
+    uint32_t const axes = this->SplitAxes(this->nodes[node].level);
+    uint32_t const level = this->nodes[node].level + 1;
+    Math::point const center = this->nodes[node].box.center();
+    Math::vector const nodeExtents = this->nodes[node].box.extents();
+    float extents[2] = { nodeExtents.x, nodeExtents.z };
+    uint32_t numChildren = 1;
+    for (uint32_t axis = 0; axis < 2; axis++)
+    {
+        if (axes & (1 << axis))
+        {
+            extents[axis] *= 0.5f;
+            numChildren *= 2;
+        }
+    }
+
+    for (uint32_t child = 0; child < numChildren; child++)
+    {
+        float offset[2] = { 0.0f, 0.0f };
+        uint32_t bit = 0;
+        for (uint32_t axis = 0; axis < 2; axis++)
+        {
+            if (axes & (1 << axis))
+            {
+                offset[axis] = (child & (1 << bit)) ? extents[axis] : -extents[axis];
+                bit++;
+            }
+        }
+
+        Math::point const childCenter = center + Math::vector(offset[0], 0.0f, offset[1]);
+        Math::vector const childExtents(extents[0], nodeExtents.y, extents[1]);
+
+        Node n;
+        n.box = Math::bbox(childCenter, childExtents);
+        n.cullBox = Math::bbox(childCenter, childExtents * 2.0f);
+        n.parent = node;
+        n.firstChild = InvalidNode;
+        n.numChildren = 0;
+        n.level = level;
+        n.numObjects = 0;
+        n.dirty = false;
+        this->nodes.Append(n);
+    }
+
+    // append might have grown the array, so only store the index afterwards
+    this->nodes[node].firstChild = firstChild;
+    this->nodes[node].numChildren = numChildren;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+QuadtreeSystem::Contains(uint32_t node, const Math::point& point) const
+{
+    const Math::bbox& box = this->nodes[node].box;
+    return point.x >= box.pmin.x && point.x <= box.pmax.x
+        && point.z >= box.pmin.z && point.z <= box.pmax.z;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+QuadtreeSystem::Fits(uint32_t node, const Math::bbox& box) const
+{
+    // the root keeps everything that doesn't fit anywhere else
+    if (node == 0)
+        return true;
+
+    Math::vector const cellExtents = this->nodes[node].box.extents();
+    Math::vector const boxExtents = box.extents();
+    if (boxExtents.x > cellExtents.x || boxExtents.z > cellExtents.z)
+        return false;
+    return this->Contains(node, box.center());
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+uint32_t
+QuadtreeSystem::FindNode(const Math::bbox& box)
+{
+    Math::point const center = box.center();
+    Math::vector const boxExtents = box.extents();
+    uint32_t node = 0;
+    if (!this->Contains(0, center))
+        return node;
+
+    float const objectCenter[2] = { center.x, center.z };
+    float const objectExtents[2] = { boxExtents.x, boxExtents.z };
+    while (this->nodes[node].level < this->depth)
+    {
+        uint32_t const axes = this->SplitAxes(this->nodes[node].level);
+        Math::point const nodeCenter = this->nodes[node].box.center();
+        Math::vector const nodeExtents = this->nodes[node].box.extents();
+        float const cellCenter[2] = { nodeCenter.x, nodeCenter.z };
+        float const cellExtents[2] = { nodeExtents.x, nodeExtents.z };
+
+        // stop once the object is larger than the child cells
+        uint32_t child = 0, bit = 0;
+        bool fits = true;
+        for (uint32_t axis = 0; axis < 2; axis++)
+        {
+            float const childExtent = (axes & (1 << axis)) ? cellExtents[axis] * 0.5f : cellExtents[axis];
+            fits &= objectExtents[axis] <= childExtent;
+            if (axes & (1 << axis))
+            {
+                if (objectCenter[axis] >= cellCenter[axis])
+                    child |= 1 << bit;
+                bit++;
+            }
+        }
+        if (!fits)
+            break;
+
+        if (this->nodes[node].firstChild == InvalidNode)
+            this->Subdivide(node);
+        node = this->nodes[node].firstChild + child;
+    }
+    return node;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
 void
-QuadtreeSystem::Setup(const QuadtreeSystemLoadInfo & info)
+QuadtreeSystem::Insert(uint32_t objectId, const Math::bbox& box)
 {
+    uint32_t const node = this->FindNode(box);
+    Object& object = this->objects[objectId];
+    n_assert(object.node == InvalidNode);
+    object.node = node;
+    object.slot = this->nodes[node].objects.Size();
+    this->nodes[node].objects.Append({ box, objectId });
+
+    for (uint32_t it = node; it != InvalidNode; it = this->nodes[it].parent)
+        this->nodes[it].numObjects++;
+    this->Invalidate(node);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+QuadtreeSystem::Remove(uint32_t objectId)
+{
+    Object& object = this->objects[objectId];
+    n_assert(object.node != InvalidNode);
+    Node& node = this->nodes[object.node];
+    node.objects.EraseIndexSwap(object.slot);
+    if (object.slot < (uint32_t)node.objects.Size())
+        this->objects[node.objects[object.slot].id].slot = object.slot;
+
+    for (uint32_t it = object.node; it != InvalidNode; it = this->nodes[it].parent)
+        this->nodes[it].numObjects--;
+    this->Invalidate(object.node);
+    object.node = InvalidNode;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+QuadtreeSystem::Invalidate(uint32_t node)
+{
+    // once a node is dirty, so are all of its parents
+    for (uint32_t it = node; it != InvalidNode && !this->nodes[it].dirty; it = this->nodes[it].parent)
+        this->nodes[it].dirty = true;
+    this->heightsDirty = true;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Children are always created after their parent, so walking the nodes backwards
+    visits every child before its parent.
+*/
+void
+QuadtreeSystem::UpdateHeights()
+{
+    if (!this->heightsDirty)
+        return;
+
+    for (IndexT i = this->nodes.Size() - 1; i >= 0; i--)
+    {
+        Node& node = this->nodes[i];
+        if (!node.dirty)
+            continue;
+        node.dirty = false;
+
+        float minY = FLT_MAX, maxY = -FLT_MAX;
+        for (const NodeObject& object : node.objects)
+        {
+            minY = Math::min(minY, object.box.pmin.y);
+            maxY = Math::max(maxY, object.box.pmax.y);
+        }
+        for (uint32_t child = 0; child < node.numChildren; child++)
+        {
+            const Node& childNode = this->nodes[node.firstChild + child];
+            if (childNode.numObjects > 0)
+            {
+                minY = Math::min(minY, childNode.cullBox.pmin.y);
+                maxY = Math::max(maxY, childNode.cullBox.pmax.y);
+            }
+        }
+
+        if (node.numObjects > 0)
+        {
+            node.cullBox.pmin.y = minY;
+            node.cullBox.pmax.y = maxY;
+        }
+    }
+    this->heightsDirty = false;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Nodes above CullJobLevel only test their own objects, nodes at CullJobLevel
+    are traversed with all of their children.
+*/
+void
+QuadtreeSystem::GatherCullItems()
+{
+    this->numCullItems = 0;
+    uint32_t queue[MaxCullItems];
+    uint32_t head = 0, tail = 0;
+    queue[tail++] = 0;
+    while (head < tail)
+    {
+        uint32_t const node = queue[head++];
+        const Node& n = this->nodes[node];
+        if (n.numObjects == 0)
+            continue;
+
+        bool const recursive = n.level == CullJobLevel;
+        this->cullItems[this->numCullItems++] = { node, recursive };
+
+        if (!recursive && n.firstChild != InvalidNode)
+        {
+            for (uint32_t child = 0; child < n.numChildren; child++)
+                queue[tail++] = n.firstChild + child;
+        }
+    }
 }
 
 } // namespace Visibility
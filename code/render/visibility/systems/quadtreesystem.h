@@ -3,23 +3,141 @@
 /**
     Quadtree system
 
+    Loose quadtree over the xz-plane, where every cell accepts objects whose center is
+    inside the cell and whose horizontal extents are no larger than the cell itself. The
+    horizontal culling bounds of a cell are twice its size, while the vertical bounds
+    are the height range of everything in its subtree, so cells hugging the terrain
+    are culled as tightly as their contents allow.
+
+    The tree is updated incrementally by a job at the start of Run, only objects whose
+    bounding box no longer fits their cell are reinserted. All observers are then culled
+    together in a single traversal, where every cell is tested once per observer and
+    cells which are invisible to all of them are skipped, so the camera and its shadow
+    cascades share the cost of walking the tree. A cell completely inside a frustum
+    accepts its whole subtree for that observer without any further tests.
+
     @copyright
     (C) 2018-2020 Individual contributors, see AUTHORS file
 */
 //------------------------------------------------------------------------------
 #include "visibilitysystem.h"
-#include "jobs/jobs.h"
 namespace Visibility
 {
-    
+
 class QuadtreeSystem : public VisibilitySystem
 {
 public:
+    /// constructor
+    QuadtreeSystem();
+    /// destructor
+    ~QuadtreeSystem() override;
+
 private:
     friend class ObserverContext;
 
     /// setup from load info
     void Setup(const QuadtreeSystemLoadInfo& info);
+
+    /// run system
+    void Run(const Threading::AtomicCounter* previousSystemCompletionCounters, const Util::FixedArray<const Threading::AtomicCounter*, true>& extraCounters) override;
+
+    struct ObserverFrustum
+    {
+        Math::vec4 colX[4], colY[4], colZ[4], colW[4];
+        Graphics::StageMask stage;
+        bool isOrtho;
+        Math::ClipStatus::Type* clipStatuses;
+        Threading::AtomicCounter* completionCounter;
+    };
+
+    /// update tree with the entities of this frame, runs in a job
+    void UpdateTree();
+    /// cull a single work item for a group of observers, runs in a job
+    void CullItem(IndexT item, const ObserverFrustum* frustums, SizeT numFrustums) const;
+    /// mark the always visible entities for a group of observers, runs once all work items of the traversal are done
+    void MarkAlwaysVisible(const ObserverFrustum* frustums, SizeT numFrustums) const;
+
+    /// reset tree to a single root node covering the box
+    void Reset(const Math::bbox& box);
+    /// grow tree so that it covers box, reinserts all objects
+    void Grow(const Math::bbox& box);
+    /// get the axes split when subdividing a node at level, as a mask of x (1) and z (2)
+    uint32_t SplitAxes(uint32_t level) const;
+    /// create the children of a node, two for every split axis
+    void Subdivide(uint32_t node);
+    /// check if a point is inside the cell of a node, ignoring height
+    bool Contains(uint32_t node, const Math::point& point) const;
+    /// check if object box fits within node
+    bool Fits(uint32_t node, const Math::bbox& box) const;
+    /// find the smallest node the box fits in, creates nodes on the way
+    uint32_t FindNode(const Math::bbox& box);
+    /// insert object in tree
+    void Insert(uint32_t objectId, const Math::bbox& box);
+    /// remove object from tree
+    void Remove(uint32_t objectId);
+    /// mark node and its parents as needing their height range updated
+    void Invalidate(uint32_t node);
+    /// update the height range of all invalidated nodes
+    void UpdateHeights();
+    /// gather the cull work items for this frame
+    void GatherCullItems();
+
+    static const uint32_t InvalidNode = 0xFFFFFFFF;
+    static const uint32_t MaxDepth = 12;
+    static const uint32_t DefaultDepth = 8;
+    static const uint32_t CullJobLevel = 3;
+    // one item per node down to and including CullJobLevel, 1 + 4 + 16 + 64
+    static const uint32_t MaxCullItems = 85;
+    // observers culled in the same traversal, one bit each
+    static const uint32_t MaxObserversPerTraversal = 32;
+
+    struct NodeObject
+    {
+        Math::bbox box;                 // copy of the object box, so that culling a node reads contiguous memory
+        uint32_t id;
+    };
+
+    struct Node
+    {
+        Math::bbox box;                 // tight cell bounds, only x and z are used
+        Math::bbox cullBox;             // horizontally twice the size of the cell, vertically the height range of the subtree
+        uint32_t parent;
+        uint32_t firstChild;            // first of numChildren consecutive children, or InvalidNode
+        uint32_t numChildren;
+        uint32_t level;
+        uint32_t numObjects;            // number of objects in this node and all of its children
+        bool dirty;                     // height range has to be recalculated
+        Util::Array<NodeObject> objects;
+    };
+
+    struct Object
+    {
+        Math::bbox box;                 // last known bounding box
+        uint32_t node;                  // node the object is stored in, or InvalidNode
+        uint32_t slot;                  // index in the node object list
+        uint32_t index;                 // entity index this frame, used to address clip statuses
+        uint32_t frame;                 // last frame the object was part of the entities
+    };
+
+    struct CullWorkItem
+    {
+        uint32_t node;
+        bool recursive;                 // if false, only the objects within the node itself are tested
+    };
+
+    Util::Array<Node> nodes;
+    Util::Array<Object> objects;
+    Util::Array<uint32_t> alwaysVisible;
+    CullWorkItem cullItems[MaxCullItems];
+    uint32_t numCullItems;
+    bool heightsDirty;
+
+    uint32_t axisDepth[2];              // number of times x and z are split
+    uint32_t depth;
+    uint32_t frame;
+    bool worldExpanding;
+    Threading::AtomicCounter updateCounter;
+    Util::FixedArray<Threading::AtomicCounter> remainingItems;    // per traversal, the last item to finish signals all observers
 };
 
 } // namespace Visibility
@@ -4,25 +4,228 @@
 //------------------------------------------------------------------------------
 
 #include "quadtreesystem.h"
+#include "math/clipstatus.h"
+#include "util/bit.h"
 namespace Visibility
 {
 
 //------------------------------------------------------------------------------
 /**
+    Entities are addressed by their object id (the node instance id), since their
+    index in the entity list is not stable between frames. Objects whose box still
+    fits their cell are left alone, and objects which are no longer part of the
+    entity list are removed from the tree.
 */
-void 
-QuadtreeInjectFunction(const Jobs::JobFuncContext& ctx)
+void
+QuadtreeSystem::UpdateTree()
 {
+    this->frame++;
+    this->alwaysVisible.Clear();
 
+    if (this->worldExpanding && this->nodes.IsEmpty())
+    {
+        if (this->ent.count == 0)
+        {
+            this->numCullItems = 0;
+            return;
+        }
+
+        Math::bbox bounds;
+        bounds.begin_extend();
+        for (IndexT i = 0; i < this->ent.count; i++)
+            bounds.extend(this->ent.boxes[this->ent.ids[i]]);
+        bounds.end_extend();
+
+        // keep cells roughly square by splitting the shorter axis fewer times
+        Math::vector const extents = bounds.extents();
+        float const axisExtents[2] = { extents.x, extents.z };
+        float const largest = Math::max(axisExtents[0], axisExtents[1]);
+        for (uint32_t axis = 0; axis < 2; axis++)
+        {
+            uint32_t depth = DefaultDepth;
+            for (float extent = axisExtents[axis] * 2.0f; extent < largest && depth > 0; extent *= 2.0f)
+                depth--;
+            this->axisDepth[axis] = depth;
+        }
+        this->depth = DefaultDepth;
+        this->Reset(bounds);
+    }
+
+    for (IndexT i = 0; i < this->ent.count; i++)
+    {
+        uint32_t const objectId = this->ent.ids[i];
+        const Math::bbox& box = this->ent.boxes[objectId];
+
+        while ((uint32_t)this->objects.Size() <= objectId)
+        {
+            Object object;
+            object.node = InvalidNode;
+            object.slot = 0;
+            object.index = 0;
+            object.frame = 0;
+            this->objects.Append(object);
+        }
+
+        Object& object = this->objects[objectId];
+        object.index = i;
+        object.frame = this->frame;
+
+        if (AllBits(this->ent.entityFlags[objectId], (uint32_t)Models::NodeInstanceFlags::NodeInstance_AlwaysVisible))
+            this->alwaysVisible.Append(i);
+
+        if (object.node != InvalidNode)
+        {
+            if (object.box.pmin == box.pmin && object.box.pmax == box.pmax)
+                continue;
+
+            object.box = box;
+            if (this->Fits(object.node, box))
+            {
+                this->nodes[object.node].objects[object.slot].box = box;
+                this->Invalidate(object.node);
+                continue;
+            }
+            this->Remove(objectId);
+        }
+
+        object.box = box;
+        if (this->worldExpanding && !this->Contains(0, box.center()))
+            this->Grow(box);
+        this->Insert(objectId, box);
+    }
+
+    // Every entity is in the tree at this point, so if the tree holds more objects some of them are gone
+    if (this->nodes[0].numObjects > (uint32_t)this->ent.count)
+    {
+        for (IndexT i = 0; i < this->objects.Size(); i++)
+        {
+            if (this->objects[i].node != InvalidNode && this->objects[i].frame != this->frame)
+                this->Remove(i);
+        }
+    }
+
+    this->UpdateHeights();
+    this->GatherCullItems();
 }
 
 //------------------------------------------------------------------------------
 /**
+    Walks the item once for all observers. Every stack entry carries two masks with
+    one bit per observer, observers for which the node still has to be tested and
+    observers for which an ancestor was found to be completely inside the frustum.
+    A node is only visited if at least one observer can see it.
 */
-void 
-QuadtreeResolveFunction(const Jobs::JobFuncContext& ctx)
+void
+QuadtreeSystem::CullItem(IndexT item, const ObserverFrustum* frustums, SizeT numFrustums) const
 {
+    if (item >= (IndexT)this->numCullItems)
+        return;
+
+    struct StackEntry
+    {
+        uint32_t node;
+        uint32_t clipped;
+        uint32_t inside;
+    };
+    StackEntry stack[MaxDepth * 3 + 1];
+    uint32_t top = 0;
+    uint32_t const allObservers = numFrustums == 32 ? 0xFFFFFFFF : (1u << numFrustums) - 1;
+    stack[top++] = { this->cullItems[item].node, allObservers, 0 };
+    bool const recursive = this->cullItems[item].recursive;
+
+    while (top > 0)
+    {
+        StackEntry entry = stack[--top];
+        const Node& node = this->nodes[entry.node];
+
+        // The root also holds objects outside of the tree bounds, so it can't be rejected
+        if (entry.node != 0)
+        {
+            uint32_t clipped = entry.clipped;
+            while (clipped != 0)
+            {
+                uint32_t const observer = Util::FirstBitSetIndex(clipped);
+                uint32_t const bit = 1u << observer;
+                clipped &= ~bit;
 
+                const ObserverFrustum& frustum = frustums[observer];
+                Math::ClipStatus::Type const status = node.cullBox.clipstatus(frustum.colX, frustum.colY, frustum.colZ, frustum.colW, frustum.isOrtho);
+                if (status == Math::ClipStatus::Outside)
+                    entry.clipped &= ~bit;
+                else if (status == Math::ClipStatus::Inside)
+                {
+                    entry.clipped &= ~bit;
+                    entry.inside |= bit;
+                }
+            }
+        }
+
+        if ((entry.clipped | entry.inside) == 0)
+            continue;
+
+        for (const NodeObject& object : node.objects)
+        {
+            // Test the box against the partially visible observers first, which avoids looking up invisible entities
+            Math::ClipStatus::Type objectStatus[MaxObserversPerTraversal];
+            uint32_t visible = entry.inside;
+            uint32_t clipped = entry.clipped;
+            while (clipped != 0)
+            {
+                uint32_t const observer = Util::FirstBitSetIndex(clipped);
+                clipped &= ~(1u << observer);
+
+                const ObserverFrustum& frustum = frustums[observer];
+                objectStatus[observer] = object.box.clipstatus(frustum.colX, frustum.colY, frustum.colZ, frustum.colW, frustum.isOrtho);
+                if (objectStatus[observer] != Math::ClipStatus::Outside)
+                    visible |= 1u << observer;
+            }
+            if (visible == 0)
+                continue;
+
+            uint32_t const index = this->objects[object.id].index;
+            Graphics::StageMask const stages = this->ent.stages[index];
+            while (visible != 0)
+            {
+                uint32_t const observer = Util::FirstBitSetIndex(visible);
+                uint32_t const bit = 1u << observer;
+                visible &= ~bit;
+
+                const ObserverFrustum& frustum = frustums[observer];
+                if ((stages & frustum.stage) == 0)
+                    continue;
+
+                if (entry.inside & bit)
+                    frustum.clipStatuses[index] = Math::ClipStatus::Inside;
+                else if (objectStatus[observer] == Math::ClipStatus::Inside || frustum.clipStatuses[index] == Math::ClipStatus::Outside)
+                    frustum.clipStatuses[index] = objectStatus[observer];
+            }
+        }
+
+        if (recursive && node.firstChild != InvalidNode)
+        {
+            for (uint32_t child = 0; child < node.numChildren; child++)
+            {
+                if (this->nodes[node.firstChild + child].numObjects > 0)
+                    stack[top++] = { node.firstChild + child, entry.clipped, entry.inside };
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+QuadtreeSystem::MarkAlwaysVisible(const ObserverFrustum* frustums, SizeT numFrustums) const
+{
+    for (uint32_t index : this->alwaysVisible)
+    {
+        for (IndexT observer = 0; observer < numFrustums; observer++)
+        {
+            if ((this->ent.stages[index] & frustums[observer].stage) != 0)
+                frustums[observer].clipStatuses[index] = Math::ClipStatus::Inside;
+        }
+    }
 }
 
 } // namespace Visibility
@@ -14,6 +14,13 @@ VisibilitySystem::VisibilitySystem()
 {
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+VisibilitySystem::~VisibilitySystem()
+{
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -71,4 +78,33 @@ VisibilitySystem::GetCompletionCounters() const
     return this->obs.completionCounters.ConstBegin();
 }
 
+//------------------------------------------------------------------------------
+/**
+    Splat the matrix such that all _x, _y, ... will contain the column values of x, y, ...
+    This provides a way to rearrange the camera transform into a more SSE friendly matrix transform in the job
+*/
+void
+VisibilitySystem::SplatTransform(const Math::mat4& transform, Math::vec4* colX, Math::vec4* colY, Math::vec4* colZ, Math::vec4* colW)
+{
+    colX[0] = Math::splat_x(transform.r[0]);
+    colX[1] = Math::splat_x(transform.r[1]);
+    colX[2] = Math::splat_x(transform.r[2]);
+    colX[3] = Math::splat_x(transform.r[3]);
+
+    colY[0] = Math::splat_y(transform.r[0]);
+    colY[1] = Math::splat_y(transform.r[1]);
+    colY[2] = Math::splat_y(transform.r[2]);
+    colY[3] = Math::splat_y(transform.r[3]);
+
+    colZ[0] = Math::splat_z(transform.r[0]);
+    colZ[1] = Math::splat_z(transform.r[1]);
+    colZ[2] = Math::splat_z(transform.r[2]);
+    colZ[3] = Math::splat_z(transform.r[3]);
+
+    colW[0] = Math::splat_w(transform.r[0]);
+    colW[1] = Math::splat_w(transform.r[1]);
+    colW[2] = Math::splat_w(transform.r[2]);
+    colW[3] = Math::splat_w(transform.r[3]);
+}
+
 } // namespace Visibility
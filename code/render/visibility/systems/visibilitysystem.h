@@ -86,6 +86,8 @@ public:
 
     /// Constructor
     VisibilitySystem();
+    /// Destructor
+    virtual ~VisibilitySystem();
 
     /// setup observers
     virtual void PrepareObservers(const Math::mat4* transforms, const bool* orthoFlags, const Graphics::StageMask* stages, Util::Array<Math::ClipStatus::Type>* results, const SizeT count);
@@ -101,6 +103,9 @@ public:
 
 protected:
 
+    /// splat observer transform columns so that bounding boxes can be tested using bbox::clipstatus
+    static void SplatTransform(const Math::mat4& transform, Math::vec4* colX, Math::vec4* colY, Math::vec4* colZ, Math::vec4* colW);
+
     Math::vec3 center;
     Math::bbox boundingbox;
 
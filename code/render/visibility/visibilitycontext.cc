@@ -26,6 +26,8 @@
 
 #include "jobs2/jobs2.h"
 
+#include "gpulang/render/system_shaders/objects_shared.h"
+
 #ifndef PUBLIC_BUILD
 #include "imgui.h"
 #endif
@@ -40,6 +42,12 @@ Util::Array<VisibilitySystem*> ObserverContext::systems;
 
 static Util::Queue<Threading::Event*> waitEvents;
 
+N_DECLARE_COUNTER(N_VISIBILITY_DRAW_PACKETS, Visibility Draw Packets);
+N_DECLARE_COUNTER(N_VISIBILITY_DRAW_COMMANDS, Visibility Draw Commands);
+
+typedef ObjectsShared::Instances::STRUCT InstanceBlock;
+static const uint32_t MaxInstancesPerDraw = sizeof(InstanceBlock::ModelArray) / sizeof(InstanceBlock::ModelArray[0]);
+
 __ImplementContext(ObserverContext, ObserverContext::observerAllocator)
 
 struct ObservableGlobalState
@@ -62,6 +70,44 @@ ObserverContext::Setup(const Graphics::GraphicsEntityId id, VisibilityEntityType
     observerAllocator.Set<Observer_ResultArray>(cid.id, ObservableState.visibilityResults); // Copy global list of all observables
 }
 
+/// Instance block shared by the merged runs of a draw list, until it is full
+struct InstanceBlockRange
+{
+    CoreGraphics::ConstantBufferOffset offset = 0;
+    uint32_t numUsed = MaxInstancesPerDraw;
+};
+
+//------------------------------------------------------------------------------
+/**
+    Uploads the transforms of a run of node instances merged into a single draw command,
+    and points the instancing constants of the first packet of the run at them.
+    Runs are packed into the same instance block and drawn from their first slot,
+    a new block is only allocated when the run doesn't fit in the current one.
+*/
+static void
+SetupInstances(const uint64_t* keys, ObserverContext::VisibilityDrawCommand& drawCmd, Models::ShaderStateNode::DrawPacket* packet, const Models::ModelContext::ModelInstance::Renderable& renderables, InstanceBlockRange& block)
+{
+    if (block.numUsed + drawCmd.numPackets > MaxInstancesPerDraw)
+    {
+        block.offset = CoreGraphics::AllocateConstantBufferMemory(sizeof(InstanceBlock));
+        block.numUsed = 0;
+    }
+
+    drawCmd.firstInstance = block.numUsed;
+    for (uint32_t i = 0; i < drawCmd.numPackets; i++)
+    {
+        uint32_t index = keys[drawCmd.offset + i] & 0x00000000FFFFFFFF;
+        uint32_t slot = block.numUsed + i;
+        int id = index;
+        CoreGraphics::SetConstants(block.offset + offsetof(InstanceBlock, ModelArray) + slot * sizeof(InstanceBlock::ModelArray[0]), renderables.nodeWorldTransforms[index], CoreGraphics::GraphicsQueueType);
+        CoreGraphics::SetConstants(block.offset + offsetof(InstanceBlock, IdArray) + slot * sizeof(InstanceBlock::IdArray[0]), id, CoreGraphics::GraphicsQueueType);
+    }
+    block.numUsed += drawCmd.numPackets;
+
+    uint32_t leader = keys[drawCmd.offset] & 0x00000000FFFFFFFF;
+    packet->offsets[renderables.nodeStates[leader].instancingConstantsIndex] = block.offset;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -111,8 +157,14 @@ ObserverContext::RunVisibilityTests(const Graphics::FrameContext& ctx)
     {
         VisibilityDrawList& visibilities = observerAllocator.Get<Observer_DrawList>(i);
         observerResults[i].Fill(0, observerResults[i].Size(), Math::ClipStatus::Type::Outside);
+        if (visibilities.drawPackets.Size() > 0)
+        {
+            N_COUNTER_DECR(N_VISIBILITY_DRAW_PACKETS, visibilities.drawPackets.Size());
+            N_COUNTER_DECR(N_VISIBILITY_DRAW_COMMANDS, visibilities.numDrawCommands);
+        }
         visibilities.visibilityTable.Clear();
         visibilities.drawPackets.Clear();
+        visibilities.numDrawCommands = 0;
     }
 
     // prepare visibility systems
@@ -216,11 +268,8 @@ ObserverContext::RunVisibilityTests(const Graphics::FrameContext& ctx)
         const VisibilityResultArray& results = observerResults[i];
         VisibilityDrawList& visibilities = observerAllocator.Get<Observer_DrawList>(i);
         Memory::ArenaAllocator<1024>& allocator = observerAllocator.Get<Observer_DrawListAllocator>(i);
-        Util::FixedArray<uint64_t>& indexBuffer = observerAllocator.Get<Observer_IndexBuffer>(i);
-        Util::FixedArray<Math::ClipStatus::Type>& indexedClipStatuses = observerAllocator.Get<Observer_IndexedClipStatuses>(i);
+        DrawListSorter& sorter = observerAllocator.Get<Observer_DrawListSorter>(i);
 
-        indexBuffer.Resize(nodes.Size());
-        indexedClipStatuses.Resize(nodes.Size());
         // Before we create our draws, we have to wait for the constants to be allocated first
         // For particles, that's done before visibility so we can omit it here
         Util::FixedArray<const Threading::AtomicCounter*, true> waitCounters =
@@ -230,156 +279,171 @@ ObserverContext::RunVisibilityTests(const Graphics::FrameContext& ctx)
             &Characters::CharacterContext::ConstantUpdateCounter,
         };
 
-        Jobs2::JobDispatch(
+        // Sort the visible node instances in parallel, and then resolve them into draw commands
+        Jobs2::JobBeginSequence(waitCounters, &completionCounter, finishedEvent);
+        sorter.AppendJobs(results.ConstBegin(), nodes.ConstBegin(), nodes.Size(), NodeInstances.nodeSortId.ConstBegin(), NodeInstances.nodeFlags.Begin(), NodeInstances.nodeFlags.Size());
+        Jobs2::JobAppendSequence(
             [
-                statuses = results.ConstBegin()
-                , ids = nodes.ConstBegin()
-                , drawList = &visibilities
+                drawList = &visibilities
                 , allocator = &allocator
                 , renderables = &NodeInstances
-                , &indexBuffer
-                , &indexedClipStatuses
+                , sorter = &sorter
             ]
         (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
         {
             N_SCOPE(VisibilitySortJob, Graphics);
             allocator->Release();
 
-            // calculate amount of models
-            uint32_t numNodeInstances = totalJobs;
-
-            if (numNodeInstances == 0)
-                return;
+            const uint64_t* indexBuffer = sorter->GetKeys();
+            const uint32_t visibleCounter = sorter->GetNumKeys();
+            if (visibleCounter == 0)
+                return; // early out
 
-            uint64_t visibleCounter = 0;
-            for (uint32_t i = 0; i < numNodeInstances; i++)
+            // Now resolve the indexbuffer into draw commands
+            InstanceBlockRange instanceBlock;
+            drawList->numDrawCommands = ResolveDrawList(indexBuffer, visibleCounter, *renderables, *drawList, *allocator,
+                [indexBuffer, renderables, &instanceBlock](VisibilityDrawCommand& drawCmd, Models::ShaderStateNode::DrawPacket* packet)
             {
-                // Make sure we're not exceeding the number of bits in the index buffer reserved for the actual node instance
-                n_assert(ids[i] < 0xFFFFFFFF);
-                indexedClipStatuses[visibleCounter] = statuses[i];
-                indexBuffer[visibleCounter] = ids[i];
-                visibleCounter++;
-            }
+                SetupInstances(indexBuffer, drawCmd, packet, *renderables, instanceBlock);
+            });
+            N_COUNTER_INCR(N_VISIBILITY_DRAW_PACKETS, visibleCounter);
+            N_COUNTER_INCR(N_VISIBILITY_DRAW_COMMANDS, drawList->numDrawCommands);
+        }, 1);
+        Jobs2::JobEndSequence();
+    }
 
-            // loop over each node and give them the appropriate weight
-            uint32_t i = 0;
-            while (i < visibleCounter)
-            {
-                n_assert(indexBuffer[i] < 0x00000000FFFFFFFF);
-                uint64_t index = indexBuffer[i] & 0x00000000FFFFFFFF;
-                Math::ClipStatus::Type clipStatus = indexedClipStatuses[i];
+    if (finishedEvent != nullptr)
+        waitEvents.Enqueue(finishedEvent);
+}
 
-                // If not visible nor active, erase item from index list
-                if (!AllBits(renderables->nodeFlags[index], Models::NodeInstanceFlags::NodeInstance_Active)
-                    || clipStatus == Math::ClipStatus::Outside)
-                {
-                    indexBuffer[i] = indexBuffer[visibleCounter - 1];
-                    indexedClipStatuses[i] = indexedClipStatuses[visibleCounter - 1];
-                    visibleCounter--;
-                    continue;
-                }
-                else
-                {
-                    // Set the node visible flag (use this to figure out if a node is seen by __any__ observer)
-                    renderables->nodeFlags[index] = SetBits(renderables->nodeFlags[index], Models::NodeInstanceFlags::NodeInstance_Visible);
-                }
+//------------------------------------------------------------------------------
+/**
+    Consecutive static nodes sharing template, mesh, material and primitive group are
+    merged into a single draw command, which is drawn instanced if the batch has an
+    instanced program. setupInstances is called exactly once for every merged command,
+    with the first packet of the run, before the run's command array is grown again.
+*/
+uint32_t
+ObserverContext::ResolveDrawList(
+    const uint64_t* keys
+    , uint32_t numKeys
+    , const Models::ModelContext::ModelInstance::Renderable& renderables
+    , VisibilityDrawList& drawList
+    , Memory::ArenaAllocator<1024>& allocator
+    , const InstanceSetupFunc& setupInstances)
+{
+    uint32_t numDraws = 0;
+    drawList.drawPackets.Reserve(numKeys);
 
-                // Get sort id and combine with index to get full sort id
-                uint64_t sortId = renderables->nodeSortId[index];
-                indexBuffer[i] = sortId | index;
-                i++;
-            }
+    ObserverContext::VisibilityBatchCommand* cmd = nullptr;
+    CoreGraphics::MeshId mesh = CoreGraphics::InvalidMeshId;
+    Materials::MaterialId mat = Materials::InvalidMaterialId;
+    const MaterialTemplatesGPULang::Entry* currentMaterialType = nullptr;
 
-            if (visibleCounter == 0)
-                return; // early out
+    // The draw command currently collecting identical node instances, if any
+    ObserverContext::VisibilityDrawCommand* run = nullptr;
+    uint32_t numDrawCommands = 0;
 
-            // sort the index buffer
-            std::qsort(indexBuffer.Begin(), visibleCounter, sizeof(uint64_t), [](const void* a, const void* b)
-            {
-                uint64_t arg1 = *static_cast<const uint64_t*>(a);
-                uint64_t arg2 = *static_cast<const uint64_t*>(b);
-                return (arg1 > arg2) - (arg1 < arg2);
-            });
+    // Ends the current run, a merged run needs its instance data before anything else is emplaced
+    auto flushRun = [&]()
+    {
+        if (run != nullptr && run->numPackets > 1)
+            setupInstances(*run, drawList.drawPackets[run->offset]);
+        run = nullptr;
+    };
 
-            // Now resolve the indexbuffer into draw commands
-            uint32_t numDraws = 0;
-            const uint32_t numPackets = visibleCounter;
-            drawList->drawPackets.Reserve(numPackets);
+    for (uint32_t i = 0; i < numKeys; i++)
+    {
+        uint32_t index = keys[i] & 0x00000000FFFFFFFF;
 
-            // Allocate single command which we can
-            ObserverContext::VisibilityBatchCommand* cmd = nullptr;
-            CoreGraphics::MeshId mesh = CoreGraphics::InvalidMeshId;
-            Materials::MaterialId mat = Materials::InvalidMaterialId;
-            const MaterialTemplatesGPULang::Entry* currentMaterialType = nullptr;
+        // If new material, add a new entry into the lookup table
+        auto otherMaterialType = renderables.nodeMaterialTemplates[index];
+        if (currentMaterialType != otherMaterialType)
+        {
+            flushRun();
 
-            for (uint32_t i = 0; i < numPackets; i++)
-            {
-                uint32_t index = indexBuffer[i] & 0x00000000FFFFFFFF;
+            // Add new draw command and get reference to it
+            cmd = &drawList.visibilityTable.Emplace(otherMaterialType);
 
-                // If new material, add a new entry into the lookup table
-                auto otherMaterialType = renderables->nodeMaterialTemplates[index];
-                if (currentMaterialType != otherMaterialType)
-                {
-                    // Add new draw command and get reference to it
-                    cmd = &drawList->visibilityTable.Emplace(otherMaterialType);
+            // Setup initial state for command
+            cmd->packetOffset = numDraws;
+            cmd->numDrawPackets = 0;
 
-                    // Setup initial state for command
-                    cmd->packetOffset = numDraws;
-                    cmd->numDrawPackets = 0;
+            mesh = CoreGraphics::InvalidMeshId;
+            currentMaterialType = otherMaterialType;
+        }
+        n_assert(cmd != nullptr);
 
-                    mesh = CoreGraphics::InvalidMeshId;
-                    currentMaterialType = otherMaterialType;
-                }
-                n_assert(cmd != nullptr);
+        // If a new node (resource), add a model apply command
+        auto otherMesh = renderables.nodeMeshes[index];
+        auto otherMat = renderables.nodeMaterials[index];
+        if (mesh != otherMesh || mat != otherMat)
+        {
+            flushRun();
 
-                // If a new node (resource), add a model apply command
-                auto otherMesh = renderables->nodeMeshes[index];
-                auto otherMat = renderables->nodeMaterials[index];
-                if (mesh != otherMesh || mat != otherMat)
-                {
-                    ObserverContext::VisibilityModelCommand& batchCmd = cmd->models.Emplace();
+            ObserverContext::VisibilityModelCommand& batchCmd = cmd->models.Emplace();
 
-                    // The offset of the command corresponds to where in the VisibilityBatchCommand batch the model should be applied
-                    batchCmd.offset = cmd->packetOffset + cmd->numDrawPackets;
-                    batchCmd.mesh = otherMesh;
-                    batchCmd.material = otherMat;
+            // The offset of the command corresponds to where in the VisibilityBatchCommand batch the model should be applied
+            batchCmd.offset = cmd->packetOffset + cmd->numDrawPackets;
+            batchCmd.mesh = otherMesh;
+            batchCmd.material = otherMat;
 
 #if NEBULA_GRAPHICS_DEBUG
-                    batchCmd.nodeName = renderables->nodeNames[index];
+            batchCmd.nodeName = renderables.nodeNames[index];
 #endif
-                    mesh = otherMesh;
-                    mat = otherMat;
-                }
+            mesh = otherMesh;
+            mat = otherMat;
+        }
 
-                ObserverContext::VisibilityDrawCommand& drawCmd = cmd->draws.Emplace();
-                drawCmd.primitiveGroup = renderables->nodePrimitiveGroup[index];
-                drawCmd.offset = cmd->packetOffset + cmd->numDrawPackets;
-                drawCmd.numInstances = Util::Get<0>(renderables->nodeDrawModifiers[index]);
-                drawCmd.baseInstance = Util::Get<1>(renderables->nodeDrawModifiers[index]);
+        const Models::ModelContext::NodeInstanceState& state = renderables.nodeStates[index];
+        bool const instanceable = renderables.nodeTypes[index] == Models::PrimitiveNodeType
+            && state.materialInstance == Materials::MaterialInstanceId::Invalid()
+            && state.instancingConstantsIndex != InvalidIndex
+            && Util::Get<0>(renderables.nodeDrawModifiers[index]) == 1
+            && Util::Get<1>(renderables.nodeDrawModifiers[index]) == 0
+            && renderables.nodeLods[index] <= 0.0f;
+        if (instanceable
+            && run != nullptr
+            && run->numPackets < MaxInstancesPerDraw
+            && renderables.nodePrimitiveGroupIndex[index] == renderables.nodePrimitiveGroupIndex[keys[run->offset] & 0x00000000FFFFFFFF])
+        {
+            run->numPackets++;
+        }
+        else
+        {
+            flushRun();
+
+            ObserverContext::VisibilityDrawCommand& drawCmd = cmd->draws.Emplace();
+            drawCmd.primitiveGroup = renderables.nodePrimitiveGroup[index];
+            drawCmd.offset = cmd->packetOffset + cmd->numDrawPackets;
+            drawCmd.numInstances = Util::Get<0>(renderables.nodeDrawModifiers[index]);
+            drawCmd.baseInstance = Util::Get<1>(renderables.nodeDrawModifiers[index]);
+            drawCmd.numPackets = 1;
+            drawCmd.firstInstance = 0;
+            run = instanceable ? &drawCmd : nullptr;
+            numDrawCommands++;
+        }
 
-                // allocate memory for draw packet
-                void* mem = allocator->Alloc(sizeof(Models::ShaderStateNode::DrawPacket));
+        // allocate memory for draw packet
+        void* mem = allocator.Alloc(sizeof(Models::ShaderStateNode::DrawPacket));
 
-                // update packet and add to list
-                Models::ShaderStateNode::DrawPacket* packet = reinterpret_cast<Models::ShaderStateNode::DrawPacket*>(mem);
-                packet->numOffsets = renderables->nodeStates[index].resourceTableOffsets.Size();
-                packet->table = renderables->nodeStates[index].resourceTables[CoreGraphics::GetBufferedFrameIndex()];
-                packet->materialInstance = renderables->nodeStates[index].materialInstance;
+        // update packet and add to list
+        Models::ShaderStateNode::DrawPacket* packet = reinterpret_cast<Models::ShaderStateNode::DrawPacket*>(mem);
+        packet->numOffsets = state.resourceTableOffsets.Size();
+        packet->table = state.resourceTables[CoreGraphics::GetBufferedFrameIndex()];
+        packet->materialInstance = state.materialInstance;
 #ifndef PUBLIC_BUILD
-                packet->boundingBox = renderables->nodeBoundingBoxes[index];
-                packet->nodeInstanceHash = index;
+        packet->boundingBox = renderables.nodeBoundingBoxes[index];
+        packet->nodeInstanceHash = index;
 #endif
-                memcpy(packet->offsets, renderables->nodeStates[index].resourceTableOffsets.Begin(), renderables->nodeStates[index].resourceTableOffsets.ByteSize());
-                packet->slot = NEBULA_DYNAMIC_OFFSET_GROUP;
-                drawList->drawPackets.Append(packet);
-                cmd->numDrawPackets++;
-                numDraws++;
-            }
-        }, nodes.Size(), waitCounters, &completionCounter, finishedEvent);
+        memcpy(packet->offsets, state.resourceTableOffsets.Begin(), state.resourceTableOffsets.ByteSize());
+        packet->slot = NEBULA_DYNAMIC_OFFSET_GROUP;
+        drawList.drawPackets.Append(packet);
+        cmd->numDrawPackets++;
+        numDraws++;
     }
-
-    if (finishedEvent != nullptr)
-        waitEvents.Enqueue(finishedEvent);
+    flushRun();
+    return numDrawCommands;
 }
 
 //------------------------------------------------------------------------------
@@ -481,6 +545,18 @@ ObserverContext::CreateBruteforceSystem(const BruteforceSystemLoadInfo& info)
     return system;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+void
+ObserverContext::DestroySystem(VisibilitySystem* system)
+{
+    IndexT index = ObserverContext::systems.FindIndex(system);
+    n_assert(index != InvalidIndex);
+    ObserverContext::systems.EraseIndex(index);
+    delete system;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -17,6 +17,9 @@
 #include "memory/arenaallocator.h"
 #include "math/clipstatus.h"
 #include "coregraphics/mesh.h"
+#include "drawlistsorter.h"
+#include "models/modelcontext.h"
+#include <functional>
 
 namespace Models
 {
@@ -55,6 +58,8 @@ public:
     static VisibilitySystem* CreateQuadtreeSystem(const QuadtreeSystemLoadInfo& info);
     /// create brute force system
     static VisibilitySystem* CreateBruteforceSystem(const BruteforceSystemLoadInfo& info);
+    /// destroy a visibility system
+    static void DestroySystem(VisibilitySystem* system);
 
     /// wait for all visibility jobs
     static void WaitForVisibility(const Graphics::FrameContext& ctx);
@@ -83,6 +88,8 @@ public:
         uint32_t offset;
         uint32_t numInstances;
         uint32_t baseInstance;
+        uint32_t numPackets;            // consecutive packets with identical geometry, drawn instanced if more than one
+        uint32_t firstInstance;         // slot of the first packet in the instance block of a merged run
     };
 
     struct VisibilityBatchCommand
@@ -97,11 +104,23 @@ public:
     {
         Util::HashTable<const MaterialTemplatesGPULang::Entry*, VisibilityBatchCommand> visibilityTable;
         Util::Array<Models::ShaderStateNode::DrawPacket*> drawPackets;
+        uint32_t numDrawCommands = 0;
     };
 
     /// get visibility draw list
     static const VisibilityDrawList* GetVisibilityDrawList(const Graphics::GraphicsEntityId id);
 
+    /// called for every draw command merging more than one packet, with the first packet of the run, sets up the first instance of the command
+    typedef std::function<void(VisibilityDrawCommand&, Models::ShaderStateNode::DrawPacket*)> InstanceSetupFunc;
+    /// resolve sorted node instance keys into draw commands, returns the number of draw commands
+    static uint32_t ResolveDrawList(
+        const uint64_t* keys
+        , uint32_t numKeys
+        , const Models::ModelContext::ModelInstance::Renderable& renderables
+        , VisibilityDrawList& drawList
+        , Memory::ArenaAllocator<1024>& allocator
+        , const InstanceSetupFunc& setupInstances);
+
     static Jobs::JobSyncId jobInternalSync;
     static Jobs::JobSyncId jobInternalSync2;
     static Jobs::JobSyncId jobInternalSync3;
@@ -123,8 +142,7 @@ private:
         Observer_ResultArray,
         Observer_DrawList,
         Observer_DrawListAllocator,
-        Observer_IndexBuffer,
-        Observer_IndexedClipStatuses
+        Observer_DrawListSorter
     };
 
     typedef Ids::IdAllocator<
@@ -135,8 +153,7 @@ private:
         , VisibilityResultArray                    // visibility lookup table
         , VisibilityDrawList                       // draw list
         , Memory::ArenaAllocator<1024>             // memory allocator for draw commands
-        , Util::FixedArray<uint64_t>               // index buffer
-        , Util::FixedArray<Math::ClipStatus::Type> // clip statuses
+        , DrawListSorter                           // sorts the visible node instances
     > ObserverAllocator;
     static ObserverAllocator observerAllocator;
 
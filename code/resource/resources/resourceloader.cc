@@ -8,17 +8,22 @@
 #include "resourceserver.h"
 #include "util/bit.h"
 #include "profiling/profiling.h"
+#include "jobs2/jobs2.h"
 
 using namespace IO;
 namespace Resources
 {
 
 __ImplementAbstractClass(Resources::ResourceLoader, 'RSLO', Core::RefCounted);
+
+N_DECLARE_HISTOGRAM(N_RESOURCE_LOAD_TIME, Resource Load Time (us))
 //------------------------------------------------------------------------------
 /**
 */
 ResourceLoader::ResourceLoader()
     : async(false)
+    , preloadFiles(false)
+    , pendingFileReads(0)
 {
     // maybe this is arrogant, just 1024 pending resources (actual resources that is) per loader?
     this->pendingLoads.Reserve(1024);
@@ -60,6 +65,8 @@ ResourceLoader::Setup()
 void
 ResourceLoader::Discard()
 {
+    // file reads still in flight enqueue jobs on the streamer thread when done
+    Jobs2::JobWait(&this->pendingFileReads);
     this->streamerThread->Stop();
     this->streamerThread = nullptr;
 }
@@ -158,12 +165,58 @@ ApplyLoadOutput(ResourceLoader* loader, const ResourceLoader::ResourceLoadOutput
 void
 DispatchJob(ResourceLoader* loader, const ResourceLoader::ResourceLoadJob& job)
 {
-    if (loader->async && !job.immediate)
+    if (loader->async && !job.immediate && loader->preloadFiles)
+    {
+        Threading::CriticalScope scope(&loader->preloadSection);
+        IndexT preloadIndex = loader->preloadingJobs.FindIndex(job.id.loaderInstanceId);
+        if (preloadIndex != InvalidIndex)
+        {
+            // The file of this resource is still being read, so the job may not overtake the load waiting for it
+            loader->preloadingJobs.ValueAtIndex(preloadIndex).Append(job);
+            return;
+        }
+    }
+
+    if (loader->async && !job.immediate && loader->preloadFiles && AllBits(job.flags, LoadFlags::Create))
+    {
+        // Read the file into memory first, the job is sent off to the thread once the read is done
+        loader->preloadSection.Enter();
+        loader->preloadingJobs.Add(job.id.loaderInstanceId, Util::Array<ResourceLoader::ResourceLoadJob>());
+        loader->preloadSection.Leave();
+
+        Threading::Interlocked::Increment(&loader->pendingFileReads);
+        auto readFunc = [loader, job](const Ptr<Stream>& stream) -> void
+        {
+            auto jobFunc = [loader, job, stream]() -> void
+            {
+                ResourceLoader::ResourceLoadOutput output = _LoadInternal(loader, job, stream);
+                loader->loadOutputs.Enqueue(output);
+            };
+
+            // Send off the load together with the jobs queued behind it, in the order they were dispatched
+            Threading::CriticalScope scope(&loader->preloadSection);
+            loader->EnqueueJob(jobFunc);
+            IndexT preloadIndex = loader->preloadingJobs.FindIndex(job.id.loaderInstanceId);
+            n_assert(preloadIndex != InvalidIndex);
+            for (const ResourceLoader::ResourceLoadJob& queuedJob : loader->preloadingJobs.ValueAtIndex(preloadIndex))
+            {
+                auto queuedFunc = [loader, queuedJob]() -> void
+                {
+                    ResourceLoader::ResourceLoadOutput output = _LoadInternal(loader, queuedJob, nullptr);
+                    loader->loadOutputs.Enqueue(output);
+                };
+                loader->EnqueueJob(queuedFunc);
+            }
+            loader->preloadingJobs.EraseAtIndex(preloadIndex);
+        };
+        IO::IoServer::Instance()->ReadFileAsync(job.name.AsCharPtr(), readFunc, &loader->pendingFileReads);
+    }
+    else if (loader->async && !job.immediate)
     {
         // Create and send off job to thread
         auto jobFunc = [loader, job]() -> void
         {
-            ResourceLoader::ResourceLoadOutput output = _LoadInternal(loader, job);
+            ResourceLoader::ResourceLoadOutput output = _LoadInternal(loader, job, nullptr);
             loader->loadOutputs.Enqueue(output);
         };
         loader->EnqueueJob(jobFunc);
@@ -171,7 +224,7 @@ DispatchJob(ResourceLoader* loader, const ResourceLoader::ResourceLoadJob& job)
     else
     {
         // Perform immediate load and update the state of the loader
-        ResourceLoader::ResourceLoadOutput output = _LoadInternal(loader, job);
+        ResourceLoader::ResourceLoadOutput output = _LoadInternal(loader, job, nullptr);
         ApplyLoadOutput(loader, output);
     }
 }
@@ -352,10 +405,14 @@ ResourceLoader::GetPlaceholder(const Resources::ResourceName& name)
 
 //------------------------------------------------------------------------------
 /**
+    If the file has already been read into memory, the preloaded stream is used
+    instead of opening the file again.
 */
 ResourceLoader::ResourceLoadOutput
-_LoadInternal(ResourceLoader* loader, ResourceLoader::ResourceLoadJob job)
+_LoadInternal(ResourceLoader* loader, ResourceLoader::ResourceLoadJob job, const Ptr<Stream>& preloadedStream)
 {
+    N_HISTOGRAM_TIMER(N_RESOURCE_LOAD_TIME);
+
     ResourceLoader::ResourceStreamOutput streamResult;
     streamResult.pendingBits = job.loadState.pendingBits;
     streamResult.loadedBits = job.loadState.loadedBits;
@@ -363,7 +420,7 @@ _LoadInternal(ResourceLoader* loader, ResourceLoader::ResourceLoadJob job)
     if (AllBits(job.flags, LoadFlags::Create))
     {
         // construct stream
-        Ptr<Stream> stream = IO::IoServer::Instance()->CreateStream(job.name.AsCharPtr());
+        Ptr<Stream> stream = preloadedStream.isvalid() ? preloadedStream : IO::IoServer::Instance()->CreateStream(job.name.AsCharPtr());
         stream->SetAccessMode(Stream::ReadAccess);
         if (stream->Open())
         {
@@ -525,7 +582,7 @@ Resources::ResourceLoader::CreateResource(const ResourceName& res, const void* l
         if (immediate)
         {
             ResourceLoadJob job = ResourceLoadJob::FromPending(this, -1, pending);
-            ResourceLoadOutput output = _LoadInternal(this, job);
+            ResourceLoadOutput output = _LoadInternal(this, job, nullptr);
             output.UpdateLoaderState(this);
             SetupIdFromEntry(output.id.loaderInstanceId, ret);
             if (output.state == Resource::Loaded && success != nullptr)
@@ -607,7 +664,7 @@ Resources::ResourceLoader::CreateResource(const ResourceName& res, const void* l
             if (immediate)
             {
                 ResourceLoadJob job = ResourceLoadJob::FromPending(this, -1, pending);
-                ResourceLoadOutput output = _LoadInternal(this, job);
+                ResourceLoadOutput output = _LoadInternal(this, job, nullptr);
                 output.UpdateLoaderState(this);
                 SetupIdFromEntry(output.id.loaderInstanceId, ret);
                 if (output.state == Resource::Loaded && success != nullptr)
@@ -774,7 +831,7 @@ ResourceLoader::SetMinLod(const Resources::ResourceId& id, const float lod, bool
         load.flags |= LoadFlags::Update;
         load.immediate = immediate;
         ResourceLoadJob job = ResourceLoadJob::FromPending(this, -1, load);
-        ResourceLoadOutput output = _LoadInternal(this, job);
+        ResourceLoadOutput output = _LoadInternal(this, job, nullptr);
         output.UpdateLoaderState(this);
     }
     else
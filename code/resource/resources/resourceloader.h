@@ -9,6 +9,14 @@
         2. Error resource
 
     If no placeholder resource is provided, the loader cannot execute asynchronously.
+
+    Asynchronous loaders which consume their whole file on load may set preloadFiles in
+    their constructor. Their files are then read into memory by the IoServer's async file
+    reader as soon as the loads are dispatched, which keeps many reads in flight at once,
+    and the loader thread only runs InitializeResource and StreamResource on files which
+    are already in memory. Loads of a resource whose file is still being read
+    are held back until the read is done, so they can't overtake it. Loaders which only read parts of their files, like streamed
+    textures, should keep reading from the file instead.
     If no error resource is provided and the resource fails to load, then the ResourceServer
     will raise an assertion. 
 
@@ -39,6 +47,7 @@
 #include "resource.h"
 #include "threading/safequeue.h"
 #include "threading/threadid.h"
+#include "threading/interlocked.h"
 #include "ids/idpool.h"
 #include <tuple>
 #include <functional>
@@ -218,7 +227,7 @@ protected:
     
     friend void ApplyLoadOutput(ResourceLoader* loader, const ResourceLoader::ResourceLoadOutput& output);
     friend void DispatchJob(ResourceLoader* loader, const ResourceLoader::ResourceLoadJob& job);
-    friend ResourceLoadOutput _LoadInternal(ResourceLoader* loader, ResourceLoadJob res);
+    friend ResourceLoadOutput _LoadInternal(ResourceLoader* loader, ResourceLoadJob res, const Ptr<IO::Stream>& preloadedStream);
 
     /// Update loader internal state
     virtual void UpdateLoaderSyncState();
@@ -292,6 +301,11 @@ protected:
     Resources::ResourceId failResourceId;
 
     bool async;
+    bool preloadFiles;
+    Threading::AtomicCounter pendingFileReads;
+    /// resources whose files are being read, with the jobs dispatched for them in the meantime
+    Util::Dictionary<Ids::Id32, Util::Array<ResourceLoadJob>> preloadingJobs;
+    Threading::CriticalSection preloadSection;
 
     Ptr<ResourceLoaderThread> streamerThread;
     std::function<void()> preJobFunc;
@@ -106,10 +106,11 @@ class VariableDefinition:
         return self.name == other.name
 
 class PassDefinition:
-    def __init__(self, batch, shader, variation):
+    def __init__(self, batch, shader, variation, instancedVariation):
         self.batch = batch
         self.shader = shader
         self.variation = variation
+        self.instancedVariation = instancedVariation
 
     def __hash__(self):
         return hash(self.batch)
@@ -188,7 +189,10 @@ class MaterialTemplateDefinition:
                     batch = p["batch"]
                     shader = p["shader"]
                     variation = p["variation"]
-                    self.passes.append(PassDefinition(batch, shader, variation))
+                    instancedVariation = None
+                    if "instancedVariation" in p:
+                        instancedVariation = p["instancedVariation"]
+                    self.passes.append(PassDefinition(batch, shader, variation, instancedVariation))
     pass
 
     def FormatHeader(self):
@@ -277,9 +281,13 @@ class MaterialTemplateDefinition:
                 func += '\t\t/* Pass {} */\n'.format(p.batch)
                 func += '\t\tCoreGraphics::ShaderId shader = CoreGraphics::ShaderGet("shd:{}.gplb");\n'.format(p.shader)
                 func += '\t\tCoreGraphics::ShaderProgramId program = CoreGraphics::ShaderGetProgram({}, CoreGraphics::ShaderFeatureMask("{}"));\n'.format('shader', p.variation)
+                if p.instancedVariation is not None:
+                    func += '\t\tCoreGraphics::ShaderProgramId instancedProgram = CoreGraphics::ShaderGetProgram({}, CoreGraphics::ShaderFeatureMask("{}"));\n'.format('shader', p.instancedVariation)
+                else:
+                    func += '\t\tCoreGraphics::ShaderProgramId instancedProgram = CoreGraphics::InvalidShaderProgramId;\n'
                 func += '\t\tIndexT bufferSlot = InvalidIndex;\n'
                 func += '\t\tif (this->entry.bufferName != nullptr) bufferSlot = CoreGraphics::ShaderGetResourceSlot({}, this->entry.bufferName);\n'.format('shader')
-                func += '\t\tthis->__{} = Entry::Pass{{.shader = shader, .program = program, .index = {}, .name = "{}", .bufferIndex=bufferSlot }};\n'.format(p.batch, passCounter, p.batch)
+                func += '\t\tthis->__{} = Entry::Pass{{.shader = shader, .program = program, .instancedProgram = instancedProgram, .index = {}, .name = "{}", .bufferIndex=bufferSlot }};\n'.format(p.batch, passCounter, p.batch)
                 func += '\t\tthis->entry.passes.Add(MaterialTemplatesGPULang::BatchGroup::{}, &this->__{});\n'.format(p.batch, p.batch)
                 func += '\t\tthis->entry.texturesPerBatch[{}].Resize({});\n'.format(passCounter, numTextures)
                 texCounter = 0
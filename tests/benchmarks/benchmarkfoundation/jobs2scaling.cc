@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+//  jobs2scaling.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "jobs2scaling.h"
+#include "jobs2/jobs2.h"
+#include "system/systeminfo.h"
+#include "math/vec4.h"
+
+namespace Benchmarking
+{
+__ImplementClass(Benchmarking::Jobs2Scaling, 'J2SC', Benchmarking::Benchmark);
+
+using namespace Timing;
+
+struct ScalingContext
+{
+    Math::vec4* inout;
+    const Math::vec4* input;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+CrossJob(SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset, void* ctx)
+{
+    ScalingContext* context = static_cast<ScalingContext*>(ctx);
+    for (IndexT i = 0; i < groupSize; i++)
+    {
+        IndexT index = i + invocationOffset;
+        if (index >= totalJobs)
+            return;
+        context->inout[index] = Math::normalize(Math::cross3(context->inout[index], context->input[index]) + context->input[index]);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+Jobs2Scaling::Run(Timer& timer)
+{
+    const SizeT NumElements = 1000000;
+    const SizeT NumIterations = 20;
+    const SizeT NumSmallDispatches = 2000;
+
+    ScalingContext ctx;
+    Math::vec4* inout = new Math::vec4[NumElements];
+    Math::vec4* input = new Math::vec4[NumElements];
+    for (IndexT i = 0; i < NumElements; i++)
+    {
+        inout[i] = Math::vec4(1, 2, 3, 0);
+        input[i] = Math::vec4(3, 2, 1, 0);
+    }
+    ctx.inout = inout;
+    ctx.input = input;
+
+    Util::Array<SizeT> threadCounts;
+    for (SizeT numThreads = 1; numThreads < System::NumCpuCores; numThreads *= 2)
+        threadCounts.Append(numThreads);
+    threadCounts.Append(System::NumCpuCores);
+
+    Time wideBaseline = 0, chainBaseline = 0;
+    timer.Start();
+    for (SizeT numThreads : threadCounts)
+    {
+        Jobs2::JobSystemInitInfo info;
+        info.name = "Jobs2Scaling";
+        info.numThreads = numThreads;
+        info.scratchMemorySize = 16_MB;
+        info.enableProfiling = false;
+        Jobs2::JobSystemInit(info);
+
+        // Wide dispatches, four dependent passes over a large array
+        Timer wideTimer;
+        wideTimer.Start();
+        for (IndexT iteration = 0; iteration < NumIterations; iteration++)
+        {
+            Threading::AtomicCounter counters[3] = { 1, 1, 1 };
+            Threading::Event event;
+            Jobs2::JobDispatch(CrossJob, NumElements, 1024, ctx, nullptr, &counters[0]);
+            Jobs2::JobDispatch(CrossJob, NumElements, 1024, ctx, { &counters[0] }, &counters[1]);
+            Jobs2::JobDispatch(CrossJob, NumElements, 1024, ctx, { &counters[1] }, &counters[2]);
+            Jobs2::JobDispatch(CrossJob, NumElements, 1024, ctx, { &counters[2] }, nullptr, &event);
+            event.Wait();
+            Jobs2::JobNewFrame();
+        }
+        wideTimer.Stop();
+
+        // Many small dispatches in short dependency chains, measures scheduling overhead
+        Timer chainTimer;
+        chainTimer.Start();
+        for (IndexT iteration = 0; iteration < NumIterations; iteration++)
+        {
+            Threading::AtomicCounter* counters = Jobs2::JobAlloc<Threading::AtomicCounter>(NumSmallDispatches);
+            Threading::AtomicCounter doneCounter = NumSmallDispatches / 2;
+            Threading::Event event;
+            for (IndexT i = 0; i < NumSmallDispatches; i += 2)
+            {
+                counters[i] = 1;
+                Jobs2::JobDispatch(CrossJob, 256, 64, ctx, nullptr, &counters[i]);
+                Jobs2::JobDispatch(CrossJob, 256, 64, ctx, { &counters[i] }, &doneCounter, &event);
+            }
+            event.Wait();
+            Jobs2::JobNewFrame();
+        }
+        chainTimer.Stop();
+
+        Jobs2::JobSystemUninit();
+
+        if (numThreads == 1)
+        {
+            wideBaseline = wideTimer.GetTime();
+            chainBaseline = chainTimer.GetTime();
+        }
+        n_printf("%3d threads: wide %f s (%.2fx), small chains %f s (%.2fx)\n"
+            , numThreads
+            , wideTimer.GetTime(), wideBaseline / wideTimer.GetTime()
+            , chainTimer.GetTime(), chainBaseline / chainTimer.GetTime());
+    }
+    timer.Stop();
+
+    delete[] inout;
+    delete[] input;
+}
+
+} // namespace Benchmarking
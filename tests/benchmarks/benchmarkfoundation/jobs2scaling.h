@@ -0,0 +1,25 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Benchmarking::Jobs2Scaling
+
+    Measures how Jobs2 scales from a single job thread up to one thread per core,
+    both for wide data parallel dispatches and for many small dependent dispatches.
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "benchmarkbase/benchmark.h"
+
+//------------------------------------------------------------------------------
+namespace Benchmarking
+{
+class Jobs2Scaling : public Benchmark
+{
+    __DeclareClass(Jobs2Scaling);
+public:
+    /// run the benchmark
+    virtual void Run(Timing::Timer& timer);
+};
+
+} // namespace Benchmarking
+//------------------------------------------------------------------------------
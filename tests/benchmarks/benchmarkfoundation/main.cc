@@ -17,6 +17,7 @@
 #include "mempoolbenchmark.h"
 #include "containerbenchmark.h"
 #include "delegates.h"
+#include "jobs2scaling.h"
 
 using namespace Core;
 using namespace Benchmarking;
@@ -40,6 +41,7 @@ main(int argc, char** argv)
     runner->AttachBenchmark(CreateObjectsByClassName::Create());
     runner->AttachBenchmark(ContainerBench::Create());
     runner->AttachBenchmark(DelegateBench::Create());
+    runner->AttachBenchmark(Jobs2Scaling::Create());
     runner->Run();
     
     // shutdown Nebula runtime
@@ -0,0 +1,34 @@
+//------------------------------------------------------------------------------
+//  benchmarkgame/main.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "core/coreserver.h"
+#include "core/sysfunc.h"
+#include "benchmarkbase/benchmarkrunner.h"
+
+#include "processorchunk.h"
+
+using namespace Core;
+using namespace Benchmarking;
+
+int __cdecl
+main(int argc, char** argv)
+{
+    // create Nebula runtime
+    Ptr<CoreServer> coreServer = CoreServer::Create();
+    coreServer->SetAppName(Util::StringAtom("Nebula Game Benchmark Runner"));
+    coreServer->Open();
+
+    // setup and run benchmarks
+    Ptr<BenchmarkRunner> runner = BenchmarkRunner::Create();
+    runner->AttachBenchmark(ProcessorChunk::Create());
+    runner->Run();
+
+    // shutdown Nebula runtime
+    runner = nullptr;
+    coreServer->Close();
+    coreServer = nullptr;
+    SysFunc::Exit(0);
+    return 0;
+}
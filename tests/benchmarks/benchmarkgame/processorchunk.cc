@@ -0,0 +1,120 @@
+//------------------------------------------------------------------------------
+//  processorchunk.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "processorchunk.h"
+#include "game/processor.h"
+#include "basegamefeature/components/position.h"
+#include "basegamefeature/components/velocity.h"
+
+namespace Benchmarking
+{
+__ImplementClass(Benchmarking::ProcessorChunk, 'PRCH', Benchmarking::Benchmark);
+
+using namespace Timing;
+
+//------------------------------------------------------------------------------
+/**
+    Setup views the same way Game::Query does, one per partition
+*/
+static void
+SetupViews(Util::FixedArray<Game::Dataset::View>& views, Game::Position* positions, Game::Velocity* velocities, SizeT numInstances, SizeT partitionSize, SizeT holeFrequency)
+{
+    views.Resize((numInstances + partitionSize - 1) / partitionSize);
+    for (IndexT i = 0; i < views.Size(); i++)
+    {
+        Game::Dataset::View& view = views[i];
+        IndexT const offset = i * partitionSize;
+        view.numInstances = (uint16_t)Math::min(partitionSize, numInstances - offset);
+        view.buffers[0] = positions + offset;
+        view.buffers[1] = velocities + offset;
+        view.validInstances.Clear();
+        view.modifiedInstances.Clear();
+        for (IndexT instance = 0; instance < view.numInstances; instance++)
+        {
+            // Every holeFrequency instance is a deleted row
+            if (holeFrequency == 0 || (offset + instance) % holeFrequency != 0)
+                view.validInstances.SetBit(instance);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static Time
+RunCallback(std::function<void(Game::World*, Game::Dataset::View const&)> const& callback, Util::FixedArray<Game::Dataset::View> const& views, SizeT numIterations)
+{
+    Timer timer;
+    timer.Start();
+    for (IndexT iteration = 0; iteration < numIterations; iteration++)
+    {
+        for (Game::Dataset::View const& view : views)
+            callback(nullptr, view);
+    }
+    timer.Stop();
+    return timer.GetTime();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+ProcessorChunk::Run(Timer& timer)
+{
+    const SizeT NumInstances = 100000;
+    const SizeT PartitionSize = 256;
+    const SizeT NumIterations = 100;
+    const float DeltaTime = 1.0f / 60.0f;
+
+    Game::Position* positions = new Game::Position[NumInstances];
+    Game::Velocity* velocities = new Game::Velocity[NumInstances];
+    for (IndexT i = 0; i < NumInstances; i++)
+    {
+        positions[i] = Math::vec3(0);
+        velocities[i] = Math::vec3(1, 2, 3);
+    }
+
+    auto perInstance = Game::Processor::ForEach(std::function([DeltaTime](Game::World*, Game::Position& pos, Game::Velocity const& vel)
+    {
+        pos = pos + vel * DeltaTime;
+    }), 0);
+
+    auto perChunk = Game::Processor::ForEachChunk(std::function([DeltaTime](Game::World*, Game::ProcessorChunk const& chunk, Game::Position* pos, Game::Velocity const* vel)
+    {
+        if (chunk.IsFull())
+        {
+            for (IndexT i = 0; i < chunk.numInstances; i++)
+                pos[i] = pos[i] + vel[i] * DeltaTime;
+        }
+        else
+        {
+            chunk.ForEachValid([pos, vel, DeltaTime](uint i)
+            {
+                pos[i] = pos[i] + vel[i] * DeltaTime;
+            });
+        }
+    }), 0);
+
+    timer.Start();
+    Util::FixedArray<Game::Dataset::View> views;
+    
+    // All instances valid, this is where the chunked fast path applies
+    SetupViews(views, positions, velocities, NumInstances, PartitionSize, 0);
+    Time fullInstance = RunCallback(perInstance, views, NumIterations);
+    Time fullChunk = RunCallback(perChunk, views, NumIterations);
+    n_printf("full tables:   per instance %f s, chunked %f s (%.2fx)\n", fullInstance, fullChunk, fullInstance / fullChunk);
+
+    // Some deleted instances, forces the masked path
+    SetupViews(views, positions, velocities, NumInstances, PartitionSize, 7);
+    Time sparseInstance = RunCallback(perInstance, views, NumIterations);
+    Time sparseChunk = RunCallback(perChunk, views, NumIterations);
+    n_printf("sparse tables: per instance %f s, chunked %f s (%.2fx)\n", sparseInstance, sparseChunk, sparseInstance / sparseChunk);
+    timer.Stop();
+
+    delete[] positions;
+    delete[] velocities;
+}
+
+} // namespace Benchmarking
@@ -0,0 +1,26 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Benchmarking::ProcessorChunk
+
+    Compares per instance processor callbacks against chunked processor
+    callbacks, integrating velocities into positions on fully and sparsely
+    populated table partitions.
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "benchmarkbase/benchmark.h"
+
+//------------------------------------------------------------------------------
+namespace Benchmarking
+{
+class ProcessorChunk : public Benchmark
+{
+    __DeclareClass(ProcessorChunk);
+public:
+    /// run the benchmark
+    virtual void Run(Timing::Timer& timer);
+};
+
+} // namespace Benchmarking
+//------------------------------------------------------------------------------
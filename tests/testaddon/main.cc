@@ -13,6 +13,7 @@
 #include "databasetest.h"
 #include "datasettest.h"
 #include "dbattrs.h"
+#include "snapshotreplicationtest.h"
 
 using namespace Core;
 using namespace Test;
@@ -32,6 +33,7 @@ __cdecl main()
     Ptr<TestRunner> testRunner = TestRunner::Create();
     testRunner->AttachTestCase(DatabaseTest::Create());
     testRunner->AttachTestCase(DatasetTest::Create());
+    testRunner->AttachTestCase(SnapshotReplicationTest::Create());
     bool result = testRunner->Run();
 
     coreServer->Close();
@@ -0,0 +1,242 @@
+//------------------------------------------------------------------------------
+//  snapshotreplicationtest.cc
+//  (C) 2025 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "snapshotreplicationtest.h"
+#include "multiplayer/server/snapshotreplicator.h"
+#include "multiplayer/client/snapshotreceiver.h"
+#include "multiplayer/snapshot/bitstream.h"
+#include "timing/timer.h"
+#include "util/fixedarray.h"
+
+namespace Test
+{
+__ImplementClass(Test::SnapshotReplicationTest, 'SNRT', Test::TestCase);
+
+using namespace Multiplayer;
+using namespace Util;
+
+static const SizeT NumEntities = 500;
+static const SizeT NumClients = 64;
+static const SizeT NumTicks = 100;
+static const float WorldSize = 1000.0f;
+static const float TickInterval = 1.0f / 8.0f;
+
+//------------------------------------------------------------------------------
+/**
+*/
+static float
+Random(uint& seed)
+{
+    seed = seed * 1103515245 + 12345;
+    return float((seed >> 8) & 0xFFFF) / 65535.0f;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Checks a client's latest snapshot against the entities it should see,
+    which are computed with a brute force distance check.
+*/
+static bool
+MatchesWorld(Snapshot const& snapshot, Array<SnapshotEntityState> const& world, bool hasView, Math::vec3 const& view, float radius)
+{
+    IndexT s = 0;
+    for (IndexT i = 0; i < world.Size(); i++)
+    {
+        if (hasView)
+        {
+            Math::vec3 pos = GetSnapshotPosition(world[i]);
+            float dx = pos.x - view.x;
+            float dz = pos.z - view.z;
+            if (dx * dx + dz * dz > radius * radius)
+            {
+                continue;
+            }
+        }
+        if (s == snapshot.entities.Size() || !SnapshotStatesEqual(snapshot.entities[s], world[i]))
+        {
+            return false;
+        }
+        s++;
+    }
+    return s == snapshot.entities.Size();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+SnapshotReplicationTest::Run()
+{
+    // variable length values round trip
+    Array<ubyte> buffer;
+    BitWriter writer(buffer);
+    static const int values[] = { 0, 1, -1, 7, -8, 511, -512, 131071, -131072, 0x7FFFFFFF, int(0x80000000) };
+    for (int value : values)
+    {
+        writer.WriteVarInt(value);
+        writer.WriteBool(true);
+    }
+    writer.Flush();
+    BitReader reader(buffer.Begin(), buffer.Size());
+    bool same = true;
+    for (int value : values)
+    {
+        same &= reader.ReadVarInt() == value && reader.ReadBool();
+    }
+    VERIFY(same && !reader.HasOverflowed());
+    reader.Read(32);
+    VERIFY(reader.HasOverflowed());
+
+    // a third of the entities stand still, the others move in straight lines
+    uint seed = 1234;
+    Array<Math::vec3> positions(NumEntities, 0);
+    Array<Math::vec3> velocities(NumEntities, 0);
+    IndexT i;
+    for (i = 0; i < NumEntities; i++)
+    {
+        positions.Append(Math::vec3(Random(seed) * WorldSize, 0.0f, Random(seed) * WorldSize));
+        velocities.Append(i % 3 == 0 ? Math::vec3(0.0f) : Math::vec3(Random(seed) * 8.0f - 4.0f, 0.0f, Random(seed) * 8.0f - 4.0f));
+    }
+
+    // every eighth client sees the whole world, the others follow an entity
+    SnapshotReplicator replicator;
+    replicator.SetRelevanceRadius(150.0f);
+    FixedArray<SnapshotReceiver> receivers(NumClients);
+    FixedArray<uint> pendingAcks(NumClients, 0);
+    for (i = 0; i < NumClients; i++)
+    {
+        replicator.AddClient(i + 1);
+    }
+    VERIFY(replicator.GetNumClients() == NumClients);
+
+    Timing::Timer timer;
+    SizeT totalBytes = 0;
+    SizeT fullSnapshotBytes = 0;
+    SizeT numReceived = 0;
+    bool allMatch = true;
+    Array<SnapshotEntityState> world;
+    for (uint64_t tick = 1; tick <= NumTicks; tick++)
+    {
+        for (i = 0; i < NumEntities; i++)
+        {
+            positions[i] += velocities[i] * TickInterval;
+        }
+        for (i = 0; i < NumClients; i++)
+        {
+            if (i % 8 != 0)
+            {
+                replicator.SetClientViewPosition(i + 1, positions[i * 7]);
+            }
+        }
+
+        // acknowledgements take a tick to arrive
+        for (i = 0; i < NumClients; i++)
+        {
+            if (pendingAcks[i] != 0)
+            {
+                replicator.AcknowledgeSnapshot(i + 1, pendingAcks[i]);
+                pendingAcks[i] = 0;
+            }
+        }
+
+        timer.Start();
+        replicator.BeginTick(tick);
+        for (i = NumEntities - 1; i >= 0; i--)
+        {
+            replicator.SetEntityState(i * 3 + 1, positions[i], velocities[i]);
+        }
+        replicator.BuildSnapshots();
+        timer.Stop();
+
+        world.Clear();
+        for (i = 0; i < NumEntities; i++)
+        {
+            world.Append(QuantizeEntityState(i * 3 + 1, positions[i], velocities[i]));
+        }
+
+        // every other client loses every tenth packet
+        for (i = 0; i < NumClients; i++)
+        {
+            n_assert(replicator.GetClientId(i) == uint(i + 1));
+            Array<ubyte> const& message = replicator.GetClientMessage(i);
+            totalBytes += message.Size();
+            if (i % 2 == 1 && (tick + i) % 10 == 0)
+            {
+                continue;
+            }
+            if (receivers[i].Receive(message.Begin(), message.Size()))
+            {
+                numReceived++;
+                pendingAcks[i] = receivers[i].GetLatestSequence();
+                bool const hasView = i % 8 != 0;
+                Math::vec3 view = hasView ? positions[i * 7] : Math::vec3(0.0f);
+                allMatch &= MatchesWorld(receivers[i].GetLatestSnapshot(), world, hasView, view, replicator.GetRelevanceRadius());
+            }
+        }
+
+        Snapshot full;
+        full.sequence = 1;
+        full.tick = tick;
+        full.entities = world;
+        BitWriter fullWriter(buffer);
+        EncodeSnapshot(full, nullptr, fullWriter);
+        fullSnapshotBytes += buffer.Size();
+    }
+    VERIFY(allMatch);
+    VERIFY(numReceived > NumTicks * NumClients * 9 / 10);
+
+    // nothing moves, so the deltas are just headers
+    for (i = 0; i < NumClients; i++)
+    {
+        replicator.AcknowledgeSnapshot(i + 1, receivers[i].GetLatestSequence());
+    }
+    replicator.BeginTick(NumTicks + 1);
+    for (i = 0; i < NumEntities; i++)
+    {
+        replicator.SetEntityState(i * 3 + 1, positions[i], Math::vec3(0.0f));
+    }
+    replicator.BuildSnapshots();
+    bool received = true;
+    for (i = 0; i < NumClients; i++)
+    {
+        Array<ubyte> const& message = replicator.GetClientMessage(i);
+        received &= receivers[i].Receive(message.Begin(), message.Size());
+        replicator.AcknowledgeSnapshot(i + 1, receivers[i].GetLatestSequence());
+    }
+    VERIFY(received);
+    replicator.BeginTick(NumTicks + 2);
+    for (i = 0; i < NumEntities; i++)
+    {
+        replicator.SetEntityState(i * 3 + 1, positions[i], Math::vec3(0.0f));
+    }
+    replicator.BuildSnapshots();
+    SizeT idleBytes = 0;
+    for (i = 0; i < NumClients; i++)
+    {
+        idleBytes += replicator.GetClientMessage(i).Size();
+        received &= receivers[i].Receive(replicator.GetClientMessage(i).Begin(), replicator.GetClientMessage(i).Size());
+        received &= receivers[i].GetChangedEntities().IsEmpty();
+    }
+    VERIFY(received);
+    VERIFY(idleBytes <= NumClients * 20);
+
+    // malformed and outdated messages are rejected
+    Array<ubyte> const& message = replicator.GetClientMessage(0);
+    VERIFY(!receivers[0].Receive(message.Begin(), message.Size()));
+    VERIFY(!receivers[1].Receive(message.Begin(), 3));
+
+    // acknowledgements of clients that are gone are ignored
+    replicator.AcknowledgeSnapshot(NumClients + 1, 0);
+    replicator.SetClientViewPosition(NumClients + 1, Math::vec3(0.0f));
+    replicator.ClearClientViewPosition(NumClients + 1);
+    VERIFY(replicator.GetNumClients() == NumClients);
+
+    n_printf("Snapshot replication, %d entities, %d clients:\n", NumEntities, NumClients);
+    n_printf("    %.1f bytes per tick, %.1f bytes per client and tick\n", float(totalBytes) / NumTicks, float(totalBytes) / (NumTicks * NumClients));
+    n_printf("    %.1f bytes per tick sending full snapshots of all entities\n", float(fullSnapshotBytes) * NumClients / NumTicks);
+    n_printf("    %.3f ms server time per tick\n", timer.GetTime() * 1000.0 / NumTicks);
+}
+
+} // namespace Test
@@ -0,0 +1,26 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Test::SnapshotReplicationTest
+
+    Loopback test of the multiplayer snapshot replication. A server
+    replicates moving entities to simulated clients, some of which lose
+    packets, and reports the bytes and server time per tick.
+
+    (C) 2025 Individual contributors, see AUTHORS file
+*/
+#include "testbase/testcase.h"
+
+//------------------------------------------------------------------------------
+namespace Test
+{
+class SnapshotReplicationTest : public TestCase
+{
+    __DeclareClass(SnapshotReplicationTest);
+public:
+    /// run the test
+    virtual void Run();
+};
+
+}; // namespace Test
+//------------------------------------------------------------------------------
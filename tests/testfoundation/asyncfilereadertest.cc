@@ -0,0 +1,106 @@
+//------------------------------------------------------------------------------
+//  asyncfilereadertest.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "asyncfilereadertest.h"
+#include "io/ioserver.h"
+#include "io/asyncfilereader.h"
+#include "io/fswrapper.h"
+#include "core/sysfunc.h"
+
+namespace Test
+{
+__ImplementClass(Test::AsyncFileReaderTest, 'ASRT', Test::TestCase);
+
+using namespace IO;
+
+static const SizeT FileSize = 1 << 20;
+static const SizeT NumReads = 300;
+
+//------------------------------------------------------------------------------
+/**
+*/
+static bool
+WaitForReads(Threading::AtomicCounter& counter)
+{
+    for (IndexT i = 0; i < 5000 && counter > 0; i++)
+    {
+        Core::SysFunc::Sleep(0.001);
+    }
+    return counter == 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AsyncFileReaderTest::Run()
+{
+    Ptr<IoServer> ioServer = IoServer::Create();
+
+    Util::FixedArray<uchar> data(FileSize);
+    for (IndexT i = 0; i < FileSize; i++)
+    {
+        data[i] = (uchar)(i * 31 + (i >> 8));
+    }
+    URI uri("temp:asyncfilereadertest.bin");
+    ioServer->EnsureDirectoriesForFile(uri);
+    Ptr<Stream> stream = ioServer->CreateStream(uri);
+    stream->SetAccessMode(Stream::WriteAccess);
+    VERIFY(stream->Open());
+    stream->Write(data.Begin(), FileSize);
+    stream->Close();
+
+    // more reads than the queue depth at once, so some of them have to wait for a slot
+    FSWrapper::Handle handle = FSWrapper::OpenFile(uri.GetHostAndLocalPath(), Stream::ReadAccess, Stream::Random);
+    VERIFY(handle != nullptr);
+    Util::FixedArray<uchar> result(FileSize, 0);
+    Threading::AtomicCounter counter = NumReads;
+    Threading::AtomicCounter numFailed = 0;
+    Util::Array<AsyncRead> reads;
+    SizeT const readSize = FileSize / NumReads;
+    for (IndexT i = 0; i < NumReads; i++)
+    {
+        AsyncRead read;
+        read.file = handle;
+        read.offset = i * readSize;
+        read.size = readSize;
+        read.buffer = result.Begin() + i * readSize;
+        read.counter = &counter;
+        read.callback = [&numFailed, readSize](Stream::Size bytesRead)
+        {
+            if (bytesRead != readSize)
+                Threading::Interlocked::Increment(&numFailed);
+        };
+        reads.Append(read);
+    }
+    ioServer->ReadAsync(reads.Begin(), reads.Size());
+
+    // the reader is created by the first asynchronous read
+    VERIFY(AsyncFileReader::HasInstance());
+    n_printf("AsyncFileReader uses io_uring: %s\n", AsyncFileReader::Instance()->IsUsingIoUring() ? "yes" : "no");
+    VERIFY(WaitForReads(counter));
+    VERIFY(numFailed == 0);
+    VERIFY(memcmp(result.Begin(), data.Begin(), NumReads * readSize) == 0);
+    FSWrapper::CloseFile(handle);
+
+    // whole file reads into memory streams
+    Ptr<Stream> loaded;
+    counter = 1;
+    ioServer->ReadFileAsync(uri, [&loaded](const Ptr<Stream>& stream) { loaded = stream; }, &counter);
+    VERIFY(WaitForReads(counter));
+    VERIFY(loaded.isvalid());
+    if (loaded.isvalid())
+    {
+        loaded->SetAccessMode(Stream::ReadAccess);
+        VERIFY(loaded->Open());
+        VERIFY(loaded->GetSize() == FileSize);
+        VERIFY(memcmp(loaded->Map(), data.Begin(), FileSize) == 0);
+        loaded->Close();
+    }
+
+    ioServer->DeleteFile(uri);
+}
+
+} // namespace Test
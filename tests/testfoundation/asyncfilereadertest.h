@@ -0,0 +1,24 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Test::AsyncFileReaderTest
+
+    Tests asynchronous file reads through the IoServer.
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "testbase/testcase.h"
+
+//------------------------------------------------------------------------------
+namespace Test
+{
+class AsyncFileReaderTest : public TestCase
+{
+    __DeclareClass(AsyncFileReaderTest);
+public:
+    /// run the test
+    virtual void Run();
+};
+
+}; // namespace Test
+//------------------------------------------------------------------------------
@@ -55,6 +55,9 @@
 #include "bxmlreadertest.h"
 #include "blobtest.h"
 #include "profilingtest.h"
+#include "asyncfilereadertest.h"
+#include "processtest.h"
+#include "packarchivetest.h"
 #include "bitfieldtest.h"
 #include "cvartest.h"
 
@@ -129,6 +132,9 @@ __cdecl main()
     testRunner->AttachTestCase(ThreadTest::Create());
     testRunner->AttachTestCase(ArrayAllocatorTest::Create());
     testRunner->AttachTestCase(ProfilingTest::Create());
+    testRunner->AttachTestCase(AsyncFileReaderTest::Create());
+    testRunner->AttachTestCase(ProcessTest::Create());
+    testRunner->AttachTestCase(PackArchiveTest::Create());
     bool result = testRunner->Run(); 
 
     gameContentServer->Discard();
@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------
+//  packarchivetest.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "packarchivetest.h"
+#include "io/ioserver.h"
+#include "io/packfs/packarchivewriter.h"
+#include "io/packfs/packformat.h"
+#include "timing/timer.h"
+
+namespace Test
+{
+__ImplementClass(Test::PackArchiveTest, 'PKTS', Test::TestCase);
+
+using namespace IO;
+using namespace Util;
+
+static const SizeT TextSize = 5 * PackBlockSize + 1234;
+static const SizeT NoiseSize = 3 * PackBlockSize + 17;
+static const SizeT NumLookups = 100000;
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+WriteTestFile(const URI& uri, const FixedArray<uchar>& data)
+{
+    IoServer::Instance()->EnsureDirectoriesForFile(uri);
+    Ptr<Stream> stream = IoServer::Instance()->CreateStream(uri);
+    stream->SetAccessMode(Stream::WriteAccess);
+    if (stream->Open())
+    {
+        if (data.Size() > 0)
+        {
+            stream->Write(data.Begin(), data.Size());
+        }
+        stream->Close();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+PackArchiveTest::Run()
+{
+    Ptr<IoServer> ioServer = IoServer::Create();
+
+    // text compresses well and is split into blocks, noise is stored as is
+    FixedArray<uchar> text(TextSize);
+    for (IndexT i = 0; i < TextSize; i++)
+    {
+        text[i] = (uchar)('a' + (i / 7 + i % 13) % 26);
+    }
+    FixedArray<uchar> noise(NoiseSize);
+    uint seed = 12345;
+    for (IndexT i = 0; i < NoiseSize; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        noise[i] = (uchar)(seed >> 16);
+    }
+    FixedArray<uchar> empty;
+    WriteTestFile("temp:packtestsrc/text.txt", text);
+    WriteTestFile("temp:packtestsrc/noise.bin", noise);
+    WriteTestFile("temp:packtestsrc/empty.bin", empty);
+
+    Ptr<PackArchiveWriter> writer = PackArchiveWriter::Create();
+    writer->AddFile("packtest/data/text.txt", "temp:packtestsrc/text.txt");
+    writer->AddFile("packtest/data/noise.bin", "temp:packtestsrc/noise.bin");
+    writer->AddFile("packtest/data/sub/empty.bin", "temp:packtestsrc/empty.bin");
+    writer->AddFile("packtest/data/sub/deeper/text.txt", "temp:packtestsrc/text.txt");
+    VERIFY(writer->Write("temp:packtest.npk"));
+
+    VERIFY(ioServer->MountArchive("temp:packtest"));
+    VERIFY(ioServer->FileExists("temp:packtest/data/text.txt"));
+    VERIFY(ioServer->FileExists("temp:packtest/data/sub/deeper/text.txt"));
+    VERIFY(!ioServer->FileExists("temp:packtest/data/missing.txt"));
+    VERIFY(ioServer->DirectoryExists("temp:packtest/data/sub"));
+
+    Array<String> files = ioServer->ListFiles("temp:packtest/data", "*");
+    VERIFY(files.Size() == 2);
+    VERIFY(InvalidIndex != files.FindIndex("text.txt"));
+    VERIFY(InvalidIndex != files.FindIndex("noise.bin"));
+    Array<String> dirs = ioServer->ListDirectories("temp:packtest/data", "*");
+    VERIFY(dirs.Size() == 1 && dirs[0] == "sub");
+
+    // whole compressed file, and a range across a block boundary
+    Ptr<Stream> stream = ioServer->CreateStream("temp:packtest/data/sub/deeper/text.txt");
+    VERIFY(stream->GetURI().Scheme() == "pak");
+    stream->SetAccessMode(Stream::ReadAccess);
+    VERIFY(stream->Open());
+    if (stream->IsOpen())
+    {
+        VERIFY(stream->GetSize() == TextSize);
+        FixedArray<uchar> result(TextSize, 0);
+        VERIFY(stream->Read(result.Begin(), TextSize) == TextSize);
+        VERIFY(memcmp(result.Begin(), text.Begin(), TextSize) == 0);
+
+        Stream::Position const start = 2 * PackBlockSize - 100;
+        stream->Seek(start, Stream::Begin);
+        VERIFY(stream->Read(result.Begin(), 300) == 300);
+        VERIFY(memcmp(result.Begin(), text.Begin() + start, 300) == 0);
+
+        // small sequential reads
+        stream->Seek(10, Stream::Begin);
+        bool same = true;
+        for (IndexT i = 10; i < TextSize; i += 1000)
+        {
+            SizeT const size = Math::min(1000, TextSize - i);
+            same &= stream->Read(result.Begin(), size) == size && memcmp(result.Begin(), text.Begin() + i, size) == 0;
+        }
+        VERIFY(same);
+        VERIFY(stream->Eof());
+
+        stream->Seek(0, Stream::Begin);
+        VERIFY(memcmp(stream->Map(), text.Begin(), TextSize) == 0);
+        stream->Unmap();
+        stream->Close();
+    }
+
+    // files stored as is are mapped straight from the pack file
+    stream = ioServer->CreateStream("temp:packtest/data/noise.bin");
+    stream->SetAccessMode(Stream::ReadAccess);
+    VERIFY(stream->Open());
+    if (stream->IsOpen())
+    {
+        VERIFY(stream->GetSize() == NoiseSize);
+        const void* mapped = stream->Map();
+        VERIFY(((uintptr_t)mapped % PackRawAlignment) == 0);
+        VERIFY(memcmp(mapped, noise.Begin(), NoiseSize) == 0);
+        stream->Unmap();
+        stream->Close();
+    }
+
+    stream = ioServer->CreateStream("temp:packtest/data/sub/empty.bin");
+    stream->SetAccessMode(Stream::ReadAccess);
+    VERIFY(stream->Open());
+    if (stream->IsOpen())
+    {
+        VERIFY(stream->GetSize() == 0);
+        VERIFY(stream->Eof());
+        stream->Close();
+    }
+
+    Timing::Timer timer;
+    timer.Start();
+    SizeT found = 0;
+    for (IndexT i = 0; i < NumLookups; i++)
+    {
+        found += ioServer->FileExists("temp:packtest/data/sub/deeper/text.txt") ? 1 : 0;
+    }
+    timer.Stop();
+    VERIFY(found == NumLookups);
+    n_printf("Pack file lookups: %.3f us per lookup\n", timer.GetTime() * 1000000.0 / NumLookups);
+
+    ioServer->UnmountArchive("temp:packtest");
+    ioServer->DeleteFile("temp:packtest.npk");
+    ioServer->DeleteFile("temp:packtestsrc/text.txt");
+    ioServer->DeleteFile("temp:packtestsrc/noise.bin");
+    ioServer->DeleteFile("temp:packtestsrc/empty.bin");
+    ioServer->DeleteDirectory("temp:packtestsrc");
+}
+
+} // namespace Test
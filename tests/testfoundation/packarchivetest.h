@@ -0,0 +1,25 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Test::PackArchiveTest
+
+    Writes a Nebula pack file, mounts it and reads files back through
+    the IoServer.
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "testbase/testcase.h"
+
+//------------------------------------------------------------------------------
+namespace Test
+{
+class PackArchiveTest : public TestCase
+{
+    __DeclareClass(PackArchiveTest);
+public:
+    /// run the test
+    virtual void Run();
+};
+
+}; // namespace Test
+//------------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+//  processtest.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "processtest.h"
+#include "system/process.h"
+#include "io/memorystream.h"
+#include "core/sysfunc.h"
+
+namespace Test
+{
+__ImplementClass(Test::ProcessTest, 'PRCT', Test::TestCase);
+
+using namespace IO;
+using namespace Util;
+
+static const SizeT NumProcesses = 8;
+
+//------------------------------------------------------------------------------
+/**
+*/
+static String
+GetContents(const Ptr<MemoryStream>& stream)
+{
+    if (stream->GetSize() == 0)
+    {
+        return String();
+    }
+    return String((const char*)stream->GetRawPointer(), (SizeT)stream->GetSize());
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+ProcessTest::Run()
+{
+#if __linux__
+    // both streams captured, with more output than a pipe holds, so they have to be read while the child runs
+    System::Process process;
+    Ptr<MemoryStream> out = MemoryStream::Create();
+    Ptr<MemoryStream> err = MemoryStream::Create();
+    process.SetExecutable(URI("/bin/sh"));
+    process.SetArguments("-c \"echo hello; head -c 300000 /dev/zero 1>&2; head -c 200000 /dev/zero\"");
+    process.SetStdoutCaptureStream(out.upcast<Stream>());
+    process.SetStderrCaptureStream(err.upcast<Stream>());
+    VERIFY(process.LaunchWait());
+    VERIFY(out->GetSize() == 200006);
+    VERIFY(err->GetSize() == 300000);
+    VERIFY(GetContents(out).ExtractRange(0, 6) == "hello\n");
+
+    // several processes at once, polled like the shader batcher does
+    System::Process processes[NumProcesses];
+    Ptr<MemoryStream> outputs[NumProcesses];
+    IndexT i;
+    for (i = 0; i < NumProcesses; i++)
+    {
+        outputs[i] = MemoryStream::Create();
+        processes[i].SetExecutable(URI("/bin/sh"));
+        processes[i].SetArguments(String::Sprintf("-c \"sleep 0.%d; echo process%d\"", NumProcesses - i, i));
+        processes[i].SetStdoutCaptureStream(outputs[i].upcast<Stream>());
+        VERIFY(processes[i].Launch());
+    }
+    SizeT numRunning = NumProcesses;
+    for (IndexT wait = 0; wait < 1000 && numRunning > 0; wait++)
+    {
+        Core::SysFunc::Sleep(0.01);
+        numRunning = 0;
+        for (i = 0; i < NumProcesses; i++)
+        {
+            numRunning += processes[i].IsRunning() ? 1 : 0;
+        }
+    }
+    VERIFY(numRunning == 0);
+    for (i = 0; i < NumProcesses; i++)
+    {
+        VERIFY(GetContents(outputs[i]) == String::Sprintf("process%d\n", i));
+    }
+
+    // the working directory is set for the child
+    System::Process pwd;
+    Ptr<MemoryStream> dir = MemoryStream::Create();
+    pwd.SetExecutable(URI("/bin/pwd"));
+    pwd.SetWorkingDirectory(URI("file:////tmp"));
+    pwd.SetStdoutCaptureStream(dir.upcast<Stream>());
+    VERIFY(pwd.LaunchWait());
+    VERIFY(GetContents(dir) == "/tmp\n");
+
+    // a missing executable only ends the child
+    System::Process missing;
+    missing.SetExecutable(URI("/nonexistent/process"));
+    VERIFY(missing.Launch());
+    for (IndexT wait = 0; wait < 1000 && missing.IsRunning(); wait++)
+    {
+        Core::SysFunc::Sleep(0.001);
+    }
+    VERIFY(!missing.IsRunning());
+#endif
+}
+
+} // namespace Test
@@ -0,0 +1,24 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class Test::ProcessTest
+
+    Tests launching external processes with captured output.
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "testbase/testcase.h"
+
+//------------------------------------------------------------------------------
+namespace Test
+{
+class ProcessTest : public TestCase
+{
+    __DeclareClass(ProcessTest);
+public:
+    /// run the test
+    virtual void Run();
+};
+
+}; // namespace Test
+//------------------------------------------------------------------------------
@@ -7,6 +7,7 @@
 #include "core/ptr.h"
 #include "profiling/profiling.h"
 #include "threading/thread.h"
+#include "io/ioserver.h"
 #include <functional>
 
 namespace Test
@@ -31,6 +32,10 @@ public:
 
 __ImplementClass(ProfilingThread, 'PRFT', Threading::Thread);
 
+N_DECLARE_COUNTER(N_PROFILING_TEST_COUNTER, Profiling Test Counter);
+N_DECLARE_HISTOGRAM(N_PROFILING_TEST_HISTOGRAM, Profiling Test Histogram);
+static const SizeT NumCounterIncrements = 1000;
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -52,6 +57,14 @@ ProfilingTest::Run()
 {
     auto fn = []()
     {
+        // counters and histograms are summed up over all threads
+        for (IndexT i = 0; i < NumCounterIncrements; i++)
+        {
+            N_COUNTER_INCR(N_PROFILING_TEST_COUNTER, 2);
+            N_HISTOGRAM_ADD(N_PROFILING_TEST_HISTOGRAM, i);
+        }
+        N_COUNTER_DECR(N_PROFILING_TEST_COUNTER, NumCounterIncrements);
+
         {
             N_SCOPE(OneSecond, test);
             Core::SysFunc::Sleep(1);
@@ -93,6 +106,9 @@ ProfilingTest::Run()
         }
     };
 
+    // stream the events of both threads to a trace file
+    VERIFY(ProfilingStartCapture("temp:profilingtest.json"));
+
     // start a thread, and generate scopes on that thread
     Ptr<ProfilingThread> thread = ProfilingThread::Create();
     thread->fn = fn;
@@ -129,6 +145,34 @@ ProfilingTest::Run()
             RecursivePrintScopes(ctx.topLevelScopes[j], 0);
         }
     }
+
+    // both threads added to the counter and histogram
+    VERIFY(ProfilingGetCounters()[N_PROFILING_TEST_COUNTER.name] == 2 * NumCounterIncrements);
+    bool foundHistogram = false;
+    for (const ProfilingHistogram& histogram : ProfilingGetHistograms())
+    {
+        if (histogram.name != N_PROFILING_TEST_HISTOGRAM.name)
+            continue;
+        foundHistogram = true;
+        VERIFY(histogram.count == 2 * NumCounterIncrements);
+        VERIFY(histogram.sum == NumCounterIncrements * (NumCounterIncrements - 1));
+        VERIFY(histogram.buckets[0] == 2);
+        VERIFY(histogram.buckets[1] == 2);
+        VERIFY(histogram.buckets[2] == 4);
+        VERIFY(histogram.buckets[10] == 2 * (NumCounterIncrements - 512));
+    }
+    VERIFY(foundHistogram);
+
+    // the capture holds the begin and end events of all scopes
+    ProfilingStopCapture();
+    Util::String trace;
+    VERIFY(IO::IoServer::ReadFile("temp:profilingtest.json", trace));
+    VERIFY(trace.BeginsWithString("["));
+    VERIFY(trace.EndsWithString("]\n"));
+    VERIFY(trace.FindStringIndex("\"name\":\"ProfilingThread\"") != InvalidIndex);
+    VERIFY(trace.FindStringIndex("\"name\":\"TwoSecondsInterval\",\"cat\":\"test\"") != InvalidIndex);
+    VERIFY(trace.FindStringIndex("\"ph\":\"E\"") != InvalidIndex);
+    IO::IoServer::Instance()->DeleteFile("temp:profilingtest.json");
 }
 
 }; // namespace Test
@@ -269,6 +269,44 @@ DatabaseTest::Run()
         // note that the table id is the same for both databases in this case, but doesn't have to be if the original table has deleted tables
         VERIFY(dbCopy->GetTable(table0).GetNumRows() == db->GetTable(table0).GetNumRows());
         VERIFY(dbCopy->GetTable(table0).GetAttributes().Size() == db->GetTable(table0).GetAttributes().Size());
+
+        // Test persistent queries
+        {
+            TableSignature const inclusive = TableSignature({TestIntId});
+            TableSignature const exclusive;
+            Util::Array<TableId> const& tids = db->CachedQuery(inclusive, exclusive);
+            VERIFY(tids.Size() == 3);
+            VERIFY(&db->CachedQuery(TableSignature({TestIntId}), TableSignature()) == &tids);
+
+            TableCreateInfo info;
+            info.name = "Table4";
+            AttributeId const cids[] = {TestIntId};
+            info.attributeIds = cids;
+            info.numAttributes = sizeof(cids) / sizeof(AttributeId);
+            TableId const table4 = db->CreateTable(info);
+            VERIFY(tids.Size() == 4);
+            VERIFY(tids.FindIndex(table4) != InvalidIndex);
+
+            // the partitions are only collected again when a table activates or recycles one
+            Database::QueryCache const& query = db->CachedPartitionQuery(inclusive, exclusive);
+            uint32_t const version = query.version;
+            SizeT const numPartitions = query.partitions.Size();
+            VERIFY(db->CachedPartitionQuery(inclusive, exclusive).version == version);
+
+            db->GetTable(table4).AddRow();
+            VERIFY(&db->CachedPartitionQuery(inclusive, exclusive) == &query);
+            VERIFY(query.version != version);
+            VERIFY(query.partitions.Size() == numPartitions + 1);
+            bool found = false;
+            for (Database::QueryCache::ActivePartition const& active : query.partitions)
+                found |= active.table == table4 && active.partition == db->GetTable(table4).GetFirstActivePartition();
+            VERIFY(found);
+
+            db->DeleteTable(table4);
+            VERIFY(tids.Size() == 3);
+            VERIFY(tids.FindIndex(table4) == InvalidIndex);
+            VERIFY(db->CachedPartitionQuery(inclusive, exclusive).partitions.Size() == numPartitions);
+        }
     }
 
     // Test table signatures
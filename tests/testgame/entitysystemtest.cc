@@ -401,6 +401,62 @@ EntitySystemTest::Run()
 
         VERIFY(world->GetComponent<TestResource>(entity).resource == "foobar.res"_atm);
     }
+
+    // Test bulk migration, entities moving between the same tables in a frame are migrated together
+    {
+        const SizeT numMigrated = 64;
+        Util::Array<Entity> migrated;
+        for (IndexT i = 0; i < numMigrated; i++)
+        {
+            Entity entity = world->CreateEntity({ .templateId = enemyBlueprint, .immediate = true });
+            Game::Position pos = vec3((float)i, 1, 2);
+            world->SetComponent(entity, pos);
+            migrated.Append(entity);
+        }
+
+        // one entity takes the single entity path to another table
+        Entity single = world->CreateEntity({ .templateId = enemyBlueprint, .immediate = true });
+        Game::Position singlePos = vec3(-1, -2, -3);
+        world->SetComponent(single, singlePos);
+
+        MemDb::TableId const fromTable = world->GetEntityMapping(migrated[0]).table;
+        SizeT const numRowsBefore = world->GetDatabase()->GetTable(fromTable).GetNumRows();
+
+        // delete every other entity, so the migrated rows are not contiguous
+        for (IndexT i = 0; i < numMigrated; i += 2)
+        {
+            world->DeleteEntity(migrated[i]);
+        }
+        StepFrame();
+
+        for (IndexT i = 1; i < numMigrated; i += 2)
+        {
+            world->AddComponent<TestVec4>(migrated[i]);
+        }
+        world->AddComponent<TestResource>(single);
+        StepFrame();
+
+        MemDb::TableId const toTable = world->GetEntityMapping(migrated[1]).table;
+        VERIFY(toTable != fromTable);
+        VERIFY(world->GetDatabase()->GetTable(fromTable).GetNumRows() == numRowsBefore - numMigrated - 1);
+        VERIFY(world->GetDatabase()->GetTable(toTable).GetNumRows() >= numMigrated / 2);
+        for (IndexT i = 1; i < numMigrated; i += 2)
+        {
+            VERIFY(world->GetEntityMapping(migrated[i]).table == toTable);
+            VERIFY(world->HasComponent<TestVec4>(migrated[i]));
+            VERIFY(world->GetComponent<Game::Position>(migrated[i]) == Game::Position(vec3((float)i, 1, 2)));
+        }
+        VERIFY(world->HasComponent<TestResource>(single));
+        VERIFY(world->GetComponent<Game::Position>(single) == singlePos);
+
+        for (IndexT i = 1; i < numMigrated; i += 2)
+        {
+            world->DeleteEntity(migrated[i]);
+        }
+        world->DeleteEntity(single);
+        StepFrame();
+    }
+
     bool hasExecutedUpdateFunc = false;
     std::function updateFunc = [&](World* world, Test::TestHealth const& testHealth, Test::TestStruct& testStruct)
     {
@@ -437,6 +493,21 @@ EntitySystemTest::Run()
     
     StepFrame();
 
+    // Test chunked processors, every async entity should be visited exactly once
+    SizeT numChunkedInstances = 0;
+    std::function updateFuncChunk = [&](World* world, Game::ProcessorChunk const& chunk, Test::TestHealth const* testHealth, Test::TestStruct const* testStruct)
+    {
+        chunk.ForEachValid([&](uint i)
+        {
+            numChunkedInstances++;
+        });
+    };
+    Game::ProcessorBuilder(world, "TestUpdateFuncChunk").FuncChunk(updateFuncChunk).Including<Test::TestAsyncComponent>().Build();
+
+    StepFrame();
+
+    VERIFY(numChunkedInstances == 10000);
+
     t->StopTime();
 }
 
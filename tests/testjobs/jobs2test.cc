@@ -92,6 +92,24 @@ Jobs2Test::Run()
     }
     VERIFY(result);
 
+    // Wait for jobs from within jobs, the waiting jobs yield their fibers to the jobs they wait for
+    static Threading::AtomicCounter numInnerJobs;
+    numInnerJobs = 0;
+    Threading::AtomicCounter outerCounter = 1;
+    JobDispatch([](SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+    {
+        Threading::AtomicCounter innerCounter = 1;
+        JobDispatch([](SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+        {
+            Threading::Interlocked::Increment(&numInnerJobs);
+        }, 16, 1, nullptr, &innerCounter);
+        JobWait(&innerCounter);
+        n_assert(innerCounter == 0);
+    }, 64, 1, nullptr, &outerCounter);
+    JobWait(&outerCounter);
+    VERIFY(outerCounter == 0);
+    VERIFY(numInnerJobs == 64 * 16);
+
     delete[] ctx.inout;
     delete[] ctx.input2;
 }
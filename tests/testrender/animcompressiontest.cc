@@ -0,0 +1,380 @@
+//------------------------------------------------------------------------------
+//  @file animcompressiontest.cc
+//  @copyright (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "coreanimation/animkeybuffer.h"
+#include "coreanimation/animkeycompression.h"
+#include "coreanimation/animcurve.h"
+#include "coreanimation/animation.h"
+#include "coreanimation/animationloader.h"
+#include "coreanimation/animationresource.h"
+#include "resources/resourceserver.h"
+#include "io/ioserver.h"
+#include "model/animutil/animbuilder.h"
+#include "model/animutil/animbuildersaver.h"
+#include "timing/timer.h"
+#include "animcompressiontest.h"
+namespace Test
+{
+
+__ImplementClass(AnimCompressionTest, 'ACTE', Core::RefCounted);
+
+using namespace CoreAnimation;
+
+//------------------------------------------------------------------------------
+/**
+*/
+static float
+RotationError(const Math::quat& q0, const Math::quat& q1)
+{
+    return 2.0f * Math::acos(Math::min(1.0f, Math::abs(Math::dot(q0, q1))));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Adds a curve with one key per time to the anim builder
+*/
+static void
+AddCurve(ToolkitUtil::AnimBuilder& anim, CurveType::Code type, const Util::Array<Math::vec4>& values, const Util::Array<Timing::Tick>& times)
+{
+    int const stride = type == CurveType::Rotation ? 4 : 3;
+    ToolkitUtil::AnimBuilderCurve curve;
+    curve.firstKeyOffset = anim.keys.Size();
+    curve.firstTimeOffset = anim.keyTimes.Size();
+    curve.numKeys = values.Size();
+    curve.curveType = type;
+    curve.preInfinityType = InfinityType::Cycle;
+    curve.postInfinityType = InfinityType::Cycle;
+    for (IndexT key = 0; key < values.Size(); key++)
+    {
+        for (IndexT i = 0; i < stride; i++)
+            anim.keys.Append(values[key][i]);
+        anim.keyTimes.Append(times[key]);
+    }
+    anim.curves.Append(curve);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Builds a clip of joints with a translation, rotation and scale curve each, once
+    with raw and once with compressed keys. The scale curves never change, so they
+    are static when compressed.
+*/
+struct TestClip
+{
+    static const SizeT NumJoints = 64;
+    static const SizeT NumKeys = 120;
+    static const Timing::Tick KeyDuration = 40;
+
+    TestClip()
+    {
+        Util::Array<float> keys;
+        Util::Array<ushort> compressedKeys;
+        Util::Array<AnimKeyBuffer::Interval> intervals, compressedIntervals;
+        this->curves.Resize(NumJoints * 3);
+        this->compressedCurves.Resize(NumJoints * 3);
+        this->idleSamples.Resize(NumJoints * 3);
+
+        for (IndexT joint = 0; joint < NumJoints; joint++)
+        {
+            Math::vec3 const axis = Math::normalize(Math::vec3(Math::rand(-1.0f, 1.0f), Math::rand(-1.0f, 1.0f), Math::rand(0.1f, 1.0f)));
+            float const speed = Math::rand(0.01f, 0.1f);
+            float const amplitude = Math::rand(0.1f, 10.0f);
+            for (IndexT type = 0; type < 3; type++)
+            {
+                IndexT const curveIndex = joint * 3 + type;
+                AnimCurve& curve = this->curves[curveIndex];
+                AnimCurve& compressed = this->compressedCurves[curveIndex];
+                curve.curveType = type == 0 ? CurveType::Translation : type == 1 ? CurveType::Rotation : CurveType::Scale;
+                curve.preInfinityType = InfinityType::Cycle;
+                curve.postInfinityType = InfinityType::Cycle;
+                curve.firstIntervalOffset = intervals.Size();
+                curve.numIntervals = NumKeys - 1;
+                compressed = curve;
+                compressed.firstIntervalOffset = compressedIntervals.Size();
+                this->idleSamples[curveIndex] = type == 1 ? Math::vec4(0, 0, 0, 1) : Math::vec4(1, 1, 1, 0);
+
+                int const stride = type == 1 ? 4 : 3;
+                uint const firstKey = keys.Size();
+                uint const firstCompressedKey = compressedKeys.Size();
+
+                // Smooth curves, like the ones sampled from an animation
+                Util::FixedArray<Math::vec4> values(NumKeys);
+                Math::vec3 min(FLT_MAX), max(-FLT_MAX);
+                for (IndexT key = 0; key < NumKeys; key++)
+                {
+                    float const phase = key * speed;
+                    if (type == 0)
+                        values[key] = Math::vec4(amplitude * Math::sin(phase), amplitude * Math::cos(phase * 0.5f), joint * 0.1f, 0);
+                    else if (type == 1)
+                        values[key] = Math::rotationquataxis(axis, Math::sin(phase) * PI).vec;
+                    else
+                        values[key] = Math::vec4(1, 1, 1, 0);
+                    min = Math::minimize(min, xyz(values[key]));
+                    max = Math::maximize(max, xyz(values[key]));
+                }
+
+                Math::vec3 offset, scale;
+                AnimVectorRange(min, max, offset, scale);
+                compressed.keyOffset = Math::vec4(offset, 0);
+                compressed.keyScale = Math::vec4(scale, 0);
+                if (type == 2)
+                {
+                    compressed.isStatic = true;
+                    compressed.numIntervals = 0;
+                    compressed.keyOffset = values[0];
+                }
+
+                for (IndexT key = 0; key < NumKeys; key++)
+                {
+                    for (IndexT i = 0; i < stride; i++)
+                        keys.Append(values[key][i]);
+
+                    if (type == 2)
+                        continue;
+                    ushort packed[3];
+                    if (type == 1)
+                        AnimCompressRotation(Math::quat(values[key]), packed);
+                    else
+                        AnimCompressVector(xyz(values[key]), offset, scale, packed);
+                    compressedKeys.Append(packed[0]);
+                    compressedKeys.Append(packed[1]);
+                    compressedKeys.Append(packed[2]);
+                }
+
+                for (IndexT key = 0; key < NumKeys - 1; key++)
+                {
+                    AnimKeyBuffer::Interval interval;
+                    interval.start = key * KeyDuration;
+                    interval.end = (key + 1) * KeyDuration;
+                    interval.duration = 1.0f / KeyDuration;
+                    interval.key0 = firstKey + key * stride;
+                    interval.key1 = firstKey + (key + 1) * stride;
+                    intervals.Append(interval);
+
+                    if (type == 2)
+                        continue;
+                    interval.key0 = firstCompressedKey + key * 3;
+                    interval.key1 = firstCompressedKey + (key + 1) * 3;
+                    compressedIntervals.Append(interval);
+                }
+            }
+        }
+
+        this->buffer = AnimKeyBuffer::Create();
+        this->buffer->Setup(intervals.Size(), keys.Size(), intervals.Begin(), keys.Begin());
+        this->compressedBuffer = AnimKeyBuffer::Create();
+        this->compressedBuffer->SetupCompressed(compressedIntervals.Size(), compressedKeys.Size(), compressedIntervals.Begin(), compressedKeys.Begin());
+        this->rawIntervalBytes = intervals.Size() * sizeof(AnimKeyBuffer::Interval);
+        this->compressedIntervalBytes = compressedIntervals.Size() * sizeof(AnimKeyBuffer::Interval);
+
+        this->clip.firstCurve = 0;
+        this->clip.numCurves = NumJoints * 3;
+        this->clip.duration = (NumKeys - 1) * KeyDuration;
+    }
+
+    AnimClip clip;
+    Util::FixedArray<AnimCurve> curves;
+    Util::FixedArray<AnimCurve> compressedCurves;
+    Util::FixedArray<Math::vec4> idleSamples;
+    Ptr<AnimKeyBuffer> buffer;
+    Ptr<AnimKeyBuffer> compressedBuffer;
+    SizeT rawIntervalBytes;
+    SizeT compressedIntervalBytes;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AnimCompressionTest::Run()
+{
+    // Every rotation survives the round trip, no matter which component is left out or its sign
+    float maxRotationError = 0.0f;
+    for (IndexT i = 0; i < 10000; i++)
+    {
+        Math::quat const q = Math::normalize(Math::quat(Math::rand(-1.0f, 1.0f), Math::rand(-1.0f, 1.0f), Math::rand(-1.0f, 1.0f), Math::rand(-1.0f, 1.0f)));
+        ushort key[3];
+        AnimCompressRotation(q, key);
+        maxRotationError = Math::max(maxRotationError, RotationError(q, AnimDecompressRotation(key)));
+    }
+    VERIFY(maxRotationError < 0.0005f);
+
+    // Vectors are off by at most half a quantization step
+    bool vectorsInRange = true;
+    for (IndexT i = 0; i < 10000; i++)
+    {
+        Math::vec3 const min(Math::rand(-100.0f, 0.0f), Math::rand(-1.0f, 0.0f), 0.0f);
+        Math::vec3 const max = min + Math::vec3(Math::rand(0.0f, 200.0f), Math::rand(0.0f, 2.0f), 0.0f);
+        Math::vec3 const value = Math::lerp(min, max, Math::rand(0.0f, 1.0f));
+        Math::vec3 offset, scale;
+        AnimVectorRange(min, max, offset, scale);
+        ushort key[3];
+        AnimCompressVector(value, offset, scale, key);
+        Math::vec3 const error = Math::abs(AnimDecompressVector(key, offset, scale) - value);
+        for (IndexT j = 0; j < 3; j++)
+            vectorsInRange &= error[j] <= scale[j] * 0.5f + 0.0001f;
+    }
+    VERIFY(vectorsInRange);
+
+    // The compressed sampler matches the raw one
+    TestClip data;
+    Util::FixedArray<uint> intervals(data.clip.numCurves, 0), compressedIntervals(data.clip.numCurves, 0);
+    // The samplers store whole vectors, so the last three component sample needs room for a fourth
+    Util::FixedArray<float> samples(TestClip::NumJoints * 10 + 1), compressedSamples(TestClip::NumJoints * 10 + 1);
+    Util::FixedArray<uchar> counts(data.clip.numCurves), compressedCounts(data.clip.numCurves);
+
+    float maxTranslationError = 0.0f, maxScaleError = 0.0f;
+    maxRotationError = 0.0f;
+    bool sameCounts = true;
+    for (Timing::Tick time = 0; time < data.clip.duration; time += 7)
+    {
+        AnimSampleLinear(data.clip, data.curves, time, Math::vec4(1), data.idleSamples, data.buffer->GetKeyBufferPointer(), data.buffer->GetIntervalBufferPointer(), intervals.Begin(), samples.Begin(), counts.Begin());
+        AnimSample(data.clip, data.compressedCurves, time, Math::vec4(1), data.idleSamples, data.compressedBuffer, SampleType::Linear, compressedIntervals.Begin(), compressedSamples.Begin(), compressedCounts.Begin());
+        for (IndexT joint = 0; joint < TestClip::NumJoints; joint++)
+        {
+            const float* raw = samples.Begin() + joint * 10;
+            const float* compressed = compressedSamples.Begin() + joint * 10;
+            for (IndexT i = 0; i < 3; i++)
+            {
+                maxTranslationError = Math::max(maxTranslationError, Math::abs(raw[i] - compressed[i]));
+                maxScaleError = Math::max(maxScaleError, Math::abs(raw[7 + i] - compressed[7 + i]));
+            }
+            maxRotationError = Math::max(maxRotationError, RotationError(Math::quat(raw[3], raw[4], raw[5], raw[6]), Math::quat(compressed[3], compressed[4], compressed[5], compressed[6])));
+        }
+        sameCounts &= memcmp(counts.Begin(), compressedCounts.Begin(), counts.ByteSize()) == 0;
+    }
+    VERIFY(sameCounts);
+    VERIFY(maxTranslationError < 0.001f);
+    VERIFY(maxScaleError == 0.0f);
+    VERIFY(maxRotationError < 0.001f);
+
+    // Step sampling returns the first key of the interval
+    AnimSampleStep(data.clip, data.curves, 100, Math::vec4(1), data.idleSamples, data.buffer->GetKeyBufferPointer(), data.buffer->GetIntervalBufferPointer(), intervals.Begin(), samples.Begin(), counts.Begin());
+    AnimSample(data.clip, data.compressedCurves, 100, Math::vec4(1), data.idleSamples, data.compressedBuffer, SampleType::Step, compressedIntervals.Begin(), compressedSamples.Begin(), compressedCounts.Begin());
+    VERIFY(Math::abs(samples[0] - compressedSamples[0]) < 0.001f);
+    VERIFY(RotationError(Math::quat(samples[3], samples[4], samples[5], samples[6]), Math::quat(compressedSamples[3], compressedSamples[4], compressedSamples[5], compressedSamples[6])) < 0.001f);
+
+    // Save a moving clip and a clip with a single key per curve as NAX4 and load them back
+    {
+        Ptr<IO::IoServer> ioServer = IO::IoServer::Create();
+        Ptr<Resources::ResourceServer> resourceServer = Resources::ResourceServer::Create();
+        resourceServer->Open();
+        resourceServer->RegisterStreamLoader("nax", AnimationLoader::RTTI);
+
+        Math::vec3 const axis(0, 1, 0);
+        ToolkitUtil::AnimBuilder anim;
+        AddCurve(anim, CurveType::Translation, { Math::vec4(0, 0, 0, 0), Math::vec4(1, 2, 3, 0), Math::vec4(2, 4, 6, 0), Math::vec4(3, 6, 9, 0) }, { 0, 40, 80, 120 });
+        AddCurve(anim, CurveType::Rotation, { Math::rotationquataxis(axis, 0.0f).vec, Math::rotationquataxis(axis, 0.5f).vec, Math::rotationquataxis(axis, 1.0f).vec, Math::rotationquataxis(axis, 1.5f).vec }, { 0, 40, 80, 120 });
+        AddCurve(anim, CurveType::Scale, { Math::vec4(1, 1, 1, 0), Math::vec4(1, 1, 1, 0), Math::vec4(1, 1, 1, 0), Math::vec4(1, 1, 1, 0) }, { 0, 40, 80, 120 });
+        AddCurve(anim, CurveType::Translation, { Math::vec4(4, 0, 0, 0) }, { 0 });
+        AddCurve(anim, CurveType::Rotation, { Math::rotationquataxis(axis, 2.0f).vec }, { 0 });
+        AddCurve(anim, CurveType::Scale, { Math::vec4(2, 2, 2, 0) }, { 0 });
+        const char* clipNames[] = { "move", "pose" };
+        for (IndexT i = 0; i < 2; i++)
+        {
+            ToolkitUtil::AnimBuilderClip clip;
+            clip.SetName(clipNames[i]);
+            clip.firstCurveOffset = i * 3;
+            clip.numCurves = 3;
+            clip.firstEventOffset = 0;
+            clip.numEvents = 0;
+            clip.firstVelocityCurveOffset = 0;
+            clip.numVelocityCurves = 0;
+            clip.duration = 160;
+            anim.AddClip(clip);
+        }
+
+        // Both platforms are little endian, like the host
+        IO::URI const uri("temp:animcompressiontest.nax");
+        VERIFY(ToolkitUtil::AnimBuilderSaver::Save(uri, { anim }, ToolkitUtil::Platform::Linux));
+
+        bool loaded = false;
+        Resources::ResourceId const resource = Resources::CreateResource(uri.AsString(), "", [&loaded](Resources::ResourceId) { loaded = true; }, nullptr, true);
+        VERIFY(loaded);
+        if (loaded)
+        {
+            AnimationId const animation = AnimationResourceGetAnimation(resource, 0);
+            const Util::FixedArray<AnimClip>& clips = AnimGetClips(animation);
+            const Util::FixedArray<AnimCurve>& curves = AnimGetCurves(animation);
+            const Ptr<AnimKeyBuffer>& buffer = AnimGetBuffer(animation);
+            VERIFY(buffer->IsCompressed());
+            VERIFY(clips.Size() == 2 && curves.Size() == 6);
+            VERIFY(clips[0].GetName() == "move" && clips[0].firstCurve == 0 && clips[0].numCurves == 3 && clips[0].duration == 160);
+            VERIFY(clips[1].GetName() == "pose" && clips[1].firstCurve == 3 && clips[1].numCurves == 3);
+
+            // Constant and single key curves are static, the others keep their intervals
+            VERIFY(!curves[0].isStatic && curves[0].numIntervals == 3);
+            VERIFY(!curves[1].isStatic && curves[1].numIntervals == 3);
+            for (IndexT i = 2; i < 6; i++)
+                VERIFY(curves[i].isStatic && curves[i].numIntervals == 0);
+
+            // Halfway between the second and third key
+            Util::FixedArray<Math::vec4> idle(3);
+            idle.Fill(Math::vec4(0, 0, 0, 1));
+            Util::FixedArray<uint> moveIntervals(3, 0), poseIntervals(3, 0);
+            float moveSamples[12], poseSamples[12], mixedSamples[12];
+            uchar moveCounts[3], poseCounts[3], mixedCounts[3];
+            AnimSample(clips[0], curves, 60, Math::vec4(1), idle, buffer, SampleType::Linear, moveIntervals.Begin(), moveSamples, moveCounts);
+            VERIFY(Math::abs(moveSamples[0] - 1.5f) < 0.001f && Math::abs(moveSamples[1] - 3.0f) < 0.001f && Math::abs(moveSamples[2] - 4.5f) < 0.001f);
+            VERIFY(RotationError(Math::quat(moveSamples[3], moveSamples[4], moveSamples[5], moveSamples[6]), Math::rotationquataxis(axis, 0.75f)) < 0.01f);
+            VERIFY(moveSamples[7] == 1.0f && moveSamples[8] == 1.0f && moveSamples[9] == 1.0f);
+            VERIFY(moveCounts[0] == 1 && moveCounts[1] == 1 && moveCounts[2] == 1);
+
+            // Single keys are stored as they are and count as samples
+            AnimSample(clips[1], curves, 60, Math::vec4(1), idle, buffer, SampleType::Linear, poseIntervals.Begin(), poseSamples, poseCounts);
+            VERIFY(poseSamples[0] == 4.0f && poseSamples[1] == 0.0f && poseSamples[2] == 0.0f);
+            VERIFY(RotationError(Math::quat(poseSamples[3], poseSamples[4], poseSamples[5], poseSamples[6]), Math::rotationquataxis(axis, 2.0f)) < 0.0001f);
+            VERIFY(poseSamples[7] == 2.0f && poseSamples[8] == 2.0f && poseSamples[9] == 2.0f);
+            VERIFY(poseCounts[0] == 1 && poseCounts[1] == 1 && poseCounts[2] == 1);
+
+            // So mixing blends them in, instead of keeping the other clip's samples as idle curves did
+            AnimMix(clips[0], 3, nullptr, 0.5f, moveSamples, poseSamples, moveCounts, poseCounts, mixedSamples, mixedCounts);
+            bool mixed = true;
+            for (IndexT i = 0; i < 3; i++)
+            {
+                mixed &= mixedCounts[i] == 2;
+                mixed &= Math::abs(mixedSamples[i] - Math::lerp(moveSamples[i], poseSamples[i], 0.5f)) < 0.0001f;
+            }
+            VERIFY(mixed);
+            VERIFY(Math::abs(mixedSamples[0] - 2.75f) < 0.001f);
+
+            Resources::DiscardResource(resource);
+        }
+
+        resourceServer->DeregisterStreamLoader("nax", AnimationLoader::RTTI);
+        resourceServer->Close();
+        ioServer->DeleteFile(uri);
+    }
+
+    // Memory and throughput
+    SizeT const rawBytes = data.buffer->GetByteSize() + data.rawIntervalBytes;
+    SizeT const compressedBytes = data.compressedBuffer->GetByteSize() + data.compressedIntervalBytes;
+    VERIFY(compressedBytes * 2 < rawBytes);
+
+    const SizeT NumSamples = 2000;
+    Timing::Timer timer;
+    timer.Start();
+    for (IndexT i = 0; i < NumSamples; i++)
+        AnimSampleLinear(data.clip, data.curves, (i * 13) % data.clip.duration, Math::vec4(1), data.idleSamples, data.buffer->GetKeyBufferPointer(), data.buffer->GetIntervalBufferPointer(), intervals.Begin(), samples.Begin(), counts.Begin());
+    timer.Stop();
+    Timing::Time const rawTime = timer.GetTime();
+
+    timer.Reset();
+    timer.Start();
+    for (IndexT i = 0; i < NumSamples; i++)
+        AnimSample(data.clip, data.compressedCurves, (i * 13) % data.clip.duration, Math::vec4(1), data.idleSamples, data.compressedBuffer, SampleType::Linear, compressedIntervals.Begin(), compressedSamples.Begin(), compressedCounts.Begin());
+    timer.Stop();
+    Timing::Time const compressedTime = timer.GetTime();
+
+    n_printf("%d joints, %d keys: raw %d bytes, %f us per sample, compressed %d bytes, %f us per sample\n"
+        , TestClip::NumJoints
+        , TestClip::NumKeys
+        , rawBytes
+        , rawTime * 1000000 / NumSamples
+        , compressedBytes
+        , compressedTime * 1000000 / NumSamples);
+}
+
+} // namespace Test
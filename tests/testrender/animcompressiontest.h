@@ -0,0 +1,24 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    Test for compressed animation keys, compares the compressed sampler against
+    sampling raw keys, loads back a NAX4 file written by the anim builder saver and
+    reports memory use and throughput of both samplers
+
+    @copyright
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include "testbase/testcase.h"
+namespace Test
+{
+
+class AnimCompressionTest : public TestCase
+{
+    __DeclareClass(AnimCompressionTest);
+public:
+    /// run test
+    virtual void Run();
+};
+
+} // namespace Test
@@ -7,6 +7,8 @@
 #include "core/coreserver.h"
 #include "testbase/testrunner.h"
 #include "animtest.h"
+#include "animcompressiontest.h"
+#include "particlebenchmark.h"
 #include "rendertest.h"
 
 using namespace Core;
@@ -28,6 +30,8 @@ NebulaMain(const Util::CommandLineArgs& args)
     // setup and run test runner
     Ptr<TestRunner> testRunner = TestRunner::Create();
     testRunner->AttachTestCase(AnimTest::Create());
+    testRunner->AttachTestCase(AnimCompressionTest::Create());
+    testRunner->AttachTestCase(ParticleBenchmark::Create());
     testRunner->AttachTestCase(RenderTest::Create());
     testRunner->Run();
     //testRunner->AttachTestCase(BXmlReaderTest::Create());
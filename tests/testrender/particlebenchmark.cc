@@ -0,0 +1,218 @@
+//------------------------------------------------------------------------------
+// particlebenchmark.cc
+// (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "particlebenchmark.h"
+#include "timing/timer.h"
+#include "particles/particle.h"
+
+using namespace Particles;
+
+namespace Test
+{
+
+__ImplementClass(ParticleBenchmark, 'PABE', Test::TestCase);
+
+static const SizeT NumParticles = 1000000;
+static const SizeT NumSteps = 10;
+static const float StepTime = 1.0f / 60.0f;
+
+//------------------------------------------------------------------------------
+/**
+    A particle as the step used to update them, one at a time
+*/
+struct AosParticle
+{
+    Math::vec4 position;
+    Math::vec4 startPosition;
+    Math::vec4 stretchPosition;
+    Math::vec4 velocity;
+    Math::vec4 uvMinMax;
+    Math::vec4 color;
+    float rotation;
+    float rotationVariation;
+    float size;
+    float sizeVariation;
+    float oneDivLifeTime;
+    float relAge;
+    float age;
+    float particleId;
+};
+
+//------------------------------------------------------------------------------
+/**
+    The per particle step the kernel replaces, without particle stretching
+*/
+static void
+StepAos(const ParticleJobUniformData& uniforms, float stepTime, const Util::Array<AosParticle>& particles, Util::Array<AosParticle>& output, Util::Array<AosParticle>& living, ParticleJobSliceOutputData& result)
+{
+    result.numLivingParticles = 0;
+    result.numParticlesToRender = 0;
+    result.bbox.begin_extend();
+    for (IndexT i = 0; i < particles.Size(); i++)
+    {
+        const AosParticle& in = particles[i];
+        AosParticle& out = output[i];
+        out.oneDivLifeTime = in.oneDivLifeTime;
+        out.age = in.age + stepTime;
+        out.relAge = in.relAge + stepTime * in.oneDivLifeTime;
+        if (out.relAge >= 1.0f)
+            continue;
+        result.numLivingParticles++;
+
+        out.startPosition = in.startPosition;
+        out.uvMinMax = in.uvMinMax;
+        out.rotationVariation = in.rotationVariation;
+        out.sizeVariation = in.sizeVariation;
+        out.particleId = in.particleId;
+
+        IndexT const sampleIndex = IndexT(out.relAge * (float)(ParticleSystemNumEnvelopeSamples - 1));
+        const float* samples = uniforms.sampleBuffer + sampleIndex * EmitterAttrs::NumEnvelopeAttrs;
+
+        Math::vec4 acceleration = uniforms.windVector * samples[EmitterAttrs::AirResistance];
+        acceleration += uniforms.gravity;
+        acceleration *= samples[EmitterAttrs::Mass];
+
+        out.position = in.position + in.velocity * samples[EmitterAttrs::VelocityFactor] * stepTime;
+        result.bbox.extend(Math::bbox(out.position, Math::vector(samples[EmitterAttrs::Size])));
+        out.velocity = in.velocity + acceleration * stepTime;
+        out.stretchPosition = out.position;
+        out.rotation = in.rotation + in.rotationVariation * samples[EmitterAttrs::RotationVelocity] * stepTime;
+        out.color.loadu(&samples[EmitterAttrs::Red]);
+        out.color.w = Math::clamp(out.color.w, 0.0f, 1.0f);
+        out.size = samples[EmitterAttrs::Size] * in.sizeVariation;
+
+        if (out.color.w > 0.001f)
+            living[result.numParticlesToRender++] = out;
+    }
+    result.bbox.end_extend();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+ParticleBenchmark::Run()
+{
+    // Envelopes fading out towards the end of the particle life
+    Util::FixedArray<float> sampleBuffer(ParticleSystemNumEnvelopeSamples * EmitterAttrs::NumEnvelopeAttrs, 0.0f);
+    for (IndexT i = 0; i < ParticleSystemNumEnvelopeSamples; i++)
+    {
+        float const t = i / float(ParticleSystemNumEnvelopeSamples - 1);
+        float* samples = sampleBuffer.Begin() + i * EmitterAttrs::NumEnvelopeAttrs;
+        samples[EmitterAttrs::Red] = 1.0f;
+        samples[EmitterAttrs::Green] = 1.0f - t * 0.5f;
+        samples[EmitterAttrs::Blue] = 0.5f;
+        samples[EmitterAttrs::Alpha] = 1.2f - t * 1.2f;
+        samples[EmitterAttrs::RotationVelocity] = 2.0f;
+        samples[EmitterAttrs::Size] = 0.1f + t;
+        samples[EmitterAttrs::AirResistance] = 0.5f;
+        samples[EmitterAttrs::VelocityFactor] = 1.0f;
+        samples[EmitterAttrs::Mass] = 1.0f + t;
+    }
+
+    ParticleJobUniformData uniforms;
+    uniforms.sampleBuffer = sampleBuffer.Begin();
+    uniforms.gravity = Math::vector(0.0f, -9.81f, 0.0f);
+    uniforms.windVector = Math::vector(1.0f, 0.0f, 0.5f);
+
+    // The same particles in both layouts, some of them die during the benchmark
+    Util::Array<AosParticle> aos(NumParticles, 0);
+    ParticleStore store;
+    store.SetCapacity(NumParticles);
+    for (IndexT i = 0; i < NumParticles; i++)
+    {
+        AosParticle particle;
+        particle.position = Math::point(Math::rand(-100.0f, 100.0f), Math::rand(0.0f, 10.0f), Math::rand(-100.0f, 100.0f));
+        particle.startPosition = particle.position;
+        particle.stretchPosition = particle.position;
+        particle.velocity = Math::vector(Math::rand(-1.0f, 1.0f), Math::rand(0.0f, 5.0f), Math::rand(-1.0f, 1.0f));
+        particle.uvMinMax = Math::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+        particle.color = Math::vec4(1.0f);
+        particle.rotation = Math::rand(0.0f, 6.0f);
+        particle.rotationVariation = Math::rand(0.5f, 1.0f);
+        particle.size = 0.1f;
+        particle.sizeVariation = Math::rand(0.5f, 1.0f);
+        particle.oneDivLifeTime = 1.0f / Math::rand(1.0f, 10.0f);
+        particle.relAge = Math::rand(0.0f, 0.98f);
+        particle.age = particle.relAge / particle.oneDivLifeTime;
+        particle.particleId = 1.0f;
+        aos.Append(particle);
+
+        IndexT const index = store.Append();
+        store.Get(ParticleStore::PositionX)[index] = particle.position.x;
+        store.Get(ParticleStore::PositionY)[index] = particle.position.y;
+        store.Get(ParticleStore::PositionZ)[index] = particle.position.z;
+        store.Get(ParticleStore::StartPositionX)[index] = particle.position.x;
+        store.Get(ParticleStore::StartPositionY)[index] = particle.position.y;
+        store.Get(ParticleStore::StartPositionZ)[index] = particle.position.z;
+        store.Get(ParticleStore::VelocityX)[index] = particle.velocity.x;
+        store.Get(ParticleStore::VelocityY)[index] = particle.velocity.y;
+        store.Get(ParticleStore::VelocityZ)[index] = particle.velocity.z;
+        store.Get(ParticleStore::Rotation)[index] = particle.rotation;
+        store.Get(ParticleStore::RotationVariation)[index] = particle.rotationVariation;
+        store.Get(ParticleStore::SizeVariation)[index] = particle.sizeVariation;
+        store.Get(ParticleStore::OneDivLifeTime)[index] = particle.oneDivLifeTime;
+        store.Get(ParticleStore::RelAge)[index] = particle.relAge;
+        store.Get(ParticleStore::Age)[index] = particle.age;
+        store.Get(ParticleStore::ParticleId)[index] = particle.particleId;
+        store.Get(ParticleStore::TextureMin)[index] = 1.0f;
+        store.Get(ParticleStore::TextureMax)[index] = 0.0f;
+    }
+
+    // The per particle step writes the next state to a second buffer
+    Util::Array<AosParticle> aosNext(aos);
+    Util::Array<AosParticle> aosLiving(aos);
+    Util::FixedArray<ParticleVertex> vertices(store.capacity);
+    ParticleJobSliceOutputData aosResult, result;
+
+    // Both steps see the same particles the first time, so they have to agree
+    StepAos(uniforms, StepTime, aos, aosNext, aosLiving, aosResult);
+    ParticleSystemStep(&uniforms, StepTime, store, vertices.Begin(), &result);
+    VERIFY(aosResult.numLivingParticles == result.numLivingParticles);
+    VERIFY(aosResult.numParticlesToRender == result.numParticlesToRender);
+    VERIFY(store.size == result.numLivingParticles);
+
+    float maxError = 0.0f;
+    for (IndexT i = 0; i < result.numParticlesToRender; i++)
+    {
+        const AosParticle& expected = aosLiving[i];
+        const ParticleVertex& vertex = vertices[i];
+        maxError = Math::max(maxError, Math::length(xyz(expected.position - vertex.position)));
+        maxError = Math::max(maxError, Math::abs(expected.color.w - vertex.color.w));
+        maxError = Math::max(maxError, Math::abs(expected.size - vertex.rotationSize.z));
+        maxError = Math::max(maxError, Math::abs(Math::sin(expected.rotation) - vertex.rotationSize.x));
+    }
+    VERIFY(maxError < 0.0001f);
+    VERIFY(Math::length(xyz(aosResult.bbox.pmin - result.bbox.pmin)) < 0.0001f);
+    VERIFY(Math::length(xyz(aosResult.bbox.pmax - result.bbox.pmax)) < 0.0001f);
+
+    Timing::Timer timer;
+    timer.Start();
+    Util::Array<AosParticle>* src = &aosNext;
+    Util::Array<AosParticle>* dst = &aos;
+    for (IndexT step = 0; step < NumSteps; step++)
+    {
+        StepAos(uniforms, StepTime, *src, *dst, aosLiving, aosResult);
+        std::swap(src, dst);
+    }
+    timer.Stop();
+    Timing::Time const aosTime = timer.GetTime() / NumSteps;
+
+    timer.Reset();
+    timer.Start();
+    for (IndexT step = 0; step < NumSteps; step++)
+        ParticleSystemStep(&uniforms, StepTime, store, vertices.Begin(), &result);
+    timer.Stop();
+    Timing::Time const soaTime = timer.GetTime() / NumSteps;
+
+    n_printf("Particle step, %d particles, %d living: per particle %.2f ms, kernel %.2f ms, %.2fx\n"
+        , NumParticles
+        , result.numLivingParticles
+        , aosTime * 1000.0
+        , soaTime * 1000.0
+        , aosTime / soaTime);
+}
+
+} // namespace Test
@@ -0,0 +1,20 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    Compares the particle step kernel against a per particle update of the same
+    synthetic particles
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include "testbase/testcase.h"
+namespace Test
+{
+class ParticleBenchmark : public TestCase
+{
+    __DeclareClass(ParticleBenchmark);
+public:
+    /// run test
+    virtual void Run();
+};
+} // namespace Test
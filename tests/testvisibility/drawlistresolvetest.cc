@@ -0,0 +1,172 @@
+//------------------------------------------------------------------------------
+// drawlistresolvetest.cc
+// (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "drawlistresolvetest.h"
+#include "models/modelcontext.h"
+#include "visibility/visibilitycontext.h"
+#include "coregraphics/graphicsdevice.h"
+#include "util/tupleutility.h"
+
+using namespace Visibility;
+
+namespace Test
+{
+
+__ImplementClass(DrawListResolveTest, 'DLRT', Test::TestCase);
+
+struct ResolvedRun
+{
+    uint32_t offset;
+    uint32_t numPackets;
+    Models::ShaderStateNode::DrawPacket* packet;
+    Util::Array<Math::mat4> transforms;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+AddNode(
+    Models::ModelContext::ModelInstance::Renderable& renderables
+    , const MaterialTemplatesGPULang::Entry* materialTemplate
+    , uint32_t mesh
+    , uint32_t material
+    , uint32_t numInstances)
+{
+    IndexT index = renderables.nodeStates.Size();
+
+    Models::ModelContext::NodeInstanceState& state = renderables.nodeStates.Emplace();
+    state.resourceTables.Resize(CoreGraphics::GetBufferedFrameIndex() + 1);
+    state.resourceTableOffsets.Resize(2);
+    state.resourceTableOffsets.Fill(0);
+    state.materialInstance = Materials::MaterialInstanceId::Invalid();
+    state.objectConstantsIndex = 0;
+    state.instancingConstantsIndex = 1;
+    state.skinningConstantsIndex = InvalidIndex;
+    state.particleConstantsIndex = InvalidIndex;
+
+    renderables.nodeMaterialTemplates.Append(materialTemplate);
+    renderables.nodeMeshes.Append(CoreGraphics::MeshId(mesh));
+    renderables.nodeMaterials.Append(Materials::MaterialId(material, 0));
+    renderables.nodeTypes.Append(Models::PrimitiveNodeType);
+    renderables.nodeDrawModifiers.Append(Util::MakeTuple(numInstances, uint32_t(0)));
+    renderables.nodeLods.Append(0.0f);
+    renderables.nodePrimitiveGroupIndex.Append(0);
+    renderables.nodePrimitiveGroup.Append(CoreGraphics::PrimitiveGroup());
+    renderables.nodeBoundingBoxes.Append(Math::bbox());
+    renderables.nodeWorldTransforms.Append(Math::translation(float(index), 0, 0));
+#if NEBULA_GRAPHICS_DEBUG
+    renderables.nodeNames.Append(Util::StringAtom("node"));
+#endif
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+DrawListResolveTest::Run()
+{
+    static MaterialTemplatesGPULang::Entry templates[2];
+    templates[0].uniqueId = 1;
+    templates[1].uniqueId = 2;
+
+    // runs end on template, mesh and material changes, and on nodes which can't be instanced
+    Models::ModelContext::ModelInstance::Renderable renderables;
+    struct { uint32_t tmpl, mesh, material, numInstances, count; } layout[] =
+    {
+        { 0, 0, 0, 1, 3 },
+        { 0, 1, 0, 1, 3 },
+        { 1, 0, 1, 1, 3 },
+        { 1, 0, 2, 1, 2 },
+        { 1, 0, 2, 2, 1 },
+        { 1, 0, 2, 1, 2 },
+    };
+    for (const auto& nodes : layout)
+    {
+        for (uint32_t i = 0; i < nodes.count; i++)
+            AddNode(renderables, &templates[nodes.tmpl], nodes.mesh, nodes.material, nodes.numInstances);
+    }
+
+    // the resolve only looks at the node index in the low bits, the nodes are already in sorted order
+    const uint32_t numKeys = renderables.nodeStates.Size();
+    Util::Array<uint64_t> keys;
+    for (uint32_t i = 0; i < numKeys; i++)
+        keys.Append((uint64_t(renderables.nodeMaterialTemplates[i]->uniqueId) << 32) | i);
+
+    Util::Array<ResolvedRun> runs;
+    ObserverContext::VisibilityDrawList drawList;
+    Memory::ArenaAllocator<1024> allocator;
+    uint32_t numDrawCommands = ObserverContext::ResolveDrawList(keys.Begin(), numKeys, renderables, drawList, allocator,
+        [&](ObserverContext::VisibilityDrawCommand& drawCmd, Models::ShaderStateNode::DrawPacket* packet)
+    {
+        // the packets of the run are all emplaced when the run is set up
+        VERIFY(drawList.drawPackets.Size() >= drawCmd.offset + drawCmd.numPackets);
+
+        ResolvedRun run;
+        run.offset = drawCmd.offset;
+        run.numPackets = drawCmd.numPackets;
+        run.packet = packet;
+        for (uint32_t i = 0; i < drawCmd.numPackets; i++)
+            run.transforms.Append(renderables.nodeWorldTransforms[keys[drawCmd.offset + i] & 0x00000000FFFFFFFF]);
+        packet->offsets[1] = runs.Size() + 1;
+        drawCmd.firstInstance = runs.Size() + 1;
+        runs.Append(run);
+    });
+
+    VERIFY(numDrawCommands == 6);
+    VERIFY(runs.Size() == 5);
+    VERIFY(drawList.drawPackets.Size() == numKeys);
+    VERIFY(drawList.visibilityTable.Size() == 2);
+
+    SizeT numPackets = 0;
+    SizeT numMerged = 0;
+    for (uint32_t t = 0; t < 2; t++)
+    {
+        const ObserverContext::VisibilityBatchCommand& batch = drawList.visibilityTable[&templates[t]];
+        for (const ObserverContext::VisibilityDrawCommand& draw : batch.draws)
+        {
+            numPackets += draw.numPackets;
+            VERIFY(draw.offset >= batch.packetOffset && draw.offset + draw.numPackets <= batch.packetOffset + batch.numDrawPackets);
+
+            // a run never spans a change of template, mesh or material
+            uint32_t leader = keys[draw.offset] & 0x00000000FFFFFFFF;
+            for (uint32_t i = 1; i < draw.numPackets; i++)
+            {
+                uint32_t index = keys[draw.offset + i] & 0x00000000FFFFFFFF;
+                VERIFY(renderables.nodeMaterialTemplates[index] == renderables.nodeMaterialTemplates[leader]);
+                VERIFY(renderables.nodeMeshes[index] == renderables.nodeMeshes[leader]);
+                VERIFY(renderables.nodeMaterials[index] == renderables.nodeMaterials[leader]);
+            }
+
+            Models::ShaderStateNode::DrawPacket* packet = drawList.drawPackets[draw.offset];
+            if (draw.numPackets == 1)
+            {
+                // single draws keep the instancing constants of their node
+                VERIFY(packet->offsets[1] == 0);
+                VERIFY(draw.firstInstance == 0);
+                continue;
+            }
+
+            // every merged draw is set up exactly once, with the instance data of its own nodes
+            numMerged++;
+            VERIFY(packet->offsets[1] > 0 && packet->offsets[1] <= (uint32_t)runs.Size());
+            if (packet->offsets[1] == 0 || packet->offsets[1] > (uint32_t)runs.Size())
+                continue;
+            const ResolvedRun& run = runs[packet->offsets[1] - 1];
+            VERIFY(run.packet == packet);
+            VERIFY(run.offset == draw.offset);
+            VERIFY(run.numPackets == draw.numPackets);
+            VERIFY(draw.firstInstance == packet->offsets[1]);
+            bool sameTransforms = run.transforms.Size() == draw.numPackets;
+            for (uint32_t i = 0; sameTransforms && i < draw.numPackets; i++)
+                sameTransforms = run.transforms[i] == Math::translation(float(keys[draw.offset + i] & 0x00000000FFFFFFFF), 0, 0);
+            VERIFY(sameTransforms);
+        }
+    }
+    VERIFY(numPackets == numKeys);
+    VERIFY(numMerged == runs.Size());
+}
+
+} // namespace Test
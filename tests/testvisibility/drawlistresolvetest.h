@@ -0,0 +1,20 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    Resolves sorted synthetic node instances into a draw list and checks
+    that every merged draw command gets the instance data of its run
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include "testbase/testcase.h"
+namespace Test
+{
+class DrawListResolveTest : public TestCase
+{
+    __DeclareClass(DrawListResolveTest);
+public:
+    /// run test
+    virtual void Run();
+};
+} // namespace Test
@@ -0,0 +1,152 @@
+//------------------------------------------------------------------------------
+// drawlistsortbenchmark.cc
+// (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "drawlistsortbenchmark.h"
+#include "timing/timer.h"
+#include "jobs2/jobs2.h"
+#include "math/clipstatus.h"
+#include "models/modelcontext.h"
+#include "visibility/drawlistsorter.h"
+#include <algorithm>
+
+using namespace Visibility;
+
+namespace Test
+{
+
+__ImplementClass(DrawListSortBenchmark, 'DLSB', Test::TestCase);
+
+//------------------------------------------------------------------------------
+/**
+    The serial sort the draw list sorter replaces
+*/
+static SizeT
+SortSerial(
+    const Util::Array<Math::ClipStatus::Type>& statuses
+    , const Util::Array<uint64_t>& sortIds
+    , const Util::Array<Models::NodeInstanceFlags>& flags
+    , Util::Array<uint64_t>& keys)
+{
+    SizeT numKeys = 0;
+    for (IndexT i = 0; i < statuses.Size(); i++)
+    {
+        if (AllBits(flags[i], Models::NodeInstanceFlags::NodeInstance_Active) && statuses[i] != Math::ClipStatus::Outside)
+            keys[numKeys++] = sortIds[i] | i;
+    }
+    std::qsort(keys.Begin(), numKeys, sizeof(uint64_t), [](const void* a, const void* b)
+    {
+        uint64_t arg1 = *static_cast<const uint64_t*>(a);
+        uint64_t arg2 = *static_cast<const uint64_t*>(b);
+        return (arg1 > arg2) - (arg1 < arg2);
+    });
+    return numKeys;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static Timing::Time
+SortParallel(
+    DrawListSorter& sorter
+    , const Util::Array<Math::ClipStatus::Type>& statuses
+    , const Util::Array<uint32_t>& ids
+    , const Util::Array<uint64_t>& sortIds
+    , Util::Array<Models::NodeInstanceFlags>& flags)
+{
+    Threading::AtomicCounter doneCounter = 1;
+    Timing::Timer timer;
+    timer.Start();
+    Jobs2::JobBeginSequence(nullptr, &doneCounter);
+    sorter.AppendJobs(statuses.Begin(), ids.Begin(), ids.Size(), sortIds.Begin(), flags.Begin(), flags.Size());
+    Jobs2::JobEndSequence();
+    Jobs2::JobWait(&doneCounter);
+    timer.Stop();
+    Jobs2::JobNewFrame();
+    return timer.GetTime();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+DrawListSortBenchmark::Run()
+{
+    const SizeT NumNodes = 200000;
+    const SizeT NumFrames = 20;
+
+    Jobs2::JobSystemInitInfo jobInfo;
+    jobInfo.name = "DrawListSortBenchmark";
+    jobInfo.numThreads = System::NumCpuCores;
+    jobInfo.priority = UINT_MAX;
+    Jobs2::JobSystemInit(jobInfo);
+
+    // Sort ids are built like the model context does, from a material sort code and a node hash
+    Util::Array<uint64_t> sortIds;
+    Util::Array<uint32_t> ids;
+    Util::Array<Models::NodeInstanceFlags> flags;
+    Util::Array<Math::ClipStatus::Type> statuses;
+    sortIds.Reserve(NumNodes);
+    for (IndexT i = 0; i < NumNodes; i++)
+    {
+        uint64_t const sortCode = Math::rand(0.0f, 16.0f);
+        uint64_t const nodeHash = Math::rand(0.0f, 256.0f);
+        sortIds.Append((sortCode << 52) | (nodeHash << 32));
+        ids.Append(i);
+        flags.Append(i % 64 == 0 ? Models::NodeInstanceFlags::NodeInstance_Visible : Models::NodeInstanceFlags::NodeInstance_Active);
+        statuses.Append(Math::rand(0.0f, 1.0f) < 0.4f ? Math::ClipStatus::Inside : Math::ClipStatus::Outside);
+    }
+
+    Util::Array<uint64_t> expected;
+    expected.Resize(NumNodes);
+    DrawListSorter sorter;
+
+    // Odd frames reshuffle the visible set, even frames only change a few percent of it like a moving camera would
+    Timing::Time serialTime = 0, fullTime = 0, incrementalTime = 0;
+    SizeT numFull = 0, numIncremental = 0;
+    bool same = true;
+    for (IndexT frame = 0; frame < NumFrames; frame++)
+    {
+        float const changeRate = (frame & 1) ? 1.0f : 0.02f;
+        for (IndexT i = 0; i < NumNodes; i++)
+        {
+            if (Math::rand(0.0f, 1.0f) < changeRate)
+                statuses[i] = Math::rand(0.0f, 1.0f) < 0.4f ? Math::ClipStatus::Clipped : Math::ClipStatus::Outside;
+        }
+
+        Timing::Timer timer;
+        timer.Start();
+        SizeT const numExpected = SortSerial(statuses, sortIds, flags, expected);
+        timer.Stop();
+        serialTime += timer.GetTime();
+
+        Timing::Time const time = SortParallel(sorter, statuses, ids, sortIds, flags);
+        if (sorter.WasIncremental())
+        {
+            incrementalTime += time;
+            numIncremental++;
+        }
+        else
+        {
+            fullTime += time;
+            numFull++;
+        }
+
+        same &= sorter.GetNumKeys() == numExpected;
+        if (same)
+            same &= memcmp(sorter.GetKeys(), expected.Begin(), numExpected * sizeof(uint64_t)) == 0;
+    }
+    VERIFY(same);
+    VERIFY(numFull > 0 && numIncremental > 0);
+
+    n_printf("%d nodes: qsort %f ms, radix sort %f ms, incremental %f ms per frame\n"
+        , NumNodes
+        , serialTime * 1000 / NumFrames
+        , fullTime * 1000 / Math::max(numFull, 1)
+        , incrementalTime * 1000 / Math::max(numIncremental, 1));
+
+    Jobs2::JobSystemUninit();
+}
+
+} // namespace Test
@@ -0,0 +1,19 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    Compares the draw list sorter against a serial sort of synthetic renderables
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include "testbase/testcase.h"
+namespace Test
+{
+class DrawListSortBenchmark : public TestCase
+{
+    __DeclareClass(DrawListSortBenchmark);
+public:
+    /// run test
+    virtual void Run();
+};
+} // namespace Test
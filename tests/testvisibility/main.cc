@@ -7,6 +7,9 @@
 #include "core/coreserver.h"
 #include "testbase/testrunner.h"
 #include "visibilitytest.h"
+#include "visibilitybenchmark.h"
+#include "drawlistsortbenchmark.h"
+#include "drawlistresolvetest.h"
 
 using namespace Core;
 using namespace Test;
@@ -23,7 +26,10 @@ int main(int argc, char** argv)
 
     // setup and run test runner
     Ptr<TestRunner> testRunner = TestRunner::Create();
+    testRunner->AttachTestCase(VisibilityBenchmark::Create());
+    testRunner->AttachTestCase(DrawListSortBenchmark::Create());
     testRunner->AttachTestCase(VisibilityTest::Create());
+    testRunner->AttachTestCase(DrawListResolveTest::Create());
     testRunner->Run();
     //testRunner->AttachTestCase(BXmlReaderTest::Create());
 
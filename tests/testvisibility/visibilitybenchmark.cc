@@ -0,0 +1,161 @@
+//------------------------------------------------------------------------------
+// visibilitybenchmark.cc
+// (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "stdneb.h"
+#include "visibilitybenchmark.h"
+#include "timing/timer.h"
+#include "jobs2/jobs2.h"
+#include "math/clipstatus.h"
+#include "visibility/visibilitycontext.h"
+#include "visibility/systems/visibilitysystem.h"
+
+using namespace Visibility;
+
+namespace Test
+{
+
+__ImplementClass(VisibilityBenchmark, 'VIBE', Test::TestCase);
+
+//------------------------------------------------------------------------------
+/**
+    Runs a system over a number of frames and returns the average time per frame
+*/
+static Timing::Time
+RunSystem(
+    VisibilitySystem* system
+    , const Util::Array<Math::mat4>& observers
+    , Util::Array<Math::ClipStatus::Type>* results
+    , const Util::Array<Math::bbox>& boxes
+    , const Util::Array<uint32_t>& ids
+    , const Util::Array<Graphics::StageMask>& stages
+    , const Util::Array<uint32_t>& flags
+    , SizeT numFrames)
+{
+    Util::FixedArray<bool> isOrtho(observers.Size(), false);
+    Util::FixedArray<Graphics::StageMask> observerStages(observers.Size(), 0xFFFF);
+    Threading::AtomicCounter readyCounter = 0;
+
+    Timing::Timer timer;
+    timer.Start();
+    for (IndexT frame = 0; frame < numFrames; frame++)
+    {
+        for (IndexT i = 0; i < observers.Size(); i++)
+            results[i].Fill(0, results[i].Size(), Math::ClipStatus::Outside);
+
+        system->PrepareObservers(observers.Begin(), isOrtho.Begin(), observerStages.Begin(), results, observers.Size());
+        system->PrepareEntities(boxes.Begin(), ids.Begin(), stages.Begin(), nullptr, flags.Begin(), ids.Size());
+        system->Run(nullptr, { &readyCounter });
+        for (IndexT i = 0; i < observers.Size(); i++)
+            Jobs2::JobWait(&system->GetCompletionCounters()[i]);
+        Jobs2::JobNewFrame();
+    }
+    timer.Stop();
+    return timer.GetTime() / numFrames;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+VisibilityBenchmark::Run()
+{
+    const SizeT NumObjects = 200000;
+    const SizeT NumFrames = 20;
+    const float WorldSize = 2000.0f;
+
+    Jobs2::JobSystemInitInfo jobInfo;
+    jobInfo.name = "VisibilityBenchmark";
+    jobInfo.numThreads = System::NumCpuCores;
+    jobInfo.priority = UINT_MAX;
+    Jobs2::JobSystemInit(jobInfo);
+
+    // Static props scattered over a large, mostly flat world
+    Util::Array<Math::bbox> boxes;
+    Util::Array<uint32_t> ids;
+    Util::Array<Graphics::StageMask> stages;
+    Util::Array<uint32_t> flags;
+    boxes.Reserve(NumObjects);
+    for (IndexT i = 0; i < NumObjects; i++)
+    {
+        Math::point center(Math::rand(-0.5f, 0.5f) * WorldSize, Math::rand(0.0f, 50.0f), Math::rand(-0.5f, 0.5f) * WorldSize);
+        float size = Math::rand(0.5f, 5.0f);
+        boxes.Append(Math::bbox(center, Math::vector(size)));
+        ids.Append(i);
+        stages.Append(0xFFFF);
+        flags.Append(0);
+    }
+
+    // A camera and four shadow cascade like observers
+    Util::Array<Math::mat4> observers;
+    Math::mat4 view = Math::lookatrh(Math::point(0, 20, 0), Math::point(100, 10, 100), Math::vector::upvec());
+    observers.Append(Math::perspfovrh(Math::deg2rad(60.0f), 16.0f / 9.0f, 0.1f, 500.0f) * view);
+    for (IndexT i = 0; i < 4; i++)
+    {
+        float extent = 50.0f * (1 << i);
+        Math::mat4 lightView = Math::lookatrh(Math::point(0, 200, 0), Math::point(10, 0, 10), Math::vector::upvec());
+        observers.Append(Math::orthorh(extent, extent, 0.1f, 400.0f) * lightView);
+    }
+
+    Util::Array<Math::ClipStatus::Type> octreeResults[5], quadtreeResults[5], bruteforceResults[5];
+    for (IndexT i = 0; i < observers.Size(); i++)
+    {
+        octreeResults[i].Resize(NumObjects);
+        quadtreeResults[i].Resize(NumObjects);
+        bruteforceResults[i].Resize(NumObjects);
+    }
+
+    OctreeSystemLoadInfo octreeInfo;
+    octreeInfo.worldExpanding = false;
+    octreeInfo.cellsX = 64;
+    octreeInfo.cellsY = 2;
+    octreeInfo.cellsZ = 64;
+    octreeInfo.width = WorldSize;
+    octreeInfo.height = 100;
+    octreeInfo.depth = WorldSize;
+    octreeInfo.pos = Math::vec4(0, 25, 0, 1);
+    VisibilitySystem* octree = ObserverContext::CreateOctreeSystem(octreeInfo);
+
+    QuadtreeSystemLoadInfo quadtreeInfo;
+    quadtreeInfo.worldExpanding = false;
+    quadtreeInfo.cellsX = 64;
+    quadtreeInfo.cellsY = 64;
+    quadtreeInfo.width = WorldSize;
+    quadtreeInfo.height = WorldSize;
+    quadtreeInfo.pos = Math::vec4(0, 25, 0, 1);
+    VisibilitySystem* quadtree = ObserverContext::CreateQuadtreeSystem(quadtreeInfo);
+    VisibilitySystem* bruteforce = ObserverContext::CreateBruteforceSystem({});
+
+    Timing::Time octreeTime = RunSystem(octree, observers, octreeResults, boxes, ids, stages, flags, NumFrames);
+    Timing::Time quadtreeTime = RunSystem(quadtree, observers, quadtreeResults, boxes, ids, stages, flags, NumFrames);
+    Timing::Time bruteforceTime = RunSystem(bruteforce, observers, bruteforceResults, boxes, ids, stages, flags, NumFrames);
+
+    // The trees test box corners while brute force tests frustum planes, so boxes touching
+    // a plane may round differently, apart from those all systems have to agree
+    bool treesSame = true;
+    SizeT boundaryMismatches = 0;
+    for (IndexT i = 0; i < observers.Size(); i++)
+    {
+        for (IndexT j = 0; j < NumObjects; j++)
+        {
+            bool const octreeVisible = octreeResults[i][j] != Math::ClipStatus::Outside;
+            bool const quadtreeVisible = quadtreeResults[i][j] != Math::ClipStatus::Outside;
+            bool const bruteforceVisible = bruteforceResults[i][j] != Math::ClipStatus::Outside;
+            treesSame &= octreeVisible == quadtreeVisible;
+            if (octreeVisible != bruteforceVisible)
+                boundaryMismatches++;
+        }
+    }
+    VERIFY(treesSame);
+    VERIFY(boundaryMismatches * 10000 <= NumObjects * observers.Size());
+
+    double const boxesPerNanosecond = double(NumObjects * observers.Size()) / (bruteforceTime * 1000000000.0);
+    n_printf("%d objects, %d observers: octree %f ms, quadtree %f ms, brute force %f ms per frame (%f boxes/ns)\n", NumObjects, observers.Size(), octreeTime * 1000, quadtreeTime * 1000, bruteforceTime * 1000, boxesPerNanosecond);
+
+    ObserverContext::DestroySystem(octree);
+    ObserverContext::DestroySystem(quadtree);
+    ObserverContext::DestroySystem(bruteforce);
+    Jobs2::JobSystemUninit();
+}
+
+} // namespace Test
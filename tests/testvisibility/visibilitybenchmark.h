@@ -0,0 +1,19 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    Compares the tree visibility systems against brute force culling
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include "testbase/testcase.h"
+namespace Test
+{
+class VisibilityBenchmark : public TestCase
+{
+    __DeclareClass(VisibilityBenchmark);
+public:
+    /// run test
+    virtual void Run();
+};
+} // namespace Test
@@ -5,7 +5,10 @@
 #include "stdneb.h"
 #include "zipstresstestapplication.h"
 #include "threading/thread.h"
+#include "threading/interlocked.h"
 #include "io/stream.h"
+#include "timing/timer.h"
+#include "io/packfs/packarchivewriter.h"
 
 namespace App
 {
@@ -19,7 +22,7 @@ class ReaderThread : public Threading::Thread
     __DeclareClass(ReaderThread);
 public:
     /// constructor
-    ReaderThread() : loopCount(0) {};
+    ReaderThread() : loopCount(0), verbose(true), bytesRead(nullptr) {};
     /// setup the directory and file pattern
     void Setup(SizeT loopCount_, const String& path_, const String& pattern_)
     {
@@ -27,6 +30,12 @@ public:
         this->path = path_;
         this->pattern = pattern_;
     };
+    /// count the bytes read instead of printing every file
+    void SetBenchmark(AtomicCounter64* bytesRead_)
+    {
+        this->bytesRead = bytesRead_;
+        this->verbose = false;
+    };
 
 protected:
     /// worker method
@@ -36,6 +45,8 @@ private:
     SizeT loopCount;
     String path;
     String pattern;
+    bool verbose;
+    AtomicCounter64* bytesRead;
 };
 __ImplementClass(App::ReaderThread, 'RTHR', Threading::Thread);
 
@@ -57,7 +68,10 @@ ReaderThread::DoWork()
         for (i = 0; i < files.Size(); i++)
         {
             URI fileUri(this->path + "/" + files[i]);
-            n_printf("%s: %s\n", Thread::GetMyThreadName(), fileUri.AsString().AsCharPtr());
+            if (this->verbose)
+            {
+                n_printf("%s: %s\n", Thread::GetMyThreadName(), fileUri.AsString().AsCharPtr());
+            }
             Ptr<Stream> stream = ioServer->CreateStream(fileUri);
             if (stream->Open())
             {
@@ -68,6 +82,10 @@ ReaderThread::DoWork()
                 n_assert(readSize == fileSize);
                 Memory::Free(Memory::DefaultHeap, buf);
                 stream->Close();
+                if (this->bytesRead != nullptr)
+                {
+                    Interlocked::Add(this->bytesRead, (int64)fileSize);
+                }
             }
         }
     }
@@ -75,6 +93,67 @@ ReaderThread::DoWork()
     // shutdown the thread
 }
 
+//------------------------------------------------------------------------------
+/**
+    Reads the same directory of one archive from a growing number of threads
+    and prints the throughput, which should scale with the number of threads.
+    Returns the throughput in MB/s for each number of threads.
+*/
+static Array<double>
+RunThroughputBenchmark(const char* name, const String& path, const String& pattern)
+{
+    n_printf("%s read throughput for %s/%s\n", name, path.AsCharPtr(), pattern.AsCharPtr());
+    Array<double> results;
+    for (SizeT numThreads = 1; numThreads <= 8; numThreads *= 2)
+    {
+        AtomicCounter64 bytesRead = 0;
+        Array<Ptr<ReaderThread>> threads;
+        for (IndexT i = 0; i < numThreads; i++)
+        {
+            Ptr<ReaderThread> thread = ReaderThread::Create();
+            thread->SetName(String::Sprintf("BenchmarkThread%d", i));
+            thread->Setup(4, path, pattern);
+            thread->SetBenchmark(&bytesRead);
+            threads.Append(thread);
+        }
+
+        Timing::Timer timer;
+        timer.Start();
+        for (IndexT i = 0; i < numThreads; i++)
+        {
+            threads[i]->Start();
+        }
+        for (IndexT i = 0; i < numThreads; i++)
+        {
+            threads[i]->Stop();
+        }
+        timer.Stop();
+
+        double megabytesPerSecond = (bytesRead / (1024.0 * 1024.0)) / timer.GetTime();
+        results.Append(megabytesPerSecond);
+        n_printf("    %d threads: %.1f MB/s, %.2fx\n", numThreads, megabytesPerSecond, megabytesPerSecond / results[0]);
+    }
+    return results;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Writes the files of a directory into a pack file and mounts it, so the
+    same data can be read from a zip archive and from a pack file.
+*/
+static bool
+WritePackFile(const String& path, const String& pattern, const String& packDir)
+{
+    IoServer* ioServer = IoServer::Instance();
+    Ptr<PackArchiveWriter> writer = PackArchiveWriter::Create();
+    Array<String> files = ioServer->ListFiles(path, pattern);
+    for (const String& file : files)
+    {
+        writer->AddFile("zipstresstest/" + packDir + "/" + file, path + "/" + file);
+    }
+    return writer->Write("temp:zipstresstest.npk") && ioServer->MountArchive("temp:zipstresstest");
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -128,6 +207,22 @@ ZipStressTestApplication::Run()
     }
     while (anyRunning);
 
+    // the same files read from a zip archive and from a pack file
+    Array<double> zip = RunThroughputBenchmark("Zip", "tex:system", "*.dds");
+    if (WritePackFile("tex:system", "*.dds", "system"))
+    {
+        Array<double> pack = RunThroughputBenchmark("Pack", "temp:zipstresstest/system", "*.dds");
+        for (i = 0; i < zip.Size(); i++)
+        {
+            n_printf("    %d threads: pack reads %.2fx as fast as zip\n", 1 << i, pack[i] / zip[i]);
+        }
+        IoServer::Instance()->UnmountArchive("temp:zipstresstest");
+    }
+    else
+    {
+        n_printf("Failed to write temp:zipstresstest.npk, skipping the pack benchmark\n");
+    }
+
     n_printf("DONE.\n");
 }
 
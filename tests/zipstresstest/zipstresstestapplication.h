@@ -3,7 +3,8 @@
 /**
     @class ZipStressTestApplication
     
-    Multithreading stress test for zip file access.
+    Multithreading stress test for zip file access, also compares the read
+    throughput of zip archives and pack files.
     
     (C) 2009 Radon Labs GmbH
 */
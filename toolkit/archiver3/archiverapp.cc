@@ -20,7 +20,8 @@ using namespace IO;
 /**
 */
 ArchiverApp::ArchiverApp() :
-    webDeployFlag(false)
+    webDeployFlag(false),
+    packFlag(false)
 {
     // empty
 }
@@ -35,7 +36,8 @@ ArchiverApp::ShowHelp()
              "(C) Radon Labs GmbH\n"
              "Creates platform-specific asset archives (e.g. export.zip, export_win32.zip)\n"
              "-help -- display this help\n"
-             "-webdeploy -- create a web-deployment directory (only win32 platform)!\n");
+             "-webdeploy -- create a web-deployment directory (only win32 platform)!\n"
+             "-pack -- create a Nebula pack file (export.npk) instead of a zip archive\n");
 }
 
 //------------------------------------------------------------------------------
@@ -47,6 +49,7 @@ ArchiverApp::ParseCmdLineArgs()
     if (ToolkitApp::ParseCmdLineArgs())
     {
         this->webDeployFlag = this->args.GetBoolFlag("-webdeploy");
+        this->packFlag = this->args.GetBoolFlag("-pack");
         return true;
     }
     return false;
@@ -100,6 +103,13 @@ ArchiverApp::Run()
         return;
     }
     
+    // pack files are the same on all platforms and don't need an external tool
+    if (this->packFlag)
+    {
+        this->PackDirectoryNpk(this->projectInfo.GetAttr("DstDir"));
+        return;
+    }
+
     // invoke platformspecific packers
     switch (this->platform)
     {
@@ -272,7 +282,69 @@ ArchiverApp::PackDirectoryWin360(const String& dirPath)
         n_printf("WARNING: failed to launch converter tool '%s'!\n", this->toolPath.AsCharPtr());
     }
 }
+//------------------------------------------------------------------------------
+/**
+    Packs a single directory into a Nebula pack file, which is mounted
+    instead of the zip archive if both exist.
+*/
+void
+ArchiverApp::PackDirectoryNpk(const String& dirPath)
+{
+    IoServer* ioServer = IoServer::Instance();
+
+    // make sure the directory exists
+    if (!ioServer->DirectoryExists(dirPath))
+    {
+        n_printf("ERROR: dir '%s' does not exist!", dirPath.AsCharPtr());
+        return;
+    }
+
+    Ptr<PackArchiveWriter> writer = PackArchiveWriter::Create();
+    this->RecurseAddPackFiles(writer, dirPath, dirPath.ExtractFileName());
 
+    String filePath = dirPath + ".npk";
+    n_printf("Packing: %d files into %s\n", writer->GetNumFiles(), filePath.AsCharPtr());
+    if (!writer->Write(filePath))
+    {
+        n_printf("ERROR: failed to write '%s'!\n", filePath.AsCharPtr());
+    }
+}
 
+//------------------------------------------------------------------------------
+/**
+    Paths in the pack file start with the name of the packed directory,
+    like the paths in the zip archives.
+*/
+void
+ArchiverApp::RecurseAddPackFiles(PackArchiveWriter* writer, const String& srcDir, const String& pathInArchive)
+{
+    IoServer* ioServer = IoServer::Instance();
+    Array<String> files = ioServer->ListFiles(srcDir, "*");
+    IndexT fileIndex;
+    for (fileIndex = 0; fileIndex < files.Size(); fileIndex++)
+    {
+        bool excluded = false;
+        IndexT i;
+        for (i = 0; i < this->excludePatterns.Size() && !excluded; i++)
+        {
+            excluded = String::MatchPattern(files[fileIndex], this->excludePatterns[i]);
+        }
+        if (!excluded)
+        {
+            writer->AddFile(pathInArchive + "/" + files[fileIndex], srcDir + "/" + files[fileIndex]);
+        }
+    }
+
+    Array<String> dirs = ioServer->ListDirectories(srcDir, "*");
+    IndexT dirIndex;
+    for (dirIndex = 0; dirIndex < dirs.Size(); dirIndex++)
+    {
+        const String& curDir = dirs[dirIndex];
+        if ((curDir != "CVS") && (curDir != ".svn"))
+        {
+            this->RecurseAddPackFiles(writer, srcDir + "/" + curDir, pathInArchive + "/" + curDir);
+        }
+    }
+}
 
 } // namespace Toolkit
@@ -16,7 +16,7 @@
 #include "nflatbuffer/flatbufferinterface.h"
 #include "flat/physics/material.h"
 #include "jobs2/jobs2.h"
-#include "system/nebulasettings.h"
+#include "system/systeminfo.h"
 #include "toolkit-common/text.h"
 
 #ifdef WIN32
@@ -163,8 +163,10 @@ AssetBatcherApp::DoWork()
 
     Jobs2::JobSystemInitInfo systemInit;
     systemInit.name = "JobSystem";
-    systemInit.numThreads = 8;
+    systemInit.numThreads = System::NumCpuCores;
     systemInit.scratchMemorySize = 16_MB;
+    // the exporters run on the job fibers and need more stack than runtime jobs
+    systemInit.fiberStackSize = 2_MB;
     systemInit.affinity = System::Cpu::All;
     systemInit.enableIo = true;
     Jobs2::JobSystemInit(systemInit);
@@ -242,23 +244,6 @@ AssetBatcherApp::DoWork()
 
     AssignRegistry::Instance()->SetAssign(Assign("home","proj:"));
 
-    // check to see if the assetbatcher has been updated, in that case, force all assets to be rebuilt.
-    IO::FileTime cmdBinModifiedTime = IO::IoServer::Instance()->GetFileWriteTime(this->args.GetCmdName());
-    if (System::NebulaSettings::Exists("gscept", "ToolkitShared", "AssetBatcherTimeStamp"))
-    {
-        Util::String oldFileTime = System::NebulaSettings::ReadString("gscept", "ToolkitShared", "AssetBatcherTimeStamp");
-        if (IO::FileTime(oldFileTime) < cmdBinModifiedTime)
-        {
-            System::NebulaSettings::WriteString("gscept", "ToolkitShared", "AssetBatcherTimeStamp", cmdBinModifiedTime.AsString());
-            force = true;
-        }
-    }
-    else
-    {
-        System::NebulaSettings::WriteString("gscept", "ToolkitShared", "AssetBatcherTimeStamp", cmdBinModifiedTime.AsString());
-        force = true;
-    }
-
     exporter->Open();
     exporter->SetExportMode(mode);
     exporter->SetForce(force);
@@ -6,6 +6,7 @@
 #include "foundation/stdneb.h"
 #include "shaderbatcherapp.h"
 #include "timing/time.h"
+#include "system/systeminfo.h"
 
 namespace Toolkit
 {
@@ -28,6 +29,19 @@ ShaderBatcherApp::ParseCmdLineArgs()
             this->shaderCompiler.SetDstFrameShaderDir(output + "/frame");
             this->shaderCompiler.SetDstMaterialsDir(output + "/materials");
         }
+
+        // the processes which compile single shaders get the same settings
+        Util::String jobArgs = Util::String::Sprintf("-platform %s", Platform::ToString(this->platform).AsCharPtr());
+        if (this->args.GetBoolFlag("-debug"))
+        {
+            jobArgs.Append(" -debug");
+        }
+        if (!output.IsEmpty())
+        {
+            jobArgs.Append(Util::String::Sprintf(" -out \"%s\"", output.AsCharPtr()));
+        }
+        this->shaderCompiler.SetJobArgs(jobArgs);
+        this->shaderCompiler.SetNumJobs(Math::max(this->args.GetInt("-jobs", System::NumCpuCores), 1));
         return true;
     }
     return false;
@@ -42,6 +56,7 @@ ShaderBatcherApp::SetupProjectInfo()
     if (ToolkitApp::SetupProjectInfo())
     {
         this->shaderCompiler.SetPlatform(this->platform);
+        this->shaderCompiler.SetCacheDir("int:shadercache");
         if (this->projectInfo.HasAttr("ShaderToolParams"))
         {
             this->shaderCompiler.SetAdditionalParams(this->projectInfo.GetAttr("ShaderToolParams"));
@@ -78,7 +93,8 @@ ShaderBatcherApp::ShowHelp()
              "-platform   -- select platform (win32, linux)\n"
              "-waitforkey -- wait for key when complete\n"
              "-force      -- force recompile\n"
-             "-debug      -- compile with debugging information\n");             
+             "-debug      -- compile with debugging information\n"
+             "-jobs       -- number of shaders compiled at the same time (default: number of cores)\n");             
 }
 
 //------------------------------------------------------------------------------
@@ -101,6 +117,16 @@ ShaderBatcherApp::Run()
         success = false;
     }
 
+    // compile a single shader for the shaderbatcher which launched this process
+    if (success && this->args.HasArg("-shader"))
+    {
+        if (!this->shaderCompiler.CompileShader(this->args.GetString("-shader")))
+        {
+            this->SetReturnCode(-1);
+        }
+        return;
+    }
+
     // call the shader compiler tool
     if (success && !this->shaderCompiler.CompileShaders())
     {
@@ -0,0 +1,337 @@
+//------------------------------------------------------------------------------
+//  shadercache.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "shadercache.h"
+#include "io/ioserver.h"
+#include "io/binaryreader.h"
+#include "io/binarywriter.h"
+#include "io/fswrapper.h"
+#include "util/hash.h"
+
+using namespace Util;
+using namespace IO;
+namespace ToolkitUtil
+{
+
+static const uint RecordMagic = 'NSHC';
+static const uint RecordVersion = 1;
+
+//------------------------------------------------------------------------------
+/**
+    Combines two murmur hashes, the keys of all shaders end up in the
+    same comparison so 32 bits are not enough.
+*/
+static uint64_t
+Hash64(const void* data, SizeT size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    return uint64_t(Util::Hash(bytes, size, 4711)) | (uint64_t(Util::Hash(bytes, size, 0x9747b28c)) << 32);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+ShaderCache::ShaderCache()
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+    The compiler executable is identified by its size and write time, which
+    makes every shader recompile when the compiler was rebuilt. The path comes
+    from the OS rather than argv[0], so the batcher and the workers it launches
+    compute the same options no matter how they were started.
+*/
+String
+ShaderCache::MakeOptions(const Util::String& target, const std::vector<std::string>& defines, const std::vector<std::string>& flags)
+{
+    String options = String::Sprintf("%u;%s", RecordVersion, target.AsCharPtr());
+    for (const std::string& define : defines)
+    {
+        options.Append(";");
+        options.Append(define.c_str());
+    }
+    for (const std::string& flag : flags)
+    {
+        options.Append(";");
+        options.Append(flag.c_str());
+    }
+
+    IOStat stat;
+    const String exe = FSWrapper::GetExecutablePath();
+    if (IoServer::Instance()->GetIOInfo(exe, stat, false))
+    {
+        options.Append(String::Sprintf(";%llu;%u;%u", (unsigned long long)stat.size, stat.modifiedTime.GetHighBits(), stat.modifiedTime.GetLowBits()));
+    }
+    return options;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+ShaderCache::IsUpToDate(const Util::String& src, const Util::String& options, const Util::Array<Util::String>& outputs)
+{
+    if (!this->cacheDir.IsValid())
+    {
+        return false;
+    }
+
+    IoServer* ioServer = IoServer::Instance();
+    const String recordPath = this->GetRecordPath(src);
+    if (!ioServer->FileExists(recordPath))
+    {
+        return false;
+    }
+
+    Ptr<BinaryReader> reader = BinaryReader::Create();
+    reader->SetStream(ioServer->CreateStream(recordPath));
+    if (!reader->Open())
+    {
+        return false;
+    }
+    if (reader->ReadUInt() != RecordMagic || reader->ReadUInt() != RecordVersion)
+    {
+        reader->Close();
+        return false;
+    }
+    uint64_t key = reader->ReadUInt64();
+    Array<FileState> dependencies;
+    Array<FileState> recordedOutputs;
+    Array<FileState>* lists[] = { &dependencies, &recordedOutputs };
+    for (Array<FileState>* list : lists)
+    {
+        uint num = reader->ReadUInt();
+        list->Reserve(num);
+        uint i;
+        for (i = 0; i < num; i++)
+        {
+            FileState state;
+            state.path = reader->ReadString();
+            state.size = reader->ReadUInt64();
+            state.writeTime = reader->ReadUInt64();
+            state.hash = reader->ReadUInt64();
+            list->Append(state);
+        }
+    }
+    reader->Close();
+
+    // the outputs have to exist and be the ones this shader produced
+    if (recordedOutputs.Size() != outputs.Size())
+    {
+        return false;
+    }
+    bool refresh = false;
+    IndexT i;
+    for (i = 0; i < outputs.Size(); i++)
+    {
+        FileState& recorded = recordedOutputs[i];
+        if (recorded.path != URI(outputs[i]).LocalPath())
+        {
+            return false;
+        }
+        FileState state = GetFileState(recorded.path, &recorded);
+        if (state.hash == 0 || state.hash != recorded.hash)
+        {
+            return false;
+        }
+        refresh |= state.writeTime != recorded.writeTime;
+        recorded = state;
+    }
+
+    // dependencies which were touched are read again, the key only changes if their contents did
+    for (i = 0; i < dependencies.Size(); i++)
+    {
+        FileState state = GetFileState(dependencies[i].path, &dependencies[i]);
+        refresh |= state.size != dependencies[i].size || state.writeTime != dependencies[i].writeTime;
+        dependencies[i] = state;
+    }
+    if (ComputeKey(options, dependencies) != key)
+    {
+        return false;
+    }
+
+    if (refresh)
+    {
+        // remember the new write times so the touched files aren't read again next time
+        this->WriteRecord(src, key, dependencies, recordedOutputs);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+ShaderCache::Update(const Util::String& src, const Util::String& options, const Util::Array<Util::String>& dependencies, const Util::Array<Util::String>& outputs)
+{
+    if (!this->cacheDir.IsValid())
+    {
+        return;
+    }
+
+    Array<FileState> dependencyStates;
+    dependencyStates.Reserve(dependencies.Size() + 1);
+    Array<String> paths;
+    paths.Append(URI(src).LocalPath());
+    for (const String& dependency : dependencies)
+    {
+        String path = URI(dependency).LocalPath();
+        if (paths.FindIndex(path) == InvalidIndex)
+        {
+            paths.Append(path);
+        }
+    }
+    for (const String& path : paths)
+    {
+        dependencyStates.Append(GetFileState(path, nullptr));
+    }
+
+    Array<FileState> outputStates;
+    for (const String& output : outputs)
+    {
+        FileState state = GetFileState(URI(output).LocalPath(), nullptr);
+        if (state.hash == 0)
+        {
+            // a shader which didn't produce all outputs is never up to date
+            this->Invalidate(src);
+            return;
+        }
+        outputStates.Append(state);
+    }
+
+    this->WriteRecord(src, ComputeKey(options, dependencyStates), dependencyStates, outputStates);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+ShaderCache::Invalidate(const Util::String& src)
+{
+    if (!this->cacheDir.IsValid())
+    {
+        return;
+    }
+    const String recordPath = this->GetRecordPath(src);
+    if (IoServer::Instance()->FileExists(recordPath))
+    {
+        IoServer::Instance()->DeleteFile(recordPath);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Records are named after the shader and its full path, shaders with the
+    same name in the base and the custom directory don't share a record.
+*/
+String
+ShaderCache::GetRecordPath(const Util::String& src) const
+{
+    const String path = URI(src).LocalPath();
+    String name = path.ExtractFileName();
+    name.StripFileExtension();
+    const uint pathHash = Util::Hash((const uint8_t*)path.AsCharPtr(), path.Length());
+    return String::Sprintf("%s/%s_%08x.shdep", this->cacheDir.AsCharPtr(), name.AsCharPtr(), pathHash);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Files which don't exist get a hash of 0.
+*/
+ShaderCache::FileState
+ShaderCache::GetFileState(const Util::String& path, const FileState* prev)
+{
+    FileState state;
+    state.path = path;
+    state.size = 0;
+    state.writeTime = 0;
+    state.hash = 0;
+
+    IoServer* ioServer = IoServer::Instance();
+    IOStat stat;
+    if (!ioServer->FileExists(path) || !ioServer->GetIOInfo(path, stat, false))
+    {
+        return state;
+    }
+    state.size = stat.size;
+    state.writeTime = (uint64_t(stat.modifiedTime.GetHighBits()) << 32) | stat.modifiedTime.GetLowBits();
+    if (prev != nullptr && prev->hash != 0 && prev->size == state.size && prev->writeTime == state.writeTime)
+    {
+        state.hash = prev->hash;
+        return state;
+    }
+
+    Ptr<Stream> stream = ioServer->CreateStream(path);
+    stream->SetAccessMode(Stream::ReadAccess);
+    if (stream->Open())
+    {
+        const SizeT size = (SizeT)stream->GetSize();
+        state.hash = size > 0 ? Hash64(stream->Map(), size) : Hash64(nullptr, 0);
+        if (size > 0)
+        {
+            stream->Unmap();
+        }
+        stream->Close();
+
+        // 0 is reserved for files which don't exist
+        if (state.hash == 0)
+        {
+            state.hash = 1;
+        }
+    }
+    return state;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+uint64_t
+ShaderCache::ComputeKey(const Util::String& options, const Util::Array<FileState>& dependencies)
+{
+    String key = options;
+    for (const FileState& dependency : dependencies)
+    {
+        key.Append(";");
+        key.Append(dependency.path);
+        key.Append(String::Sprintf("=%08x%08x", uint(dependency.hash >> 32), uint(dependency.hash)));
+    }
+    return Hash64(key.AsCharPtr(), key.Length());
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+ShaderCache::WriteRecord(const Util::String& src, uint64_t key, const Util::Array<FileState>& dependencies, const Util::Array<FileState>& outputs)
+{
+    IoServer::Instance()->CreateDirectory(this->cacheDir);
+    Ptr<BinaryWriter> writer = BinaryWriter::Create();
+    writer->SetStream(IoServer::Instance()->CreateStream(this->GetRecordPath(src)));
+    if (!writer->Open())
+    {
+        n_printf("Couldn't write shader cache record for %s\n", src.AsCharPtr());
+        return;
+    }
+    writer->WriteUInt(RecordMagic);
+    writer->WriteUInt(RecordVersion);
+    writer->WriteUInt64(key);
+    const Array<FileState>* lists[] = { &dependencies, &outputs };
+    for (const Array<FileState>* list : lists)
+    {
+        writer->WriteUInt(list->Size());
+        for (const FileState& state : *list)
+        {
+            writer->WriteString(state.path);
+            writer->WriteUInt64(state.size);
+            writer->WriteUInt64(state.writeTime);
+            writer->WriteUInt64(state.hash);
+        }
+    }
+    writer->Close();
+}
+
+} // namespace ToolkitUtil
@@ -0,0 +1,89 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class ToolkitUtil::ShaderCache
+
+    Remembers the dependencies of compiled shaders between runs, so that
+    shaders which are up to date can be skipped without running the
+    preprocessor again.
+
+    Every shader gets its own record in the cache directory, which lists
+    the files it was compiled from with their content hashes, and the
+    outputs it produced. The key of a record is a hash of the compile
+    options, the compiler executable and the contents of all dependencies.
+    A shader is up to date if the key computed from the recorded
+    dependencies matches, touching a shared include without changing it
+    doesn't cause a recompile. Since the records are per shader, several
+    compiler processes may use the same cache directory at the same time.
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "util/array.h"
+#include "util/string.h"
+#include <vector>
+#include <string>
+
+//------------------------------------------------------------------------------
+namespace ToolkitUtil
+{
+class ShaderCache
+{
+public:
+    /// constructor
+    ShaderCache();
+
+    /// set the directory the records are kept in, caching is disabled without one
+    void SetCacheDir(const Util::String& dir);
+    /// get the directory the records are kept in
+    const Util::String& GetCacheDir() const;
+
+    /// build the options string of a compile, includes the compiler executable
+    static Util::String MakeOptions(const Util::String& target, const std::vector<std::string>& defines, const std::vector<std::string>& flags);
+    /// returns true if the outputs of a shader were compiled with the options from its current dependencies
+    bool IsUpToDate(const Util::String& src, const Util::String& options, const Util::Array<Util::String>& outputs);
+    /// record the dependencies and outputs of a shader which compiled successfully
+    void Update(const Util::String& src, const Util::String& options, const Util::Array<Util::String>& dependencies, const Util::Array<Util::String>& outputs);
+    /// remove the record of a shader, for example after it failed to compile
+    void Invalidate(const Util::String& src);
+
+private:
+    struct FileState
+    {
+        Util::String path;
+        uint64_t size;
+        uint64_t writeTime;
+        uint64_t hash;
+    };
+
+    /// get the path of the record of a shader
+    Util::String GetRecordPath(const Util::String& src) const;
+    /// get the state of a file, only reads it if its size or write time differ from the previous state
+    static FileState GetFileState(const Util::String& path, const FileState* prev);
+    /// compute the key from the options and the dependency hashes
+    static uint64_t ComputeKey(const Util::String& options, const Util::Array<FileState>& dependencies);
+    /// write a record
+    void WriteRecord(const Util::String& src, uint64_t key, const Util::Array<FileState>& dependencies, const Util::Array<FileState>& outputs);
+
+    Util::String cacheDir;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+ShaderCache::SetCacheDir(const Util::String& dir)
+{
+    this->cacheDir = dir;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline const Util::String&
+ShaderCache::GetCacheDir() const
+{
+    return this->cacheDir;
+}
+
+} // namespace ToolkitUtil
+//------------------------------------------------------------------------------
@@ -7,7 +7,10 @@
 #include "io/ioserver.h"
 #include "io/xmlreader.h"
 #include "coregraphics/config.h"
-#include "app/application.h"
+#include "io/fswrapper.h"
+#include "system/process.h"
+#include "timing/timer.h"
+#include "timing/time.h"
 
 #if __DX11__
 #include <d3dx11.h>
@@ -35,7 +38,8 @@ ShaderCompiler::ShaderCompiler() :
     platform(Platform::Win32),
     force(false),
     debug(false),
-    quiet(false)
+    quiet(false),
+    numJobs(1)
 {
     // empty
 }
@@ -94,35 +98,27 @@ ShaderCompiler::CompileShaders()
 
     // attempt compile base shaders
     bool retval = false;
+    const bool hasCustomShaders = this->srcShaderCustomDir.IsValid() && URI(this->srcShaderCustomDir) != URI(this->srcShaderBaseDir);
     if (this->language == "HLSL")
     {
         retval = this->CompileHLSL(this->srcShaderBaseDir);
-    }
-    else if (this->language == "GLSL")
-    {
-        retval = this->CompileGLSL(this->srcShaderBaseDir);
-    }
-    else if (this->language == "SPIRV")
-    {
-        retval = this->CompileSPIRV(this->srcShaderBaseDir);
-    }
-
-    if (this->srcShaderCustomDir.IsValid() && URI(this->srcShaderCustomDir) != URI(this->srcShaderBaseDir))
-    {
-        // attempt to compile custom shaders
-        if (this->language == "HLSL")
+        if (hasCustomShaders)
         {
+            // attempt to compile custom shaders
             this->CompileHLSL(this->srcShaderCustomDir);
         }
-        else if (this->language == "GLSL")
-        {
-            this->CompileGLSL(this->srcShaderCustomDir);
-        }
-        else if (this->language == "SPIRV")
+    }
+    else if (this->language == "GLSL" || this->language == "SPIRV")
+    {
+        // base and custom shaders are compiled together, so they can all run in parallel
+        Array<String> srcDirs;
+        srcDirs.Append(this->srcShaderBaseDir);
+        if (hasCustomShaders)
         {
-            this->CompileSPIRV(this->srcShaderCustomDir);
+            srcDirs.Append(this->srcShaderCustomDir);
         }
-    }    
+        retval = this->CompileAnyFX(srcDirs);
+    }
 
     if (retval)
     {
@@ -395,241 +391,286 @@ ShaderCompiler::CompileHLSL(const Util::String& srcPath)
 //------------------------------------------------------------------------------
 /**
     Implemented using AnyFX
+
+    Shaders are first checked against the shader cache, which only reads
+    their recorded dependencies. The AnyFX preprocessor keeps global state,
+    so instead of threads the remaining shaders are compiled by several
+    processes at the same time.
 */
-bool 
-ShaderCompiler::CompileGLSL(const Util::String& srcPath)
+bool
+ShaderCompiler::CompileAnyFX(const Util::Array<Util::String>& srcDirs)
 {
     const Ptr<IoServer>& ioServer = IoServer::Instance();
 
-    // list files in directory
-    Array<String> srcFiles = ioServer->ListFiles(srcPath, "*.fx");
-
 #ifndef __ANYFX__
-    n_printf("Error: Cannot compile DX11 shaders without DX11 support\n");
+    n_printf("Error: Cannot compile shaders without AnyFX support\n");
     return false;
 #endif
 
 #if __ANYFX__
-    // start AnyFX compilation
-    AnyFXBeginCompile();
+    Timing::Timer timer;
+    timer.Start();
 
-    // go through all files and compile
-    IndexT j;
-    for (j = 0; j < srcFiles.Size(); j++)
+    // find the shaders which have to be compiled
+    Array<String> srcFiles;
+    SizeT numShaders = 0;
+    for (const String& srcDir : srcDirs)
     {
-        // get file
-        String file = srcFiles[j];
-
-        // format string with file
-        String srcFile = srcPath + "/" + file;
-
-        // format destination
-        String destFile = this->dstShaderDir + "/" + file;
-        destFile.StripFileExtension();
-        file.StripFileExtension();
-
-        URI src(srcFile);
-        URI dst(destFile);
-
-        // add to dictionary
-        this->shaderNames.Append(file);
-
-        if (this->CheckRecompile(srcFile, destFile))
+        Array<String> files = ioServer->ListFiles(srcDir, "*.fx");
+        for (const String& file : files)
         {
-            // compile
-            n_printf("Compiling:\n   %s -> %s\n", src.LocalPath().AsCharPtr(), dst.LocalPath().AsCharPtr());
-
-            URI shaderFolder("toolkit:work/shaders/gl");
-            std::vector<std::string> defines;
-            std::vector<std::string> flags;
-            Util::String define;
-            define.Format("-D GLSL");
-            defines.push_back(define.AsCharPtr());
-
-            // first include this folder
-            define.Format("-I%s/", URI(srcPath).LocalPath().AsCharPtr());
-            defines.push_back(define.AsCharPtr());
+            String srcFile = srcDir + "/" + file;
+            String name = file;
+            name.StripFileExtension();
 
-            // then include the N3 toolkit shaders folder
-            define.Format("-I%s/", shaderFolder.LocalPath().AsCharPtr());
-            defines.push_back(define.AsCharPtr());
+            // add to dictionary
+            this->shaderNames.Append(name);
+            numShaders++;
 
-            // set flags
-            flags.push_back("/NOSUB");      // deactivate subroutine usage
-            flags.push_back("/GBLOCK");     // put all shader variables outside of explicit buffers in one global block
-
-            // if using debug, output raw shader code
-            if (this->debug)
+            if (this->force || !this->IsUpToDate(srcFile))
             {
-                flags.push_back("/O");
+                srcFiles.Append(srcFile);
             }
-            
-            AnyFXErrorBlob* errors = NULL;
+        }
+    }
 
-            // this will get the highest possible value for the GL version, now clamp the minor and major to the one supported by glew
-            int major = 4;
-            int minor = 4;
-            
-            Util::String target;
-            target.Format("gl%d%d", major, minor);
-            Util::String escapedSrc = src.LocalPath();
-            //escapedSrc.SubstituteString(" ", "\\ ");
-            Util::String escapedDst = dst.LocalPath();
-            //escapedDst.SubstituteString(" ", "\\ ");
-            
-            bool res = AnyFXCompile(escapedSrc.AsCharPtr(), escapedDst.AsCharPtr(), target.AsCharPtr(), nullptr, "Khronos", defines, flags, &errors);
-            if (!res)
-            {
-                if (errors)
-                {
-                    n_printf("%s\n", errors->buffer);
-                    delete errors;
-                    errors = 0;
-                }
-                return false;
-            }
-            else if (errors)
-            {
-                n_printf("%s\n", errors->buffer);
-                delete errors;
-                errors = 0;
-            }
+    bool success = true;
+    if (this->numJobs > 1 && srcFiles.Size() > 1)
+    {
+        success = this->RunJobs(srcFiles);
+    }
+    else
+    {
+        // start AnyFX compilation
+        AnyFXBeginCompile();
+
+        for (const String& srcFile : srcFiles)
+        {
+            success &= this->CompileAnyFXFile(srcFile);
         }
+
+        // stop AnyFX compilation
+        AnyFXEndCompile();
     }
 
-    // stop AnyFX compilation
-    AnyFXEndCompile();
+    timer.Stop();
+    n_printf("%d shaders: %d compiled, %d up to date (%.2f s)\n", numShaders, srcFiles.Size(), numShaders - srcFiles.Size(), timer.GetTime());
+    return success;
 #else
-#error "No GLSL compiler implemented! (use definition __ANYFX__ to fix this)"
+#error "No GLSL or SPIR-V compiler implemented! (use definition __ANYFX__ to fix this)"
 #endif
-
-    return true;
 }
 
 //------------------------------------------------------------------------------
 /**
+    Used by the processes RunJobs launches, the shader is always compiled.
 */
 bool
-ShaderCompiler::CompileSPIRV(const Util::String& srcPath)
+ShaderCompiler::CompileShader(const Util::String& srcFile)
 {
-    const Ptr<IoServer>& ioServer = IoServer::Instance();
-
-    // list files in directory
-    Array<String> srcFiles = ioServer->ListFiles(srcPath, "*.fx");
-
 #ifndef __ANYFX__
-    n_printf("Error: Cannot compile DX11 shaders without DX11 support\n");
+    n_printf("Error: Cannot compile shaders without AnyFX support\n");
     return false;
 #endif
 
 #if __ANYFX__
-    // start AnyFX compilation
-    AnyFXBeginCompile();
-
-    // go through all files and compile
-    IndexT j;
-    for (j = 0; j < srcFiles.Size(); j++)
+    if (!IoServer::Instance()->FileExists(srcFile))
     {
-        // get file
-        String file = srcFiles[j];
-
-        // format string with file
-        String srcFile = srcPath + "/" + file;
-
-        // format destination
-        String destFile = this->dstShaderDir + "/" + file;
-        destFile.StripFileExtension();
-        file.StripFileExtension();
-
-        // add to dictionary
-        this->shaderNames.Append(file);
-
-        URI shaderFolder(this->srcShaderBaseDir);
-        std::vector<std::string> defines;
-        std::vector<std::string> flags;
-        Util::String define;
-        define.Format("-D GLSL");
-        defines.push_back(define.AsCharPtr());
-
-        // first include this folder
-        define.Format("-I%s/", URI(srcPath).LocalPath().AsCharPtr());
-        defines.push_back(define.AsCharPtr());
-
-        // then include the N3 toolkit shaders folder
-        define.Format("-I%s/", shaderFolder.LocalPath().AsCharPtr());
-        defines.push_back(define.AsCharPtr());
+        n_printf("Error: shader source '%s' not found!\n", srcFile.AsCharPtr());
+        return false;
+    }
+    IoServer::Instance()->CreateDirectory(this->dstShaderDir);
 
-        URI src(srcFile);
-        URI dst(destFile);
+    AnyFXBeginCompile();
+    bool success = this->CompileAnyFXFile(srcFile);
+    AnyFXEndCompile();
+    return success;
+#else
+#error "No GLSL or SPIR-V compiler implemented! (use definition __ANYFX__ to fix this)"
+#endif
+}
 
-        bool needRecompile = false;
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+ShaderCompiler::CompileAnyFXFile(const Util::String& srcFile)
+{
+#if __ANYFX__
+    const String destFile = this->GetOutput(srcFile);
+    URI src(srcFile);
+    URI dst(destFile);
+
+    String target;
+    std::vector<std::string> defines;
+    std::vector<std::string> flags;
+    this->GetCompileArgs(srcFile, target, defines, flags);
+
+    // compile
+    n_printf("Compiling:\n   %s -> %s\n", src.LocalPath().AsCharPtr(), dst.LocalPath().AsCharPtr());
+
+    AnyFXErrorBlob* errors = NULL;
+    Util::String escapedSrc = src.LocalPath();
+    Util::String escapedDst = dst.LocalPath();
+    bool res = AnyFXCompile(escapedSrc.AsCharPtr(), escapedDst.AsCharPtr(), target.AsCharPtr(), nullptr, "Khronos", defines, flags, &errors);
+    if (errors)
+    {
+        n_printf("%s\n", errors->buffer);
+        delete errors;
+        errors = 0;
+    }
+    if (!res)
+    {
+        this->cache.Invalidate(srcFile);
+        return false;
+    }
 
-        // generate dependencies
-        std::vector<std::string> deps = AnyFXGenerateDependencies(src.LocalPath().AsCharPtr(), defines);
+    // remember what the shader was compiled from, the first dependency is the shader itself
+    std::vector<std::string> deps = AnyFXGenerateDependencies(escapedSrc.AsCharPtr(), defines);
+    Array<String> dependencies;
+    size_t i;
+    for (i = 1; i < deps.size(); i++)
+    {
+        dependencies.Append(deps[i].c_str());
+    }
+    Array<String> outputs;
+    outputs.Append(destFile);
+    this->cache.Update(srcFile, ShaderCache::MakeOptions(target, defines, flags), dependencies, outputs);
+    return true;
+#else
+    return false;
+#endif
+}
 
-        uint i;
-        for (i = 1; i < deps.size(); i++)
+//------------------------------------------------------------------------------
+/**
+    Launches this executable with -shader for every shader, at most numJobs
+    at a time. The workers are started from the path of the running executable,
+    so their shader cache options match ours. A worker only updates the shader cache if its shader compiled,
+    so the cache tells whether it succeeded.
+*/
+bool
+ShaderCompiler::RunJobs(const Util::Array<Util::String>& srcFiles)
+{
+    const String exe = IO::FSWrapper::GetExecutablePath();
+    FixedArray<System::Process> processes(this->numJobs);
+    FixedArray<IndexT> running(this->numJobs, InvalidIndex);
+    SizeT numRunning = 0;
+    IndexT next = 0;
+    bool success = true;
+    while (next < srcFiles.Size() || numRunning > 0)
+    {
+        IndexT i;
+        for (i = 0; i < processes.Size(); i++)
+        {
+            if (running[i] != InvalidIndex && !processes[i].IsRunning())
+            {
+                const String& srcFile = srcFiles[running[i]];
+                if (!this->IsUpToDate(srcFile))
+                {
+                    n_printf("Error: failed to compile %s\n", URI(srcFile).LocalPath().AsCharPtr());
+                    success = false;
+                }
+                running[i] = InvalidIndex;
+                numRunning--;
+            }
+            if (running[i] == InvalidIndex && next < srcFiles.Size())
+            {
+                processes[i].SetExecutable(exe);
+                processes[i].SetWorkingDirectory("proj:");
+                processes[i].SetArguments(String::Sprintf("%s -shader \"%s\"", this->jobArgs.AsCharPtr(), URI(srcFiles[next]).LocalPath().AsCharPtr()));
+                if (processes[i].Launch())
+                {
+                    running[i] = next;
+                    numRunning++;
+                }
+                else
+                {
+                    n_printf("Error: couldn't launch %s to compile %s\n", exe.AsCharPtr(), srcFiles[next].AsCharPtr());
+                    success = false;
+                }
+                next++;
+            }
+        }
+        if (numRunning > 0)
         {
-            Util::String dep = deps[i].c_str();
-            needRecompile |= this->CheckRecompile(dep, destFile);
+            Timing::Sleep(0.01);
         }
-        needRecompile |= this->CheckRecompile(srcFile, destFile);
-        needRecompile |= this->CheckRecompile(App::Application::Instance()->GetCmdLineArgs().GetCmdName(), destFile);
+    }
+    return success;
+}
 
-        if (needRecompile)
-        {
-            // compile
-            n_printf("Compiling %s:\n   %s -> %s\n", srcFile.AsCharPtr(), src.LocalPath().AsCharPtr(), dst.LocalPath().AsCharPtr());
+//------------------------------------------------------------------------------
+/**
+*/
+void
+ShaderCompiler::GetCompileArgs(const Util::String& srcFile, Util::String& target, std::vector<std::string>& defines, std::vector<std::string>& flags) const
+{
+    String srcPath = srcFile.ExtractDirName();
+    srcPath.TrimRight("/");
 
-            // set flags
-            flags.push_back("/NOSUB");          // deactivate subroutine usage, effectively expands all subroutines as functions
-            flags.push_back("/GBLOCK");         // put all shader variables outside of an explicit block in one global block
-            flags.push_back(Util::String::Sprintf("/DEFAULTSET %d", NEBULA_BATCH_GROUP).AsCharPtr());   // since we want the most frequently switched set as high as possible, we send the default set to 8, must match the NEBULAT_DEFAULT_GROUP in std.fxh and DEFAULT_GROUP in coregraphics/config.h
+    Util::String define;
+    define.Format("-D GLSL");
+    defines.push_back(define.AsCharPtr());
 
-            // if using debug, output raw shader code
-            if (this->debug)
-            {
-                flags.push_back("/O");
-            }
+    // first include this folder
+    define.Format("-I%s/", URI(srcPath).LocalPath().AsCharPtr());
+    defines.push_back(define.AsCharPtr());
 
-            AnyFXErrorBlob* errors = NULL;
+    // set flags
+    flags.push_back("/NOSUB");          // deactivate subroutine usage, effectively expands all subroutines as functions
+    flags.push_back("/GBLOCK");         // put all shader variables outside of an explicit block in one global block
 
-            // this will get the highest possible value for the GL version, now clamp the minor and major to the one supported by glew
-            int major = 1;
-            int minor = 0;
+    if (this->language == "SPIRV")
+    {
+        // then include the base shaders folder
+        define.Format("-I%s/", URI(this->srcShaderBaseDir).LocalPath().AsCharPtr());
+        defines.push_back(define.AsCharPtr());
 
-            Util::String target;
-            target.Format("spv%d%d", major, minor);
-            Util::String escapedSrc = src.LocalPath();
-            Util::String escapedDst = dst.LocalPath();
+        flags.push_back(Util::String::Sprintf("/DEFAULTSET %d", NEBULA_BATCH_GROUP).AsCharPtr());   // since we want the most frequently switched set as high as possible, we send the default set to 8, must match the NEBULAT_DEFAULT_GROUP in std.fxh and DEFAULT_GROUP in coregraphics/config.h
+        target.Format("spv%d%d", 1, 0);
+    }
+    else
+    {
+        // then include the N3 toolkit shaders folder
+        define.Format("-I%s/", URI("toolkit:work/shaders/gl").LocalPath().AsCharPtr());
+        defines.push_back(define.AsCharPtr());
 
-            bool res = AnyFXCompile(escapedSrc.AsCharPtr(), escapedDst.AsCharPtr(), target.AsCharPtr(), nullptr, "Khronos", defines, flags, &errors);
-            if (!res)
-            {
-                if (errors)
-                {
-                    n_printf("%s\n", errors->buffer);
-                    delete errors;
-                    errors = 0;
-                }
-                return false;
-            }
-            else if (errors)
-            {
-                n_printf("%s\n", errors->buffer);
-                delete errors;
-                errors = 0;
-            }
-        }
+        // clamp the GL version to the one supported by glew
+        target.Format("gl%d%d", 4, 4);
     }
 
-    // stop AnyFX compilation
-    AnyFXEndCompile();
-#else
-#error "No SPIR-V compiler implemented! (use definition __ANYFX__ to fix this)"
-#endif
+    // if using debug, output raw shader code
+    if (this->debug)
+    {
+        flags.push_back("/O");
+    }
+}
 
-    return true;
+//------------------------------------------------------------------------------
+/**
+*/
+String
+ShaderCompiler::GetOutput(const Util::String& srcFile) const
+{
+    String file = srcFile.ExtractFileName();
+    file.StripFileExtension();
+    return this->dstShaderDir + "/" + file;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+ShaderCompiler::IsUpToDate(const Util::String& srcFile)
+{
+    String target;
+    std::vector<std::string> defines;
+    std::vector<std::string> flags;
+    this->GetCompileArgs(srcFile, target, defines, flags);
+    Array<String> outputs;
+    outputs.Append(this->GetOutput(srcFile));
+    return this->cache.IsUpToDate(srcFile, ShaderCache::MakeOptions(target, defines, flags), outputs);
 }
 
 //------------------------------------------------------------------------------
@@ -4,6 +4,10 @@
     @class ToolkitUtil::ShaderCompiler
     
     Compiles DX FX files.
+
+    GLSL and SPIR-V shaders are skipped if the shader cache finds them up
+    to date, the others are compiled by several instances of the batcher at
+    the same time, each launched with -shader for a single file.
     
     (C) 2012 Gustav Sterbrant
 */
@@ -11,6 +15,7 @@
 #include "toolkit-common/platform.h"
 #include "io/uri.h"
 #include "util/string.h"
+#include "shadercache.h"
 namespace ToolkitUtil
 {
 class ShaderCompiler
@@ -52,9 +57,17 @@ public:
     void SetAdditionalParams(const Util::String& params);
     /// set quiet flag
     void SetQuietFlag(bool b);
+    /// set the directory the shader cache is kept in
+    void SetCacheDir(const Util::String& dir);
+    /// set the number of shaders which are compiled at the same time, with 1 they are compiled in this process
+    void SetNumJobs(SizeT num);
+    /// set the arguments passed to the processes which compile single shaders
+    void SetJobArgs(const Util::String& args);
 
     /// compile all shaders 
     bool CompileShaders();
+    /// compile a single shader in this process
+    bool CompileShader(const Util::String& srcFile);
     /// compile frame shader files
     bool CompileFrameShaders();
     /// compile materials
@@ -65,10 +78,18 @@ private:
     bool CheckRecompile(const Util::String& srcPath, const Util::String& dstPath);
     /// compile shaders for HLSL
     bool CompileHLSL(const Util::String& srcPath);
-    /// compiles shaders for glsl
-    bool CompileGLSL(const Util::String& srcPath);
-    /// compiles shaders for SPIRV
-    bool CompileSPIRV(const Util::String& srcPath);
+    /// compile GLSL or SPIRV shaders with AnyFX, skipping the ones which are up to date
+    bool CompileAnyFX(const Util::Array<Util::String>& srcDirs);
+    /// compile a single shader with AnyFX, must be called between AnyFXBeginCompile and AnyFXEndCompile
+    bool CompileAnyFXFile(const Util::String& srcFile);
+    /// compile shaders in parallel, each in its own process
+    bool RunJobs(const Util::Array<Util::String>& srcFiles);
+    /// get the target, defines and flags a shader is compiled with
+    void GetCompileArgs(const Util::String& srcFile, Util::String& target, std::vector<std::string>& defines, std::vector<std::string>& flags) const;
+    /// get the compiled file of a shader
+    Util::String GetOutput(const Util::String& srcFile) const;
+    /// check the shader cache for a shader
+    bool IsUpToDate(const Util::String& srcFile);
     /// write shader dictionary
     bool WriteShaderDictionary();
 
@@ -88,6 +109,9 @@ private:
     bool debug;
     Util::String additionalParams;
     Util::Array<Util::String> shaderNames;
+    ShaderCache cache;
+    SizeT numJobs;
+    Util::String jobArgs;
 }; 
 
 //------------------------------------------------------------------------------
@@ -225,5 +249,32 @@ ShaderCompiler::SetQuietFlag(bool b)
     this->quiet = b;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+ShaderCompiler::SetCacheDir(const Util::String& dir)
+{
+    this->cache.SetCacheDir(dir);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+ShaderCompiler::SetNumJobs(SizeT num)
+{
+    this->numJobs = num;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+ShaderCompiler::SetJobArgs(const Util::String& args)
+{
+    this->jobArgs = args;
+}
+
 } // namespace ToolkitUtil
 //------------------------------------------------------------------------------
\ No newline at end of file
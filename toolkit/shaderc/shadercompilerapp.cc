@@ -28,6 +28,9 @@ ShaderCompilerApp::ParseCmdLineArgs()
         this->shaderCompiler.SetDstBinary(this->args.GetString("-o"));
         this->shaderCompiler.SetDstHeader(this->args.GetString("-h"));
 
+        // the dependency records are kept next to the generated headers, unless told otherwise
+        this->shaderCompiler.SetCacheDir(this->args.HasArg("-cache") ? this->args.GetString("-cache") : this->args.GetString("-h"));
+
         // find include dir args
         for (SizeT i = 0; i < this->args.GetNumArgs(); i++)
         {
@@ -151,9 +151,6 @@ SingleShaderCompiler::CompileGLSL(const Util::String& srcf)
 #endif
 
 #if __ANYFX__
-    // start AnyFX compilation
-    AnyFXBeginCompile();
-
     Util::String file = srcf.ExtractFileName();
     file.StripFileExtension();
     // format destination
@@ -162,9 +159,6 @@ SingleShaderCompiler::CompileGLSL(const Util::String& srcf)
     URI src(srcf);
     URI dst(destFile);
 
-    // compile
-    n_printf("[shaderc] Compiling:\n   %s -> %s\n", src.LocalPath().AsCharPtr(), dst.LocalPath().AsCharPtr());
-
     std::vector<std::string> defines;
     std::vector<std::string> flags;
     Util::String define;
@@ -211,6 +205,22 @@ SingleShaderCompiler::CompileGLSL(const Util::String& srcf)
         , std::make_pair(NEBULA_DYNAMIC_OFFSET_GROUP, "DynamicOffset")
     };
 
+    // skip the shader if neither its dependencies nor the options changed since it was compiled
+    const Util::String options = ShaderCache::MakeOptions(target, defines, flags);
+    Util::Array<Util::String> outputs;
+    outputs.Append(destFile);
+    if (this->cache.IsUpToDate(srcf, options, outputs))
+    {
+        n_printf("[shaderc] Up to date:\n   %s\n", src.LocalPath().AsCharPtr());
+        return true;
+    }
+
+    // compile
+    n_printf("[shaderc] Compiling:\n   %s -> %s\n", src.LocalPath().AsCharPtr(), dst.LocalPath().AsCharPtr());
+
+    // start AnyFX compilation
+    AnyFXBeginCompile();
+
     bool res = AnyFXCompile(
         escapedSrc.AsCharPtr()
         , escapedDst.AsCharPtr()
@@ -231,6 +241,7 @@ SingleShaderCompiler::CompileGLSL(const Util::String& srcf)
             delete errors;
             errors = 0;
         }
+        this->cache.Invalidate(srcf);
         return false;
     }
     else if (errors)
@@ -239,6 +250,7 @@ SingleShaderCompiler::CompileGLSL(const Util::String& srcf)
         delete errors;
         errors = 0;
     }
+    this->UpdateCache(srcf, options, defines, outputs);
 
     // stop AnyFX compilation
     AnyFXEndCompile();
@@ -263,10 +275,6 @@ SingleShaderCompiler::CompileSPIRV(const Util::String& srcf)
 #endif
 
 #if __ANYFX__
-    // start AnyFX compilation
-    AnyFXBeginCompile();
-
-    
     Util::String file = srcf.ExtractFileName();
     Util::String folder = srcf.ExtractDirName();
     file.StripFileExtension();
@@ -279,11 +287,6 @@ SingleShaderCompiler::CompileSPIRV(const Util::String& srcf)
     URI dst(destFile);
     URI dstH(destHeader);
 
-    // compile
-    n_printf("[shaderc] \n Compiling:\n   %s -> %s", src.LocalPath().AsCharPtr(), dst.LocalPath().AsCharPtr());
-    n_printf("          \n Generating:\n   %s -> %s\n", src.LocalPath().AsCharPtr(), dstH.LocalPath().AsCharPtr());
-
-    
     std::vector<std::string> defines;
     std::vector<std::string> flags;
     Util::String define;
@@ -332,6 +335,24 @@ SingleShaderCompiler::CompileSPIRV(const Util::String& srcf)
         , std::make_pair(NEBULA_DYNAMIC_OFFSET_GROUP, "DynamicOffset")
     };
 
+    // skip the shader if neither its dependencies nor the options changed since it was compiled
+    const Util::String options = ShaderCache::MakeOptions(target, defines, flags);
+    Util::Array<Util::String> outputs;
+    outputs.Append(destFile);
+    outputs.Append(destHeader);
+    if (this->cache.IsUpToDate(srcf, options, outputs))
+    {
+        n_printf("[shaderc] Up to date:\n   %s\n", src.LocalPath().AsCharPtr());
+        return true;
+    }
+
+    // compile
+    n_printf("[shaderc] \n Compiling:\n   %s -> %s", src.LocalPath().AsCharPtr(), dst.LocalPath().AsCharPtr());
+    n_printf("          \n Generating:\n   %s -> %s\n", src.LocalPath().AsCharPtr(), dstH.LocalPath().AsCharPtr());
+
+    // start AnyFX compilation
+    AnyFXBeginCompile();
+
     bool res = AnyFXCompile(
         escapedSrc.AsCharPtr()
         , escapedDst.AsCharPtr()
@@ -351,6 +372,7 @@ SingleShaderCompiler::CompileSPIRV(const Util::String& srcf)
             delete errors;
             errors = 0;
         }
+        this->cache.Invalidate(srcf);
         return false;
     }
     else if (errors)
@@ -359,6 +381,8 @@ SingleShaderCompiler::CompileSPIRV(const Util::String& srcf)
         delete errors;
         errors = 0;
     }
+    this->UpdateCache(srcf, options, defines, outputs);
+
     // stop AnyFX compilation
     AnyFXEndCompile();
 #else
@@ -436,5 +460,24 @@ const Ptr<IoServer>& ioServer = IoServer::Instance();
     return true;
 }
 
+//------------------------------------------------------------------------------
+/**
+    The dependencies are generated after the compile succeeded, the first
+    one is the shader itself.
+*/
+void
+SingleShaderCompiler::UpdateCache(const Util::String& srcf, const Util::String& options, const std::vector<std::string>& defines, const Util::Array<Util::String>& outputs)
+{
+#if __ANYFX__
+    std::vector<std::string> deps = AnyFXGenerateDependencies(URI(srcf).LocalPath().AsCharPtr(), defines);
+    Util::Array<Util::String> dependencies;
+    size_t i;
+    for (i = 1; i < deps.size(); i++)
+    {
+        dependencies.Append(deps[i].c_str());
+    }
+    this->cache.Update(srcf, options, dependencies, outputs);
+#endif
+}
 
 } // namespace ToolkitUtil
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include "toolkit-common/platform.h"
 #include "io/uri.h"
 #include "util/string.h"
+#include "shaderbatcher/shadercache.h"
 
 namespace ToolkitUtil
 {
@@ -40,6 +41,8 @@ public:
     void SetAdditionalParams(const Util::String& params);
     /// set quiet flag
     void SetQuietFlag(bool b);
+    /// set the directory the shader cache is kept in
+    void SetCacheDir(const Util::String& dir);
 
     /// compile shader
     bool CompileShader(const Util::String& src);
@@ -56,6 +59,8 @@ private:
     bool CompileGLSL(const Util::String& src);
     /// compiles shaders for SPIRV
     bool CompileSPIRV(const Util::String& src);
+    /// record the dependencies of a compiled shader in the shader cache
+    void UpdateCache(const Util::String& src, const Util::String& options, const std::vector<std::string>& defines, const Util::Array<Util::String>& outputs);
     
     Platform::Code platform;    
     Util::String dstBinary;    
@@ -65,6 +70,7 @@ private:
     bool debug;
     Util::String additionalParams;
     Util::Array<Util::String> includeDirs;  
+    ShaderCache cache;
 }; 
 
 //------------------------------------------------------------------------------
@@ -140,5 +146,14 @@ SingleShaderCompiler::SetQuietFlag(bool b)
     this->quiet = b;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+SingleShaderCompiler::SetCacheDir(const Util::String& dir)
+{
+    this->cache.SetCacheDir(dir);
+}
+
 } // namespace ToolkitUtil
 //------------------------------------------------------------------------------
\ No newline at end of file
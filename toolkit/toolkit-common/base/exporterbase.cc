@@ -297,6 +297,7 @@ void
 ExporterBase::WriteIntermediateFile(const IO::URI& sourceFile, Util::Array<IO::URI> const& output)
 {
 	IO::URI const assetPath = "src:";
+	this->exportedFiles = output;
 	Ptr<JsonWriter> writer = JsonWriter::Create();
 	Util::String intermediateFile = sourceFile.LocalPath();
 	intermediateFile.SubstituteString(assetPath.LocalPath(), "intermediate:");
@@ -45,6 +45,8 @@ public:
 
     /// call this after exporting a file. This will generate an intermediate file that is used to keep track of source <-> export linkage
     void WriteIntermediateFile(const IO::URI& sourceFile, Util::Array<IO::URI> const& output);
+    /// get the files written by the last export, as passed to WriteIntermediateFile
+    const Util::Array<IO::URI>& GetExportedFiles() const;
 
     /// exports a single file
     virtual void ExportFile(const IO::URI& file);
@@ -109,6 +111,7 @@ protected:
     ExporterProgressCallback progressCallback;
     ExporterMinMaxCallback  minMaxCallback;
     ToolkitUtil::Logger* logger;
+    Util::Array<IO::URI> exportedFiles;
 
     bool hasErrors;
 
@@ -126,6 +129,15 @@ ExporterBase::IsOpen() const
     return this->isOpen;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+inline const Util::Array<IO::URI>&
+ExporterBase::GetExportedFiles() const
+{
+    return this->exportedFiles;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -39,6 +39,7 @@ Logger::Error(const char* msg, ...)
     va_start(argList, msg);
     String str;
     str.FormatArgList(msg, argList);
+    Threading::CriticalScope scope(&this->cs);
     this->messages.Append(String("[ERROR] ") + str);
     if (this->verbose)
     {
@@ -57,6 +58,7 @@ Logger::Warning(const char* msg, ...)
     va_start(argList, msg);
     String str;
     str.FormatArgList(msg, argList);
+    Threading::CriticalScope scope(&this->cs);
     this->messages.Append(String("[WARNING] ") + str);
     if (this->verbose)
     {
@@ -75,6 +77,7 @@ Logger::Print(const char* msg, ...)
     va_start(argList, msg);
     String str;
     str.FormatArgList(msg, argList);
+    Threading::CriticalScope scope(&this->cs);
     this->messages.Append(str);
     if (this->verbose)
     {
@@ -3,7 +3,8 @@
 /**
     @class ToolkitUtil::Logger
     
-    A simple logger for error messages and warnings.
+    A simple logger for error messages and warnings. Messages can be
+    put from several threads at once.
     
     (C) 2008 Radon Labs GmbH
     (C) 2013-2016 Individual contributors, see AUTHORS file
@@ -11,6 +12,7 @@
 #include "util/string.h"
 #include "util/array.h"
 #include "util/stack.h"
+#include "threading/criticalsection.h"
 
 //------------------------------------------------------------------------------
 namespace ToolkitUtil
@@ -42,6 +44,7 @@ public:
 protected:
     bool verbose;
 
+    Threading::CriticalSection cs;
     Util::String indent;
     Util::Array<Util::String> messages;
 };
@@ -70,6 +73,7 @@ Logger::GetVerbose() const
 inline void 
 Logger::Indent()
 {
+    Threading::CriticalScope scope(&this->cs);
     this->indent += "    ";
 }
 
@@ -79,6 +83,7 @@ Logger::Indent()
 inline void 
 Logger::Unindent()
 {
+    Threading::CriticalScope scope(&this->cs);
     this->indent = this->indent.ExtractRange(0, this->indent.Length() - 4);
 }
 
@@ -103,12 +103,19 @@ ToolkitConsoleHandler::DebugOut(const String& s)
 void
 ToolkitConsoleHandler::Clear()
 {
+    Threading::CriticalScope scope(&this->cs);
     Threading::ThreadId id = Threading::Thread::GetMyThreadId();
     if (this->log.Contains(id))
     {
         this->currentFlags[id] = 0;
         this->log[id].Clear();
-    }   
+    }
+    else
+    {
+        // register the thread, so that its log can be queried before anything was printed
+        this->log.Add(id, Util::Array<LogEntry>());
+        this->currentFlags.Add(id, 0);
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -117,6 +124,7 @@ ToolkitConsoleHandler::Clear()
 Util::Array<Util::String>
 ToolkitConsoleHandler::GetErrors()
 {
+    Threading::CriticalScope scope(&this->cs);
     Threading::ThreadId id = Threading::Thread::GetMyThreadId();
     Util::Array<Util::String> errors;
     for (Util::Array<LogEntry>::Iterator iter = this->log[id].Begin(); iter != this->log[id].End(); iter++)
@@ -135,6 +143,7 @@ ToolkitConsoleHandler::GetErrors()
 Util::Array<Util::String>
 ToolkitConsoleHandler::GetWarnings()
 {
+    Threading::CriticalScope scope(&this->cs);
     Util::Array<Util::String> warnings;
     Threading::ThreadId id = Threading::Thread::GetMyThreadId();
     for (Util::Array<LogEntry>::Iterator iter = this->log[id].Begin(); iter != this->log[id].End(); iter++)
@@ -149,9 +158,10 @@ ToolkitConsoleHandler::GetWarnings()
 //------------------------------------------------------------------------------
 /**
 */
-const Util::Array<ToolkitConsoleHandler::LogEntry> &
+Util::Array<ToolkitConsoleHandler::LogEntry>
 ToolkitConsoleHandler::GetLog()
 {
+    Threading::CriticalScope scope(&this->cs);
     return this->log[Threading::Thread::GetMyThreadId()];
 }
 
@@ -63,10 +63,10 @@ public:
     Util::Array<Util::String> GetErrors();
     /// get errors
     Util::Array<Util::String> GetWarnings();
-    /// get full console output
-    const Util::Array<LogEntry> & GetLog();
+    /// get full console output of the calling thread
+    Util::Array<LogEntry> GetLog();
     /// what kinds of messages occurred since last clear
-    unsigned char GetLevels() const;
+    unsigned char GetLevels();
 
 private:    
     ///
@@ -111,8 +111,9 @@ ToolkitUtil::ToolLog::AddEntry(const Ptr<ToolkitUtil::ToolkitConsoleHandler> & c
 /**
 */
 inline unsigned char
-ToolkitConsoleHandler::GetLevels() const
+ToolkitConsoleHandler::GetLevels()
 {
+    Threading::CriticalScope scope(&this->cs);
     Threading::ThreadId id = Threading::Thread::GetMyThreadId();
     return this->currentFlags[id];
 }
@@ -0,0 +1,431 @@
+//------------------------------------------------------------------------------
+//  assetbuildcache.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "assetbuildcache.h"
+#include "io/ioserver.h"
+#include "io/binaryreader.h"
+#include "io/binarywriter.h"
+#include "io/fswrapper.h"
+#include "util/hash.h"
+#include "util/guid.h"
+
+using namespace Util;
+using namespace IO;
+namespace ToolkitUtil
+{
+
+static const uint IndexMagic = 'NABC';
+static const uint IndexVersion = 1;
+
+//------------------------------------------------------------------------------
+/**
+    Two murmur passes with different seeds, 32 bits are too few for a
+    content addressed store.
+*/
+static uint64_t
+Hash64(const void* data, SizeT size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = uint64_t(Util::Hash(bytes, size, 4711)) | (uint64_t(Util::Hash(bytes, size, 0x9747b28c)) << 32);
+
+    // 0 is reserved for files which don't exist
+    return hash != 0 ? hash : 1;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static String
+HashToString(uint64_t hash)
+{
+    return String::Sprintf("%08x%08x", uint(hash >> 32), uint(hash));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+AssetBuildCache::AssetBuildCache() :
+    numHits(0),
+    numRestored(0),
+    isDirty(false),
+    isOpen(false)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+AssetBuildCache::~AssetBuildCache()
+{
+    if (this->IsOpen())
+    {
+        this->Close();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetBuildCache::Open(const IO::URI& path)
+{
+    n_assert(!this->IsOpen());
+    this->root = path.AsString();
+    IoServer::Instance()->CreateDirectory(path);
+    this->LoadIndex();
+    this->numHits = 0;
+    this->numRestored = 0;
+    this->isOpen = true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetBuildCache::Close()
+{
+    n_assert(this->IsOpen());
+    if (this->isDirty)
+    {
+        this->SaveIndex();
+    }
+    this->files.Clear();
+    this->entries.Clear();
+    this->isOpen = false;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+uint64_t
+AssetBuildCache::HashFile(const IO::URI& file)
+{
+    IoServer* ioServer = IoServer::Instance();
+    if (ioServer->DirectoryExists(file))
+    {
+        // directories, like cube maps, hash the names and hashes of their files
+        Array<String> names = ioServer->ListFiles(file, "*");
+        names.Sort();
+        String contents;
+        for (const String& name : names)
+        {
+            contents.Append(name);
+            contents.Append(HashToString(this->HashFile(file.AsString() + "/" + name)));
+        }
+        return Hash64(contents.AsCharPtr(), contents.Length());
+    }
+
+    IOStat stat;
+    if (!ioServer->FileExists(file) || !ioServer->GetIOInfo(file, stat, false))
+    {
+        return 0;
+    }
+    const String path = file.LocalPath();
+    const uint64_t writeTime = (uint64_t(stat.modifiedTime.GetHighBits()) << 32) | stat.modifiedTime.GetLowBits();
+    this->cs.Enter();
+    IndexT index = this->files.FindIndex(path);
+    if (index != InvalidIndex)
+    {
+        const FileState& state = this->files.ValueAtIndex(index);
+        if (state.size == stat.size && state.writeTime == writeTime)
+        {
+            uint64_t hash = state.hash;
+            this->cs.Leave();
+            return hash;
+        }
+    }
+    this->cs.Leave();
+
+    // the file is new or was modified, read it
+    uint64_t hash = 0;
+    Ptr<Stream> stream = ioServer->CreateStream(file);
+    stream->SetAccessMode(Stream::ReadAccess);
+    if (stream->Open())
+    {
+        const SizeT size = (SizeT)stream->GetSize();
+        if (size > 0)
+        {
+            hash = Hash64(stream->Map(), size);
+            stream->Unmap();
+        }
+        else
+        {
+            hash = Hash64(nullptr, 0);
+        }
+        stream->Close();
+    }
+    if (hash == 0)
+    {
+        return 0;
+    }
+
+    Threading::CriticalScope scope(&this->cs);
+    index = this->files.FindIndex(path);
+    if (index == InvalidIndex)
+    {
+        this->files.Add(path, { stat.size, writeTime, hash });
+    }
+    else
+    {
+        this->files.ValueAtIndex(index) = { stat.size, writeTime, hash };
+    }
+    this->isDirty = true;
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+uint64_t
+AssetBuildCache::ComputeKey(const Util::String& step, uint version, uint options, const Util::Array<IO::URI>& inputs)
+{
+    String key = String::Sprintf("%s:%u:%u", step.AsCharPtr(), version, options);
+    for (const URI& input : inputs)
+    {
+        key.Append(":");
+        key.Append(input.LocalPath());
+        key.Append("=");
+        key.Append(HashToString(this->HashFile(input)));
+    }
+    return Hash64(key.AsCharPtr(), key.Length());
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+AssetBuildCache::Restore(uint64_t key)
+{
+    if (!this->IsOpen())
+    {
+        return false;
+    }
+
+    Entry entry;
+    this->cs.Enter();
+    IndexT index = this->entries.FindIndex(key);
+    if (index != InvalidIndex)
+    {
+        entry = this->entries.ValueAtIndex(index);
+    }
+    this->cs.Leave();
+    if (index == InvalidIndex)
+    {
+        return false;
+    }
+
+    IoServer* ioServer = IoServer::Instance();
+    SizeT restored = 0;
+    IndexT i;
+    for (i = 0; i < entry.outputs.Size(); i++)
+    {
+        const URI output = entry.outputs[i];
+        if (this->HashFile(output) == entry.hashes[i])
+        {
+            continue;
+        }
+
+        // the output is missing or was overwritten by a different build, copy the cached one back
+        const String object = this->GetObjectPath(entry.hashes[i]);
+        if (!ioServer->FileExists(object))
+        {
+            return false;
+        }
+        ioServer->CreateDirectory(output.LocalPath().ExtractDirName());
+        if (!ioServer->CopyFile(object, output))
+        {
+            return false;
+        }
+        restored++;
+    }
+
+    Threading::CriticalScope scope(&this->cs);
+    this->numHits++;
+    this->numRestored += restored;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetBuildCache::Store(uint64_t key, const Util::Array<IO::URI>& outputs)
+{
+    if (!this->IsOpen())
+    {
+        return;
+    }
+
+    IoServer* ioServer = IoServer::Instance();
+    Entry entry;
+    for (const URI& output : outputs)
+    {
+        if (ioServer->DirectoryExists(output))
+        {
+            continue;
+        }
+        uint64_t hash = this->HashFile(output);
+        if (hash == 0)
+        {
+            // the exporter didn't write all of its outputs, an entry without them can't be restored
+            return;
+        }
+        const String object = this->GetObjectPath(hash);
+        if (!ioServer->FileExists(object))
+        {
+            // jobs whose outputs have the same contents store the same object, copy to a file of our own and move it into place
+            Guid guid;
+            guid.Generate();
+            const String tmpObject = String::Sprintf("%s.%s.tmp", object.AsCharPtr(), guid.AsString().AsCharPtr());
+            ioServer->CreateDirectory(object.ExtractDirName());
+            if (!ioServer->CopyFile(output, tmpObject))
+            {
+                return;
+            }
+            if (!FSWrapper::ReplaceFile(URI(tmpObject).LocalPath(), URI(object).LocalPath()))
+            {
+                ioServer->DeleteFile(tmpObject);
+                if (!ioServer->FileExists(object))
+                {
+                    return;
+                }
+            }
+        }
+        entry.outputs.Append(output.AsString());
+        entry.hashes.Append(hash);
+    }
+
+    Threading::CriticalScope scope(&this->cs);
+    IndexT index = this->entries.FindIndex(key);
+    if (index == InvalidIndex)
+    {
+        this->entries.Add(key, entry);
+    }
+    else
+    {
+        this->entries.ValueAtIndex(index) = entry;
+    }
+    this->isDirty = true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+String
+AssetBuildCache::GetObjectPath(uint64_t hash) const
+{
+    const String name = HashToString(hash);
+    return String::Sprintf("%s/objects/%s/%s", this->root.AsCharPtr(), name.ExtractRange(0, 2).AsCharPtr(), name.AsCharPtr());
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetBuildCache::LoadIndex()
+{
+    this->files.Clear();
+    this->entries.Clear();
+    this->isDirty = false;
+
+    const String path = this->root + "/index.bin";
+    if (!IoServer::Instance()->FileExists(path))
+    {
+        return;
+    }
+    Ptr<BinaryReader> reader = BinaryReader::Create();
+    reader->SetStream(IoServer::Instance()->CreateStream(path));
+    if (!reader->Open())
+    {
+        return;
+    }
+    if (reader->ReadUInt() != IndexMagic || reader->ReadUInt() != IndexVersion)
+    {
+        // written by a different version, start over
+        reader->Close();
+        return;
+    }
+
+    uint numFiles = reader->ReadUInt();
+    this->files.Reserve(numFiles);
+    this->files.BeginBulkAdd();
+    uint i;
+    for (i = 0; i < numFiles; i++)
+    {
+        String file = reader->ReadString();
+        FileState state;
+        state.size = reader->ReadUInt64();
+        state.writeTime = reader->ReadUInt64();
+        state.hash = reader->ReadUInt64();
+        this->files.Add(file, state);
+    }
+    this->files.EndBulkAdd();
+
+    uint numEntries = reader->ReadUInt();
+    this->entries.Reserve(numEntries);
+    this->entries.BeginBulkAdd();
+    for (i = 0; i < numEntries; i++)
+    {
+        uint64_t key = reader->ReadUInt64();
+        Entry entry;
+        uint numOutputs = reader->ReadUInt();
+        uint j;
+        for (j = 0; j < numOutputs; j++)
+        {
+            entry.outputs.Append(reader->ReadString());
+            entry.hashes.Append(reader->ReadUInt64());
+        }
+        this->entries.Add(key, entry);
+    }
+    this->entries.EndBulkAdd();
+    reader->Close();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetBuildCache::SaveIndex()
+{
+    Ptr<BinaryWriter> writer = BinaryWriter::Create();
+    writer->SetStream(IoServer::Instance()->CreateStream(this->root + "/index.bin"));
+    if (!writer->Open())
+    {
+        n_warning("AssetBuildCache: could not write index to %s\n", this->root.AsCharPtr());
+        return;
+    }
+    writer->WriteUInt(IndexMagic);
+    writer->WriteUInt(IndexVersion);
+
+    writer->WriteUInt(this->files.Size());
+    IndexT i;
+    for (i = 0; i < this->files.Size(); i++)
+    {
+        const FileState& state = this->files.ValueAtIndex(i);
+        writer->WriteString(this->files.KeyAtIndex(i));
+        writer->WriteUInt64(state.size);
+        writer->WriteUInt64(state.writeTime);
+        writer->WriteUInt64(state.hash);
+    }
+
+    writer->WriteUInt(this->entries.Size());
+    for (i = 0; i < this->entries.Size(); i++)
+    {
+        const Entry& entry = this->entries.ValueAtIndex(i);
+        writer->WriteUInt64(this->entries.KeyAtIndex(i));
+        writer->WriteUInt(entry.outputs.Size());
+        IndexT j;
+        for (j = 0; j < entry.outputs.Size(); j++)
+        {
+            writer->WriteString(entry.outputs[j]);
+            writer->WriteUInt64(entry.hashes[j]);
+        }
+    }
+    writer->Close();
+    this->isDirty = false;
+}
+
+} // namespace ToolkitUtil
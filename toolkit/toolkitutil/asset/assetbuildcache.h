@@ -0,0 +1,119 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class ToolkitUtil::AssetBuildCache
+
+    Decides whether an export step has to run, based on the contents of its
+    inputs rather than on file times.
+
+    The key of a step is a hash of the step name, the exporter version, the
+    export options and the content hashes of all input files. After a step
+    succeeded, its outputs are copied into the cache, addressed by their
+    content hash, and recorded under the key. A step whose key is found is
+    up to date, outputs which are missing or were overwritten, for example
+    after switching branches, are restored from the cache instead of being
+    exported again.
+
+    Content hashes of files are remembered together with their size and
+    write time, so that a file is only read again once it was modified.
+    All methods are thread safe.
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "io/uri.h"
+#include "util/array.h"
+#include "util/dictionary.h"
+#include "util/string.h"
+#include "threading/criticalsection.h"
+
+//------------------------------------------------------------------------------
+namespace ToolkitUtil
+{
+class AssetBuildCache
+{
+public:
+    /// constructor
+    AssetBuildCache();
+    /// destructor
+    ~AssetBuildCache();
+
+    /// open the cache in a directory and load its index
+    void Open(const IO::URI& path);
+    /// save the index and close the cache
+    void Close();
+    /// returns true if the cache is open
+    bool IsOpen() const;
+
+    /// get the content hash of a file or of all files in a directory, 0 if it doesn't exist
+    uint64_t HashFile(const IO::URI& file);
+    /// compute the key of an export step
+    uint64_t ComputeKey(const Util::String& step, uint version, uint options, const Util::Array<IO::URI>& inputs);
+    /// returns true if a step with the key was built, restores outputs which don't match the cached ones
+    bool Restore(uint64_t key);
+    /// store the outputs of a successfully built step under its key, nothing is stored if an output is missing
+    void Store(uint64_t key, const Util::Array<IO::URI>& outputs);
+
+    /// get the number of steps which were up to date
+    SizeT GetNumHits() const;
+    /// get the number of outputs which were restored from the cache
+    SizeT GetNumRestored() const;
+
+private:
+    struct FileState
+    {
+        uint64_t size;
+        uint64_t writeTime;
+        uint64_t hash;
+    };
+    struct Entry
+    {
+        Util::Array<Util::String> outputs;
+        Util::Array<uint64_t> hashes;
+    };
+
+    /// get the path of an object in the cache
+    Util::String GetObjectPath(uint64_t hash) const;
+    /// load the index
+    void LoadIndex();
+    /// save the index
+    void SaveIndex();
+
+    Threading::CriticalSection cs;
+    Util::Dictionary<Util::String, FileState> files;
+    Util::Dictionary<uint64_t, Entry> entries;
+    Util::String root;
+    SizeT numHits;
+    SizeT numRestored;
+    bool isDirty;
+    bool isOpen;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+AssetBuildCache::IsOpen() const
+{
+    return this->isOpen;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+AssetBuildCache::GetNumHits() const
+{
+    return this->numHits;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+AssetBuildCache::GetNumRestored() const
+{
+    return this->numRestored;
+}
+
+} // namespace ToolkitUtil
+//------------------------------------------------------------------------------
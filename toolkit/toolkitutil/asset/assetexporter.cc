@@ -10,6 +10,9 @@
 #include "nflatbuffer/flatbufferinterface.h"
 #include "toolkit-common/text.h"
 #include "io/jsonreader.h"
+#include "jobs2/jobs2.h"
+#include "timing/timer.h"
+#include "util/guid.h"
 
 using namespace Util;
 using namespace IO;
@@ -17,6 +20,28 @@ namespace ToolkitUtil
 {
 __ImplementClass(ToolkitUtil::AssetExporter, 'ASEX', Core::RefCounted);
 
+//------------------------------------------------------------------------------
+/**
+    Bump the version of an exporter whenever its output changes, this
+    invalidates everything it exported before in the build cache.
+*/
+static const struct
+{
+    const char* name;
+    uint version;
+    uint forceMode;
+} JobTypes[] =
+{
+    { "GLTF", 1, AssetExporter::ForceGLTF },
+    { "FBX", 1, AssetExporter::ForceFBX },
+    { "Model", 1, AssetExporter::ForceModels },
+    { "Texture", 1, AssetExporter::ForceTextures },
+    { "Surface", 1, AssetExporter::ForceSurfaces },
+    { "Particle", 1, AssetExporter::ForceParticles },
+    { "Audio", 1, AssetExporter::ForceAudio },
+    { "Physics", 1, AssetExporter::ForcePhysics },
+};
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -41,12 +66,11 @@ void
 AssetExporter::Open()
 {
     ExporterBase::Open();
-    this->surfaceExporter = ToolkitUtil::SurfaceExporter::Create();
-    this->surfaceExporter->Open();
-    this->particleExporter = ToolkitUtil::ParticleExporter::Create();
-    this->particleExporter->Open();
-    this->modelBuilder = ToolkitUtil::ModelBuilder::Create();
     this->textureExporter.Setup();
+    if (AssignRegistry::Instance()->HasAssign("intermediate"))
+    {
+        this->cache.Open("intermediate:buildcache");
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -55,11 +79,10 @@ AssetExporter::Open()
 void
 AssetExporter::Close()
 {
-    this->surfaceExporter->Close();
-    this->surfaceExporter = nullptr;
-    this->particleExporter->Close();
-    this->particleExporter = nullptr;
-    this->modelBuilder = nullptr;
+    if (this->cache.IsOpen())
+    {
+        this->cache.Close();
+    }
     this->textureExporter.Discard();
     this->textureAttrTable.Discard();
     ExporterBase::Close();
@@ -73,7 +96,7 @@ AssetExporter::UpdateSource()
 {
     this->RecurseValidateIntermediates("intermediate:");
 
-    if (this->textureAttrTable.IsValid()) 
+    if (this->textureAttrTable.IsValid())
         this->textureAttrTable.Discard();
     this->textureAttrTable.Setup("src:assets/");
     this->textureExporter.SetTextureAttrTable(std::move(this->textureAttrTable));
@@ -85,58 +108,84 @@ AssetExporter::UpdateSource()
 void
 AssetExporter::ExportFile(const IO::URI& file)
 {
-    IoServer* ioServer = IoServer::Instance();
-    Util::String const ext = file.AsString().GetFileExtension();
-    Util::String const fileName = file.AsString().ExtractFileName();
+    this->QueueFile(file, this->category);
+    this->RunJobs();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetExporter::ExportDir(const Util::String& category)
+{
+    String assetPath = String::Sprintf("src:assets/%s/", category.AsCharPtr());
+    this->ExportFolder(assetPath, category);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetExporter::ExportFolder(const Util::String& assetPath, const Util::String& category)
+{
+    n_printf("\n----------------- Exporting asset directory %s -----------------\n", Text(URI(assetPath).LocalPath()).Color(TextColor::Blue).Style(FontMode::Bold).AsCharPtr());
+    this->QueueFolder(assetPath, category);
+    this->RunJobs();
+}
 
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetExporter::ExportAll()
+{
+    IndexT folderIndex;
+    Array<String> folders = IoServer::Instance()->ListDirectories("src:assets/", "*");
+    for (folderIndex = 0; folderIndex < folders.Size(); folderIndex++)
+    {
+        this->QueueFolder(String::Sprintf("src:assets/%s/", folders[folderIndex].AsCharPtr()), folders[folderIndex]);
+    }
+    n_printf("\n----------------- Exporting %d asset directories -----------------\n", folders.Size());
+    this->RunJobs();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetExporter::ExportList(const Util::Array<Util::String>& files)
+{
+    this->QueueList(files);
+    this->RunJobs();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetExporter::SetExportMode(unsigned int mode)
+{
+    this->mode = mode;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+AssetExporter::GetJobType(const Util::String& file, JobType& type) const
+{
+    Util::String const ext = file.GetFileExtension();
     if ((this->mode & ExportModes::GLTF) && (ext == "gltf" || ext == "glb"))
     {
-        this->gltfExporter = ToolkitUtil::NglTFExporter::Create();
-        this->gltfExporter->SetTextureConverter(&this->textureExporter);
-        this->gltfExporter->Open();
-        this->gltfExporter->SetForce(this->force || (this->mode & ExportModes::ForceGLTF) != 0);
-        this->gltfExporter->SetCategory(this->category);
-        this->gltfExporter->SetLogger(this->logger);
-        this->gltfExporter->SetFile(fileName);
-        this->gltfExporter->ExportFile(file);
-        this->gltfExporter->Close();
-        this->gltfExporter = nullptr;
+        type = GLTFJob;
     }
     else if ((this->mode & ExportModes::FBX) && ext == "fbx")
     {
-        this->fbxExporter = ToolkitUtil::NFbxExporter::Create();
-        this->fbxExporter->Open();
-        this->fbxExporter->SetForce(this->force || (this->mode & ExportModes::ForceFBX) != 0);
-        this->fbxExporter->SetCategory(this->category);
-        this->fbxExporter->SetLogger(this->logger);
-        this->fbxExporter->SetFile(fileName);
-        this->fbxExporter->ExportFile(file);
-        this->fbxExporter->Close();
-        this->fbxExporter = nullptr;
+        type = FBXJob;
     }
     else if ((this->mode & ExportModes::Models) && ext == "attributes")
     {
-        String modelName = fileName;
-        modelName.StripFileExtension();
-        modelName = category + "/" + modelName;
-        Ptr<ModelConstants> constants = ModelDatabase::Instance()->LookupConstants(modelName, true);
-        Ptr<ModelAttributes> attributes = ModelDatabase::Instance()->LookupAttributes(modelName, true);
-        Ptr<ModelPhysics> physics = ModelDatabase::Instance()->LookupPhysics(modelName, true);
-
-        this->modelBuilder->SetConstants(constants);
-        this->modelBuilder->SetAttributes(attributes);
-        this->modelBuilder->SetPhysics(physics);
-
-        String modelPath = String::Sprintf("mdl:%s.n3", modelName.AsCharPtr());
-        this->logger->Print(
-            "%s -> %s\n",
-            Text(file.LocalPath()).Color(TextColor::Blue).AsCharPtr(),
-            Text(URI(modelPath).LocalPath()).Color(TextColor::Green).AsCharPtr()
-        );
-        this->modelBuilder->SaveN3(modelPath, this->platform);
-
-        String physicsPath = String::Sprintf("phys:%s.actor", modelName.AsCharPtr());
-        this->modelBuilder->SaveN3Physics(physicsPath, this->platform);
+        type = ModelJob;
     }
     else if ((this->mode & ExportModes::Textures) &&
              (
@@ -145,35 +194,20 @@ AssetExporter::ExportFile(const IO::URI& file)
                  ext == "bmp" ||
                  ext == "dds" ||
                  ext == "png" ||
-                 ext == "jpg" ||
                  ext == "exr" ||
                  ext == "tif" ||
                  ext == "cube"
               ))
     {
-        this->textureExporter.SetForceFlag(this->force || (this->mode & ExportModes::ForceTextures) != 0);
-        this->textureExporter.SetLogger(this->logger);
-
-        Util::String dstDir = Util::String::Sprintf("tex:%s", category.AsCharPtr());
-        
-        Util::String dstFile = Util::String::Sprintf("%s/%s", dstDir.AsCharPtr(), fileName.AsCharPtr());
-        dstFile.StripFileExtension();
-        if (ext == "cube")
-            this->textureExporter.ConvertCubemap(file.AsString(), dstFile, "temp:textureconverter");
-        else
-            this->textureExporter.ConvertTexture(file.AsString(), dstFile, "temp:textureconverter");
+        type = TextureJob;
     }
     else if ((this->mode & ExportModes::Surfaces) && ext == "sur")
     {
-        this->surfaceExporter->SetLogger(this->logger);
-        this->surfaceExporter->SetForce(this->force || (this->mode & ExportModes::ForceSurfaces) != 0);
-        this->surfaceExporter->ExportFile(file);
+        type = SurfaceJob;
     }
     else if ((this->mode & ExportModes::Particles) && ext == "par")
     {
-        this->particleExporter->SetLogger(this->logger);
-        this->particleExporter->SetForce(this->force || (this->mode & ExportModes::ForceParticles) != 0);
-        this->particleExporter->ExportFile(file);
+        type = ParticleJob;
     }
     else if ((this->mode & ExportModes::Audio) &&
              (
@@ -182,268 +216,290 @@ AssetExporter::ExportFile(const IO::URI& file)
                 ext == "ogg"
              ))
     {
-        Util::String dstDir = Util::String::Sprintf("dst:audio/%s", category.AsCharPtr());
-        ioServer->CreateDirectory(dstDir);
-        Util::String dstFile = Util::String::Sprintf("%s/%s", dstDir.AsCharPtr(), fileName.AsCharPtr());
-        this->logger->Print(
-            "%s -> %s\n",
-            Text(file.LocalPath()).Color(TextColor::Blue).AsCharPtr(),
-            Text(URI(dstFile).LocalPath()).Color(TextColor::Green).AsCharPtr()
-        );
-        ioServer->CopyFile(file, dstFile);
+        type = AudioJob;
     }
     else if ((this->mode & ExportModes::Physics) && ext == "actor")
     {
-        Util::String dstDir = Util::String::Sprintf("dst:physics/%s", category.AsCharPtr());
-        Util::String dstFile = Util::String::Sprintf("%s/%s", dstDir.AsCharPtr(), fileName.AsCharPtr());
-        if (this->mode & ExportModes::ForcePhysics || NeedsConversion(file.AsString(), dstFile))
-        {
-            this->logger->Print(
-                "%s -> %s\n",
-                Text(Format("%s", file.AsString().AsCharPtr())).Color(TextColor::Blue).AsCharPtr(),
-                Text(URI(dstFile).LocalPath()).Color(TextColor::Green).Style(FontMode::Underline).AsCharPtr()
-            );
-            Flat::FlatbufferInterface::Compile(file, dstDir, "ACTO");
-        }
-        else
-        {
-            this->logger->Print("Skipping %s\n", Text(file.AsString()).Color(TextColor::Blue).AsCharPtr());
-        }
+        type = PhysicsJob;
+    }
+    else
+    {
+        return false;
     }
+    return true;
 }
 
 //------------------------------------------------------------------------------
 /**
 */
 void
-AssetExporter::ExportDir(const Util::String& category)
+AssetExporter::QueueFile(const IO::URI& file, const Util::String& category)
 {
-    String assetPath = String::Sprintf("src:assets/%s/", category.AsCharPtr());
-    this->ExportFolder(assetPath, category);
+    JobType type;
+    if (this->GetJobType(file.AsString(), type))
+    {
+        this->jobs[type].Append({ file, category, ToolLogEntry(), false });
+        if (this->jobCategories.FindIndex(category) == InvalidIndex)
+        {
+            this->jobCategories.Append(category);
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
 /**
 */
 void
-AssetExporter::ExportFolder(const Util::String& assetPath, const Util::String& category)
+AssetExporter::QueueFolder(const Util::String& assetPath, const Util::String& category)
 {
-    n_printf("\n----------------- Exporting asset directory %s -----------------\n", Text(URI(assetPath).LocalPath()).Color(TextColor::Blue).Style(FontMode::Bold).AsCharPtr());
     IoServer* ioServer = IoServer::Instance();
-
-    IndexT fileIndex;
-    ToolLog log(category);
-    Ptr<ToolkitUtil::ToolkitConsoleHandler> console = ToolkitUtil::ToolkitConsoleHandler::Instance();
-    this->category = category;
-
-    if (this->mode & ExportModes::GLTF)
+    Array<String> files = ioServer->ListFiles(assetPath, "*");
+    files.AppendArray(ioServer->ListDirectories(assetPath, "*.cube"));
+    for (const String& file : files)
     {
-        console->Clear();
-        // export GLTF sources
-
-        this->logger->Print("\nGLTFs ------------\n");
-        Array<String> files = ioServer->ListFiles(assetPath, "*.gltf");
-        files.AppendArray(ioServer->ListFiles(assetPath, "*.glb"));
-        log.AddEntry(console, "GLTF", category);
-        if (files.IsEmpty())
-        {
-            this->logger->Print("Nothing to export\n");
-        }
-        else
-        {
-            for (fileIndex = 0; fileIndex < files.Size(); fileIndex++)
-            {
-                console->Clear();
-                this->ExportFile(assetPath + files[fileIndex]);
-                log.AddEntry(console, "GLTF", files[fileIndex]);
-            }
-        }
+        this->QueueFile(assetPath + file, category);
     }
 
-    if (this->mode & ExportModes::FBX)
+    // the scene exporters write the attributes of new models, so queue those models too
+    if (this->mode & ExportModes::Models)
     {
-        this->logger->Print("\nFBXs ----------------\n");
-
-        // export FBX sources
-        Array<String> files = ioServer->ListFiles(assetPath, "*.fbx");
-        log.AddEntry(console, "FBX", category);
-        if (files.IsEmpty())
+        for (const String& file : files)
         {
-            this->logger->Print("Nothing to export\n");
-        }
-        else
-        {
-            for (fileIndex = 0; fileIndex < files.Size(); fileIndex++)
+            JobType type;
+            if (this->GetJobType(file, type) && (type == GLTFJob || type == FBXJob))
             {
-                console->Clear();
-                this->ExportFile(assetPath + files[fileIndex]);
-                log.AddEntry(console, "FBX", files[fileIndex]);
+                String attributes = file;
+                attributes.StripFileExtension();
+                attributes.Append(".attributes");
+                if (files.FindIndex(attributes) == InvalidIndex)
+                {
+                    this->QueueFile(assetPath + attributes, category);
+                }
             }
         }
     }
+}
 
-    if (this->mode & ExportModes::Models)
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetExporter::QueueList(const Util::Array<Util::String>& files)
+{
+    for (Array<String>::Iterator iter = files.Begin(); iter != files.End(); iter++)
     {
-        // export models
-        this->logger->Print("\nModels --------------\n");
-        Array<String> files = ioServer->ListFiles(assetPath, "*.attributes");
-        if (files.IsEmpty())
+        const Util::String& str = *iter;
+        if (IO::IoServer::Instance()->FileExists(str))
         {
-            this->logger->Print("Nothing to export\n");
+            this->QueueFile(str, this->category);
         }
-        else
+        else if (IO::IoServer::Instance()->DirectoryExists(str))
         {
-            for (fileIndex = 0; fileIndex < files.Size(); fileIndex++)
-            {
-                console->Clear();
-                this->ExportFile(assetPath + files[fileIndex]);
-                log.AddEntry(console, "Model", files[fileIndex]);
-            }
+            Array<String> filesInFolder = IoServer::Instance()->ListFiles(str, "*");
+            filesInFolder.AppendArray(IoServer::Instance()->ListDirectories(str, "*"));
+            for (auto& f : filesInFolder)
+                f = str + "/" + f;
+            this->QueueList(filesInFolder);
         }
     }
+}
 
-    if (this->mode & ExportModes::Textures)
+//------------------------------------------------------------------------------
+/**
+*/
+void
+AssetExporter::RunJobs()
+{
+    Timing::Timer timer;
+    timer.Start();
+    SizeT numHits = this->cache.GetNumHits();
+    SizeT numRestored = this->cache.GetNumRestored();
+
+    // the build cache decides what has to be exported, so the exporters don't check file times,
+    // the texture converter is only read by the jobs, every other exporter is created per job
+    this->textureExporter.SetForceFlag(true);
+    this->textureExporter.SetLogger(this->logger);
+
+    // the glTF exporter dispatches jobs and resets the job memory itself, so it has to run on this thread
+    for (Job& job : this->jobs[GLTFJob])
     {
-        // export textures
-        Array<String> files = ioServer->ListFiles(assetPath, "*.tga");
-        files.AppendArray(ioServer->ListFiles(assetPath, "*.bmp"));
-        files.AppendArray(ioServer->ListFiles(assetPath, "*.dds"));
-        files.AppendArray(ioServer->ListFiles(assetPath, "*.png"));
-        files.AppendArray(ioServer->ListFiles(assetPath, "*.jpg"));
-        files.AppendArray(ioServer->ListFiles(assetPath, "*.exr"));
-        files.AppendArray(ioServer->ListFiles(assetPath, "*.tif"));
-        files.AppendArray(ioServer->ListDirectories(assetPath, "*.cube"));
-
-        this->logger->Print("\nTextures ------------\n");
-        if (files.IsEmpty())
-        {
-            this->logger->Print("Nothing to export\n");
-        }
-        else
-        {
-            for (fileIndex = 0; fileIndex < files.Size(); fileIndex++)
-            {
-                console->Clear();
-                this->ExportFile(assetPath + files[fileIndex]);
-                log.AddEntry(console, "Texture", files[fileIndex]);
-            }
-        }
+        this->RunJob(GLTFJob, job);
     }
 
-    if (this->mode & ExportModes::Surfaces)
+    if (Jobs2::JobGetNumThreads() == 0)
     {
-        this->logger->Print("\nSurfaces ------------\n");
-        Array<String> files = ioServer->ListFiles(assetPath, "*.sur");
-        if (files.IsEmpty())
+        // no job threads, run everything in dependency order
+        static const JobType order[] = { FBXJob, TextureJob, AudioJob, PhysicsJob, ParticleJob, ModelJob, SurfaceJob };
+        for (JobType type : order)
         {
-            this->logger->Print("Nothing to export\n");
-        }
-        else
-        {
-            for (fileIndex = 0; fileIndex < files.Size(); fileIndex++)
+            for (Job& job : this->jobs[type])
             {
-                console->Clear();
-                this->ExportFile(assetPath + files[fileIndex]);
-                log.AddEntry(console, "Surface", files[fileIndex]);
+                this->RunJob(type, job);
             }
         }
     }
-
-    if (this->mode & ExportModes::Particles)
+    else
     {
-        this->logger->Print("\nParticles ------------\n");
-        Array<String> files = ioServer->ListFiles(assetPath, "*.par");
-        if (files.IsEmpty())
+        Jobs2::JobNewFrame();
+        Threading::AtomicCounter counters[NumJobTypes];
+        auto dispatch = [this, &counters](JobType type, const Util::FixedArray<const Threading::AtomicCounter*, true>& waitCounters)
         {
-            this->logger->Print("Nothing to export\n");
-        }
-        else
+            counters[type] = 1;
+            Jobs2::JobDispatch(
+                [
+                    this
+                    , type
+                    , jobs = this->jobs[type].Begin()
+                ]
+            (SizeT totalJobs, SizeT groupSize, IndexT groupIndex, SizeT invocationOffset)
+            {
+                for (IndexT i = 0; i < groupSize; i++)
+                {
+                    IndexT index = i + invocationOffset;
+                    if (index >= totalJobs)
+                        return;
+
+                    this->RunJob(type, jobs[index]);
+                }
+            }, this->jobs[type].Size(), 1, waitCounters, &counters[type]);
+        };
+
+        dispatch(FBXJob, nullptr);
+        dispatch(TextureJob, nullptr);
+        dispatch(AudioJob, nullptr);
+        dispatch(PhysicsJob, nullptr);
+        dispatch(ParticleJob, nullptr);
+
+        // models are built from the attributes and meshes written by the scene exporters
+        dispatch(ModelJob, { &counters[FBXJob] });
+
+        // surfaces reference the exported textures
+        dispatch(SurfaceJob, { &counters[TextureJob] });
+
+        IndexT type;
+        for (type = 0; type < NumJobTypes; type++)
         {
-            for (fileIndex = 0; fileIndex < files.Size(); fileIndex++)
+            if (type != GLTFJob)
             {
-                console->Clear();
-                this->ExportFile(assetPath + files[fileIndex]);
-                log.AddEntry(console, "Surface", files[fileIndex]);
+                Jobs2::JobWait(&counters[type]);
             }
         }
+        Jobs2::JobNewFrame();
     }
 
-    if (this->mode & ExportModes::Audio)
+    // collect the logs of the jobs in a stable order
+    SizeT numJobs = 0;
+    SizeT numExported = 0;
+    for (const String& category : this->jobCategories)
     {
-        this->logger->Print("\nAudio ---------------\n");
-        Array<String> files = ioServer->ListFiles(assetPath, "*.wav");
-        files.AppendArray(ioServer->ListFiles(assetPath, "*.mp3"));
-        files.AppendArray(ioServer->ListFiles(assetPath, "*.ogg"));
-        if (files.IsEmpty())
+        ToolLog log(category);
+        IndexT type;
+        for (type = 0; type < NumJobTypes; type++)
         {
-            this->logger->Print("Nothing to export\n");
-        }
-        else
-        {
-            for (fileIndex = 0; fileIndex < files.Size(); fileIndex++)
+            for (const Job& job : this->jobs[type])
             {
-                console->Clear();
-                this->ExportFile(assetPath + files[fileIndex]);
-                log.AddEntry(console, "Audio", files[fileIndex]);
+                if (job.category == category)
+                {
+                    log.logLevels |= job.log.logLevels;
+                    log.logs.Append(job.log);
+                }
             }
         }
+        this->messages.Append(log);
     }
-    if (this->mode & ExportModes::Physics)
+    IndexT type;
+    for (type = 0; type < NumJobTypes; type++)
     {
-        this->logger->Print("\nPhysics -------------\n");
-        Array<String> files = ioServer->ListFiles(assetPath, "*.actor", true);
-        if (files.IsEmpty())
+        for (const Job& job : this->jobs[type])
         {
-            this->logger->Print("Nothing to export\n");
-        }
-        else
-        {
-            for (auto const& file : files)
-            {
-                this->ExportFile(assetPath + file);
-                log.AddEntry(console, "Physics", file);
-            }
+            numExported += job.exported ? 1 : 0;
         }
+        numJobs += this->jobs[type].Size();
+        this->jobs[type].Clear();
     }
-    this->messages.Append(log);
-    this->category = "";
+    this->jobCategories.Clear();
+
+    timer.Stop();
+    this->logger->Print(
+        "%d files: %d exported, %d up to date, %d outputs restored from the build cache %s\n",
+        numJobs,
+        numExported,
+        this->cache.GetNumHits() - numHits,
+        this->cache.GetNumRestored() - numRestored,
+        Format("(%.2f s)", timer.GetTime()).AsCharPtr()
+    );
 }
 
 //------------------------------------------------------------------------------
 /**
 */
 void
-AssetExporter::ExportAll()
+AssetExporter::RunJob(JobType type, Job& job)
 {
-    IndexT folderIndex;
-    Array<String> folders = IoServer::Instance()->ListDirectories("src:assets/", "*");
-    for (folderIndex = 0; folderIndex < folders.Size(); folderIndex++)
+    ToolkitConsoleHandler* console = ToolkitConsoleHandler::Instance();
+    console->Clear();
+    job.exported = false;
+    if (type == ModelJob && !IoServer::Instance()->FileExists(job.file))
     {
-        this->ExportDir(folders[folderIndex]);
+        // queued for a scene which didn't write any attributes
+        job.log = { JobTypes[type].name, job.file.AsString().ExtractFileName(), 0, Array<ToolkitConsoleHandler::LogEntry>() };
+        return;
     }
+
+    Array<URI> inputs;
+    this->GetJobInputs(type, job, inputs);
+    const String step = String::Sprintf("%s:%s", JobTypes[type].name, job.file.LocalPath().AsCharPtr());
+    const bool force = this->force || (this->mode & JobTypes[type].forceMode) != 0;
+
+    uint64_t key = this->cache.ComputeKey(step, JobTypes[type].version, this->platform, inputs);
+    job.exported = force || !this->cache.Restore(key);
+    if (job.exported)
+    {
+        Array<URI> outputs;
+        this->Export(type, job, outputs);
+
+        // failed exports aren't cached, so they are retried on the next run
+        if ((console->GetLevels() & ToolkitConsoleHandler::LogError) == 0)
+        {
+            // the scene exporters update the attributes they read, so compute the key from the final inputs
+            key = this->cache.ComputeKey(step, JobTypes[type].version, this->platform, inputs);
+            this->cache.Store(key, outputs);
+        }
+    }
+    job.log = { JobTypes[type].name, job.file.AsString().ExtractFileName(), console->GetLevels(), console->GetLog() };
 }
 
 //------------------------------------------------------------------------------
 /**
 */
 void
-AssetExporter::ExportList(const Util::Array<Util::String>& files)
+AssetExporter::GetJobInputs(JobType type, const Job& job, Util::Array<IO::URI>& inputs) const
 {
-    for (Array<String>::Iterator iter = files.Begin(); iter != files.End(); iter++)
+    String name = job.file.AsString().ExtractFileName();
+    name.StripFileExtension();
+    const String modelPath = String::Sprintf("src:assets/%s/%s", job.category.AsCharPtr(), name.AsCharPtr());
+    switch (type)
     {
-        const Util::String& str = *iter;
-        if (IO::IoServer::Instance()->FileExists(str))
-        {
-            this->ExportFile(str);
-        }
-        else if (IO::IoServer::Instance()->DirectoryExists(str))
-        {
-            Array<String> filesInFolder = IoServer::Instance()->ListFiles(str, "*");
-            filesInFolder.AppendArray(IoServer::Instance()->ListDirectories(str, "*"));
-            for (auto& f : filesInFolder)
-                f = str + "/" + f;
-            this->ExportList(filesInFolder);
-        }
+        case GLTFJob:
+        case FBXJob:
+            inputs.Append(job.file);
+            inputs.Append(modelPath + ".attributes");
+            inputs.Append(modelPath + ".constants");
+            inputs.Append(modelPath + ".physics");
+            break;
+        case ModelJob:
+            inputs.Append(modelPath + ".attributes");
+            inputs.Append(modelPath + ".constants");
+            inputs.Append(modelPath + ".physics");
+            break;
+        case TextureJob:
+            inputs.Append(job.file);
+            inputs.Append(modelPath + ".xml");
+            inputs.Append("src:assets/batchattributes.xml");
+            break;
+        default:
+            inputs.Append(job.file);
+            break;
     }
 }
 
@@ -451,9 +507,145 @@ AssetExporter::ExportList(const Util::Array<Util::String>& files)
 /**
 */
 void
-AssetExporter::SetExportMode(unsigned int mode)
+AssetExporter::Export(JobType type, const Job& job, Util::Array<IO::URI>& outputs)
 {
-    this->mode = mode;
+    IoServer* ioServer = IoServer::Instance();
+    const IO::URI& file = job.file;
+    const Util::String& category = job.category;
+    Util::String const fileName = file.AsString().ExtractFileName();
+    Util::String name = fileName;
+    name.StripFileExtension();
+
+    switch (type)
+    {
+        case GLTFJob:
+        {
+            Ptr<ToolkitUtil::NglTFExporter> gltfExporter = ToolkitUtil::NglTFExporter::Create();
+            gltfExporter->SetTextureConverter(&this->textureExporter);
+            gltfExporter->Open();
+            gltfExporter->SetForce(true);
+            gltfExporter->SetCategory(category);
+            gltfExporter->SetLogger(this->logger);
+            gltfExporter->SetFile(fileName);
+            gltfExporter->ExportFile(file);
+            gltfExporter->Close();
+
+            // the models written along with the meshes belong to the model jobs
+            outputs.AppendArray(gltfExporter->GetExportedFiles());
+            break;
+        }
+        case FBXJob:
+        {
+            Ptr<ToolkitUtil::NFbxExporter> fbxExporter = ToolkitUtil::NFbxExporter::Create();
+            fbxExporter->Open();
+            fbxExporter->SetForce(true);
+            fbxExporter->SetCategory(category);
+            fbxExporter->SetLogger(this->logger);
+            fbxExporter->SetFile(fileName);
+            fbxExporter->ExportFile(file);
+            fbxExporter->Close();
+            outputs.AppendArray(fbxExporter->GetExportedFiles());
+            break;
+        }
+        case ModelJob:
+        {
+            String modelName = category + "/" + name;
+            Ptr<ModelConstants> constants = ModelDatabase::Instance()->LookupConstants(modelName, true);
+            Ptr<ModelAttributes> attributes = ModelDatabase::Instance()->LookupAttributes(modelName, true);
+            Ptr<ModelPhysics> physics = ModelDatabase::Instance()->LookupPhysics(modelName, true);
+
+            Ptr<ToolkitUtil::ModelBuilder> modelBuilder = ToolkitUtil::ModelBuilder::Create();
+            modelBuilder->SetConstants(constants);
+            modelBuilder->SetAttributes(attributes);
+            modelBuilder->SetPhysics(physics);
+
+            String modelPath = String::Sprintf("mdl:%s.n3", modelName.AsCharPtr());
+            this->logger->Print(
+                "%s -> %s\n",
+                Text(file.LocalPath()).Color(TextColor::Blue).AsCharPtr(),
+                Text(URI(modelPath).LocalPath()).Color(TextColor::Green).AsCharPtr()
+            );
+            modelBuilder->SaveN3(modelPath, this->platform);
+
+            String physicsPath = String::Sprintf("phys:%s.actor", modelName.AsCharPtr());
+            modelBuilder->SaveN3Physics(physicsPath, this->platform);
+            outputs.Append(modelPath);
+            outputs.Append(physicsPath);
+            break;
+        }
+        case TextureJob:
+        {
+            Util::String dstDir = Util::String::Sprintf("tex:%s", category.AsCharPtr());
+            Util::String dstFile = Util::String::Sprintf("%s/%s", dstDir.AsCharPtr(), name.AsCharPtr());
+
+            // textures are converted in parallel, so every job needs its own temporary directory
+            Guid guid;
+            guid.Generate();
+            Util::String tmpDir = Util::String::Sprintf("temp:textureconverter/%s", guid.AsString().AsCharPtr());
+            if (file.AsString().GetFileExtension() == "cube")
+                this->textureExporter.ConvertCubemap(file.AsString(), dstFile, tmpDir);
+            else
+                this->textureExporter.ConvertTexture(file.AsString(), dstFile, tmpDir);
+            if (ioServer->DirectoryExists(tmpDir))
+            {
+                ioServer->DeleteDirectory(tmpDir);
+            }
+            outputs.Append(dstFile + ".dds");
+            break;
+        }
+        case SurfaceJob:
+        {
+            Ptr<ToolkitUtil::SurfaceExporter> surfaceExporter = ToolkitUtil::SurfaceExporter::Create();
+            surfaceExporter->Open();
+            surfaceExporter->SetForce(true);
+            surfaceExporter->SetLogger(this->logger);
+            surfaceExporter->ExportFile(file);
+            surfaceExporter->Close();
+            outputs.Append(String::Sprintf("sur:%s/%s.sur", file.LocalPath().ExtractLastDirName().AsCharPtr(), name.AsCharPtr()));
+            break;
+        }
+        case ParticleJob:
+        {
+            Ptr<ToolkitUtil::ParticleExporter> particleExporter = ToolkitUtil::ParticleExporter::Create();
+            particleExporter->Open();
+            particleExporter->SetForce(true);
+            particleExporter->SetLogger(this->logger);
+            particleExporter->ExportFile(file);
+            particleExporter->Close();
+            outputs.Append(String::Sprintf("par:%s/%s.par", file.LocalPath().ExtractLastDirName().AsCharPtr(), name.AsCharPtr()));
+            break;
+        }
+        case AudioJob:
+        {
+            Util::String dstDir = Util::String::Sprintf("dst:audio/%s", category.AsCharPtr());
+            ioServer->CreateDirectory(dstDir);
+            Util::String dstFile = Util::String::Sprintf("%s/%s", dstDir.AsCharPtr(), fileName.AsCharPtr());
+            this->logger->Print(
+                "%s -> %s\n",
+                Text(file.LocalPath()).Color(TextColor::Blue).AsCharPtr(),
+                Text(URI(dstFile).LocalPath()).Color(TextColor::Green).AsCharPtr()
+            );
+            ioServer->CopyFile(file, dstFile);
+            outputs.Append(dstFile);
+            break;
+        }
+        case PhysicsJob:
+        {
+            Util::String dstDir = Util::String::Sprintf("dst:physics/%s", category.AsCharPtr());
+            Util::String dstFile = Util::String::Sprintf("%s/%s", dstDir.AsCharPtr(), fileName.AsCharPtr());
+            this->logger->Print(
+                "%s -> %s\n",
+                Text(Format("%s", file.AsString().AsCharPtr())).Color(TextColor::Blue).AsCharPtr(),
+                Text(URI(dstFile).LocalPath()).Color(TextColor::Green).Style(FontMode::Underline).AsCharPtr()
+            );
+            Flat::FlatbufferInterface::Compile(file, dstDir, "ACTO");
+            outputs.Append(dstFile);
+            break;
+        }
+        default:
+            n_error("AssetExporter: unknown job type %d\n", type);
+            break;
+    }
 }
 
 } // namespace ToolkitUtil
@@ -5,7 +5,13 @@
     
     The asset exporter takes a single directory and exports any models, textures and gfx-sources.
 
-    This isn't based on an exporter class, because it has no need for incremental batching.
+    Files are queued as export jobs and run on the job threads. Models wait
+    for the scenes which write their attributes and surfaces wait for the
+    textures, everything else runs in parallel. glTF scenes are exported up
+    front, since the glTF exporter distributes its own work over the job
+    threads. Whether a job has to run is decided by the build cache.
+    Jobs create their own exporters, only the texture converter is shared
+    and it isn't modified while jobs run.
     
     (C) 2015-2016 Individual contributors, see AUTHORS file
 */
@@ -20,6 +26,7 @@
 #include "toolkit-common/toolkitconsolehandler.h"
 #include "toolkitutil/model/import/gltf/ngltfexporter.h"
 #include "toolkitutil/particle/particleexporter.h"
+#include "toolkitutil/asset/assetbuildcache.h"
 
 namespace ToolkitUtil
 {
@@ -86,13 +93,50 @@ public:
     const Util::Array<ToolkitUtil::ToolLog> & GetMessages() const;
 
 private:
-    Ptr<ToolkitUtil::NFbxExporter> fbxExporter;
-    Ptr<ToolkitUtil::NglTFExporter> gltfExporter;
+    enum JobType
+    {
+        GLTFJob,
+        FBXJob,
+        ModelJob,
+        TextureJob,
+        SurfaceJob,
+        ParticleJob,
+        AudioJob,
+        PhysicsJob,
+
+        NumJobTypes
+    };
+
+    struct Job
+    {
+        IO::URI file;
+        Util::String category;
+        ToolLogEntry log;
+        bool exported;
+    };
+
+    /// get the type of job exporting a file, returns false if the file isn't exported in the current mode
+    bool GetJobType(const Util::String& file, JobType& type) const;
+    /// queue a single file
+    void QueueFile(const IO::URI& file, const Util::String& category);
+    /// queue all files of a folder
+    void QueueFolder(const Util::String& assetPath, const Util::String& category);
+    /// queue a list of files and folders
+    void QueueList(const Util::Array<Util::String>& files);
+    /// run all queued jobs
+    void RunJobs();
+    /// run a single job, called from the job threads
+    void RunJob(JobType type, Job& job);
+    /// get the files the output of a job depends on
+    void GetJobInputs(JobType type, const Job& job, Util::Array<IO::URI>& inputs) const;
+    /// export the file of a job
+    void Export(JobType type, const Job& job, Util::Array<IO::URI>& outputs);
+
     ToolkitUtil::TextureConverter textureExporter;
-    Ptr<ToolkitUtil::SurfaceExporter> surfaceExporter;
-    Ptr<ToolkitUtil::ParticleExporter> particleExporter;
-    Ptr<ToolkitUtil::ModelBuilder> modelBuilder;    
     ToolkitUtil::TextureAttrTable textureAttrTable;
+    ToolkitUtil::AssetBuildCache cache;
+    Util::Array<Job> jobs[NumJobTypes];
+    Util::Array<Util::String> jobCategories;
     unsigned int mode;
     Util::Array<ToolLog> messages;
 };
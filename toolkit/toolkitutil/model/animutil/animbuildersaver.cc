@@ -7,6 +7,7 @@
 #include "model/animutil/animbuildersaver.h"
 #include "io/ioserver.h"
 #include "coreanimation/naxfileformatstructs.h"
+#include "coreanimation/animkeycompression.h"
 
 namespace ToolkitUtil
 {
@@ -20,7 +21,7 @@ using namespace Math;
 /**
 */
 bool
-AnimBuilderSaver::Save(const URI& uri, const Util::Array<AnimBuilder>& animBuilders, Platform::Code platform)
+AnimBuilderSaver::Save(const URI& uri, const Util::Array<AnimBuilder>& animBuilders, Platform::Code platform, bool compressKeys)
 {
     // make sure the target directory exists
     IoServer::Instance()->CreateDirectory(uri.LocalPath().ExtractDirName());
@@ -30,8 +31,8 @@ AnimBuilderSaver::Save(const URI& uri, const Util::Array<AnimBuilder>& animBuild
     if (stream->Open())
     {
         ByteOrder byteOrder(ByteOrder::Host, Platform::GetPlatformByteOrder(platform));
-        AnimBuilderSaver::WriteHeader(stream, animBuilders, byteOrder);
-        AnimBuilderSaver::WriteAnimations(stream, animBuilders, byteOrder);
+        AnimBuilderSaver::WriteHeader(stream, animBuilders, byteOrder, compressKeys);
+        AnimBuilderSaver::WriteAnimations(stream, animBuilders, byteOrder, compressKeys);
 
         stream->Close();
         stream = nullptr;
@@ -48,11 +49,11 @@ AnimBuilderSaver::Save(const URI& uri, const Util::Array<AnimBuilder>& animBuild
 /**
 */
 void
-AnimBuilderSaver::WriteHeader(const Ptr<Stream>& stream, const Util::Array<AnimBuilder>& animBuilders, const ByteOrder& byteOrder)
+AnimBuilderSaver::WriteHeader(const Ptr<Stream>& stream, const Util::Array<AnimBuilder>& animBuilders, const ByteOrder& byteOrder, bool compressKeys)
 {
-    // setup header
+    // setup header, NAX4 shares the header with NAX3
     Nax3Header nax3Header;
-    nax3Header.magic         = byteOrder.Convert<uint>(NEBULA_NAX3_MAGICNUMBER);
+    nax3Header.magic         = byteOrder.Convert<uint>(compressKeys ? NEBULA_NAX4_MAGICNUMBER : NEBULA_NAX3_MAGICNUMBER);
     nax3Header.numAnimations = byteOrder.Convert(animBuilders.Size());
 
     // write header
@@ -63,58 +64,73 @@ AnimBuilderSaver::WriteHeader(const Ptr<Stream>& stream, const Util::Array<AnimB
 /**
 */
 void 
-AnimBuilderSaver::WriteAnimations(const Ptr<IO::Stream>& stream, const Util::Array<AnimBuilder>& animBuilders, const System::ByteOrder& byteOrder)
+AnimBuilderSaver::WriteAnimations(const Ptr<IO::Stream>& stream, const Util::Array<AnimBuilder>& animBuilders, const System::ByteOrder& byteOrder, bool compressKeys)
 {
     for (auto& anim : animBuilders)
     {
+        Util::Array<Nax3Interval> intervals;
+        Util::Array<Nax4Curve> compressedCurves;
+        Util::Array<ushort> compressedKeys;
+        if (compressKeys)
+            AnimBuilderSaver::CompressCurves(anim, compressedCurves, intervals, compressedKeys, byteOrder);
+
         Nax3Anim nax3;
         nax3.numClips = anim.GetNumClips();
         nax3.numEvents = anim.events.Size();
         nax3.numCurves = anim.curves.Size();
-        nax3.numKeys = anim.keys.Size();
-        nax3.numIntervals = 0;
-        for (const auto& curve : anim.curves)
+        nax3.numKeys = compressKeys ? compressedKeys.Size() : anim.keys.Size();
+        nax3.numIntervals = intervals.Size();
+        if (!compressKeys)
         {
-            nax3.numIntervals += curve.numKeys == 0 ? 0 : curve.numKeys - 1;
+            for (const auto& curve : anim.curves)
+            {
+                nax3.numIntervals += curve.numKeys == 0 ? 0 : curve.numKeys - 1;
+            }
         }
 
         // write header
         stream->Write(&nax3, sizeof(nax3));
 
-        Util::Array<Nax3Interval> intervals;
+        for (const auto& nax4Curve : compressedCurves)
+        {
+            stream->Write(&nax4Curve, sizeof(nax4Curve));
+        }
 
-        for (const auto& curve : anim.curves)
+        if (!compressKeys)
         {
-            // write curve attributes
-            Nax3Curve nax3Curve;
-            nax3Curve.firstIntervalOffset = intervals.Size();
-            nax3Curve.numIntervals = curve.numKeys == 0 ? 0 : curve.numKeys - 1;
-            nax3Curve.preInfinityType = curve.preInfinityType;
-            nax3Curve.postInfinityType = curve.postInfinityType;
-            nax3Curve.curveType = curve.curveType;
+            for (const auto& curve : anim.curves)
+            {
+                // write curve attributes
+                Nax3Curve nax3Curve;
+                nax3Curve.firstIntervalOffset = intervals.Size();
+                nax3Curve.numIntervals = curve.numKeys == 0 ? 0 : curve.numKeys - 1;
+                nax3Curve.preInfinityType = curve.preInfinityType;
+                nax3Curve.postInfinityType = curve.postInfinityType;
+                nax3Curve.curveType = curve.curveType;
 
-            byteOrder.ConvertInPlace(nax3Curve.firstIntervalOffset);
-            byteOrder.ConvertInPlace(nax3Curve.numIntervals);
+                byteOrder.ConvertInPlace(nax3Curve.firstIntervalOffset);
+                byteOrder.ConvertInPlace(nax3Curve.numIntervals);
 
-            // write to stream
-            stream->Write(&nax3Curve, sizeof(nax3Curve));            
+                // write to stream
+                stream->Write(&nax3Curve, sizeof(nax3Curve));            
 
-            int stride = curve.curveType == CurveType::Rotation ? 4 : 3;
+                int stride = curve.curveType == CurveType::Rotation ? 4 : 3;
 
-            // Create intervals for the keys
-            for (IndexT i = 0; i < nax3Curve.numIntervals; i++)
-            {
-                Timing::Tick start = anim.keyTimes[curve.firstTimeOffset + i];
-                Timing::Tick end = anim.keyTimes[curve.firstTimeOffset + i + 1];
-                Nax3Interval interval;
+                // Create intervals for the keys
+                for (IndexT i = 0; i < nax3Curve.numIntervals; i++)
+                {
+                    Timing::Tick start = anim.keyTimes[curve.firstTimeOffset + i];
+                    Timing::Tick end = anim.keyTimes[curve.firstTimeOffset + i + 1];
+                    Nax3Interval interval;
 
-                interval.start = byteOrder.Convert(start);
-                interval.end = byteOrder.Convert(end);
-                interval.key0 = byteOrder.Convert(curve.firstKeyOffset + i * stride);
-                interval.key1 = byteOrder.Convert(curve.firstKeyOffset + (i + 1) * stride);
-                interval.duration = 1 / float(interval.end - interval.start);
+                    interval.start = byteOrder.Convert(start);
+                    interval.end = byteOrder.Convert(end);
+                    interval.key0 = byteOrder.Convert(curve.firstKeyOffset + i * stride);
+                    interval.key1 = byteOrder.Convert(curve.firstKeyOffset + (i + 1) * stride);
+                    interval.duration = 1 / float(interval.end - interval.start);
 
-                intervals.Append(interval);
+                    intervals.Append(interval);
+                }
             }
         }
 
@@ -186,11 +202,121 @@ AnimBuilderSaver::WriteAnimations(const Ptr<IO::Stream>& stream, const Util::Arr
             stream->Write(&interval, sizeof(Nax3Interval));
         }
 
-        for (const float key : anim.keys)
+        if (compressKeys)
+        {
+            for (const ushort key : compressedKeys)
+            {
+                ushort value = byteOrder.Convert(key);
+                stream->Write(&value, sizeof(ushort));
+            }
+        }
+        else
+        {
+            for (const float key : anim.keys)
+            {
+                float value = byteOrder.Convert(key);
+                stream->Write(&value, sizeof(float));
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Curves where all keys are the same are stored as a single uncompressed key,
+    otherwise every key is quantized to three 16 bit values. Translation, scale and
+    velocity keys are quantized relative to the range of their curve.
+*/
+void
+AnimBuilderSaver::CompressCurves(const AnimBuilder& anim, Util::Array<Nax4Curve>& curves, Util::Array<Nax3Interval>& intervals, Util::Array<ushort>& keys, const System::ByteOrder& byteOrder)
+{
+    const float StaticKeyTolerance = 0.00001f;
+    for (const auto& curve : anim.curves)
+    {
+        Nax4Curve nax4Curve;
+        Memory::Clear(&nax4Curve, sizeof(nax4Curve));
+        nax4Curve.firstIntervalOffset = intervals.Size();
+        nax4Curve.preInfinityType = curve.preInfinityType;
+        nax4Curve.postInfinityType = curve.postInfinityType;
+        nax4Curve.curveType = curve.curveType;
+
+        bool const rotation = curve.curveType == CurveType::Rotation;
+        int const stride = rotation ? 4 : 3;
+        const float* src = curve.numKeys > 0 ? &anim.keys[curve.firstKeyOffset] : nullptr;
+
+        // find out if all keys are the same, and the range of translation, scale and velocity keys
+        bool isStatic = curve.numKeys > 0;
+        vec3 min(FLT_MAX), max(-FLT_MAX);
+        for (IndexT i = 0; i < (IndexT)curve.numKeys; i++)
+        {
+            const float* key = src + i * stride;
+            for (IndexT j = 0; j < stride; j++)
+                isStatic &= Math::abs(key[j] - src[j]) <= StaticKeyTolerance;
+            if (!rotation)
+            {
+                min = minimize(min, vec3(key[0], key[1], key[2]));
+                max = maximize(max, vec3(key[0], key[1], key[2]));
+            }
+        }
+
+        if (isStatic)
+        {
+            nax4Curve.flags = Nax4CurveStatic;
+            for (IndexT j = 0; j < stride; j++)
+                nax4Curve.keyOffset[j] = src[j];
+        }
+        else if (curve.numKeys > 0)
         {
-            float value = byteOrder.Convert(key);
-            stream->Write(&value, sizeof(float));
+            vec3 offset, scale;
+            if (!rotation)
+            {
+                AnimVectorRange(min, max, offset, scale);
+                for (IndexT j = 0; j < 3; j++)
+                {
+                    nax4Curve.keyOffset[j] = offset[j];
+                    nax4Curve.keyScale[j] = scale[j];
+                }
+            }
+
+            uint const firstKey = keys.Size();
+            for (IndexT i = 0; i < (IndexT)curve.numKeys; i++)
+            {
+                const float* key = src + i * stride;
+                ushort compressed[3];
+                if (rotation)
+                    AnimCompressRotation(quat(key[0], key[1], key[2], key[3]), compressed);
+                else
+                    AnimCompressVector(vec3(key[0], key[1], key[2]), offset, scale, compressed);
+                keys.Append(compressed[0]);
+                keys.Append(compressed[1]);
+                keys.Append(compressed[2]);
+            }
+
+            // Create intervals for the keys
+            nax4Curve.numIntervals = curve.numKeys - 1;
+            for (IndexT i = 0; i < (IndexT)nax4Curve.numIntervals; i++)
+            {
+                Timing::Tick start = anim.keyTimes[curve.firstTimeOffset + i];
+                Timing::Tick end = anim.keyTimes[curve.firstTimeOffset + i + 1];
+                Nax3Interval interval;
+
+                interval.start = byteOrder.Convert(start);
+                interval.end = byteOrder.Convert(end);
+                interval.key0 = byteOrder.Convert(firstKey + i * 3);
+                interval.key1 = byteOrder.Convert(firstKey + (i + 1) * 3);
+                interval.duration = byteOrder.Convert(1 / float(end - start));
+
+                intervals.Append(interval);
+            }
         }
+
+        nax4Curve.firstIntervalOffset = byteOrder.Convert(nax4Curve.firstIntervalOffset);
+        nax4Curve.numIntervals = byteOrder.Convert(nax4Curve.numIntervals);
+        for (IndexT j = 0; j < 4; j++)
+            nax4Curve.keyOffset[j] = byteOrder.Convert(nax4Curve.keyOffset[j]);
+        for (IndexT j = 0; j < 3; j++)
+            nax4Curve.keyScale[j] = byteOrder.Convert(nax4Curve.keyScale[j]);
+        curves.Append(nax4Curve);
     }
 }
 
@@ -3,7 +3,7 @@
 /**
     @class ToolkitUtil::AnimBuilderSaver
     
-    Save AnimBuilder object into NAX3 file.
+    Save AnimBuilder object into NAX3 file, or NAX4 file if the keys are compressed.
     
     (C) 2009 Radon Labs GmbH
     (C) 2013-2016 Individual contributors, see AUTHORS file
@@ -13,6 +13,7 @@
 #include "toolkit-common/platform.h"
 #include "io/stream.h"
 #include "system/byteorder.h"
+#include "coreanimation/naxfileformatstructs.h"
 
 //------------------------------------------------------------------------------
 namespace ToolkitUtil
@@ -20,14 +21,16 @@ namespace ToolkitUtil
 class AnimBuilderSaver
 {
 public:
-    /// Save NAX3 file
-    static bool Save(const IO::URI& uri, const Util::Array<AnimBuilder>& animBuilders, Platform::Code platform);
+    /// Save NAX3 file, or NAX4 file if the keys should be compressed
+    static bool Save(const IO::URI& uri, const Util::Array<AnimBuilder>& animBuilders, Platform::Code platform, bool compressKeys = true);
 
 private:
     /// Write header to stream
-    static void WriteHeader(const Ptr<IO::Stream>& stream, const Util::Array<AnimBuilder>& animBuilders, const System::ByteOrder& byteOrder);
+    static void WriteHeader(const Ptr<IO::Stream>& stream, const Util::Array<AnimBuilder>& animBuilders, const System::ByteOrder& byteOrder, bool compressKeys);
     /// Write anim header to stream
-    static void WriteAnimations(const Ptr<IO::Stream>& stream, const Util::Array<AnimBuilder>& animBuilders, const System::ByteOrder& byteOrder);
+    static void WriteAnimations(const Ptr<IO::Stream>& stream, const Util::Array<AnimBuilder>& animBuilders, const System::ByteOrder& byteOrder, bool compressKeys);
+    /// Compress the curves and keys of an animation
+    static void CompressCurves(const AnimBuilder& anim, Util::Array<CoreAnimation::Nax4Curve>& curves, Util::Array<CoreAnimation::Nax3Interval>& intervals, Util::Array<ushort>& keys, const System::ByteOrder& byteOrder);
 };
 
 } // namespace ToolkitUtil
@@ -16,7 +16,6 @@
 #include "model/meshutil/meshbuildersaver.h"
 
 #include "model/import/gltf/node/ngltfscene.h"
-#include "model/import/base/uniquestring.h"
 
 #include "model/modelutil/modeldatabase.h"
 
@@ -63,9 +62,6 @@ ModelExporter::ExportFile(const IO::URI& file)
 {
     IO::IoServer* ioServer = IO::IoServer::Instance();
 
-    // Reset all unique strings
-    UniqueString::Reset();
-
     outputFiles.Clear();
 
     this->path = file;
@@ -133,8 +129,46 @@ ModelExporter::ExportFile(const IO::URI& file)
         , Skeleton
     };
 
+    // weld vertices and reorder triangles for the vertex cache
+    Util::FixedArray<float> acmrBefore(mergedMeshes.Size());
+    for (IndexT i = 0; i < mergedMeshes.Size(); i++)
+    {
+        acmrBefore[i] = mergedMeshes[i]->ComputeAcmr();
+        mergedMeshes[i]->Deflate(nullptr);
+        mergedMeshes[i]->OptimizeVertexCache();
+    }
+
+    // split the render meshes into meshlets for cluster culling, this reorders their triangles
+    Timing::Timer meshletTimer;
+    meshletTimer.Start();
+    MeshletBuilder meshlets;
+    meshlets.Build(mergedMeshes);
+    meshletTimer.Stop();
+    SizeT numMeshlets = meshlets.GetMeshlets().Size();
+    if (numMeshlets > 0)
+    {
+        this->logger->Print("Meshlets: %d for %d triangles, %.1f triangles per meshlet, %d bytes (%.2f ms)\n",
+            numMeshlets,
+            meshlets.GetNumTriangles(),
+            meshlets.GetNumTriangles() / float(numMeshlets),
+            int(numMeshlets * sizeof(CoreGraphics::Nvx3Meshlet)),
+            meshletTimer.GetTime() * 1000.0f);
+    }
+
+    // the final triangle order is known, lay out the vertices in the order they are used
+    for (IndexT i = 0; i < mergedMeshes.Size(); i++)
+    {
+        mergedMeshes[i]->OptimizeVertexFetch();
+        this->logger->Print("Mesh %d: %d vertices, %d triangles, ACMR %.3f -> %.3f\n",
+            i,
+            mergedMeshes[i]->GetNumVertices(),
+            mergedMeshes[i]->GetNumTriangles(),
+            acmrBefore[i],
+            mergedMeshes[i]->ComputeAcmr());
+    }
+
     // save mesh to file
-    if (!MeshBuilderSaver::Save(destinationFiles[DestinationFile::Mesh], mergedMeshes, this->platform))
+    if (!MeshBuilderSaver::Save(destinationFiles[DestinationFile::Mesh], mergedMeshes, this->platform, &meshlets))
     {
         this->logger->Error("Failed to save NVX file : % s\n", destinationFiles[DestinationFile::Mesh].LocalPath().AsCharPtr());
     }
@@ -11,6 +11,7 @@
 #include "scenenode.h"
 #include "toolkit-common/base/exporttypes.h"
 #include "toolkit-common/logger.h"
+#include "uniquestring.h"
 
 namespace ToolkitUtil
 {
@@ -66,6 +67,8 @@ protected:
     Util::String name;
     Util::String category;
     ToolkitUtil::ExportFlags flags;
+    /// node names are unique within the scene
+    UniqueString uniqueNames;
 };
 
 
@@ -8,12 +8,19 @@
 namespace ToolkitUtil
 {
 
-Util::Dictionary<IndexT, SizeT> UniqueString::Lookup;
+//------------------------------------------------------------------------------
+/**
+*/
+UniqueString::UniqueString()
+{
+    // empty
+}
+
 //------------------------------------------------------------------------------
 /**
 */
 Util::String
-ToolkitUtil::UniqueString::New(const Util::String& str)
+UniqueString::New(const Util::String& str)
 {
     // If string is empty, return a randomly generated GUID
     if (str.IsEmpty())
@@ -24,17 +31,17 @@ ToolkitUtil::UniqueString::New(const Util::String& str)
     }
 
     auto hash = str.HashCode();
-    IndexT i = UniqueString::Lookup.FindIndex(hash);
+    IndexT i = this->lookup.FindIndex(hash);
 
     if (i == InvalidIndex)
     {
-        UniqueString::Lookup.Add(hash, 0);
+        this->lookup.Add(hash, 0);
         return str;
     }
     else
     {
         Util::String ret;
-        SizeT& value = UniqueString::Lookup.ValueAtIndex(i);
+        SizeT& value = this->lookup.ValueAtIndex(i);
         ret.Format("%s_%d", str.AsCharPtr(), value);
         value++;
         return ret;
@@ -47,7 +54,7 @@ ToolkitUtil::UniqueString::New(const Util::String& str)
 Util::String
 UniqueString::New(const char* str)
 {
-    return UniqueString::New(Util::String(str));
+    return this->New(Util::String(str));
 }
 
 //------------------------------------------------------------------------------
@@ -56,7 +63,7 @@ UniqueString::New(const char* str)
 void 
 UniqueString::Reset()
 {
-    Lookup.Clear();
+    this->lookup.Clear();
 }
 
 } // namespace ToolkitUtil
\ No newline at end of file
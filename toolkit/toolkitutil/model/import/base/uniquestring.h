@@ -3,6 +3,9 @@
 /**
     A UniqueString is a Util::String of which there can be only one.
 
+    The strings are unique within a table, every scene owns its own
+    table so scenes can be exported in parallel.
+
     @copyright
     (C) 2022 Individual contributors, see AUTHORS file
 */
@@ -14,18 +17,18 @@ namespace ToolkitUtil
 class UniqueString
 {
 public:
-    /// Delete constructor
-    UniqueString() = delete;
+    /// constructor
+    UniqueString();
 
     /// Uniqueify string
-    static Util::String New(const Util::String& str);
+    Util::String New(const Util::String& str);
     /// Uniqueify string
-    static Util::String New(const char* str);
+    Util::String New(const char* str);
 
     /// Reset strings
-    static void Reset();
+    void Reset();
 
 private:
-    static Util::Dictionary<IndexT, SizeT> Lookup;
+    Util::Dictionary<IndexT, SizeT> lookup;
 };
 } // namespace ToolkitUtil
@@ -18,9 +18,9 @@ int JointCounter = 0;
 /**
 */
 void 
-NFbxJointNode::Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode)
+NFbxJointNode::Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode, UniqueString& names)
 {
-    NFbxNode::Setup(node, parent, fbxNode);
+    NFbxNode::Setup(node, parent, fbxNode, names);
     ufbx_bone* bone = ufbx_as_bone(fbxNode->attrib);
     ufbx_node* parentFbx = fbxNode->parent;
     node->skeleton.isSkeletonRoot = parent == nullptr || parentFbx->attrib_type == UFBX_ELEMENT_UNKNOWN;
@@ -12,11 +12,12 @@
 namespace ToolkitUtil
 {
 class SceneNode;
+class UniqueString;
 class NFbxJointNode
 {
 public:
     /// Setup node from FBX node
-    static void Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode);
+    static void Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode, UniqueString& names);
 }; 
 
 } // namespace ToolkitUtil
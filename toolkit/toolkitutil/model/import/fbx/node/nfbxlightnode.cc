@@ -15,9 +15,9 @@ namespace ToolkitUtil
 /**
 */
 void 
-NFbxLightNode::Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode)
+NFbxLightNode::Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode, UniqueString& names)
 {
-    NFbxNode::Setup(node, parent, fbxNode);
+    NFbxNode::Setup(node, parent, fbxNode, names);
     ufbx_light* light = fbxNode->light;
     switch (light->type)
     {
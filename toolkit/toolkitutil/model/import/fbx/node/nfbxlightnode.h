@@ -12,11 +12,12 @@
 namespace ToolkitUtil
 {
 class SceneNode;
+class UniqueString;
 class NFbxLightNode
 {
 public:
     /// Setup node from FBX node
-    static void Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode);
+    static void Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode, UniqueString& names);
 
     enum LightType
     {
@@ -17,8 +17,6 @@ using namespace Util;
 using namespace CoreAnimation;
 using namespace ToolkitUtil;
 
-uint MeshCounter = 0;
-
 //------------------------------------------------------------------------------
 /**
 */
@@ -27,9 +25,10 @@ NFbxMeshNode::Setup(
     SceneNode* node
     , SceneNode* parent
     , ufbx_node* fbxNode
+    , UniqueString& names
 )
 {
-    NFbxNode::Setup(node, parent, fbxNode);
+    NFbxNode::Setup(node, parent, fbxNode, names);
 }
 
 //------------------------------------------------------------------------------
@@ -118,9 +117,8 @@ NFbxMeshNode::ExtractMesh(
         n_assert_msg(normalCount > 0, "You need at least one set of normals or no shader will be applicable!");
     }
 
-    // get scale
-    uint groupId = MeshCounter++;
-    node->mesh.groupId = groupId;
+    // group ids only have to be unique within the scene, which is exported on a single job
+    node->mesh.groupId = node->mesh.meshIndex;
 
     MeshBuilderVertex::ComponentMask componentMask = 0x0;
     Util::FixedArray<Math::vec3> controlPoints;
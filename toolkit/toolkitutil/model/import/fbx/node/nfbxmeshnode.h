@@ -15,11 +15,11 @@
 #include "math/vec4.h"
 #include "ufbx/ufbx.h"
 
-extern uint MeshCounter;
 namespace ToolkitUtil
 {
 
 class SceneNode;
+class UniqueString;
 class NFbxMeshNode
 {
 public:
@@ -27,7 +27,7 @@ public:
     typedef uint MeshMask;
 
     /// Setup node from FBX node
-    static void Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode);
+    static void Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode, UniqueString& names);
 
     /// Extract mesh
     static void ExtractMesh(
@@ -101,9 +101,9 @@ FbxToMath(const ufbx_vec2& vector)
 /**
 */
 void 
-NFbxNode::Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode)
+NFbxNode::Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode, UniqueString& names)
 {
-    node->base.name = UniqueString::New(fbxNode->name.data);
+    node->base.name = names.New(fbxNode->name.data);
     if (node->base.name == "physics")
     {
         node->base.isPhysics = true;
@@ -32,6 +32,7 @@ Math::vec3 FbxToMath(const ufbx_vec3& vector);
 Math::vec2 FbxToMath(const ufbx_vec2& vector);
 
 class SceneNode;
+class UniqueString;
 class NFbxScene;
 class NFbxMeshNode;
 class ModelAttributes;
@@ -42,7 +43,7 @@ class NFbxNode
 public:
 
     /// Setup base node
-    static void Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode);
+    static void Setup(SceneNode* node, SceneNode* parent, ufbx_node* fbxNode, UniqueString& names);
 
     /// Generates animation clip
     static void ExtractAnimation(SceneNode* node, Util::Array<float>& keys, Util::Array<Timing::Tick>& keyTimes, ufbx_anim_stack* animStack);
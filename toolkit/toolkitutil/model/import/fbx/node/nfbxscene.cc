@@ -49,31 +49,31 @@ NFbxScene::ParseNodeHierarchy(
         case UFBX_ELEMENT_BONE:
         {
             node.Setup(SceneNode::NodeType::Joint);
-            NFbxJointNode::Setup(&node, parent, fbxNode); 
+            NFbxJointNode::Setup(&node, parent, fbxNode, this->uniqueNames); 
             break;
         }
         case UFBX_ELEMENT_MESH:
         {
             node.Setup(SceneNode::NodeType::Mesh);
-            NFbxNode::Setup(&node, parent, fbxNode);
+            NFbxNode::Setup(&node, parent, fbxNode, this->uniqueNames);
             break;
         }
         case UFBX_ELEMENT_LOD_GROUP:
         {
             node.Setup(SceneNode::NodeType::Lod);
-            NFbxNode::Setup(&node, parent, fbxNode);
+            NFbxNode::Setup(&node, parent, fbxNode, this->uniqueNames);
             break;
         }
         case UFBX_ELEMENT_LIGHT:
         {
             node.Setup(SceneNode::NodeType::Light);
-            NFbxLightNode::Setup(&node, parent, fbxNode);
+            NFbxLightNode::Setup(&node, parent, fbxNode, this->uniqueNames);
             break;
         }
         default:
         {
             node.Setup(SceneNode::NodeType::Transform);
-            NFbxNode::Setup(&node, parent, fbxNode);
+            NFbxNode::Setup(&node, parent, fbxNode, this->uniqueNames);
             break;
         }
     }
@@ -441,7 +441,7 @@ NglTFScene::ParseNodeHierarchy(
     node.base.name = gltfNode->name;
     if (node.base.name.IsEmpty())
     {
-        node.base.name = UniqueString::New("unnamed");
+        node.base.name = this->uniqueNames.New("unnamed");
     }
 
     size_t numChildren = gltfNode->children.Size();
@@ -192,126 +192,99 @@ MeshBuilder::Transform(const mat4& m)
 
 //------------------------------------------------------------------------------
 /**
-    qsort() hook for Deflate() method.
-*/
-MeshBuilder* MeshBuilder::qsortData = 0;
-int
-__cdecl
-MeshBuilder::VertexSorter(const void* elm0, const void* elm1)
-{
-    MeshBuilder* meshBuilder = qsortData;
-    int i0 = *(int*)elm0;
-    int i1 = *(int*)elm1;
-    const MeshBuilderVertex& v0 = meshBuilder->VertexAt(i0);
-    const MeshBuilderVertex& v1 = meshBuilder->VertexAt(i1);
-    return v0.Compare(v1);
-}
+    Weld equal vertices in a single pass over the vertices. Every vertex is
+    looked up in an open addressing table keyed by its hash, the first
+    occurrence of a vertex is kept and later ones are mapped onto it, so
+    the order of the remaining vertices is preserved. Triangles are
+    remapped to the new indices. Returns the number of remaining vertices.
 
-//------------------------------------------------------------------------------
-/**
-    Cleanup the mesh. This removes redundant vertices and optionally record
-    the collapse history into a client-provided collapsMap. The collaps map
-    contains at each new vertex index the 'old' vertex indices which have
-    been collapsed into the new vertex.
+    The table is local, so different meshes can be welded concurrently.
 */
-void
-MeshBuilder::Deflate(FixedArray<Array<IndexT>>* collapsMap)
+SizeT
+MeshBuilder::WeldVertices(FixedArray<IndexT>& indexMap)
 {
-    // generate a index remapping table and sorted vertex array
-    SizeT numVertices = this->GetNumVertices();
-    IndexT* indexMap = (IndexT*)Memory::Alloc(Memory::ScratchHeap, numVertices * sizeof(IndexT));
-    IndexT* sortMap = (IndexT*)Memory::Alloc(Memory::ScratchHeap, numVertices * sizeof(IndexT));
-    IndexT* shiftMap = (IndexT*)Memory::Alloc(Memory::ScratchHeap, numVertices * sizeof(IndexT));
-    IndexT i;
-    for (i = 0; i < numVertices; i++)
-    {
-        indexMap[i] = i;
-        sortMap[i] = i;
-    }
+    const SizeT numVertices = this->vertices.Size();
+    indexMap.SetSize(numVertices);
 
-    // generate a sorted index map (sort by X coordinate)
-    qsortData = this;
-    qsort(sortMap, numVertices, sizeof(IndexT), MeshBuilder::VertexSorter);
-
-    // search sorted array for redundant vertices
-    IndexT baseIndex = 0;
-    for (baseIndex = 0; baseIndex < (numVertices - 1);)
+    // keep the table at most half full
+    SizeT tableSize = 16;
+    while (tableSize < numVertices * 2)
     {
-        IndexT nextIndex = baseIndex + 1;
-        while ((nextIndex < numVertices) &&
-            (this->vertices[sortMap[baseIndex]] == this->vertices[sortMap[nextIndex]]))
-        {
-            // mark the vertex as invalid
-            this->vertices[sortMap[nextIndex]].SetFlag(MeshBuilderVertex::Redundant);
-
-            // put the new valid index into the index remapping table
-            indexMap[sortMap[nextIndex]] = sortMap[baseIndex];
-            nextIndex++;
-        }
-        baseIndex = nextIndex;
+        tableSize <<= 1;
     }
+    FixedArray<IndexT> table(tableSize, InvalidIndex);
+    FixedArray<uint> tableHashes(tableSize);
 
-    // fill the shiftMap, this contains for each vertex index the number
-    // of invalid vertices in front of it
-    SizeT numInvalid = 0;
-    IndexT vertexIndex;
-    for (vertexIndex = 0; vertexIndex < numVertices; vertexIndex++)
+    SizeT numUnique = 0;
+    IndexT i;
+    for (i = 0; i < numVertices; i++)
     {
-        if (this->vertices[vertexIndex].CheckFlag(MeshBuilderVertex::Redundant))
+        const uint hash = this->vertices[i].Hash();
+        IndexT slot = hash & (tableSize - 1);
+        while (true)
         {
-            numInvalid++;
+            const IndexT entry = table[slot];
+            if (entry == InvalidIndex)
+            {
+                // unique vertices are compacted in place, entries always point below the current vertex
+                table[slot] = numUnique;
+                tableHashes[slot] = hash;
+                if (numUnique != i)
+                {
+                    this->vertices[numUnique] = this->vertices[i];
+                }
+                indexMap[i] = numUnique++;
+                break;
+            }
+
+            const MeshBuilderVertex& other = this->vertices[entry];
+            if (tableHashes[slot] == hash
+                && other.componentMask == this->vertices[i].componentMask
+                && other.Compare(this->vertices[i]) == 0)
+            {
+                indexMap[i] = entry;
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
         }
-        shiftMap[vertexIndex] = numInvalid;
     }
+    this->vertices.Resize(numUnique);
 
-    // fix the triangle's vertex indices, first, remap the old index to a
-    // valid index from the indexMap, then decrement by the shiftMap entry
-    // at that index (which contains the number of invalid vertices in front
-    // of that index)
-    // fix vertex indices in triangles
     SizeT numTriangles = this->triangles.Size();
-    IndexT curTriangle;
-    for (curTriangle = 0; curTriangle < numTriangles; curTriangle++)
+    for (i = 0; i < numTriangles; i++)
     {
-        MeshBuilderTriangle& t = this->triangles[curTriangle];
-        for (i = 0; i < 3; i++)
-        {
-            IndexT newIndex = indexMap[t.vertexIndex[i]];
-            t.vertexIndex[i] = newIndex - shiftMap[newIndex];
-        }
+        MeshBuilderTriangle& t = this->triangles[i];
+        t.vertexIndex[0] = indexMap[t.vertexIndex[0]];
+        t.vertexIndex[1] = indexMap[t.vertexIndex[1]];
+        t.vertexIndex[2] = indexMap[t.vertexIndex[2]];
     }
+    return numUnique;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Cleanup the mesh. This removes redundant vertices and optionally record
+    the collapse history into a client-provided collapsMap. The collaps map
+    contains at each new vertex index the 'old' vertex indices which have
+    been collapsed into the new vertex.
+*/
+void
+MeshBuilder::Deflate(FixedArray<Array<IndexT>>* collapsMap)
+{
+    FixedArray<IndexT> indexMap;
+    this->WeldVertices(indexMap);
 
     // initialize the collapse map so that for each new (collapsed)
     // index it contains a list of old vertex indices which have been
     // collapsed into the new vertex 
     if (collapsMap)
     {
-        collapsMap->SetSize(numVertices);
-        for (i = 0; i < numVertices; i++)
-        {
-            IndexT newIndex = indexMap[i];
-            IndexT collapsedIndex = newIndex - shiftMap[newIndex];
-            (*collapsMap)[collapsedIndex].Append(i);
-        }
-    }
-
-    // finally, remove the redundant vertices
-    numVertices = this->vertices.Size();
-    Array<MeshBuilderVertex> newArray;
-    newArray.Reserve(numVertices);
-    for (vertexIndex = 0; vertexIndex < numVertices; vertexIndex++)
-    {
-        if (!this->vertices[vertexIndex].CheckFlag(MeshBuilderVertex::Redundant))
+        collapsMap->SetSize(indexMap.Size());
+        for (IndexT i = 0; i < indexMap.Size(); i++)
         {
-            newArray.Append(this->vertices[vertexIndex]);
+            (*collapsMap)[indexMap[i]].Append(i);
         }
     }
-    this->vertices = newArray;
-
-    // cleanup
-    Memory::Free(Memory::ScratchHeap, indexMap);
-    Memory::Free(Memory::ScratchHeap, sortMap);
-    Memory::Free(Memory::ScratchHeap, shiftMap);
 }
 
 //------------------------------------------------------------------------------
@@ -374,101 +347,273 @@ MeshBuilder::FlipUvs()
 
 void MeshBuilder::Cleanup(Array<Array<int> >* collapseMap)
 {
-    int numVertices = this->vertices.Size();
+    FixedArray<IndexT> indexMap;
+    this->WeldVertices(indexMap);
 
-    // generate a index remapping table and sorted vertex array
-    int* indexMap = new int[numVertices];
-    int* sortMap = new int[numVertices];
-    int* shiftMap = new int[numVertices];
-
-    int i;
-    for (i = 0; i < numVertices; i++)
+    // initialize the collaps map so that for each new (collapsed) index it contains a list of old vertex indices
+    //  which have been collapsed into the new vertex
+    if (collapseMap)
     {
-        indexMap[i] = i;
-        sortMap[i] = i;
+        for (IndexT i = 0; i < indexMap.Size(); i++)
+            (*collapseMap)[indexMap[i]].Append(i);
     }
+}
 
-    // generate a sorted index map (sort by X coordinate)
-    qsortData = this;
-    qsort(sortMap, numVertices, sizeof(int), MeshBuilder::VertexSorter);
-
-    // search sorted array for redundant vertices
-    int baseIndex = 0;
-    for (baseIndex = 0; baseIndex < (numVertices - 1);)
+//------------------------------------------------------------------------------
+/**
+    Reorder the triangles of every primitive group for the post transform
+    vertex cache. Groups stay in place, so only the order inside a group
+    changes.
+*/
+void
+MeshBuilder::OptimizeVertexCache()
+{
+    if (this->groups.IsEmpty())
+    {
+        this->OptimizeVertexCache(0, this->triangles.Size());
+    }
+    else
     {
-        int nextIndex = baseIndex + 1;
-        while (nextIndex < numVertices &&
-            this->vertices[sortMap[baseIndex]] == this->vertices[sortMap[nextIndex]])
+        for (IndexT i = 0; i < this->groups.Size(); i++)
         {
-            // mark the vertex as invalid
-            this->vertices[sortMap[nextIndex]].SetFlag(MeshBuilderVertex::Redundant);
-
-            // put the new valid index into the index remapping table
-            indexMap[sortMap[nextIndex]] = sortMap[baseIndex];
-            nextIndex++;
+            this->OptimizeVertexCache(this->groups[i].GetFirstTriangleIndex(), this->groups[i].GetNumTriangles());
         }
-
-        baseIndex = nextIndex;
     }
+}
 
-    // fill the shiftMap, this contains for each vertex index the number of invalid vertices in front of it
-    int numInvalid = 0;
-
-    int vertexIndex;
-    for (vertexIndex = 0; vertexIndex < numVertices; vertexIndex++)
+//------------------------------------------------------------------------------
+/**
+    Tom Forsyth's linear speed vertex cache optimization. Every vertex is
+    scored by its position in a simulated LRU cache and by the number of
+    triangles still using it, and the next triangle is the one with the
+    highest sum of vertex scores among those touching the cache. Vertices
+    of the last triangle get a lower fixed score, so the next triangle
+    doesn't just reuse them, and vertices with few triangles left are
+    boosted so they are finished off before they leave the cache.
+*/
+void
+MeshBuilder::OptimizeVertexCache(IndexT firstTriangle, SizeT numTriangles)
+{
+    if (numTriangles < 2)
     {
-        if (this->vertices[vertexIndex].CheckFlag(MeshBuilderVertex::Redundant))
-            numInvalid++;
+        return;
+    }
+    const SizeT CacheSize = VertexCacheSize;
+    const SizeT MaxValence = 32;
+    const SizeT numVertices = this->vertices.Size();
 
-        shiftMap[vertexIndex] = numInvalid;
+    float cacheScores[CacheSize];
+    float valenceScores[MaxValence + 1];
+    IndexT i;
+    for (i = 0; i < CacheSize; i++)
+    {
+        cacheScores[i] = i < 3 ? 0.75f : Math::pow(1.0f - float(i - 3) / float(CacheSize - 3), 1.5f);
+    }
+    valenceScores[0] = 0.0f;
+    for (i = 1; i <= MaxValence; i++)
+    {
+        valenceScores[i] = 2.0f / Math::sqrt(float(i));
+    }
+    auto vertexScore = [&](IndexT cachePosition, SizeT numLive) -> float
+    {
+        if (numLive == 0)
+            return -1.0f;
+        float score = cachePosition != InvalidIndex ? cacheScores[cachePosition] : 0.0f;
+        return score + valenceScores[Math::min(numLive, MaxValence)];
+    };
+
+    // bucket the triangles of the range by vertex, the live triangles of a vertex are kept in front
+    FixedArray<SizeT> numLive(numVertices, 0);
+    for (i = 0; i < numTriangles; i++)
+    {
+        const MeshBuilderTriangle& t = this->triangles[firstTriangle + i];
+        numLive[t.vertexIndex[0]]++;
+        numLive[t.vertexIndex[1]]++;
+        numLive[t.vertexIndex[2]]++;
+    }
+    FixedArray<IndexT> offsets(numVertices + 1);
+    offsets[0] = 0;
+    for (i = 0; i < numVertices; i++)
+    {
+        offsets[i + 1] = offsets[i] + numLive[i];
+    }
+    FixedArray<IndexT> fill(offsets);
+    FixedArray<IndexT> adjacency(numTriangles * 3);
+    for (i = 0; i < numTriangles; i++)
+    {
+        const MeshBuilderTriangle& t = this->triangles[firstTriangle + i];
+        adjacency[fill[t.vertexIndex[0]]++] = i;
+        adjacency[fill[t.vertexIndex[1]]++] = i;
+        adjacency[fill[t.vertexIndex[2]]++] = i;
     }
 
-    // fix the triangle's vertex indices, first, remap the old index to a valid index from the indexMap,
-    //  then decrement by the shiftMap entry at that index, which contains the number of invalid vertices
-    //  in front of that index
-    //  fix vertex indices in triangles
-    int numTriangles = this->triangles.Size();
+    FixedArray<IndexT> cachePositions(numVertices, InvalidIndex);
+    FixedArray<float> vertexScores(numVertices, 0.0f);
+    for (i = 0; i < numVertices; i++)
+    {
+        vertexScores[i] = vertexScore(InvalidIndex, numLive[i]);
+    }
+    FixedArray<float> triangleScores(numTriangles);
+    FixedArray<bool> emitted(numTriangles, false);
+    for (i = 0; i < numTriangles; i++)
+    {
+        const MeshBuilderTriangle& t = this->triangles[firstTriangle + i];
+        triangleScores[i] = vertexScores[t.vertexIndex[0]] + vertexScores[t.vertexIndex[1]] + vertexScores[t.vertexIndex[2]];
+    }
 
-    int curTriangle;
-    for (curTriangle = 0; curTriangle < numTriangles; curTriangle++)
+    IndexT cache[CacheSize + 3];
+    IndexT newCache[CacheSize + 3];
+    SizeT cacheCount = 0;
+    Array<MeshBuilderTriangle> ordered;
+    ordered.Reserve(numTriangles);
+    IndexT best = InvalidIndex;
+    IndexT cursor = 0;
+    while (ordered.Size() < numTriangles)
     {
-        MeshBuilderTriangle& t = this->triangles[curTriangle];
-        for (i = 0; i < 3; i++)
+        if (best == InvalidIndex)
         {
-            int newIndex = indexMap[t.vertexIndex[i]];
-            t.vertexIndex[i] = newIndex - shiftMap[newIndex];
+            // nothing in the cache has triangles left, continue with the next triangle in the original order
+            while (emitted[cursor])
+            {
+                cursor++;
+            }
+            best = cursor;
         }
-    }
+        const MeshBuilderTriangle& tri = this->triangles[firstTriangle + best];
+        emitted[best] = true;
+        ordered.Append(tri);
 
-    // initialize the collaps map so that for each new (collapsed) index it contains a list of old vertex indices
-    //  which have been collapsed into the new vertex
-    if (collapseMap)
-    {
-        for (i = 0; i < numVertices; i++)
+        // remove the triangle from the live triangles of its vertices
+        SizeT newCount = 0;
+        for (IndexT corner = 0; corner < 3; corner++)
         {
-            int newIndex = indexMap[i];
-            int collapsedIndex = newIndex - shiftMap[newIndex];
+            const IndexT v = tri.vertexIndex[corner];
+            IndexT* live = &adjacency[offsets[v]];
+            for (IndexT j = 0; j < numLive[v]; j++)
+            {
+                if (live[j] == best)
+                {
+                    live[j] = live[numLive[v] - 1];
+                    live[numLive[v] - 1] = best;
+                    numLive[v]--;
+                    break;
+                }
+            }
+            if ((newCount < 1 || newCache[0] != v) && (newCount < 2 || newCache[1] != v))
+            {
+                newCache[newCount++] = v;
+            }
+        }
 
-            (*collapseMap)[collapsedIndex].Append(i);
+        // the triangle's vertices move to the front of the cache, the rest is pushed back
+        for (i = 0; i < cacheCount; i++)
+        {
+            const IndexT v = cache[i];
+            if (v != tri.vertexIndex[0] && v != tri.vertexIndex[1] && v != tri.vertexIndex[2])
+            {
+                newCache[newCount++] = v;
+            }
         }
-    }
 
-    // finally, remove the redundant vertices
-    numVertices = this->vertices.Size();
+        // rescore the vertices whose cache position changed, including the ones which fell out
+        for (i = 0; i < newCount; i++)
+        {
+            const IndexT v = newCache[i];
+            cachePositions[v] = i < CacheSize ? i : InvalidIndex;
+            const float score = vertexScore(cachePositions[v], numLive[v]);
+            const float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+            for (IndexT j = 0; j < numLive[v]; j++)
+            {
+                triangleScores[adjacency[offsets[v] + j]] += delta;
+            }
+        }
 
-    Array<MeshBuilderVertex> newArray(numVertices, numVertices);
-    for (vertexIndex = 0; vertexIndex < numVertices; vertexIndex++)
+        // the best next triangle uses a vertex in the cache
+        best = InvalidIndex;
+        float bestScore = -1.0f;
+        cacheCount = Math::min(newCount, CacheSize);
+        for (i = 0; i < cacheCount; i++)
+        {
+            const IndexT v = newCache[i];
+            cache[i] = v;
+            for (IndexT j = 0; j < numLive[v]; j++)
+            {
+                const IndexT t = adjacency[offsets[v] + j];
+                if (triangleScores[t] > bestScore)
+                {
+                    best = t;
+                    bestScore = triangleScores[t];
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < numTriangles; i++)
     {
-        if (!this->vertices[vertexIndex].CheckFlag(MeshBuilderVertex::Redundant))
-            newArray.Append(this->vertices[vertexIndex]);
+        this->triangles[firstTriangle + i] = ordered[i];
     }
+}
 
-    this->vertices = newArray;
+//------------------------------------------------------------------------------
+/**
+    Renumber the vertices in the order the triangles first use them, so
+    that vertex fetches walk through memory mostly linearly. Should run
+    after the last pass reordering triangles.
+*/
+void
+MeshBuilder::OptimizeVertexFetch()
+{
+    FixedArray<IndexT> remap(this->vertices.Size(), InvalidIndex);
+    Array<MeshBuilderVertex> newVertices;
+    newVertices.Reserve(this->vertices.Size());
+    for (IndexT i = 0; i < this->triangles.Size(); i++)
+    {
+        MeshBuilderTriangle& t = this->triangles[i];
+        for (IndexT corner = 0; corner < 3; corner++)
+        {
+            IndexT& index = t.vertexIndex[corner];
+            if (remap[index] == InvalidIndex)
+            {
+                remap[index] = newVertices.Size();
+                newVertices.Append(this->vertices[index]);
+            }
+            index = remap[index];
+        }
+    }
+    this->vertices = std::move(newVertices);
+}
 
-    // cleanup
-    delete[] indexMap;
-    delete[] sortMap;
-    delete[] shiftMap;
+//------------------------------------------------------------------------------
+/**
+    A vertex is in the FIFO cache if fewer than cacheSize misses happened
+    since it was last transformed. 3 is the worst case, 0.5 is the best
+    possible value for a regular grid.
+*/
+float
+MeshBuilder::ComputeAcmr(SizeT cacheSize) const
+{
+    if (this->triangles.IsEmpty())
+    {
+        return 0.0f;
+    }
+    FixedArray<SizeT> timestamps(this->vertices.Size(), 0);
+    SizeT time = cacheSize + 1;
+    SizeT misses = 0;
+    for (IndexT i = 0; i < this->triangles.Size(); i++)
+    {
+        const MeshBuilderTriangle& t = this->triangles[i];
+        for (IndexT corner = 0; corner < 3; corner++)
+        {
+            const IndexT v = t.vertexIndex[corner];
+            if (time - timestamps[v] > cacheSize)
+            {
+                timestamps[v] = time++;
+                misses++;
+            }
+        }
+    }
+    return misses / float(this->triangles.Size());
 }
 
 //------------------------------------------------------------------------------
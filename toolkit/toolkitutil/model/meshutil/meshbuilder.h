@@ -24,6 +24,8 @@ class MeshBuilder
 {
     struct Mesh;
 public:
+    /// size of the vertex cache the triangles are optimized for
+    static const SizeT VertexCacheSize = 16;
 
     /// constructor
     MeshBuilder();
@@ -75,6 +77,12 @@ public:
     void Transform(const Math::mat4& m);
     /// remove redundant vertices
     void Deflate(Util::FixedArray<Util::Array<IndexT> >* collapseMap);
+    /// reorder the triangles of each group to make better use of the post transform vertex cache
+    void OptimizeVertexCache();
+    /// reorder the vertices in the order the triangles reference them, drops unreferenced vertices
+    void OptimizeVertexFetch();
+    /// compute the average cache miss ratio, the number of transformed vertices per triangle with a FIFO cache
+    float ComputeAcmr(SizeT cacheSize = VertexCacheSize) const;
     /// inflate mesh to 3 unique vertices per triangles, created redundant vertices
     void Inflate();
     /// flip v texture coordinates
@@ -91,9 +99,11 @@ public:
     void CalculateTangents();
 
 private:
-    /// a qsort() hook for generating a sorted index array
-    static int __cdecl VertexSorter(const void* elm0, const void* elm1);
-    static MeshBuilder* qsortData;
+    /// weld equal vertices, fills the new index of every old vertex
+    SizeT WeldVertices(Util::FixedArray<IndexT>& indexMap);
+    /// reorder a range of triangles for the vertex cache
+    void OptimizeVertexCache(IndexT firstTriangle, SizeT numTriangles);
+
     friend class MeshBuilderSaver;
     friend class SkinPartitioner;
     friend class SkinFragment;
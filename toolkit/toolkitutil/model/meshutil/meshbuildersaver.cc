@@ -24,7 +24,7 @@ using namespace Math;
 /**
 */
 bool
-MeshBuilderSaver::Save(const IO::URI& uri, const Util::Array<MeshBuilder*>& meshes, Platform::Code platform)
+MeshBuilderSaver::Save(const IO::URI& uri, const Util::Array<MeshBuilder*>& meshes, Platform::Code platform, const MeshletBuilder* meshlets)
 {
     // make sure the target directory exists
     IoServer::Instance()->CreateDirectory(uri.LocalPath().ExtractDirName());
@@ -35,9 +35,9 @@ MeshBuilderSaver::Save(const IO::URI& uri, const Util::Array<MeshBuilder*>& mesh
     {
         ByteOrder byteOrder(ByteOrder::Host, Platform::GetPlatformByteOrder(platform));
 
-        MeshBuilderSaver::WriteHeader(stream, meshes, byteOrder);
-        MeshBuilderSaver::WriteMeshes(stream, meshes, byteOrder);
-        MeshBuilderSaver::WriteMeshlets(stream, meshes, byteOrder);
+        MeshBuilderSaver::WriteHeader(stream, meshes, meshlets, byteOrder);
+        MeshBuilderSaver::WriteMeshes(stream, meshes, meshlets, byteOrder);
+        MeshBuilderSaver::WriteMeshlets(stream, meshlets, byteOrder);
         MeshBuilderSaver::WriteVertices(stream, meshes, byteOrder);
         MeshBuilderSaver::WriteTriangles(stream, meshes, byteOrder);
 
@@ -58,12 +58,13 @@ MeshBuilderSaver::Save(const IO::URI& uri, const Util::Array<MeshBuilder*>& mesh
 /**
 */
 void
-MeshBuilderSaver::WriteHeader(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const System::ByteOrder& byteOrder)
+MeshBuilderSaver::WriteHeader(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const MeshletBuilder* meshlets, const System::ByteOrder& byteOrder)
 {
     SizeT indexDataSize = 0;
     SizeT vertexDataSize = 0;
     SizeT meshDataSize = meshes.Size() * sizeof(Nvx3VertexRange);
-    SizeT meshletDataSize = 0;
+    SizeT numMeshlets = meshlets != nullptr ? meshlets->GetMeshlets().Size() : 0;
+    SizeT meshletDataSize = numMeshlets * sizeof(Nvx3Meshlet);
     for (IndexT i = 0; i < meshes.Size(); i++)
     {
         meshDataSize += meshes[i]->groups.Size() * sizeof(Nvx3Group);
@@ -83,7 +84,7 @@ MeshBuilderSaver::WriteHeader(const Ptr<IO::Stream>& stream, const Util::Array<M
     nvx3Header.meshDataOffset = sizeof(Nvx3Header);
     nvx3Header.numMeshes = byteOrder.Convert<uint>(meshes.Size());
     nvx3Header.meshletDataOffset = sizeof(Nvx3Header) + meshDataSize;
-    nvx3Header.numMeshlets = 0; // TODO: Add meshlet support
+    nvx3Header.numMeshlets = byteOrder.Convert<uint>(numMeshlets);
     nvx3Header.vertexDataOffset = sizeof(Nvx3Header) + meshDataSize + meshletDataSize; 
     nvx3Header.vertexDataSize = vertexDataSize;
     nvx3Header.indexDataOffset = sizeof(Nvx3Header) + meshDataSize + meshletDataSize + vertexDataSize;
@@ -97,9 +98,11 @@ MeshBuilderSaver::WriteHeader(const Ptr<IO::Stream>& stream, const Util::Array<M
 /**
 */
 void
-MeshBuilderSaver::WriteMeshes(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const System::ByteOrder& byteOrder)
+MeshBuilderSaver::WriteMeshes(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const MeshletBuilder* meshlets, const System::ByteOrder& byteOrder)
 {
     uint indexByteOffset = 0;
+    uint meshletIndex = 0;
+    IndexT meshletGroupIndex = 0;
     uint vertexByteOffset = 0;
     uint groupByteOffset = sizeof(Nvx3Header) + meshes.Size() * sizeof(Nvx3VertexRange);
 
@@ -132,9 +135,11 @@ MeshBuilderSaver::WriteMeshes(const Ptr<IO::Stream>& stream, const Util::Array<M
             nvx3Group.numIndices = byteOrder.Convert<uint>(numTriangles * 3);
             nvx3Group.primType = PrimitiveTopology::TriangleList;
             
-            // TODO: Add support for meshlets
-            nvx3Group.firstMeshlet = 0;
-            nvx3Group.numMeshlets = 0;
+            // meshlets are counted in the same mesh and group order
+            uint numMeshlets = meshlets != nullptr ? meshlets->GetGroupMeshletCounts()[meshletGroupIndex++] : 0;
+            nvx3Group.firstMeshlet = byteOrder.Convert<uint>(meshletIndex);
+            nvx3Group.numMeshlets = byteOrder.Convert<uint>(numMeshlets);
+            meshletIndex += numMeshlets;
             groups.Append(nvx3Group);
         }
 
@@ -143,6 +148,8 @@ MeshBuilderSaver::WriteMeshes(const Ptr<IO::Stream>& stream, const Util::Array<M
         vertexByteOffset += baseVertexDataSize + attributesVertexDataSize;
     }
 
+    n_assert(meshlets == nullptr || meshletGroupIndex == meshlets->GetGroupMeshletCounts().Size());
+
     // Write groups after all meshes
     for (IndexT groupIndex = 0; groupIndex < groups.Size(); groupIndex++)
     {
@@ -329,8 +336,20 @@ MeshBuilderSaver::WriteTriangles(const Ptr<Stream>& stream, const Util::Array<Me
 /**
 */
 void 
-MeshBuilderSaver::WriteMeshlets(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const System::ByteOrder& byteOrder)
+MeshBuilderSaver::WriteMeshlets(const Ptr<IO::Stream>& stream, const MeshletBuilder* meshlets, const System::ByteOrder& byteOrder)
 {
+    if (meshlets == nullptr)
+        return;
+
+    const Util::Array<Nvx3Meshlet>& data = meshlets->GetMeshlets();
+    for (IndexT i = 0; i < data.Size(); i++)
+    {
+        Nvx3Meshlet meshlet = data[i];
+        meshlet.firstIndex = byteOrder.Convert<uint>(meshlet.firstIndex);
+        meshlet.numIndices = byteOrder.Convert<uint>(meshlet.numIndices);
+        meshlet.numVertices = byteOrder.Convert<uint>(meshlet.numVertices);
+        stream->Write(&meshlet, sizeof(Nvx3Meshlet));
+    }
 }
 
 } // namespace ToolkitUtil
@@ -8,6 +8,7 @@
 */
 #include "io/uri.h"
 #include "model/meshutil/meshbuilder.h"
+#include "model/meshutil/meshletbuilder.h"
 #include "toolkit-common/platform.h"
 #include "io/stream.h"
 #include "system/byteorder.h"
@@ -18,21 +19,21 @@ namespace ToolkitUtil
 class MeshBuilderSaver
 {
 public:
-    /// save nvx3 file
-    static bool Save(const IO::URI& uri, const Util::Array<MeshBuilder*>& meshes, Platform::Code platform);
+    /// save nvx3 file, optionally with the meshlets built from the same meshes
+    static bool Save(const IO::URI& uri, const Util::Array<MeshBuilder*>& meshes, Platform::Code platform, const MeshletBuilder* meshlets = nullptr);
 private:
 
     /// write header to stream using nvx3
-    static void WriteHeader(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const System::ByteOrder& byteOrder);
+    static void WriteHeader(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const MeshletBuilder* meshlets, const System::ByteOrder& byteOrder);
     /// Write meshes
-    static void WriteMeshes(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const System::ByteOrder& byteOrder);
+    static void WriteMeshes(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const MeshletBuilder* meshlets, const System::ByteOrder& byteOrder);
 
     /// write the vertices to stream
     static void WriteVertices(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const System::ByteOrder& byteOrder);
     /// write the triangles to stream
     static void WriteTriangles(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const System::ByteOrder& byteOrder);
     /// Write meshlets
-    static void WriteMeshlets(const Ptr<IO::Stream>& stream, const Util::Array<MeshBuilder*>& meshes, const System::ByteOrder& byteOrder);
+    static void WriteMeshlets(const Ptr<IO::Stream>& stream, const MeshletBuilder* meshlets, const System::ByteOrder& byteOrder);
 };
 
 } // namespace ToolkitUtil
@@ -54,6 +54,11 @@ MeshBuilderVertex::Compare(const MeshBuilderVertex& rhs) const
             return 1;
         else if (less_any(this->attributes.normal.tangent, rhs.attributes.normal.tangent))
             return -1;
+
+        if (this->attributes.normal.sign > rhs.attributes.normal.sign)
+            return 1;
+        else if (this->attributes.normal.sign < rhs.attributes.normal.sign)
+            return -1;
     }
     if (AllBits(this->componentMask, Components::Color))
     {
@@ -88,12 +93,94 @@ MeshBuilderVertex::Compare(const MeshBuilderVertex& rhs) const
             || this->attributes.skin.indices.z < rhs.attributes.skin.indices.z
             || this->attributes.skin.indices.w < rhs.attributes.skin.indices.w)
             return -1;
+
+        // vertices of different skin fragments may share joints but not their remapped indices
+        if (this->attributes.skin.remapIndices.x > rhs.attributes.skin.remapIndices.x
+            || this->attributes.skin.remapIndices.y > rhs.attributes.skin.remapIndices.y
+            || this->attributes.skin.remapIndices.z > rhs.attributes.skin.remapIndices.z
+            || this->attributes.skin.remapIndices.w > rhs.attributes.skin.remapIndices.w)
+            return 1;
+        else if (this->attributes.skin.remapIndices.x < rhs.attributes.skin.remapIndices.x
+            || this->attributes.skin.remapIndices.y < rhs.attributes.skin.remapIndices.y
+            || this->attributes.skin.remapIndices.z < rhs.attributes.skin.remapIndices.z
+            || this->attributes.skin.remapIndices.w < rhs.attributes.skin.remapIndices.w)
+            return -1;
     }
 
     // fallthrough: all components equal
     return 0;
 }
 
+//------------------------------------------------------------------------------
+/**
+    Adding 0 turns -0 into +0, which Compare() treats as equal.
+*/
+static inline uint
+HashFloat(uint hash, float value)
+{
+    value += 0.0f;
+    uint bits;
+    Memory::Copy(&value, &bits, sizeof(uint));
+    return (hash ^ bits) * 16777619u;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+uint
+MeshBuilderVertex::Hash() const
+{
+    uint hash = 2166136261u;
+    hash = HashFloat(hash, this->base.position.x);
+    hash = HashFloat(hash, this->base.position.y);
+    hash = HashFloat(hash, this->base.position.z);
+    hash = HashFloat(hash, this->base.position.w);
+    hash = HashFloat(hash, this->base.uv.x);
+    hash = HashFloat(hash, this->base.uv.y);
+    if (AllBits(this->componentMask, Components::Normals))
+    {
+        hash = HashFloat(hash, this->attributes.normal.normal.x);
+        hash = HashFloat(hash, this->attributes.normal.normal.y);
+        hash = HashFloat(hash, this->attributes.normal.normal.z);
+        hash = HashFloat(hash, this->attributes.normal.tangent.x);
+        hash = HashFloat(hash, this->attributes.normal.tangent.y);
+        hash = HashFloat(hash, this->attributes.normal.tangent.z);
+        hash = HashFloat(hash, this->attributes.normal.sign);
+    }
+    if (AllBits(this->componentMask, Components::Color))
+    {
+        hash = HashFloat(hash, this->attributes.color.color.x);
+        hash = HashFloat(hash, this->attributes.color.color.y);
+        hash = HashFloat(hash, this->attributes.color.color.z);
+        hash = HashFloat(hash, this->attributes.color.color.w);
+    }
+    if (AllBits(this->componentMask, Components::SecondUv))
+    {
+        hash = HashFloat(hash, this->attributes.secondUv.uv2.x);
+        hash = HashFloat(hash, this->attributes.secondUv.uv2.y);
+    }
+    if (AllBits(this->componentMask, Components::SkinIndices | Components::SkinWeights))
+    {
+        hash = HashFloat(hash, this->attributes.skin.weights.x);
+        hash = HashFloat(hash, this->attributes.skin.weights.y);
+        hash = HashFloat(hash, this->attributes.skin.weights.z);
+        hash = HashFloat(hash, this->attributes.skin.weights.w);
+        for (IndexT i = 0; i < 4; i++)
+        {
+            hash = (hash ^ this->attributes.skin.indices.v[i]) * 16777619u;
+            hash = (hash ^ this->attributes.skin.remapIndices.v[i]) * 16777619u;
+        }
+    }
+
+    // FNV leaves the low bits poorly mixed, finish with an avalanche
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
 //------------------------------------------------------------------------------
 /**
 */
@@ -89,12 +89,15 @@ public:
 
     /// compare vertex against other, return -1, 0 or +1
     int Compare(const MeshBuilderVertex& rhs) const;
+    /// hash the components which Compare() looks at, equal vertices have equal hashes
+    uint Hash() const;
     /// transform the vertex
     void Transform(const Math::mat4& m);
 
 private:
     friend class MeshBuilder;
     friend class MeshBuilderSaver;
+    friend class MeshletBuilder;
     friend class SkinPartitioner;
     friend class SkinFragment;
     friend class NFbxScene;
@@ -0,0 +1,414 @@
+//------------------------------------------------------------------------------
+//  meshletbuilder.cc
+//  (C) 2024 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "foundation/stdneb.h"
+#include "meshletbuilder.h"
+
+#include <algorithm>
+
+namespace ToolkitUtil
+{
+using namespace Util;
+using namespace Math;
+using namespace CoreGraphics;
+
+//------------------------------------------------------------------------------
+/**
+*/
+MeshletBuilder::MeshletBuilder() :
+    numTriangles(0),
+    groupFirstTriangle(0),
+    seedCursor(0),
+    meshletIndex(InvalidIndex),
+    meshletNumTriangles(0)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+MeshletBuilder::Clear()
+{
+    this->meshlets.Clear();
+    this->groupMeshletCounts.Clear();
+    this->numTriangles = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+MeshletBuilder::Build(const Util::Array<MeshBuilder*>& meshes)
+{
+    this->Clear();
+    for (IndexT meshIndex = 0; meshIndex < meshes.Size(); meshIndex++)
+    {
+        MeshBuilder* mesh = meshes[meshIndex];
+        const Array<MeshBuilderGroup>& groups = mesh->GetPrimitiveGroups();
+        for (IndexT groupIndex = 0; groupIndex < groups.Size(); groupIndex++)
+        {
+            this->BuildGroup(mesh, groups[groupIndex].GetFirstTriangleIndex(), groups[groupIndex].GetNumTriangles());
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+MeshletBuilder::BuildGroup(MeshBuilder* mesh, IndexT firstTriangle, SizeT numTriangles)
+{
+    const SizeT firstMeshlet = this->meshlets.Size();
+    if (numTriangles == 0)
+    {
+        this->groupMeshletCounts.Append(0);
+        return;
+    }
+    n_assert(firstTriangle + numTriangles <= mesh->GetNumTriangles());
+    this->groupFirstTriangle = firstTriangle;
+    this->numTriangles += numTriangles;
+
+    // count the triangles of every vertex, then bucket them by vertex
+    const SizeT numVertices = mesh->GetNumVertices();
+    this->liveTriangleCounts.Resize(numVertices);
+    this->liveTriangleCounts.Fill(0, numVertices, 0);
+    this->vertexTriangleOffsets.Resize(numVertices + 1);
+    this->vertexMeshlet.Resize(numVertices);
+    this->vertexMeshlet.Fill(0, numVertices, InvalidIndex);
+    IndexT i;
+    for (i = 0; i < numTriangles; i++)
+    {
+        IndexT v[3];
+        mesh->TriangleAt(firstTriangle + i).GetVertexIndices(v[0], v[1], v[2]);
+        this->liveTriangleCounts[v[0]]++;
+        this->liveTriangleCounts[v[1]]++;
+        this->liveTriangleCounts[v[2]]++;
+    }
+
+    // offsets start out as the end of each bucket and are decremented while filling
+    IndexT offset = 0;
+    for (i = 0; i < numVertices; i++)
+    {
+        offset += this->liveTriangleCounts[i];
+        this->vertexTriangleOffsets[i] = offset;
+    }
+    this->vertexTriangleOffsets[numVertices] = offset;
+    this->vertexTriangles.Resize(offset);
+    for (i = 0; i < numTriangles; i++)
+    {
+        IndexT v[3];
+        mesh->TriangleAt(firstTriangle + i).GetVertexIndices(v[0], v[1], v[2]);
+        this->vertexTriangles[--this->vertexTriangleOffsets[v[0]]] = i;
+        this->vertexTriangles[--this->vertexTriangleOffsets[v[1]]] = i;
+        this->vertexTriangles[--this->vertexTriangleOffsets[v[2]]] = i;
+    }
+
+    this->emitted.Resize(numTriangles);
+    this->emitted.Fill(0, numTriangles, false);
+    this->triangleCandidate.Resize(numTriangles);
+    this->triangleCandidate.Fill(0, numTriangles, InvalidIndex);
+    this->candidates.Clear();
+    this->reordered.Clear();
+    this->reordered.Reserve(numTriangles);
+    this->seedCursor = 0;
+
+    while (this->reordered.Size() < numTriangles)
+    {
+        const IndexT seed = this->PickSeed(mesh);
+        const IndexT firstReordered = this->reordered.Size();
+        this->meshletIndex = this->meshlets.Size();
+        this->meshletNumTriangles = 0;
+        this->meshletVertices.Clear();
+        this->meshletTriangles.Clear();
+        this->candidates.Clear();
+
+        IndexT triangle = seed;
+        while (triangle != InvalidIndex)
+        {
+            this->AddTriangle(mesh, triangle);
+            triangle = this->PickCandidate(mesh);
+        }
+        this->FinishMeshlet(mesh, firstReordered);
+    }
+
+    // draw the meshlets facing away from the center of the group first, they are the most likely to occlude the others
+    this->order.Clear();
+    vec3 groupCenter(0.0f);
+    for (i = firstMeshlet; i < this->meshlets.Size(); i++)
+    {
+        const Nvx3Meshlet& meshlet = this->meshlets[i];
+        groupCenter += vec3(meshlet.boundingSphere[0], meshlet.boundingSphere[1], meshlet.boundingSphere[2]) * float(meshlet.numIndices);
+        this->order.Append(i);
+    }
+    groupCenter = groupCenter * (1.0f / float(numTriangles * 3));
+    this->sortKeys.Resize(this->meshlets.Size());
+    for (i = firstMeshlet; i < this->meshlets.Size(); i++)
+    {
+        const Nvx3Meshlet& meshlet = this->meshlets[i];
+        const vec3 center(meshlet.boundingSphere[0], meshlet.boundingSphere[1], meshlet.boundingSphere[2]);
+        this->sortKeys[i] = dot(center - groupCenter, vec3(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]));
+    }
+    std::stable_sort(this->order.begin(), this->order.end(), [this](IndexT lhs, IndexT rhs)
+    {
+        return this->sortKeys[lhs] > this->sortKeys[rhs];
+    });
+
+    // write the triangles back in meshlet order
+    IndexT triangle = firstTriangle;
+    this->sortedMeshlets.Clear();
+    for (i = 0; i < this->order.Size(); i++)
+    {
+        Nvx3Meshlet meshlet = this->meshlets[this->order[i]];
+        const IndexT source = meshlet.firstIndex / 3 - firstTriangle;
+        for (IndexT j = 0; j < meshlet.numIndices / 3; j++)
+        {
+            mesh->TriangleAt(triangle + j) = this->reordered[source + j];
+        }
+        meshlet.firstIndex = triangle * 3;
+        triangle += meshlet.numIndices / 3;
+        this->sortedMeshlets.Append(meshlet);
+    }
+    for (i = 0; i < this->sortedMeshlets.Size(); i++)
+    {
+        this->meshlets[firstMeshlet + i] = this->sortedMeshlets[i];
+    }
+    this->groupMeshletCounts.Append(this->meshlets.Size() - firstMeshlet);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Continuing next to the previous meshlet keeps the meshlets compact,
+    triangles with few live neighbours are preferred to avoid leaving
+    isolated triangles behind.
+*/
+IndexT
+MeshletBuilder::PickSeed(MeshBuilder* mesh)
+{
+    IndexT seed = InvalidIndex;
+    SizeT bestLive = 0;
+    for (IndexT i = 0; i < this->candidates.Size(); i++)
+    {
+        const IndexT candidate = this->candidates[i];
+        if (this->emitted[candidate])
+        {
+            continue;
+        }
+        IndexT v[3];
+        mesh->TriangleAt(this->groupFirstTriangle + candidate).GetVertexIndices(v[0], v[1], v[2]);
+        const SizeT live = this->liveTriangleCounts[v[0]] + this->liveTriangleCounts[v[1]] + this->liveTriangleCounts[v[2]];
+        if (seed == InvalidIndex || live < bestLive)
+        {
+            seed = candidate;
+            bestLive = live;
+        }
+    }
+
+    if (seed == InvalidIndex)
+    {
+        // the previous meshlet was an island, continue in the original triangle order
+        while (this->emitted[this->seedCursor])
+        {
+            this->seedCursor++;
+        }
+        seed = this->seedCursor;
+    }
+    return seed;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+MeshletBuilder::AddTriangle(MeshBuilder* mesh, IndexT triangle)
+{
+    const MeshBuilderTriangle& tri = mesh->TriangleAt(this->groupFirstTriangle + triangle);
+    this->emitted[triangle] = true;
+    this->meshletTriangles.Append(triangle);
+    this->meshletNumTriangles++;
+
+    IndexT v[3];
+    tri.GetVertexIndices(v[0], v[1], v[2]);
+    IndexT i;
+    for (i = 0; i < 3; i++)
+    {
+        this->liveTriangleCounts[v[i]]--;
+        if (this->vertexMeshlet[v[i]] != this->meshletIndex)
+        {
+            this->vertexMeshlet[v[i]] = this->meshletIndex;
+            this->meshletVertices.Append(v[i]);
+        }
+    }
+
+    // every triangle sharing a vertex with the meshlet becomes a candidate
+    for (i = 0; i < 3; i++)
+    {
+        for (IndexT j = this->vertexTriangleOffsets[v[i]]; j < this->vertexTriangleOffsets[v[i] + 1]; j++)
+        {
+            const IndexT neighbour = this->vertexTriangles[j];
+            if (!this->emitted[neighbour] && this->triangleCandidate[neighbour] != this->meshletIndex)
+            {
+                this->triangleCandidate[neighbour] = this->meshletIndex;
+                this->candidates.Append(neighbour);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Prefers the candidate adding the fewest new vertices, then the one
+    whose vertices have the fewest triangles left. Emitted candidates are
+    compacted away while scanning.
+*/
+IndexT
+MeshletBuilder::PickCandidate(MeshBuilder* mesh)
+{
+    if (this->meshletNumTriangles >= MaxTriangles)
+    {
+        return InvalidIndex;
+    }
+
+    IndexT best = InvalidIndex;
+    SizeT bestNew = 0;
+    SizeT bestLive = 0;
+    IndexT numCandidates = 0;
+    for (IndexT i = 0; i < this->candidates.Size(); i++)
+    {
+        const IndexT candidate = this->candidates[i];
+        if (this->emitted[candidate])
+        {
+            continue;
+        }
+        this->candidates[numCandidates++] = candidate;
+
+        IndexT v[3];
+        mesh->TriangleAt(this->groupFirstTriangle + candidate).GetVertexIndices(v[0], v[1], v[2]);
+        SizeT newVertices = 0;
+        SizeT live = 0;
+        for (IndexT j = 0; j < 3; j++)
+        {
+            newVertices += this->vertexMeshlet[v[j]] != this->meshletIndex ? 1 : 0;
+            live += this->liveTriangleCounts[v[j]];
+        }
+        if (this->meshletVertices.Size() + newVertices > MaxVertices)
+        {
+            continue;
+        }
+        if (best == InvalidIndex || newVertices < bestNew || (newVertices == bestNew && live < bestLive))
+        {
+            best = candidate;
+            bestNew = newVertices;
+            bestLive = live;
+        }
+    }
+    this->candidates.Resize(numCandidates);
+    return best;
+}
+
+//------------------------------------------------------------------------------
+/**
+    The bounding sphere is centered on the bounding box of the vertices.
+    The normal cone is built from the average triangle normal, its apex is
+    moved back along the axis until every triangle plane lies in front of
+    it, which keeps the culling test conservative.
+*/
+void
+MeshletBuilder::FinishMeshlet(MeshBuilder* mesh, IndexT firstReordered)
+{
+    // keep the triangles in their original order, which the vertex cache optimization chose
+    this->meshletTriangles.Sort();
+    for (IndexT t = 0; t < this->meshletTriangles.Size(); t++)
+    {
+        this->reordered.Append(mesh->TriangleAt(this->groupFirstTriangle + this->meshletTriangles[t]));
+    }
+
+    Nvx3Meshlet meshlet;
+    meshlet.firstIndex = (this->groupFirstTriangle + firstReordered) * 3;
+    meshlet.numIndices = this->meshletNumTriangles * 3;
+    meshlet.numVertices = this->meshletVertices.Size();
+
+    IndexT i;
+    vec3 minPoint = xyz(mesh->VertexAt(this->meshletVertices[0]).base.position);
+    vec3 maxPoint = minPoint;
+    for (i = 1; i < this->meshletVertices.Size(); i++)
+    {
+        const vec3 pos = xyz(mesh->VertexAt(this->meshletVertices[i]).base.position);
+        minPoint = minimize(minPoint, pos);
+        maxPoint = maximize(maxPoint, pos);
+    }
+    const vec3 center = (minPoint + maxPoint) * 0.5f;
+    float radius = 0.0f;
+    for (i = 0; i < this->meshletVertices.Size(); i++)
+    {
+        radius = Math::max(radius, length(xyz(mesh->VertexAt(this->meshletVertices[i]).base.position) - center));
+    }
+    meshlet.boundingSphere[0] = center.x;
+    meshlet.boundingSphere[1] = center.y;
+    meshlet.boundingSphere[2] = center.z;
+    meshlet.boundingSphere[3] = radius;
+
+    // degenerate triangles have no normal and don't restrict the cone
+    vec3 normals[MaxTriangles];
+    vec3 corners[MaxTriangles];
+    SizeT numNormals = 0;
+    vec3 axis(0.0f);
+    for (i = 0; i < this->meshletNumTriangles; i++)
+    {
+        IndexT v0, v1, v2;
+        this->reordered[firstReordered + i].GetVertexIndices(v0, v1, v2);
+        const vec3 p0 = xyz(mesh->VertexAt(v0).base.position);
+        const vec3 normal = cross(xyz(mesh->VertexAt(v1).base.position) - p0, xyz(mesh->VertexAt(v2).base.position) - p0);
+        const float area = length(normal);
+        if (area > 0.0f)
+        {
+            normals[numNormals] = normal * (1.0f / area);
+            corners[numNormals] = p0;
+            axis += normals[numNormals];
+            numNormals++;
+        }
+    }
+
+    float minDot = 1.0f;
+    const float axisLength = length(axis);
+    if (axisLength > 0.0f)
+    {
+        axis = axis * (1.0f / axisLength);
+        for (i = 0; i < numNormals; i++)
+        {
+            minDot = Math::min(minDot, dot(normals[i], axis));
+        }
+    }
+
+    // cones wider than a hemisphere can't cull anything, a small margin keeps the apex from going to infinity
+    if (axisLength == 0.0f || minDot <= 0.1f)
+    {
+        meshlet.coneApex[0] = center.x;
+        meshlet.coneApex[1] = center.y;
+        meshlet.coneApex[2] = center.z;
+        meshlet.coneAxis[0] = meshlet.coneAxis[1] = meshlet.coneAxis[2] = 0.0f;
+        meshlet.coneCutoff = 1.0f;
+    }
+    else
+    {
+        float maxDistance = 0.0f;
+        for (i = 0; i < numNormals; i++)
+        {
+            const float distance = dot(center - corners[i], normals[i]) / dot(axis, normals[i]);
+            maxDistance = Math::max(maxDistance, distance);
+        }
+        const vec3 apex = center - axis * maxDistance;
+        meshlet.coneApex[0] = apex.x;
+        meshlet.coneApex[1] = apex.y;
+        meshlet.coneApex[2] = apex.z;
+        meshlet.coneAxis[0] = axis.x;
+        meshlet.coneAxis[1] = axis.y;
+        meshlet.coneAxis[2] = axis.z;
+        meshlet.coneCutoff = Math::sqrt(1.0f - minDot * minDot);
+    }
+    this->meshlets.Append(meshlet);
+}
+
+} // namespace ToolkitUtil
@@ -0,0 +1,118 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class ToolkitUtil::MeshletBuilder
+
+    Partitions the primitive groups of meshes into meshlets, clusters of
+    triangles with a bounding sphere and a normal cone which can be culled
+    individually.
+
+    Meshlets are grown greedily from a seed triangle by adding the adjacent
+    triangle which introduces the fewest new vertices, until either the
+    vertex or the triangle limit is reached. The triangles of each group
+    are reordered so that every meshlet is a contiguous index range, inside
+    a meshlet the previous triangle order is kept. The meshlets of a group
+    are sorted so that the ones facing outwards are drawn first, which
+    reduces overdraw.
+
+    (C) 2024 Individual contributors, see AUTHORS file
+*/
+#include "model/meshutil/meshbuilder.h"
+#include "coregraphics/nvx3fileformatstructs.h"
+#include "util/array.h"
+
+//------------------------------------------------------------------------------
+namespace ToolkitUtil
+{
+class MeshletBuilder
+{
+public:
+    /// maximum number of unique vertices in a meshlet
+    static const SizeT MaxVertices = 64;
+    /// maximum number of triangles in a meshlet
+    static const SizeT MaxTriangles = 124;
+
+    /// constructor
+    MeshletBuilder();
+
+    /// build the meshlets of all groups of the meshes, reorders the triangles of the meshes
+    void Build(const Util::Array<MeshBuilder*>& meshes);
+    /// clear meshlets
+    void Clear();
+
+    /// get the meshlets of all groups of all meshes
+    const Util::Array<CoreGraphics::Nvx3Meshlet>& GetMeshlets() const;
+    /// get the number of meshlets of every group of every mesh, in order
+    const Util::Array<uint>& GetGroupMeshletCounts() const;
+    /// get the number of triangles the meshlets were built from
+    SizeT GetNumTriangles() const;
+
+private:
+    /// split a single group into meshlets
+    void BuildGroup(MeshBuilder* mesh, IndexT firstTriangle, SizeT numTriangles);
+    /// add a triangle of the group to the current meshlet
+    void AddTriangle(MeshBuilder* mesh, IndexT triangle);
+    /// pick the best candidate for the current meshlet, or InvalidIndex if none fits
+    IndexT PickCandidate(MeshBuilder* mesh);
+    /// pick the seed of the next meshlet, preferring the leftover candidates of the previous one
+    IndexT PickSeed(MeshBuilder* mesh);
+    /// finish the current meshlet, which starts at the given reordered triangle, and compute its bounds
+    void FinishMeshlet(MeshBuilder* mesh, IndexT firstReordered);
+
+    Util::Array<CoreGraphics::Nvx3Meshlet> meshlets;
+    Util::Array<uint> groupMeshletCounts;
+    SizeT numTriangles;
+
+    // per vertex triangle adjacency of the current group
+    Util::Array<IndexT> vertexTriangleOffsets;
+    Util::Array<IndexT> vertexTriangles;
+    Util::Array<SizeT> liveTriangleCounts;
+    Util::Array<IndexT> vertexMeshlet;
+
+    // per triangle state of the current group
+    Util::Array<bool> emitted;
+    Util::Array<IndexT> triangleCandidate;
+    Util::Array<IndexT> candidates;
+    Util::Array<IndexT> meshletVertices;
+    Util::Array<IndexT> meshletTriangles;
+    Util::Array<MeshBuilderTriangle> reordered;
+
+    // per meshlet state of the current group
+    Util::Array<IndexT> order;
+    Util::Array<float> sortKeys;
+    Util::Array<CoreGraphics::Nvx3Meshlet> sortedMeshlets;
+    IndexT groupFirstTriangle;
+    IndexT seedCursor;
+    IndexT meshletIndex;
+    SizeT meshletNumTriangles;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline const Util::Array<CoreGraphics::Nvx3Meshlet>&
+MeshletBuilder::GetMeshlets() const
+{
+    return this->meshlets;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline const Util::Array<uint>&
+MeshletBuilder::GetGroupMeshletCounts() const
+{
+    return this->groupMeshletCounts;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+MeshletBuilder::GetNumTriangles() const
+{
+    return this->numTriangles;
+}
+
+} // namespace ToolkitUtil
+//------------------------------------------------------------------------------
@@ -13,7 +13,7 @@ using namespace Util;
 namespace ToolkitUtil
 {
 
-__ImplementSingleton(ModelDatabase);
+__ImplementInterfaceSingleton(ModelDatabase);
 __ImplementClass(ToolkitUtil::ModelDatabase, 'IMDB', Core::RefCounted);
 
 //------------------------------------------------------------------------------
@@ -22,7 +22,7 @@ __ImplementClass(ToolkitUtil::ModelDatabase, 'IMDB', Core::RefCounted);
 ModelDatabase::ModelDatabase() :
     isOpen(false)
 {
-    __ConstructSingleton;
+    __ConstructInterfaceSingleton;
 }
 
 //------------------------------------------------------------------------------
@@ -30,7 +30,7 @@ ModelDatabase::ModelDatabase() :
 */
 ModelDatabase::~ModelDatabase()
 {
-    __DestructSingleton;
+    __DestructInterfaceSingleton;
 }
 
 //------------------------------------------------------------------------------
@@ -49,6 +49,7 @@ ModelDatabase::Open()
 void 
 ModelDatabase::Close()
 {
+    Threading::CriticalScope scope(&this->cs);
     n_assert(this->IsOpen());
     IndexT i;
     for (i = 0; i < this->modelAttributes.Size(); i++)
@@ -77,6 +78,7 @@ ModelDatabase::Close()
 void 
 ModelDatabase::LoadAttributes(const Util::String & folder)
 {
+    Threading::CriticalScope scope(&this->cs);
     
     Array<String> files = IoServer::Instance()->ListFiles(folder, "*.attributes");
     for (IndexT fileIndex = 0; fileIndex < files.Size(); fileIndex++)
@@ -139,6 +141,7 @@ ModelDatabase::LoadAttributes(const Util::String & folder)
 Ptr<ModelAttributes>
 ModelDatabase::LookupAttributes(const Util::String& name, bool reload)
 {
+    Threading::CriticalScope scope(&this->cs);
     if (!this->modelAttributes.Contains(name))
     {
         // create new model attributes
@@ -198,6 +201,7 @@ ModelDatabase::LookupAttributes(const Util::String& name, bool reload)
 bool
 ModelDatabase::AttributesExist(const Util::String& name)
 {
+    Threading::CriticalScope scope(&this->cs);
     // format file
     String file;
     file.Format("src:assets/%s.attributes", name.AsCharPtr());
@@ -214,9 +218,10 @@ ModelDatabase::AttributesExist(const Util::String& name)
 //------------------------------------------------------------------------------
 /**
 */
-const Util::String&
+Util::String
 ModelDatabase::GetAttributesName(const Ptr<ModelAttributes>& attrs)
 {
+    Threading::CriticalScope scope(&this->cs);
     IndexT index = this->modelAttributes.ValuesAsArray().FindIndex(attrs);
     n_assert(index != InvalidIndex);
     return this->modelAttributes.KeysAsArray()[index];
@@ -228,6 +233,7 @@ ModelDatabase::GetAttributesName(const Ptr<ModelAttributes>& attrs)
 Ptr<ModelPhysics>
 ModelDatabase::LookupPhysics(const Util::String& name, bool reload)
 {
+    Threading::CriticalScope scope(&this->cs);
     if (!this->modelPhysics.Contains(name))
     {
         // create new model attributes
@@ -287,6 +293,7 @@ ModelDatabase::LookupPhysics(const Util::String& name, bool reload)
 bool
 ModelDatabase::PhysicsExist(const Util::String& name)
 {
+    Threading::CriticalScope scope(&this->cs);
     // format file
     String file;
     file.Format("src:assets/%s.physics", name.AsCharPtr());
@@ -303,9 +310,10 @@ ModelDatabase::PhysicsExist(const Util::String& name)
 //------------------------------------------------------------------------------
 /**
 */
-const Util::String&
+Util::String
 ModelDatabase::GetPhysicsName(const Ptr<ModelPhysics>& attrs)
 {
+    Threading::CriticalScope scope(&this->cs);
     IndexT index = this->modelPhysics.ValuesAsArray().FindIndex(attrs);
     n_assert(index != InvalidIndex);
     return this->modelPhysics.KeysAsArray()[index];
@@ -317,6 +325,7 @@ ModelDatabase::GetPhysicsName(const Ptr<ModelPhysics>& attrs)
 Ptr<ModelConstants>
 ModelDatabase::LookupConstants(const Util::String& name, bool reload)
 {
+    Threading::CriticalScope scope(&this->cs);
     if (!this->modelConstants.Contains(name))
     {
         // create new model attributes
@@ -376,6 +385,7 @@ ModelDatabase::LookupConstants(const Util::String& name, bool reload)
 bool
 ModelDatabase::ConstantsExist(const Util::String& name)
 {
+    Threading::CriticalScope scope(&this->cs);
     // format file
     String file;
     file.Format("src:assets/%s.constants", name.AsCharPtr());
@@ -392,9 +402,10 @@ ModelDatabase::ConstantsExist(const Util::String& name)
 //------------------------------------------------------------------------------
 /**
 */
-const Util::String&
+Util::String
 ModelDatabase::GetConstantsName(const Ptr<ModelConstants>& constants)
 {
+    Threading::CriticalScope scope(&this->cs);
     IndexT index = this->modelConstants.ValuesAsArray().FindIndex(constants);
     n_assert(index != InvalidIndex);
     return this->modelConstants.KeysAsArray()[index];
@@ -3,7 +3,8 @@
 /**
     @class ToolkitUtil::ModelDatabase
     
-    Holds dictionary of import options, is also responsible for loading and saving them
+    Holds dictionary of import options, is also responsible for loading and saving them.
+    The database is shared by all threads, lookups are thread safe.
     
     (C) 2012-2016 Individual contributors, see AUTHORS file
 */
@@ -12,6 +13,7 @@
 #include "util/string.h"
 #include "core/singleton.h"
 #include "core/refcounted.h"
+#include "threading/criticalsection.h"
 #include "modelattributes.h"
 #include "modelconstants.h"
 #include "modelphysics.h"
@@ -21,7 +23,7 @@ namespace ToolkitUtil
 class ModelDatabase: public Core::RefCounted
     
 {
-    __DeclareSingleton(ModelDatabase);
+    __DeclareInterfaceSingleton(ModelDatabase);
     __DeclareClass(ModelDatabase);
 public:
 
@@ -45,24 +47,25 @@ public:
     /// checks if attributes exist
     bool AttributesExist(const Util::String& name);
     /// gets name of model attributes pointer
-    const Util::String& GetAttributesName(const Ptr<ModelAttributes>& attrs);
+    Util::String GetAttributesName(const Ptr<ModelAttributes>& attrs);
 
     /// performs lookup on physics attributes, loads from file if it doesn't exist
     Ptr<ModelPhysics> LookupPhysics(const Util::String& name, bool reload = false);
     /// checks if attributes exist
     bool PhysicsExist(const Util::String& name);
     /// gets name of model attributes pointer
-    const Util::String& GetPhysicsName(const Ptr<ModelPhysics>& attrs);
+    Util::String GetPhysicsName(const Ptr<ModelPhysics>& attrs);
 
     /// performs lookup on model constants, loads from file if it doesn't exist
     Ptr<ModelConstants> LookupConstants(const Util::String& name, bool reload = false);
     /// checks if constants exist
     bool ConstantsExist(const Util::String& name);
     /// gets name of model constants
-    const Util::String& GetConstantsName(const Ptr<ModelConstants>& constants);
+    Util::String GetConstantsName(const Ptr<ModelConstants>& constants);
 
 private:
     bool isOpen;
+    Threading::CriticalSection cs;
     Util::Dictionary<Util::String, Ptr<ModelAttributes>> modelAttributes;
     Util::Dictionary<Util::String, Ptr<ModelConstants>> modelConstants;
     Util::Dictionary<Util::String, Ptr<ModelPhysics>> modelPhysics;